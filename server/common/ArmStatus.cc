@@ -32,7 +32,14 @@ ArmInfo::ArmInfo(void)
 : running(false),
   stat(ARM_WORK_STAT_INIT),
   numUpdate(0),
-  numFailure(0)
+  numFailure(0),
+  pollingIntervalSec(0),
+  numEventsInLastPoll(0),
+  lastPollDurationMSec(0),
+  numAdmittedEvents(0),
+  numSpilledEvents(0),
+  numReplayedEvents(0),
+  numPendingEvents(0)
 {
 }
 
@@ -103,6 +110,17 @@ void ArmStatus::setArmInfo(const ArmInfo &armInfo)
 	m_impl->rwlock.unlock();
 }
 
+void ArmStatus::setPollingStatistics(const int &pollingIntervalSec,
+                                     const size_t &numEventsInLastPoll,
+                                     const size_t &lastPollDurationMSec)
+{
+	m_impl->rwlock.writeLock();
+	m_impl->armInfo.pollingIntervalSec = pollingIntervalSec;
+	m_impl->armInfo.numEventsInLastPoll = numEventsInLastPoll;
+	m_impl->armInfo.lastPollDurationMSec = lastPollDurationMSec;
+	m_impl->rwlock.unlock();
+}
+
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
@@ -45,6 +45,19 @@ struct ArmInfo
 
 	size_t           numUpdate;
 	size_t           numFailure;
+
+	// The interval actually used for the next polling. It differs from
+	// the configured one when the adaptive polling is enabled.
+	int              pollingIntervalSec;
+	size_t           numEventsInLastPoll;
+	size_t           lastPollDurationMSec;
+
+	// The statistics of the admission control of the events. They are
+	// filled by UnifiedDataStore, not by the arm.
+	size_t           numAdmittedEvents;
+	size_t           numSpilledEvents;
+	size_t           numReplayedEvents;
+	size_t           numPendingEvents;
 	
 	// Constructor
 	ArmInfo(void);
@@ -69,6 +82,9 @@ public:
 	void logFailure(const std::string &comment = "",
 	                const ArmWorkingStatus &status = ARM_WORK_STAT_FAILURE);
 	void setArmInfo(const ArmInfo &armInfo);
+	void setPollingStatistics(const int &pollingIntervalSec,
+	                          const size_t &numEventsInLastPoll,
+	                          const size_t &lastPollDurationMSec);
 
 protected:
 
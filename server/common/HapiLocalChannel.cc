@@ -0,0 +1,680 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <Logger.h>
+#include <Mutex.h>
+#include <AtomicValue.h>
+#include "HapiLocalChannel.h"
+
+using namespace std;
+using namespace mlpl;
+
+const char *HapiLocalChannel::ENV_NAME = "HAPI_LOCAL_CHANNEL";
+const size_t HapiLocalChannel::DEFAULT_RING_SIZE = 4 * 1024 * 1024;
+const size_t HapiLocalChannel::MAX_MESSAGE_SIZE = 128 * 1024 * 1024;
+
+static const uint32_t CHANNEL_MAGIC   = 0x48415043; // 'HAPC'
+static const uint32_t CHANNEL_VERSION = 2;
+static const int      STALL_TIMEOUT_MSEC = 30 * 1000;
+static const useconds_t WAIT_SPACE_INTERVAL_USEC = 1000;
+static const mode_t   CHANNEL_MODE = S_IRUSR | S_IWUSR;
+static const mode_t   CHANNEL_DIR_MODE = S_IRWXU | S_IRWXG;
+
+enum {
+	RING_TO_PLUGIN,
+	RING_TO_SERVER,
+	NUM_RINGS,
+};
+
+// A plugin attaches to the channel by incrementing attachCount after it
+// saves the head of the ring to the server in attachHead. The server
+// skips the data before attachHead, which may be a part of a message
+// written by the previous plugin. The server acknowledges the attach by
+// setting ackedAttach after it saves the head of the ring to the plugin
+// in ackHead at a message boundary. The plugin reads from there.
+//
+// The server increments 'generation' when it opens the channel again.
+// A plugin that attached to the previous generation gets an exception.
+struct ChannelHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t ringSize;
+	volatile uint64_t generation;
+	volatile uint64_t attachCount;
+	volatile uint64_t attachHead;
+	volatile uint64_t ackedAttach;
+	volatile uint64_t ackHead;
+	uint8_t  reserved[8];
+};
+
+// The head and the tail are placed on the different cache lines so that
+// the writer and the reader don't contend for the same line.
+struct RingHeader {
+	volatile uint64_t head; // Total bytes written by the writer
+	uint8_t  reserved0[56];
+	volatile uint64_t tail; // Total bytes read by the reader
+	uint8_t  reserved1[56];
+};
+
+struct Ring {
+	RingHeader *header;
+	uint8_t    *data;
+	uint64_t    size;
+	int         notifyFd;
+
+	Ring(void)
+	: header(NULL),
+	  data(NULL),
+	  size(0),
+	  notifyFd(-1)
+	{
+	}
+
+	uint64_t getUsedSize(void) const
+	{
+		__sync_synchronize();
+		return header->head - header->tail;
+	}
+
+	void copyIn(const uint8_t *src, const uint64_t &length)
+	{
+		const uint64_t offset = header->head % size;
+		const uint64_t firstLength = min(length, size - offset);
+		memcpy(&data[offset], src, firstLength);
+		memcpy(data, &src[firstLength], length - firstLength);
+		__sync_synchronize();
+		header->head += length;
+	}
+
+	void copyOut(uint8_t *dest, const uint64_t &length)
+	{
+		const uint64_t offset = header->tail % size;
+		const uint64_t firstLength = min(length, size - offset);
+		memcpy(dest, &data[offset], firstLength);
+		memcpy(&dest[firstLength], data, length - firstLength);
+		__sync_synchronize();
+		header->tail += length;
+	}
+
+	void notify(void)
+	{
+		const char c = 0;
+		// EAGAIN means that the FIFO already has unread notifications.
+		// It's enough to wake up the reader.
+		if (write(notifyFd, &c, 1) == -1 && errno != EAGAIN)
+			MLPL_ERR("Failed to notify: %s\n", strerror(errno));
+	}
+
+	void drainNotification(void)
+	{
+		char buf[64];
+		while (read(notifyFd, buf, sizeof(buf)) > 0)
+			;
+	}
+};
+
+static size_t getMapSize(const size_t &ringSize)
+{
+	return sizeof(ChannelHeader) +
+	       NUM_RINGS * (sizeof(RingHeader) + ringSize);
+}
+
+static int64_t getMonotonicTimeMSec(void)
+{
+	struct timespec ts;
+	HATOHOL_ASSERT(clock_gettime(CLOCK_MONOTONIC, &ts) == 0,
+	               "Failed to get the time: %s\n", strerror(errno));
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+struct HapiLocalChannel::Impl {
+	const string path;
+	const Side   side;
+	const size_t ringSize;
+	bool         created;
+	bool         opened;
+	void        *mapAddr;
+	size_t       mapSize;
+	Ring         rings[NUM_RINGS];
+	Ring        *sendRing;
+	Ring        *recvRing;
+	Mutex        sendLock;
+	AtomicValue<int> interrupted;
+	ChannelHeader *channelHeader;
+	// The generation and the attach count when this object opened it
+	uint64_t     generation;
+	uint64_t     attachCount;
+	// Set on the server when a plugin attaches while a message is read
+	bool         peerRestarted;
+
+	Impl(const string &_path, const Side &_side, const size_t &_ringSize)
+	: path(_path),
+	  side(_side),
+	  ringSize(_ringSize),
+	  created(false),
+	  opened(false),
+	  mapAddr(MAP_FAILED),
+	  mapSize(0),
+	  sendRing(NULL),
+	  recvRing(NULL),
+	  interrupted(0),
+	  channelHeader(NULL),
+	  generation(0),
+	  attachCount(0),
+	  peerRestarted(false)
+	{
+		if (side == SIDE_SERVER) {
+			sendRing = &rings[RING_TO_PLUGIN];
+			recvRing = &rings[RING_TO_SERVER];
+		} else {
+			sendRing = &rings[RING_TO_SERVER];
+			recvRing = &rings[RING_TO_PLUGIN];
+		}
+	}
+
+	virtual ~Impl()
+	{
+		close();
+		if (created) {
+			unlink(path.c_str());
+			for (int i = 0; i < NUM_RINGS; i++)
+				unlink(getFifoPath(i).c_str());
+		}
+	}
+
+	string getFifoPath(const int &ringIndex) const
+	{
+		// The same suffixes as the AMQP queues.
+		return path + ((ringIndex == RING_TO_PLUGIN) ? "-T" : "-S");
+	}
+
+	void create(void) throw(HatoholException)
+	{
+		const size_t pos = path.rfind('/');
+		if (pos != string::npos && pos > 0) {
+			// The same mode as NamedPipe::BASE_DIR so that the
+			// directory can be shared with the pipes.
+			const string dir = path.substr(0, pos);
+			mode_t prevMask = umask(0002);
+			int result = mkdir(dir.c_str(), CHANNEL_DIR_MODE);
+			umask(prevMask);
+			if (result == -1 && errno != EEXIST) {
+				THROW_HATOHOL_EXCEPTION(
+				  "Failed to make dir: %s: %s\n",
+				  dir.c_str(), strerror(errno));
+			}
+		}
+
+		unlink(path.c_str());
+		int fd = ::open(path.c_str(), O_RDWR|O_CREAT|O_EXCL,
+		                CHANNEL_MODE);
+		if (fd == -1) {
+			THROW_HATOHOL_EXCEPTION("Failed to create: %s: %s\n",
+			                        path.c_str(), strerror(errno));
+		}
+		const size_t size = getMapSize(ringSize);
+		const int ret = ftruncate(fd, size);
+		const int truncErrno = errno;
+		::close(fd);
+		if (ret == -1) {
+			THROW_HATOHOL_EXCEPTION("Failed to truncate: %s: %s\n",
+			  path.c_str(), strerror(truncErrno));
+		}
+
+		for (int i = 0; i < NUM_RINGS; i++) {
+			const string fifoPath = getFifoPath(i);
+			unlink(fifoPath.c_str());
+			if (mkfifo(fifoPath.c_str(), CHANNEL_MODE) == -1) {
+				THROW_HATOHOL_EXCEPTION(
+				  "Failed to make FIFO: %s: %s\n",
+				  fifoPath.c_str(), strerror(errno));
+			}
+		}
+		created = true;
+	}
+
+	void map(void) throw(HatoholException)
+	{
+		int fd = ::open(path.c_str(), O_RDWR);
+		if (fd == -1) {
+			THROW_HATOHOL_EXCEPTION("Failed to open: %s: %s\n",
+			                        path.c_str(), strerror(errno));
+		}
+		struct stat st;
+		if (fstat(fd, &st) == -1) {
+			const int err = errno;
+			::close(fd);
+			THROW_HATOHOL_EXCEPTION("Failed to stat: %s: %s\n",
+			                        path.c_str(), strerror(err));
+		}
+		mapSize = st.st_size;
+		mapAddr = mmap(NULL, mapSize, PROT_READ|PROT_WRITE,
+		               MAP_SHARED, fd, 0);
+		const int mapErrno = errno;
+		::close(fd);
+		if (mapAddr == MAP_FAILED) {
+			THROW_HATOHOL_EXCEPTION("Failed to mmap: %s: %s\n",
+			                        path.c_str(), strerror(mapErrno));
+		}
+	}
+
+	void initHeaders(const uint64_t &newGeneration)
+	{
+		memset(mapAddr, 0, mapSize);
+		ChannelHeader *header = static_cast<ChannelHeader *>(mapAddr);
+		header->magic      = CHANNEL_MAGIC;
+		header->version    = CHANNEL_VERSION;
+		header->ringSize   = ringSize;
+		header->generation = newGeneration;
+		__sync_synchronize();
+	}
+
+	uint64_t getCurrentGeneration(void) const
+	{
+		const ChannelHeader *header =
+		  static_cast<ChannelHeader *>(mapAddr);
+		if (mapSize < sizeof(ChannelHeader) ||
+		    header->magic != CHANNEL_MAGIC)
+			return 0;
+		return header->generation;
+	}
+
+	void setupRings(void) throw(HatoholException)
+	{
+		const ChannelHeader *header =
+		  static_cast<ChannelHeader *>(mapAddr);
+		if (mapSize < sizeof(ChannelHeader) ||
+		    header->magic != CHANNEL_MAGIC ||
+		    header->version != CHANNEL_VERSION ||
+		    getMapSize(header->ringSize) != mapSize) {
+			THROW_HATOHOL_EXCEPTION(
+			  "Invalid channel: %s (size: %zd)\n",
+			  path.c_str(), mapSize);
+		}
+
+		channelHeader = static_cast<ChannelHeader *>(mapAddr);
+		uint8_t *addr = static_cast<uint8_t *>(mapAddr);
+		addr += sizeof(ChannelHeader);
+		for (int i = 0; i < NUM_RINGS; i++) {
+			Ring &ring = rings[i];
+			ring.header = reinterpret_cast<RingHeader *>(addr);
+			addr += sizeof(RingHeader);
+			ring.data = addr;
+			addr += header->ringSize;
+			ring.size = header->ringSize;
+
+			// O_RDWR doesn't block until the peer opens the FIFO.
+			const string fifoPath = getFifoPath(i);
+			ring.notifyFd = ::open(fifoPath.c_str(),
+			                       O_RDWR|O_NONBLOCK);
+			if (ring.notifyFd == -1) {
+				THROW_HATOHOL_EXCEPTION(
+				  "Failed to open FIFO: %s: %s\n",
+				  fifoPath.c_str(), strerror(errno));
+			}
+		}
+	}
+
+	void open(void) throw(HatoholException)
+	{
+		AutoMutex autoMutex(&sendLock);
+		// Opening again starts a new session.
+		if (opened)
+			closeWithoutLock();
+		try {
+			const bool needCreate = (side == SIDE_SERVER && !created);
+			if (needCreate)
+				create();
+			map();
+			if (side == SIDE_SERVER) {
+				// The data left in the rings are dropped.
+				initHeaders(getCurrentGeneration() + 1);
+			}
+			setupRings();
+		} catch (...) {
+			unmap();
+			throw;
+		}
+		generation = channelHeader->generation;
+		if (side == SIDE_SERVER) {
+			attachCount = 0;
+			// Wake up the plugin to notice the new generation.
+			sendRing->notify();
+		} else {
+			channelHeader->attachHead = sendRing->header->head;
+			__sync_synchronize();
+			attachCount =
+			  __sync_add_and_fetch(&channelHeader->attachCount, 1);
+			sendRing->notify();
+		}
+		interrupted.set(0);
+		opened = true;
+	}
+
+	void checkGeneration(void) throw(HatoholException)
+	{
+		__sync_synchronize();
+		if (channelHeader->generation != generation) {
+			THROW_HATOHOL_EXCEPTION(
+			  "The channel has been reset by the server: %s\n",
+			  path.c_str());
+		}
+	}
+
+	// Called on the server with sendLock held, so that ackHead is at
+	// a message boundary.
+	void acknowledgeAttachWithoutLock(void)
+	{
+		__sync_synchronize();
+		const uint64_t count = channelHeader->attachCount;
+		if (channelHeader->ackedAttach == count)
+			return;
+		channelHeader->ackHead = sendRing->header->head;
+		__sync_synchronize();
+		channelHeader->ackedAttach = count;
+		sendRing->notify();
+	}
+
+	/**
+	 * Handle the attach of a new plugin on the server.
+	 *
+	 * @return true if a plugin has newly attached.
+	 */
+	bool handleAttach(void)
+	{
+		__sync_synchronize();
+		const uint64_t count = channelHeader->attachCount;
+		if (count == attachCount)
+			return false;
+		attachCount = count;
+		peerRestarted = true;
+		__sync_synchronize();
+		recvRing->header->tail = channelHeader->attachHead;
+		AutoMutex autoMutex(&sendLock);
+		acknowledgeAttachWithoutLock();
+		return true;
+	}
+
+	/**
+	 * Check if the server has acknowledged the attach of this plugin.
+	 * Until then, the data in the ring are of the previous plugin.
+	 * They are dropped so that the server isn't blocked by the full ring.
+	 */
+	bool isAttachAcknowledged(void)
+	{
+		__sync_synchronize();
+		if (channelHeader->ackedAttach == attachCount) {
+			if (recvRing->header->tail < channelHeader->ackHead)
+				recvRing->header->tail = channelHeader->ackHead;
+			return true;
+		}
+		// The head doesn't move between ackHead is set and
+		// ackedAttach is. So this never drops the data after ackHead.
+		const uint64_t head = recvRing->header->head;
+		__sync_synchronize();
+		if (channelHeader->ackedAttach == attachCount)
+			return isAttachAcknowledged();
+		recvRing->header->tail = head;
+		return false;
+	}
+
+	/**
+	 * Check the state of the peer before the data are read.
+	 *
+	 * @return true if the data in the ring can be read.
+	 */
+	bool checkPeer(void) throw(HatoholException)
+	{
+		if (side == SIDE_PLUGIN) {
+			checkGeneration();
+			return isAttachAcknowledged();
+		}
+		handleAttach();
+		return true;
+	}
+
+	void unmap(void)
+	{
+		for (int i = 0; i < NUM_RINGS; i++) {
+			Ring &ring = rings[i];
+			if (ring.notifyFd != -1)
+				::close(ring.notifyFd);
+			ring = Ring();
+		}
+		if (mapAddr != MAP_FAILED)
+			munmap(mapAddr, mapSize);
+		mapAddr = MAP_FAILED;
+		mapSize = 0;
+	}
+
+	void closeWithoutLock(void)
+	{
+		if (!opened)
+			return;
+		unmap();
+		channelHeader = NULL;
+		interrupted.set(0);
+		opened = false;
+	}
+
+	void close(void)
+	{
+		AutoMutex autoMutex(&sendLock);
+		closeWithoutLock();
+	}
+
+	void write(const uint8_t *src, const uint64_t &length)
+	  throw(HatoholException)
+	{
+		uint64_t written = 0;
+		int64_t stallStartTime = 0;
+		while (written < length) {
+			if (side == SIDE_PLUGIN)
+				checkGeneration();
+			const uint64_t space =
+			  sendRing->size - sendRing->getUsedSize();
+			if (space == 0) {
+				const int64_t now = getMonotonicTimeMSec();
+				if (!stallStartTime)
+					stallStartTime = now;
+				else if (now - stallStartTime > STALL_TIMEOUT_MSEC)
+					THROW_HATOHOL_EXCEPTION(
+					  "The peer doesn't read: %s\n",
+					  path.c_str());
+				sendRing->notify();
+				usleep(WAIT_SPACE_INTERVAL_USEC);
+				continue;
+			}
+			stallStartTime = 0;
+			const uint64_t chunkLength = min(space, length - written);
+			sendRing->copyIn(&src[written], chunkLength);
+			written += chunkLength;
+		}
+	}
+
+	bool waitForData(const uint64_t &requiredSize, const int &timeoutMSec)
+	  throw(HatoholException)
+	{
+		const int64_t startTime = getMonotonicTimeMSec();
+		while (true) {
+			if (checkPeer() &&
+			    recvRing->getUsedSize() >= requiredSize)
+				return true;
+			if (interrupted.get()) {
+				interrupted.set(0);
+				return false;
+			}
+			int pollTimeout = -1;
+			if (timeoutMSec >= 0) {
+				const int64_t elapsed =
+				  getMonotonicTimeMSec() - startTime;
+				if (elapsed >= timeoutMSec)
+					return false;
+				pollTimeout = timeoutMSec - elapsed;
+			}
+			struct pollfd pfd;
+			pfd.fd = recvRing->notifyFd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			if (poll(&pfd, 1, pollTimeout) == -1 && errno != EINTR) {
+				THROW_HATOHOL_EXCEPTION("Failed to poll: %s\n",
+				                        strerror(errno));
+			}
+			recvRing->drainNotification();
+		}
+	}
+};
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+HapiLocalChannel::HapiLocalChannel(
+  const string &path, const Side &side, const size_t &ringSize)
+: m_impl(new Impl(path, side, ringSize))
+{
+}
+
+HapiLocalChannel::~HapiLocalChannel()
+{
+}
+
+void HapiLocalChannel::open(void) throw(HatoholException)
+{
+	m_impl->open();
+}
+
+void HapiLocalChannel::close(void)
+{
+	m_impl->close();
+}
+
+bool HapiLocalChannel::isOpened(void) const
+{
+	return m_impl->opened;
+}
+
+const string &HapiLocalChannel::getPath(void) const
+{
+	return m_impl->path;
+}
+
+void HapiLocalChannel::send(const SmartBuffer &sbuf) throw(HatoholException)
+{
+	AutoMutex autoMutex(&m_impl->sendLock);
+	if (!m_impl->opened) {
+		THROW_HATOHOL_EXCEPTION("Not opened: %s\n",
+		                        m_impl->path.c_str());
+	}
+	if (m_impl->side == SIDE_SERVER)
+		m_impl->acknowledgeAttachWithoutLock();
+	if (sbuf.size() > MAX_MESSAGE_SIZE) {
+		THROW_HATOHOL_EXCEPTION("Too large message: %s: %zd\n",
+		                        m_impl->path.c_str(), sbuf.size());
+	}
+	const uint32_t length = sbuf.size();
+	m_impl->write(reinterpret_cast<const uint8_t *>(&length),
+	              sizeof(length));
+	m_impl->write(sbuf.getPointer<uint8_t>(0), length);
+	m_impl->sendRing->notify();
+}
+
+bool HapiLocalChannel::receive(SmartBuffer &sbuf, const int &timeoutMSec)
+  throw(HatoholException)
+{
+	HATOHOL_ASSERT(m_impl->opened, "Not opened: %s\n",
+	               m_impl->path.c_str());
+	while (true) {
+		m_impl->peerRestarted = false;
+		if (!m_impl->waitForData(sizeof(uint32_t), timeoutMSec))
+			return false;
+		if (m_impl->peerRestarted)
+			continue;
+		if (receiveBody(sbuf))
+			return true;
+	}
+}
+
+void HapiLocalChannel::interrupt(void)
+{
+	AutoMutex autoMutex(&m_impl->sendLock);
+	if (!m_impl->opened)
+		return;
+	m_impl->interrupted.set(1);
+	m_impl->recvRing->notify();
+}
+
+// ---------------------------------------------------------------------------
+// Private methods
+// ---------------------------------------------------------------------------
+bool HapiLocalChannel::receiveBody(SmartBuffer &sbuf) throw(HatoholException)
+{
+	Ring *ring = m_impl->recvRing;
+	uint32_t length;
+	ring->copyOut(reinterpret_cast<uint8_t *>(&length), sizeof(length));
+	if (length > MAX_MESSAGE_SIZE) {
+		// The length is broken and the following data can't be
+		// framed any more. Opening again drops them. A plugin attaches
+		// again, and the server starts a new generation.
+		MLPL_ERR("Too large message: %s: %zd. Reset the channel.\n",
+		         m_impl->path.c_str(), (size_t)length);
+		const int interrupted = m_impl->interrupted.get();
+		m_impl->open();
+		m_impl->interrupted.set(interrupted);
+		return false;
+	}
+
+	sbuf.alloc(length);
+	uint8_t *dest = sbuf.getPointer<uint8_t>(0);
+	uint64_t received = 0;
+	while (received < length) {
+		if (!m_impl->checkPeer() || m_impl->peerRestarted) {
+			// The plugin that sent the head of the message has
+			// gone. The new one writes from the head of a message.
+			MLPL_WARN("Dropped a part of a message from the "
+			          "previous plugin: %s\n",
+			          m_impl->path.c_str());
+			return false;
+		}
+		const uint64_t usedSize = ring->getUsedSize();
+		if (usedSize == 0) {
+			// The rest of the message is being written.
+			if (!m_impl->waitForData(1, STALL_TIMEOUT_MSEC)) {
+				THROW_HATOHOL_EXCEPTION(
+				  "Failed to receive the rest: %s: %zd/%zd\n",
+				  m_impl->path.c_str(), (size_t)received,
+				  (size_t)length);
+			}
+			continue;
+		}
+		const uint64_t chunkLength = min(usedSize, length - received);
+		ring->copyOut(&dest[received], chunkLength);
+		received += chunkLength;
+	}
+	sbuf.resetIndex();
+	return true;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HapiLocalChannel_h
+#define HapiLocalChannel_h
+
+#include <string>
+#include <memory>
+#include <SmartBuffer.h>
+#include "Params.h"
+#include "HatoholException.h"
+
+/**
+ * A transport of HAPI messages between the Hatohol server and an arm
+ * plugin running on the same host.
+ *
+ * The server creates a file-backed shared memory region that has two
+ * ring buffers (server -> plugin and plugin -> server) and two FIFOs
+ * used to wake up the reader. The plugin maps the same file. Each message
+ * is framed as a 32bit length followed by the payload, so the existing
+ * HAPI wire format is carried without any change. A message larger than
+ * the ring is streamed in pieces as the reader consumes it. A message
+ * can't be larger than MAX_MESSAGE_SIZE. When the reader gets a larger
+ * length, it regards the framing as broken and opens the channel again.
+ *
+ * A plugin attaches to the channel when it opens it. The server drops
+ * the data written by the previous plugin, including a message that was
+ * cut in the middle, and the new plugin reads only the messages sent
+ * after the attach. So a relaunched plugin can use the same channel.
+ *
+ * Only one thread shall call receive(). send() is MT-safe.
+ */
+class HapiLocalChannel {
+public:
+	enum Side {
+		SIDE_SERVER,
+		SIDE_PLUGIN,
+	};
+
+	static const char *ENV_NAME;
+	static const size_t DEFAULT_RING_SIZE;
+	static const size_t MAX_MESSAGE_SIZE;
+
+	HapiLocalChannel(const std::string &path, const Side &side,
+	                 const size_t &ringSize = DEFAULT_RING_SIZE);
+	virtual ~HapiLocalChannel();
+
+	/**
+	 * Open the channel.
+	 *
+	 * On the server side, the shared memory file and the FIFOs are
+	 * created if they haven't been created by this object. The rings
+	 * are reset every time the server opens the channel, so messages
+	 * which have not been read are dropped. A plugin that opened the
+	 * channel before that gets a HatoholException from send() and
+	 * receive(), and has to open the channel again.
+	 * On the plugin side, they must have been created by the server.
+	 * Calling open() on an opened channel closes it first.
+	 *
+	 * A HatoholException is thrown on failure.
+	 */
+	void open(void) throw(HatoholException);
+	void close(void);
+	bool isOpened(void) const;
+	const std::string &getPath(void) const;
+
+	/**
+	 * Send a message.
+	 *
+	 * This method blocks while the ring is full. If the peer doesn't
+	 * read the message for a long time, or the message is larger than
+	 * MAX_MESSAGE_SIZE, a HatoholException is thrown.
+	 *
+	 * @param sbuf A message to be sent. The whole buffer is sent.
+	 */
+	void send(const mlpl::SmartBuffer &sbuf) throw(HatoholException);
+
+	/**
+	 * Receive a message.
+	 *
+	 * @param sbuf
+	 * A buffer to store the message. The previous content is dropped and
+	 * the index is reset to zero.
+	 *
+	 * @param timeoutMSec
+	 * A timeout in millisecond to wait for the head of a message.
+	 * A negative value means an infinite wait.
+	 *
+	 * @return
+	 * true if a message is received. false if no message arrives within
+	 * the timeout or interrupt() is called.
+	 */
+	bool receive(mlpl::SmartBuffer &sbuf, const int &timeoutMSec)
+	  throw(HatoholException);
+
+	/**
+	 * Make the thread blocked in receive() return immediately.
+	 * If no thread is in receive(), the next receive() that waits for
+	 * a message returns false. open() and close() clear the request.
+	 */
+	void interrupt(void);
+
+private:
+	bool receiveBody(mlpl::SmartBuffer &sbuf) throw(HatoholException);
+
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // HapiLocalChannel_h
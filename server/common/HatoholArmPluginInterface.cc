@@ -31,7 +31,9 @@
 #include <qpid/messaging/Session.h>
 #include "HatoholArmPluginInterface.h"
 #include "HatoholException.h"
+#include "HapiLocalChannel.h"
 #include "MonitoringServerInfo.h"
+#include "MetricsRegistry.h"
 
 using namespace std;
 using namespace mlpl;
@@ -85,6 +87,10 @@ struct HatoholArmPluginInterface::Impl {
 	uint32_t   sequenceIdOfCurrCmd;
 	SmartQueue<ReplyWaiter *> replyWaiterQueue;
 	GMainContext *glibMainContext;
+	MetricHistogram &sentMessageSize;
+	MetricHistogram &receivedMessageSize;
+	MetricHistogram &handlingDuration;
+	unique_ptr<HapiLocalChannel> localChannel;
 
 	Impl(HatoholArmPluginInterface *_hapi,
 	               const bool &_workInServer)
@@ -97,7 +103,18 @@ struct HatoholArmPluginInterface::Impl {
 	  sequenceId(0),
 	  sequenceIdOfCurrCmd(SEQ_ID_UNKNOWN),
 	  glibMainContext(NULL),
+	  sentMessageSize(MetricsRegistry::getInstance()->getHistogram(
+	    "hatohol_hapi_message_size_bytes", "Size of HAPI messages",
+	    1.0, "direction=\"sent\"")),
+	  receivedMessageSize(MetricsRegistry::getInstance()->getHistogram(
+	    "hatohol_hapi_message_size_bytes", "Size of HAPI messages",
+	    1.0, "direction=\"received\"")),
+	  handlingDuration(MetricsRegistry::getInstance()->getHistogram(
+	    "hatohol_hapi_message_handling_duration_seconds",
+	    "Time to handle a received HAPI message",
+	    MetricsRegistry::UNIT_MICRO_SEC)),
 	  connected(false),
+	  usingLocalChannel(false),
 	  brokerUrl(DEFAULT_BROKER_URL)
 	{
 	}
@@ -112,6 +129,12 @@ struct HatoholArmPluginInterface::Impl {
 
 	void connect(void)
 	{
+		const string localChannelPath = getLocalChannelPath();
+		if (!localChannelPath.empty()) {
+			connectLocalChannel(localChannelPath);
+			return;
+		}
+
 		const string connectionOptions;
 		const string url = getBrokerUrl();
 		const string queueAddr = getQueueAddress();
@@ -143,11 +166,42 @@ struct HatoholArmPluginInterface::Impl {
 		hapi->onSessionChanged(&session);
 	}
 
+	/**
+	 * Open the channel on the shared memory instead of connecting to
+	 * the broker. onConnected() is called with a connection that isn't
+	 * opened, because the subclasses use it only as a trigger.
+	 */
+	void connectLocalChannel(const string &path)
+	{
+		MLPL_INFO("Try to open a local channel (%s): %s\n",
+		          workInServer ? "server" : "client", path.c_str());
+
+		AutoMutex autoMutex(&connectionLock);
+		if (!localChannel.get() || localChannel->getPath() != path) {
+			const HapiLocalChannel::Side side = workInServer ?
+			  HapiLocalChannel::SIDE_SERVER :
+			  HapiLocalChannel::SIDE_PLUGIN;
+			localChannel =
+			  unique_ptr<HapiLocalChannel>(
+			    new HapiLocalChannel(path, side));
+		}
+		localChannel->open();
+		usingLocalChannel = true;
+		connected = true;
+		hapi->onConnected(connection);
+	}
+
 	void disconnect(void)
 	{
 		AutoMutex autoMutex(&connectionLock);
 		if (!connected)
 			return;
+		if (usingLocalChannel) {
+			localChannel->close();
+			usingLocalChannel = false;
+			connected = false;
+			return;
+		}
 		try {
 			session.sync();
 			session.close();
@@ -178,11 +232,40 @@ struct HatoholArmPluginInterface::Impl {
 	void acknowledge(void)
 	{
 		AutoMutex autoMutex(&connectionLock);
-		if (!connected)
+		if (!connected || usingLocalChannel)
 			return;
 		session.acknowledge();
 	}
 
+	bool isUsingLocalChannel(void)
+	{
+		AutoMutex autoMutex(&connectionLock);
+		return usingLocalChannel;
+	}
+
+	/**
+	 * Wake up the thread waiting for a message so that it can notice
+	 * the exit request. The channel is closed by the thread itself
+	 * because it may still be touching the shared memory.
+	 */
+	void interruptLocalChannel(void)
+	{
+		AutoMutex autoMutex(&connectionLock);
+		if (localChannel.get())
+			localChannel->interrupt();
+	}
+
+	void sendViaLocalChannel(const SmartBuffer &sbuf)
+	{
+		HapiLocalChannel *channel = NULL;
+		{
+			AutoMutex autoMutex(&connectionLock);
+			channel = localChannel.get();
+		}
+		HATOHOL_ASSERT(channel, "No local channel.\n");
+		channel->send(sbuf);
+	}
+
 	void resetInitiation(void)
 	{
 		initState = INIT_STAT_UNKNOWN;
@@ -227,12 +310,26 @@ struct HatoholArmPluginInterface::Impl {
 		generalLock.unlock();
 	}
 
+	string getLocalChannelPath(void) const
+	{
+		AutoMutex autoMutex(&generalLock);
+		return localChannelPath;
+	}
+
+	void setLocalChannelPath(const string &path)
+	{
+		AutoMutex autoMutex(&generalLock);
+		localChannelPath = path;
+	}
+
 private:
 	bool       connected;
+	bool       usingLocalChannel;
 	Mutex      connectionLock;
 	mutable Mutex generalLock;
 	string     brokerUrl;
 	string     queueAddress;
+	string     localChannelPath;
 };
 
 // ---------------------------------------------------------------------------
@@ -267,10 +364,20 @@ HatoholArmPluginInterface::~HatoholArmPluginInterface()
 
 void HatoholArmPluginInterface::send(const string &message)
 {
+	if (m_impl->isUsingLocalChannel()) {
+		SmartBuffer sbuf(message.size());
+		memcpy(sbuf.getPointer<char>(0), message.c_str(),
+		       message.size());
+		m_impl->sendViaLocalChannel(sbuf);
+		m_impl->sentMessageSize.observe(message.size());
+		return;
+	}
+
 	Message request;
 	request.setReplyTo(m_impl->receiverAddr);
 	request.setContent(message);
 	m_impl->sender.send(request);
+	m_impl->sentMessageSize.observe(message.size());
 }
 
 void HatoholArmPluginInterface::send(
@@ -286,14 +393,29 @@ void HatoholArmPluginInterface::send(
 		m_impl->replyWaiterQueue.push(replyWaiter);
 	}
 
+	if (m_impl->isUsingLocalChannel()) {
+		m_impl->sendViaLocalChannel(smbuf);
+		m_impl->sentMessageSize.observe(smbuf.size());
+		return;
+	}
+
 	Message request;
 	request.setReplyTo(m_impl->receiverAddr);
 	request.setContent(smbuf.getPointer<char>(0), smbuf.size());
 	m_impl->sender.send(request);
+	m_impl->sentMessageSize.observe(smbuf.size());
 }
 
 bool HatoholArmPluginInterface::getMessagingContext(MessagingContext &msgCtx)
 {
+	// The local channel has only one peer. No reply address is needed.
+	if (m_impl->isUsingLocalChannel()) {
+		HATOHOL_ASSERT(m_impl->currBuffer,
+		               "This object doesn't have a current message.\n");
+		msgCtx.sequenceId = getSequenceIdInProgress();
+		return true;
+	}
+
 	HATOHOL_ASSERT(m_impl->currMessage,
 	               "This object doesn't have a current message.\n");
 	msgCtx.replyAddress = m_impl->currMessage->getReplyTo();
@@ -316,10 +438,17 @@ void HatoholArmPluginInterface::reply(const mlpl::SmartBuffer &replyBuf)
 void HatoholArmPluginInterface::reply(const MessagingContext &msgCtx,
                                       const mlpl::SmartBuffer &replyBuf)
 {
+	if (m_impl->isUsingLocalChannel()) {
+		m_impl->sendViaLocalChannel(replyBuf);
+		m_impl->sentMessageSize.observe(replyBuf.size());
+		return;
+	}
+
 	Message reply;
 	reply.setContent(replyBuf.getPointer<char>(0), replyBuf.size());
 	Sender sender = m_impl->session.createSender(msgCtx.replyAddress);
 	sender.send(reply);
+	m_impl->sentMessageSize.observe(replyBuf.size());
 }
 
 void HatoholArmPluginInterface::replyError(const HapiResponseCode &code)
@@ -339,7 +468,10 @@ void HatoholArmPluginInterface::replyOk(void)
 void HatoholArmPluginInterface::exitSync(void)
 {
 	requestExit();
-	m_impl->disconnect();
+	if (m_impl->isUsingLocalChannel())
+		m_impl->interruptLocalChannel();
+	else
+		m_impl->disconnect();
 	HatoholThreadBase::exitSync();
 }
 
@@ -675,6 +807,16 @@ void HatoholArmPluginInterface::setQueueAddress(const string &queueAddr)
 	return m_impl->setQueueAddress(queueAddr);
 }
 
+string HatoholArmPluginInterface::getLocalChannelPath(void) const
+{
+	return m_impl->getLocalChannelPath();
+}
+
+void HatoholArmPluginInterface::setLocalChannelPath(const string &path)
+{
+	m_impl->setLocalChannelPath(path);
+}
+
 void HatoholArmPluginInterface::setGLibMainContext(GMainContext *context)
 {
 	if (m_impl->glibMainContext)
@@ -706,11 +848,16 @@ gpointer HatoholArmPluginInterface::mainThread(HatoholThreadArg *arg)
 		sendInitiationPacket();
 	else
 		sendInitiationRequest();
+	const bool usingLocalChannel = m_impl->isUsingLocalChannel();
 	while (!isExitRequested()) {
 		Message message;
+		SmartBuffer sbuf;
 		try {
 			hapi->onPriorToFetchMessage();
-			m_impl->receiver.fetch(message);
+			if (usingLocalChannel)
+				fetchFromLocalChannel(sbuf);
+			else
+				m_impl->receiver.fetch(message);
 			hapi->onSuccessFetchMessage();
 		} catch (const exception &e) {
 			hapi->onFailureFetchMessage();
@@ -720,13 +867,15 @@ gpointer HatoholArmPluginInterface::mainThread(HatoholThreadArg *arg)
 
 		if (isExitRequested())
 			break;
-		SmartBuffer sbuf;
-		load(sbuf, message);
+		if (!usingLocalChannel)
+			load(sbuf, message);
 		sbuf.resetIndex();
 		m_impl->currMessage = &message;
 		m_impl->currBuffer  = &sbuf;
+		m_impl->receivedMessageSize.observe(sbuf.size());
 
 		try {
+			MetricTimer timer(m_impl->handlingDuration);
 			onReceived(sbuf);
 		} catch (const exception &e) {
 			MLPL_ERR("Caught exception: %s\n", e.what());
@@ -743,6 +892,15 @@ gpointer HatoholArmPluginInterface::mainThread(HatoholThreadArg *arg)
 	return NULL;
 }
 
+void HatoholArmPluginInterface::fetchFromLocalChannel(SmartBuffer &sbuf)
+{
+	// receive() returns false only when interrupt() is called.
+	while (!m_impl->localChannel->receive(sbuf, -1)) {
+		if (isExitRequested())
+			return;
+	}
+}
+
 void HatoholArmPluginInterface::onConnected(Connection &conn)
 {
 }
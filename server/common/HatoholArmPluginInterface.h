@@ -90,6 +90,9 @@ enum HapiCommandCode {
 	// Since 14.12
 	// Sv -> Cl
 	HAPI_CMD_REQ_FETCH_HISTORY,
+	// Cl -> Sv
+	HAPI_CMD_GET_TIMES_OF_LAST_EVENTS,
+	HAPI_CMD_SEND_TABLE_DELTA,
 
 	NUM_HAPI_CMD
 };
@@ -108,6 +111,8 @@ enum HapiResponseCode {
 	// Since 14.12
 	// Cl -> Sv
 	HAPI_RES_HISTORY,
+	// Sv -> Cl
+	HAPI_RES_ERR_GENERATION_MISMATCH,
 
 	NUM_HAPI_CMD_RES
 };
@@ -199,6 +204,11 @@ struct HapiParamTimeOfLastEvent {
 	uint64_t triggerId;
 } __attribute__((__packed__));
 
+struct HapiParamTimesOfLastEvents {
+	uint32_t numTriggers;
+	// Traling data is an array of trigger IDs (uint64_t).
+} __attribute__((__packed__));
+
 struct HapiResponseHeader {
 	uint16_t type;
 	uint16_t code;
@@ -245,11 +255,40 @@ struct HapiResTimeOfLastEvent {
 	uint32_t nsec;
 } __attribute__((__packed__));
 
+struct HapiResTimesOfLastEvents {
+	// The same as HapiResLastEventId. It is returned together to save
+	// a round trip at the beginning of a polling cycle.
+	uint64_t lastEventId;
+	uint32_t numTriggers;
+	// Traling data is an array of HapiResTimeOfLastEvent in the same
+	// order as the trigger IDs in the command.
+} __attribute__((__packed__));
+
 struct HapiHapSelfTriggers {
 	uint64_t numTriggers;
 	// Traling data is an array of HatoholArmPluginWatchType.
 } __attribute__((__packed__));
 
+/**
+ * Rows changed since the table of baseGeneration was sent.
+ *
+ * tableCode is one of HAPI_CMD_SEND_HOSTS, HAPI_CMD_SEND_HOST_GROUPS and
+ * HAPI_CMD_SEND_HOST_GROUP_ELEMENTS. It means that the rows have the same
+ * columns as the table sent by the command.
+ * If baseGeneration is zero, the added rows are the whole table. Otherwise,
+ * the server replies HAPI_RES_ERR_GENERATION_MISMATCH when its generation
+ * of the table isn't baseGeneration. The plugin should resend the whole
+ * table in that case.
+ */
+struct HapiParamTableDelta {
+	uint16_t tableCode;
+	uint64_t baseGeneration;
+	uint64_t generation;
+	// Trailing data are two item tables:
+	// [1] Added or changed rows.
+	// [2] Removed rows. They are the rows sent before.
+} __attribute__((__packed__));
+
 struct HapiParamReqFetchHistory {
 	uint64_t hostId;
 	uint64_t itemId;
@@ -517,6 +556,25 @@ public:
 	std::string getQueueAddress(void) const;
 	void setQueueAddress(const std::string &queueAddr);
 
+	/**
+	 * Get the path of the local channel.
+	 *
+	 * @return
+	 * The path, or an empty string when the messages are carried by
+	 * the AMQP broker.
+	 */
+	std::string getLocalChannelPath(void) const;
+
+	/**
+	 * Carry the messages on a HapiLocalChannel instead of the AMQP
+	 * broker. This must be called before start().
+	 *
+	 * @param path
+	 * The path of the channel. The server side creates it and the plugin
+	 * side opens it. An empty string selects the AMQP broker.
+	 */
+	void setLocalChannelPath(const std::string &path);
+
 	/**
 	 * Set the GLibMainContext.
 	 *
@@ -631,6 +689,15 @@ protected:
 	void load(mlpl::SmartBuffer &sbuf,
 	          const qpid::messaging::Message &message);
 
+	/**
+	 * Wait for a message from the local channel.
+	 *
+	 * @param sbuf
+	 * A buffer to store the message. It is left empty when the exit is
+	 * requested during the wait.
+	 */
+	void fetchFromLocalChannel(mlpl::SmartBuffer &sbuf);
+
 	void parseCommand(const HapiCommandHeader *header,
 	                  mlpl::SmartBuffer &cmdBuf);
 	void parseResponse(const HapiResponseHeader *header,
@@ -841,5 +908,6 @@ inline size_t HatoholArmPluginInterface::getBodySize<void>(void)
 
 #define HAP_PIPE_NAME_FMT "hap-pipe-%" FMT_SERVER_ID
 #define HAP_PIPE_OPT      "hap-pipe"
+#define HAP_LOCAL_CHANNEL_NAME_FMT "hap-local-%" FMT_SERVER_ID
 
 #endif // HatoholArmPluginInterface_h
@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <inttypes.h>
+#include <map>
+#include <Mutex.h>
+#include <StringUtils.h>
+#include <AtomicValue.h>
+#include "MetricsRegistry.h"
+#include "HatoholException.h"
+
+using namespace std;
+using namespace mlpl;
+
+const char *MetricsRegistry::PROMETHEUS_TEXT_MIME_TYPE =
+  "text/plain; version=0.0.4";
+const double MetricsRegistry::UNIT_MICRO_SEC = 1e-6;
+
+static string makeSeriesName(const string &name, const string &labels,
+                             const string &extraLabel = "")
+{
+	string seriesName = name;
+	if (labels.empty() && extraLabel.empty())
+		return seriesName;
+	seriesName += "{";
+	seriesName += labels;
+	if (!labels.empty() && !extraLabel.empty())
+		seriesName += ",";
+	seriesName += extraLabel;
+	seriesName += "}";
+	return seriesName;
+}
+
+// ---------------------------------------------------------------------------
+// Metric
+// ---------------------------------------------------------------------------
+Metric::~Metric()
+{
+}
+
+size_t Metric::getShardIndex(void)
+{
+	static AtomicValue<size_t> numThreads(0);
+	static __thread size_t shardIndex = SIZE_MAX;
+	if (shardIndex == SIZE_MAX)
+		shardIndex = numThreads.add(1);
+	return shardIndex;
+}
+
+// ---------------------------------------------------------------------------
+// MetricCounter
+// ---------------------------------------------------------------------------
+MetricCounter::MetricCounter(void)
+{
+	for (size_t i = 0; i < NUM_SHARDS; i++)
+		m_shards[i].value = 0;
+}
+
+void MetricCounter::add(const uint64_t &value)
+{
+	Shard &shard = m_shards[getShardIndex() % NUM_SHARDS];
+	__sync_add_and_fetch(&shard.value, value);
+}
+
+uint64_t MetricCounter::get(void) const
+{
+	uint64_t value = 0;
+	for (size_t i = 0; i < NUM_SHARDS; i++)
+		value += __sync_fetch_and_add(
+		  const_cast<uint64_t *>(&m_shards[i].value), 0);
+	return value;
+}
+
+const char *MetricCounter::getTypeName(void) const
+{
+	return "counter";
+}
+
+void MetricCounter::writePrometheusText(string &out, const string &name,
+                                        const string &labels) const
+{
+	out += StringUtils::sprintf("%s %" PRIu64 "\n",
+	                            makeSeriesName(name, labels).c_str(),
+	                            get());
+}
+
+// ---------------------------------------------------------------------------
+// MetricGauge
+// ---------------------------------------------------------------------------
+MetricGauge::MetricGauge(void)
+: m_value(0)
+{
+}
+
+void MetricGauge::set(const int64_t &value)
+{
+	int64_t oldValue;
+	do {
+		oldValue = m_value;
+	} while (!__sync_bool_compare_and_swap(&m_value, oldValue, value));
+}
+
+void MetricGauge::add(const int64_t &value)
+{
+	__sync_add_and_fetch(&m_value, value);
+}
+
+void MetricGauge::sub(const int64_t &value)
+{
+	__sync_sub_and_fetch(&m_value, value);
+}
+
+int64_t MetricGauge::get(void) const
+{
+	return __sync_fetch_and_add(const_cast<int64_t *>(&m_value), 0);
+}
+
+const char *MetricGauge::getTypeName(void) const
+{
+	return "gauge";
+}
+
+void MetricGauge::writePrometheusText(string &out, const string &name,
+                                      const string &labels) const
+{
+	out += StringUtils::sprintf("%s %" PRId64 "\n",
+	                            makeSeriesName(name, labels).c_str(),
+	                            get());
+}
+
+// ---------------------------------------------------------------------------
+// MetricHistogram
+// ---------------------------------------------------------------------------
+MetricHistogram::MetricHistogram(const double &unit)
+: m_unit(unit)
+{
+	for (size_t i = 0; i < NUM_SHARDS; i++) {
+		Shard &shard = m_shards[i];
+		for (size_t j = 0; j <= NUM_BUCKETS; j++)
+			shard.buckets[j] = 0;
+		shard.sum = 0;
+		shard.count = 0;
+	}
+}
+
+size_t MetricHistogram::getBucketIndex(const uint64_t &value)
+{
+	if (value <= 1)
+		return 0;
+	// The smallest i that satisfies value <= 2^i
+	const size_t index = 64 - __builtin_clzll(value - 1);
+	return index < NUM_BUCKETS ? index : NUM_BUCKETS;
+}
+
+void MetricHistogram::observe(const uint64_t &value)
+{
+	Shard &shard = m_shards[getShardIndex() % NUM_SHARDS];
+	__sync_add_and_fetch(&shard.buckets[getBucketIndex(value)], 1);
+	__sync_add_and_fetch(&shard.sum, value);
+	__sync_add_and_fetch(&shard.count, 1);
+}
+
+uint64_t MetricHistogram::getCount(void) const
+{
+	uint64_t count = 0;
+	for (size_t i = 0; i < NUM_SHARDS; i++)
+		count += __sync_fetch_and_add(
+		  const_cast<uint64_t *>(&m_shards[i].count), 0);
+	return count;
+}
+
+uint64_t MetricHistogram::getSum(void) const
+{
+	uint64_t sum = 0;
+	for (size_t i = 0; i < NUM_SHARDS; i++)
+		sum += __sync_fetch_and_add(
+		  const_cast<uint64_t *>(&m_shards[i].sum), 0);
+	return sum;
+}
+
+uint64_t MetricHistogram::getBucketCount(const size_t &index) const
+{
+	uint64_t count = 0;
+	for (size_t i = 0; i < NUM_SHARDS; i++)
+		count += __sync_fetch_and_add(
+		  const_cast<uint64_t *>(&m_shards[i].buckets[index]), 0);
+	return count;
+}
+
+const char *MetricHistogram::getTypeName(void) const
+{
+	return "histogram";
+}
+
+void MetricHistogram::writePrometheusText(string &out, const string &name,
+                                          const string &labels) const
+{
+	const string bucketName = name + "_bucket";
+	uint64_t cumulativeCount = 0;
+	for (size_t i = 0; i <= NUM_BUCKETS; i++) {
+		cumulativeCount += getBucketCount(i);
+		string le;
+		if (i < NUM_BUCKETS) {
+			le = StringUtils::sprintf("le=\"%g\"",
+			                          (double)(1ULL << i) * m_unit);
+		} else {
+			le = "le=\"+Inf\"";
+		}
+		out += StringUtils::sprintf(
+		  "%s %" PRIu64 "\n",
+		  makeSeriesName(bucketName, labels, le).c_str(),
+		  cumulativeCount);
+	}
+	out += StringUtils::sprintf(
+	  "%s %g\n", makeSeriesName(name + "_sum", labels).c_str(),
+	  (double)getSum() * m_unit);
+	out += StringUtils::sprintf(
+	  "%s %" PRIu64 "\n",
+	  makeSeriesName(name + "_count", labels).c_str(), cumulativeCount);
+}
+
+// ---------------------------------------------------------------------------
+// MetricTimer
+// ---------------------------------------------------------------------------
+MetricTimer::MetricTimer(MetricHistogram &histogram)
+: m_histogram(histogram),
+  m_stopped(false)
+{
+	clock_gettime(CLOCK_MONOTONIC, &m_startTime);
+}
+
+MetricTimer::~MetricTimer()
+{
+	stop();
+}
+
+void MetricTimer::stop(void)
+{
+	if (m_stopped)
+		return;
+	m_stopped = true;
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int64_t elapsed = (now.tv_sec - m_startTime.tv_sec) * 1000000LL;
+	elapsed += (now.tv_nsec - m_startTime.tv_nsec) / 1000;
+	m_histogram.observe(elapsed > 0 ? elapsed : 0);
+}
+
+// ---------------------------------------------------------------------------
+// MetricsRegistry
+// ---------------------------------------------------------------------------
+typedef map<string, Metric *>           LabelsMetricMap;
+typedef LabelsMetricMap::iterator       LabelsMetricMapIterator;
+typedef LabelsMetricMap::const_iterator LabelsMetricMapConstIterator;
+
+struct MetricFamily {
+	string          help;
+	LabelsMetricMap metrics;
+};
+
+typedef map<string, MetricFamily>        MetricFamilyMap;
+typedef MetricFamilyMap::iterator        MetricFamilyMapIterator;
+typedef MetricFamilyMap::const_iterator  MetricFamilyMapConstIterator;
+
+struct MetricsRegistry::Impl
+{
+	static Mutex            instanceLock;
+	static MetricsRegistry *instance;
+
+	Mutex           lock;
+	MetricFamilyMap families;
+
+	template<class MetricType>
+	MetricType &getMetric(const string &name, const string &help,
+	                      const string &labels, MetricType *newMetric)
+	{
+		lock.lock();
+		MetricFamily &family = families[name];
+		if (family.help.empty())
+			family.help = help;
+		LabelsMetricMapIterator it = family.metrics.find(labels);
+		if (it != family.metrics.end()) {
+			lock.unlock();
+			delete newMetric;
+			MetricType *metric = dynamic_cast<MetricType *>(it->second);
+			HATOHOL_ASSERT(metric, "Type mismatch: %s{%s}",
+			               name.c_str(), labels.c_str());
+			return *metric;
+		}
+		family.metrics[labels] = newMetric;
+		lock.unlock();
+		return *newMetric;
+	}
+};
+
+Mutex            MetricsRegistry::Impl::instanceLock;
+MetricsRegistry *MetricsRegistry::Impl::instance = NULL;
+
+MetricsRegistry *MetricsRegistry::getInstance(void)
+{
+	if (Impl::instance)
+		return Impl::instance;
+
+	Impl::instanceLock.lock();
+	if (!Impl::instance)
+		Impl::instance = new MetricsRegistry();
+	Impl::instanceLock.unlock();
+	return Impl::instance;
+}
+
+MetricCounter &MetricsRegistry::getCounter(const string &name,
+                                           const string &help,
+                                           const string &labels)
+{
+	return m_impl->getMetric(name, help, labels, new MetricCounter());
+}
+
+MetricGauge &MetricsRegistry::getGauge(const string &name,
+                                       const string &help,
+                                       const string &labels)
+{
+	return m_impl->getMetric(name, help, labels, new MetricGauge());
+}
+
+MetricHistogram &MetricsRegistry::getHistogram(const string &name,
+                                               const string &help,
+                                               const double &unit,
+                                               const string &labels)
+{
+	return m_impl->getMetric(name, help, labels,
+	                         new MetricHistogram(unit));
+}
+
+void MetricsRegistry::writePrometheusText(string &out)
+{
+	m_impl->lock.lock();
+	MetricFamilyMapConstIterator familyIt = m_impl->families.begin();
+	for (; familyIt != m_impl->families.end(); ++familyIt) {
+		const string &name = familyIt->first;
+		const MetricFamily &family = familyIt->second;
+		if (family.metrics.empty())
+			continue;
+		const Metric *first = family.metrics.begin()->second;
+		out += StringUtils::sprintf("# HELP %s %s\n",
+		                            name.c_str(), family.help.c_str());
+		out += StringUtils::sprintf("# TYPE %s %s\n",
+		                            name.c_str(), first->getTypeName());
+		LabelsMetricMapConstIterator it = family.metrics.begin();
+		for (; it != family.metrics.end(); ++it)
+			it->second->writePrometheusText(out, name, it->first);
+	}
+	m_impl->lock.unlock();
+}
+
+MetricsRegistry::MetricsRegistry(void)
+: m_impl(new Impl())
+{
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MetricsRegistry_h
+#define MetricsRegistry_h
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <memory>
+#include "Params.h"
+
+/**
+ * Metrics of the server itself. The update methods don't take any lock,
+ * so they can be called in hot paths. A metric is created on the first
+ * request for it and lives until the process exits. So the callers
+ * should keep the reference instead of looking it up every time.
+ */
+class Metric {
+public:
+	virtual ~Metric();
+	virtual const char *getTypeName(void) const = 0;
+	virtual void writePrometheusText(std::string &out,
+	                                 const std::string &name,
+	                                 const std::string &labels) const = 0;
+protected:
+	static size_t getShardIndex(void);
+};
+
+/**
+ * A monotonically increasing value. Each thread adds to one of the
+ * shards so that the threads don't contend for the same cache line.
+ */
+class MetricCounter : public Metric {
+public:
+	static const size_t NUM_SHARDS = 8;
+
+	MetricCounter(void);
+	void add(const uint64_t &value = 1);
+	uint64_t get(void) const;
+
+	virtual const char *getTypeName(void) const override;
+	virtual void writePrometheusText(std::string &out,
+	                                 const std::string &name,
+	                                 const std::string &labels
+	                                ) const override;
+private:
+	// Padded not to share a cache line with other shards
+	struct Shard {
+		uint64_t value;
+		char     padding[64 - sizeof(uint64_t)];
+	};
+	Shard m_shards[NUM_SHARDS];
+};
+
+/**
+ * A value that can go up and down such as a queue length.
+ */
+class MetricGauge : public Metric {
+public:
+	MetricGauge(void);
+	void set(const int64_t &value);
+	void add(const int64_t &value = 1);
+	void sub(const int64_t &value = 1);
+	int64_t get(void) const;
+
+	virtual const char *getTypeName(void) const override;
+	virtual void writePrometheusText(std::string &out,
+	                                 const std::string &name,
+	                                 const std::string &labels
+	                                ) const override;
+private:
+	int64_t m_value;
+};
+
+/**
+ * A distribution of integer values in buckets of powers of two.
+ * The upper bound of the bucket i is 2^i and the last one is +Inf.
+ * The values are exposed after they are multiplied by 'unit'.
+ * E.g. a duration is recorded in microseconds with unit 1e-6, so that
+ * it is exposed in seconds.
+ */
+class MetricHistogram : public Metric {
+public:
+	static const size_t NUM_SHARDS = 8;
+	static const size_t NUM_BUCKETS = 32;
+
+	MetricHistogram(const double &unit = 1.0);
+	void observe(const uint64_t &value);
+	uint64_t getCount(void) const;
+	uint64_t getSum(void) const;
+	uint64_t getBucketCount(const size_t &index) const;
+	static size_t getBucketIndex(const uint64_t &value);
+
+	virtual const char *getTypeName(void) const override;
+	virtual void writePrometheusText(std::string &out,
+	                                 const std::string &name,
+	                                 const std::string &labels
+	                                ) const override;
+private:
+	struct Shard {
+		uint64_t buckets[NUM_BUCKETS + 1];
+		uint64_t sum;
+		uint64_t count;
+		char     padding[64];
+	};
+	Shard  m_shards[NUM_SHARDS];
+	double m_unit;
+};
+
+/**
+ * Observe the elapsed time from the construction to stop() or
+ * the destruction in microseconds.
+ */
+class MetricTimer {
+public:
+	MetricTimer(MetricHistogram &histogram);
+	virtual ~MetricTimer();
+	void stop(void);
+private:
+	MetricHistogram &m_histogram;
+	timespec         m_startTime;
+	bool             m_stopped;
+};
+
+class MetricsRegistry {
+public:
+	static MetricsRegistry *getInstance(void);
+
+	/**
+	 * Get a metric. It's created if it doesn't exist.
+	 *
+	 * @param name A metric name such as 'hatohol_rest_requests_total'.
+	 * @param help A description used for '# HELP'.
+	 * @param labels Prometheus labels such as 'server_id="1"' or empty.
+	 * @return A reference of the metric.
+	 */
+	MetricCounter &getCounter(const std::string &name,
+	                          const std::string &help,
+	                          const std::string &labels = "");
+	MetricGauge &getGauge(const std::string &name,
+	                      const std::string &help,
+	                      const std::string &labels = "");
+	MetricHistogram &getHistogram(const std::string &name,
+	                              const std::string &help,
+	                              const double &unit = 1.0,
+	                              const std::string &labels = "");
+
+	/**
+	 * Write all metrics in the Prometheus text exposition format
+	 * (version 0.0.4).
+	 */
+	void writePrometheusText(std::string &out);
+
+	static const char *PROMETHEUS_TEXT_MIME_TYPE;
+	static const double UNIT_MICRO_SEC;
+
+protected:
+	MetricsRegistry(void);
+	virtual ~MetricsRegistry();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // MetricsRegistry_h
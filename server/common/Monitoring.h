@@ -104,6 +104,21 @@ enum EventType {
 	EVENT_TYPE_GOOD,
 	EVENT_TYPE_BAD,
 	EVENT_TYPE_UNKNOWN,
+
+	// A trigger started flapping. The following events of the trigger
+	// are dropped until it stops flapping.
+	EVENT_TYPE_FLAPPING,
+};
+
+enum EventCorrelationType {
+	EVENT_CORRELATION_NONE,
+
+	// A problem of a host on which other hosts depend.
+	EVENT_CORRELATION_ROOT_CAUSE,
+
+	// A problem caused by a problem of a host on which the host depends,
+	// or its recovery. It is not passed to the actions.
+	EVENT_CORRELATION_SYMPTOM,
 };
 
 struct EventInfo {
@@ -124,6 +139,7 @@ struct EventInfo {
 	HostIdType          hostId;
 	std::string         hostName;
 	std::string         brief;
+	EventCorrelationType correlation;
 };
 void initEventInfo(EventInfo &eventInfo);
 
@@ -192,6 +208,20 @@ typedef std::list<HostgroupElement> HostgroupElementList;
 typedef HostgroupElementList::iterator HostgroupElementListIterator;
 typedef HostgroupElementList::const_iterator HostgroupElementListConstIterator;
 
+// The hosts selected by hostId and groupId depend on parentHostId.
+// ALL_HOSTS and ALL_HOST_GROUPS select all of them.
+struct HostDependency {
+	int                 id;
+	ServerIdType        serverId;
+	HostIdType          hostId;
+	HostgroupIdType     groupId;
+	HostIdType          parentHostId;
+};
+
+typedef std::list<HostDependency> HostDependencyList;
+typedef HostDependencyList::iterator HostDependencyListIterator;
+typedef HostDependencyList::const_iterator HostDependencyListConstIterator;
+
 struct MonitoringServerStatus {
 	ServerIdType serverId;
 	double       nvps;
@@ -19,6 +19,7 @@
 
 #include <cstdio>
 #include <string>
+#include <set>
 #include <Reaper.h>
 #include "JSONParser.h"
 #include "ZabbixAPI.h"
@@ -34,6 +35,58 @@ static const guint DEFAULT_TIMEOUT = 60;
 static const size_t HISTORY_LIMIT_PER_ONCE = 1000;
 
 const uint64_t ZabbixAPI::EVENT_ID_NOT_FOUND = -1;
+const size_t   ZabbixAPI::DEFAULT_MAX_CONNECTIONS = 4;
+
+// The limit is for the whole samples of the items.
+static size_t getHistoryLimit(const size_t &numItems)
+{
+	return HISTORY_LIMIT_PER_ONCE * numItems;
+}
+
+// IDs of the requests in a batch request
+enum {
+	REQUEST_ID_HOST = 1,
+	REQUEST_ID_GROUP,
+};
+
+static string buildHostRequest(const string &authToken, const int &id = 1)
+{
+	JSONBuilder agent;
+	agent.startObject();
+	agent.add("jsonrpc", "2.0");
+	agent.add("method", "host.get");
+
+	agent.startObject("params");
+	agent.add("output", "extend");
+	agent.add("selectGroups", "refer");
+	agent.endObject(); // params
+
+	agent.add("auth", authToken);
+	agent.add("id", id);
+	agent.endObject();
+
+	return agent.generate();
+}
+
+static string buildGroupRequest(const string &authToken, const int &id = 1)
+{
+	JSONBuilder agent;
+	agent.startObject();
+	agent.add("jsonrpc", "2.0");
+	agent.add("method", "hostgroup.get");
+
+	agent.startObject("params");
+	agent.add("real_hosts", true);
+	agent.add("output", "extend");
+	agent.add("selectHosts", "refer");
+	agent.endObject(); //params
+
+	agent.add("auth", authToken);
+	agent.add("id", id);
+	agent.endObject();
+
+	return agent.generate();
+}
 
 struct ZabbixAPI::Impl {
 
@@ -45,10 +98,12 @@ struct ZabbixAPI::Impl {
 	int            apiVersionMinor;
 	int            apiVersionMicro;
 	SoupSession   *session;
+	size_t         maxConnections;
 	string         authToken;
 
 	bool                 gotTriggers;
 	VariableItemTablePtr functionsTablePtr;
+	bool                 batchRequestUnsupported;
 
 	// constructors and destructor
 	Impl(void)
@@ -56,7 +111,9 @@ struct ZabbixAPI::Impl {
 	  apiVersionMinor(0),
 	  apiVersionMicro(0),
 	  session(NULL),
-	  gotTriggers(false)
+	  maxConnections(DEFAULT_MAX_CONNECTIONS),
+	  gotTriggers(false),
+	  batchRequestUnsupported(false)
 	{
 	}
 
@@ -202,14 +259,32 @@ bool ZabbixAPI::openSession(SoupMessage **msgPtr)
 }
 
 
+void ZabbixAPI::setMaxConnections(const size_t &maxConnections)
+{
+	HATOHOL_ASSERT(maxConnections > 0, "No connection.\n");
+	m_impl->maxConnections = maxConnections;
+	if (m_impl->session) {
+		g_object_set(m_impl->session,
+		             SOUP_SESSION_MAX_CONNS,
+		             (guint)maxConnections,
+		             SOUP_SESSION_MAX_CONNS_PER_HOST,
+		             (guint)maxConnections,
+		             NULL);
+	}
+}
+
 SoupSession *ZabbixAPI::getSession(void)
 {
-	// NOTE: current implementaion is not MT-safe.
-	//       If we have to use this function from multiple threads,
-	//       it is only necessary to prepare sessions by thread.
+	// NOTE: The creation is not MT-safe. Call this method once before
+	//       the requests from multiple threads. SoupSessionSync itself
+	//       can send messages from multiple threads in parallel.
 	if (!m_impl->session)
 		m_impl->session = soup_session_sync_new_with_options(
 			SOUP_SESSION_TIMEOUT,      DEFAULT_TIMEOUT,
+			SOUP_SESSION_MAX_CONNS,
+			(guint)m_impl->maxConnections,
+			SOUP_SESSION_MAX_CONNS_PER_HOST,
+			(guint)m_impl->maxConnections,
 			//FIXME: Sometimes it causes crash (issue #98)
 			//SOUP_SESSION_IDLE_TIMEOUT, DEFAULT_IDLE_TIMEOUT,
 			NULL);
@@ -319,15 +394,103 @@ ItemTablePtr ZabbixAPI::getHistory(const ItemIdType &itemId,
 				   const ZabbixAPI::ValueType &valueType,
 				   const time_t &beginTime,
 				   const time_t &endTime)
+{
+	vector<ItemIdType> itemIds;
+	itemIds.push_back(itemId);
+	return getHistory(itemIds, valueType, beginTime, endTime);
+}
+
+ItemTablePtr ZabbixAPI::getHistory(const vector<ItemIdType> &itemIds,
+				   const ZabbixAPI::ValueType &valueType,
+				   const time_t &beginTime,
+				   const time_t &endTime)
+{
+	// history.get returns at most the limit of samples. The rest are
+	// got by the following requests from the time of the last sample.
+	// The samples of that time are returned again and skipped.
+	typedef pair<uint64_t, uint64_t> SampleKey; // item ID and ns
+	VariableItemTablePtr tablePtr;
+	const size_t limit = getHistoryLimit(itemIds.size());
+	time_t timeFrom = beginTime;
+	set<SampleKey> lastSampleKeys;
+	while (true) {
+		HatoholError queryRet;
+		SoupMessage *msg = queryHistory(queryRet, itemIds, valueType,
+		                                timeFrom, endTime);
+		if (!msg) {
+			if (queryRet == HTERR_INTERNAL_ERROR) {
+				THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
+				  HTERR_INTERNAL_ERROR,
+				  "Failed to query history.");
+			} else {
+				THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
+				  HTERR_FAILED_CONNECT_ZABBIX,
+				  "%s", queryRet.getMessage().c_str());
+			}
+		}
+		JSONParser parser(msg->response_body->data);
+		g_object_unref(msg);
+		if (parser.hasError()) {
+			THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
+			  HTERR_FAILED_TO_PARSE_JSON_DATA,
+			  "Failed to parser: %s", parser.getErrorMessage());
+		}
+
+		startObject(parser, "result");
+		const int numData = parser.countElements();
+		MLPL_DBG("The number of history: %d\n", numData);
+		time_t lastClock = timeFrom;
+		set<SampleKey> newSampleKeys(lastSampleKeys);
+		bool gotNewSample = false;
+		for (int i = 0; i < numData; i++) {
+			startElement(parser, i);
+			VariableItemGroupPtr grp;
+			const uint64_t itemId = pushUint64(
+			  parser, grp, "itemid", ITEM_ID_ZBX_HISTORY_ITEMID);
+			const time_t clock = pushUint64(
+			  parser, grp, "clock", ITEM_ID_ZBX_HISTORY_CLOCK);
+			const uint64_t ns = pushUint64(
+			  parser, grp, "ns", ITEM_ID_ZBX_HISTORY_NS);
+			pushString(parser, grp, "value",
+			           ITEM_ID_ZBX_HISTORY_VALUE);
+			parser.endElement();
+
+			const SampleKey key(itemId, ns);
+			if (clock == timeFrom && lastSampleKeys.count(key))
+				continue;
+			tablePtr->add(grp);
+			gotNewSample = true;
+			if (clock != lastClock) {
+				lastClock = clock;
+				newSampleKeys.clear();
+			}
+			newSampleKeys.insert(key);
+		}
+		if ((size_t)numData < limit)
+			break;
+		if (!gotNewSample) {
+			MLPL_WARN("Too many samples at %ld. "
+			          "The rest of them are not got.\n",
+			          (long)timeFrom);
+			break;
+		}
+		timeFrom = lastClock;
+		lastSampleKeys.swap(newSampleKeys);
+	}
+
+	return ItemTablePtr(tablePtr);
+}
+
+void ZabbixAPI::getHosts(
+  ItemTablePtr &hostsTablePtr, ItemTablePtr &hostsGroupsTablePtr)
 {
 	HatoholError queryRet;
-	SoupMessage *msg = queryHistory(queryRet, itemId, valueType,
-					beginTime, endTime);
+	SoupMessage *msg = queryHost(queryRet);
 	if (!msg) {
 		if (queryRet == HTERR_INTERNAL_ERROR) {
 			THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
 			  HTERR_INTERNAL_ERROR,
-			  "Failed to query history.");
+			  "Failed to query hosts.");
 		} else {
 			THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
 			  HTERR_FAILED_CONNECT_ZABBIX,
@@ -341,35 +504,19 @@ ItemTablePtr ZabbixAPI::getHistory(const ItemIdType &itemId,
 		  HTERR_FAILED_TO_PARSE_JSON_DATA,
 		  "Failed to parser: %s", parser.getErrorMessage());
 	}
-
 	startObject(parser, "result");
-	VariableItemTablePtr tablePtr;
-	int numData = parser.countElements();
-	MLPL_DBG("The number of history: %d\n", numData);
-	for (int i = 0; i < numData; i++) {
-		startElement(parser, i);
-		VariableItemGroupPtr grp;
-		pushUint64(parser, grp, "itemid", ITEM_ID_ZBX_HISTORY_ITEMID);
-		pushUint64(parser, grp, "clock",  ITEM_ID_ZBX_HISTORY_CLOCK);
-		pushUint64(parser, grp, "ns",     ITEM_ID_ZBX_HISTORY_NS);
-		pushString(parser, grp, "value",  ITEM_ID_ZBX_HISTORY_VALUE);
-		tablePtr->add(grp);
-		parser.endElement();
-	}
-
-	return ItemTablePtr(tablePtr);
+	parseHosts(parser, hostsTablePtr, hostsGroupsTablePtr);
 }
 
-void ZabbixAPI::getHosts(
-  ItemTablePtr &hostsTablePtr, ItemTablePtr &hostsGroupsTablePtr)
+void ZabbixAPI::getGroups(ItemTablePtr &groupsTablePtr)
 {
 	HatoholError queryRet;
-	SoupMessage *msg = queryHost(queryRet);
+	SoupMessage *msg = queryGroup(queryRet);
 	if (!msg) {
 		if (queryRet == HTERR_INTERNAL_ERROR) {
 			THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
 			  HTERR_INTERNAL_ERROR,
-			  "Failed to query hosts.");
+			  "Failed to query groups.");
 		} else {
 			THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
 			  HTERR_FAILED_CONNECT_ZABBIX,
@@ -384,54 +531,89 @@ void ZabbixAPI::getHosts(
 		  "Failed to parser: %s", parser.getErrorMessage());
 	}
 	startObject(parser, "result");
+	parseGroups(parser, groupsTablePtr);
+}
 
-	VariableItemTablePtr variableHostsTablePtr, variableHostsGroupsTablePtr;
-	int numData = parser.countElements();
-	MLPL_DBG("The number of hosts: %d\n", numData);
-	if (numData < 1)
+void ZabbixAPI::getHostsAndGroups(ItemTablePtr &hostsTablePtr,
+                                  ItemTablePtr &hostsGroupsTablePtr,
+                                  ItemTablePtr &groupsTablePtr)
+{
+	if (m_impl->batchRequestUnsupported) {
+		getHosts(hostsTablePtr, hostsGroupsTablePtr);
+		getGroups(groupsTablePtr);
 		return;
-
-	for (int i = 0; i < numData; i++) {
-		parseAndPushHostsData(parser, variableHostsTablePtr, i);
-		parseAndPushHostsGroupsData(parser,
-		                            variableHostsGroupsTablePtr, i);
 	}
-	hostsTablePtr = ItemTablePtr(variableHostsTablePtr);
-	hostsGroupsTablePtr = ItemTablePtr(variableHostsGroupsTablePtr);
-}
 
-void ZabbixAPI::getGroups(ItemTablePtr &groupsTablePtr)
-{
+	vector<string> requests;
+	requests.push_back(
+	  buildHostRequest(m_impl->authToken, REQUEST_ID_HOST));
+	requests.push_back(
+	  buildGroupRequest(m_impl->authToken, REQUEST_ID_GROUP));
+
 	HatoholError queryRet;
-	SoupMessage *msg = queryGroup(queryRet);
+	SoupMessage *msg = queryBatch(requests, queryRet);
 	if (!msg) {
 		if (queryRet == HTERR_INTERNAL_ERROR) {
 			THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
 			  HTERR_INTERNAL_ERROR,
-			  "Failed to query groups.");
+			  "Failed to query hosts and groups.");
 		} else {
 			THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
 			  HTERR_FAILED_CONNECT_ZABBIX,
 			  "%s", queryRet.getMessage().c_str());
 		}
 	}
-	JSONParser parser(msg->response_body->data);
+	// A server without the support of the batch request returns
+	// an error object. The requests are sent one by one after that.
+	const string response(msg->response_body->data,
+	                      msg->response_body->length);
 	g_object_unref(msg);
+	const size_t head = response.find_first_not_of(" \t\r\n");
+	if (head == string::npos || response[head] != '[') {
+		MLPL_INFO("Batch requests aren't supported. "
+		          "Get hosts and groups separately: %s\n",
+		          response.c_str());
+		m_impl->batchRequestUnsupported = true;
+		getHosts(hostsTablePtr, hostsGroupsTablePtr);
+		getGroups(groupsTablePtr);
+		return;
+	}
+	JSONParser parser(response);
 	if (parser.hasError()) {
 		THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
 		  HTERR_FAILED_TO_PARSE_JSON_DATA,
 		  "Failed to parser: %s", parser.getErrorMessage());
 	}
-	startObject(parser, "result");
 
-	VariableItemTablePtr variableGroupsTablePtr;
-	int numData = parser.countElements();
-	MLPL_DBG("The number of groups: %d\n", numData);
-
-	for (int i = 0; i < numData; i++)
-		parseAndPushGroupsData(parser, variableGroupsTablePtr, i);
-
-	groupsTablePtr = ItemTablePtr(variableGroupsTablePtr);
+	// The responses may be in any order.
+	bool gotHosts = false;
+	bool gotGroups = false;
+	const unsigned int numResponses = parser.countElements();
+	for (unsigned int i = 0; i < numResponses; i++) {
+		startElement(parser, i);
+		int64_t id;
+		if (!parser.read("id", id)) {
+			THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
+			  HTERR_FAILED_TO_PARSE_JSON_DATA,
+			  "Failed to read: id");
+		}
+		startObject(parser, "result");
+		if (id == REQUEST_ID_HOST) {
+			parseHosts(parser, hostsTablePtr, hostsGroupsTablePtr);
+			gotHosts = true;
+		} else if (id == REQUEST_ID_GROUP) {
+			parseGroups(parser, groupsTablePtr);
+			gotGroups = true;
+		}
+		parser.endObject(); // result
+		parser.endElement();
+	}
+	if (!gotHosts || !gotGroups) {
+		THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
+		  HTERR_FAILED_TO_PARSE_JSON_DATA,
+		  "Missing responses: hosts: %d, groups: %d",
+		  gotHosts, gotGroups);
+	}
 }
 
 ItemTablePtr ZabbixAPI::getApplications(const vector<uint64_t> &appIdVector)
@@ -657,7 +839,7 @@ SoupMessage *ZabbixAPI::queryItem(HatoholError &queryRet)
 }
 
 SoupMessage *ZabbixAPI::queryHistory(HatoholError &queryRet,
-				     const ItemIdType &itemId,
+				     const vector<ItemIdType> &itemIds,
 				     const ZabbixAPI::ValueType &valueType,
 				     const time_t &beginTime,
 				     const time_t &endTime)
@@ -670,12 +852,20 @@ SoupMessage *ZabbixAPI::queryHistory(HatoholError &queryRet,
 	agent.startObject("params");
 	agent.add("output", "extend");
 	agent.add("history", valueType);
-	agent.add("itemids", itemId);
+	if (itemIds.size() == 1) {
+		agent.add("itemids", itemIds[0]);
+	} else {
+		agent.startArray("itemids");
+		vector<ItemIdType>::const_iterator it = itemIds.begin();
+		for (; it != itemIds.end(); ++it)
+			agent.add(*it);
+		agent.endArray();
+	}
 	agent.add("time_from", beginTime);
 	agent.add("time_till", endTime);
 	agent.add("sortfield", "clock");
 	agent.add("sortorder", "ASC");
-	agent.add("limit", HISTORY_LIMIT_PER_ONCE);
+	agent.add("limit", getHistoryLimit(itemIds.size()));
 	agent.endObject(); // params
 
 	agent.add("auth", m_impl->authToken);
@@ -687,41 +877,12 @@ SoupMessage *ZabbixAPI::queryHistory(HatoholError &queryRet,
 
 SoupMessage *ZabbixAPI::queryHost(HatoholError &queryRet)
 {
-	JSONBuilder agent;
-	agent.startObject();
-	agent.add("jsonrpc", "2.0");
-	agent.add("method", "host.get");
-
-	agent.startObject("params");
-	agent.add("output", "extend");
-	agent.add("selectGroups", "refer");
-	agent.endObject(); // params
-
-	agent.add("auth", m_impl->authToken);
-	agent.add("id", 1);
-	agent.endObject();
-
-	return queryCommon(agent, queryRet);
+	return queryCommon(buildHostRequest(m_impl->authToken), queryRet);
 }
 
 SoupMessage *ZabbixAPI::queryGroup(HatoholError &queryRet)
 {
-	JSONBuilder agent;
-	agent.startObject();
-	agent.add("jsonrpc", "2.0");
-	agent.add("method", "hostgroup.get");
-
-	agent.startObject("params");
-	agent.add("real_hosts", true);
-	agent.add("output", "extend");
-	agent.add("selectHosts", "refer");
-	agent.endObject(); //params
-
-	agent.add("auth", m_impl->authToken);
-	agent.add("id", 1);
-	agent.endObject();
-
-	return queryCommon(agent, queryRet);
+	return queryCommon(buildGroupRequest(m_impl->authToken), queryRet);
 }
 
 SoupMessage *ZabbixAPI::queryApplication(const vector<uint64_t> &appIdVector,
@@ -764,7 +925,25 @@ ItemTablePtr ZabbixAPI::getFunctions(void)
 
 SoupMessage *ZabbixAPI::queryCommon(JSONBuilder &agent, HatoholError &queryRet)
 {
-	string request_body = agent.generate();
+	return queryCommon(agent.generate(), queryRet);
+}
+
+SoupMessage *ZabbixAPI::queryBatch(const vector<string> &requests,
+                                   HatoholError &queryRet)
+{
+	string requestBody = "[";
+	for (size_t i = 0; i < requests.size(); i++) {
+		if (i > 0)
+			requestBody += ",";
+		requestBody += requests[i];
+	}
+	requestBody += "]";
+	return queryCommon(requestBody, queryRet);
+}
+
+SoupMessage *ZabbixAPI::queryCommon(const string &request_body,
+                                    HatoholError &queryRet)
+{
 	SoupMessage *msg = soup_message_new(SOUP_METHOD_POST, m_impl->uri.c_str());
 	if (!msg) {
 		MLPL_ERR("Failed to call: soup_message_new: uri: %s\n",
@@ -1199,6 +1378,36 @@ void ZabbixAPI::parseAndPushEventsData(
 }
 
 
+void ZabbixAPI::parseHosts(JSONParser &parser, ItemTablePtr &hostsTablePtr,
+                           ItemTablePtr &hostsGroupsTablePtr)
+{
+	VariableItemTablePtr variableHostsTablePtr, variableHostsGroupsTablePtr;
+	int numData = parser.countElements();
+	MLPL_DBG("The number of hosts: %d\n", numData);
+	if (numData < 1)
+		return;
+
+	for (int i = 0; i < numData; i++) {
+		parseAndPushHostsData(parser, variableHostsTablePtr, i);
+		parseAndPushHostsGroupsData(parser,
+		                            variableHostsGroupsTablePtr, i);
+	}
+	hostsTablePtr = ItemTablePtr(variableHostsTablePtr);
+	hostsGroupsTablePtr = ItemTablePtr(variableHostsGroupsTablePtr);
+}
+
+void ZabbixAPI::parseGroups(JSONParser &parser, ItemTablePtr &groupsTablePtr)
+{
+	VariableItemTablePtr variableGroupsTablePtr;
+	int numData = parser.countElements();
+	MLPL_DBG("The number of groups: %d\n", numData);
+
+	for (int i = 0; i < numData; i++)
+		parseAndPushGroupsData(parser, variableGroupsTablePtr, i);
+
+	groupsTablePtr = ItemTablePtr(variableGroupsTablePtr);
+}
+
 void ZabbixAPI::pushTriggersHostid(JSONParser &parser,
                                    ItemGroup *itemGroup)
 {
@@ -46,6 +46,7 @@ public:
 	virtual ~ZabbixAPI();
 
 	static const uint64_t EVENT_ID_NOT_FOUND;
+	static const size_t   DEFAULT_MAX_CONNECTIONS;
 
 	static ItemInfoValueType toItemValueType(
 	  const ZabbixAPI::ValueType &valueType);
@@ -98,6 +99,19 @@ protected:
 	 */
 	bool openSession(SoupMessage **msgPtr = NULL);
 
+	/**
+	 * Set the maximum number of the persistent connections to the
+	 * Zabbix server. The connections are kept alive and reused by the
+	 * following requests.
+	 *
+	 * @param maxConnections The maximum number of the connections.
+	 */
+	void setMaxConnections(const size_t &maxConnections);
+
+	/**
+	 * Get the session. The session is MT-safe, but the first call of
+	 * this method that creates it isn't.
+	 */
 	SoupSession *getSession(void);
 	bool updateAuthTokenIfNeeded(void);
 	std::string getAuthToken(void);
@@ -131,6 +145,22 @@ protected:
 				const time_t &beginTime,
 				const time_t &endTime);
 
+	/**
+	 * Get the history of items with history.get calls for all items.
+	 * When the samples exceed the limit of a call, the rest are got
+	 * with the following calls.
+	 *
+	 * @param itemIds Items whose values are the same type.
+	 *
+	 * @return
+	 * The obtained history as an ItemTable format. The samples of
+	 * the items are mixed and sorted by the time.
+	 */
+	ItemTablePtr getHistory(const std::vector<ItemIdType> &itemIds,
+				const ZabbixAPI::ValueType &valueType,
+				const time_t &beginTime,
+				const time_t &endTime);
+
 	/**
 	 * Get the hosts and the host groups.
 	 *
@@ -151,6 +181,24 @@ protected:
 	 */
 	void getGroups(ItemTablePtr &groupsTablePtr);
 
+	/**
+	 * Get the hosts, the host groups, and the groups with one JSON-RPC
+	 * batch request. If the server doesn't support the batch request,
+	 * they are got with separate requests from then on.
+	 *
+	 * @param hostsTablePtr
+	 * A ItemTablePtr the obtained hosts are stored in.
+	 *
+	 * @param hostsGroupsTablePtr
+	 * A ItemTablePtr the obtained host groups are stored in.
+	 *
+	 * @param groupsTablePtr
+	 * A ItemTablePtr the obtained groups are stored in.
+	 */
+	void getHostsAndGroups(ItemTablePtr &hostsTablePtr,
+	                       ItemTablePtr &hostsGroupsTablePtr,
+	                       ItemTablePtr &groupsTablePtr);
+
 	/**
 	 * Get the applications
 	 *
@@ -212,7 +260,7 @@ protected:
 	 * A SoupMessage object with the raw Zabbix servers's response.
 	 */
 	SoupMessage *queryHistory(HatoholError &queryRet,
-				  const ItemIdType &itemId,
+				  const std::vector<ItemIdType> &itemIds,
 				  const ZabbixAPI::ValueType &valueType,
 				  const time_t &beginTime,
 				  const time_t &endTime);
@@ -274,6 +322,21 @@ protected:
 	ItemTablePtr getFunctions(void);
 
 	SoupMessage *queryCommon(JSONBuilder &agent, HatoholError &queryRet);
+	SoupMessage *queryCommon(const std::string &requestBody,
+	                         HatoholError &queryRet);
+
+	/**
+	 * Post requests as a JSON-RPC batch request.
+	 *
+	 * @param requests
+	 * The requests. Each of them must have a unique ID.
+	 *
+	 * @return
+	 * A SoupMessage object with the raw Zabbix servers's response,
+	 * which is an array of the responses.
+	 */
+	SoupMessage *queryBatch(const std::vector<std::string> &requests,
+	                        HatoholError &queryRet);
 	SoupMessage *queryAPIVersion(HatoholError &queryRet);
 	std::string getInitialJSONRequest(void);
 	bool parseInitialResponse(SoupMessage *msg);
@@ -310,6 +373,10 @@ protected:
 	  JSONParser &parser,
 	  VariableItemTablePtr &tablePtr, const int &index);
 
+	void parseHosts(JSONParser &parser, ItemTablePtr &hostsTablePtr,
+	                ItemTablePtr &hostsGroupsTablePtr);
+	void parseGroups(JSONParser &parser, ItemTablePtr &groupsTablePtr);
+
 	void pushTriggersHostid(JSONParser &parser, ItemGroup *itemGroup);
 	void pushApplicationid(JSONParser &parser, ItemGroup *itemGroup);
 
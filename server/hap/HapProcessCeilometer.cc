@@ -26,12 +26,14 @@
 #include "Utils.h"
 #include "JSONBuilder.h"
 #include "JSONParser.h"
+#include "HatoholThreadBase.h"
 #include "HapProcessCeilometer.h"
 
 using namespace std;
 using namespace mlpl;
 
 static const char *MIME_JSON = "application/json";
+static const size_t DEFAULT_MAX_CONCURRENT_REQUESTS = 8;
 
 struct OpenStackEndPoint {
 	string publicURL;
@@ -58,6 +60,9 @@ struct HapProcessCeilometer::HttpRequestArg
 	string      url;
 	string      body;
 	bool        useAuthToken;
+	// An ID of the target such as an alarm or an instance. It is used
+	// to handle the reply of a request sent by sendHttpRequests().
+	string      targetId;
 	mlpl::Reaper<SoupMessage> msgPtr;
 
 	HttpRequestArg(const char *_method, const string &_url)
@@ -68,6 +73,79 @@ struct HapProcessCeilometer::HttpRequestArg
 	}
 };
 
+struct HapProcessCeilometer::HttpRequestBatch
+{
+	vector<HttpRequestArg *> args;
+	vector<HatoholError>     errors;
+	Mutex                    lock;
+	size_t                   next; // protected by lock
+
+	HttpRequestBatch(void)
+	: next(0)
+	{
+	}
+
+	virtual ~HttpRequestBatch()
+	{
+		for (size_t i = 0; i < args.size(); i++)
+			delete args[i];
+	}
+
+	HttpRequestArg &add(const char *method, const string &url,
+	                    const string &targetId)
+	{
+		HttpRequestArg *arg = new HttpRequestArg(method, url);
+		arg->targetId = targetId;
+		args.push_back(arg);
+		return *arg;
+	}
+
+	size_t size(void) const
+	{
+		return args.size();
+	}
+
+	bool takeNext(size_t &index)
+	{
+		AutoMutex autoMutex(&lock);
+		if (next >= args.size())
+			return false;
+		index = next++;
+		return true;
+	}
+};
+
+/**
+ * A worker that sends requests in a batch one by one. Each worker has
+ * its own SoupSession so that the connection is kept alive between the
+ * requests (and between the polling cycles).
+ */
+struct HapProcessCeilometer::HttpRequestWorker : public HatoholThreadBase
+{
+	HapProcessCeilometer &hap;
+	HttpRequestBatch     &batch;
+	SoupSession          *session;
+
+	HttpRequestWorker(HapProcessCeilometer &_hap, HttpRequestBatch &_batch,
+	                  SoupSession *_session)
+	: hap(_hap),
+	  batch(_batch),
+	  session(_session)
+	{
+	}
+
+protected:
+	virtual gpointer mainThread(HatoholThreadArg *arg) override
+	{
+		size_t index;
+		while (batch.takeNext(index)) {
+			batch.errors[index] =
+			  hap.sendHttpRequest(*batch.args[index], session);
+		}
+		return NULL;
+	}
+};
+
 struct HapProcessCeilometer::Impl {
 	string osUsername;
 	string osPassword;
@@ -82,8 +160,12 @@ struct HapProcessCeilometer::Impl {
 	AcquireContext    acquireCtx;
 	vector<string>    instanceIds;
 	set<string>       targetItemNames;
+	size_t            maxConcurrentRequests;
+	// sessions[0] is also used for requests sent one by one.
+	vector<SoupSession *> sessions;
 
 	Impl(void)
+	: maxConcurrentRequests(DEFAULT_MAX_CONCURRENT_REQUESTS)
 	{
 		const char *targetItems[] = {
 			"cpu",
@@ -101,6 +183,19 @@ struct HapProcessCeilometer::Impl {
 			targetItemNames.insert(targetItems[i]);
 	}
 
+	virtual ~Impl()
+	{
+		for (size_t i = 0; i < sessions.size(); i++)
+			g_object_unref(sessions[i]);
+	}
+
+	SoupSession *getSession(const size_t &index)
+	{
+		while (sessions.size() <= index)
+			sessions.push_back(soup_session_sync_new());
+		return sessions[index];
+	}
+
 	void clear(void)
 	{
 		token.clear();
@@ -273,6 +368,12 @@ bool HapProcessCeilometer::parserEndpoints(JSONParser &parser,
 }
 
 HatoholError HapProcessCeilometer::sendHttpRequest(HttpRequestArg &arg)
+{
+	return sendHttpRequest(arg, m_impl->getSession(0));
+}
+
+HatoholError HapProcessCeilometer::sendHttpRequest(HttpRequestArg &arg,
+                                                   SoupSession *session)
 {
 	const string &url = arg.url;
 	HATOHOL_ASSERT(arg.method, "Method is not set.");
@@ -296,9 +397,7 @@ HatoholError HapProcessCeilometer::sendHttpRequest(HttpRequestArg &arg)
 		                         SOUP_MEMORY_TEMPORARY,
 		                         arg.body.c_str(), arg.body.size());
 	}
-	SoupSession *session = soup_session_sync_new();
 	guint ret = soup_session_send_message(session, msg);
-	g_object_unref(session);
 	if (ret != SOUP_STATUS_OK) {
 		MLPL_ERR("Failed to connect: (%d) %s, URL: %s\n",
 		         ret, soup_status_get_phrase(ret), url.c_str());
@@ -307,6 +406,43 @@ HatoholError HapProcessCeilometer::sendHttpRequest(HttpRequestArg &arg)
 	return HTERR_OK;
 }
 
+void HapProcessCeilometer::sendHttpRequests(HttpRequestBatch &batch)
+{
+	const size_t numRequests = batch.size();
+	batch.errors.assign(numRequests, HatoholError());
+	batch.next = 0;
+	const size_t numWorkers =
+	  min(numRequests, m_impl->maxConcurrentRequests);
+	if (numWorkers <= 1) {
+		for (size_t i = 0; i < numRequests; i++)
+			batch.errors[i] = sendHttpRequest(*batch.args[i]);
+		return;
+	}
+
+	// The sessions are created here because Impl isn't MT-safe.
+	vector<HttpRequestWorker *> workers;
+	for (size_t i = 0; i < numWorkers; i++) {
+		workers.push_back(new HttpRequestWorker(
+		  *this, batch, m_impl->getSession(i)));
+	}
+	for (size_t i = 0; i < numWorkers; i++)
+		workers[i]->start();
+	for (size_t i = 0; i < numWorkers; i++) {
+		workers[i]->waitExit();
+		delete workers[i];
+	}
+}
+
+void HapProcessCeilometer::setMaxConcurrentRequests(const size_t &num)
+{
+	m_impl->maxConcurrentRequests = num;
+}
+
+size_t HapProcessCeilometer::getMaxConcurrentRequests(void) const
+{
+	return m_impl->maxConcurrentRequests;
+}
+
 HatoholError HapProcessCeilometer::getInstanceList(void)
 {
 	m_impl->instanceIds.clear();
@@ -326,7 +462,8 @@ HatoholError HapProcessCeilometer::getInstanceList(void)
 	} else if (hostTablePtr->getNumberOfRows() == 0) {
 		return HTERR_OK;
 	}
-	sendTable(HAPI_CMD_SEND_HOSTS, static_cast<ItemTablePtr>(hostTablePtr));
+	sendTableDelta(HAPI_CMD_SEND_HOSTS,
+	               static_cast<ItemTablePtr>(hostTablePtr));
 	return err;
 }
 
@@ -571,12 +708,36 @@ HatoholError HapProcessCeilometer::parseReplyGetAlarmList(
 
 HatoholError HapProcessCeilometer::getAlarmHistories(void)
 {
+	const StringVector &alarmIds = m_impl->acquireCtx.alarmIds;
+	vector<TriggerIdType> triggerIds;
+	triggerIds.reserve(alarmIds.size());
+	for (size_t i = 0; i < alarmIds.size(); i++)
+		triggerIds.push_back(generateHashU64(alarmIds[i]));
+	vector<SmartTime> lastTimes;
+	if (!triggerIds.empty())
+		getTimesOfLastEvents(triggerIds, lastTimes);
+
+	HttpRequestBatch batch;
+	for (size_t i = 0; i < alarmIds.size(); i++) {
+		const string &alarmId = alarmIds[i];
+		string url = StringUtils::sprintf(
+		               "%s/v2/alarms/%s/history%s",
+		               m_impl->ceilometerEP.publicURL.c_str(),
+		               alarmId.c_str(),
+		               getHistoryQueryOption(lastTimes[i]).c_str());
+		batch.add(SOUP_METHOD_GET, url, alarmId);
+	}
+	sendHttpRequests(batch);
+
+	// The replies are handled in this thread in the order of the alarms.
 	HatoholError err(HTERR_OK);
-	for (size_t i = 0; i < m_impl->acquireCtx.alarmIds.size(); i++) {
-		err = getAlarmHistory(i);
+	for (size_t i = 0; i < batch.size(); i++) {
+		err = batch.errors[i];
+		if (err == HTERR_OK)
+			err = getAlarmHistory(*batch.args[i]);
 		if (err != HTERR_OK) {
 			MLPL_ERR("Failed to get alarm history: %s\n",
-			         m_impl->acquireCtx.alarmIds[i].c_str());
+			         batch.args[i]->targetId.c_str());
 		}
 	}
 	return err;
@@ -601,22 +762,13 @@ string  HapProcessCeilometer::getHistoryQueryOption(
 	return query;
 }
 
-HatoholError HapProcessCeilometer::getAlarmHistory(const unsigned int &index)
+HatoholError HapProcessCeilometer::getAlarmHistory(HttpRequestArg &arg)
 {
-	const char *alarmId = m_impl->acquireCtx.alarmIds[index].c_str();
-	const SmartTime lastTime = getTimeOfLastEvent(generateHashU64(alarmId));
-	string url = StringUtils::sprintf(
-	               "%s/v2/alarms/%s/history%s",
-	               m_impl->ceilometerEP.publicURL.c_str(),
-	               alarmId, getHistoryQueryOption(lastTime).c_str());
-	HttpRequestArg arg(SOUP_METHOD_GET, url);
-	HatoholError err = sendHttpRequest(arg);
-	if (err != HTERR_OK)
-		return err;
+	const string &url = arg.url;
 	SoupMessage *msg = arg.msgPtr.get();
 
 	AlarmTimeMap alarmTimeMap;
-	err = parseReplyGetAlarmHistory(msg, alarmTimeMap);
+	HatoholError err = parseReplyGetAlarmHistory(msg, alarmTimeMap);
 	if (err != HTERR_OK) {
 		MLPL_DBG("body: %" G_GOFFSET_FORMAT ", %s\n",
 		         msg->response_body->length, msg->response_body->data);
@@ -870,10 +1022,36 @@ HatoholError HapProcessCeilometer::fetchItem(const MessagingContext &msgCtx,
 {
 	MLPL_DBG("fetchItem\n");
 	VariableItemTablePtr tablePtr;
-	HatoholError err(HTERR_OK);
-	for (size_t i = 0; i < m_impl->instanceIds.size(); i++) {
-		const string &instanceId = m_impl->instanceIds[i];
-		err = fetchItemsOfInstance(tablePtr, instanceId);
+	HatoholError err = updateAuthTokenIfNeeded();
+	if (err == HTERR_OK) {
+		// Get links to the meters of all instances, then the meters.
+		HttpRequestBatch instanceBatch;
+		for (size_t i = 0; i < m_impl->instanceIds.size(); i++) {
+			const string &instanceId = m_impl->instanceIds[i];
+			string url = StringUtils::sprintf(
+			  "%s/v2/resources/%s",
+			  m_impl->ceilometerEP.publicURL.c_str(),
+			  instanceId.c_str());
+			instanceBatch.add(SOUP_METHOD_GET, url, instanceId);
+		}
+		sendHttpRequests(instanceBatch);
+
+		HttpRequestBatch resourceBatch;
+		for (size_t i = 0; i < instanceBatch.size(); i++) {
+			err = instanceBatch.errors[i];
+			if (err != HTERR_OK)
+				continue;
+			err = fetchItemsOfInstance(resourceBatch,
+			                           *instanceBatch.args[i]);
+		}
+		sendHttpRequests(resourceBatch);
+
+		for (size_t i = 0; i < resourceBatch.size(); i++) {
+			err = resourceBatch.errors[i];
+			if (err != HTERR_OK)
+				continue;
+			err = getResource(tablePtr, *resourceBatch.args[i]);
+		}
 	}
 	SmartBuffer resBuf;
 	setupResponseBuffer<void>(resBuf, 0, HAPI_RES_ITEMS, &msgCtx);
@@ -884,21 +1062,9 @@ HatoholError HapProcessCeilometer::fetchItem(const MessagingContext &msgCtx,
 }
 
 HatoholError HapProcessCeilometer::fetchItemsOfInstance(
-  VariableItemTablePtr &tablePtr, const string &instanceId)
+  HttpRequestBatch &resourceBatch, HttpRequestArg &arg)
 {
-	HatoholError err = updateAuthTokenIfNeeded();
-	if (err != HTERR_OK)
-		return err;
-
-	string url = StringUtils::sprintf(
-	               "%s/v2/resources/%s",
-	               m_impl->ceilometerEP.publicURL.c_str(),
-	               instanceId.c_str());
-	HttpRequestArg arg(SOUP_METHOD_GET, url);
-	err = sendHttpRequest(arg);
-	if (err != HTERR_OK)
-		return err;
-
+	const string &instanceId = arg.targetId;
 	SoupMessage *msg = arg.msgPtr.get();
 	JSONParser parser(msg->response_body->data);
 	if (parser.hasError()) {
@@ -913,8 +1079,8 @@ HatoholError HapProcessCeilometer::fetchItemsOfInstance(
 
 	const unsigned int count = parser.countElements();
 	for (unsigned int idx = 0; idx < count; idx++) {
-		HatoholError err = parserResourceLink(parser, tablePtr, idx,
-		                                      instanceId);
+		HatoholError err = parserResourceLink(parser, resourceBatch,
+		                                      idx, instanceId);
 		if (err != HTERR_OK)
 			return err;
 	}
@@ -937,8 +1103,8 @@ HatoholError HapProcessCeilometer::fetchHistory(const MessagingContext &msgCtx,
 }
 
 HatoholError HapProcessCeilometer::parserResourceLink(
-  JSONParser &parser, VariableItemTablePtr &tablePtr, const unsigned int &index,
-  const string &instanceId)
+  JSONParser &parser, HttpRequestBatch &resourceBatch,
+  const unsigned int &index, const string &instanceId)
 {
 	JSONParser::PositionStack parserRewinder(parser);
 	if (! parserRewinder.pushElement(index)) {
@@ -953,17 +1119,15 @@ HatoholError HapProcessCeilometer::parserResourceLink(
 		return HTERR_OK;
 	if (!read(parser, "href", href))
 		return HTERR_FAILED_TO_PARSE_JSON_DATA;
-	return getResource(tablePtr, href, instanceId);
+	resourceBatch.add(SOUP_METHOD_GET, href + "&limit=1", instanceId);
+	return HTERR_OK;
 }
 
 HatoholError HapProcessCeilometer::getResource(
-  VariableItemTablePtr &tablePtr, const string &_url, const string &instanceId)
+  VariableItemTablePtr &tablePtr, HttpRequestArg &arg)
 {
-	string url = _url + "&limit=1";
-	HttpRequestArg arg(SOUP_METHOD_GET, url);
-	HatoholError err = sendHttpRequest(arg);
-	if (err != HTERR_OK)
-		return err;
+	const string &url = arg.url;
+	const string &instanceId = arg.targetId;
 	SoupMessage *msg = arg.msgPtr.get();
 	JSONParser parser(msg->response_body->data);
 	if (parser.hasError()) {
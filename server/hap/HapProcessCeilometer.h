@@ -42,7 +42,19 @@ protected:
 	bool parseReplyToknes(SoupMessage *msg);
 
 	struct HttpRequestArg;
+	struct HttpRequestBatch;
+	struct HttpRequestWorker;
 	HatoholError sendHttpRequest(HttpRequestArg &arg);
+	HatoholError sendHttpRequest(HttpRequestArg &arg, SoupSession *session);
+
+	/**
+	 * Send requests in a batch concurrently. The number of requests on
+	 * the fly is limited by getMaxConcurrentRequests(). The result
+	 * of each request is stored in HttpRequestBatch::errors.
+	 */
+	void sendHttpRequests(HttpRequestBatch &batch);
+	void setMaxConcurrentRequests(const size_t &num);
+	size_t getMaxConcurrentRequests(void) const;
 
 	HatoholError getInstanceList(void);
 	HatoholError parseReplyInstanceList(SoupMessage *msg,
@@ -62,7 +74,7 @@ protected:
 	uint64_t generateHashU64(const std::string &str);
 
 	HatoholError getAlarmHistories(void);
-	HatoholError getAlarmHistory(const unsigned int &index);
+	HatoholError getAlarmHistory(HttpRequestArg &arg);
 	std::string  getHistoryQueryOption(const mlpl::SmartTime &lastTime);
 	HatoholError parseReplyGetAlarmHistory(SoupMessage *msg,
 	                                       AlarmTimeMap &alarmTimeMap);
@@ -89,16 +101,15 @@ protected:
 	                       const MessagingContext &msgCtx,
 			       const mlpl::SmartBuffer &cmdBuf) override;
 	HatoholError fetchItemsOfInstance(
-	  VariableItemTablePtr &tablePtr, const std::string &instanceId);
+	  HttpRequestBatch &resourceBatch, HttpRequestArg &arg);
 	virtual HatoholError fetchHistory(
 	  const MessagingContext &msgCtx,
 	  const mlpl::SmartBuffer &cmdBuf) override;
 	HatoholError parserResourceLink(
-	  JSONParser &parser, VariableItemTablePtr &tablePtr,
+	  JSONParser &parser, HttpRequestBatch &resourceBatch,
 	  const unsigned int &index, const std::string &instanceId);
 	HatoholError getResource(
-	  VariableItemTablePtr &tablePtr, const std::string &url,
-	  const std::string &instanceId);
+	  VariableItemTablePtr &tablePtr, HttpRequestArg &arg);
 
 private:
 	struct Impl;
@@ -83,15 +83,15 @@ void HapProcessZabbixAPI::workOnHostsAndHostgroupElements(void)
 {
 	ItemTablePtr hostTablePtr, hostGroupsTablePtr;
 	getHosts(hostTablePtr, hostGroupsTablePtr);
-	sendTable(HAPI_CMD_SEND_HOSTS, hostTablePtr);
-	sendTable(HAPI_CMD_SEND_HOST_GROUP_ELEMENTS, hostGroupsTablePtr);
+	sendTableDelta(HAPI_CMD_SEND_HOSTS, hostTablePtr);
+	sendTableDelta(HAPI_CMD_SEND_HOST_GROUP_ELEMENTS, hostGroupsTablePtr);
 }
 
 void HapProcessZabbixAPI::workOnHostgroups(void)
 {
 	ItemTablePtr hostgroupsTablePtr;
 	getGroups(hostgroupsTablePtr);
-	sendTable(HAPI_CMD_SEND_HOST_GROUPS, hostgroupsTablePtr);
+	sendTableDelta(HAPI_CMD_SEND_HOST_GROUPS, hostgroupsTablePtr);
 }
 
 void HapProcessZabbixAPI::workOnEvents(void)
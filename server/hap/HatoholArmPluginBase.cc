@@ -24,6 +24,7 @@
 #include <Mutex.h>
 #include <Reaper.h>
 #include "HatoholArmPluginBase.h"
+#include "HapiLocalChannel.h"
 
 using namespace mlpl;
 using namespace std;
@@ -99,7 +100,141 @@ private:
 
 };
 
+// ---------------------------------------------------------------------------
+// TableSnapshot
+// ---------------------------------------------------------------------------
+typedef map<string, ItemGroupPtr> RowMap;
+typedef RowMap::iterator          RowMapIterator;
+typedef RowMap::const_iterator    RowMapConstIterator;
+
+struct TableSnapshot {
+	Mutex    lock;
+	// The generation of 'rows'. Zero means that the server may not have
+	// the same rows. The whole table is sent next time in that case.
+	uint64_t generation;
+	uint64_t lastGeneration;
+	RowMap   rows;
+
+	TableSnapshot(void)
+	: generation(0),
+	  lastGeneration(0)
+	{
+	}
+
+	void invalidate(void)
+	{
+		AutoMutex autoMutex(&lock);
+		generation = 0;
+	}
+};
+
+struct TableDeltaCallbacks : public HatoholArmPluginInterface::CommandCallbacks
+{
+	TableSnapshot *snapshot;
+
+	TableDeltaCallbacks(TableSnapshot *_snapshot)
+	: snapshot(_snapshot)
+	{
+	}
+
+	virtual void onGotReply(
+	  SmartBuffer &replyBuf, const HapiCommandHeader &cmdHeader) override
+	{
+		const HapiResponseHeader *header =
+		  replyBuf.getPointer<HapiResponseHeader>(0);
+		const uint16_t code = EndianConverter::LtoN(header->code);
+		if (code == HAPI_RES_OK)
+			return;
+		MLPL_INFO("Failed to apply a table delta (%d). "
+		          "The whole table will be sent next time.\n", code);
+		snapshot->invalidate();
+	}
+
+	virtual void onError(
+	  const HapiResponseCode &code,
+	  const HapiCommandHeader &cmdHeader) override
+	{
+		// The snapshot may have been deleted with the plugin.
+		if (code == HAPI_RES_ERR_DESTRUCTED)
+			return;
+		snapshot->invalidate();
+	}
+};
+
+static void getKeyItemIdsOfTable(
+  const HapiCommandCode &code, vector<ItemId> &keyItemIds)
+{
+	switch (code) {
+	case HAPI_CMD_SEND_HOSTS:
+		keyItemIds.push_back(ITEM_ID_ZBX_HOSTS_HOSTID);
+		break;
+	case HAPI_CMD_SEND_HOST_GROUP_ELEMENTS:
+		keyItemIds.push_back(ITEM_ID_ZBX_HOSTS_GROUPS_HOSTID);
+		keyItemIds.push_back(ITEM_ID_ZBX_HOSTS_GROUPS_GROUPID);
+		break;
+	case HAPI_CMD_SEND_HOST_GROUPS:
+		keyItemIds.push_back(ITEM_ID_ZBX_GROUPS_GROUPID);
+		break;
+	default:
+		THROW_HATOHOL_EXCEPTION("Unsupported table: %d\n", code);
+	}
+}
+
+static string makeRowKey(
+  const ItemGroup *itemGroup, const vector<ItemId> &keyItemIds)
+{
+	string key;
+	for (size_t i = 0; i < keyItemIds.size(); i++) {
+		const ItemData *itemData = itemGroup->getItem(keyItemIds[i]);
+		HATOHOL_ASSERT(itemData, "Not found key item: %" PRIu64 "\n",
+		               keyItemIds[i]);
+		if (i > 0)
+			key += "\t";
+		key += itemData->getString();
+	}
+	return key;
+}
+
+static bool isSameRow(const ItemGroup *row0, const ItemGroup *row1)
+{
+	const size_t numItems = row0->getNumberOfItems();
+	if (row1->getNumberOfItems() != numItems)
+		return false;
+	for (size_t i = 0; i < numItems; i++) {
+		const ItemData *item0 = row0->getItemAt(i);
+		const ItemData *item1 = row1->getItemAt(i);
+		if (item0->getId() != item1->getId())
+			return false;
+		if (item0->getItemType() != item1->getItemType())
+			return false;
+		if (item0->isNull() != item1->isNull())
+			return false;
+		if (!item0->isNull() && *item0 != *item1)
+			return false;
+	}
+	return true;
+}
+
 struct HatoholArmPluginBase::Impl {
+	Mutex                            tableSnapshotsLock;
+	map<uint16_t, TableSnapshot *>   tableSnapshots;
+
+	virtual ~Impl()
+	{
+		map<uint16_t, TableSnapshot *>::iterator it =
+		  tableSnapshots.begin();
+		for (; it != tableSnapshots.end(); ++it)
+			delete it->second;
+	}
+
+	TableSnapshot &getTableSnapshot(const HapiCommandCode &code)
+	{
+		AutoMutex autoMutex(&tableSnapshotsLock);
+		TableSnapshot *&snapshot = tableSnapshots[code];
+		if (!snapshot)
+			snapshot = new TableSnapshot();
+		return *snapshot;
+	}
 };
 
 // ---------------------------------------------------------------------------
@@ -112,6 +247,12 @@ HatoholArmPluginBase::HatoholArmPluginBase(void)
 	if (env)
 		setQueueAddress(env);
 
+	// The server sets this when the plugin should use the shared memory
+	// instead of the AMQP broker.
+	const char *localChannelPath = getenv(HapiLocalChannel::ENV_NAME);
+	if (localChannelPath)
+		setLocalChannelPath(localChannelPath);
+
 	registerCommandHandler(
 	  HAPI_CMD_REQ_FETCH_ITEMS,
 	  (CommandHandler)
@@ -287,6 +428,77 @@ SmartTime HatoholArmPluginBase::getTimeOfLastEvent(
 	return cb->lastTime;
 }
 
+void HatoholArmPluginBase::getTimesOfLastEvents(
+  const vector<TriggerIdType> &triggerIds, vector<SmartTime> &times,
+  EventIdType *lastEventId)
+{
+	struct Callback : public SyncCommand {
+		vector<SmartTime> &times;
+		EventIdType        lastEventId;
+
+		Callback(HatoholArmPluginBase *obj, vector<SmartTime> &_times)
+		: SyncCommand(obj),
+		  times(_times),
+		  lastEventId(INVALID_EVENT_ID)
+		{
+		}
+
+		virtual void onGotReply(
+		  mlpl::SmartBuffer &replyBuf,
+		  const HapiCommandHeader &cmdHeader) override
+		{
+			SemaphorePoster poster(this);
+			HatoholArmPluginBase *obj = getObject();
+			const HapiResTimesOfLastEvents *body =
+			  obj->getResponseBody
+			    <HapiResTimesOfLastEvents>(replyBuf);
+			const size_t numTriggers = LtoN(body->numTriggers);
+			body = obj->getResponseBody<HapiResTimesOfLastEvents>(
+			  replyBuf,
+			  sizeof(HapiResTimeOfLastEvent) * numTriggers);
+			lastEventId = LtoN(body->lastEventId);
+			const HapiResTimeOfLastEvent *timeArray =
+			  reinterpret_cast<const HapiResTimeOfLastEvent *>(
+			    body + 1);
+			times.reserve(numTriggers);
+			for (size_t i = 0; i < numTriggers; i++) {
+				timespec ts = {
+					(time_t)LtoN(timeArray[i].sec),
+					(long)LtoN(timeArray[i].nsec)
+				};
+				times.push_back(SmartTime(ts));
+			}
+			setSucceeded();
+		}
+	} *cb = new Callback(this, times);
+	Reaper<UsedCountable> reaper(cb, UsedCountable::unref);
+
+	times.clear();
+	const size_t numTriggers = triggerIds.size();
+	SmartBuffer cmdBuf;
+	HapiParamTimesOfLastEvents *param =
+	  setupCommandHeader<HapiParamTimesOfLastEvents>(
+	    cmdBuf, HAPI_CMD_GET_TIMES_OF_LAST_EVENTS,
+	    sizeof(uint64_t) * numTriggers);
+	param->numTriggers = NtoL(numTriggers);
+	uint64_t *idArray = reinterpret_cast<uint64_t *>(param + 1);
+	for (size_t i = 0; i < numTriggers; i++)
+		idArray[i] = NtoL(triggerIds[i]);
+	send(cmdBuf, cb);
+	cb->wait();
+	if (!cb->getSucceeded()) {
+		THROW_HATOHOL_EXCEPTION(
+		  "Failed to call HAPI_CMD_GET_TIMES_OF_LAST_EVENTS\n");
+	}
+	if (times.size() != numTriggers) {
+		THROW_HATOHOL_EXCEPTION(
+		  "Unexpected number of times: %zd (expected: %zd)\n",
+		  times.size(), numTriggers);
+	}
+	if (lastEventId)
+		*lastEventId = cb->lastEventId;
+}
+
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
@@ -390,6 +602,69 @@ void HatoholArmPluginBase::sendTable(
 	send(cmdBuf);
 }
 
+bool HatoholArmPluginBase::sendTableDelta(
+  const HapiCommandCode &code, const ItemTablePtr &tablePtr)
+{
+	vector<ItemId> keyItemIds;
+	getKeyItemIdsOfTable(code, keyItemIds);
+
+	RowMap currRows;
+	const ItemGroupList &itemGroupList = tablePtr->getItemGroupList();
+	ItemGroupListConstIterator grpIt = itemGroupList.begin();
+	for (; grpIt != itemGroupList.end(); ++grpIt) {
+		const ItemGroup *itemGroup = *grpIt;
+		currRows[makeRowKey(itemGroup, keyItemIds)] =
+		  ItemGroupPtr(itemGroup);
+	}
+
+	TableSnapshot &snapshot = m_impl->getTableSnapshot(code);
+	AutoMutex autoMutex(&snapshot.lock);
+	const uint64_t baseGeneration = snapshot.generation;
+	VariableItemTablePtr addedRows, removedRows;
+	if (baseGeneration == 0) {
+		RowMapConstIterator it = currRows.begin();
+		for (; it != currRows.end(); ++it)
+			addedRows->add(it->second);
+	} else {
+		RowMapConstIterator it = currRows.begin();
+		for (; it != currRows.end(); ++it) {
+			RowMapConstIterator prevIt =
+			  snapshot.rows.find(it->first);
+			if (prevIt != snapshot.rows.end() &&
+			    isSameRow(prevIt->second, it->second))
+				continue;
+			addedRows->add(it->second);
+		}
+		it = snapshot.rows.begin();
+		for (; it != snapshot.rows.end(); ++it) {
+			if (currRows.find(it->first) == currRows.end())
+				removedRows->add(it->second);
+		}
+		if (addedRows->getNumberOfRows() == 0 &&
+		    removedRows->getNumberOfRows() == 0)
+			return false;
+	}
+
+	const uint64_t generation = ++snapshot.lastGeneration;
+	snapshot.rows.swap(currRows);
+	snapshot.generation = generation;
+
+	SmartBuffer cmdBuf;
+	HapiParamTableDelta *body =
+	  setupCommandHeader<HapiParamTableDelta>(
+	    cmdBuf, HAPI_CMD_SEND_TABLE_DELTA);
+	body->tableCode      = NtoL((uint16_t)code);
+	body->baseGeneration = NtoL(baseGeneration);
+	body->generation     = NtoL(generation);
+	cmdBuf.incIndex(sizeof(HapiParamTableDelta));
+	appendItemTable(cmdBuf, (ItemTablePtr)addedRows);
+	appendItemTable(cmdBuf, (ItemTablePtr)removedRows);
+	TableDeltaCallbacks *cb = new TableDeltaCallbacks(&snapshot);
+	Reaper<UsedCountable> reaper(cb, UsedCountable::unref);
+	send(cmdBuf, cb);
+	return true;
+}
+
 void HatoholArmPluginBase::sendArmInfo(const ArmInfo &armInfo,
 				       const HatoholArmPluginWatchType &type)
 {
@@ -64,6 +64,22 @@ public:
 	mlpl::SmartTime getTimeOfLastEvent(
 	  const TriggerIdType &triggerId = ALL_TRIGGERS);
 
+	/**
+	 * Get the times of the last events of triggers with one command.
+	 *
+	 * @param triggerIds IDs of the tareget triggers.
+	 * @param times
+	 * The times are stored in the same order as triggerIds. If no events
+	 * of a trigger is found, hasValidTime() of the element is false.
+	 * @param lastEventId
+	 * If this is not NULL, the last event ID in the Hatohol server
+	 * (the same as getLastEventId()) is stored.
+	 */
+	void getTimesOfLastEvents(
+	  const std::vector<TriggerIdType> &triggerIds,
+	  std::vector<mlpl::SmartTime> &times,
+	  EventIdType *lastEventId = NULL);
+
 protected:
 	static const size_t WAIT_INFINITE;
 
@@ -83,6 +99,23 @@ protected:
 
 	void sendTable(const HapiCommandCode &code,
 	               const ItemTablePtr &tablePtr);
+
+	/**
+	 * Send only the rows changed since the last call with the same code.
+	 *
+	 * The whole table is sent on the first call and after the server
+	 * fails to apply a delta. Nothing is sent if no rows are changed.
+	 *
+	 * @param code
+	 * HAPI_CMD_SEND_HOSTS, HAPI_CMD_SEND_HOST_GROUPS or
+	 * HAPI_CMD_SEND_HOST_GROUP_ELEMENTS.
+	 *
+	 * @param tablePtr The whole table.
+	 *
+	 * @return true if the command is sent.
+	 */
+	bool sendTableDelta(const HapiCommandCode &code,
+	                    const ItemTablePtr &tablePtr);
 	void sendArmInfo(const ArmInfo &armInfo,
 			 const HatoholArmPluginWatchType &type = COLLECT_OK);
 	void sendHapSelfTriggers(const int TriggerNum,
@@ -20,7 +20,9 @@
 #include <cstdio>
 #include <cstdlib>
 #include <stdarg.h>
+#include <inttypes.h>
 #include <string>
+#include <vector>
 #include <syslog.h>
 #include <unistd.h>
 #include <sys/syscall.h>
@@ -31,27 +33,373 @@ using namespace mlpl;
 #include <string.h>
 #include "StringUtils.h"
 #include "SmartTime.h"
+#include "Mutex.h"
+#include "AtomicValue.h"
+#include "SimpleSemaphore.h"
 
 static const char* LogHeaders [MLPL_NUM_LOG_LEVEL] = {
 	"BUG", "CRIT", "ERR", "WARN", "INFO", "DBG",
 };
 
-LogLevel Logger::m_currLogLevel = MLPL_LOG_LEVEL_NOT_SET;
-pthread_rwlock_t Logger::m_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+AtomicValue<int> Logger::m_currLogLevel(MLPL_LOG_LEVEL_NOT_SET);
+AtomicValue<uint32_t> Logger::m_levelGeneration(1);
+pthread_once_t Logger::m_levelOnce = PTHREAD_ONCE_INIT;
 bool Logger::syslogoutputFlag = true;
 ReadWriteLock Logger::lock;
 const char *Logger::LEVEL_ENV_VAR_NAME = "MLPL_LOGGER_LEVEL";
 const char *Logger::MLPL_LOGGER_FLAGS = "MLPL_LOGGER_FLAGS";
+const char *Logger::RATE_LIMIT_ENV_VAR_NAME = "MLPL_LOGGER_RATE_LIMIT";
 bool Logger::syslogConnected = false;
 bool Logger::extraInfoFlag[256];
 pid_t Logger::pid = 0;
 __thread pid_t Logger::tid =0;
 
+static AtomicValue<uint32_t> g_rateLimit(0);
+
+static const uint32_t LEVEL_CACHE_LEVEL_BITS = 8;
+static const uint32_t LEVEL_CACHE_LEVEL_MASK =
+  (1 << LEVEL_CACHE_LEVEL_BITS) - 1;
+static const uint32_t LEVEL_CACHE_GENERATION_MASK =
+  0xffffffff >> LEVEL_CACHE_LEVEL_BITS;
+
+// These are created on the first use, because MLPL_P() can be called
+// from static initializers in other files.
+static Mutex &getModuleLogLevelsLock(void)
+{
+	static Mutex moduleLogLevelsLock;
+	return moduleLogLevelsLock;
+}
+
+static LogLevelMap &getModuleLogLevelMap(void)
+{
+	static LogLevelMap moduleLogLevels;
+	return moduleLogLevels;
+}
+
+// ----------------------------------------------------------------------------
+// AsyncWriter
+// ----------------------------------------------------------------------------
+static const size_t ASYNC_LOG_BODY_SIZE = 512;
+static const size_t ASYNC_LOG_RING_SIZE = 128;
+static const size_t ASYNC_LOG_WAKE_UP_INTERVAL_MSEC = 100;
+
+struct AsyncLogRecord {
+	LogLevel    level;
+	const char *fileName;
+	int         lineNumber;
+	timespec    time;
+	pid_t       threadId;
+	char        body[ASYNC_LOG_BODY_SIZE];
+};
+
+/**
+ * A single-producer single-consumer ring buffer. The producer is the
+ * thread that owns the ring and the consumer is the writer thread.
+ * 'head' is modified only by the producer and 'tail' only by the consumer,
+ * so no lock is needed.
+ */
+struct AsyncLogRing {
+	AsyncLogRecord        records[ASYNC_LOG_RING_SIZE];
+	AtomicValue<size_t>   head;
+	AtomicValue<size_t>   tail;
+	AtomicValue<uint64_t> numDropped;
+	uint64_t              numReportedDropped; // accessed only by the writer
+	AtomicValue<int>      orphaned;
+
+	AsyncLogRing(void)
+	: head(0),
+	  tail(0),
+	  numDropped(0),
+	  numReportedDropped(0),
+	  orphaned(false)
+	{
+	}
+
+	bool empty(void) const
+	{
+		return head.get() == tail.get();
+	}
+
+	AsyncLogRecord *getWritableRecord(void)
+	{
+		const size_t idx = head.get();
+		if (idx - tail.get() >= ASYNC_LOG_RING_SIZE)
+			return NULL;
+		return &records[idx % ASYNC_LOG_RING_SIZE];
+	}
+
+	void commit(void)
+	{
+		__sync_synchronize();
+		head.add(1);
+	}
+
+	const AsyncLogRecord *getReadableRecord(void)
+	{
+		const size_t idx = tail.get();
+		if (idx == head.get())
+			return NULL;
+		__sync_synchronize();
+		return &records[idx % ASYNC_LOG_RING_SIZE];
+	}
+
+	void release(void)
+	{
+		__sync_synchronize();
+		tail.add(1);
+	}
+};
+
+struct Logger::AsyncWriter : public Logger {
+	static AtomicValue<int>       enabled;
+	static AtomicValue<uint64_t>  numDropped;
+	// Held while the writer thread is started or stopped, and while
+	// the rings are drained.
+	static Mutex                  lock;
+	static bool                   running;
+	static bool                   stopRequest;
+	static pthread_t              thread;
+	static SimpleSemaphore        wakeUpSem;
+	static vector<AsyncLogRing *> rings;
+	static Mutex                  ringsLock;
+	static pthread_key_t          ringKey;
+	static pthread_once_t         ringKeyOnce;
+	static __thread AsyncLogRing *currRing;
+
+	static void createRingKey(void)
+	{
+		pthread_key_create(&ringKey, orphanRing);
+		pthread_atfork(lockBeforeFork, unlockAfterFork,
+		               resetAfterFork);
+		atexit(stopAtExit);
+	}
+
+	static void orphanRing(void *data)
+	{
+		// The ring is deleted by the writer after it is drained.
+		// This is called in the exiting thread. A message logged by
+		// a later TLS destructor gets a new ring.
+		AsyncLogRing *ring = static_cast<AsyncLogRing *>(data);
+		currRing = NULL;
+		ring->orphaned.set(true);
+	}
+
+	static AsyncLogRing *getRing(void)
+	{
+		if (currRing)
+			return currRing;
+		pthread_once(&ringKeyOnce, createRingKey);
+		AsyncLogRing *ring = new AsyncLogRing();
+		ringsLock.lock();
+		rings.push_back(ring);
+		ringsLock.unlock();
+		pthread_setspecific(ringKey, ring);
+		currRing = ring;
+		return ring;
+	}
+
+	static bool push(LogLevel level, const char *fileName, int lineNumber,
+	                 const char *fmt, va_list ap)
+	{
+		AsyncLogRing *ring = getRing();
+		AsyncLogRecord *record = ring->getWritableRecord();
+		if (!record) {
+			ring->numDropped.add(1);
+			numDropped.add(1);
+			return true;
+		}
+
+		va_list aq;
+		va_copy(aq, ap);
+		const int len = vsnprintf(record->body, ASYNC_LOG_BODY_SIZE,
+		                          fmt, aq);
+		va_end(aq);
+		// A long message is written synchronously not to be truncated.
+		if (len < 0 || static_cast<size_t>(len) >= ASYNC_LOG_BODY_SIZE)
+			return false;
+
+		record->level = level;
+		record->fileName = fileName;
+		record->lineNumber = lineNumber;
+		record->time = SmartTime::getCurrTime().getAsTimespec();
+		record->threadId = getThreadId();
+		ring->commit();
+		wakeUpSem.post();
+		return true;
+	}
+
+	static void write(const AsyncLogRecord &record)
+	{
+		string extraInfoString =
+		  createExtraInfoString(record.time, record.threadId);
+		string header = createHeader(record.level, record.fileName,
+		                             record.lineNumber, extraInfoString);
+		output(header, record.body);
+	}
+
+	static void reportDropped(AsyncLogRing *ring)
+	{
+		const uint64_t numDropped = ring->numDropped.get();
+		const uint64_t numNew = numDropped - ring->numReportedDropped;
+		if (numNew == 0)
+			return;
+		ring->numReportedDropped = numDropped;
+		string header = createHeader(MLPL_LOG_WARN, __FILE__, __LINE__,
+		                             createExtraInfoString());
+		output(header, StringUtils::sprintf(
+		  "Dropped %" PRIu64 " messages: the ring buffer is full.\n",
+		  numNew));
+	}
+
+	/**
+	 * Write the messages put by the calling thread. It is used before
+	 * a message is written synchronously so that the message follows
+	 * the ones in the ring.
+	 */
+	static void drainCurrRing(void)
+	{
+		if (!currRing)
+			return;
+		// The writer thread also drains rings with this lock.
+		ringsLock.lock();
+		const AsyncLogRecord *record;
+		while ((record = currRing->getReadableRecord())) {
+			write(*record);
+			currRing->release();
+		}
+		reportDropped(currRing);
+		ringsLock.unlock();
+	}
+
+	static void drain(void)
+	{
+		ringsLock.lock();
+		vector<AsyncLogRing *>::iterator it = rings.begin();
+		while (it != rings.end()) {
+			AsyncLogRing *ring = *it;
+			// Check it before draining so that no message put just
+			// before the owner thread exits is lost.
+			const bool orphaned = ring->orphaned.get();
+			const AsyncLogRecord *record;
+			while ((record = ring->getReadableRecord())) {
+				write(*record);
+				ring->release();
+			}
+			reportDropped(ring);
+			if (orphaned) {
+				delete ring;
+				it = rings.erase(it);
+			} else {
+				++it;
+			}
+		}
+		ringsLock.unlock();
+	}
+
+	static void *mainLoop(void *)
+	{
+		while (true) {
+			// The timeout covers a wake up missed by a race
+			// between the check of the rings and the wait.
+			wakeUpSem.timedWait(ASYNC_LOG_WAKE_UP_INTERVAL_MSEC);
+			drain();
+			lock.lock();
+			const bool exitLoop = stopRequest;
+			lock.unlock();
+			if (exitLoop)
+				break;
+		}
+		return NULL;
+	}
+
+	static void start(void)
+	{
+		pthread_once(&ringKeyOnce, createRingKey);
+		lock.lock();
+		if (!running) {
+			stopRequest = false;
+			const int err =
+			  pthread_create(&thread, NULL, mainLoop, NULL);
+			if (err) {
+				lock.unlock();
+				log(MLPL_LOG_ERR, __FILE__, __LINE__,
+				    "Failed to create a writer thread: %s\n",
+				    strerror(err));
+				return;
+			}
+			running = true;
+		}
+		enabled.set(true);
+		lock.unlock();
+	}
+
+	static void stop(void)
+	{
+		lock.lock();
+		enabled.set(false);
+		if (!running) {
+			lock.unlock();
+			return;
+		}
+		stopRequest = true;
+		lock.unlock();
+		wakeUpSem.post();
+		pthread_join(thread, NULL);
+		lock.lock();
+		running = false;
+		lock.unlock();
+		// Messages put while the thread was stopping
+		drain();
+	}
+
+	static void stopAtExit(void)
+	{
+		stop();
+	}
+
+	static void lockBeforeFork(void)
+	{
+		lock.lock();
+		ringsLock.lock();
+	}
+
+	static void unlockAfterFork(void)
+	{
+		ringsLock.unlock();
+		lock.unlock();
+	}
+
+	static void resetAfterFork(void)
+	{
+		// The writer thread doesn't exist in the child process.
+		enabled.set(false);
+		running = false;
+		unlockAfterFork();
+	}
+};
+
+AtomicValue<int>       Logger::AsyncWriter::enabled(false);
+AtomicValue<uint64_t>  Logger::AsyncWriter::numDropped(0);
+Mutex                  Logger::AsyncWriter::lock;
+bool                   Logger::AsyncWriter::running = false;
+bool                   Logger::AsyncWriter::stopRequest = false;
+pthread_t              Logger::AsyncWriter::thread;
+SimpleSemaphore        Logger::AsyncWriter::wakeUpSem(0);
+vector<AsyncLogRing *> Logger::AsyncWriter::rings;
+Mutex                  Logger::AsyncWriter::ringsLock;
+pthread_key_t          Logger::AsyncWriter::ringKey;
+pthread_once_t         Logger::AsyncWriter::ringKeyOnce = PTHREAD_ONCE_INIT;
+__thread AsyncLogRing *Logger::AsyncWriter::currRing = NULL;
+
 class Initializer : public Logger {
 	public:
 		Initializer() {
-			setExtraInfoFlag(getenv(MLPL_LOGGER_FLAGS));
+			const char *flags = getenv(MLPL_LOGGER_FLAGS);
+			setExtraInfoFlag(flags);
 			setupProcessId();
+			setupRateLimit();
+			if (flags && strchr(flags, 'A'))
+				enableAsyncOutput();
 		}
 };
 Initializer init;
@@ -62,24 +410,143 @@ Initializer init;
 void Logger::log(LogLevel level, const char *fileName, int lineNumber,
                  const char *fmt, ...)
 {
-	string extraInfoString = createExtraInfoString();
-	string header = createHeader(level, fileName, lineNumber, extraInfoString);
-
 	va_list ap;
 	va_start(ap, fmt);
+	if (AsyncWriter::enabled.get()) {
+		if (level > MLPL_LOG_CRIT &&
+		    AsyncWriter::push(level, fileName, lineNumber, fmt, ap)) {
+			va_end(ap);
+			return;
+		}
+		// A critical or long message is written synchronously after
+		// the messages of this thread that are still queued.
+		AsyncWriter::drainCurrRing();
+	}
 	string body = StringUtils::vsprintf(fmt, ap);
 	va_end(ap);
 
-	fprintf(stderr, "%s%s", header.c_str(), body.c_str());
+	string extraInfoString = createExtraInfoString();
+	string header = createHeader(level, fileName, lineNumber, extraInfoString);
+	output(header, body);
+}
 
-	lock.readLock();
-	if (syslogoutputFlag) {
-		connectSyslogIfNeeded();
-		lock.unlock();
-		syslog(LOG_INFO, "%s%s", header.c_str(), body.c_str());
-	} else {
-		lock.unlock();
+void Logger::enableAsyncOutput(void)
+{
+	AsyncWriter::start();
+}
+
+void Logger::disableAsyncOutput(void)
+{
+	AsyncWriter::stop();
+}
+
+bool Logger::isAsyncOutputEnabled(void)
+{
+	return AsyncWriter::enabled.get();
+}
+
+uint64_t Logger::getNumberOfDroppedMessages(void)
+{
+	return AsyncWriter::numDropped.get();
+}
+
+void Logger::setLogLevel(LogLevel level)
+{
+	setCurrLogLevel();
+	m_currLogLevel.set(level);
+	updateLevelGeneration();
+}
+
+LogLevel Logger::getLogLevel(void)
+{
+	setCurrLogLevel();
+	return static_cast<LogLevel>(m_currLogLevel.get());
+}
+
+void Logger::setModuleLogLevel(const string &module, LogLevel level)
+{
+	Mutex &moduleLogLevelsLock = getModuleLogLevelsLock();
+	moduleLogLevelsLock.lock();
+	getModuleLogLevelMap()[module] = level;
+	moduleLogLevelsLock.unlock();
+	updateLevelGeneration();
+}
+
+void Logger::clearModuleLogLevel(const string &module)
+{
+	Mutex &moduleLogLevelsLock = getModuleLogLevelsLock();
+	moduleLogLevelsLock.lock();
+	getModuleLogLevelMap().erase(module);
+	moduleLogLevelsLock.unlock();
+	updateLevelGeneration();
+}
+
+void Logger::getModuleLogLevels(LogLevelMap &levels)
+{
+	Mutex &moduleLogLevelsLock = getModuleLogLevelsLock();
+	moduleLogLevelsLock.lock();
+	levels = getModuleLogLevelMap();
+	moduleLogLevelsLock.unlock();
+}
+
+bool Logger::parseLogLevel(const string &name, LogLevel &level)
+{
+	for (int i = 0; i < MLPL_NUM_LOG_LEVEL; i++) {
+		if (name == LogHeaders[i]) {
+			level = static_cast<LogLevel>(i);
+			return true;
+		}
 	}
+	return false;
+}
+
+const char *Logger::getLogLevelName(LogLevel level)
+{
+	if (level < 0 || level >= MLPL_NUM_LOG_LEVEL)
+		return NULL;
+	return LogHeaders[level];
+}
+
+string Logger::getModuleName(const char *fileName)
+{
+	const char *baseName = strrchr(fileName, '/');
+	baseName = baseName ? baseName + 1 : fileName;
+	const char *extension = strrchr(baseName, '.');
+	if (!extension)
+		return baseName;
+	return string(baseName, extension - baseName);
+}
+
+void Logger::setRateLimit(const uint32_t &maxMessagesPerSec)
+{
+	g_rateLimit.set(maxMessagesPerSec);
+}
+
+bool Logger::passRateLimit(LogLevel level, LogCallSite *site,
+                           const char *fileName, int lineNumber)
+{
+	const uint32_t rateLimit = g_rateLimit.get();
+	if (rateLimit == 0 || level <= MLPL_LOG_CRIT)
+		return true;
+
+	const time_t now = time(NULL);
+	const time_t windowStart = site->windowStart;
+	if (now != windowStart &&
+	    __sync_bool_compare_and_swap(&site->windowStart,
+	                                 windowStart, now)) {
+		__sync_lock_test_and_set(&site->count, 0);
+		const uint32_t suppressed =
+		  __sync_lock_test_and_set(&site->suppressed, 0);
+		if (suppressed) {
+			log(MLPL_LOG_WARN, fileName, lineNumber,
+			    "Suppressed %" PRIu32 " messages by the rate "
+			    "limit.\n", suppressed);
+		}
+	}
+	if (__sync_add_and_fetch(&site->count, 1) <= rateLimit)
+		return true;
+	__sync_add_and_fetch(&site->suppressed, 1);
+	return false;
 }
 
 // ----------------------------------------------------------------------------
@@ -87,17 +554,23 @@ void Logger::log(LogLevel level, const char *fileName, int lineNumber,
 // ----------------------------------------------------------------------------
 bool Logger::shouldLog(LogLevel level)
 {
-	bool ret = false;
-	pthread_rwlock_rdlock(&m_rwlock);
-	if (m_currLogLevel == MLPL_LOG_LEVEL_NOT_SET) {
-		pthread_rwlock_unlock(&m_rwlock);
-		setCurrLogLevel();
-		pthread_rwlock_rdlock(&m_rwlock);
+	setCurrLogLevel();
+	return level <= m_currLogLevel.get();
+}
+
+bool Logger::shouldLog(LogLevel level, LogCallSite *site,
+                       const char *fileName)
+{
+	setCurrLogLevel();
+	const uint32_t generation =
+	  m_levelGeneration.get() & LEVEL_CACHE_GENERATION_MASK;
+	uint32_t levelCache = site->levelCache;
+	if ((levelCache >> LEVEL_CACHE_LEVEL_BITS) != generation) {
+		levelCache = (generation << LEVEL_CACHE_LEVEL_BITS) |
+		             resolveLogLevel(fileName);
+		site->levelCache = levelCache;
 	}
-	if (level <= m_currLogLevel)
-		ret = true;
-	pthread_rwlock_unlock(&m_rwlock);
-	return ret;
+	return level <= static_cast<int>(levelCache & LEVEL_CACHE_LEVEL_MASK);
 }
 
 void Logger::enableSyslogOutput(void)
@@ -116,37 +589,60 @@ void Logger::disableSyslogOutput(void)
 
 void Logger::setCurrLogLevel(void)
 {
-	pthread_rwlock_wrlock(&m_rwlock);
-	if (m_currLogLevel != MLPL_LOG_LEVEL_NOT_SET) {
-		pthread_rwlock_unlock(&m_rwlock);
-		return;
-	}
+	pthread_once(&m_levelOnce, setupLogLevels);
+}
 
+void Logger::setupLogLevels(void)
+{
 	char *env = getenv(LEVEL_ENV_VAR_NAME);
 	if (!env) {
-		m_currLogLevel = MLPL_LOG_INFO;
-		pthread_rwlock_unlock(&m_rwlock);
+		m_currLogLevel.set(MLPL_LOG_INFO);
 		return;
 	}
-	string envStr = env;
-	if (envStr == "DBG")
-		m_currLogLevel = MLPL_LOG_DBG;
-	else if (envStr == "INFO")
-		m_currLogLevel = MLPL_LOG_INFO;
-	else if (envStr == "WARN")
-		m_currLogLevel = MLPL_LOG_WARN;
-	else if (envStr == "ERR")
-		m_currLogLevel = MLPL_LOG_ERR;
-	else if (envStr == "CRIT")
-		m_currLogLevel = MLPL_LOG_CRIT;
-	else if (envStr == "BUG")
-		m_currLogLevel = MLPL_LOG_BUG;
-	else {
-		log(MLPL_LOG_WARN, __FILE__, __LINE__,
-		    "Unknown level: %s\n", env);
-		m_currLogLevel = MLPL_LOG_INFO;
-	}
-	pthread_rwlock_unlock(&m_rwlock);
+
+	// e.g. "INFO,ZabbixAPI:DBG,ArmBase:WARN"
+	LogLevel defaultLevel = MLPL_LOG_INFO;
+	StringVector items;
+	StringUtils::split(items, env, ',');
+	for (size_t i = 0; i < items.size(); i++) {
+		const string &item = items[i];
+		const size_t pos = item.find(':');
+		const string levelStr =
+		  (pos == string::npos) ? item : item.substr(pos + 1);
+		LogLevel level;
+		if (!parseLogLevel(levelStr, level)) {
+			log(MLPL_LOG_WARN, __FILE__, __LINE__,
+			    "Unknown level: %s\n", item.c_str());
+			continue;
+		}
+		if (pos == string::npos)
+			defaultLevel = level;
+		else
+			setModuleLogLevel(item.substr(0, pos), level);
+	}
+	m_currLogLevel.set(defaultLevel);
+	updateLevelGeneration();
+}
+
+LogLevel Logger::resolveLogLevel(const char *fileName)
+{
+	const string module = getModuleName(fileName);
+	LogLevel level = static_cast<LogLevel>(m_currLogLevel.get());
+	Mutex &moduleLogLevelsLock = getModuleLogLevelsLock();
+	LogLevelMap &moduleLogLevels = getModuleLogLevelMap();
+	moduleLogLevelsLock.lock();
+	LogLevelMapConstIterator it = moduleLogLevels.find(module);
+	if (it != moduleLogLevels.end())
+		level = it->second;
+	moduleLogLevelsLock.unlock();
+	return level;
+}
+
+void Logger::updateLevelGeneration(void)
+{
+	// The generation 0 is reserved for a call site not resolved yet.
+	if ((m_levelGeneration.add(1) & LEVEL_CACHE_GENERATION_MASK) == 0)
+		m_levelGeneration.add(1);
 }
 
 void Logger::connectSyslogIfNeeded(void)
@@ -157,6 +653,20 @@ void Logger::connectSyslogIfNeeded(void)
 	syslogConnected = true;
 }
 
+void Logger::output(const string &header, const string &body)
+{
+	fprintf(stderr, "%s%s", header.c_str(), body.c_str());
+
+	lock.readLock();
+	if (syslogoutputFlag) {
+		connectSyslogIfNeeded();
+		lock.unlock();
+		syslog(LOG_INFO, "%s%s", header.c_str(), body.c_str());
+	} else {
+		lock.unlock();
+	}
+}
+
 string Logger::createHeader(LogLevel level, const char *fileName,
                             int lineNumber, string extraInfoString)
 {
@@ -177,6 +687,20 @@ string Logger::createExtraInfoString(void)
 	return extraInfoString;
 }
 
+string Logger::createExtraInfoString(const timespec &time,
+                                     const pid_t &threadId)
+{
+	string extraInfoString = "";
+	if (extraInfoFlag['C'])
+		addCurrentTime(extraInfoString, time);
+	if (extraInfoFlag['P'])
+		addProcessId(extraInfoString);
+	if (extraInfoFlag['T'])
+		addThreadId(extraInfoString, threadId);
+
+	return extraInfoString;
+}
+
 void Logger::setExtraInfoFlag(const char *extraInfoArg)
 {
 	if (extraInfoArg == NULL)
@@ -194,21 +718,42 @@ void Logger::addProcessId(string &extraInfoString)
 
 void Logger::addThreadId(string &extraInfoString)
 {
-	if (tid == 0)
-		tid = syscall(SYS_gettid);
-	extraInfoString += StringUtils::sprintf("T:%d ", tid);
+	addThreadId(extraInfoString, getThreadId());
+}
+
+void Logger::addThreadId(string &extraInfoString, const pid_t &threadId)
+{
+	extraInfoString += StringUtils::sprintf("T:%d ", threadId);
 }
 
 void Logger::addCurrentTime(string &extraInfoString)
 {
 	SmartTime smtime = SmartTime::getCurrTime();
-	const timespec &currTime = smtime.getAsTimespec();
+	addCurrentTime(extraInfoString, smtime.getAsTimespec());
+}
 
+void Logger::addCurrentTime(string &extraInfoString, const timespec &currTime)
+{
 	extraInfoString += StringUtils::sprintf("[%ld.%09ld] ", currTime.tv_sec,
 	                                                       currTime.tv_nsec);
 }
 
+pid_t Logger::getThreadId(void)
+{
+	if (tid == 0)
+		tid = syscall(SYS_gettid);
+	return tid;
+}
+
 void Logger::setupProcessId(void)
 {
 		pid = getpid();
 }
+
+void Logger::setupRateLimit(void)
+{
+	const char *env = getenv(RATE_LIMIT_ENV_VAR_NAME);
+	if (!env)
+		return;
+	g_rateLimit.set(atoi(env));
+}
@@ -21,8 +21,12 @@
 #define Logger_h
 
 #include <pthread.h>
+#include <stdint.h>
+#include <time.h>
 #include <string>
+#include <map>
 #include "ReadWriteLock.h"
+#include "AtomicValue.h"
 namespace mlpl {
 
 enum LogLevel {
@@ -37,18 +41,121 @@ enum LogLevel {
 	MLPL_LOG_LEVEL_NOT_SET,
 };
 
+typedef std::map<std::string, LogLevel> LogLevelMap;
+typedef LogLevelMap::iterator           LogLevelMapIterator;
+typedef LogLevelMap::const_iterator     LogLevelMapConstIterator;
+
+/**
+ * A state for each MLPL_P() call site. It has to be a POD so that it can
+ * be statically initialized in the macro.
+ *
+ * 'levelCache' holds the level for the source file in the lower 8 bits
+ * and the generation of the level settings in the upper bits. So it can
+ * be checked without a lock. It's resolved again when the settings are
+ * changed.
+ */
+struct LogCallSite {
+	uint32_t levelCache;
+	time_t   windowStart;
+	uint32_t count;
+	uint32_t suppressed;
+};
+#define MLPL_LOG_CALL_SITE_INITIALIZER {0, 0, 0, 0}
+
 class Logger {
 public:
 	static const char *LEVEL_ENV_VAR_NAME;
 	static const char *MLPL_LOGGER_FLAGS;
+	static const char *RATE_LIMIT_ENV_VAR_NAME;
 	static void log(LogLevel level,
 	                const char *fileName, int lineNumber,
 	                const char *fmt, ...)
 		__attribute__((__format__ (__printf__, 4, 5)));
 	static bool shouldLog(LogLevel level);
+	static bool shouldLog(LogLevel level, LogCallSite *site,
+	                      const char *fileName);
 	static void enableSyslogOutput(void);
 	static void disableSyslogOutput(void);
+
+	/**
+	 * Start the asynchronous output mode.
+	 *
+	 * In this mode, log() only puts the formatted message to a ring
+	 * buffer of the calling thread and returns. The header creation
+	 * and the output to stderr and syslog are done on a dedicated
+	 * writer thread. When the ring buffer is full, the message is
+	 * dropped and counted. Messages whose level is CRIT or BUG are
+	 * always written synchronously.
+	 * This mode is also enabled by 'A' in MLPL_LOGGER_FLAGS.
+	 */
+	static void enableAsyncOutput(void);
+
+	/**
+	 * Stop the asynchronous output mode. Messages in the ring buffers
+	 * are written before this function returns.
+	 */
+	static void disableAsyncOutput(void);
+
+	static bool isAsyncOutputEnabled(void);
+
+	/**
+	 * Get the number of messages dropped because a ring buffer was full.
+	 *
+	 * @return The total number since the process started.
+	 */
+	static uint64_t getNumberOfDroppedMessages(void);
+
+	/**
+	 * Set the maximum number of messages per second for each call site
+	 * of MLPL_P(). The excess messages are suppressed and the number of
+	 * them is reported when the next period begins.
+	 * Messages whose level is CRIT or BUG are never suppressed.
+	 *
+	 * @param maxMessagesPerSec
+	 * A maximum number of messages. 0 means no limit (default).
+	 * It can also be set by MLPL_LOGGER_RATE_LIMIT.
+	 */
+	static void setRateLimit(const uint32_t &maxMessagesPerSec);
+
+	static bool passRateLimit(LogLevel level, LogCallSite *site,
+	                          const char *fileName, int lineNumber);
+
+	/**
+	 * Set the level applied to the modules whose level is not set.
+	 */
+	static void setLogLevel(LogLevel level);
+	static LogLevel getLogLevel(void);
+
+	/**
+	 * Set the level of a module. The name of a module is a base name of
+	 * the source file without the extension (e.g. 'ZabbixAPI').
+	 * The levels can also be set by MLPL_LOGGER_LEVEL such as
+	 * "INFO,ZabbixAPI:DBG,ArmBase:WARN".
+	 */
+	static void setModuleLogLevel(const std::string &module,
+	                              LogLevel level);
+	static void clearModuleLogLevel(const std::string &module);
+	static void getModuleLogLevels(LogLevelMap &levels);
+
+	static bool parseLogLevel(const std::string &name, LogLevel &level);
+	static const char *getLogLevelName(LogLevel level);
+	static std::string getModuleName(const char *fileName);
 protected:
+	struct AsyncWriter;
+
+	static void output(const std::string &header, const std::string &body);
+	static std::string createExtraInfoString(const timespec &time,
+	                                         const pid_t &threadId);
+	static void addThreadId(std::string &extraInfoSrting,
+	                        const pid_t &threadId);
+	static void addCurrentTime(std::string &extraInfoSrting,
+	                           const timespec &time);
+	static pid_t getThreadId(void);
+	static void setupRateLimit(void);
+	static void setupLogLevels(void);
+	static LogLevel resolveLogLevel(const char *fileName);
+	static void updateLevelGeneration(void);
+
 	static void setCurrLogLevel(void);
 	static void connectSyslogIfNeeded(void);
 	static std::string createHeader(LogLevel level, const char *fileName,
@@ -60,8 +167,9 @@ protected:
 	static void addCurrentTime(std::string &extraInfoSrting);
 	static void setupProcessId(void);
 private:
-	static LogLevel m_currLogLevel;
-	static pthread_rwlock_t m_rwlock;
+	static AtomicValue<int> m_currLogLevel;
+	static AtomicValue<uint32_t> m_levelGeneration;
+	static pthread_once_t m_levelOnce;
 	static bool syslogoutputFlag;
 	static ReadWriteLock lock;
 	static bool syslogConnected;
@@ -72,9 +180,21 @@ private:
 
 } // namespace mlpl
 
+/*
+ * Messages whose level is lower than this are removed at compile time.
+ * It can be changed by --with-log-level-floor of the configure script.
+ */
+#ifndef MLPL_COMPILED_LOG_LEVEL
+#define MLPL_COMPILED_LOG_LEVEL mlpl::MLPL_LOG_DBG
+#endif
+
 #define MLPL_P(LOG_LV, FMT, ...) \
 do { \
-  if (mlpl::Logger::shouldLog(LOG_LV)) \
+  static mlpl::LogCallSite _mlplLogCallSite = MLPL_LOG_CALL_SITE_INITIALIZER; \
+  if ((LOG_LV) <= MLPL_COMPILED_LOG_LEVEL && \
+      mlpl::Logger::shouldLog(LOG_LV, &_mlplLogCallSite, __FILE__) && \
+      mlpl::Logger::passRateLimit(LOG_LV, &_mlplLogCallSite, \
+                                  __FILE__, __LINE__)) \
     mlpl::Logger::log(LOG_LV, __FILE__, __LINE__, FMT, ##__VA_ARGS__); \
 } while (0)
 
@@ -46,6 +46,12 @@ int main(int argc, char **argv)
 		MLPL_CRIT("%s\n", testString);
 	else if (level == "BUG")
 		MLPL_BUG("%s\n", testString);
+	else if (level == "ORDER") {
+		// A long message and a critical one are written synchronously.
+		MLPL_INFO("%s\n", testString);
+		MLPL_INFO("%s\n", string(testLongStringLength, 'x').c_str());
+		MLPL_CRIT("%s\n", testString);
+	}
 	else {
 		fprintf(stderr, "unknown level: %s\n", level.c_str());
 		return EXIT_FAILURE;
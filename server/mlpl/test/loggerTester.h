@@ -21,5 +21,7 @@
 #define loggerTester_h
 
 const static char *testString  = "Logger_Test_Message.";
+// Longer than a record of the ring buffer for the asynchronous output
+const static size_t testLongStringLength = 1024;
 
 #endif // loggerTester_h
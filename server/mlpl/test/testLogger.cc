@@ -334,6 +334,8 @@ static void _assertAddCurrentTime(void)
 
 void cut_teardown(void)
 {
+	unsetenv(Logger::MLPL_LOGGER_FLAGS);
+	Logger::setRateLimit(0);
 	if (g_standardOutput) {
 		g_free(g_standardOutput);
 		g_standardOutput = NULL;
@@ -476,4 +478,64 @@ void test_addCurrentTime(void)
 	assertAddCurrentTime();
 }
 
+void test_asyncOutput(void)
+{
+	// The messages in the ring buffer have to be written on exit.
+	cppcut_assert_equal(0, setenv(Logger::MLPL_LOGGER_FLAGS, "A", 1));
+	assertLogOutput("INFO", "INFO", true);
+}
+
+void test_asyncOutputKeepsOrder(void)
+{
+	cppcut_assert_equal(0, setenv(Logger::MLPL_LOGGER_FLAGS, "A", 1));
+	cppcut_assert_equal(0, setenv(Logger::LEVEL_ENV_VAR_NAME, "INFO", 1));
+	const gchar *testDir = cut_get_test_directory();
+	testDir = testDir ? testDir : ".";
+	const gchar *commandPath = cut_build_path(testDir, "loggerTestee",
+						   NULL);
+	string commandLine = commandPath + string(" ORDER");
+	g_spawnRet = g_spawn_command_line_sync(commandLine.c_str(),
+	                                       &g_standardOutput,
+	                                       &g_standardError,
+	                                       &g_exitStatus, &g_error);
+	cut_trace(assertSpawnResult());
+
+	vector<string> lines = split(g_standardError, '\n');
+	const char *expectedLevels[] = {"[INFO]", "[INFO]", "[CRIT]"};
+	const size_t numExpected = G_N_ELEMENTS(expectedLevels);
+	cppcut_assert_equal(numExpected, lines.size());
+	for (size_t i = 0; i < numExpected; i++) {
+		ParsableString pstr(lines[i]);
+		cppcut_assert_equal(string(expectedLevels[i]),
+		  pstr.readWord(ParsableString::SEPARATOR_SPACE));
+	}
+	cppcut_assert_equal(
+	  true, lines[1].find(string(testLongStringLength, 'x')) !=
+	        string::npos);
+}
+
+void test_passRateLimit(void)
+{
+	LogCallSite site = MLPL_LOG_CALL_SITE_INITIALIZER;
+	Logger::setRateLimit(2);
+	cppcut_assert_equal(true,  Logger::passRateLimit(MLPL_LOG_INFO, &site,
+	                                                 __FILE__, __LINE__));
+	cppcut_assert_equal(true,  Logger::passRateLimit(MLPL_LOG_INFO, &site,
+	                                                 __FILE__, __LINE__));
+	cppcut_assert_equal(false, Logger::passRateLimit(MLPL_LOG_INFO, &site,
+	                                                 __FILE__, __LINE__));
+	cppcut_assert_equal(true,  Logger::passRateLimit(MLPL_LOG_CRIT, &site,
+	                                                 __FILE__, __LINE__));
+}
+
+void test_passRateLimitWithoutLimit(void)
+{
+	LogCallSite site = MLPL_LOG_CALL_SITE_INITIALIZER;
+	for (size_t i = 0; i < 10; i++) {
+		cppcut_assert_equal(true,
+		  Logger::passRateLimit(MLPL_LOG_INFO, &site,
+		                        __FILE__, __LINE__));
+	}
+}
+
 } // namespace testLogger
@@ -19,6 +19,7 @@
 
 #include <cstring>
 #include <deque>
+#include <algorithm>
 #include <errno.h>
 #include "ActionManager.h"
 #include "ActorCollector.h"
@@ -37,6 +38,7 @@
 #include "ChildProcessManager.h"
 #include "IncidentSenderManager.h"
 #include "ThreadLocalDBCache.h"
+#include "MetricsRegistry.h"
 
 using namespace std;
 using namespace mlpl;
@@ -101,6 +103,9 @@ struct ResidentInfo :
 	Mutex               queueLock;
 	ResidentNotifyQueue notifyQueue; // should be used with queueLock.
 	ResidentStatus      status;      // should be used with queueLock.
+	// The number of notifyInfo at the front of notifyQueue that have
+	// been sent and are waiting for the ack. (used with queueLock)
+	size_t              numNotifying;
 
 	NamedPipe pipeRd, pipeWr;
 	string pipeName;
@@ -113,6 +118,7 @@ struct ResidentInfo :
 	  pid(0),
 	  inRunningResidentMap(false),
 	  status(RESIDENT_STAT_INIT),
+	  numNotifying(0),
 	  pipeRd(NamedPipe::END_TYPE_MASTER_READ),
 	  pipeWr(NamedPipe::END_TYPE_MASTER_WRITE)
 	{
@@ -199,6 +205,17 @@ struct ResidentInfo :
 
 		delete notifyInfo;
 	}
+
+	void getNotifyingInfos(vector<ActionManager::ResidentNotifyInfo *> &vect)
+	{
+		queueLock.lock();
+		HATOHOL_ASSERT(numNotifying <= notifyQueue.size(),
+		               "numNotifying: %zd, queue: %zd\n",
+		               numNotifying, notifyQueue.size());
+		vect.assign(notifyQueue.begin(),
+		            notifyQueue.begin() + numNotifying);
+		queueLock.unlock();
+	}
 };
 
 Mutex              ResidentInfo::residentMapLock;
@@ -520,6 +537,11 @@ static bool shouldSkipIncidentSender(
 
 void ActionManager::checkEvents(const EventInfoList &eventList)
 {
+	static MetricCounter &numCheckedEvents =
+	  MetricsRegistry::getInstance()->getCounter(
+	    "hatohol_action_checked_events_total",
+	    "The number of events checked if they trigger actions");
+	numCheckedEvents.add(eventList.size());
 	ThreadLocalDBCache cache;
 	DBTablesAction &dbAction = cache.getAction();
 	EventInfoListConstIterator it = eventList.begin();
@@ -612,11 +634,25 @@ HatoholError ActionManager::runAction(const ActionDef &actionDef,
 	if (!checkActionOwner(actionDef))
 		return HTERR_INVALID_USER;
 
+	static const char *METRIC_NAME = "hatohol_actions_total";
+	static const char *METRIC_HELP = "The number of executed actions";
+	MetricsRegistry *metrics = MetricsRegistry::getInstance();
+	static MetricCounter &numCommandActions =
+	  metrics->getCounter(METRIC_NAME, METRIC_HELP, "type=\"command\"");
+	static MetricCounter &numResidentActions =
+	  metrics->getCounter(METRIC_NAME, METRIC_HELP, "type=\"resident\"");
+	static MetricCounter &numIncidentSenderActions =
+	  metrics->getCounter(METRIC_NAME, METRIC_HELP,
+	                      "type=\"incident_sender\"");
+
 	if (actionDef.type == ACTION_COMMAND) {
+		numCommandActions.add();
 		execCommandAction(actionDef, eventInfo, dbAction);
 	} else if (actionDef.type == ACTION_RESIDENT) {
+		numResidentActions.add();
 		execResidentAction(actionDef, eventInfo, dbAction);
 	} else if (actionDef.type == ACTION_INCIDENT_SENDER) {
+		numIncidentSenderActions.add();
 		execIncidentSenderAction(actionDef, eventInfo, dbAction);
 	} else {
 		HATOHOL_ASSERT(true, "Unknown type: %d\n", actionDef.type);
@@ -1040,9 +1076,10 @@ void ActionManager::moduleLoadedCb(GIOStatus stat, SmartBuffer &sbuf,
  * - The default GLIB event dispacther thread (main)
  *     [callback registered by pullData()]
  */
-void ActionManager::gotNotifyEventAckCb(GIOStatus stat, SmartBuffer &sbuf,
-                                        size_t size,
-                                        ResidentNotifyInfo *notifyInfo)
+void ActionManager::gotNotifyEventAckHeaderCb(GIOStatus stat,
+                                              SmartBuffer &sbuf,
+                                              size_t size,
+                                              ResidentNotifyInfo *notifyInfo)
 {
 	ResidentInfo *residentInfo = notifyInfo->residentInfo;
 	ActionManager *obj = residentInfo->actionManager;
@@ -1053,31 +1090,79 @@ void ActionManager::gotNotifyEventAckCb(GIOStatus stat, SmartBuffer &sbuf,
 	}
 
 	int pktType = ResidentCommunicator::getPacketType(sbuf);
-	if (pktType != RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_ACK) {
+	if (pktType != RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENTS_ACK) {
 		MLPL_ERR("Unexpected packet: %d\n", pktType);
 		obj->closeResident(notifyInfo,
 		                   ACTLOG_EXECFAIL_PIPE_READ_DATA_UNEXPECTED);
 		return;
 	}
 
-	// get the result code
+	// check the body length
+	vector<ResidentNotifyInfo *> notifyingInfos;
+	residentInfo->getNotifyingInfos(notifyingInfos);
+	const size_t expectedBodyLen =
+	  RESIDENT_PROTO_NOTIFY_EVENTS_NUM_LEN +
+	  RESIDENT_PROTO_EVENT_ACK_CODE_LEN * notifyingInfos.size();
 	sbuf.resetIndex();
-	sbuf.incIndex(RESIDENT_PROTO_HEADER_LEN);
-	uint32_t resultCode = *sbuf.getPointer<uint32_t>();
+	uint32_t bodyLen = *sbuf.getPointer<uint32_t>();
+	if (bodyLen != expectedBodyLen) {
+		MLPL_ERR("Invalid body length: %" PRIu32 ", expect: %zd\n",
+		         bodyLen, expectedBodyLen);
+		obj->closeResident(notifyInfo,
+		                   ACTLOG_EXECFAIL_PIPE_READ_DATA_UNEXPECTED);
+		return;
+	}
+	residentInfo->pullData(bodyLen, gotNotifyEventAckCb);
+}
 
-	// log the end of action
-	HATOHOL_ASSERT(notifyInfo->logId != INVALID_ACTION_LOG_ID,
-	               "log ID: %" PRIx64, notifyInfo->logId);
-	DBTablesAction::LogEndExecActionArg logArg;
-	logArg.logId = notifyInfo->logId;
-	logArg.status = ACTLOG_STAT_SUCCEEDED,
-	logArg.exitCode = resultCode;
+/*
+ * executed on the following thread(s)
+ * - The default GLIB event dispacther thread (main)
+ *     [callback registered by pullData()]
+ */
+void ActionManager::gotNotifyEventAckCb(GIOStatus stat, SmartBuffer &sbuf,
+                                        size_t size,
+                                        ResidentNotifyInfo *notifyInfo)
+{
+	ResidentInfo *residentInfo = notifyInfo->residentInfo;
+	ActionManager *obj = residentInfo->actionManager;
+	if (stat != G_IO_STATUS_NORMAL) {
+		MLPL_ERR("Error: status: %x\n", stat);
+		obj->closeResident(notifyInfo, ACTLOG_EXECFAIL_PIPE_READ_ERR);
+		return;
+	}
 
+	vector<ResidentNotifyInfo *> notifyingInfos;
+	residentInfo->getNotifyingInfos(notifyingInfos);
+	uint32_t numCodes = sbuf.getValueAndIncIndex<uint32_t>();
+	if (numCodes != notifyingInfos.size()) {
+		MLPL_ERR("Unexpected number of result codes: %" PRIu32 ", "
+		         "expect: %zd\n", numCodes, notifyingInfos.size());
+		obj->closeResident(notifyInfo,
+		                   ACTLOG_EXECFAIL_PIPE_READ_DATA_UNEXPECTED);
+		return;
+	}
+
+	// log the end of actions
 	ThreadLocalDBCache cache;
-	cache.getAction().logEndExecAction(logArg);
+	DBTablesAction &dbAction = cache.getAction();
+	for (size_t i = 0; i < notifyingInfos.size(); i++) {
+		ResidentNotifyInfo *info = notifyingInfos[i];
+		HATOHOL_ASSERT(info->logId != INVALID_ACTION_LOG_ID,
+		               "log ID: %" PRIx64, info->logId);
+		DBTablesAction::LogEndExecActionArg logArg;
+		logArg.logId = info->logId;
+		logArg.status = ACTLOG_STAT_SUCCEEDED,
+		logArg.exitCode = sbuf.getValueAndIncIndex<uint32_t>();
+		dbAction.logEndExecAction(logArg);
+	}
 
 	// remove the notifyInfo 
-	residentInfo->deleteFrontNotifyInfo();
+	residentInfo->queueLock.lock();
+	residentInfo->numNotifying = 0;
+	residentInfo->queueLock.unlock();
+	for (size_t i = 0; i < notifyingInfos.size(); i++)
+		residentInfo->deleteFrontNotifyInfo();
 
 	// send the next notificaiton if it exists
 	residentInfo->setStatus(RESIDENT_STAT_IDLE);
@@ -1258,47 +1343,58 @@ ResidentInfo *ActionManager::launchResidentActionYard
 void ActionManager::tryNotifyEvent(ResidentInfo *residentInfo)
 {
 	residentInfo->queueLock.lock();
-	ResidentNotifyInfo *notifyInfo = NULL;
+	vector<ResidentNotifyInfo *> notifyInfos;
 	if (residentInfo->status != RESIDENT_STAT_IDLE) {
 		residentInfo->queueLock.unlock();
 		return;
 	}
-	if (!residentInfo->notifyQueue.empty()) {
-		notifyInfo = residentInfo->notifyQueue.front();
+	ResidentNotifyQueueIterator it = residentInfo->notifyQueue.begin();
+	for (; it != residentInfo->notifyQueue.end(); ++it) {
+		if (notifyInfos.size() >= RESIDENT_PROTO_NOTIFY_EVENTS_MAX_NUM)
+			break;
+		notifyInfos.push_back(*it);
+	}
+	if (!notifyInfos.empty()) {
+		residentInfo->numNotifying = notifyInfos.size();
 		residentInfo->status = RESIDENT_STAT_WAIT_NOTIFY_ACK;
 	}
 	residentInfo->queueLock.unlock();
-	if (notifyInfo)
-		notifyEvent(residentInfo, notifyInfo);
+	if (!notifyInfos.empty())
+		notifyEvents(residentInfo, notifyInfos);
 }
 
 /*
  * executed on the following thread(s)
  * - Threads that call checkEvents()
- *     [from notifyEvent()]
+ *     [from tryNotifyEvent()]
  * - The default GLIB event dispacther thread (main)
- *     [from notifyEvent()]
+ *     [from tryNotifyEvent()]
  */
-void ActionManager::notifyEvent(ResidentInfo *residentInfo,
-                                ResidentNotifyInfo *notifyInfo)
+void ActionManager::notifyEvents(
+  ResidentInfo *residentInfo,
+  const vector<ResidentNotifyInfo *> &notifyInfos)
 {
 	ResidentCommunicator comm;
-	comm.setNotifyEventBody(residentInfo->actionDef.id,
-	                        notifyInfo->eventInfo,
-	                        notifyInfo->sessionId);
+	comm.setNotifyEventsHeader(notifyInfos.size());
+	for (size_t i = 0; i < notifyInfos.size(); i++) {
+		comm.addNotifyEventBody(residentInfo->actionDef.id,
+		                        notifyInfos[i]->eventInfo,
+		                        notifyInfos[i]->sessionId);
+	}
 	comm.push(residentInfo->pipeWr);
 
-	// wait for result code
-	residentInfo->setPullCallbackArg(notifyInfo);
-	residentInfo->pullData(RESIDENT_PROTO_HEADER_LEN +
-	                       RESIDENT_PROTO_EVENT_ACK_CODE_LEN,
-	                       gotNotifyEventAckCb);
+	// wait for result codes
+	residentInfo->setPullCallbackArg(notifyInfos[0]);
+	residentInfo->pullHeader(gotNotifyEventAckHeaderCb);
 
-	// create or update an action log
-	HATOHOL_ASSERT(notifyInfo->logId != INVALID_ACTION_LOG_ID,
-	               "An action log ID is not set.");
+	// create or update action logs
 	ThreadLocalDBCache cache;
-	cache.getAction().updateLogStatusToStart(notifyInfo->logId);
+	DBTablesAction &dbAction = cache.getAction();
+	for (size_t i = 0; i < notifyInfos.size(); i++) {
+		HATOHOL_ASSERT(notifyInfos[i]->logId != INVALID_ACTION_LOG_ID,
+		               "An action log ID is not set.");
+		dbAction.updateLogStatusToStart(notifyInfos[i]->logId);
+	}
 }
 
 /*
@@ -1489,16 +1585,27 @@ void ActionManager::closeResident(ResidentInfo *residentInfo)
 void ActionManager::closeResident(ResidentNotifyInfo *notifyInfo,
                                   ActionLogExecFailureCode failureCode)
 {
-	DBTablesAction::LogEndExecActionArg logArg;
-	logArg.logId = notifyInfo->logId;
-	logArg.status = ACTLOG_STAT_FAILED;
-	logArg.failureCode = failureCode;
-	logArg.exitCode = 0;
+	// Other events sent in the same packet as notifyInfo also fail.
+	ResidentInfo *residentInfo = notifyInfo->residentInfo;
+	vector<ResidentNotifyInfo *> notifyInfos;
+	residentInfo->getNotifyingInfos(notifyInfos);
+	if (find(notifyInfos.begin(), notifyInfos.end(), notifyInfo) ==
+	    notifyInfos.end()) {
+		notifyInfos.push_back(notifyInfo);
+	}
+
 	ThreadLocalDBCache cache;
-	cache.getAction().logEndExecAction(logArg);
+	DBTablesAction &dbAction = cache.getAction();
+	for (size_t i = 0; i < notifyInfos.size(); i++) {
+		DBTablesAction::LogEndExecActionArg logArg;
+		logArg.logId = notifyInfos[i]->logId;
+		logArg.status = ACTLOG_STAT_FAILED;
+		logArg.failureCode = failureCode;
+		logArg.exitCode = 0;
+		dbAction.logEndExecAction(logArg);
+	}
 
 	// remove this notifyInfo from the queue in the parent ResidentInfo
-	ResidentInfo *residentInfo = notifyInfo->residentInfo;
 	pid_t pid = residentInfo->pid;
 	ActorCollector::setDontLog(pid);
 	// NOTE: Hereafter we cannot access 'notifyInfo', because it is
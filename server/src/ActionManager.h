@@ -21,6 +21,7 @@
 #define ActionManager_h
 
 #include <memory>
+#include <vector>
 #include "Params.h"
 #include "SmartBuffer.h"
 #include "DBTablesAction.h"
@@ -96,6 +97,10 @@ protected:
 	                       size_t size, ResidentNotifyInfo *notifyInfo);
 	static void moduleLoadedCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
 	                           size_t size, ResidentNotifyInfo *notifyInfo);
+	static void gotNotifyEventAckHeaderCb(GIOStatus stat,
+	                                      mlpl::SmartBuffer &sbuf,
+	                                      size_t size,
+	                                      ResidentNotifyInfo *notifyInfo);
 	static void gotNotifyEventAckCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
 	                                size_t size,
 	                                ResidentNotifyInfo *residentInfo);
@@ -194,28 +199,30 @@ protected:
 	                                       DBTablesAction &dbAction,
 	                                       ActorInfo *actorInfoCopy);
 	/**
-	 * notify hatohol-resident-yard of an event only when it is idle and
+	 * notify hatohol-resident-yard of events only when it is idle and
 	 * there is at least one element in residentInfo->notifyQueue.
 	 * Othewise the request is processed later.
+	 * Up to RESIDENT_PROTO_NOTIFY_EVENTS_MAX_NUM events at the top of
+	 * the queue are sent in one packet.
 	 *
 	 * @param residentInfo A residentInfo instance.
 	 */
 	void tryNotifyEvent(ResidentInfo *residentInfo);
 
 	/**
-	 * notify hatohol-resident-yard of an event at the top of notifyQueue.
+	 * notify hatohol-resident-yard of events at the top of notifyQueue
+	 * with a single NOTIFY_EVENTS packet.
 	 * NOTE: This function is assumed to be called only from
 	 * tryNotifyEvent().
 	 *
 	 * @param residentInfo A residentInfo instance.
 	 *
-	 * @param notifyInfo.
-	 * A ResidentNotifyInfo instance. If the member: logId is
-	 * INVALID_ACTION_LOG_ID, the new log record is created.
-	 * Otherwise the record with it will be updated.
+	 * @param notifyInfos.
+	 * ResidentNotifyInfo instances at the top of the queue. The member:
+	 * logId of each instance must be a valid log ID.
 	 */
-	void notifyEvent(ResidentInfo *residentInfo,
-	                 ResidentNotifyInfo *notifyInfo);
+	void notifyEvents(ResidentInfo *residentInfo,
+	                  const std::vector<ResidentNotifyInfo *> &notifyInfos);
 
 	void execIncidentSenderAction(const ActionDef &actionDef,
 				      const EventInfo &eventInfo,
@@ -21,6 +21,7 @@
 #include <semaphore.h>
 #include <errno.h>
 #include <queue>
+#include <algorithm>
 #include <Logger.h>
 #include <AtomicValue.h>
 #include "ArmBase.h"
@@ -28,12 +29,42 @@
 #include "DBTablesMonitoring.h"
 #include "UnifiedDataStore.h"
 #include "ThreadLocalDBCache.h"
+#include "MetricsRegistry.h"
+#include "ArmScheduler.h"
+#include "ConfigManager.h"
 
 using namespace std;
 using namespace mlpl;
 
 const char *SERVER_SELF_MONITORING_SUFFIX = "_SELF";
 
+// The adaptive polling interval is kept within 1/N to N times of the
+// configured one.
+static const int ADAPTIVE_POLLING_RANGE = 4;
+
+static int calcAdaptivePollingInterval(
+  const int &baseSec, const int &currSec,
+  const size_t &numEvents, const size_t &durationMSec)
+{
+	const int ceilingSec = baseSec * ADAPTIVE_POLLING_RANGE;
+	int floorSec = max(baseSec / ADAPTIVE_POLLING_RANGE, 1);
+	// Don't spend more than a half of the time in the polling.
+	const int busyFloorSec = (durationMSec * 2 + 999) / 1000;
+	if (floorSec < busyFloorSec)
+		floorSec = min(busyFloorSec, ceilingSec);
+
+	int nextSec;
+	if (numEvents > 0)
+		nextSec = currSec / 2;
+	else
+		nextSec = currSec + max(currSec / 2, 1);
+	if (nextSec < floorSec)
+		nextSec = floorSec;
+	else if (nextSec > ceilingSec)
+		nextSec = ceilingSec;
+	return nextSec;
+}
+
 typedef enum {
 	UPDATE_POLLING,
 	UPDATE_ITEM_REQUEST,
@@ -46,12 +77,13 @@ struct FetcherJob
 	ClosureBase *closure;
 
 	struct HistoryQuery {
-		ItemInfo itemInfo;
+		ItemInfoList itemInfoList;
 		time_t beginTime;
 		time_t endTime;
-		HistoryQuery(const ItemInfo _itemInfo,
+		HistoryQuery(const ItemInfoList &_itemInfoList,
 			     const time_t &_beginTime, const time_t &_endTime)
-		: itemInfo(_itemInfo), beginTime(_beginTime), endTime(_endTime)
+		: itemInfoList(_itemInfoList),
+		  beginTime(_beginTime), endTime(_endTime)
 		{
 		}
 	} *historyQuery;
@@ -63,10 +95,10 @@ struct FetcherJob
 	}
 
 	FetcherJob(Closure1<HistoryInfoVect> *_closure,
-		   const ItemInfo &_itemInfo,
+		   const ItemInfoList &_itemInfoList,
 		   const time_t &_beginTime, const time_t &_endTime)
 	: updateType(UPDATE_HISTORY_REQUEST), closure(_closure),
-	  historyQuery(new HistoryQuery(_itemInfo, _beginTime, _endTime))
+	  historyQuery(new HistoryQuery(_itemInfoList, _beginTime, _endTime))
 	{
 	}
 
@@ -103,8 +135,9 @@ struct FetcherJob
 	}
 };
 
-struct ArmBase::Impl
+struct ArmBase::Impl : public ArmScheduler::Task
 {
+	ArmBase             *arm;
 	string               name;
 	MonitoringServerInfo serverInfo; // we have the copy.
 	timespec             lastPollingTime;
@@ -116,16 +149,40 @@ struct ArmBase::Impl
 	string               lastFailureComment;
 	ArmWorkingStatus     lastFailureStatus;
 	queue<FetcherJob *>  jobQueue;
+	ArmWorkingStatus     previousArmWorkStatus;
+	int                  currPollingIntervalSec;
+	size_t               numPolledEvents;
+	MetricHistogram     &cycleDuration;
+	MetricCounter       &numFailures;
+
+	// Used only when the arm runs on ArmScheduler
+	ArmScheduler        *scheduler;
+	bool                 pollingPrepared;
+	bool                 exitCallbackDone;
 
 	ArmResultTriggerInfo ArmResultTriggerTable[NUM_COLLECT_NG_KIND];
 
-	Impl(const string &_name,
+	Impl(ArmBase *_arm, const string &_name,
 	               const MonitoringServerInfo &_serverInfo)
-	: name(_name),
+	: arm(_arm),
+	  name(_name),
 	  serverInfo(_serverInfo),
 	  exitRequest(false),
 	  isCopyOnDemandEnabled(false),
-	  lastFailureStatus(ARM_WORK_STAT_FAILURE)
+	  lastFailureStatus(ARM_WORK_STAT_FAILURE),
+	  previousArmWorkStatus(ARM_WORK_STAT_INIT),
+	  currPollingIntervalSec(_serverInfo.pollingIntervalSec),
+	  numPolledEvents(0),
+	  cycleDuration(MetricsRegistry::getInstance()->getHistogram(
+	    "hatohol_arm_cycle_duration_seconds",
+	    "Time of a polling or fetch cycle of an arm",
+	    MetricsRegistry::UNIT_MICRO_SEC, getMetricLabels())),
+	  numFailures(MetricsRegistry::getInstance()->getCounter(
+	    "hatohol_arm_cycle_failures_total",
+	    "The number of failed cycles of an arm", getMetricLabels())),
+	  scheduler(NULL),
+	  pollingPrepared(false),
+	  exitCallbackDone(false)
 	{
 		static const int PSHARED = 1;
 		HATOHOL_ASSERT(sem_init(&sleepSemaphore, PSHARED, 0) == 0,
@@ -141,6 +198,40 @@ struct ArmBase::Impl
 			MLPL_ERR("Failed to call sem_destroy(): %d\n", errno);
 	}
 
+	string getMetricLabels(void) const
+	{
+		return StringUtils::sprintf(
+		  "server_id=\"%" FMT_SERVER_ID "\"", serverInfo.id);
+	}
+
+	virtual int runOnce(void) override
+	{
+		if (!pollingPrepared) {
+			arm->prepareForPolling();
+			pollingPrepared = true;
+		}
+		if (arm->hasExitRequest())
+			return ArmScheduler::FINISHED;
+		const int sleepTime = arm->runOneCycle();
+		if (arm->hasExitRequest())
+			return ArmScheduler::FINISHED;
+		// A wake-up for the requests pushed during the run is merged
+		// into one. Run the rest without waiting for the interval.
+		if (!isJobQueueEmpty())
+			return 0;
+		return sleepTime;
+	}
+
+	void wakeUp(void)
+	{
+		if (scheduler) {
+			scheduler->wakeUp(this);
+			return;
+		}
+		if (sem_post(&sleepSemaphore) == -1)
+			MLPL_ERR("Failed to call sem_post: %d\n", errno);
+	}
+
 	void stampLastPollingTime(void)
 	{
 		int result = clock_gettime(CLOCK_REALTIME,
@@ -156,9 +247,23 @@ struct ArmBase::Impl
 		}
 	}
 
+	void updatePollingInterval(const size_t &durationMSec)
+	{
+		const int baseSec = serverInfo.pollingIntervalSec;
+		if (ConfigManager::getInstance()->isAdaptivePollingEnabled()) {
+			currPollingIntervalSec = calcAdaptivePollingInterval(
+			  baseSec, currPollingIntervalSec, numPolledEvents,
+			  durationMSec);
+		} else {
+			currPollingIntervalSec = baseSec;
+		}
+		armStatus.setPollingStatistics(currPollingIntervalSec,
+		                               numPolledEvents, durationMSec);
+	}
+
 	int getSecondsToNextPolling(void)
 	{
-		time_t interval = serverInfo.pollingIntervalSec;
+		time_t interval = currPollingIntervalSec;
 		timespec currentTime;
 
 		int result = clock_gettime(CLOCK_REALTIME, &currentTime);
@@ -169,8 +274,8 @@ struct ArmBase::Impl
 				interval -= elapsed;
 		}
 
-		if (interval <= 0 || interval > serverInfo.pollingIntervalSec)
-			interval = serverInfo.pollingIntervalSec;
+		if (interval <= 0 || interval > currPollingIntervalSec)
+			interval = currPollingIntervalSec;
 
 		return interval;
 	}
@@ -194,6 +299,14 @@ struct ArmBase::Impl
 		return job;
 	}
 
+	bool isJobQueueEmpty(void)
+	{
+		rwlock.readLock();
+		const bool empty = jobQueue.empty();
+		rwlock.unlock();
+		return empty;
+	}
+
 	void clearJob(void)
 	{
 		rwlock.writeLock();
@@ -223,7 +336,7 @@ struct ArmBase::Impl
 // ---------------------------------------------------------------------------
 ArmBase::ArmBase(
   const string &name, const MonitoringServerInfo &serverInfo)
-: m_impl(new Impl(name, serverInfo))
+: m_impl(new Impl(this, name, serverInfo))
 {
 	m_impl->setInitialTriggerTable();
 }
@@ -237,16 +350,37 @@ ArmBase::~ArmBase()
 
 void ArmBase::start(void)
 {
-	HatoholThreadBase::start();
+	if (ConfigManager::getInstance()->getNumberOfArmSchedulerWorkers()) {
+		m_impl->scheduler = ArmScheduler::getInstance();
+		m_impl->scheduler->add(m_impl.get(), getPollingInterval(),
+		                       m_impl->getMetricLabels());
+	} else {
+		HatoholThreadBase::start();
+	}
 	m_impl->armStatus.setRunningStatus(true);
 }
 
 void ArmBase::waitExit(void)
 {
-	HatoholThreadBase::waitExit();
+	if (m_impl->scheduler) {
+		m_impl->scheduler->waitForFinish(m_impl.get());
+		if (!m_impl->exitCallbackDone) {
+			doExitCallback();
+			m_impl->exitCallbackDone = true;
+		}
+	} else {
+		HatoholThreadBase::waitExit();
+	}
 	m_impl->armStatus.setRunningStatus(false);
 }
 
+bool ArmBase::isStarted(void) const
+{
+	if (m_impl->scheduler)
+		return m_impl->armStatus.getArmInfo().running;
+	return HatoholThreadBase::isStarted();
+}
+
 bool ArmBase::isFetchItemsSupported(void) const
 {
 	return true;
@@ -255,8 +389,7 @@ bool ArmBase::isFetchItemsSupported(void) const
 void ArmBase::fetchItems(Closure0 *closure)
 {
 	m_impl->pushJob(new FetcherJob(closure));
-	if (sem_post(&m_impl->sleepSemaphore) == -1)
-		MLPL_ERR("Failed to call sem_post: %d\n", errno);
+	m_impl->wakeUp();
 }
 
 void ArmBase::fetchHistory(const ItemInfo &itemInfo,
@@ -264,14 +397,25 @@ void ArmBase::fetchHistory(const ItemInfo &itemInfo,
 			   const time_t &endTime,
 			   Closure1<HistoryInfoVect> *closure)
 {
-	m_impl->pushJob(new FetcherJob(closure, itemInfo, beginTime, endTime));
-	if (sem_post(&m_impl->sleepSemaphore) == -1)
-		MLPL_ERR("Failed to call sem_post: %d\n", errno);
+	ItemInfoList itemInfoList;
+	itemInfoList.push_back(itemInfo);
+	fetchHistory(itemInfoList, beginTime, endTime, closure);
+}
+
+void ArmBase::fetchHistory(const ItemInfoList &itemInfoList,
+			   const time_t &beginTime,
+			   const time_t &endTime,
+			   Closure1<HistoryInfoVect> *closure)
+{
+	m_impl->pushJob(
+	  new FetcherJob(closure, itemInfoList, beginTime, endTime));
+	m_impl->wakeUp();
 }
 
 void ArmBase::setPollingInterval(int sec)
 {
 	m_impl->serverInfo.pollingIntervalSec = sec;
+	m_impl->currPollingIntervalSec = sec;
 }
 
 int ArmBase::getPollingInterval(void) const
@@ -314,8 +458,7 @@ void ArmBase::requestExit(void)
 	m_impl->exitRequest = true;
 
 	// to return immediately from the waiting.
-	if (sem_post(&m_impl->sleepSemaphore) == -1)
-		MLPL_ERR("Failed to call sem_post: %d\n", errno);
+	m_impl->wakeUp();
 }
 
 const MonitoringServerInfo &ArmBase::getServerInfo(void) const
@@ -484,68 +627,18 @@ void ArmBase::setServerConnectStatus(const ArmPollingResult &type)
 		}
 	}
 
-	if (!triggerInfoList.empty()) {
-		ThreadLocalDBCache cache;
-		cache.getMonitoring().addTriggerInfoList(triggerInfoList);
-	}
-	if (!eventInfoList.empty()) {
-		UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
+	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
+	if (!triggerInfoList.empty())
+		dataStore->addTriggerList(triggerInfoList);
+	if (!eventInfoList.empty())
 		dataStore->addEventList(eventInfoList);
-	}
 }
 
 gpointer ArmBase::mainThread(HatoholThreadArg *arg)
 {
-	ArmWorkingStatus previousArmWorkStatus = ARM_WORK_STAT_INIT;
+	prepareForPolling();
 	while (!hasExitRequest()) {
-		FetcherJob *job = m_impl->popJob();
-		UpdateType updateType = job ? job->updateType : UPDATE_POLLING;
-		int sleepTime = m_impl->getSecondsToNextPolling();
-
-		ArmPollingResult armPollingResult;
-		if (updateType == UPDATE_ITEM_REQUEST) {
-			HATOHOL_ASSERT(job, "Invalid FetcherJob");
-			armPollingResult = mainThreadOneProcFetchItems();
-			job->run();
-		} else if (updateType == UPDATE_HISTORY_REQUEST) {
-			HATOHOL_ASSERT(job && job->historyQuery,
-				       "Invalid FetcherJob");
-			HistoryInfoVect historyInfoVect;
-			FetcherJob::HistoryQuery &query = *job->historyQuery;
-			armPollingResult =
-			  mainThreadOneProcFetchHistory(
-			    historyInfoVect, query.itemInfo,
-			    query.beginTime, query.endTime);
-			job->run(historyInfoVect);
-		} else {
-			armPollingResult = mainThreadOneProc();
-		}
-		delete job;
-
-		if (armPollingResult == COLLECT_OK) {
-			m_impl->armStatus.logSuccess();
-			m_impl->lastFailureStatus = ARM_WORK_STAT_OK;
-		} else {
-			sleepTime = getRetryInterval();
-			m_impl->armStatus.logFailure(m_impl->lastFailureComment,
-			                            m_impl->lastFailureStatus);
-			m_impl->lastFailureComment.clear();
-			m_impl->lastFailureStatus = ARM_WORK_STAT_FAILURE;
-		}
-		if (previousArmWorkStatus == ARM_WORK_STAT_INIT) {
-			setInitialTrrigerStatus();
-		}
-		if (m_impl->lastFailureStatus != ARM_WORK_STAT_OK) {
-			setServerConnectStatus(armPollingResult);
-		} else {
-			if (previousArmWorkStatus != m_impl->lastFailureStatus)
-				setServerConnectStatus(armPollingResult);
-		}
-		previousArmWorkStatus = m_impl->lastFailureStatus;
-
-		if (updateType == UPDATE_POLLING)
-			m_impl->stampLastPollingTime();
-
+		int sleepTime = runOneCycle();
 		if (hasExitRequest())
 			break;
 		sleepInterruptible(sleepTime);
@@ -553,6 +646,76 @@ gpointer ArmBase::mainThread(HatoholThreadArg *arg)
 	return NULL;
 }
 
+void ArmBase::prepareForPolling(void)
+{
+}
+
+int ArmBase::runOneCycle(void)
+{
+	FetcherJob *job = m_impl->popJob();
+	UpdateType updateType = job ? job->updateType : UPDATE_POLLING;
+	int sleepTime = m_impl->getSecondsToNextPolling();
+
+	ArmPollingResult armPollingResult;
+	m_impl->numPolledEvents = 0;
+	const SmartTime startTime(SmartTime::INIT_CURR_TIME);
+	MetricTimer timer(m_impl->cycleDuration);
+	if (updateType == UPDATE_ITEM_REQUEST) {
+		HATOHOL_ASSERT(job, "Invalid FetcherJob");
+		armPollingResult = mainThreadOneProcFetchItems();
+		job->run();
+	} else if (updateType == UPDATE_HISTORY_REQUEST) {
+		HATOHOL_ASSERT(job && job->historyQuery,
+			       "Invalid FetcherJob");
+		HistoryInfoVect historyInfoVect;
+		FetcherJob::HistoryQuery &query = *job->historyQuery;
+		armPollingResult =
+		  mainThreadOneProcFetchHistories(
+		    historyInfoVect, query.itemInfoList,
+		    query.beginTime, query.endTime);
+		job->run(historyInfoVect);
+	} else {
+		armPollingResult = mainThreadOneProc();
+	}
+	timer.stop();
+	delete job;
+
+	if (armPollingResult == COLLECT_OK) {
+		m_impl->armStatus.logSuccess();
+		m_impl->lastFailureStatus = ARM_WORK_STAT_OK;
+	} else {
+		m_impl->numFailures.add();
+		sleepTime = getRetryInterval();
+		m_impl->armStatus.logFailure(m_impl->lastFailureComment,
+		                            m_impl->lastFailureStatus);
+		m_impl->lastFailureComment.clear();
+		m_impl->lastFailureStatus = ARM_WORK_STAT_FAILURE;
+	}
+	if (m_impl->previousArmWorkStatus == ARM_WORK_STAT_INIT) {
+		setInitialTrrigerStatus();
+	}
+	if (m_impl->lastFailureStatus != ARM_WORK_STAT_OK) {
+		setServerConnectStatus(armPollingResult);
+	} else {
+		if (m_impl->previousArmWorkStatus != m_impl->lastFailureStatus)
+			setServerConnectStatus(armPollingResult);
+	}
+	m_impl->previousArmWorkStatus = m_impl->lastFailureStatus;
+
+	if (updateType == UPDATE_POLLING)
+		m_impl->stampLastPollingTime();
+
+	if (updateType == UPDATE_POLLING && armPollingResult == COLLECT_OK) {
+		SmartTime duration(SmartTime::INIT_CURR_TIME);
+		duration -= startTime;
+		m_impl->updatePollingInterval(duration.getAsMSec());
+		if (ConfigManager::getInstance()->isAdaptivePollingEnabled())
+			sleepTime = m_impl->currPollingIntervalSec;
+	}
+
+	return sleepTime;
+}
+
 ArmBase::ArmPollingResult ArmBase::mainThreadOneProcFetchItems(void)
 {
 	return COLLECT_OK;
@@ -565,6 +728,26 @@ ArmBase::ArmPollingResult ArmBase::mainThreadOneProcFetchHistory(
 	return COLLECT_OK;
 }
 
+ArmBase::ArmPollingResult ArmBase::mainThreadOneProcFetchHistories(
+  HistoryInfoVect &historyInfoVect, const ItemInfoList &itemInfoList,
+  const time_t &beginTime, const time_t &endTime)
+{
+	ItemInfoListConstIterator it = itemInfoList.begin();
+	for (; it != itemInfoList.end(); ++it) {
+		const ArmPollingResult result =
+		  mainThreadOneProcFetchHistory(historyInfoVect, *it,
+		                                beginTime, endTime);
+		if (result != COLLECT_OK)
+			return result;
+	}
+	return COLLECT_OK;
+}
+
+void ArmBase::countPolledEvents(const size_t &numEvents)
+{
+	m_impl->numPolledEvents += numEvents;
+}
+
 void ArmBase::getArmStatus(ArmStatus *&armStatus)
 {
 	armStatus = &m_impl->armStatus;
@@ -53,6 +53,13 @@ public:
 	void start(void);
 	virtual void waitExit(void) override;
 
+	/**
+	 * Check if the arm has been started. This hides the one of
+	 * HatoholThreadBase because the arm may run on ArmScheduler
+	 * without its own thread.
+	 */
+	bool isStarted(void) const;
+
 	const MonitoringServerInfo &getServerInfo(void) const;
 	const ArmStatus &getArmStatus(void) const;
 
@@ -63,6 +70,15 @@ public:
 				  const time_t &endTime,
 				  Closure1<HistoryInfoVect> *closure);
 
+	/**
+	 * Fetch the history of items in a single job. The closure is
+	 * called once with the samples of all the items.
+	 */
+	virtual void fetchHistory(const ItemInfoList &itemInfoList,
+				  const time_t &beginTime,
+				  const time_t &endTime,
+				  Closure1<HistoryInfoVect> *closure);
+
 	void setPollingInterval(int sec);
 	int getPollingInterval(void) const;
 	int getRetryInterval(void) const;
@@ -96,6 +112,13 @@ protected:
 	gpointer mainThread(HatoholThreadArg *arg);
 
 	// virtual methods defined in this class
+
+	/**
+	 * Called once before the first cycle on the thread that runs the
+	 * cycles. The default implementation does nothing.
+	 */
+	virtual void prepareForPolling(void);
+
 	virtual ArmPollingResult mainThreadOneProc(void) = 0;
 	virtual ArmPollingResult mainThreadOneProcFetchItems(void);
 	virtual ArmPollingResult mainThreadOneProcFetchHistory(
@@ -104,6 +127,25 @@ protected:
 	  const time_t &beginTime,
 	  const time_t &endTime);
 
+	/**
+	 * Fetch the history of items. The default implementation calls
+	 * mainThreadOneProcFetchHistory() for each item.
+	 */
+	virtual ArmPollingResult mainThreadOneProcFetchHistories(
+	  HistoryInfoVect &historyInfoVect,
+	  const ItemInfoList &itemInfoList,
+	  const time_t &beginTime,
+	  const time_t &endTime);
+
+	/**
+	 * Count the events got in the current polling. They are used to
+	 * adapt the polling interval. This must be called from
+	 * mainThreadOneProc().
+	 *
+	 * @param numEvents The number of the events.
+	 */
+	void countPolledEvents(const size_t &numEvents);
+
 	void getArmStatus(ArmStatus *&armStatus);
 	void setFailureInfo(
 	  const std::string &comment,
@@ -116,6 +158,13 @@ protected:
 	void setInitialTrrigerStatus(void);
 
 private:
+	/**
+	 * Run a polling cycle or a queued fetch request.
+	 *
+	 * @return The seconds to the next cycle.
+	 */
+	int runOneCycle(void);
+
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
 };
@@ -17,7 +17,13 @@
  * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <time.h>
+#include <set>
+#include <deque>
+#include <Mutex.h>
 #include "ArmNagiosNDOUtils.h"
 #include "DBAgentMySQL.h"
 #include "Utils.h"
@@ -27,6 +33,8 @@
 #include "SQLUtils.h"
 #include "HatoholException.h"
 #include "ThreadLocalDBCache.h"
+#include "ConfigManager.h"
+#include "NDOStreamReceiver.h"
 using namespace std;
 using namespace mlpl;
 
@@ -36,12 +44,22 @@ static const char *TABLE_NAME_HOSTS         = "nagios_hosts";
 static const char *TABLE_NAME_STATEHISTORY  = "nagios_statehistory";
 static const char *TABLE_NAME_HOSTGROUPS    = "nagios_hostgroups";
 static const char *TABLE_NAME_HOSTGROUP_MEMBERS = "nagios_hostgroup_members";
+static const char *TABLE_NAME_OBJECTS       = "nagios_objects";
+
+// Events received from the NDO stream have IDs from this value so that
+// they don't conflict with statehistory_id used for the polled ones.
+static const EventIdType NDO_STREAM_EVENT_ID_BASE = 1ULL << 62;
+
+// The number of the streamed events remembered to suppress the duplicated
+// ones in the reconciliation poll.
+static const size_t MAX_NUM_STREAMED_EVENT_KEYS = 4096;
 
 enum
 {
 	STATE_OK       = 0,
 	STATE_WARNING  = 1,
 	STATE_CRITICAL = 2,
+	STATE_UNKNOWN  = 3,
 };
 
 // The explanation of soft and hard state can be found in
@@ -352,6 +370,146 @@ static const DBAgent::TableProfile tableProfileStateHistory =
 			    COLUMN_DEF_STATEHISTORY,
 			    NUM_IDX_STATEHISTORY);
 
+// Definitions: nagios_objects
+static const ColumnDef COLUMN_DEF_OBJECTS[] = {
+{
+	"object_id",                       // columnName
+	SQL_COLUMN_TYPE_INT,               // type
+	11,                                // columnLength
+	0,                                 // decFracLength
+	false,                             // canBeNull
+	SQL_KEY_PRI,                       // keyType
+	0,                                 // flags
+	NULL,                              // defaultValue
+}, {
+	"name1",                           // columnName
+	SQL_COLUMN_TYPE_VARCHAR,           // type
+	128,                               // columnLength
+	0,                                 // decFracLength
+	false,                             // canBeNull
+	SQL_KEY_NONE,                      // keyType
+	0,                                 // flags
+	"",                                // defaultValue
+}, {
+	"name2",                           // columnName
+	SQL_COLUMN_TYPE_VARCHAR,           // type
+	128,                               // columnLength
+	0,                                 // decFracLength
+	true,                              // canBeNull
+	SQL_KEY_NONE,                      // keyType
+	0,                                 // flags
+	NULL,                              // defaultValue
+},
+};
+
+enum {
+	IDX_OBJECTS_OBJECT_ID,
+	IDX_OBJECTS_NAME1,
+	IDX_OBJECTS_NAME2,
+	NUM_IDX_OBJECTS,
+};
+
+static const DBAgent::TableProfile tableProfileObjects =
+  DBAGENT_TABLEPROFILE_INIT(TABLE_NAME_OBJECTS,
+			    COLUMN_DEF_OBJECTS,
+			    NUM_IDX_OBJECTS);
+
+static void setStatusAndSeverity(const int &state, TriggerStatusType &status,
+                                 TriggerSeverityType &severity)
+{
+	// TODO: severity should not depend on the status.
+	if (state == STATE_OK) {
+		status = TRIGGER_STATUS_OK;
+		severity = TRIGGER_SEVERITY_INFO;
+		return;
+	}
+	status = TRIGGER_STATUS_PROBLEM;
+	if (state == STATE_WARNING)
+		severity = TRIGGER_SEVERITY_WARNING;
+	else if (state == STATE_CRITICAL)
+		severity = TRIGGER_SEVERITY_CRITICAL;
+	else
+		severity = TRIGGER_SEVERITY_UNKNOWN;
+}
+
+// A cheap summary of a table's content. It is computed in the NDOUtils DB
+// so that a table with no change doesn't have to be transferred. Both
+// the sum and the XOR of the row CRCs don't depend on the row order.
+struct NDOUtilsTableDigest {
+	bool     valid;
+	uint64_t numRows;
+	uint64_t crcSum;
+	uint64_t crcXor;
+
+	NDOUtilsTableDigest(void)
+	: valid(false),
+	  numRows(0),
+	  crcSum(0),
+	  crcXor(0)
+	{
+	}
+
+	bool operator==(const NDOUtilsTableDigest &rhs) const
+	{
+		return valid && rhs.valid && numRows == rhs.numRows &&
+		       crcSum == rhs.crcSum && crcXor == rhs.crcXor;
+	}
+};
+
+typedef map<HostgroupIdType, string>       HostgroupNameMap;
+typedef HostgroupNameMap::const_iterator   HostgroupNameMapConstIterator;
+
+typedef pair<HostgroupIdType, HostIdType>  HostgroupMemberKey;
+typedef set<HostgroupMemberKey>            HostgroupMemberSet;
+
+// IDs of a service that is identified by a host and service name in
+// the NDO stream.
+struct NDOServiceIds {
+	TriggerIdType serviceId;
+	HostIdType    hostId;
+	string        hostName; // display_name of the host
+};
+
+typedef map<string, NDOServiceIds>        NDOServiceIdsMap;
+typedef NDOServiceIdsMap::const_iterator  NDOServiceIdsMapConstIterator;
+
+// An event is identified by (service_id, state_time, state).
+struct StreamedEventKey {
+	TriggerIdType serviceId;
+	time_t        time;
+	int           state;
+
+	bool operator<(const StreamedEventKey &rhs) const
+	{
+		if (serviceId != rhs.serviceId)
+			return serviceId < rhs.serviceId;
+		if (time != rhs.time)
+			return time < rhs.time;
+		return state < rhs.state;
+	}
+};
+
+typedef set<StreamedEventKey>   StreamedEventKeySet;
+typedef deque<StreamedEventKey> StreamedEventKeyQueue;
+
+static string makeServiceKey(const string &hostName, const string &serviceName)
+{
+	return hostName + '\t' + serviceName;
+}
+
+// The reverse of setStatusAndSeverity()
+static int getState(const TriggerStatusType &status,
+                    const TriggerSeverityType &severity)
+{
+	if (status == TRIGGER_STATUS_OK)
+		return STATE_OK;
+	if (severity == TRIGGER_SEVERITY_WARNING)
+		return STATE_WARNING;
+	if (severity == TRIGGER_SEVERITY_CRITICAL)
+		return STATE_CRITICAL;
+	return STATE_UNKNOWN;
+}
+
 // ---------------------------------------------------------------------------
 // Private context
 // ---------------------------------------------------------------------------
@@ -368,6 +526,27 @@ struct ArmNagiosNDOUtils::Impl
 	string               selectEventBaseCondition;
 	UnifiedDataStore    *dataStore;
 	MonitoringServerInfo serverInfo;
+	NDOUtilsTableDigest  hostDigest;
+	NDOUtilsTableDigest  hostgroupDigest;
+	NDOUtilsTableDigest  hostgroupMembersDigest;
+	HostgroupNameMap     knownHostgroups;
+	HostgroupMemberSet   knownHostgroupMembers;
+
+	// The following are used for the NDO stream
+	string                ndoStreamPath;
+	NDOStreamReceiver    *streamReceiver;
+	DBClientJoinBuilder   selectServiceIdsBuilder;
+	// The polled events that were streamed aren't stored. So the last
+	// polled ID is saved in this file to resume after a restart.
+	string                pollCursorPath;
+	EventIdType           lastPolledEventId;
+	mlpl::Mutex           streamLock;
+	// The following are protected by streamLock
+	NDOServiceIdsMap      serviceIdsMap;
+	bool                  serviceIdsMapExpired;
+	StreamedEventKeySet   streamedEventKeySet;
+	StreamedEventKeyQueue streamedEventKeyQueue;
+	uint64_t              streamEventSequence;
 
 	// methods
 	Impl(const MonitoringServerInfo &_serverInfo)
@@ -379,16 +558,127 @@ struct ArmNagiosNDOUtils::Impl
 	  selectHostgroupArg(tableProfileHostgroups),
 	  selectHostgroupMembersArg(tableProfileHostgroupMembers),
 	  dataStore(NULL),
-	  serverInfo(_serverInfo)
+	  serverInfo(_serverInfo),
+	  streamReceiver(NULL),
+	  selectServiceIdsBuilder(tableProfileServices),
+	  lastPolledEventId(EVENT_NOT_FOUND),
+	  serviceIdsMapExpired(true),
+	  streamEventSequence(0)
 	{
 		dataStore = UnifiedDataStore::getInstance();
+		const string ndoStreamDirectory =
+		  ConfigManager::getInstance()->getNDOStreamDirectory();
+		if (!ndoStreamDirectory.empty()) {
+			ndoStreamPath = StringUtils::sprintf(
+			  "%s/%" FMT_SERVER_ID ".ndo",
+			  ndoStreamDirectory.c_str(), serverInfo.id);
+		}
+		pollCursorPath = StringUtils::sprintf(
+		  "%s/ndo-poll-cursor-%" FMT_SERVER_ID,
+		  ConfigManager::getInstance()->getDatabaseDirectory().c_str(),
+		  serverInfo.id);
 	}
 
 	virtual ~Impl()
 	{
+		delete streamReceiver;
 		delete dbAgent;
 	}
 
+	bool isStreamEnabled(void) const
+	{
+		return streamReceiver;
+	}
+
+	// The cursor is used whenever the stream is configured, so that it
+	// is valid when the receiver starts later.
+	bool isStreamConfigured(void) const
+	{
+		return !ndoStreamPath.empty();
+	}
+
+	EventIdType loadPollCursor(void)
+	{
+		FILE *fp = fopen(pollCursorPath.c_str(), "r");
+		if (!fp)
+			return EVENT_NOT_FOUND;
+		EventIdType id = EVENT_NOT_FOUND;
+		if (fscanf(fp, "%" PRIu64, &id) != 1) {
+			MLPL_ERR("Broken poll cursor: %s\n",
+			         pollCursorPath.c_str());
+			id = EVENT_NOT_FOUND;
+		}
+		fclose(fp);
+		return id;
+	}
+
+	// The file is replaced by rename() so that a crash never leaves
+	// a truncated cursor.
+	bool savePollCursor(const EventIdType &id)
+	{
+		const string tmpPath = pollCursorPath + ".tmp";
+		FILE *fp = fopen(tmpPath.c_str(), "w");
+		if (!fp) {
+			MLPL_ERR("Failed to open %s: %s\n",
+			         tmpPath.c_str(), strerror(errno));
+			return false;
+		}
+		const bool written = (fprintf(fp, "%" PRIu64 "\n", id) > 0);
+		const bool closed = (fclose(fp) == 0);
+		if (!written || !closed ||
+		    rename(tmpPath.c_str(), pollCursorPath.c_str()) != 0) {
+			MLPL_ERR("Failed to save the poll cursor: %s: %s\n",
+			         pollCursorPath.c_str(), strerror(errno));
+			remove(tmpPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// The streamed events stored before the restart are remembered
+	// so that the poll doesn't store them again.
+	void loadStreamedEventKeys(void)
+	{
+		EventsQueryOption option(USER_ID_SYSTEM);
+		option.setTargetServerId(serverInfo.id);
+		option.setSortType(EventsQueryOption::SORT_UNIFIED_ID,
+		                   DataQueryOption::SORT_DESCENDING);
+		option.setMaximumNumber(MAX_NUM_STREAMED_EVENT_KEYS);
+		EventInfoList eventInfoList;
+		ThreadLocalDBCache cache;
+		cache.getMonitoring().getEventInfoList(eventInfoList, option);
+
+		AutoMutex autoMutex(&streamLock);
+		EventInfoList::reverse_iterator it = eventInfoList.rbegin();
+		for (; it != eventInfoList.rend(); ++it) {
+			if (it->id < NDO_STREAM_EVENT_ID_BASE)
+				continue;
+			const StreamedEventKey key = {
+			  it->triggerId, it->time.tv_sec,
+			  getState(it->status, it->severity)};
+			rememberStreamedEvent(key);
+		}
+	}
+
+	void rememberStreamedEvent(const StreamedEventKey &key)
+	{
+		// Called with streamLock held
+		if (!streamedEventKeySet.insert(key).second)
+			return;
+		streamedEventKeyQueue.push_back(key);
+		if (streamedEventKeyQueue.size() > MAX_NUM_STREAMED_EVENT_KEYS) {
+			streamedEventKeySet.erase(
+			  streamedEventKeyQueue.front());
+			streamedEventKeyQueue.pop_front();
+		}
+	}
+
+	bool isStreamedEvent(const StreamedEventKey &key)
+	{
+		AutoMutex autoMutex(&streamLock);
+		return streamedEventKeySet.count(key);
+	}
+
 	void connect(void)
 	{
 		HATOHOL_ASSERT(!dbAgent, "dbAgent is NOT NULL.");
@@ -397,6 +687,57 @@ struct ArmNagiosNDOUtils::Impl
 		  serverInfo.password.c_str(),
 		  serverInfo.getHostAddress().c_str(), serverInfo.port);
 	}
+
+	void clearDigests(void)
+	{
+		hostDigest = NDOUtilsTableDigest();
+		hostgroupDigest = NDOUtilsTableDigest();
+		hostgroupMembersDigest = NDOUtilsTableDigest();
+		knownHostgroups.clear();
+		knownHostgroupMembers.clear();
+	}
+
+	/**
+	 * Compute the digest of the columns used in selectArg.
+	 *
+	 * @return true if the digest differs from the previous one.
+	 */
+	bool fetchDigest(const DBAgent::SelectExArg &selectArg,
+	                 const NDOUtilsTableDigest &prevDigest,
+	                 NDOUtilsTableDigest &digest)
+	{
+		const DBAgent::TableProfile &tableProfile =
+		  *selectArg.tableProfile;
+		string row = "CONCAT_WS(CHAR(31)";
+		for (size_t i = 0; i < selectArg.statements.size(); i++) {
+			row += ",";
+			row += selectArg.statements[i];
+		}
+		row += ")";
+
+		DBAgent::SelectExArg arg(tableProfile);
+		arg.add("COUNT(*)", SQL_COLUMN_TYPE_BIGUINT);
+		arg.add(StringUtils::sprintf("COALESCE(SUM(CRC32(%s)),0)",
+		                             row.c_str()),
+		        SQL_COLUMN_TYPE_BIGUINT);
+		arg.add(StringUtils::sprintf("COALESCE(BIT_XOR(CRC32(%s)),0)",
+		                             row.c_str()),
+		        SQL_COLUMN_TYPE_BIGUINT);
+		dbAgent->select(arg);
+
+		const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
+		ItemGroupStream itemGroupStream(*grpList.begin());
+		itemGroupStream >> digest.numRows;
+		itemGroupStream >> digest.crcSum;
+		itemGroupStream >> digest.crcXor;
+		digest.valid = true;
+		if (digest == prevDigest) {
+			MLPL_DBG("%s: unchanged (%" PRIu64 " rows)\n",
+			         tableProfile.name, digest.numRows);
+			return false;
+		}
+		return true;
+	}
 };
 
 // ---------------------------------------------------------------------------
@@ -412,13 +753,39 @@ ArmNagiosNDOUtils::ArmNagiosNDOUtils(const MonitoringServerInfo &serverInfo)
 	makeSelectHostArg();
 	makeSelectHostgroupArg();
 	makeSelectHostgroupMembersArg();
+	makeSelectServiceIdsBuilder();
 }
 
 ArmNagiosNDOUtils::~ArmNagiosNDOUtils()
 {
+	// The receiver calls back this object
+	delete m_impl->streamReceiver;
+	m_impl->streamReceiver = NULL;
 	requestExitAndWait();
 }
 
+void ArmNagiosNDOUtils::setNDOStreamPath(const string &path)
+{
+	HATOHOL_ASSERT(!m_impl->streamReceiver,
+	               "The stream receiver has already started.");
+	m_impl->ndoStreamPath = path;
+}
+
+const string &ArmNagiosNDOUtils::getNDOStreamPath(void) const
+{
+	return m_impl->ndoStreamPath;
+}
+
+void ArmNagiosNDOUtils::startNDOStreamReceiver(void)
+{
+	if (m_impl->ndoStreamPath.empty() || m_impl->streamReceiver)
+		return;
+	m_impl->loadStreamedEventKeys();
+	m_impl->streamReceiver = new NDOStreamReceiver(
+	  m_impl->ndoStreamPath, ndoRecordReceivedCb, this);
+	m_impl->streamReceiver->start();
+}
+
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
@@ -490,6 +857,25 @@ void ArmNagiosNDOUtils::makeSelectItemBuilder(void)
 	builder.add(IDX_SERVICESTATUS_OUTPUT);
 }
 
+void ArmNagiosNDOUtils::makeSelectServiceIdsBuilder(void)
+{
+	DBClientJoinBuilder &builder = m_impl->selectServiceIdsBuilder;
+	builder.add(IDX_SERVICES_SERVICE_ID);
+	builder.add(IDX_SERVICES_HOST_OBJECT_ID);
+
+	builder.addTable(
+	  tableProfileObjects, DBClientJoinBuilder::INNER_JOIN,
+	  IDX_SERVICES_SERVICE_OBJECT_ID, IDX_OBJECTS_OBJECT_ID);
+	builder.add(IDX_OBJECTS_NAME1);
+	builder.add(IDX_OBJECTS_NAME2);
+
+	builder.addTable(
+	  tableProfileHosts, DBClientJoinBuilder::INNER_JOIN,
+	  tableProfileServices, IDX_SERVICES_HOST_OBJECT_ID,
+	  IDX_HOSTS_HOST_OBJECT_ID);
+	builder.add(IDX_HOSTS_DISPLAY_NAME);
+}
+
 void ArmNagiosNDOUtils::makeSelectHostArg(void)
 {
 	DBAgent::SelectExArg &arg = m_impl->selectHostArg;
@@ -529,11 +915,32 @@ void ArmNagiosNDOUtils::addConditionForTriggerQuery(void)
 	                        tm.tm_hour, tm.tm_min, tm.tm_sec);
 }
 
-void ArmNagiosNDOUtils::addConditionForEventQuery(void)
+EventIdType ArmNagiosNDOUtils::getEventCursor(void)
 {
-	ThreadLocalDBCache cache;
 	const MonitoringServerInfo &svInfo = getServerInfo();
-	uint64_t lastEventId = cache.getMonitoring().getLastEventId(svInfo.id);
+	// With the NDO stream, the polled events may be skipped as duplicates
+	// and not stored. So the last ID is kept in the cursor file.
+	EventIdType lastEventId = m_impl->lastPolledEventId;
+	if (!m_impl->isStreamConfigured() || lastEventId == EVENT_NOT_FOUND) {
+		lastEventId = UnifiedDataStore::getInstance()->getLastEventId(
+		  svInfo.id, NDO_STREAM_EVENT_ID_BASE);
+	}
+	if (m_impl->isStreamConfigured() &&
+	    m_impl->lastPolledEventId == EVENT_NOT_FOUND) {
+		// The cursor may be older than the DB if the stream was
+		// disabled for a while.
+		const EventIdType cursor = m_impl->loadPollCursor();
+		if (cursor != EVENT_NOT_FOUND &&
+		    (lastEventId == EVENT_NOT_FOUND || cursor > lastEventId))
+			lastEventId = cursor;
+		m_impl->lastPolledEventId = lastEventId;
+	}
+	return lastEventId;
+}
+
+void ArmNagiosNDOUtils::addConditionForEventQuery(void)
+{
+	const EventIdType lastEventId = getEventCursor();
 	string cond;
 	DBAgent::SelectExArg &arg = m_impl->selectEventBuilder.getSelectExArg();
 	arg.condition = m_impl->selectEventBaseCondition;
@@ -568,20 +975,10 @@ void ArmNagiosNDOUtils::getTrigger(void)
 
 		itemGroupStream >> trigInfo.id;      // service_id
 
-		// TODO: severity should not depend on the status.
 		// status and severity (current_status)
 		itemGroupStream >> currentStatus;
-		trigInfo.status = TRIGGER_STATUS_OK;
-		trigInfo.severity = TRIGGER_SEVERITY_INFO;
-		if (currentStatus != STATE_OK) {
-			trigInfo.status = TRIGGER_STATUS_PROBLEM;
-			if (currentStatus == STATE_WARNING)
-				trigInfo.severity = TRIGGER_SEVERITY_WARNING;
-			else if (currentStatus == STATE_CRITICAL)
-				trigInfo.severity = TRIGGER_SEVERITY_CRITICAL;
-			else
-				trigInfo.severity = TRIGGER_SEVERITY_UNKNOWN;
-		}
+		setStatusAndSeverity(currentStatus,
+		                     trigInfo.status, trigInfo.severity);
 
 		itemGroupStream >> trigInfo.lastChangeTime.tv_sec;
 		                                      //status_update_time
@@ -590,8 +987,7 @@ void ArmNagiosNDOUtils::getTrigger(void)
 		itemGroupStream >> trigInfo.hostName; // hosts.display_name
 		triggerInfoList.push_back(trigInfo);
 	}
-	ThreadLocalDBCache cache;
-	cache.getMonitoring().addTriggerInfoList(triggerInfoList);
+	m_impl->dataStore->addTriggerList(triggerInfoList);
 }
 
 void ArmNagiosNDOUtils::getEvent(void)
@@ -607,6 +1003,7 @@ void ArmNagiosNDOUtils::getEvent(void)
 	// TODO: use addEventInfoList with the newly added data.
 	const MonitoringServerInfo &svInfo = getServerInfo();
 	EventInfoList eventInfoList;
+	EventIdType lastPolledEventId = m_impl->lastPolledEventId;
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
 	ItemGroupListConstIterator itemGrpItr = grpList.begin();
 	for (; itemGrpItr != grpList.end(); ++itemGrpItr) {
@@ -619,27 +1016,147 @@ void ArmNagiosNDOUtils::getEvent(void)
 		itemGroupStream >> eventInfo.id; // statehistory_id
 		// type, status, and severity (state)
 		itemGroupStream >> state;
-		if (state == STATE_OK) {
-			eventInfo.type = EVENT_TYPE_GOOD;
-			eventInfo.status = TRIGGER_STATUS_OK,
-			eventInfo.severity = TRIGGER_SEVERITY_INFO;
-		} else {
-			eventInfo.type = EVENT_TYPE_BAD;
-			eventInfo.status = TRIGGER_STATUS_PROBLEM;
-			if (state == STATE_WARNING)
-				eventInfo.severity = TRIGGER_SEVERITY_WARNING;
-			else if (state == STATE_CRITICAL)
-				eventInfo.severity = TRIGGER_SEVERITY_CRITICAL;
-			else
-				eventInfo.severity = TRIGGER_SEVERITY_UNKNOWN;
-		}
+		eventInfo.type =
+		  (state == STATE_OK) ? EVENT_TYPE_GOOD : EVENT_TYPE_BAD;
+		setStatusAndSeverity(state,
+		                     eventInfo.status, eventInfo.severity);
 		itemGroupStream >> eventInfo.time.tv_sec; // state_time
 		itemGroupStream >> eventInfo.brief;       // output
 		itemGroupStream >> eventInfo.triggerId;   // service_id
 		itemGroupStream >> eventInfo.hostId;      // host_id
 		itemGroupStream >> eventInfo.hostName;    // hosts.display_name
+		if (lastPolledEventId == EVENT_NOT_FOUND ||
+		    eventInfo.id > lastPolledEventId)
+			lastPolledEventId = eventInfo.id;
+
+		if (m_impl->isStreamEnabled()) {
+			const StreamedEventKey key = {
+			  eventInfo.triggerId, eventInfo.time.tv_sec, state};
+			if (m_impl->isStreamedEvent(key))
+				continue;
+		}
 		eventInfoList.push_back(eventInfo);
 	}
+	if (m_impl->isStreamEnabled() && !eventInfoList.empty()) {
+		MLPL_INFO("%zd events were missed in the NDO stream.\n",
+		          eventInfoList.size());
+	}
+	m_impl->dataStore->addEventList(eventInfoList);
+	countPolledEvents(eventInfoList.size());
+
+	// The cursor advances only after the events are stored.
+	if (m_impl->isStreamConfigured() &&
+	    lastPolledEventId != m_impl->lastPolledEventId) {
+		m_impl->lastPolledEventId = lastPolledEventId;
+		m_impl->savePollCursor(lastPolledEventId);
+	}
+}
+
+void ArmNagiosNDOUtils::updateServiceIdsMap(void)
+{
+	DBAgent::SelectExArg &arg =
+	  m_impl->selectServiceIdsBuilder.getSelectExArg();
+	m_impl->dbAgent->select(arg);
+
+	NDOServiceIdsMap serviceIdsMap;
+	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
+	ItemGroupListConstIterator itemGrpItr = grpList.begin();
+	for (; itemGrpItr != grpList.end(); ++itemGrpItr) {
+		ItemGroupStream itemGroupStream(*itemGrpItr);
+		NDOServiceIds ids;
+		string hostName, serviceName;
+		itemGroupStream >> ids.serviceId;    // service_id
+		itemGroupStream >> ids.hostId;       // host_object_id
+		itemGroupStream >> hostName;         // objects.name1
+		itemGroupStream >> serviceName;      // objects.name2
+		itemGroupStream >> ids.hostName;     // hosts.display_name
+		serviceIdsMap[makeServiceKey(hostName, serviceName)] = ids;
+	}
+	MLPL_DBG("The number of services for NDO stream: %zd\n",
+	         serviceIdsMap.size());
+
+	AutoMutex autoMutex(&m_impl->streamLock);
+	m_impl->serviceIdsMap.swap(serviceIdsMap);
+	m_impl->serviceIdsMapExpired = false;
+}
+
+void ArmNagiosNDOUtils::ndoRecordReceivedCb(
+  const NDOStreamParser::Record &record, void *data)
+{
+	ArmNagiosNDOUtils *obj = static_cast<ArmNagiosNDOUtils *>(data);
+	if (record.type == NDOStreamParser::API_STATECHANGEDATA)
+		obj->ingestStateChange(record);
+}
+
+void ArmNagiosNDOUtils::ingestStateChange(
+  const NDOStreamParser::Record &record)
+{
+	// This is called on the thread of NDOStreamReceiver.
+	typedef NDOStreamParser P;
+	if (record.getInt(P::DATA_TYPE) != P::NEBTYPE_STATECHANGE_END)
+		return;
+	// The DB poll also handles only hard state changes of services.
+	const string &serviceName = record.get(P::DATA_SERVICE);
+	if (serviceName.empty())
+		return;
+	if (record.getInt(P::DATA_STATETYPE) != HARD_STATE)
+		return;
+
+	const MonitoringServerInfo &svInfo = getServerInfo();
+	const string &hostName = record.get(P::DATA_HOST);
+	const int state = record.getInt(P::DATA_STATE);
+	const timespec timestamp = record.getTimestamp(P::DATA_TIMESTAMP);
+
+	EventInfo eventInfo;
+	{
+		AutoMutex autoMutex(&m_impl->streamLock);
+		NDOServiceIdsMapConstIterator it = m_impl->serviceIdsMap.find(
+		  makeServiceKey(hostName, serviceName));
+		if (it == m_impl->serviceIdsMap.end()) {
+			// It will be obtained by the next DB poll.
+			MLPL_DBG("Unknown service in NDO stream: %s: %s\n",
+			         hostName.c_str(), serviceName.c_str());
+			m_impl->serviceIdsMapExpired = true;
+			return;
+		}
+		const NDOServiceIds &ids = it->second;
+		eventInfo.triggerId = ids.serviceId;
+		eventInfo.hostId    = ids.hostId;
+		eventInfo.hostName  = ids.hostName;
+
+		const StreamedEventKey key = {
+		  ids.serviceId, timestamp.tv_sec, state};
+		m_impl->rememberStreamedEvent(key);
+
+		// Unique as long as less than 256 events happen in a micro
+		// second. (sec * 10^6 + usec) << 8 doesn't reach 2^62.
+		const uint64_t usec =
+		  (uint64_t)timestamp.tv_sec * 1000000 +
+		  timestamp.tv_nsec / 1000;
+		eventInfo.id = NDO_STREAM_EVENT_ID_BASE +
+		  ((usec << 8) | (m_impl->streamEventSequence++ & 0xff));
+	}
+	eventInfo.serverId = svInfo.id;
+	eventInfo.time = timestamp;
+	eventInfo.type = (state == STATE_OK) ? EVENT_TYPE_GOOD : EVENT_TYPE_BAD;
+	setStatusAndSeverity(state, eventInfo.status, eventInfo.severity);
+	eventInfo.brief = record.get(P::DATA_OUTPUT);
+
+	TriggerInfo trigInfo;
+	trigInfo.serverId       = svInfo.id;
+	trigInfo.id             = eventInfo.triggerId;
+	trigInfo.status         = eventInfo.status;
+	trigInfo.severity       = eventInfo.severity;
+	trigInfo.lastChangeTime = eventInfo.time;
+	trigInfo.hostId         = eventInfo.hostId;
+	trigInfo.hostName       = eventInfo.hostName;
+	trigInfo.brief          = eventInfo.brief;
+
+	TriggerInfoList triggerInfoList;
+	triggerInfoList.push_back(trigInfo);
+	EventInfoList eventInfoList;
+	eventInfoList.push_back(eventInfo);
+	m_impl->dataStore->addTriggerList(triggerInfoList);
 	m_impl->dataStore->addEventList(eventInfoList);
 }
 
@@ -676,12 +1193,16 @@ void ArmNagiosNDOUtils::getItem(void)
 
 		itemInfoList.push_back(itemInfo);
 	}
-	ThreadLocalDBCache cache;
-	cache.getMonitoring().addItemInfoList(itemInfoList);
+	m_impl->dataStore->addItemList(itemInfoList);
 }
 
-void ArmNagiosNDOUtils::getHost(void)
+bool ArmNagiosNDOUtils::getHost(void)
 {
+	NDOUtilsTableDigest digest;
+	if (!m_impl->fetchDigest(m_impl->selectHostArg,
+	                         m_impl->hostDigest, digest))
+		return false;
+
 	// TODO: should use transaction
 	m_impl->dbAgent->select(m_impl->selectHostArg);
 	size_t numHosts =
@@ -701,12 +1222,20 @@ void ArmNagiosNDOUtils::getHost(void)
 		itemGroupStream >> hostInfo.hostName;
 		hostInfoList.push_back(hostInfo);
 	}
+	// updateHosts() needs the whole list to find removed hosts.
 	ThreadLocalDBCache cache;
 	cache.getMonitoring().updateHosts(hostInfoList, svInfo.id);
+	m_impl->hostDigest = digest;
+	return true;
 }
 
-void ArmNagiosNDOUtils::getHostgroup(void)
+bool ArmNagiosNDOUtils::getHostgroup(void)
 {
+	NDOUtilsTableDigest digest;
+	if (!m_impl->fetchDigest(m_impl->selectHostgroupArg,
+	                         m_impl->hostgroupDigest, digest))
+		return false;
+
 	// TODO: should use transaction
 	m_impl->dbAgent->select(m_impl->selectHostgroupArg);
 	size_t numHostgroups =
@@ -715,6 +1244,7 @@ void ArmNagiosNDOUtils::getHostgroup(void)
 
 	const MonitoringServerInfo &svInfo = getServerInfo();
 	HostgroupInfoList hostgroupInfoList;
+	HostgroupNameMap hostgroups;
 	const ItemGroupList &grpList =
 	  m_impl->selectHostgroupArg.dataTable->getItemGroupList();
 	ItemGroupListConstIterator itemGrpItr = grpList.begin();
@@ -725,14 +1255,34 @@ void ArmNagiosNDOUtils::getHostgroup(void)
 		hostgroupInfo.serverId = svInfo.id;
 		itemGroupStream >> hostgroupInfo.groupId;
 		itemGroupStream >> hostgroupInfo.groupName;
+		hostgroups[hostgroupInfo.groupId] = hostgroupInfo.groupName;
+
+		// Only new or renamed ones are written
+		HostgroupNameMapConstIterator it =
+		  m_impl->knownHostgroups.find(hostgroupInfo.groupId);
+		if (it != m_impl->knownHostgroups.end() &&
+		    it->second == hostgroupInfo.groupName)
+			continue;
 		hostgroupInfoList.push_back(hostgroupInfo);
 	}
-	ThreadLocalDBCache cache;
-	cache.getMonitoring().addHostgroupInfoList(hostgroupInfoList);
+	MLPL_DBG("The number of changed hostgroups: %zd\n",
+	         hostgroupInfoList.size());
+	if (!hostgroupInfoList.empty()) {
+		ThreadLocalDBCache cache;
+		cache.getMonitoring().addHostgroupInfoList(hostgroupInfoList);
+	}
+	m_impl->knownHostgroups.swap(hostgroups);
+	m_impl->hostgroupDigest = digest;
+	return true;
 }
 
-void ArmNagiosNDOUtils::getHostgroupMembers(void)
+bool ArmNagiosNDOUtils::getHostgroupMembers(void)
 {
+	NDOUtilsTableDigest digest;
+	if (!m_impl->fetchDigest(m_impl->selectHostgroupMembersArg,
+	                         m_impl->hostgroupMembersDigest, digest))
+		return false;
+
 	// TODO: should use transaction
 	m_impl->dbAgent->select(m_impl->selectHostgroupMembersArg);
 	size_t numHostgroupMembers =
@@ -741,6 +1291,7 @@ void ArmNagiosNDOUtils::getHostgroupMembers(void)
 
 	const MonitoringServerInfo &svInfo = getServerInfo();
 	HostgroupElementList hostgroupElementList;
+	HostgroupMemberSet members;
 	const ItemGroupList &grpList =
 	  m_impl->selectHostgroupMembersArg.dataTable->getItemGroupList();
 	ItemGroupListConstIterator itemGrpItr = grpList.begin();
@@ -751,10 +1302,25 @@ void ArmNagiosNDOUtils::getHostgroupMembers(void)
 		hostgroupElement.serverId = svInfo.id;
 		itemGroupStream >> hostgroupElement.groupId;
 		itemGroupStream >> hostgroupElement.hostId;
+		const HostgroupMemberKey key(hostgroupElement.groupId,
+		                             hostgroupElement.hostId);
+		members.insert(key);
+
+		// Only new ones are written
+		if (m_impl->knownHostgroupMembers.count(key))
+			continue;
 		hostgroupElementList.push_back(hostgroupElement);
 	}
-	ThreadLocalDBCache cache;
-	cache.getMonitoring().addHostgroupElementList(hostgroupElementList);
+	MLPL_DBG("The number of new hostgroupMembers: %zd\n",
+	         hostgroupElementList.size());
+	if (!hostgroupElementList.empty()) {
+		ThreadLocalDBCache cache;
+		cache.getMonitoring().addHostgroupElementList(
+		  hostgroupElementList);
+	}
+	m_impl->knownHostgroupMembers.swap(members);
+	m_impl->hostgroupMembersDigest = digest;
+	return true;
 }
 
 void ArmNagiosNDOUtils::connect(void)
@@ -770,6 +1336,8 @@ ArmBase::ArmPollingResult ArmNagiosNDOUtils::handleHatoholException(
 			 he.what(), he.getErrCode());
 		delete m_impl->dbAgent;
 		m_impl->dbAgent = NULL;
+		// NDOUtils may have been rebuilt while we were disconnected.
+		m_impl->clearDigests();
 		return COLLECT_NG_DISCONNECT_NAGIOS;
 	} else {
 		MLPL_ERR("Got exception: %s\n", he.what());
@@ -777,7 +1345,7 @@ ArmBase::ArmPollingResult ArmNagiosNDOUtils::handleHatoholException(
 	}
 }
 
-gpointer ArmNagiosNDOUtils::mainThread(HatoholThreadArg *arg)
+void ArmNagiosNDOUtils::prepareForPolling(void)
 {
 	const MonitoringServerInfo &svInfo = getServerInfo();
 	MLPL_INFO("started: ArmNagiosNDOUtils (server: %s)\n",
@@ -788,7 +1356,7 @@ gpointer ArmNagiosNDOUtils::mainThread(HatoholThreadArg *arg)
 	ArmBase::registerAvailableTrigger(COLLECT_NG_INTERNAL_ERROR,
 					  FAILED_INTERNAL_ERROR_TRIGGER_ID,
 					  HTERR_INTERNAL_ERROR);
-	return ArmBase::mainThread(arg);
+	startNDOStreamReceiver();
 }
 
 ArmBase::ArmPollingResult ArmNagiosNDOUtils::mainThreadOneProc(void)
@@ -796,11 +1364,21 @@ ArmBase::ArmPollingResult ArmNagiosNDOUtils::mainThreadOneProc(void)
 	try {
 		if (!m_impl->dbAgent)
 			connect();
+		// With the NDO stream, this is a reconciliation of what
+		// the stream missed.
 		getTrigger();
 		getEvent();
-		getHost();
+		const bool hostsChanged = getHost();
 		getHostgroup();
 		getHostgroupMembers();
+		if (m_impl->isStreamEnabled()) {
+			bool expired;
+			m_impl->streamLock.lock();
+			expired = m_impl->serviceIdsMapExpired;
+			m_impl->streamLock.unlock();
+			if (expired || hostsChanged)
+				updateServiceIdsMap();
+		}
 		if (!getCopyOnDemandEnabled())
 			getItem();
 	} catch (const HatoholException &he) {
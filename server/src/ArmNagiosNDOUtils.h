@@ -26,6 +26,7 @@
 #include "JSONParser.h"
 #include "JSONBuilder.h"
 #include "DBTablesConfig.h"
+#include "NDOStreamParser.h"
 
 class ArmNagiosNDOUtils : public ArmBase
 {
@@ -33,6 +34,19 @@ public:
 	ArmNagiosNDOUtils(const MonitoringServerInfo &serverInfo);
 	virtual ~ArmNagiosNDOUtils();
 
+	/**
+	 * Set the path of the NDOMOD output to receive events as soon as
+	 * they happen. The DB is still polled to pick up events the stream
+	 * missed. By default, the path is made from
+	 * ConfigManager::getNDOStreamDirectory(). This must be called
+	 * before start().
+	 *
+	 * @param path A path of the NDOMOD output, or an empty string not
+	 * to use the stream.
+	 */
+	void setNDOStreamPath(const std::string &path);
+	const std::string &getNDOStreamPath(void) const;
+
 protected:
 	void makeSelectTriggerBuilder(void);
 	void makeSelectEventBuilder(void);
@@ -40,20 +54,45 @@ protected:
 	void makeSelectHostArg(void);
 	void makeSelectHostgroupArg(void);
 	void makeSelectHostgroupMembersArg(void);
+	void makeSelectServiceIdsBuilder(void);
 	void addConditionForTriggerQuery(void);
+
+	/**
+	 * Get the ID of the last event that has been polled. When the NDO
+	 * stream is used, it is saved in a file in the database directory
+	 * and is kept over a restart.
+	 *
+	 * @return The ID or EVENT_NOT_FOUND.
+	 */
+	EventIdType getEventCursor(void);
 	void addConditionForEventQuery(void);
 	void getTrigger(void);
 	void getEvent(void);
 	void getItem(void);
-	void getHost(void);
-	void getHostgroup(void);
-	void getHostgroupMembers(void);
+
+	/**
+	 * Synchronize hosts, hostgroups and hostgroup members with NDOUtils.
+	 * Nothing is fetched nor written if the digest of the source table
+	 * is the same as that of the previous call.
+	 *
+	 * @return true if the table has been synchronized, or false if it
+	 * has been skipped.
+	 */
+	bool getHost(void);
+	bool getHostgroup(void);
+	bool getHostgroupMembers(void);
 	void connect(void);
 
+	void startNDOStreamReceiver(void);
+	void updateServiceIdsMap(void);
+	static void ndoRecordReceivedCb(const NDOStreamParser::Record &record,
+	                                void *data);
+	void ingestStateChange(const NDOStreamParser::Record &record);
+
 	ArmPollingResult handleHatoholException(const HatoholException &he);
 
 	// virtual methods
-	virtual gpointer mainThread(HatoholThreadArg *arg);
+	virtual void prepareForPolling(void);
 	virtual ArmPollingResult mainThreadOneProc(void);
 	virtual ArmPollingResult mainThreadOneProcFetchItems(void);
 
@@ -269,13 +269,12 @@ std::string ArmRedmine::getQuery(void)
 	return m_impl->getQuery();
 }
 
-gpointer ArmRedmine::mainThread(HatoholThreadArg *arg)
+void ArmRedmine::prepareForPolling(void)
 {
 	const IncidentTrackerInfo &trackerInfo = m_impl->m_incidentTrackerInfo;
 	MLPL_INFO("started: ArmRedmine "
 		  "(Tracker ID: %" FMT_INCIDENT_TRACKER_ID ", Nickname: %s)\n",
 	          trackerInfo.id, trackerInfo.nickname.c_str());
-	return ArmBase::mainThread(arg);
 }
 
 ArmBase::ArmPollingResult ArmRedmine::mainThreadOneProc(void)
@@ -33,7 +33,7 @@ public:
 
 protected:
 	// virtual methods
-	virtual gpointer mainThread(HatoholThreadArg *arg) override;
+	virtual void prepareForPolling(void) override;
 	virtual ArmBase::ArmPollingResult mainThreadOneProc(void) override;
 
 	std::string getURL(void);
@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <cstdlib>
+#include <queue>
+#include <deque>
+#include <list>
+#include <map>
+#include <Logger.h>
+#include <Mutex.h>
+#include <AtomicValue.h>
+#include <SimpleSemaphore.h>
+#include "ArmScheduler.h"
+#include "HatoholThreadBase.h"
+#include "HatoholException.h"
+#include "ConfigManager.h"
+#include "MetricsRegistry.h"
+
+using namespace std;
+using namespace mlpl;
+
+// A run that starts later than this after its deadline is counted as late.
+static const uint64_t LATE_THRESHOLD_MSEC = 1000;
+static const size_t   IDLE_WAIT_MSEC = 60 * 1000;
+
+static uint64_t getMonotonicMSec(void)
+{
+	timespec ts;
+	HATOHOL_ASSERT(clock_gettime(CLOCK_MONOTONIC, &ts) == 0,
+	               "Failed to call clock_gettime: %d\n", errno);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// ---------------------------------------------------------------------------
+// ArmScheduler::Task
+// ---------------------------------------------------------------------------
+ArmScheduler::Task::~Task()
+{
+}
+
+// ---------------------------------------------------------------------------
+// ArmScheduler::Impl
+// ---------------------------------------------------------------------------
+struct ArmScheduler::Impl
+{
+	enum TaskStatus {
+		TASK_WAITING, // in the timer heap
+		TASK_READY,   // in the ready queue
+		TASK_RUNNING,
+	};
+
+	struct TaskState {
+		TaskStatus               status;
+		uint64_t                 deadline; // monotonic time in msec
+		uint64_t                 sequence;
+		bool                     wakeUpRequested;
+		MetricHistogram         *lag;
+		MetricCounter           *numLateRuns;
+		list<SimpleSemaphore *>  finishWaiters;
+
+		TaskState(void)
+		: status(TASK_WAITING),
+		  deadline(0),
+		  sequence(0),
+		  wakeUpRequested(false),
+		  lag(NULL),
+		  numLateRuns(NULL)
+		{
+		}
+	};
+	typedef map<Task *, TaskState>  TaskStateMap;
+	typedef TaskStateMap::iterator  TaskStateMapIterator;
+
+	// An entry becomes stale when the sequence of the task is updated.
+	// Such entries are just dropped when they reach the top of the heap.
+	struct TimerEntry {
+		uint64_t  deadline;
+		uint64_t  sequence;
+		Task     *task;
+
+		// The earliest deadline has the highest priority.
+		bool operator<(const TimerEntry &rhs) const
+		{
+			return deadline > rhs.deadline;
+		}
+	};
+
+	struct Dispatcher : public HatoholThreadBase {
+		ArmScheduler::Impl *impl;
+
+		Dispatcher(ArmScheduler::Impl *_impl)
+		: impl(_impl)
+		{
+		}
+
+		virtual gpointer mainThread(HatoholThreadArg *arg) override
+		{
+			impl->dispatch();
+			return NULL;
+		}
+	};
+
+	struct Worker : public HatoholThreadBase {
+		ArmScheduler::Impl *impl;
+
+		Worker(ArmScheduler::Impl *_impl)
+		: impl(_impl)
+		{
+		}
+
+		virtual gpointer mainThread(HatoholThreadArg *arg) override
+		{
+			impl->work();
+			return NULL;
+		}
+	};
+
+	static Mutex          instanceLock;
+	static ArmScheduler  *instance;
+
+	Mutex                 lock;
+	TaskStateMap          taskStateMap;
+	priority_queue<TimerEntry> timerHeap;
+	deque<Task *>         readyQueue;
+	uint64_t              sequenceCounter;
+	SimpleSemaphore       dispatchSem;
+	SimpleSemaphore       readySem;
+	AtomicValue<bool>     quit;
+	Dispatcher            dispatcher;
+	vector<Worker *>      workers;
+	MetricGauge          &numBusyWorkers;
+
+	Impl(const size_t &numWorkers)
+	: sequenceCounter(0),
+	  dispatchSem(0),
+	  readySem(0),
+	  quit(false),
+	  dispatcher(this),
+	  numBusyWorkers(MetricsRegistry::getInstance()->getGauge(
+	    "hatohol_arm_scheduler_busy_workers",
+	    "The number of workers of the arm scheduler running a task"))
+	{
+		HATOHOL_ASSERT(numWorkers > 0, "No worker.\n");
+		for (size_t i = 0; i < numWorkers; i++) {
+			workers.push_back(new Worker(this));
+			workers.back()->start();
+		}
+		dispatcher.start();
+	}
+
+	virtual ~Impl()
+	{
+		quit = true;
+		dispatchSem.post();
+		dispatcher.waitExit();
+		for (size_t i = 0; i < workers.size(); i++)
+			readySem.post();
+		for (size_t i = 0; i < workers.size(); i++) {
+			workers[i]->waitExit();
+			delete workers[i];
+		}
+
+		// Don't leave the waiters blocked.
+		TaskStateMapIterator it = taskStateMap.begin();
+		for (; it != taskStateMap.end(); ++it)
+			notifyFinish(it->second);
+	}
+
+	// Call with the lock.
+	void schedule(Task *task, TaskState &state, const uint64_t &deadline)
+	{
+		state.status = TASK_WAITING;
+		state.deadline = deadline;
+		state.sequence = ++sequenceCounter;
+
+		TimerEntry entry;
+		entry.deadline = deadline;
+		entry.sequence = state.sequence;
+		entry.task = task;
+		timerHeap.push(entry);
+		dispatchSem.post();
+	}
+
+	// Call with the lock.
+	void notifyFinish(TaskState &state)
+	{
+		list<SimpleSemaphore *>::iterator it =
+		  state.finishWaiters.begin();
+		for (; it != state.finishWaiters.end(); ++it)
+			(*it)->post();
+		state.finishWaiters.clear();
+	}
+
+	void dispatch(void)
+	{
+		while (!quit) {
+			size_t waitMSec = IDLE_WAIT_MSEC;
+			lock.lock();
+			const uint64_t now = getMonotonicMSec();
+			while (!timerHeap.empty()) {
+				const TimerEntry entry = timerHeap.top();
+				TaskStateMapIterator it =
+				  taskStateMap.find(entry.task);
+				if (it == taskStateMap.end() ||
+				    it->second.sequence != entry.sequence ||
+				    it->second.status != TASK_WAITING) {
+					timerHeap.pop();
+					continue;
+				}
+				if (entry.deadline > now) {
+					waitMSec = entry.deadline - now;
+					break;
+				}
+				timerHeap.pop();
+				it->second.status = TASK_READY;
+				readyQueue.push_back(entry.task);
+				readySem.post();
+			}
+			lock.unlock();
+			dispatchSem.timedWait(waitMSec);
+		}
+	}
+
+	void work(void)
+	{
+		while (true) {
+			readySem.wait();
+			if (quit)
+				break;
+
+			lock.lock();
+			HATOHOL_ASSERT(!readyQueue.empty(),
+			               "The ready queue is empty.\n");
+			Task *task = readyQueue.front();
+			readyQueue.pop_front();
+			TaskState &state = taskStateMap[task];
+			state.status = TASK_RUNNING;
+			const uint64_t now = getMonotonicMSec();
+			const uint64_t lagMSec =
+			  now > state.deadline ? now - state.deadline : 0;
+			state.lag->observe(lagMSec * 1000);
+			if (lagMSec > LATE_THRESHOLD_MSEC)
+				state.numLateRuns->add();
+			lock.unlock();
+
+			numBusyWorkers.add();
+			int nextSec = FINISHED;
+			try {
+				nextSec = task->runOnce();
+			} catch (const exception &e) {
+				MLPL_ERR("Got an exception: %s\n", e.what());
+			}
+			numBusyWorkers.sub();
+
+			finishRun(task, nextSec);
+		}
+	}
+
+	void finishRun(Task *task, const int &nextSec)
+	{
+		AutoMutex autoMutex(&lock);
+		TaskStateMapIterator it = taskStateMap.find(task);
+		HATOHOL_ASSERT(it != taskStateMap.end(),
+		               "Unknown task: %p\n", task);
+		TaskState &state = it->second;
+		if (nextSec == FINISHED) {
+			notifyFinish(state);
+			taskStateMap.erase(it);
+			return;
+		}
+		uint64_t deadline = getMonotonicMSec();
+		if (!state.wakeUpRequested)
+			deadline += (uint64_t)nextSec * 1000;
+		state.wakeUpRequested = false;
+		schedule(task, state, deadline);
+	}
+};
+
+Mutex          ArmScheduler::Impl::instanceLock;
+ArmScheduler  *ArmScheduler::Impl::instance = NULL;
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+ArmScheduler *ArmScheduler::getInstance(void)
+{
+	AutoMutex autoMutex(&Impl::instanceLock);
+	if (!Impl::instance) {
+		ConfigManager *confMgr = ConfigManager::getInstance();
+		Impl::instance =
+		  new ArmScheduler(confMgr->getNumberOfArmSchedulerWorkers());
+	}
+	return Impl::instance;
+}
+
+ArmScheduler::ArmScheduler(const size_t &numWorkers)
+: m_impl(new Impl(numWorkers))
+{
+}
+
+ArmScheduler::~ArmScheduler()
+{
+}
+
+size_t ArmScheduler::getNumberOfWorkers(void) const
+{
+	return m_impl->workers.size();
+}
+
+void ArmScheduler::add(Task *task, const int &spreadSec,
+                       const string &metricLabels)
+{
+	MetricsRegistry *metrics = MetricsRegistry::getInstance();
+	uint64_t deadline = getMonotonicMSec();
+	if (spreadSec > 0)
+		deadline += random() % ((uint64_t)spreadSec * 1000);
+
+	AutoMutex autoMutex(&m_impl->lock);
+	HATOHOL_ASSERT(
+	  m_impl->taskStateMap.find(task) == m_impl->taskStateMap.end(),
+	  "The task has already been added: %p\n", task);
+	Impl::TaskState &state = m_impl->taskStateMap[task];
+	state.lag = &metrics->getHistogram(
+	  "hatohol_arm_scheduler_lag_seconds",
+	  "Time from the deadline to the start of a run of an arm",
+	  MetricsRegistry::UNIT_MICRO_SEC, metricLabels);
+	state.numLateRuns = &metrics->getCounter(
+	  "hatohol_arm_scheduler_late_runs_total",
+	  "The number of runs of an arm started after the deadline",
+	  metricLabels);
+	m_impl->schedule(task, state, deadline);
+}
+
+void ArmScheduler::wakeUp(Task *task)
+{
+	AutoMutex autoMutex(&m_impl->lock);
+	Impl::TaskStateMapIterator it = m_impl->taskStateMap.find(task);
+	if (it == m_impl->taskStateMap.end())
+		return;
+	Impl::TaskState &state = it->second;
+	if (state.status == Impl::TASK_RUNNING)
+		state.wakeUpRequested = true;
+	else if (state.status == Impl::TASK_WAITING)
+		m_impl->schedule(task, state, getMonotonicMSec());
+	// A task in the ready queue will run soon. Nothing to do.
+}
+
+void ArmScheduler::waitForFinish(Task *task)
+{
+	SimpleSemaphore finished(0);
+	m_impl->lock.lock();
+	Impl::TaskStateMapIterator it = m_impl->taskStateMap.find(task);
+	if (it == m_impl->taskStateMap.end()) {
+		m_impl->lock.unlock();
+		return;
+	}
+	it->second.finishWaiters.push_back(&finished);
+	m_impl->lock.unlock();
+	finished.wait();
+}
+
+size_t ArmScheduler::getNumberOfTasks(void) const
+{
+	AutoMutex autoMutex(&m_impl->lock);
+	return m_impl->taskStateMap.size();
+}
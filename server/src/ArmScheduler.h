@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ArmScheduler_h
+#define ArmScheduler_h
+
+#include <string>
+#include <memory>
+#include "Params.h"
+
+/**
+ * ArmScheduler runs periodic tasks such as the polling of arms on a
+ * fixed number of worker threads instead of a thread for each task.
+ * The number of workers is also the maximum number of tasks that run
+ * at the same time.
+ */
+class ArmScheduler {
+public:
+	static const int FINISHED = -1;
+
+	class Task {
+	public:
+		virtual ~Task();
+
+		/**
+		 * Run one cycle of the task. This is called on a worker
+		 * thread of the scheduler.
+		 *
+		 * @return
+		 * The seconds to the next run, or FINISHED to remove the
+		 * task from the scheduler.
+		 */
+		virtual int runOnce(void) = 0;
+	};
+
+	/**
+	 * Get the scheduler shared by the arms. The number of workers is
+	 * taken from ConfigManager when this is called at the first time.
+	 */
+	static ArmScheduler *getInstance(void);
+
+	ArmScheduler(const size_t &numWorkers);
+	virtual ~ArmScheduler();
+
+	size_t getNumberOfWorkers(void) const;
+
+	/**
+	 * Add a task.
+	 *
+	 * @param task A task. The owner is still the caller.
+	 * @param spreadSec
+	 * The first run is placed at a random point within this period
+	 * so that many tasks added at once don't run at the same time.
+	 * @param metricLabels
+	 * Labels of the metrics of the lag from the deadline of each run.
+	 */
+	void add(Task *task, const int &spreadSec,
+	         const std::string &metricLabels = "");
+
+	/**
+	 * Move the next run of a task to now. If the task is running, it
+	 * runs again as soon as the current run finishes.
+	 *
+	 * @param task A task that has been added.
+	 */
+	void wakeUp(Task *task);
+
+	/**
+	 * Wait until a task returns FINISHED. This returns immediately if
+	 * the task has already finished or hasn't been added. It must not
+	 * be called from runOnce() of the task itself.
+	 *
+	 * @param task A task.
+	 */
+	void waitForFinish(Task *task);
+
+	/**
+	 * Get the number of the tasks that have been added and have not
+	 * finished.
+	 */
+	size_t getNumberOfTasks(void) const;
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // ArmScheduler_h
@@ -19,9 +19,11 @@
 
 #include <Logger.h>
 #include <Mutex.h>
+#include <SimpleSemaphore.h>
 using namespace mlpl;
 
 #include <sstream>
+#include <map>
 #include <libsoup/soup.h>
 #include <json-glib/json-glib.h>
 
@@ -35,34 +37,121 @@ using namespace mlpl;
 #include "HatoholDBUtils.h"
 #include "HostInfoCache.h"
 #include "ThreadLocalDBCache.h"
+#include "HatoholThreadBase.h"
+#include "ConfigManager.h"
 
 using namespace std;
 
 static const uint64_t NUMBER_OF_GET_EVENT_PER_ONCE  = 1000;
 static const guint DEFAULT_IDLE_TIMEOUT = 60;
 
+class connectionException : public HatoholException {};
+
+// Fetches triggers on another thread while the arm's thread gets
+// the other tables through the same session. The thread is started at
+// the first request and reused by the following polls.
+class ArmZabbixAPI::TriggerFetcher : public HatoholThreadBase {
+public:
+	TriggerFetcher(ArmZabbixAPI &zbxAPI)
+	: m_zbxAPI(zbxAPI),
+	  m_requestSince(0),
+	  m_requestSem(0),
+	  m_doneSem(0)
+	{
+	}
+
+	virtual ~TriggerFetcher()
+	{
+		if (isStarted())
+			exitSync();
+	}
+
+	/**
+	 * Start a fetch. getTriggers() has to be called before the next
+	 * request.
+	 */
+	void request(const int &requestSince)
+	{
+		m_requestSince = requestSince;
+		if (!isStarted())
+			start();
+		m_requestSem.post();
+	}
+
+	/**
+	 * Wait for the end of the fetch and get the triggers. An exception
+	 * thrown in the fetch is thrown again here.
+	 */
+	ItemTablePtr getTriggers(void)
+	{
+		m_doneSem.wait();
+		ItemTablePtr triggers = m_triggers;
+		m_triggers = ItemTablePtr();
+		if (m_exception.get()) {
+			unique_ptr<HatoholException>
+			  exception(m_exception.release());
+			throw *exception;
+		}
+		return triggers;
+	}
+
+	virtual void waitExit(void) override
+	{
+		// Wake up the thread waiting for a request.
+		m_requestSem.post();
+		HatoholThreadBase::waitExit();
+	}
+
+protected:
+	virtual gpointer mainThread(HatoholThreadArg *arg) override
+	{
+		while (true) {
+			m_requestSem.wait();
+			if (isExitRequested())
+				break;
+			try {
+				m_triggers = m_zbxAPI.getTrigger(m_requestSince);
+			} catch (const HatoholException &he) {
+				m_exception = unique_ptr<HatoholException>(
+				  new HatoholException(he));
+			}
+			m_doneSem.post();
+		}
+		return NULL;
+	}
+
+private:
+	ArmZabbixAPI                 &m_zbxAPI;
+	int                           m_requestSince;
+	SimpleSemaphore               m_requestSem;
+	SimpleSemaphore               m_doneSem;
+	ItemTablePtr                  m_triggers;
+	unique_ptr<HatoholException>  m_exception;
+};
+
 struct ArmZabbixAPI::Impl
 {
 	const ServerIdType zabbixServerId;
-	HostInfoCache      hostInfoCache;
+	TriggerFetcher     triggerFetcher;
 
 	// constructors
-	Impl(const MonitoringServerInfo &serverInfo)
-	: zabbixServerId(serverInfo.id)
+	Impl(ArmZabbixAPI &zbxAPI, const MonitoringServerInfo &serverInfo)
+	: zabbixServerId(serverInfo.id),
+	  triggerFetcher(zbxAPI)
 	{
 	}
 };
 
-class connectionException : public HatoholException {};
-
 // ---------------------------------------------------------------------------
 // Public methods
 // ---------------------------------------------------------------------------
 ArmZabbixAPI::ArmZabbixAPI(const MonitoringServerInfo &serverInfo)
 : ArmBase("ArmZabbixAPI", serverInfo),
-  m_impl(new Impl(serverInfo))
+  m_impl(new Impl(*this, serverInfo))
 {
 	setMonitoringServerInfo(serverInfo);
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	setMaxConnections(confMgr->getZabbixAPIMaxConnections());
 }
 
 ArmZabbixAPI::~ArmZabbixAPI()
@@ -78,12 +167,16 @@ void ArmZabbixAPI::onGotNewEvents(const ItemTablePtr &itemPtr)
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
-ItemTablePtr ArmZabbixAPI::updateTriggers(void)
+int ArmZabbixAPI::getTriggerRequestSince(void)
 {
 	UnifiedDataStore *uds = UnifiedDataStore::getInstance();
 	SmartTime last = uds->getTimestampOfLastTrigger(m_impl->zabbixServerId);
-	const int requestSince = last.getAsTimespec().tv_sec;
-	return getTrigger(requestSince);
+	return last.getAsTimespec().tv_sec;
+}
+
+ItemTablePtr ArmZabbixAPI::updateTriggers(void)
+{
+	return getTrigger(getTriggerRequestSince());
 }
 
 void ArmZabbixAPI::updateItems(void)
@@ -101,6 +194,15 @@ void ArmZabbixAPI::updateHosts(void)
 	makeHatoholMapHostsHostgroups(hostsGroupsTablePtr);
 }
 
+void ArmZabbixAPI::updateHostsAndGroups(void)
+{
+	ItemTablePtr hostTablePtr, hostsGroupsTablePtr, groupTablePtr;
+	getHostsAndGroups(hostTablePtr, hostsGroupsTablePtr, groupTablePtr);
+	makeHatoholHosts(hostTablePtr);
+	makeHatoholMapHostsHostgroups(hostsGroupsTablePtr);
+	makeHatoholHostgroups(groupTablePtr);
+}
+
 void ArmZabbixAPI::updateEvents(void)
 {
 	const EventIdType serverLastEventId = getEndEventId(false);
@@ -109,9 +211,9 @@ void ArmZabbixAPI::updateEvents(void)
 		return;
 	}
 
-	ThreadLocalDBCache cache;
 	const EventIdType dbLastEventId =
-	  cache.getMonitoring().getLastEventId(m_impl->zabbixServerId);
+	  UnifiedDataStore::getInstance()->getLastEventId(
+	    m_impl->zabbixServerId);
 	MLPL_DBG("The last event ID in Hatohol DB: %" FMT_EVENT_ID "\n", dbLastEventId);
 	EventIdType eventIdFrom = dbLastEventId == EVENT_ID_NOT_FOUND ?
 	                          getEndEventId(true) :
@@ -146,7 +248,7 @@ void ArmZabbixAPI::updateGroups(void)
 //
 // virtual methods
 //
-gpointer ArmZabbixAPI::mainThread(HatoholThreadArg *arg)
+void ArmZabbixAPI::prepareForPolling(void)
 {
 	const MonitoringServerInfo &svInfo = getServerInfo();
 	MLPL_INFO("started: ArmZabbixAPI (server: %s)\n",
@@ -160,17 +262,15 @@ gpointer ArmZabbixAPI::mainThread(HatoholThreadArg *arg)
 	ArmBase::registerAvailableTrigger(COLLECT_NG_INTERNAL_ERROR,
 					  FAILED_INTERNAL_ERROR_TRIGGER_ID,
 					  HTERR_INTERNAL_ERROR);
-	return ArmBase::mainThread(arg);
 }
 
 void ArmZabbixAPI::makeHatoholTriggers(ItemTablePtr triggers)
 {
-	ThreadLocalDBCache cache;
 	TriggerInfoList triggerInfoList;
 	HatoholDBUtils::transformTriggersToHatoholFormat(
 	  triggerInfoList, triggers, m_impl->zabbixServerId,
-	  m_impl->hostInfoCache);
-	cache.getMonitoring().addTriggerInfoList(triggerInfoList);
+	  HostInfoCache::getInstance(m_impl->zabbixServerId));
+	UnifiedDataStore::getInstance()->addTriggerList(triggerInfoList);
 }
 
 void ArmZabbixAPI::makeHatoholEvents(ItemTablePtr events)
@@ -181,6 +281,7 @@ void ArmZabbixAPI::makeHatoholEvents(ItemTablePtr events)
 
 	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
 	dataStore->addEventList(eventInfoList);
+	countPolledEvents(eventInfoList.size());
 }
 
 void ArmZabbixAPI::makeHatoholItems(
@@ -193,7 +294,7 @@ void ArmZabbixAPI::makeHatoholItems(
 	serverStatus.serverId = m_impl->zabbixServerId;
 	HatoholDBUtils::transformItemsToHatoholFormat(
 	  itemInfoList, serverStatus, items, applications);
-	dbMonitoring.addItemInfoList(itemInfoList);
+	UnifiedDataStore::getInstance()->addItemList(itemInfoList);
 	dbMonitoring.addMonitoringServerStatus(&serverStatus);
 }
 
@@ -222,11 +323,6 @@ void ArmZabbixAPI::makeHatoholHosts(ItemTablePtr hosts)
 	HatoholDBUtils::transformHostsToHatoholFormat(hostInfoList, hosts,
 	                                              m_impl->zabbixServerId);
 	cache.getMonitoring().updateHosts(hostInfoList, m_impl->zabbixServerId);
-
-	// TODO: consider if DBClientHatohol should have the cache
-	HostInfoListConstIterator hostInfoItr = hostInfoList.begin();
-	for (; hostInfoItr != hostInfoList.end(); ++hostInfoItr)
-		m_impl->hostInfoCache.update(*hostInfoItr);
 }
 
 uint64_t ArmZabbixAPI::getMaximumNumberGetEventPerOnce(void)
@@ -260,10 +356,20 @@ ArmBase::ArmPollingResult ArmZabbixAPI::mainThreadOneProc(void)
 		return COLLECT_NG_DISCONNECT_ZABBIX;
 
 	try {
-		ItemTablePtr triggers = updateTriggers();
-		updateHosts();
-		updateGroups();
-		makeHatoholTriggers(triggers);
+		// The session has to be created before it's shared.
+		getSession();
+		TriggerFetcher &triggerFetcher = m_impl->triggerFetcher;
+		triggerFetcher.request(getTriggerRequestSince());
+		try {
+			updateHostsAndGroups();
+		} catch (...) {
+			try {
+				triggerFetcher.getTriggers();
+			} catch (...) {
+			}
+			throw;
+		}
+		makeHatoholTriggers(triggerFetcher.getTriggers());
 		updateEvents();
 
 		if (!getCopyOnDemandEnabled())
@@ -308,6 +414,38 @@ ArmBase::ArmPollingResult ArmZabbixAPI::mainThreadOneProcFetchHistory(
 	return COLLECT_OK;
 }
 
+ArmBase::ArmPollingResult ArmZabbixAPI::mainThreadOneProcFetchHistories(
+  HistoryInfoVect &historyInfoVect, const ItemInfoList &itemInfoList,
+  const time_t &beginTime, const time_t &endTime)
+{
+	if (!updateAuthTokenIfNeeded())
+		return COLLECT_NG_DISCONNECT_ZABBIX;
+
+	// history.get takes a value type, so one call is issued per type.
+	typedef map<ZabbixAPI::ValueType, vector<ItemIdType> > ItemIdsMap;
+	ItemIdsMap itemIdsMap;
+	ItemInfoListConstIterator it = itemInfoList.begin();
+	for (; it != itemInfoList.end(); ++it) {
+		const ZabbixAPI::ValueType valueType =
+		  ZabbixAPI::fromItemValueType(it->valueType);
+		itemIdsMap[valueType].push_back(it->id);
+	}
+
+	try {
+		ItemIdsMap::const_iterator idsIt = itemIdsMap.begin();
+		for (; idsIt != itemIdsMap.end(); ++idsIt) {
+			ItemTablePtr itemTablePtr = getHistory(
+			  idsIt->second, idsIt->first, beginTime, endTime);
+			HatoholDBUtils::transformHistoryToHatoholFormat(
+			  historyInfoVect, itemTablePtr,
+			  m_impl->zabbixServerId);
+		}
+	} catch (const HatoholException &he) {
+		return handleHatoholException(he);
+	}
+	return COLLECT_OK;
+}
+
 // ---------------------------------------------------------------------------
 // Private methods
 // ---------------------------------------------------------------------------
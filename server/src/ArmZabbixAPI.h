@@ -43,6 +43,7 @@ public:
 	virtual void onGotNewEvents(const ItemTablePtr &itemPtr);
 
 protected:
+	int getTriggerRequestSince(void);
 	ItemTablePtr updateTriggers(void);
 	void updateItems(void);
 
@@ -61,6 +62,12 @@ protected:
 
 	void updateGroups(void);
 
+	/**
+	 * Get all hosts and groups in the ZABBIX server with a batch
+	 * request and save them in the Hatohol DB.
+	 */
+	void updateHostsAndGroups(void);
+
 	void makeHatoholTriggers(ItemTablePtr triggers);
 	void makeHatoholEvents(ItemTablePtr events);
 	void makeHatoholItems(ItemTablePtr items, ItemTablePtr applications);
@@ -73,7 +80,7 @@ protected:
 	ArmPollingResult handleHatoholException(const HatoholException &he);
 
 	// virtual methods
-	virtual gpointer mainThread(HatoholThreadArg *arg);
+	virtual void prepareForPolling(void);
 	virtual ArmPollingResult mainThreadOneProc(void);
 	virtual ArmPollingResult mainThreadOneProcFetchItems(void);
 	virtual ArmPollingResult mainThreadOneProcFetchHistory(
@@ -81,9 +88,15 @@ protected:
 	  const ItemInfo &itemInfo,
 	  const time_t &beginTime,
 	  const time_t &endTime);
+	virtual ArmPollingResult mainThreadOneProcFetchHistories(
+	  HistoryInfoVect &historyInfoVect,
+	  const ItemInfoList &itemInfoList,
+	  const time_t &beginTime,
+	  const time_t &endTime);
 
 private:
 	struct Impl;
+	class TriggerFetcher;
 	std::unique_ptr<Impl> m_impl;
 };
 
@@ -47,6 +47,11 @@ static int DEFAULT_ALLOWED_TIME_OF_ACTION_FOR_OLD_EVENTS
 const char *ConfigManager::DEFAULT_PID_FILE_PATH = LOCALSTATEDIR "/run/hatohol.pid";
 
 static int DEFAULT_MAX_NUM_RUNNING_COMMAND_ACTION = 10;
+static const size_t DEFAULT_ZABBIX_API_MAX_CONNECTIONS = 4;
+static const size_t DEFAULT_EVENT_FLAP_START_THRESHOLD = 6;
+static const size_t DEFAULT_EVENT_FLAP_STOP_THRESHOLD = 2;
+static const size_t DEFAULT_EVENT_CORRELATION_WINDOW = 300;
+static const size_t DEFAULT_EVENT_ADMISSION_BURST = 1000;
 
 static gboolean parseFaceRestPort(
   const gchar *option_name, const gchar *value,
@@ -82,12 +87,14 @@ static void showVersion(void)
 // CommandLineOptions
 // ---------------------------------------------------------------------------
 CommandLineOptions::CommandLineOptions(void)
-: pidFilePath(NULL),
+: configFilePath(NULL),
+  pidFilePath(NULL),
   user(NULL),
   dbServer(NULL),
   dbName(NULL),
   dbUser(NULL),
   dbPassword(NULL),
+  dbPoolSize(-1),
   foreground(FALSE),
   testMode(FALSE),
   enableCopyOnDemand(FALSE),
@@ -106,6 +113,20 @@ struct ConfigManager::Impl {
 	string                databaseDirectory;
 	string                actionCommandDirectory;
 	string                residentYardDirectory;
+	string                ndoStreamDirectory;
+	bool                  hapLocalChannelEnabled;
+	size_t                numArmSchedulerWorkers;
+	bool                  adaptivePollingEnabled;
+	size_t                zabbixAPIMaxConnections;
+	size_t                numHistoryCacheItems;
+	size_t                eventFlapWindow;
+	size_t                eventFlapStartThreshold;
+	size_t                eventFlapStopThreshold;
+	size_t                eventCorrelationWindow;
+	size_t                eventAdmissionRate;
+	size_t                eventAdmissionBurst;
+	size_t                ingestionJournalSize;
+	size_t                groupCommitDelay;
 	bool                  foreground;
 	string                dbServerAddress;
 	int                   dbServerPort;
@@ -117,7 +138,20 @@ struct ConfigManager::Impl {
 
 	// methods
 	Impl(void)
-	: foreground(false),
+	: hapLocalChannelEnabled(false),
+	  numArmSchedulerWorkers(0),
+	  adaptivePollingEnabled(false),
+	  zabbixAPIMaxConnections(DEFAULT_ZABBIX_API_MAX_CONNECTIONS),
+	  numHistoryCacheItems(0),
+	  eventFlapWindow(0),
+	  eventFlapStartThreshold(DEFAULT_EVENT_FLAP_START_THRESHOLD),
+	  eventFlapStopThreshold(DEFAULT_EVENT_FLAP_STOP_THRESHOLD),
+	  eventCorrelationWindow(DEFAULT_EVENT_CORRELATION_WINDOW),
+	  eventAdmissionRate(0),
+	  eventAdmissionBurst(DEFAULT_EVENT_ADMISSION_BURST),
+	  ingestionJournalSize(0),
+	  groupCommitDelay(0),
+	  foreground(false),
 	  dbServerAddress("localhost"),
 	  dbServerPort(0),
 	  testMode(false),
@@ -182,6 +216,13 @@ struct ConfigManager::Impl {
 		}
 
 		loadConfigFileMySQLGroup(keyFile);
+		loadConfigFileNDOUtilsGroup(keyFile);
+		loadConfigFileHapGroup(keyFile);
+		loadConfigFileArmGroup(keyFile);
+		loadConfigFileZabbixGroup(keyFile);
+		loadConfigFileHistoryGroup(keyFile);
+		loadConfigFileEventGroup(keyFile);
+		loadConfigFileIngestionGroup(keyFile);
 
 		return true;
 	}
@@ -193,6 +234,10 @@ struct ConfigManager::Impl {
 		DBHatohol::setDefaultDBParams(cmdLineOpts.dbName,
 		                              cmdLineOpts.dbUser,
 		                              cmdLineOpts.dbPassword);
+		if (cmdLineOpts.dbPoolSize > 0) {
+			ThreadLocalDBCache::setMaxNumberOfConnections(
+			  cmdLineOpts.dbPoolSize);
+		}
 		if (cmdLineOpts.foreground)
 			foreground = true;
 		if (cmdLineOpts.testMode)
@@ -210,6 +255,176 @@ struct ConfigManager::Impl {
 	}
 
 private:
+	void loadConfigFileNDOUtilsGroup(GKeyFile *keyFile)
+	{
+		const gchar *group = "ndoutils";
+
+		if (!g_key_file_has_group(keyFile, group))
+			return;
+
+		gchar *streamDirectory = g_key_file_get_string(
+		  keyFile, group, "stream_directory", NULL);
+		if (streamDirectory)
+			ndoStreamDirectory = streamDirectory;
+		g_free(streamDirectory);
+	}
+
+	void loadConfigFileHapGroup(GKeyFile *keyFile)
+	{
+		const gchar *group = "hap";
+
+		if (!g_key_file_has_group(keyFile, group))
+			return;
+
+		if (!g_key_file_has_key(keyFile, group, "local_channel", NULL))
+			return;
+		GError *error = NULL;
+		gboolean localChannel = g_key_file_get_boolean(
+		  keyFile, group, "local_channel", &error);
+		if (error) {
+			MLPL_ERR("Invalid local_channel: %s\n", error->message);
+			g_error_free(error);
+			return;
+		}
+		hapLocalChannelEnabled = localChannel;
+	}
+
+	/**
+	 * Load an integer that must not be negative.
+	 *
+	 * @return
+	 * The loaded value. defaultValue if the key doesn't exist or the
+	 * value is invalid. An invalid value is logged.
+	 */
+	static size_t loadNonNegativeInteger(GKeyFile *keyFile,
+	                                     const gchar *group,
+	                                     const gchar *key,
+	                                     const size_t &defaultValue)
+	{
+		if (!g_key_file_has_key(keyFile, group, key, NULL))
+			return defaultValue;
+		GError *error = NULL;
+		const gint value =
+		  g_key_file_get_integer(keyFile, group, key, &error);
+		if (error) {
+			MLPL_ERR("Invalid %s in [%s]: %s\n",
+			         key, group, error->message);
+			g_error_free(error);
+			return defaultValue;
+		}
+		if (value < 0) {
+			MLPL_ERR("Invalid %s in [%s]: %d\n", key, group, value);
+			return defaultValue;
+		}
+		return value;
+	}
+
+	void loadConfigFileArmGroup(GKeyFile *keyFile)
+	{
+		const gchar *group = "arm";
+
+		if (!g_key_file_has_group(keyFile, group))
+			return;
+
+		numArmSchedulerWorkers = loadNonNegativeInteger(
+		  keyFile, group, "scheduler_workers", numArmSchedulerWorkers);
+
+		GError *error = NULL;
+		gboolean adaptivePolling = g_key_file_get_boolean(
+		  keyFile, group, "adaptive_polling", &error);
+		if (error) {
+			g_error_free(error);
+			return;
+		}
+		adaptivePollingEnabled = adaptivePolling;
+	}
+
+	void loadConfigFileZabbixGroup(GKeyFile *keyFile)
+	{
+		const gchar *group = "zabbix";
+
+		if (!g_key_file_has_group(keyFile, group))
+			return;
+
+		const size_t maxConnections = loadNonNegativeInteger(
+		  keyFile, group, "max_connections", zabbixAPIMaxConnections);
+		if (maxConnections == 0) {
+			MLPL_ERR("Invalid max_connections in [%s]: 0\n", group);
+			return;
+		}
+		zabbixAPIMaxConnections = maxConnections;
+	}
+
+	void loadConfigFileIngestionGroup(GKeyFile *keyFile)
+	{
+		const gchar *group = "ingestion";
+
+		if (!g_key_file_has_group(keyFile, group))
+			return;
+
+		ingestionJournalSize = loadNonNegativeInteger(
+		  keyFile, group, "journal_size", ingestionJournalSize);
+		groupCommitDelay = loadNonNegativeInteger(
+		  keyFile, group, "group_commit_delay", groupCommitDelay);
+	}
+
+	void loadConfigFileHistoryGroup(GKeyFile *keyFile)
+	{
+		const gchar *group = "history";
+
+		if (!g_key_file_has_group(keyFile, group))
+			return;
+
+		numHistoryCacheItems = loadNonNegativeInteger(
+		  keyFile, group, "cache_items", numHistoryCacheItems);
+	}
+
+	void loadConfigFileEventGroup(GKeyFile *keyFile)
+	{
+		const gchar *group = "event";
+
+		if (!g_key_file_has_group(keyFile, group))
+			return;
+
+		loadConfigFileEventFlapKeys(keyFile, group);
+		eventCorrelationWindow = loadNonNegativeInteger(
+		  keyFile, group, "correlation_window", eventCorrelationWindow);
+		loadConfigFileEventAdmissionKeys(keyFile, group);
+	}
+
+	void loadConfigFileEventAdmissionKeys(GKeyFile *keyFile,
+	                                      const gchar *group)
+	{
+		const size_t burst = loadNonNegativeInteger(
+		  keyFile, group, "admission_burst", eventAdmissionBurst);
+		if (burst == 0) {
+			MLPL_ERR("Invalid admission_burst in [%s]: 0\n", group);
+			return;
+		}
+		eventAdmissionRate = loadNonNegativeInteger(
+		  keyFile, group, "admission_rate", eventAdmissionRate);
+		eventAdmissionBurst = burst;
+	}
+
+	void loadConfigFileEventFlapKeys(GKeyFile *keyFile, const gchar *group)
+	{
+		const size_t startThreshold = loadNonNegativeInteger(
+		  keyFile, group, "flap_start_changes",
+		  eventFlapStartThreshold);
+		const size_t stopThreshold = loadNonNegativeInteger(
+		  keyFile, group, "flap_stop_changes", eventFlapStopThreshold);
+		if (startThreshold <= stopThreshold) {
+			MLPL_ERR("Invalid flap_start_changes: %zd, "
+			         "flap_stop_changes: %zd\n",
+			         startThreshold, stopThreshold);
+			return;
+		}
+		eventFlapWindow = loadNonNegativeInteger(
+		  keyFile, group, "flap_window", eventFlapWindow);
+		eventFlapStartThreshold = startThreshold;
+		eventFlapStopThreshold = stopThreshold;
+	}
+
 	void loadConfigFileMySQLGroup(GKeyFile *keyFile)
 	{
 		const gchar *group = "mysql";
@@ -227,6 +442,11 @@ private:
 		g_free(database);
 		g_free(user);
 		g_free(password);
+
+		const size_t poolSize =
+		  loadNonNegativeInteger(keyFile, group, "pool_size", 0);
+		if (poolSize > 0)
+			ThreadLocalDBCache::setMaxNumberOfConnections(poolSize);
 	}
 };
 
@@ -244,6 +464,10 @@ bool ConfigManager::parseCommandLine(gint *argc, gchar ***argv,
 		{"version",
 		 'v', 0, G_OPTION_ARG_NONE,
 		 &showVersionFlag, "Show the version", NULL},
+		{"config-file",
+		 0, 0, G_OPTION_ARG_STRING,
+		 &cmdLineOpts->configFilePath,
+		 "Configuration file path", NULL},
 		{"pid-file",
 		 'p', 0, G_OPTION_ARG_STRING,
 		 &cmdLineOpts->pidFilePath, "Pid file path", NULL},
@@ -265,6 +489,10 @@ bool ConfigManager::parseCommandLine(gint *argc, gchar ***argv,
 		{"db-password",
 		 'w', 0, G_OPTION_ARG_STRING,
 		 &cmdLineOpts->dbPassword, "Database password", NULL},
+		{"db-pool-size",
+		 0, 0, G_OPTION_ARG_INT,
+		 &cmdLineOpts->dbPoolSize,
+		 "Maximum number of concurrent database connections", NULL},
 		{"enable-copy-on-demand",
 		 'e', 0, G_OPTION_ARG_NONE,
 		 &cmdLineOpts->enableCopyOnDemand,
@@ -317,6 +545,14 @@ void ConfigManager::reset(const CommandLineOptions *cmdLineOpts)
 	delete Impl::instance;
 	Impl::instance = NULL;
 	ConfigManager *confMgr = getInstance();
+	unique_ptr<const CommandLineOptions> localOpts;
+	if (!cmdLineOpts) {
+		localOpts = unique_ptr<const CommandLineOptions>(
+		  new CommandLineOptions());
+		cmdLineOpts = localOpts.get();
+	}
+	if (cmdLineOpts->configFilePath)
+		confMgr->m_impl->confFilePath = cmdLineOpts->configFilePath;
 	confMgr->loadConfFile();
 
 	confMgr->m_impl->actionCommandDirectory =
@@ -324,12 +560,6 @@ void ConfigManager::reset(const CommandLineOptions *cmdLineOpts)
 	confMgr->m_impl->residentYardDirectory = string(PREFIX"/sbin");
 
 	// override by the command line options if needed
-	unique_ptr<const CommandLineOptions> localOpts;
-	if (!cmdLineOpts) {
-		localOpts = unique_ptr<const CommandLineOptions>(
-		  new CommandLineOptions());
-		cmdLineOpts = localOpts.get();
-	}
 	confMgr->m_impl->reflectCommandLineOptions(*cmdLineOpts);
 }
 
@@ -412,6 +642,174 @@ void ConfigManager::setResidentYardDirectory(const string &dir)
 	m_impl->residentYardDirectory = dir;
 }
 
+string ConfigManager::getNDOStreamDirectory(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->ndoStreamDirectory;
+}
+
+void ConfigManager::setNDOStreamDirectory(const string &dir)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->ndoStreamDirectory = dir;
+}
+
+bool ConfigManager::isHapLocalChannelEnabled(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->hapLocalChannelEnabled;
+}
+
+void ConfigManager::setHapLocalChannelEnabled(const bool &enable)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->hapLocalChannelEnabled = enable;
+}
+
+size_t ConfigManager::getNumberOfArmSchedulerWorkers(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->numArmSchedulerWorkers;
+}
+
+void ConfigManager::setNumberOfArmSchedulerWorkers(const size_t &numWorkers)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->numArmSchedulerWorkers = numWorkers;
+}
+
+bool ConfigManager::isAdaptivePollingEnabled(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->adaptivePollingEnabled;
+}
+
+void ConfigManager::setAdaptivePollingEnabled(const bool &enable)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->adaptivePollingEnabled = enable;
+}
+
+size_t ConfigManager::getZabbixAPIMaxConnections(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->zabbixAPIMaxConnections;
+}
+
+void ConfigManager::setZabbixAPIMaxConnections(const size_t &maxConnections)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->zabbixAPIMaxConnections = maxConnections;
+}
+
+size_t ConfigManager::getNumberOfHistoryCacheItems(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->numHistoryCacheItems;
+}
+
+void ConfigManager::setNumberOfHistoryCacheItems(const size_t &numItems)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->numHistoryCacheItems = numItems;
+}
+
+size_t ConfigManager::getEventFlapWindow(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->eventFlapWindow;
+}
+
+void ConfigManager::setEventFlapWindow(const size_t &window)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->eventFlapWindow = window;
+}
+
+size_t ConfigManager::getEventFlapStartThreshold(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->eventFlapStartThreshold;
+}
+
+void ConfigManager::setEventFlapStartThreshold(const size_t &numChanges)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->eventFlapStartThreshold = numChanges;
+}
+
+size_t ConfigManager::getEventFlapStopThreshold(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->eventFlapStopThreshold;
+}
+
+void ConfigManager::setEventFlapStopThreshold(const size_t &numChanges)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->eventFlapStopThreshold = numChanges;
+}
+
+size_t ConfigManager::getEventCorrelationWindow(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->eventCorrelationWindow;
+}
+
+void ConfigManager::setEventCorrelationWindow(const size_t &window)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->eventCorrelationWindow = window;
+}
+
+size_t ConfigManager::getEventAdmissionRate(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->eventAdmissionRate;
+}
+
+void ConfigManager::setEventAdmissionRate(const size_t &rate)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->eventAdmissionRate = rate;
+}
+
+size_t ConfigManager::getEventAdmissionBurst(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->eventAdmissionBurst;
+}
+
+void ConfigManager::setEventAdmissionBurst(const size_t &numEvents)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->eventAdmissionBurst = numEvents;
+}
+
+size_t ConfigManager::getIngestionJournalSize(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->ingestionJournalSize;
+}
+
+void ConfigManager::setIngestionJournalSize(const size_t &size)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->ingestionJournalSize = size;
+}
+
+size_t ConfigManager::getGroupCommitDelay(void)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->groupCommitDelay;
+}
+
+void ConfigManager::setGroupCommitDelay(const size_t &delay)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->groupCommitDelay = delay;
+}
+
 bool ConfigManager::isTestMode(void) const
 {
 	return m_impl->testMode;
@@ -25,12 +25,14 @@
 #include "DBTablesConfig.h"
 
 struct CommandLineOptions {
+	gchar    *configFilePath;
 	gchar    *pidFilePath;
 	gchar    *user;
 	gchar    *dbServer;
 	gchar    *dbName;
 	gchar    *dbUser;
 	gchar    *dbPassword;
+	gint      dbPoolSize;
 	gboolean  foreground;
 	gboolean  testMode;
 	gboolean  enableCopyOnDemand;
@@ -97,6 +99,152 @@ public:
 	std::string getResidentYardDirectory(void);
 	void setResidentYardDirectory(const std::string &dir);
 
+	/**
+	 * Get the directory where NDOMOD writes its output for each Nagios
+	 * server. The path for a server is "<directory>/<server ID>.ndo".
+	 *
+	 * @return
+	 * The directory, or an empty string if the NDO stream isn't used.
+	 */
+	std::string getNDOStreamDirectory(void);
+	void setNDOStreamDirectory(const std::string &dir);
+
+	/**
+	 * Get the flag to carry the messages between the server and the
+	 * arm plugins launched by the server on the shared memory instead
+	 * of the AMQP broker. Passive plugins always use the broker.
+	 *
+	 * @return true if the local channel is used.
+	 */
+	bool isHapLocalChannelEnabled(void);
+	void setHapLocalChannelEnabled(const bool &enable);
+
+	/**
+	 * Get the number of the worker threads shared by the arms for the
+	 * polling. It is read only when the first arm starts.
+	 *
+	 * @return
+	 * The number of the workers. If it is 0, each arm has its own
+	 * thread.
+	 */
+	size_t getNumberOfArmSchedulerWorkers(void);
+	void setNumberOfArmSchedulerWorkers(const size_t &numWorkers);
+
+	/**
+	 * Get the flag to let each arm change its polling interval within
+	 * a quarter to four times of the configured one by the number of
+	 * the events got by the last polling.
+	 *
+	 * @return true if the adaptive polling is enabled.
+	 */
+	bool isAdaptivePollingEnabled(void);
+	void setAdaptivePollingEnabled(const bool &enable);
+
+	/**
+	 * Get the maximum number of the persistent HTTP connections from
+	 * each Zabbix arm to its server.
+	 *
+	 * @return The maximum number of the connections.
+	 */
+	size_t getZabbixAPIMaxConnections(void);
+	void setZabbixAPIMaxConnections(const size_t &maxConnections);
+
+	/**
+	 * Get the maximum number of items whose history is cached locally.
+	 * It is read only when the cache is used at the first time.
+	 *
+	 * @return
+	 * The number of the items. If it is 0, the history is always
+	 * fetched from the monitoring servers.
+	 */
+	size_t getNumberOfHistoryCacheItems(void);
+	void setNumberOfHistoryCacheItems(const size_t &numItems);
+
+	/**
+	 * Get the length of the window in which the state changes of
+	 * each trigger are counted to detect flapping.
+	 * It is read only when the first events are received.
+	 *
+	 * @return
+	 * The length in seconds. If it is 0, the detection is disabled.
+	 */
+	size_t getEventFlapWindow(void);
+	void setEventFlapWindow(const size_t &window);
+
+	/**
+	 * Get the number of the state changes in the window with which
+	 * a trigger starts flapping.
+	 *
+	 * @return The number of the state changes.
+	 */
+	size_t getEventFlapStartThreshold(void);
+	void setEventFlapStartThreshold(const size_t &numChanges);
+
+	/**
+	 * Get the number of the state changes in the window with which
+	 * a flapping trigger settles.
+	 *
+	 * @return The number of the state changes.
+	 */
+	size_t getEventFlapStopThreshold(void);
+	void setEventFlapStopThreshold(const size_t &numChanges);
+
+	/**
+	 * Get the time in which a problem of a host is regarded as the cause
+	 * of the problems of the hosts that depend on it after it recovered.
+	 * It is read only when the first events are received.
+	 *
+	 * @return The time in seconds.
+	 */
+	size_t getEventCorrelationWindow(void);
+	void setEventCorrelationWindow(const size_t &window);
+
+	/**
+	 * Get the number of the events per second admitted from each
+	 * monitoring server. The excess events are spooled in the database
+	 * directory and admitted later.
+	 * It is read only when the first events are received.
+	 *
+	 * @return
+	 * The number of the events. If it is 0, the admission control is
+	 * disabled.
+	 */
+	size_t getEventAdmissionRate(void);
+	void setEventAdmissionRate(const size_t &rate);
+
+	/**
+	 * Get the number of the events from each monitoring server that are
+	 * admitted at once before the rate is applied.
+	 *
+	 * @return The number of the events.
+	 */
+	size_t getEventAdmissionBurst(void);
+	void setEventAdmissionBurst(const size_t &numEvents);
+
+	/**
+	 * Get the size of the ingestion journal through which the data
+	 * from the arms are stored in the DB.
+	 * It is read when UnifiedDataStore is started.
+	 *
+	 * @return
+	 * The size in MiB. If it is 0, the journal is disabled and
+	 * the arms store the data directly.
+	 */
+	size_t getIngestionJournalSize(void);
+	void setIngestionJournalSize(const size_t &size);
+
+	/**
+	 * Get the time to wait for the other arms before the monitoring data
+	 * are stored, so that those of many arms are stored in one
+	 * transaction. It is read when UnifiedDataStore is started.
+	 *
+	 * @return
+	 * The time in milliseconds. If it is 0, the data of each arm are
+	 * stored in a transaction of their own.
+	 */
+	size_t getGroupCommitDelay(void);
+	void setGroupCommitDelay(const size_t &delay);
+
 	bool isTestMode(void) const;
 
 	/**
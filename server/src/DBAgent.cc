@@ -22,6 +22,7 @@
 #include "DBAgent.h"
 #include "HatoholException.h"
 #include "SeparatorInjector.h"
+#include "MetricsRegistry.h"
 using namespace std;
 using namespace mlpl;
 
@@ -405,8 +406,14 @@ void DBAgent::fixupIndexes(const TableProfile &tableProfile)
 
 void DBAgent::runTransaction(TransactionProc &proc)
 {
+	static MetricHistogram &transactionDuration =
+	  MetricsRegistry::getInstance()->getHistogram(
+	    "hatohol_db_transaction_duration_seconds",
+	    "Time from the beginning to the commit of a transaction",
+	    MetricsRegistry::UNIT_MICRO_SEC);
 	if (!proc.preproc(*this))
 		return;
+	MetricTimer timer(transactionDuration);
 	begin();
 	try {
 		proc(*this);
@@ -508,6 +515,10 @@ string DBAgent::makeSelectStatement(const SelectExArg &selectExArg)
 		sql += " WHERE ";
 		sql += selectExArg.condition;
 	}
+	if (!selectExArg.groupBy.empty()) {
+		sql += " GROUP BY ";
+		sql += selectExArg.groupBy;
+	}
 	if (!selectExArg.orderBy.empty()) {
 		sql += " ORDER BY ";
 		sql += selectExArg.orderBy;
@@ -677,6 +688,15 @@ const DBTermCodec *DBAgent::getDBTermCodec(void) const
 	return &Impl::dbTermCodec;
 }
 
+void DBAgent::attachToCurrentThread(void)
+{
+}
+
+bool DBAgent::checkConnection(void)
+{
+	return true;
+}
+
 void DBAgent::createIndex(const TableProfile &tableProfile,
                           const IndexDef &indexDef)
 {
@@ -158,6 +158,7 @@ public:
 		std::vector<std::string>   statements;
 		std::vector<SQLColumnType> columnTypes;
 		std::string                condition;
+		std::string                groupBy;
 		std::string                orderBy;
 		size_t                     limit;
 		size_t                     offset;
@@ -265,6 +266,20 @@ public:
 
 	virtual const DBTermCodec *getDBTermCodec(void) const;
 
+	/**
+	 * Prepare the connection for the caller thread. This is called
+	 * when a pooled connection is handed to a thread that may differ
+	 * from the one that opened it.
+	 */
+	virtual void attachToCurrentThread(void);
+
+	/**
+	 * Check if the connection is usable and reconnect if it isn't.
+	 *
+	 * @return true if the connection is usable, otherwise false.
+	 */
+	virtual bool checkConnection(void);
+
 	struct TransactionProc {
 		/**
 		 * This method is called before the runTransaction.
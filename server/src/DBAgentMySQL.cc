@@ -23,6 +23,7 @@
 #include "SQLUtils.h"
 #include "SeparatorInjector.h"
 #include "Params.h"
+#include "MetricsRegistry.h"
 using namespace std;
 using namespace mlpl;
 
@@ -535,6 +536,27 @@ uint64_t DBAgentMySQL::getNumberOfAffectedRows(void)
 	return num;
 }
 
+void DBAgentMySQL::attachToCurrentThread(void)
+{
+	// The client library needs per-thread data for every thread that
+	// uses a connection. mysql_init() sets it up only for the thread
+	// that opened the connection. A call from an already initialized
+	// thread does nothing.
+	mysql_thread_init();
+}
+
+bool DBAgentMySQL::checkConnection(void)
+{
+	if (m_impl->connected && mysql_ping(&m_impl->mysql) == 0)
+		return true;
+	MLPL_INFO("Reconnect to MySQL: %s\n", m_impl->dbName.c_str());
+	if (m_impl->connected)
+		mysql_close(&m_impl->mysql);
+	m_impl->connected = false;
+	connect();
+	return m_impl->connected;
+}
+
 void DBAgentMySQL::addColumns(const AddColumnsArg &addColumnsArg)
 {
 	string query = "ALTER TABLE ";
@@ -609,6 +631,17 @@ void DBAgentMySQL::sleepAndReconnect(unsigned int sleepTimeSec)
 
 void DBAgentMySQL::queryWithRetry(const string &statement)
 {
+	static MetricHistogram &queryDuration =
+	  MetricsRegistry::getInstance()->getHistogram(
+	    "hatohol_db_query_duration_seconds",
+	    "Time to execute a query including retries",
+	    MetricsRegistry::UNIT_MICRO_SEC, "backend=\"mysql\"");
+	static MetricCounter &queryErrors =
+	  MetricsRegistry::getInstance()->getCounter(
+	    "hatohol_db_query_errors_total",
+	    "The number of queries that failed after retries",
+	    "backend=\"mysql\"");
+	MetricTimer timer(queryDuration);
 	unsigned int errorNumber = 0;
 	size_t numRetry = DEFAULT_NUM_RETRY;
 	for (size_t i = 0; i < numRetry; i++) {
@@ -641,6 +674,7 @@ void DBAgentMySQL::queryWithRetry(const string &statement)
 				break;
 		}
 	}
+	queryErrors.add();
 	if (errorNumber == CR_SERVER_GONE_ERROR || errorNumber == CR_SERVER_LOST ) {
 		THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
 		  HTERR_FAILED_CONNECT_MYSQL,
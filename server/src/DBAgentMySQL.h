@@ -65,6 +65,8 @@ public:
 				 const std::string &destName);
 	virtual uint64_t getLastInsertId(void);
 	virtual uint64_t getNumberOfAffectedRows(void);
+	virtual void attachToCurrentThread(void) override;
+	virtual bool checkConnection(void) override;
 
 protected:
 	static const char *getCStringOrNullIfEmpty(const std::string &str);
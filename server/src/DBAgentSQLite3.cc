@@ -40,6 +40,12 @@ class DBTermCodecSQLite3 : public DBTermCodec {
 	{
 		return StringUtils::sprintf("%" PRId64, val);
 	}
+
+	// A backslash isn't special in SQLite.
+	virtual string enc(const string &val) const override
+	{
+		return "'" + StringUtils::replace(val, "'", "''") + "'";
+	}
 };
 
 #define MAKE_SQL_STATEMENT_FROM_VAARG(LAST_ARG, STR_NAME) \
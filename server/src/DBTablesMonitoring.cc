@@ -18,6 +18,8 @@
  */
 
 #include <memory>
+#include <algorithm>
+#include <set>
 #include <Mutex.h>
 #include "DBAgentFactory.h"
 #include "DBTablesMonitoring.h"
@@ -27,6 +29,9 @@
 #include "Params.h"
 #include "ItemGroupStream.h"
 #include "DBClientJoinBuilder.h"
+#include "HostInfoCache.h"
+#include "TriggerStateSnapshot.h"
+#include "EventCorrelator.h"
 
 // TODO: rmeove the followin two include files!
 // This class should not be aware of it.
@@ -43,10 +48,12 @@ const char *DBTablesMonitoring::TABLE_NAME_HOSTS      = "hosts";
 const char *DBTablesMonitoring::TABLE_NAME_HOSTGROUPS = "hostgroups";
 const char *DBTablesMonitoring::TABLE_NAME_MAP_HOSTS_HOSTGROUPS
                                                    = "map_hosts_hostgroups";
+const char *DBTablesMonitoring::TABLE_NAME_HOST_DEPENDENCIES
+                                                   = "host_dependencies";
 const char *DBTablesMonitoring::TABLE_NAME_SERVER_STATUS = "server_status";
 const char *DBTablesMonitoring::TABLE_NAME_INCIDENTS  = "incidents";
 
-const int   DBTablesMonitoring::MONITORING_DB_VERSION = 8;
+const int   DBTablesMonitoring::MONITORING_DB_VERSION = 9;
 
 void operator>>(ItemGroupStream &itemGroupStream, TriggerStatusType &rhs)
 {
@@ -63,11 +70,42 @@ void operator>>(ItemGroupStream &itemGroupStream, EventType &rhs)
 	rhs = itemGroupStream.read<int, EventType>();
 }
 
+void operator>>(ItemGroupStream &itemGroupStream, EventCorrelationType &rhs)
+{
+	rhs = itemGroupStream.read<int, EventCorrelationType>();
+}
+
 void operator>>(ItemGroupStream &itemGroupStream, HostValidity &rhs)
 {
 	rhs = itemGroupStream.read<int, HostValidity>();
 }
 
+// HostInfoCache is the authoritative source of the host names. The name
+// stored with the row is used only when the host isn't in the cache.
+// The cache of the server is looked up once for consecutive rows.
+struct HostNameResolver {
+	ServerIdType   serverId;
+	HostInfoCache *hostInfoCache;
+
+	HostNameResolver(void)
+	: serverId(INVALID_SERVER_ID),
+	  hostInfoCache(NULL)
+	{
+	}
+
+	void resolve(const ServerIdType &_serverId, const HostIdType &hostId,
+	             string &hostName)
+	{
+		if (hostId == INVALID_HOST_ID || hostId == INAPPLICABLE_HOST_ID)
+			return;
+		if (!hostInfoCache || serverId != _serverId) {
+			hostInfoCache = &HostInfoCache::getInstance(_serverId);
+			serverId = _serverId;
+		}
+		hostInfoCache->getName(hostId, hostName);
+	}
+};
+
 // ----------------------------------------------------------------------------
 // Table: triggers
 // ----------------------------------------------------------------------------
@@ -296,6 +334,15 @@ static const ColumnDef COLUMN_DEF_EVENTS[] = {
 	SQL_KEY_NONE,                      // keyType
 	0,                                 // flags
 	NULL,                              // defaultValue
+}, {
+	"correlation",                     // columnName
+	SQL_COLUMN_TYPE_INT,               // type
+	11,                                // columnLength
+	0,                                 // decFracLength
+	false,                             // canBeNull
+	SQL_KEY_NONE,                      // keyType
+	0,                                 // flags
+	"0",                               // defaultValue
 },
 };
 
@@ -312,6 +359,7 @@ enum {
 	IDX_EVENTS_HOST_ID,
 	IDX_EVENTS_HOST_NAME,
 	IDX_EVENTS_BRIEF,
+	IDX_EVENTS_CORRELATION,
 	NUM_IDX_EVENTS,
 };
 
@@ -675,6 +723,72 @@ static const DBAgent::TableProfile tableProfileMapHostsHostgroups =
 			    NUM_IDX_MAP_HOSTS_HOSTGROUPS,
 			    indexDefsMapHostsHostgroups);
 
+// ----------------------------------------------------------------------------
+// Table: host_dependencies
+// ----------------------------------------------------------------------------
+static const ColumnDef COLUMN_DEF_HOST_DEPENDENCIES[] = {
+{
+	"id",                              // columnName
+	SQL_COLUMN_TYPE_INT,               // type
+	11,                                // columnLength
+	0,                                 // decFracLength
+	false,                             // canBeNull
+	SQL_KEY_PRI,                       // keyType
+	SQL_COLUMN_FLAG_AUTO_INC,          // flags
+	NULL,                              // defaultValue
+}, {
+	"server_id",                       // columnName
+	SQL_COLUMN_TYPE_INT,               // type
+	11,                                // columnLength
+	0,                                 // decFracLength
+	false,                             // canBeNull
+	SQL_KEY_NONE,                      // keyType
+	0,                                 // flags
+	NULL,                              // defaultValue
+}, {
+	"host_id",                         // columnName
+	SQL_COLUMN_TYPE_BIGUINT,           // type
+	20,                                // columnLength
+	0,                                 // decFracLength
+	false,                             // canBeNull
+	SQL_KEY_NONE,                      // keyType
+	0,                                 // flags
+	NULL,                              // defaultValue
+}, {
+	"host_group_id",                   // columnName
+	SQL_COLUMN_TYPE_BIGUINT,           // type
+	20,                                // columnLength
+	0,                                 // decFracLength
+	false,                             // canBeNull
+	SQL_KEY_NONE,                      // keyType
+	0,                                 // flags
+	NULL,                              // defaultValue
+}, {
+	"parent_host_id",                  // columnName
+	SQL_COLUMN_TYPE_BIGUINT,           // type
+	20,                                // columnLength
+	0,                                 // decFracLength
+	false,                             // canBeNull
+	SQL_KEY_NONE,                      // keyType
+	0,                                 // flags
+	NULL,                              // defaultValue
+},
+};
+
+enum {
+	IDX_HOST_DEPENDENCIES_ID,
+	IDX_HOST_DEPENDENCIES_SERVER_ID,
+	IDX_HOST_DEPENDENCIES_HOST_ID,
+	IDX_HOST_DEPENDENCIES_GROUP_ID,
+	IDX_HOST_DEPENDENCIES_PARENT_HOST_ID,
+	NUM_IDX_HOST_DEPENDENCIES,
+};
+
+static const DBAgent::TableProfile tableProfileHostDependencies =
+  DBAGENT_TABLEPROFILE_INIT(DBTablesMonitoring::TABLE_NAME_HOST_DEPENDENCIES,
+			    COLUMN_DEF_HOST_DEPENDENCIES,
+			    NUM_IDX_HOST_DEPENDENCIES);
+
 // ----------------------------------------------------------------------------
 // Table: server_status
 // ----------------------------------------------------------------------------
@@ -903,6 +1017,7 @@ void initEventInfo(EventInfo &eventInfo)
 	eventInfo.status = TRIGGER_STATUS_UNKNOWN;
 	eventInfo.severity = TRIGGER_SEVERITY_UNKNOWN;
 	eventInfo.hostId = INVALID_HOST_ID;
+	eventInfo.correlation = EVENT_CORRELATION_NONE;
 }
 
 // ---------------------------------------------------------------------------
@@ -921,6 +1036,199 @@ static const HostResourceQueryOption::Synapse synapseEventsQueryOption(
   IDX_MAP_HOSTS_HOSTGROUPS_SERVER_ID, IDX_MAP_HOSTS_HOSTGROUPS_HOST_ID,
   IDX_MAP_HOSTS_HOSTGROUPS_GROUP_ID);
 
+static void makeTextSearchDocument(TextSearchIndex::Document &document,
+                                   const EventInfo &eventInfo)
+{
+	document.serverId = eventInfo.serverId;
+	document.id = eventInfo.id;
+	document.text = eventInfo.brief + "\n" + eventInfo.hostName;
+}
+
+static void makeTextSearchDocument(TextSearchIndex::Document &document,
+                                   const TriggerInfo &triggerInfo)
+{
+	document.serverId = triggerInfo.serverId;
+	document.id = triggerInfo.id;
+	document.text = triggerInfo.brief;
+}
+
+static void makeTextSearchDocument(TextSearchIndex::Document &document,
+                                   const ItemInfo &itemInfo)
+{
+	document.serverId = itemInfo.serverId;
+	document.id = itemInfo.id;
+	document.text = itemInfo.brief;
+}
+
+template<typename T>
+static void updateTextSearchIndex(const TextSearchIndex::Target &target,
+                                  const T &info)
+{
+	TextSearchIndex::DocumentVect documentVect(1);
+	makeTextSearchDocument(documentVect[0], info);
+	TextSearchIndex::updateInstance(target, documentVect);
+}
+
+template<typename T>
+static void updateTextSearchIndex(const TextSearchIndex::Target &target,
+                                  const std::list<T> &infoList)
+{
+	TextSearchIndex::DocumentVect documentVect(infoList.size());
+	typename std::list<T>::const_iterator it = infoList.begin();
+	for (size_t i = 0; it != infoList.end(); ++it, i++)
+		makeTextSearchDocument(documentVect[i], *it);
+	TextSearchIndex::updateInstance(target, documentVect);
+}
+
+// The maximum number of the keys listed in a condition for a text search.
+// The words are matched by LIKE if more records match.
+static const size_t MAX_KEYS_IN_TEXT_SEARCH_CONDITION = 10000;
+
+static string makeTextSearchCondition(const TextSearchIndex::Target &target,
+                                      const string &query,
+                                      const string &serverIdColumn,
+                                      const string &idColumn,
+                                      const vector<string> &textColumns,
+                                      const DBTermCodec &dbTermCodec)
+{
+	TextSearchIndex::KeySet keySet;
+	TextSearchIndex::EvictedIdMap evictedIdMap;
+	TextSearchIndex::getInstance(target).search(keySet, query,
+	                                            &evictedIdMap);
+	const string likeCondition =
+	  TextSearchIndex::makeLikeCondition(query, textColumns, dbTermCodec);
+	if (keySet.size() > MAX_KEYS_IN_TEXT_SEARCH_CONDITION)
+		return likeCondition;
+
+	const string condition =
+	  TextSearchIndex::makeCondition(keySet, serverIdColumn, idColumn);
+	if (evictedIdMap.empty())
+		return condition;
+
+	// The records evicted from the index are matched by LIKE.
+	string evictedCondition = TextSearchIndex::makeEvictedCondition(
+	  evictedIdMap, serverIdColumn, idColumn);
+	if (!likeCondition.empty())
+		evictedCondition += " AND " + likeCondition;
+	return "(" + condition + " OR (" + evictedCondition + "))";
+}
+
+static string addTextSearchCondition(const string &condition,
+                                     const string &textSearchCondition)
+{
+	if (DBHatohol::isAlwaysFalseCondition(textSearchCondition))
+		return textSearchCondition;
+	if (textSearchCondition.empty())
+		return condition;
+	if (condition.empty())
+		return textSearchCondition;
+	return condition + " AND " + textSearchCondition;
+}
+
+struct TriggerSortKey {
+	size_t columnIndex;
+	bool   descending;
+};
+
+// Get the columns of the sort order of the option. false is returned if
+// the order has a column that TriggerInfoLess doesn't know.
+static bool getTriggerSortKeys(vector<TriggerSortKey> &sortKeys,
+                               const TriggersQueryOption &option)
+{
+	const DataQueryOption::SortOrderVect &sortOrderVect =
+	  option.getSortOrderVect();
+	DataQueryOption::SortOrderVectConstIterator it = sortOrderVect.begin();
+	for (; it != sortOrderVect.end(); ++it) {
+		if (it->columnName.empty())
+			continue;
+		if (it->direction != DataQueryOption::SORT_ASCENDING &&
+		    it->direction != DataQueryOption::SORT_DESCENDING) {
+			continue;
+		}
+		size_t idx = 0;
+		for (; idx < NUM_IDX_TRIGGERS; idx++) {
+			if (it->columnName ==
+			      COLUMN_DEF_TRIGGERS[idx].columnName ||
+			    it->columnName ==
+			      tableProfileTriggers.getFullColumnName(idx)) {
+				break;
+			}
+		}
+		if (idx == NUM_IDX_TRIGGERS)
+			return false;
+		TriggerSortKey sortKey;
+		sortKey.columnIndex = idx;
+		sortKey.descending =
+		  (it->direction == DataQueryOption::SORT_DESCENDING);
+		sortKeys.push_back(sortKey);
+	}
+	return true;
+}
+
+template<typename T>
+static int compareValue(const T &lhs, const T &rhs)
+{
+	if (lhs < rhs)
+		return -1;
+	if (rhs < lhs)
+		return 1;
+	return 0;
+}
+
+static int compareTriggerColumn(const TriggerInfo &lhs,
+                                const TriggerInfo &rhs,
+                                const size_t &columnIndex)
+{
+	switch (columnIndex) {
+	case IDX_TRIGGERS_SERVER_ID:
+		return compareValue(lhs.serverId, rhs.serverId);
+	case IDX_TRIGGERS_ID:
+		return compareValue(lhs.id, rhs.id);
+	case IDX_TRIGGERS_STATUS:
+		return compareValue(lhs.status, rhs.status);
+	case IDX_TRIGGERS_SEVERITY:
+		return compareValue(lhs.severity, rhs.severity);
+	case IDX_TRIGGERS_LAST_CHANGE_TIME_SEC:
+		return compareValue(lhs.lastChangeTime.tv_sec,
+		                    rhs.lastChangeTime.tv_sec);
+	case IDX_TRIGGERS_LAST_CHANGE_TIME_NS:
+		return compareValue(lhs.lastChangeTime.tv_nsec,
+		                    rhs.lastChangeTime.tv_nsec);
+	case IDX_TRIGGERS_HOST_ID:
+		return compareValue(lhs.hostId, rhs.hostId);
+	case IDX_TRIGGERS_HOSTNAME:
+		return compareValue(lhs.hostName, rhs.hostName);
+	case IDX_TRIGGERS_BRIEF:
+		return compareValue(lhs.brief, rhs.brief);
+	default:
+		HATOHOL_ASSERT(false, "Invalid column index: %zd\n",
+		               columnIndex);
+	}
+	return 0;
+}
+
+struct TriggerInfoLess {
+	const vector<TriggerSortKey> &sortKeys;
+
+	TriggerInfoLess(const vector<TriggerSortKey> &_sortKeys)
+	: sortKeys(_sortKeys)
+	{
+	}
+
+	bool operator()(const TriggerInfo *lhs, const TriggerInfo *rhs) const
+	{
+		for (size_t i = 0; i < sortKeys.size(); i++) {
+			const TriggerSortKey &sortKey = sortKeys[i];
+			int result = compareTriggerColumn(*lhs, *rhs,
+			                                  sortKey.columnIndex);
+			if (result == 0)
+				continue;
+			return sortKey.descending ? (result > 0) : (result < 0);
+		}
+		return false;
+	}
+};
+
 struct EventsQueryOption::Impl {
 	uint64_t limitOfUnifiedId;
 	SortType sortType;
@@ -928,6 +1236,7 @@ struct EventsQueryOption::Impl {
 	TriggerSeverityType minSeverity;
 	TriggerStatusType triggerStatus;
 	TriggerIdType triggerId;
+	string textQuery;
 
 	Impl()
 	: limitOfUnifiedId(NO_LIMIT),
@@ -1011,6 +1320,18 @@ string EventsQueryOption::getCondition(void) const
 			m_impl->triggerId);
 	}
 
+	if (!m_impl->textQuery.empty()) {
+		vector<string> textColumns;
+		textColumns.push_back(getColumnName(IDX_EVENTS_BRIEF));
+		textColumns.push_back(getColumnName(IDX_EVENTS_HOST_NAME));
+		condition = addTextSearchCondition(condition,
+		  makeTextSearchCondition(
+		    TextSearchIndex::TARGET_EVENTS, m_impl->textQuery,
+		    getColumnName(IDX_EVENTS_SERVER_ID),
+		    getColumnName(IDX_EVENTS_ID), textColumns,
+		    *getDBTermCodec()));
+	}
+
 	return condition;
 }
 
@@ -1103,6 +1424,16 @@ TriggerIdType EventsQueryOption::getTriggerId(void) const
 	return m_impl->triggerId;
 }
 
+void EventsQueryOption::setTextQuery(const string &query)
+{
+	m_impl->textQuery = query;
+}
+
+const string &EventsQueryOption::getTextQuery(void) const
+{
+	return m_impl->textQuery;
+}
+
 //
 // TriggersQueryOption
 //
@@ -1120,6 +1451,7 @@ struct TriggersQueryOption::Impl {
 	TriggerIdType targetId;
 	TriggerSeverityType minSeverity;
 	TriggerStatusType triggerStatus;
+	string textQuery;
 
 	Impl()
 	: targetId(ALL_TRIGGERS),
@@ -1190,6 +1522,21 @@ string TriggersQueryOption::getCondition(void) const
 			m_impl->triggerStatus);
 	}
 
+	if (!m_impl->textQuery.empty()) {
+		const char *tableName = DBTablesMonitoring::TABLE_NAME_TRIGGERS;
+		vector<string> textColumns;
+		textColumns.push_back(StringUtils::sprintf("%s.%s", tableName,
+		  COLUMN_DEF_TRIGGERS[IDX_TRIGGERS_BRIEF].columnName));
+		condition = addTextSearchCondition(condition,
+		  makeTextSearchCondition(
+		    TextSearchIndex::TARGET_TRIGGERS, m_impl->textQuery,
+		    StringUtils::sprintf("%s.%s", tableName,
+		      COLUMN_DEF_TRIGGERS[IDX_TRIGGERS_SERVER_ID].columnName),
+		    StringUtils::sprintf("%s.%s", tableName,
+		      COLUMN_DEF_TRIGGERS[IDX_TRIGGERS_ID].columnName),
+		    textColumns, *getDBTermCodec()));
+	}
+
 	return condition;
 }
 
@@ -1223,6 +1570,16 @@ TriggerStatusType TriggersQueryOption::getTriggerStatus(void) const
 	return m_impl->triggerStatus;
 }
 
+void TriggersQueryOption::setTextQuery(const string &query)
+{
+	m_impl->textQuery = query;
+}
+
+const string &TriggersQueryOption::getTextQuery(void) const
+{
+	return m_impl->textQuery;
+}
+
 //
 // ItemsQueryOption
 //
@@ -1237,6 +1594,7 @@ static const HostResourceQueryOption::Synapse synapseItemsQueryOption(
 struct ItemsQueryOption::Impl {
 	ItemIdType targetId;
 	string itemGroupName;
+	string textQuery;
 
 	Impl()
 	: targetId(ALL_ITEMS)
@@ -1297,6 +1655,21 @@ string ItemsQueryOption::getCondition(void) const
 			escaped.c_str());
 	}
 
+	if (!m_impl->textQuery.empty()) {
+		const char *tableName = DBTablesMonitoring::TABLE_NAME_ITEMS;
+		vector<string> textColumns;
+		textColumns.push_back(StringUtils::sprintf("%s.%s", tableName,
+		  COLUMN_DEF_ITEMS[IDX_ITEMS_BRIEF].columnName));
+		condition = addTextSearchCondition(condition,
+		  makeTextSearchCondition(
+		    TextSearchIndex::TARGET_ITEMS, m_impl->textQuery,
+		    StringUtils::sprintf("%s.%s", tableName,
+		      COLUMN_DEF_ITEMS[IDX_ITEMS_SERVER_ID].columnName),
+		    StringUtils::sprintf("%s.%s", tableName,
+		      COLUMN_DEF_ITEMS[IDX_ITEMS_ID].columnName),
+		    textColumns, *getDBTermCodec()));
+	}
+
 	return condition;
 }
 
@@ -1320,6 +1693,16 @@ const string &ItemsQueryOption::getTargetItemGroupName(void)
 	return m_impl->itemGroupName;
 }
 
+void ItemsQueryOption::setTextQuery(const string &query)
+{
+	m_impl->textQuery = query;
+}
+
+const string &ItemsQueryOption::getTextQuery(void) const
+{
+	return m_impl->textQuery;
+}
+
 //
 // HostsQueryOption
 //
@@ -1509,7 +1892,13 @@ void DBTablesMonitoring::addTriggerInfo(TriggerInfo *triggerInfo)
 			addTriggerInfoWithoutTransaction(dbAgent, *triggerInfo);
 		}
 	} trx(triggerInfo);
+	TriggerStateSnapshot::UpdateLock updateLock;
 	getDBAgent().runTransaction(trx);
+
+	TriggerInfoList triggerInfoList;
+	triggerInfoList.push_back(*triggerInfo);
+	TriggerStateSnapshot::update(updateLock, triggerInfoList);
+	updateTextSearchIndex(TextSearchIndex::TARGET_TRIGGERS, *triggerInfo);
 }
 
 void DBTablesMonitoring::addTriggerInfoList(const TriggerInfoList &triggerInfoList)
@@ -1530,7 +1919,12 @@ void DBTablesMonitoring::addTriggerInfoList(const TriggerInfoList &triggerInfoLi
 				addTriggerInfoWithoutTransaction(dbAgent, *it);
 		}
 	} trx(triggerInfoList);
+	TriggerStateSnapshot::UpdateLock updateLock;
 	getDBAgent().runTransaction(trx);
+
+	TriggerStateSnapshot::update(updateLock, triggerInfoList);
+	updateTextSearchIndex(TextSearchIndex::TARGET_TRIGGERS,
+	                      triggerInfoList);
 }
 
 bool DBTablesMonitoring::getTriggerInfo(TriggerInfo &triggerInfo,
@@ -1551,6 +1945,53 @@ bool DBTablesMonitoring::getTriggerInfo(TriggerInfo &triggerInfo,
 
 void DBTablesMonitoring::getTriggerInfoList(TriggerInfoList &triggerInfoList,
 					 const TriggersQueryOption &option)
+{
+	vector<TriggerSortKey> sortKeys;
+	if (!getTriggerSortKeys(sortKeys, option)) {
+		getTriggerInfoListFromDB(triggerInfoList, option);
+		return;
+	}
+
+	const size_t limit = option.getMaximumNumber();
+	const size_t offset = option.getOffset();
+	if (!limit && offset)
+		return;
+
+	TriggerStateSnapshotPtr snapshot(TriggerStateSnapshot::get(), false);
+	TriggerStateSnapshot::TriggerInfoPtrVect triggers;
+	snapshot->find(triggers, option);
+	if (!sortKeys.empty()) {
+		stable_sort(triggers.begin(), triggers.end(),
+		            TriggerInfoLess(sortKeys));
+	}
+
+	size_t end = triggers.size();
+	if (limit && offset + limit < end)
+		end = offset + limit;
+	HostNameResolver hostNameResolver;
+	for (size_t i = offset; i < end; i++) {
+		triggerInfoList.push_back(*triggers[i]);
+		TriggerInfo &trigInfo = triggerInfoList.back();
+		hostNameResolver.resolve(trigInfo.serverId, trigInfo.hostId,
+		                         trigInfo.hostName);
+	}
+}
+
+void DBTablesMonitoring::getTriggerStateSources(
+  TriggerInfoList &triggerInfoList,
+  HostgroupElementList &hostgroupElementList)
+{
+	TriggersQueryOption triggersOption(USER_ID_SYSTEM);
+	triggersOption.setFilterForDataOfDefunctServers(false);
+	getTriggerInfoListFromDB(triggerInfoList, triggersOption);
+
+	HostgroupElementQueryOption hostgroupOption(USER_ID_SYSTEM);
+	hostgroupOption.setFilterForDataOfDefunctServers(false);
+	getHostgroupElementList(hostgroupElementList, hostgroupOption);
+}
+
+void DBTablesMonitoring::getTriggerInfoListFromDB(
+  TriggerInfoList &triggerInfoList, const TriggersQueryOption &option)
 {
 	// build a condition
 	string condition = option.getCondition();
@@ -1586,6 +2027,7 @@ void DBTablesMonitoring::getTriggerInfoList(TriggerInfoList &triggerInfoList,
 	getDBAgent().runTransaction(arg);
 
 	// check the result and copy
+	HostNameResolver hostNameResolver;
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
 	ItemGroupListConstIterator itemGrpItr = grpList.begin();
 	for (; itemGrpItr != grpList.end(); ++itemGrpItr) {
@@ -1601,6 +2043,10 @@ void DBTablesMonitoring::getTriggerInfoList(TriggerInfoList &triggerInfoList,
 		itemGroupStream >> trigInfo.hostId;
 		itemGroupStream >> trigInfo.hostName;
 		itemGroupStream >> trigInfo.brief;
+		if (trigInfo.hostName.empty())
+			hostNameResolver.resolve(trigInfo.serverId,
+			                         trigInfo.hostId,
+			                         trigInfo.hostName);
 
 		triggerInfoList.push_back(trigInfo);
 	}
@@ -1644,7 +2090,12 @@ void DBTablesMonitoring::setTriggerInfoList(
 				addTriggerInfoWithoutTransaction(dbAgent, *it);
 		}
 	} trx(triggerInfoList, serverId);
+	TriggerStateSnapshot::UpdateLock updateLock;
 	getDBAgent().runTransaction(trx);
+
+	TriggerStateSnapshot::replace(updateLock, triggerInfoList, serverId);
+	updateTextSearchIndex(TextSearchIndex::TARGET_TRIGGERS,
+	                      triggerInfoList);
 }
 
 int DBTablesMonitoring::getLastChangeTimeOfTrigger(const ServerIdType &serverId)
@@ -1689,6 +2140,8 @@ void DBTablesMonitoring::addEventInfo(EventInfo *eventInfo)
 		}
 	} trx(eventInfo);
 	getDBAgent().runTransaction(trx);
+
+	updateTextSearchIndex(TextSearchIndex::TARGET_EVENTS, *eventInfo);
 }
 
 void DBTablesMonitoring::addEventInfoList(const EventInfoList &eventInfoList)
@@ -1709,6 +2162,9 @@ void DBTablesMonitoring::addEventInfoList(const EventInfoList &eventInfoList)
 		}
 	} trx(eventInfoList);
 	getDBAgent().runTransaction(trx);
+
+	updateTextSearchIndex(TextSearchIndex::TARGET_EVENTS,
+	                      eventInfoList);
 }
 
 HatoholError DBTablesMonitoring::getEventInfoList(
@@ -1728,6 +2184,7 @@ HatoholError DBTablesMonitoring::getEventInfoList(
 	builder.add(IDX_EVENTS_HOST_ID);
 	builder.add(IDX_EVENTS_HOST_NAME);
 	builder.add(IDX_EVENTS_BRIEF);
+	builder.add(IDX_EVENTS_CORRELATION);
 
 	builder.addTable(
 	  tableProfileTriggers, DBClientJoinBuilder::LEFT_JOIN,
@@ -1781,6 +2238,7 @@ HatoholError DBTablesMonitoring::getEventInfoList(
 	getDBAgent().runTransaction(arg);
 
 	// check the result and copy
+	HostNameResolver hostNameResolver;
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
 	ItemGroupListConstIterator itemGrpItr = grpList.begin();
 	for (; itemGrpItr != grpList.end(); ++itemGrpItr) {
@@ -1806,6 +2264,7 @@ HatoholError DBTablesMonitoring::getEventInfoList(
 		itemGroupStream >> eventHostId;
 		itemGroupStream >> eventHostName;
 		itemGroupStream >> eventBrief;
+		itemGroupStream >> eventInfo.correlation;
 
 		TriggerStatusType   triggerStatus;
 		TriggerSeverityType triggerSeverity;
@@ -1835,6 +2294,8 @@ HatoholError DBTablesMonitoring::getEventInfoList(
 			eventInfo.hostId = triggerHostId;
 			eventInfo.hostName = triggerHostName;
 		}
+		hostNameResolver.resolve(eventInfo.serverId, eventInfo.hostId,
+		                         eventInfo.hostName);
 		if (!eventBrief.empty()) {
 			eventInfo.brief = eventBrief;
 		} else {
@@ -1900,6 +2361,9 @@ void DBTablesMonitoring::setEventInfoList(
 		}
 	} trx(eventInfoList, serverId);
 	getDBAgent().runTransaction(trx);
+
+	updateTextSearchIndex(TextSearchIndex::TARGET_EVENTS,
+	                      eventInfoList);
 }
 
 void DBTablesMonitoring::addHostgroupInfo(HostgroupInfo *groupInfo)
@@ -1943,24 +2407,66 @@ void DBTablesMonitoring::addHostgroupInfoList(
 
 }
 
+void DBTablesMonitoring::deleteHostgroupInfoList(
+  const HostgroupInfoList &groupInfoList)
+{
+	struct TrxProc : public DBAgent::TransactionProc {
+		const HostgroupInfoList &groupInfoList;
+
+		TrxProc(const HostgroupInfoList &_groupInfoList)
+		: groupInfoList(_groupInfoList)
+		{
+		}
+
+		void operator ()(DBAgent &dbAgent) override
+		{
+			const DBTermCodec *dbTermCodec =
+			  dbAgent.getDBTermCodec();
+			HostgroupInfoListConstIterator it =
+			  groupInfoList.begin();
+			for (; it != groupInfoList.end(); ++it) {
+				DBAgent::DeleteArg arg(tableProfileHostgroups);
+				arg.condition = StringUtils::sprintf(
+				  "%s=%s AND %s=%s",
+				  COLUMN_DEF_HOSTGROUPS[
+				    IDX_HOSTGROUPS_SERVER_ID].columnName,
+				  dbTermCodec->enc(it->serverId).c_str(),
+				  COLUMN_DEF_HOSTGROUPS[
+				    IDX_HOSTGROUPS_GROUP_ID].columnName,
+				  dbTermCodec->enc(it->groupId).c_str());
+				dbAgent.deleteRows(arg);
+			}
+		}
+	} trx(groupInfoList);
+	getDBAgent().runTransaction(trx);
+}
+
 void DBTablesMonitoring::addHostgroupElement(
   HostgroupElement *hostgroupElement)
 {
 	struct TrxProc : public DBAgent::TransactionProc {
 		HostgroupElement *hostgroupElement;
+		bool changed;
 		
 		TrxProc(HostgroupElement *_hostgroupElement)
-		: hostgroupElement(_hostgroupElement)
+		: hostgroupElement(_hostgroupElement),
+		  changed(false)
 		{
 		}
 
 		void operator ()(DBAgent &dbAgent) override
 		{
-			addHostgroupElementWithoutTransaction(
+			changed = addHostgroupElementWithoutTransaction(
 			  dbAgent, *hostgroupElement);
 		}
 	} trx(hostgroupElement);
 	getDBAgent().runTransaction(trx);
+
+	HostgroupElementList hostgroupElementList;
+	hostgroupElementList.push_back(*hostgroupElement);
+	TriggerStateSnapshot::addHostgroupElements(hostgroupElementList);
+	if (trx.changed)
+		EventCorrelator::invalidateDependencies();
 }
 
 void DBTablesMonitoring::addHostgroupElementList(
@@ -1968,23 +2474,134 @@ void DBTablesMonitoring::addHostgroupElementList(
 {
 	struct TrxProc : public DBAgent::TransactionProc {
 		const HostgroupElementList &hostgroupElementList;
+		bool changed;
 		
 		TrxProc(const HostgroupElementList &_hostgroupElementList)
-		: hostgroupElementList(_hostgroupElementList)
+		: hostgroupElementList(_hostgroupElementList),
+		  changed(false)
+		{
+		}
+
+		void operator ()(DBAgent &dbAgent) override
+		{
+			HostgroupElementListConstIterator it =
+			  hostgroupElementList.begin();
+			for (; it != hostgroupElementList.end(); ++it) {
+				if (addHostgroupElementWithoutTransaction(
+				      dbAgent, *it)) {
+					changed = true;
+				}
+			}
+		}
+	} trx(hostgroupElementList);
+	getDBAgent().runTransaction(trx);
+
+	TriggerStateSnapshot::addHostgroupElements(hostgroupElementList);
+	if (trx.changed)
+		EventCorrelator::invalidateDependencies();
+}
+
+void DBTablesMonitoring::deleteHostgroupElementList(
+  const HostgroupElementList &hostgroupElementList)
+{
+	struct TrxProc : public DBAgent::TransactionProc {
+		const HostgroupElementList &hostgroupElementList;
+		bool changed;
+
+		TrxProc(const HostgroupElementList &_hostgroupElementList)
+		: hostgroupElementList(_hostgroupElementList),
+		  changed(false)
 		{
 		}
 
 		void operator ()(DBAgent &dbAgent) override
 		{
+			const DBTermCodec *dbTermCodec =
+			  dbAgent.getDBTermCodec();
 			HostgroupElementListConstIterator it =
 			  hostgroupElementList.begin();
 			for (; it != hostgroupElementList.end(); ++it) {
-				addHostgroupElementWithoutTransaction(dbAgent,
-				                                      *it);
+				DBAgent::DeleteArg arg(
+				  tableProfileMapHostsHostgroups);
+				arg.condition = StringUtils::sprintf(
+				  "%s=%s AND %s=%s AND %s=%s",
+				  COLUMN_DEF_MAP_HOSTS_HOSTGROUPS[
+				    IDX_MAP_HOSTS_HOSTGROUPS_SERVER_ID
+				  ].columnName,
+				  dbTermCodec->enc(it->serverId).c_str(),
+				  COLUMN_DEF_MAP_HOSTS_HOSTGROUPS[
+				    IDX_MAP_HOSTS_HOSTGROUPS_HOST_ID
+				  ].columnName,
+				  dbTermCodec->enc(it->hostId).c_str(),
+				  COLUMN_DEF_MAP_HOSTS_HOSTGROUPS[
+				    IDX_MAP_HOSTS_HOSTGROUPS_GROUP_ID
+				  ].columnName,
+				  dbTermCodec->enc(it->groupId).c_str());
+				if (!dbAgent.isRecordExisting(
+				      TABLE_NAME_MAP_HOSTS_HOSTGROUPS,
+				      arg.condition)) {
+					continue;
+				}
+				dbAgent.deleteRows(arg);
+				changed = true;
 			}
 		}
 	} trx(hostgroupElementList);
 	getDBAgent().runTransaction(trx);
+
+	TriggerStateSnapshot::deleteHostgroupElements(hostgroupElementList);
+	if (trx.changed)
+		EventCorrelator::invalidateDependencies();
+}
+
+void DBTablesMonitoring::addHostDependency(HostDependency *hostDependency)
+{
+	DBAgent::InsertArg arg(tableProfileHostDependencies);
+	arg.add(hostDependency->id);
+	arg.add(hostDependency->serverId);
+	arg.add(hostDependency->hostId);
+	arg.add(hostDependency->groupId);
+	arg.add(hostDependency->parentHostId);
+	getDBAgent().runTransaction(arg, &hostDependency->id);
+
+	EventCorrelator::invalidateDependencies();
+}
+
+void DBTablesMonitoring::deleteHostDependency(const int &id)
+{
+	DBAgent::DeleteArg arg(tableProfileHostDependencies);
+	arg.condition = StringUtils::sprintf(
+	  "%s=%d",
+	  COLUMN_DEF_HOST_DEPENDENCIES[IDX_HOST_DEPENDENCIES_ID].columnName,
+	  id);
+	getDBAgent().runTransaction(arg);
+
+	EventCorrelator::invalidateDependencies();
+}
+
+void DBTablesMonitoring::getHostDependencyList(
+  HostDependencyList &hostDependencyList)
+{
+	DBAgent::SelectExArg arg(tableProfileHostDependencies);
+	arg.add(IDX_HOST_DEPENDENCIES_ID);
+	arg.add(IDX_HOST_DEPENDENCIES_SERVER_ID);
+	arg.add(IDX_HOST_DEPENDENCIES_HOST_ID);
+	arg.add(IDX_HOST_DEPENDENCIES_GROUP_ID);
+	arg.add(IDX_HOST_DEPENDENCIES_PARENT_HOST_ID);
+	getDBAgent().runTransaction(arg);
+
+	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
+	ItemGroupListConstIterator itemGrpItr = grpList.begin();
+	for (; itemGrpItr != grpList.end(); ++itemGrpItr) {
+		ItemGroupStream itemGroupStream(*itemGrpItr);
+		hostDependencyList.push_back(HostDependency());
+		HostDependency &hostDependency = hostDependencyList.back();
+		itemGroupStream >> hostDependency.id;
+		itemGroupStream >> hostDependency.serverId;
+		itemGroupStream >> hostDependency.hostId;
+		itemGroupStream >> hostDependency.groupId;
+		itemGroupStream >> hostDependency.parentHostId;
+	}
 }
 
 void DBTablesMonitoring::addHostInfo(HostInfo *hostInfo)
@@ -2003,6 +2620,10 @@ void DBTablesMonitoring::addHostInfo(HostInfo *hostInfo)
 		}
 	} trx(hostInfo);
 	getDBAgent().runTransaction(trx);
+
+	HostInfoList hostInfoList;
+	hostInfoList.push_back(*hostInfo);
+	HostInfoCache::updateInstances(hostInfoList);
 }
 
 void DBTablesMonitoring::addHostInfoList(const HostInfoList &hostInfoList)
@@ -2023,13 +2644,13 @@ void DBTablesMonitoring::addHostInfoList(const HostInfoList &hostInfoList)
 		}
 	} trx(hostInfoList);
 	getDBAgent().runTransaction(trx);
+
+	HostInfoCache::updateInstances(hostInfoList);
 }
 
 void DBTablesMonitoring::updateHosts(const HostInfoList &hostInfoList,
                                      const ServerIdType &serverId)
 {
-	// TODO: We should update the host name if it's changed.
-
 	// Make a set that contains current hosts records
 	HostsQueryOption option(USER_ID_SYSTEM);
 	option.setValidity(HOST_VALID);
@@ -2048,9 +2669,16 @@ void DBTablesMonitoring::updateHosts(const HostInfoList &hostInfoList,
 	HostInfoListConstIterator newHostsItr = hostInfoList.begin();
 	for (; newHostsItr != hostInfoList.end(); ++newHostsItr) {
 		const HostInfo &newHostInfo = *newHostsItr;
-		if (currValidHosts.erase(newHostInfo.id) >= 1) {
-			// The host already exits. We have nrothing to do.
-			continue;
+		HostIdHostInfoMapIterator currIt =
+		  currValidHosts.find(newHostInfo.id);
+		if (currIt != currValidHosts.end()) {
+			const bool renamed =
+			  (currIt->second->hostName != newHostInfo.hostName);
+			currValidHosts.erase(currIt);
+			// The host already exits. We have nrothing to do
+			// unless it has been renamed.
+			if (!renamed)
+				continue;
 		}
 		updatedHostInfoList.push_back(newHostInfo);
 	}
@@ -2066,7 +2694,57 @@ void DBTablesMonitoring::updateHosts(const HostInfoList &hostInfoList,
 	addHostInfoList(updatedHostInfoList);
 }
 
-EventIdType DBTablesMonitoring::getLastEventId(const ServerIdType &serverId)
+void DBTablesMonitoring::updateHostgroups(
+  const HostgroupInfoList &groupInfoList, const ServerIdType &serverId)
+{
+	HostgroupsQueryOption option(USER_ID_SYSTEM);
+	option.setTargetServerId(serverId);
+	HostgroupInfoList currGroups;
+	getHostgroupInfoList(currGroups, option);
+
+	set<HostgroupIdType> newGroupIds;
+	HostgroupInfoListConstIterator it = groupInfoList.begin();
+	for (; it != groupInfoList.end(); ++it)
+		newGroupIds.insert(it->groupId);
+
+	HostgroupInfoList removedGroups;
+	for (it = currGroups.begin(); it != currGroups.end(); ++it) {
+		if (newGroupIds.find(it->groupId) == newGroupIds.end())
+			removedGroups.push_back(*it);
+	}
+	if (!removedGroups.empty())
+		deleteHostgroupInfoList(removedGroups);
+	addHostgroupInfoList(groupInfoList);
+}
+
+void DBTablesMonitoring::updateHostgroupElements(
+  const HostgroupElementList &hostgroupElementList,
+  const ServerIdType &serverId)
+{
+	HostgroupElementQueryOption option(USER_ID_SYSTEM);
+	option.setTargetServerId(serverId);
+	HostgroupElementList currElements;
+	getHostgroupElementList(currElements, option);
+
+	typedef pair<HostIdType, HostgroupIdType> ElementKey;
+	set<ElementKey> newElements;
+	HostgroupElementListConstIterator it = hostgroupElementList.begin();
+	for (; it != hostgroupElementList.end(); ++it)
+		newElements.insert(ElementKey(it->hostId, it->groupId));
+
+	HostgroupElementList removedElements;
+	for (it = currElements.begin(); it != currElements.end(); ++it) {
+		const ElementKey key(it->hostId, it->groupId);
+		if (newElements.find(key) == newElements.end())
+			removedElements.push_back(*it);
+	}
+	if (!removedElements.empty())
+		deleteHostgroupElementList(removedElements);
+	addHostgroupElementList(hostgroupElementList);
+}
+
+EventIdType DBTablesMonitoring::getLastEventId(const ServerIdType &serverId,
+                                               const EventIdType &upperBound)
 {
 	const DBTermCodec *dbTermCodec = getDBAgent().getDBTermCodec();
 	DBAgent::SelectExArg arg(tableProfileEvents);
@@ -2076,6 +2754,10 @@ EventIdType DBTablesMonitoring::getLastEventId(const ServerIdType &serverId)
 	arg.condition = StringUtils::sprintf("%s=%s",
 	    COLUMN_DEF_EVENTS[IDX_EVENTS_SERVER_ID].columnName, 
 	    dbTermCodec->enc(serverId).c_str());
+	if (upperBound != EVENT_NOT_FOUND) {
+		arg.condition += StringUtils::sprintf(" AND %s<%" PRIu64,
+		    COLUMN_DEF_EVENTS[IDX_EVENTS_ID].columnName, upperBound);
+	}
 
 	getDBAgent().runTransaction(arg);
 
@@ -2158,6 +2840,126 @@ SmartTime DBTablesMonitoring::getTimeOfLastEvent(
 	return SmartTime(ts);
 }
 
+void DBTablesMonitoring::getTimesOfLastEvents(
+  const ServerIdType &serverId, const vector<TriggerIdType> &triggerIds,
+  vector<SmartTime> &times)
+{
+	using StringUtils::sprintf;
+
+	// Too long IN clause is split to limit the size of a statement.
+	static const size_t MAX_NUM_IDS_IN_STATEMENT = 1000;
+
+	struct TrxProc : public DBAgent::TransactionProc {
+		const DBTermCodec            *dbTermCodec;
+		const ServerIdType            serverId;
+		const vector<TriggerIdType>  &triggerIds;
+		map<TriggerIdType, timespec>  lastTimeMap;
+
+		TrxProc(const DBTermCodec *_dbTermCodec,
+		        const ServerIdType &_serverId,
+		        const vector<TriggerIdType> &_triggerIds)
+		: dbTermCodec(_dbTermCodec),
+		  serverId(_serverId),
+		  triggerIds(_triggerIds)
+		{
+		}
+
+		string makeInClause(const size_t &idx, const string &values)
+		{
+			return sprintf("%s IN (%s)",
+			  COLUMN_DEF_EVENTS[idx].columnName, values.c_str());
+		}
+
+		void selectLastEventIds(DBAgent &dbAgent, const string &ids,
+		                        string &unifiedIds)
+		{
+			DBAgent::SelectExArg arg(tableProfileEvents);
+			const ColumnDef &colDefUniId =
+			  COLUMN_DEF_EVENTS[IDX_EVENTS_UNIFIED_ID];
+			arg.add(sprintf("max(%s)", colDefUniId.columnName),
+			        colDefUniId.type);
+			arg.condition = sprintf("%s=%s AND %s",
+			  COLUMN_DEF_EVENTS[IDX_EVENTS_SERVER_ID].columnName,
+			  dbTermCodec->enc(serverId).c_str(),
+			  makeInClause(IDX_EVENTS_TRIGGER_ID, ids).c_str());
+			arg.groupBy =
+			  COLUMN_DEF_EVENTS[IDX_EVENTS_TRIGGER_ID].columnName;
+			dbAgent.select(arg);
+
+			const ItemGroupList &grpList =
+			  arg.dataTable->getItemGroupList();
+			ItemGroupListConstIterator it = grpList.begin();
+			for (; it != grpList.end(); ++it) {
+				ItemGroupStream itemGroupStream(*it);
+				if (!unifiedIds.empty())
+					unifiedIds += ",";
+				unifiedIds += sprintf("%" FMT_EVENT_ID,
+				  itemGroupStream.read<EventIdType>());
+			}
+		}
+
+		void selectTimes(DBAgent &dbAgent, const string &unifiedIds)
+		{
+			DBAgent::SelectExArg arg(tableProfileEvents);
+			arg.add(IDX_EVENTS_TRIGGER_ID);
+			arg.add(IDX_EVENTS_TIME_SEC);
+			arg.add(IDX_EVENTS_TIME_NS);
+			arg.condition =
+			  makeInClause(IDX_EVENTS_UNIFIED_ID, unifiedIds);
+			dbAgent.select(arg);
+
+			const ItemGroupList &grpList =
+			  arg.dataTable->getItemGroupList();
+			ItemGroupListConstIterator it = grpList.begin();
+			for (; it != grpList.end(); ++it) {
+				ItemGroupStream itemGroupStream(*it);
+				TriggerIdType triggerId;
+				timespec ts;
+				itemGroupStream >> triggerId;
+				itemGroupStream >> ts.tv_sec;
+				itemGroupStream >> ts.tv_nsec;
+				lastTimeMap[triggerId] = ts;
+			}
+		}
+
+		void operator ()(DBAgent &dbAgent) override
+		{
+			size_t idx = 0;
+			while (idx < triggerIds.size()) {
+				string ids;
+				const size_t end =
+				  min(idx + MAX_NUM_IDS_IN_STATEMENT,
+				      triggerIds.size());
+				for (; idx < end; idx++) {
+					if (!ids.empty())
+						ids += ",";
+					ids += dbTermCodec->enc(
+					         triggerIds[idx]);
+				}
+				string unifiedIds;
+				selectLastEventIds(dbAgent, ids, unifiedIds);
+				if (!unifiedIds.empty())
+					selectTimes(dbAgent, unifiedIds);
+			}
+		}
+	} trx(getDBAgent().getDBTermCodec(), serverId, triggerIds);
+
+	times.clear();
+	if (triggerIds.empty())
+		return;
+	getDBAgent().runTransaction(trx);
+
+	times.reserve(triggerIds.size());
+	for (size_t i = 0; i < triggerIds.size(); i++) {
+		map<TriggerIdType, timespec>::const_iterator it =
+		  trx.lastTimeMap.find(triggerIds[i]);
+		if (it == trx.lastTimeMap.end())
+			times.push_back(SmartTime());
+		else
+			times.push_back(SmartTime(it->second));
+	}
+}
+
 void DBTablesMonitoring::addItemInfo(ItemInfo *itemInfo)
 {
 	struct TrxProc : public DBAgent::TransactionProc {
@@ -2174,6 +2976,8 @@ void DBTablesMonitoring::addItemInfo(ItemInfo *itemInfo)
 		}
 	} trx(itemInfo);
 	getDBAgent().runTransaction(trx);
+
+	updateTextSearchIndex(TextSearchIndex::TARGET_ITEMS, *itemInfo);
 }
 
 void DBTablesMonitoring::addItemInfoList(const ItemInfoList &itemInfoList)
@@ -2194,6 +2998,72 @@ void DBTablesMonitoring::addItemInfoList(const ItemInfoList &itemInfoList)
 		}
 	} trx(itemInfoList);
 	getDBAgent().runTransaction(trx);
+
+	updateTextSearchIndex(TextSearchIndex::TARGET_ITEMS,
+	                      itemInfoList);
+}
+
+void DBTablesMonitoring::addMonitoringData(
+  const TriggerInfoList &triggerInfoList, const EventInfoList &eventInfoList,
+  const ItemInfoList &itemInfoList)
+{
+	struct TrxProc : public DBAgent::TransactionProc {
+		const TriggerInfoList &triggerInfoList;
+		const EventInfoList   &eventInfoList;
+		const ItemInfoList    &itemInfoList;
+
+		TrxProc(const TriggerInfoList &_triggerInfoList,
+		        const EventInfoList &_eventInfoList,
+		        const ItemInfoList &_itemInfoList)
+		: triggerInfoList(_triggerInfoList),
+		  eventInfoList(_eventInfoList),
+		  itemInfoList(_itemInfoList)
+		{
+		}
+
+		bool preproc(DBAgent &dbAgent) override
+		{
+			return !triggerInfoList.empty() ||
+			       !eventInfoList.empty() ||
+			       !itemInfoList.empty();
+		}
+
+		void operator ()(DBAgent &dbAgent) override
+		{
+			TriggerInfoListConstIterator trigIt =
+			  triggerInfoList.begin();
+			for (; trigIt != triggerInfoList.end(); ++trigIt)
+				addTriggerInfoWithoutTransaction(dbAgent,
+				                                 *trigIt);
+			EventInfoListConstIterator eventIt =
+			  eventInfoList.begin();
+			for (; eventIt != eventInfoList.end(); ++eventIt)
+				addEventInfoWithoutTransaction(dbAgent,
+				                               *eventIt);
+			ItemInfoListConstIterator itemIt = itemInfoList.begin();
+			for (; itemIt != itemInfoList.end(); ++itemIt)
+				addItemInfoWithoutTransaction(dbAgent, *itemIt);
+		}
+	} trx(triggerInfoList, eventInfoList, itemInfoList);
+	// Writes of only events and items don't wait for the lock.
+	unique_ptr<TriggerStateSnapshot::UpdateLock> updateLock;
+	if (!triggerInfoList.empty())
+		updateLock.reset(new TriggerStateSnapshot::UpdateLock());
+	getDBAgent().runTransaction(trx);
+
+	if (!triggerInfoList.empty()) {
+		TriggerStateSnapshot::update(*updateLock, triggerInfoList);
+		updateTextSearchIndex(TextSearchIndex::TARGET_TRIGGERS,
+		                      triggerInfoList);
+	}
+	if (!eventInfoList.empty()) {
+		updateTextSearchIndex(TextSearchIndex::TARGET_EVENTS,
+		                      eventInfoList);
+	}
+	if (!itemInfoList.empty()) {
+		updateTextSearchIndex(TextSearchIndex::TARGET_ITEMS,
+		                      itemInfoList);
+	}
 }
 
 void DBTablesMonitoring::getItemInfoList(ItemInfoList &itemInfoList,
@@ -2255,6 +3125,69 @@ void DBTablesMonitoring::getItemInfoList(ItemInfoList &itemInfoList,
 	}
 }
 
+void DBTablesMonitoring::getTextSearchDocuments(
+  TextSearchIndex::DocumentVect &documentVect,
+  const TextSearchIndex::Target &target)
+{
+	const DBAgent::TableProfile *tableProfile = NULL;
+	size_t serverIdIndex = 0, idIndex = 0, briefIndex = 0;
+	switch (target) {
+	case TextSearchIndex::TARGET_EVENTS:
+		tableProfile = &tableProfileEvents;
+		serverIdIndex = IDX_EVENTS_SERVER_ID;
+		idIndex = IDX_EVENTS_ID;
+		briefIndex = IDX_EVENTS_BRIEF;
+		break;
+	case TextSearchIndex::TARGET_TRIGGERS:
+		tableProfile = &tableProfileTriggers;
+		serverIdIndex = IDX_TRIGGERS_SERVER_ID;
+		idIndex = IDX_TRIGGERS_ID;
+		briefIndex = IDX_TRIGGERS_BRIEF;
+		break;
+	case TextSearchIndex::TARGET_ITEMS:
+		tableProfile = &tableProfileItems;
+		serverIdIndex = IDX_ITEMS_SERVER_ID;
+		idIndex = IDX_ITEMS_ID;
+		briefIndex = IDX_ITEMS_BRIEF;
+		break;
+	default:
+		HATOHOL_ASSERT(false, "Invalid target: %d\n", target);
+	}
+
+	DBAgent::SelectExArg arg(*tableProfile);
+	arg.add(serverIdIndex);
+	arg.add(idIndex);
+	arg.add(briefIndex);
+	// The documents are added in this order and the earlier ones are
+	// evicted first when the index is full.
+	if (target == TextSearchIndex::TARGET_EVENTS) {
+		arg.add(IDX_EVENTS_HOST_NAME);
+		arg.orderBy = StringUtils::sprintf("%s ASC",
+		  COLUMN_DEF_EVENTS[IDX_EVENTS_UNIFIED_ID].columnName);
+	} else {
+		arg.orderBy = StringUtils::sprintf("%s ASC",
+		  tableProfile->columnDefs[idIndex].columnName);
+	}
+	getDBAgent().runTransaction(arg);
+
+	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
+	documentVect.reserve(documentVect.size() + grpList.size());
+	ItemGroupListConstIterator itemGrpItr = grpList.begin();
+	for (; itemGrpItr != grpList.end(); ++itemGrpItr) {
+		ItemGroupStream itemGroupStream(*itemGrpItr);
+		documentVect.push_back(TextSearchIndex::Document());
+		TextSearchIndex::Document &document = documentVect.back();
+		itemGroupStream >> document.serverId;
+		itemGroupStream >> document.id;
+		itemGroupStream >> document.text;
+		if (target == TextSearchIndex::TARGET_EVENTS) {
+			string hostName;
+			itemGroupStream >> hostName;
+			document.text += "\n" + hostName;
+		}
+	}
+}
+
 void DBTablesMonitoring::addMonitoringServerStatus(
   MonitoringServerStatus *serverStatus)
 {
@@ -2275,101 +3208,68 @@ void DBTablesMonitoring::addMonitoringServerStatus(
 	getDBAgent().runTransaction(trx);
 }
 
-size_t DBTablesMonitoring::getNumberOfTriggers(
-  const TriggersQueryOption &option, const std::string &additionalCondition)
-{
-	DBAgent::SelectExArg arg(tableProfileTriggers);
-	string stmt = "count(*)";
-	if (option.isHostgroupUsed()) {
-		// Because a same trigger can be counted multiple times in
-		// this case, we should distinguish duplicated records. Althogh
-		// we have to use 2 columns (server ID and trigger ID) to do
-		// it, count() function doesn't accept multiple arguments.
-		// To avoid this issue we concat server ID and trigger ID.
-
-		// TODO: The statement depends on SQL implementations.
-		// We should remove this code after we improve the hostgroups
-		// issue by using sub query (github issue #168).
-		const char *fmt = NULL;
-		const type_info &dbAgentType = typeid(getDBAgent());
-		if (dbAgentType == typeid(DBAgentSQLite3))
-			fmt = "count(distinct %s || ',' || %s)";
-		else if (dbAgentType == typeid(DBAgentMySQL))
-			fmt = "count(distinct %s,%s)";
-		HATOHOL_ASSERT(fmt, "Unknown DBAgent type.");
-
-		stmt = StringUtils::sprintf(fmt,
-		  option.getColumnName(IDX_TRIGGERS_SERVER_ID).c_str(),
-		  option.getColumnName(IDX_TRIGGERS_ID).c_str());
+// Count the triggers found in the snapshot. If status or severity is
+// given, only the triggers that have it are counted.
+static size_t countTriggers(const TriggersQueryOption &option,
+                            const TriggerStatusType &status,
+                            const TriggerSeverityType &severity)
+{
+	TriggerStateSnapshotPtr snapshot(TriggerStateSnapshot::get(), false);
+	TriggerStateSnapshot::TriggerInfoPtrVect triggers;
+	snapshot->find(triggers, option);
+	size_t numTriggers = 0;
+	TriggerStateSnapshot::TriggerInfoPtrVectConstIterator it =
+	  triggers.begin();
+	for (; it != triggers.end(); ++it) {
+		const TriggerInfo &triggerInfo = **it;
+		if (status != TRIGGER_STATUS_ALL &&
+		    triggerInfo.status != status) {
+			continue;
+		}
+		if (severity != TRIGGER_SEVERITY_ALL &&
+		    triggerInfo.severity != severity) {
+			continue;
+		}
+		numTriggers++;
 	}
-	arg.add(stmt, SQL_COLUMN_TYPE_INT);
-
-	// from
-	arg.tableField = option.getFromClause();
-
-	// condition
-	arg.condition = option.getCondition();
-	if (!additionalCondition.empty()) {
-		if (!arg.condition.empty())
-			arg.condition += " and ";
-		arg.condition += additionalCondition;
+	return numTriggers;
+}
+
+// Count the distinct host IDs of the triggers found in the snapshot.
+static size_t countHosts(const TriggersQueryOption &option,
+                         const TriggerStatusType &status)
+{
+	TriggerStateSnapshotPtr snapshot(TriggerStateSnapshot::get(), false);
+	TriggerStateSnapshot::TriggerInfoPtrVect triggers;
+	snapshot->find(triggers, option);
+	set<HostIdType> hostIdSet;
+	TriggerStateSnapshot::TriggerInfoPtrVectConstIterator it =
+	  triggers.begin();
+	for (; it != triggers.end(); ++it) {
+		const TriggerInfo &triggerInfo = **it;
+		if (status != TRIGGER_STATUS_ALL &&
+		    triggerInfo.status != status) {
+			continue;
+		}
+		hostIdSet.insert(triggerInfo.hostId);
 	}
-
-	getDBAgent().runTransaction(arg);
-
-	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
-	ItemGroupStream itemGroupStream(*grpList.begin());
-	return itemGroupStream.read<int>();
+	return hostIdSet.size();
 }
 
 size_t DBTablesMonitoring::getNumberOfBadTriggers(
   const TriggersQueryOption &option, TriggerSeverityType severity)
 {
-	string additionalCondition;
-
-	if (severity == TRIGGER_SEVERITY_ALL) {
-		additionalCondition
-		  = StringUtils::sprintf(
-		      "%s=%d",
-		      option.getColumnName(IDX_TRIGGERS_STATUS).c_str(),
-		      TRIGGER_STATUS_PROBLEM);
-	} else {
-		additionalCondition
-		  = StringUtils::sprintf(
-		      "%s=%d and %s=%d",
-		      option.getColumnName(IDX_TRIGGERS_SEVERITY).c_str(),
-		      severity,
-		      option.getColumnName(IDX_TRIGGERS_STATUS).c_str(),
-		      TRIGGER_STATUS_PROBLEM);
-	}
-	return getNumberOfTriggers(option, additionalCondition);
+	return countTriggers(option, TRIGGER_STATUS_PROBLEM, severity);
 }
 
 size_t DBTablesMonitoring::getNumberOfTriggers(const TriggersQueryOption &option)
 {
-	return getNumberOfTriggers(option, string());
+	return countTriggers(option, TRIGGER_STATUS_ALL, TRIGGER_SEVERITY_ALL);
 }
 
 size_t DBTablesMonitoring::getNumberOfHosts(const TriggersQueryOption &option)
 {
-	// TODO: consider if we can use hosts table.
-	DBAgent::SelectExArg arg(tableProfileTriggers);
-	string stmt =
-	  StringUtils::sprintf("count(distinct %s)",
-	    option.getColumnName(IDX_TRIGGERS_HOST_ID).c_str());
-	arg.add(stmt, SQL_COLUMN_TYPE_INT);
-
-	// from
-	arg.tableField = option.getFromClause();
-
-	// condition
-	arg.condition = option.getCondition();
-
-	getDBAgent().runTransaction(arg);
-
-	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
-	ItemGroupStream itemGroupStream(*grpList.begin());
-	return itemGroupStream.read<int>();
+	return countHosts(option, TRIGGER_STATUS_ALL);
 }
 
 size_t DBTablesMonitoring::getNumberOfGoodHosts(const TriggersQueryOption &option)
@@ -2384,30 +3284,7 @@ size_t DBTablesMonitoring::getNumberOfGoodHosts(const TriggersQueryOption &optio
 
 size_t DBTablesMonitoring::getNumberOfBadHosts(const TriggersQueryOption &option)
 {
-	DBAgent::SelectExArg arg(tableProfileTriggers);
-	string stmt =
-	  StringUtils::sprintf("count(distinct %s)",
-	    option.getColumnName(IDX_TRIGGERS_HOST_ID).c_str());
-	arg.add(stmt, SQL_COLUMN_TYPE_INT);
-
-	// from
-	arg.tableField = option.getFromClause();
-
-	// condition
-	arg.condition = option.getCondition();
-	if (!arg.condition.empty())
-		arg.condition += " AND ";
-
-	arg.condition +=
-	  StringUtils::sprintf("%s=%d",
-	    option.getColumnName(IDX_TRIGGERS_STATUS).c_str(),
-	    TRIGGER_STATUS_PROBLEM);
-
-	getDBAgent().runTransaction(arg);
-
-	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
-	ItemGroupStream itemGroupStream(*grpList.begin());
-	return itemGroupStream.read<int>();
+	return countHosts(option, TRIGGER_STATUS_PROBLEM);
 }
 
 size_t DBTablesMonitoring::getNumberOfItems(
@@ -2643,6 +3520,8 @@ DBTables::SetupInfo &DBTablesMonitoring::getSetupInfo(void)
 		&tableProfileHostgroups,
 	}, {
 		&tableProfileMapHostsHostgroups,
+	}, {
+		&tableProfileHostDependencies,
 	}, {
 		&tableProfileServerStatus,
 	}, {
@@ -2693,6 +3572,7 @@ void DBTablesMonitoring::addEventInfoWithoutTransaction(
 	arg.add(eventInfo.hostId);
 	arg.add(eventInfo.hostName);
 	arg.add(eventInfo.brief);
+	arg.add(eventInfo.correlation);
 	arg.upsertOnDuplicate = true;
 	dbAgent.insert(arg);
 }
@@ -2728,7 +3608,8 @@ void DBTablesMonitoring::addHostgroupInfoWithoutTransaction(
 	dbAgent.insert(arg);
 }
 
-void DBTablesMonitoring::addHostgroupElementWithoutTransaction(
+// Returns false if the element has already been there.
+bool DBTablesMonitoring::addHostgroupElementWithoutTransaction(
   DBAgent &dbAgent, const HostgroupElement &hostgroupElement)
 {
 	// TODO: create the condition outside of the transaction.
@@ -2739,15 +3620,17 @@ void DBTablesMonitoring::addHostgroupElementWithoutTransaction(
 	  dbTermCodec->enc(hostgroupElement.hostId).c_str(),
 	  dbTermCodec->enc(hostgroupElement.groupId).c_str());
 
-	if (!dbAgent.isRecordExisting(TABLE_NAME_MAP_HOSTS_HOSTGROUPS,
-	                              condition)) {
-		DBAgent::InsertArg arg(tableProfileMapHostsHostgroups);
-		arg.add(hostgroupElement.id);
-		arg.add(hostgroupElement.serverId);
-		arg.add(hostgroupElement.hostId);
-		arg.add(hostgroupElement.groupId);
-		dbAgent.insert(arg);
+	if (dbAgent.isRecordExisting(TABLE_NAME_MAP_HOSTS_HOSTGROUPS,
+	                             condition)) {
+		return false;
 	}
+	DBAgent::InsertArg arg(tableProfileMapHostsHostgroups);
+	arg.add(hostgroupElement.id);
+	arg.add(hostgroupElement.serverId);
+	arg.add(hostgroupElement.hostId);
+	arg.add(hostgroupElement.groupId);
+	dbAgent.insert(arg);
+	return true;
 }
 
 void DBTablesMonitoring::addHostInfoWithoutTransaction(
@@ -2884,5 +3767,11 @@ static bool updateDB(DBAgent &dbAgent, const int &oldVer, void *data)
 		addColumnsArg.columnIndexes.push_back(IDX_ITEMS_UNIT);
 		dbAgent.addColumns(addColumnsArg);
 	}
+	if (oldVer <= 8) {
+		// add new columns to events
+		DBAgent::AddColumnsArg addColumnsArg(tableProfileEvents);
+		addColumnsArg.columnIndexes.push_back(IDX_EVENTS_CORRELATION);
+		dbAgent.addColumns(addColumnsArg);
+	}
 	return true;
 }
@@ -28,6 +28,7 @@
 #include "HostResourceQueryOption.h"
 #include "SmartTime.h"
 #include "Monitoring.h"
+#include "TextSearchIndex.h"
 
 class EventsQueryOption : public HostResourceQueryOption {
 public:
@@ -59,6 +60,13 @@ public:
 	void setTriggerId(const TriggerIdType &triggerId);
 	TriggerIdType getTriggerId(void) const;
 
+	/**
+	 * Set words to be searched in the brief and the host name.
+	 * An empty query matches all events.
+	 */
+	void setTextQuery(const std::string &query);
+	const std::string &getTextQuery(void) const;
+
 private:
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
@@ -80,6 +88,13 @@ public:
 	void setTriggerStatus(const TriggerStatusType &status);
 	TriggerStatusType getTriggerStatus(void) const;
 
+	/**
+	 * Set words to be searched in the brief.
+	 * An empty query matches all triggers.
+	 */
+	void setTextQuery(const std::string &query);
+	const std::string &getTextQuery(void) const;
+
 private:
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
@@ -99,6 +114,13 @@ public:
 	void setTargetItemGroupName(const std::string &itemGroupName);
 	const std::string &getTargetItemGroupName(void);
 
+	/**
+	 * Set words to be searched in the brief.
+	 * An empty query matches all items.
+	 */
+	void setTextQuery(const std::string &query);
+	const std::string &getTextQuery(void) const;
+
 private:
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
@@ -149,6 +171,7 @@ public:
 	static const char *TABLE_NAME_HOSTS;
 	static const char *TABLE_NAME_HOSTGROUPS;
 	static const char *TABLE_NAME_MAP_HOSTS_HOSTGROUPS;
+	static const char *TABLE_NAME_HOST_DEPENDENCIES;
 	static const char *TABLE_NAME_SERVER_STATUS;
 	static const char *TABLE_NAME_INCIDENTS;
 
@@ -178,6 +201,16 @@ public:
 	                    const TriggersQueryOption &option);
 	void getTriggerInfoList(TriggerInfoList &triggerInfoList,
 				const TriggersQueryOption &option);
+
+	/**
+	 * Get all triggers and host group elements in the DB to make
+	 * a TriggerStateSnapshot.
+	 *
+	 * @param triggerInfoList The triggers are appended to this.
+	 * @param hostgroupElementList The elements are appended to this.
+	 */
+	void getTriggerStateSources(TriggerInfoList &triggerInfoList,
+	                            HostgroupElementList &hostgroupElementList);
 	void setTriggerInfoList(const TriggerInfoList &triggerInfoList,
 	                        const ServerIdType &serverId);
 	/**
@@ -200,6 +233,14 @@ public:
 
 	void addHostgroupInfo(HostgroupInfo *eventInfo);
 	void addHostgroupInfoList(const HostgroupInfoList &groupInfoList);
+
+	/**
+	 * Delete host groups.
+	 *
+	 * @param groupInfoList
+	 * Host groups to be deleted. Only serverId and groupId are used.
+	 */
+	void deleteHostgroupInfoList(const HostgroupInfoList &groupInfoList);
 	HatoholError getHostgroupInfoList(HostgroupInfoList &hostgroupInfoList,
 	                      const HostgroupsQueryOption &option);
 	HatoholError getHostgroupElementList
@@ -210,6 +251,26 @@ public:
 	void addHostgroupElementList
 	  (const HostgroupElementList &mapHostHostgroupsInfoList);
 
+	/**
+	 * Delete host group elements.
+	 *
+	 * @param hostgroupElementList
+	 * Elements to be deleted. Only serverId, hostId and groupId are used.
+	 */
+	void deleteHostgroupElementList(
+	  const HostgroupElementList &hostgroupElementList);
+
+	/**
+	 * Add a dependency between hosts used by EventCorrelator.
+	 *
+	 * @param hostDependency
+	 * A dependency to be added. The ID of the added record is set to
+	 * its id.
+	 */
+	void addHostDependency(HostDependency *hostDependency);
+	void deleteHostDependency(const int &id);
+	void getHostDependencyList(HostDependencyList &hostDependencyList);
+
 	void addHostInfo(HostInfo *hostInfo);
 	void addHostInfoList(const HostInfoList &hostInfoList);
 
@@ -225,15 +286,45 @@ public:
 	void updateHosts(const HostInfoList &hostInfoList,
 	                 const ServerIdType &serverId);
 
+	/**
+	 * Update the host group records.
+	 *
+	 * The records that are not included in the given groupInfoList
+	 * are deleted.
+	 *
+	 * @param groupInfoList A list of host groups.
+	 * @param serverId      A monitoring server ID.
+	 */
+	void updateHostgroups(const HostgroupInfoList &groupInfoList,
+	                      const ServerIdType &serverId);
+
+	/**
+	 * Update the host group element records.
+	 *
+	 * The records that are not included in the given hostgroupElementList
+	 * are deleted.
+	 *
+	 * @param hostgroupElementList A list of host group elements.
+	 * @param serverId             A monitoring server ID.
+	 */
+	void updateHostgroupElements(
+	  const HostgroupElementList &hostgroupElementList,
+	  const ServerIdType &serverId);
+
 	/**
 	 * get the last (maximum) event ID of the event that belongs to
 	 * the specified server
 	 * @param serverId A target server ID.
+	 * @param upperBound
+	 * Only IDs less than this are taken into account. It is ignored if
+	 * EVENT_NOT_FOUND is given.
 	 * @return
 	 * The last event ID. If there is no event data, EVENT_NOT_FOUND
 	 * is returned.
 	 */
-	EventIdType getLastEventId(const ServerIdType &serverId);
+	EventIdType getLastEventId(
+	  const ServerIdType &serverId,
+	  const EventIdType &upperBound = EVENT_NOT_FOUND);
 
 	/**
 	 * Get the time of the last event.
@@ -249,10 +340,48 @@ public:
 	  const ServerIdType &serverId,
 	  const TriggerIdType &triggerId = ALL_TRIGGERS);
 
+	/**
+	 * Get the time of the last event of each trigger at once.
+	 *
+	 * The result is the same as that of getTimeOfLastEvent() for each
+	 * trigger. However, the number of queries doesn't depend on the
+	 * number of triggers.
+	 *
+	 * @param serverId   A target server ID.
+	 * @param triggerIds Target trigger IDs.
+	 * @param times
+	 * The times are stored in the same order as triggerIds. If there's
+	 * no event of a trigger, hasValidTime() of the element is false.
+	 */
+	void getTimesOfLastEvents(
+	  const ServerIdType &serverId,
+	  const std::vector<TriggerIdType> &triggerIds,
+	  std::vector<mlpl::SmartTime> &times);
+
 	void addItemInfo(ItemInfo *itemInfo);
 	void addItemInfoList(const ItemInfoList &itemInfoList);
+
+	/**
+	 * Add triggers, events and items in one transaction.
+	 * Any of the lists may be empty.
+	 *
+	 * @param triggerInfoList A list of TriggerInfo.
+	 * @param eventInfoList A list of EventInfo.
+	 * @param itemInfoList A list of ItemInfo.
+	 */
+	void addMonitoringData(const TriggerInfoList &triggerInfoList,
+	                       const EventInfoList &eventInfoList,
+	                       const ItemInfoList &itemInfoList);
 	void getItemInfoList(ItemInfoList &itemInfoList,
 			     const ItemsQueryOption &option);
+
+	/**
+	 * Get the texts of all the records of a target to build a
+	 * TextSearchIndex.
+	 */
+	void getTextSearchDocuments(
+	  TextSearchIndex::DocumentVect &documentVect,
+	  const TextSearchIndex::Target &target);
 	void addMonitoringServerStatus(MonitoringServerStatus *serverStatus);
 
 	/**
@@ -313,7 +442,7 @@ protected:
 	  DBAgent &dbAgent, const ItemInfo &itemInfo);
 	static void addHostgroupInfoWithoutTransaction(
 	  DBAgent &dbAgent, const HostgroupInfo &groupInfo);
-	static void addHostgroupElementWithoutTransaction(
+	static bool addHostgroupElementWithoutTransaction(
 	  DBAgent &dbAgent, const HostgroupElement &hostgroupElement);
 	static void addHostInfoWithoutTransaction(
 	  DBAgent &dbAgent, const HostInfo &hostInfo);
@@ -321,8 +450,8 @@ protected:
 	  DBAgent &dbAgent, const MonitoringServerStatus &serverStatus);
 	static void addIncidentInfoWithoutTransaction(
 	  DBAgent &dbAgent, const IncidentInfo &incidentInfo);
-	size_t getNumberOfTriggers(const TriggersQueryOption &option,
-				   const std::string &additionalCondition);
+	void getTriggerInfoListFromDB(TriggerInfoList &triggerInfoList,
+	                              const TriggersQueryOption &option);
 
 
 private:
@@ -32,3 +32,10 @@ string DBTermCodec::enc(const uint64_t &val) const
 {
 	return StringUtils::sprintf("%" PRIu64, val);
 }
+
+string DBTermCodec::enc(const string &val) const
+{
+	string escaped = StringUtils::replace(val, "\\", "\\\\");
+	escaped = StringUtils::replace(escaped, "'", "''");
+	return "'" + escaped + "'";
+}
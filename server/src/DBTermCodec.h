@@ -27,6 +27,12 @@ class DBTermCodec {
 public:
 	virtual std::string enc(const int &val) const;
 	virtual std::string enc(const uint64_t &val) const;
+
+	/**
+	 * Make a quoted string literal. The quotes and backslashes in
+	 * the value are escaped.
+	 */
+	virtual std::string enc(const std::string &val) const;
 };
 
 #endif // DBTermCodec_h
@@ -17,7 +17,43 @@
  * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <Mutex.h>
 #include "DataStore.h"
+using namespace mlpl;
+
+// Collects the results of the fetch of each item.
+struct HistoryCollector {
+	Mutex                      mutex;
+	size_t                     numRemaining;
+	HistoryInfoVect            historyInfoVect;
+	Closure1<HistoryInfoVect> *closure;
+};
+
+struct HistoryCollectClosure : public Closure1<HistoryInfoVect>
+{
+	HistoryCollector *m_collector;
+
+	HistoryCollectClosure(HistoryCollector *collector)
+	: m_collector(collector)
+	{
+	}
+
+	// The closure is called once for each item, also on a failure.
+	virtual void operator()(const HistoryInfoVect &historyInfoVect)
+	{
+		m_collector->mutex.lock();
+		m_collector->historyInfoVect.insert(
+		  m_collector->historyInfoVect.end(),
+		  historyInfoVect.begin(), historyInfoVect.end());
+		const bool completed = (--m_collector->numRemaining == 0);
+		m_collector->mutex.unlock();
+		if (!completed)
+			return;
+		(*m_collector->closure)(m_collector->historyInfoVect);
+		delete m_collector->closure;
+		delete m_collector;
+	}
+};
 
 // ---------------------------------------------------------------------------
 // Public methods
@@ -49,6 +85,30 @@ void DataStore::startOnDemandFetchHistory(const ItemInfo &itemInfo,
 	delete closure;
 }
 
+void DataStore::startOnDemandFetchHistories(const ItemInfoList &itemInfoList,
+					    const time_t &beginTime,
+					    const time_t &endTime,
+					    Closure1<HistoryInfoVect> *closure)
+{
+	if (itemInfoList.empty()) {
+		HistoryInfoVect historyInfoVect;
+		(*closure)(historyInfoVect);
+		delete closure;
+		return;
+	}
+
+	// The counter is set before the first fetch because it may
+	// complete immediately.
+	HistoryCollector *collector = new HistoryCollector();
+	collector->numRemaining = itemInfoList.size();
+	collector->closure = closure;
+	ItemInfoListConstIterator it = itemInfoList.begin();
+	for (; it != itemInfoList.end(); ++it) {
+		startOnDemandFetchHistory(*it, beginTime, endTime,
+		                          new HistoryCollectClosure(collector));
+	}
+}
+
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
@@ -39,11 +39,27 @@ public:
 	virtual void setCopyOnDemandEnable(bool enable);
 	virtual bool isFetchItemsSupported(void);
 	virtual void startOnDemandFetchItem(Closure0 *closure);
+
+	/**
+	 * Fetch the history of an item. The closure is called once, with
+	 * no sample on a failure, and then deleted by the data store.
+	 */
 	virtual void startOnDemandFetchHistory(
 	  const ItemInfo &itemInfo,
 	  const time_t &beginTime,
 	  const time_t &endTime,
 	  Closure1<HistoryInfoVect> *closure);
+
+	/**
+	 * Fetch the history of items of this data store. The closure is
+	 * called once with the samples of all the items. The default
+	 * implementation calls startOnDemandFetchHistory() for each item.
+	 */
+	virtual void startOnDemandFetchHistories(
+	  const ItemInfoList &itemInfoList,
+	  const time_t &beginTime,
+	  const time_t &endTime,
+	  Closure1<HistoryInfoVect> *closure);
 protected:
 	virtual ~DataStore();
 };
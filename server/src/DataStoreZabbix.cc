@@ -69,6 +69,14 @@ void DataStoreZabbix::startOnDemandFetchHistory(
 	m_armApi.fetchHistory(itemInfo, beginTime, endTime, closure);
 }
 
+void DataStoreZabbix::startOnDemandFetchHistories(
+  const ItemInfoList &itemInfoList,
+  const time_t &beginTime, const time_t &endTime,
+  Closure1<HistoryInfoVect> *closure)
+{
+	m_armApi.fetchHistory(itemInfoList, beginTime, endTime, closure);
+}
+
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
@@ -40,6 +40,11 @@ public:
 	  const time_t &beginTime,
 	  const time_t &endTime,
 	  Closure1<HistoryInfoVect> *closure) override;
+	virtual void startOnDemandFetchHistories(
+	  const ItemInfoList &itemInfoList,
+	  const time_t &beginTime,
+	  const time_t &endTime,
+	  Closure1<HistoryInfoVect> *closure) override;
 private:
 	ArmZabbixAPI	m_armApi;
 };
@@ -0,0 +1,539 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <Mutex.h>
+#include <Logger.h>
+#include <SmartBuffer.h>
+#include <StringUtils.h>
+#include "EventAdmissionController.h"
+#include "MonitoringDataCodec.h"
+using namespace std;
+using namespace mlpl;
+
+const size_t EventAdmissionController::DEFAULT_MAX_SPOOL_SIZE =
+  64 * 1024 * 1024;
+
+// ---------------------------------------------------------------------------
+// Spool file
+// ---------------------------------------------------------------------------
+// Each record of a spool file is a 32-bit length of the body followed by
+// the body that has the fields of an EventInfo.
+static bool writeRecord(FILE *fp, const EventInfo &eventInfo)
+{
+	SmartBuffer buf;
+	buf.addEx32(0); // The length is set at last.
+	MonitoringDataCodec::encode(buf, eventInfo);
+	const size_t size = buf.index();
+	buf.setAt(0, size - sizeof(uint32_t));
+	return fwrite(static_cast<char *>(buf), size, 1, fp) == 1;
+}
+
+static bool readRecord(FILE *fp, EventInfo &eventInfo)
+{
+	uint32_t length;
+	if (fread(&length, sizeof(length), 1, fp) != 1 || length == 0)
+		return false;
+	SmartBuffer buf(length);
+	if (fread(static_cast<char *>(buf), length, 1, fp) != 1)
+		return false;
+	return MonitoringDataCodec::decode(buf, eventInfo);
+}
+
+// ---------------------------------------------------------------------------
+// Private context
+// ---------------------------------------------------------------------------
+struct SourceState {
+	double      tokens;
+	SmartTime   lastRefillTime;
+	std::string spoolPath;
+	long        spoolSize;
+	long        readOffset;
+	// The read position in the offset file. It is behind readOffset
+	// while the replayed events are being stored.
+	long        savedOffset;
+	size_t      numReplaying;
+	EventIdType lastSpooledEventId;
+	EventAdmissionController::Statistics statistics;
+
+	SourceState(void)
+	: tokens(0),
+	  spoolSize(0),
+	  readOffset(0),
+	  savedOffset(0),
+	  numReplaying(0),
+	  lastSpooledEventId(EVENT_NOT_FOUND)
+	{
+	}
+
+	string getOffsetPath(void) const
+	{
+		return spoolPath + ".offset";
+	}
+};
+
+typedef map<ServerIdType, SourceState>  SourceStateMap;
+typedef SourceStateMap::iterator        SourceStateMapIterator;
+typedef SourceStateMap::const_iterator  SourceStateMapConstIterator;
+typedef map<ServerIdType, EventInfoList> ServerEventListMap;
+typedef ServerEventListMap::iterator    ServerEventListMapIterator;
+
+struct EventAdmissionController::Impl
+{
+	const size_t   rate;
+	const size_t   burst;
+	const string   spoolDirectory;
+	const size_t   maxSpoolSize;
+	mutable Mutex  mutex;
+	SourceStateMap sourceStateMap;
+	bool           replaying;
+
+	Impl(const size_t &_rate, const size_t &_burst, const string &dir,
+	     const size_t &_maxSpoolSize)
+	: rate(_rate),
+	  burst(_burst),
+	  spoolDirectory(dir),
+	  maxSpoolSize(_maxSpoolSize),
+	  replaying(false)
+	{
+	}
+
+	SourceState &getSourceState(const ServerIdType &serverId,
+	                            const SmartTime &now)
+	{
+		SourceStateMapIterator it = sourceStateMap.find(serverId);
+		if (it != sourceStateMap.end())
+			return it->second;
+		SourceState &state = sourceStateMap[serverId];
+		state.tokens = burst;
+		state.lastRefillTime = now;
+		state.spoolPath = StringUtils::sprintf(
+		  "%s/event-spool-%" FMT_SERVER_ID,
+		  spoolDirectory.c_str(), serverId);
+		loadSpool(state);
+		return state;
+	}
+
+	// Take over the events spooled before the restart.
+	void loadSpool(SourceState &state)
+	{
+		FILE *fp = fopen(state.getOffsetPath().c_str(), "r");
+		if (fp) {
+			if (fscanf(fp, "%ld", &state.readOffset) != 1)
+				state.readOffset = 0;
+			fclose(fp);
+		}
+		fp = fopen(state.spoolPath.c_str(), "rb");
+		if (!fp) {
+			state.readOffset = 0;
+			return;
+		}
+		state.savedOffset = state.readOffset;
+		size_t numPending = 0;
+		if (fseek(fp, state.readOffset, SEEK_SET) == 0) {
+			EventInfo eventInfo;
+			while (readRecord(fp, eventInfo)) {
+				updateLastSpooledEventId(state, eventInfo);
+				numPending++;
+			}
+		}
+		if (fseek(fp, 0, SEEK_END) == 0)
+			state.spoolSize = ftell(fp);
+		fclose(fp);
+		state.statistics.numPending = numPending;
+		if (numPending == 0)
+			removeSpool(state);
+		else
+			MLPL_INFO("Found %zd spooled events: %s\n",
+			          numPending, state.spoolPath.c_str());
+	}
+
+	static void updateLastSpooledEventId(SourceState &state,
+	                                     const EventInfo &eventInfo)
+	{
+		if (state.lastSpooledEventId == EVENT_NOT_FOUND ||
+		    eventInfo.id > state.lastSpooledEventId)
+			state.lastSpooledEventId = eventInfo.id;
+	}
+
+	bool appendToSpool(SourceState &state, const EventInfoList &eventList)
+	{
+		// The replayed part is not counted, since it is cut off by
+		// compactSpool().
+		if (state.spoolSize - state.readOffset >= (long)maxSpoolSize) {
+			MLPL_ERR("The spool file is full: %s\n",
+			         state.spoolPath.c_str());
+			return false;
+		}
+		FILE *fp = fopen(state.spoolPath.c_str(), "ab");
+		if (!fp) {
+			MLPL_ERR("Failed to open %s: %s\n",
+			         state.spoolPath.c_str(), strerror(errno));
+			return false;
+		}
+		bool succeeded = true;
+		EventInfoListConstIterator it = eventList.begin();
+		for (; it != eventList.end() && succeeded; ++it) {
+			succeeded = writeRecord(fp, *it);
+			updateLastSpooledEventId(state, *it);
+		}
+		const long size = ftell(fp);
+		if (size >= 0)
+			state.spoolSize = size;
+		if (fclose(fp) != 0)
+			succeeded = false;
+		if (!succeeded) {
+			MLPL_ERR("Failed to write %s: %s\n",
+			         state.spoolPath.c_str(), strerror(errno));
+		}
+		return succeeded;
+	}
+
+	size_t readFromSpool(SourceState &state, const size_t &numEvents,
+	                     EventInfoList &eventList)
+	{
+		FILE *fp = fopen(state.spoolPath.c_str(), "rb");
+		if (!fp) {
+			MLPL_ERR("Failed to open %s: %s\n",
+			         state.spoolPath.c_str(), strerror(errno));
+			return 0;
+		}
+		size_t numRead = 0;
+		if (fseek(fp, state.readOffset, SEEK_SET) == 0) {
+			EventInfo eventInfo;
+			while (numRead < numEvents &&
+			       readRecord(fp, eventInfo)) {
+				eventList.push_back(eventInfo);
+				numRead++;
+			}
+			state.readOffset = ftell(fp);
+		}
+		fclose(fp);
+		return numRead;
+	}
+
+	// The offset file is replaced with a new one so that a crash
+	// doesn't leave a broken offset.
+	bool saveReadOffset(SourceState &state)
+	{
+		const string path = state.getOffsetPath();
+		const string tmpPath = path + ".tmp";
+		FILE *fp = fopen(tmpPath.c_str(), "w");
+		if (!fp) {
+			MLPL_ERR("Failed to open %s: %s\n",
+			         tmpPath.c_str(), strerror(errno));
+			return false;
+		}
+		const bool written =
+		  (fprintf(fp, "%ld\n", state.readOffset) > 0);
+		if (fclose(fp) != 0 || !written ||
+		    rename(tmpPath.c_str(), path.c_str()) != 0) {
+			MLPL_ERR("Failed to write %s: %s\n",
+			         path.c_str(), strerror(errno));
+			remove(tmpPath.c_str());
+			return false;
+		}
+		state.savedOffset = state.readOffset;
+		return true;
+	}
+
+	static bool copyFileTail(FILE *src, FILE *dst)
+	{
+		char buf[BUFSIZ];
+		size_t size;
+		while ((size = fread(buf, 1, sizeof(buf), src)) > 0) {
+			if (fwrite(buf, 1, size, dst) != size)
+				return false;
+		}
+		return !ferror(src);
+	}
+
+	// The pending events are moved to a new spool file so that the
+	// replayed part doesn't keep growing while events keep spilling.
+	// If the process crashes between saving the offset and replacing
+	// the spool file, the stored events are admitted again, which is
+	// better than losing the pending ones. The caller saves the read
+	// offset of the current file when this returns false.
+	bool compactSpool(SourceState &state)
+	{
+		const string tmpPath = state.spoolPath + ".tmp";
+		FILE *src = fopen(state.spoolPath.c_str(), "rb");
+		if (!src) {
+			MLPL_ERR("Failed to open %s: %s\n",
+			         state.spoolPath.c_str(), strerror(errno));
+			return false;
+		}
+		FILE *dst = fopen(tmpPath.c_str(), "wb");
+		if (!dst) {
+			MLPL_ERR("Failed to open %s: %s\n",
+			         tmpPath.c_str(), strerror(errno));
+			fclose(src);
+			return false;
+		}
+		bool succeeded = (fseek(src, state.readOffset, SEEK_SET) == 0);
+		if (succeeded)
+			succeeded = copyFileTail(src, dst);
+		fclose(src);
+		if (fclose(dst) != 0)
+			succeeded = false;
+		if (!succeeded) {
+			MLPL_ERR("Failed to write %s: %s\n",
+			         tmpPath.c_str(), strerror(errno));
+			remove(tmpPath.c_str());
+			return false;
+		}
+
+		const long readOffset = state.readOffset;
+		state.readOffset = 0;
+		if (!saveReadOffset(state)) {
+			state.readOffset = readOffset;
+			remove(tmpPath.c_str());
+			return false;
+		}
+		if (rename(tmpPath.c_str(), state.spoolPath.c_str()) != 0) {
+			MLPL_ERR("Failed to rename %s: %s\n",
+			         tmpPath.c_str(), strerror(errno));
+			state.readOffset = readOffset;
+			remove(tmpPath.c_str());
+			return false;
+		}
+		state.spoolSize -= readOffset;
+		return true;
+	}
+
+	void removeSpool(SourceState &state)
+	{
+		remove(state.spoolPath.c_str());
+		remove(state.getOffsetPath().c_str());
+		state.spoolSize = 0;
+		state.readOffset = 0;
+		state.savedOffset = 0;
+		state.lastSpooledEventId = EVENT_NOT_FOUND;
+	}
+
+	void refill(SourceState &state, const SmartTime &now)
+	{
+		if (now <= state.lastRefillTime)
+			return;
+		SmartTime elapsed(now);
+		elapsed -= state.lastRefillTime;
+		state.tokens += rate * elapsed.getAsSec();
+		if (state.tokens > burst)
+			state.tokens = burst;
+		state.lastRefillTime = now;
+	}
+
+	// The read position is saved by finishReplay().
+	size_t replay(SourceState &state, EventInfoList &admittedEventList)
+	{
+		Statistics &statistics = state.statistics;
+		if (statistics.numPending == 0)
+			return 0;
+		size_t numEvents = state.tokens;
+		if (numEvents > statistics.numPending)
+			numEvents = statistics.numPending;
+		if (numEvents == 0)
+			return 0;
+		const size_t numRead =
+		  readFromSpool(state, numEvents, admittedEventList);
+		state.tokens -= numRead;
+		state.numReplaying += numRead;
+		statistics.numReplayed += numRead;
+		statistics.numPending -= numRead;
+		if (numRead < numEvents) {
+			MLPL_ERR("Dropped %zd broken spooled events: %s\n",
+			         statistics.numPending,
+			         state.spoolPath.c_str());
+			statistics.numPending = 0;
+			if (state.numReplaying == 0)
+				removeSpool(state);
+		}
+		return numRead;
+	}
+
+	bool needToCompactSpool(const SourceState &state) const
+	{
+		return state.readOffset >= (long)maxSpoolSize / 2;
+	}
+
+	void finishReplay(SourceState &state, const bool &stored)
+	{
+		Statistics &statistics = state.statistics;
+		if (stored) {
+			if (statistics.numPending == 0)
+				removeSpool(state);
+			else if (!needToCompactSpool(state) ||
+			         !compactSpool(state))
+				saveReadOffset(state);
+		} else {
+			state.readOffset = state.savedOffset;
+			statistics.numReplayed -= state.numReplaying;
+			statistics.numPending += state.numReplaying;
+		}
+		state.numReplaying = 0;
+	}
+
+	// The events replayed in the same call are stored with the new
+	// ones, while those replayed by another caller may not be yet.
+	void admitNewEvents(SourceState &state,
+	                    EventInfoList &admittedEventList,
+	                    const EventInfoList &eventList,
+	                    const bool &replayedByOther)
+	{
+		Statistics &statistics = state.statistics;
+		EventInfoList spilledEventList;
+		EventInfoListConstIterator it = eventList.begin();
+		for (; it != eventList.end(); ++it) {
+			// The spooled events must be admitted first.
+			if (statistics.numPending > 0 ||
+			    (replayedByOther && state.numReplaying > 0) ||
+			    !spilledEventList.empty() || state.tokens < 1) {
+				spilledEventList.push_back(*it);
+				continue;
+			}
+			admittedEventList.push_back(*it);
+			state.tokens -= 1;
+			statistics.numAdmitted++;
+		}
+		if (spilledEventList.empty())
+			return;
+		if (!appendToSpool(state, spilledEventList)) {
+			// Losing events is worse than exceeding the rate.
+			statistics.numAdmitted += spilledEventList.size();
+			admittedEventList.splice(admittedEventList.end(),
+			                         spilledEventList);
+			return;
+		}
+		statistics.numSpilled += spilledEventList.size();
+		statistics.numPending += spilledEventList.size();
+	}
+};
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+EventAdmissionController::Statistics::Statistics(void)
+: numAdmitted(0),
+  numSpilled(0),
+  numReplayed(0),
+  numPending(0)
+{
+}
+
+EventAdmissionController::EventAdmissionController(
+  const size_t &rate, const size_t &burst, const string &spoolDirectory,
+  const size_t &maxSpoolSize)
+: m_impl(new Impl(rate, burst, spoolDirectory, maxSpoolSize))
+{
+}
+
+EventAdmissionController::~EventAdmissionController()
+{
+}
+
+bool EventAdmissionController::isEnabled(void) const
+{
+	return m_impl->rate > 0;
+}
+
+bool EventAdmissionController::admit(EventInfoList &admittedEventList,
+                                     const EventInfoList &eventList,
+                                     const SmartTime &now)
+{
+	if (!isEnabled()) {
+		admittedEventList.insert(admittedEventList.end(),
+		                         eventList.begin(), eventList.end());
+		return false;
+	}
+
+	// The events about the connections to the servers are not limited.
+	ServerEventListMap serverEventListMap;
+	EventInfoListConstIterator it = eventList.begin();
+	for (; it != eventList.end(); ++it) {
+		if (it->id == DISCONNECT_SERVER_EVENT_ID)
+			admittedEventList.push_back(*it);
+		else
+			serverEventListMap[it->serverId].push_back(*it);
+	}
+
+	AutoMutex autoLock(&m_impl->mutex);
+	const bool canReplay = !m_impl->replaying;
+	size_t numReplayed = 0;
+	ServerEventListMapIterator serverIt = serverEventListMap.begin();
+	for (; serverIt != serverEventListMap.end(); ++serverIt) {
+		SourceState &state =
+		  m_impl->getSourceState(serverIt->first, now);
+		m_impl->refill(state, now);
+		if (canReplay)
+			numReplayed += m_impl->replay(state, admittedEventList);
+		m_impl->admitNewEvents(state, admittedEventList,
+		                       serverIt->second, !canReplay);
+	}
+
+	SourceStateMapIterator stateIt = m_impl->sourceStateMap.begin();
+	for (; canReplay && stateIt != m_impl->sourceStateMap.end();
+	     ++stateIt) {
+		SourceState &state = stateIt->second;
+		if (state.statistics.numPending == 0)
+			continue;
+		if (serverEventListMap.find(stateIt->first) !=
+		    serverEventListMap.end())
+			continue;
+		m_impl->refill(state, now);
+		numReplayed += m_impl->replay(state, admittedEventList);
+	}
+	if (numReplayed == 0)
+		return false;
+	m_impl->replaying = true;
+	return true;
+}
+
+void EventAdmissionController::finishReplay(const bool &stored)
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	SourceStateMapIterator it = m_impl->sourceStateMap.begin();
+	for (; it != m_impl->sourceStateMap.end(); ++it) {
+		if (it->second.numReplaying > 0)
+			m_impl->finishReplay(it->second, stored);
+	}
+	m_impl->replaying = false;
+}
+
+EventAdmissionController::Statistics
+  EventAdmissionController::getStatistics(const ServerIdType &serverId) const
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	SourceStateMapConstIterator it = m_impl->sourceStateMap.find(serverId);
+	if (it == m_impl->sourceStateMap.end())
+		return Statistics();
+	return it->second.statistics;
+}
+
+EventIdType EventAdmissionController::getLastSpooledEventId(
+  const ServerIdType &serverId)
+{
+	if (!isEnabled())
+		return EVENT_NOT_FOUND;
+	AutoMutex autoLock(&m_impl->mutex);
+	const SmartTime now(SmartTime::INIT_CURR_TIME);
+	return m_impl->getSourceState(serverId, now).lastSpooledEventId;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EventAdmissionController_h
+#define EventAdmissionController_h
+
+#include <string>
+#include <memory>
+#include <SmartTime.h>
+#include "Params.h"
+#include "Monitoring.h"
+
+/**
+ * Limits the rate of the events admitted from each monitoring server.
+ *
+ * Each server has a token bucket which is refilled at the rate up to
+ * the burst. An event consumes a token. The events that can't get
+ * a token are appended to the spool file of the server and admitted
+ * before the newer events of the server when tokens are refilled.
+ * So the order of the events of a server is kept. The read position of
+ * the spool file is saved after the admitted events are stored, so that
+ * they are admitted only once even after a restart.
+ *
+ * The events are admitted directly when the pending events in the spool
+ * file reach the maximum size, because losing them is worse than
+ * exceeding the rate. The replayed part is cut off from the spool file
+ * once it exceeds half of the maximum size.
+ */
+class EventAdmissionController {
+public:
+	struct Statistics {
+		size_t numAdmitted;
+		size_t numSpilled;
+		size_t numReplayed;
+		size_t numPending;
+
+		Statistics(void);
+	};
+
+	static const size_t DEFAULT_MAX_SPOOL_SIZE;
+
+	/**
+	 * Constructor.
+	 *
+	 * @param rate
+	 * The number of the events per second admitted from each server.
+	 * If it is 0, all events are admitted immediately.
+	 * @param burst The capacity of the token bucket.
+	 * @param spoolDirectory The directory where spool files are created.
+	 * @param maxSpoolSize
+	 * The maximum size in bytes of the pending events in a spool file.
+	 */
+	EventAdmissionController(
+	  const size_t &rate, const size_t &burst,
+	  const std::string &spoolDirectory,
+	  const size_t &maxSpoolSize = DEFAULT_MAX_SPOOL_SIZE);
+	virtual ~EventAdmissionController();
+
+	bool isEnabled(void) const;
+
+	/**
+	 * Admit events.
+	 *
+	 * The spooled events of the other servers are also admitted if
+	 * their buckets have been refilled. The spooled events are admitted
+	 * by only one caller at a time.
+	 *
+	 * @param admittedEventList The admitted events are appended.
+	 * @param eventList
+	 * Events received from the monitoring servers. It may be empty to
+	 * admit only the spooled events.
+	 * @param now The current time.
+	 * @return
+	 * true if spooled events are admitted. The caller must call
+	 * finishReplay() after it stores the admitted events.
+	 */
+	bool admit(EventInfoList &admittedEventList,
+	           const EventInfoList &eventList,
+	           const mlpl::SmartTime &now =
+	             mlpl::SmartTime(mlpl::SmartTime::INIT_CURR_TIME));
+
+	/**
+	 * Save the read positions of the spool files after the spooled
+	 * events admitted by admit() are stored.
+	 *
+	 * @param stored
+	 * false if the events aren't stored. They are admitted again.
+	 */
+	void finishReplay(const bool &stored);
+
+	Statistics getStatistics(const ServerIdType &serverId) const;
+
+	/**
+	 * Get the last ID of the events of a server in the spool file.
+	 * The spool file left before a restart is also taken into account.
+	 *
+	 * @param serverId A server ID.
+	 * @return
+	 * The event ID. If no event of the server is spooled,
+	 * EVENT_NOT_FOUND is returned.
+	 */
+	EventIdType getLastSpooledEventId(const ServerIdType &serverId);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // EventAdmissionController_h
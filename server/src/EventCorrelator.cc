@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+#include <Mutex.h>
+#include <AtomicValue.h>
+#include "EventCorrelator.h"
+#include "ThreadLocalDBCache.h"
+#include "TriggerStateSnapshot.h"
+using namespace std;
+using namespace mlpl;
+
+typedef pair<ServerIdType, HostIdType>          HostKey;
+typedef map<HostKey, HostIdVector>              HostParentsMap;
+typedef HostParentsMap::const_iterator          HostParentsMapConstIterator;
+typedef map<ServerIdType, HostIdVector>         ServerParentsMap;
+typedef ServerParentsMap::const_iterator        ServerParentsMapConstIterator;
+typedef set<HostKey>                            HostKeySet;
+typedef vector<HostKey>                         HostKeyVector;
+typedef pair<ServerIdType, HostgroupIdType>     HostgroupKey;
+typedef map<HostgroupKey, HostIdSet>            HostgroupMembersMap;
+typedef HostgroupMembersMap::const_iterator     HostgroupMembersMapConstIterator;
+
+struct TriggerProblem {
+	time_t since;
+	bool   symptom;
+};
+
+typedef map<TriggerIdType, TriggerProblem>      TriggerProblemMap;
+typedef TriggerProblemMap::const_iterator       TriggerProblemMapConstIterator;
+
+struct HostProblemState {
+	TriggerProblemMap problems;
+	bool              recovered;
+	time_t            recoveredTime;
+
+	HostProblemState(void)
+	: recovered(false),
+	  recoveredTime(0)
+	{
+	}
+
+	bool isFailing(const time_t &time, const size_t &window) const
+	{
+		TriggerProblemMapConstIterator it = problems.begin();
+		for (; it != problems.end(); ++it) {
+			// A problem received later in the same list is also
+			// regarded as the cause if it is within the window.
+			if (it->second.since <= time + (time_t)window)
+				return true;
+		}
+		return recovered && recoveredTime + (time_t)window >= time;
+	}
+};
+
+typedef map<HostKey, HostProblemState>          HostProblemStateMap;
+typedef HostProblemStateMap::iterator           HostProblemStateMapIterator;
+typedef HostProblemStateMap::const_iterator     HostProblemStateMapConstIterator;
+
+struct EventCorrelator::Impl
+{
+	static AtomicValue<int> generation;
+
+	const size_t        window;
+	Mutex               mutex;
+	bool                loaded;
+	int                 loadedGeneration;
+
+	// The parents of each host, and those of all hosts of a server.
+	HostParentsMap      parentsMap;
+	ServerParentsMap    serverParentsMap;
+	HostKeySet          parentHostSet;
+
+	HostProblemStateMap problemStateMap;
+
+	Impl(const size_t &_window)
+	: window(_window),
+	  loaded(false),
+	  loadedGeneration(0)
+	{
+	}
+
+	void addParent(const ServerIdType &serverId, const HostIdType &hostId,
+	               const HostIdType &parentHostId)
+	{
+		if (hostId == parentHostId)
+			return;
+		parentsMap[HostKey(serverId, hostId)].push_back(parentHostId);
+	}
+
+	void loadDependencies(void)
+	{
+		parentsMap.clear();
+		serverParentsMap.clear();
+		parentHostSet.clear();
+
+		ThreadLocalDBCache cache;
+		DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
+		HostDependencyList hostDependencyList;
+		dbMonitoring.getHostDependencyList(hostDependencyList);
+		if (hostDependencyList.empty())
+			return;
+
+		HostgroupElementList hostgroupElementList;
+		HostgroupElementQueryOption option(USER_ID_SYSTEM);
+		option.setFilterForDataOfDefunctServers(false);
+		dbMonitoring.getHostgroupElementList(hostgroupElementList,
+		                                     option);
+		HostgroupMembersMap membersMap;
+		HostgroupElementListConstIterator elemIt =
+		  hostgroupElementList.begin();
+		for (; elemIt != hostgroupElementList.end(); ++elemIt) {
+			const HostgroupKey key(elemIt->serverId,
+			                       elemIt->groupId);
+			membersMap[key].insert(elemIt->hostId);
+		}
+
+		HostDependencyListConstIterator it =
+		  hostDependencyList.begin();
+		for (; it != hostDependencyList.end(); ++it) {
+			const HostDependency &dep = *it;
+			parentHostSet.insert(
+			  HostKey(dep.serverId, dep.parentHostId));
+			if (dep.groupId == ALL_HOST_GROUPS) {
+				if (dep.hostId == ALL_HOSTS) {
+					serverParentsMap[dep.serverId].push_back(
+					  dep.parentHostId);
+				} else {
+					addParent(dep.serverId, dep.hostId,
+					          dep.parentHostId);
+				}
+				continue;
+			}
+			HostgroupMembersMapConstIterator membersIt =
+			  membersMap.find(HostgroupKey(dep.serverId,
+			                               dep.groupId));
+			if (membersIt == membersMap.end())
+				continue;
+			const HostIdSet &members = membersIt->second;
+			HostIdSetConstIterator hostIt = members.begin();
+			for (; hostIt != members.end(); ++hostIt) {
+				if (dep.hostId != ALL_HOSTS &&
+				    dep.hostId != *hostIt)
+					continue;
+				addParent(dep.serverId, *hostIt,
+				          dep.parentHostId);
+			}
+		}
+	}
+
+	// Take the problems that have already been there when the parent
+	// hosts are loaded.
+	void loadProblemsOfParents(void)
+	{
+		TriggersQueryOption option(USER_ID_SYSTEM);
+		option.setFilterForDataOfDefunctServers(false);
+		TriggerStateSnapshotPtr snapshot(TriggerStateSnapshot::get(),
+		                                 false);
+		TriggerStateSnapshot::TriggerInfoPtrVect triggers;
+		snapshot->find(triggers, option);
+		TriggerStateSnapshot::TriggerInfoPtrVectConstIterator it =
+		  triggers.begin();
+		for (; it != triggers.end(); ++it) {
+			const TriggerInfo &triggerInfo = **it;
+			if (triggerInfo.status != TRIGGER_STATUS_PROBLEM)
+				continue;
+			const HostKey key(triggerInfo.serverId,
+			                  triggerInfo.hostId);
+			if (parentHostSet.find(key) == parentHostSet.end())
+				continue;
+			TriggerProblemMap &problems =
+			  problemStateMap[key].problems;
+			if (problems.find(triggerInfo.id) != problems.end())
+				continue;
+			TriggerProblem &problem = problems[triggerInfo.id];
+			problem.since = triggerInfo.lastChangeTime.tv_sec;
+			problem.symptom = false;
+		}
+	}
+
+	void reloadIfNeeded(void)
+	{
+		const int currGeneration = generation;
+		if (loaded && loadedGeneration == currGeneration)
+			return;
+		loadDependencies();
+		if (!parentHostSet.empty())
+			loadProblemsOfParents();
+		loaded = true;
+		loadedGeneration = currGeneration;
+	}
+
+	bool isParent(const HostKey &key) const
+	{
+		return parentHostSet.find(key) != parentHostSet.end();
+	}
+
+	bool hasFailingParent(const HostIdVector &parents,
+	                      const ServerIdType &serverId,
+	                      const HostIdType &hostId, const time_t &time)
+	{
+		HostIdVectorConstIterator it = parents.begin();
+		for (; it != parents.end(); ++it) {
+			if (*it == hostId)
+				continue;
+			HostProblemStateMapConstIterator stateIt =
+			  problemStateMap.find(HostKey(serverId, *it));
+			if (stateIt == problemStateMap.end())
+				continue;
+			if (stateIt->second.isFailing(time, window))
+				return true;
+		}
+		return false;
+	}
+
+	// Returns false if the host doesn't depend on any host.
+	bool isSymptom(const HostKey &key, const time_t &time, bool &symptom)
+	{
+		bool hasParents = false;
+		symptom = false;
+		HostParentsMapConstIterator it = parentsMap.find(key);
+		if (it != parentsMap.end()) {
+			hasParents = true;
+			symptom = hasFailingParent(it->second, key.first,
+			                           key.second, time);
+		}
+		if (symptom)
+			return true;
+		ServerParentsMapConstIterator serverIt =
+		  serverParentsMap.find(key.first);
+		if (serverIt != serverParentsMap.end()) {
+			hasParents = true;
+			symptom = hasFailingParent(serverIt->second, key.first,
+			                           key.second, time);
+		}
+		return hasParents;
+	}
+
+	void addProblem(const HostKey &key, const TriggerIdType &triggerId,
+	                const time_t &time, const bool &symptom)
+	{
+		TriggerProblem &problem =
+		  problemStateMap[key].problems[triggerId];
+		problem.since = time;
+		problem.symptom = symptom;
+	}
+
+	// Some monitoring servers don't give the host of an event. It is
+	// taken from the trigger of the event in such a case.
+	void makeHostKeys(HostKeyVector &keys, const EventInfoList &eventList)
+	{
+		bool hasUnknownHost = false;
+		EventInfoListConstIterator it = eventList.begin();
+		for (; it != eventList.end(); ++it) {
+			keys.push_back(HostKey(it->serverId, it->hostId));
+			if (it->hostId == INVALID_HOST_ID)
+				hasUnknownHost = true;
+		}
+		if (!hasUnknownHost)
+			return;
+
+		TriggerStateSnapshotPtr snapshot(TriggerStateSnapshot::get(),
+		                                 false);
+		it = eventList.begin();
+		for (size_t i = 0; it != eventList.end(); ++it, i++) {
+			if (it->hostId != INVALID_HOST_ID)
+				continue;
+			const TriggerInfo *triggerInfo =
+			  snapshot->find(it->serverId, it->triggerId);
+			if (triggerInfo)
+				keys[i].second = triggerInfo->hostId;
+		}
+	}
+
+	void correlateProblem(EventInfo &eventInfo, const HostKey &key)
+	{
+		const time_t time = eventInfo.time.tv_sec;
+		bool symptom;
+		const bool hasParents = isSymptom(key, time, symptom);
+		const bool parent = isParent(key);
+		if (symptom)
+			eventInfo.correlation = EVENT_CORRELATION_SYMPTOM;
+		else if (parent)
+			eventInfo.correlation = EVENT_CORRELATION_ROOT_CAUSE;
+		if (hasParents || parent)
+			addProblem(key, eventInfo.triggerId, time, symptom);
+	}
+
+	void correlateRecovery(EventInfo &eventInfo, const HostKey &key)
+	{
+		HostProblemStateMapIterator stateIt =
+		  problemStateMap.find(key);
+		if (stateIt == problemStateMap.end())
+			return;
+		HostProblemState &state = stateIt->second;
+		TriggerProblemMap::iterator it =
+		  state.problems.find(eventInfo.triggerId);
+		if (it == state.problems.end())
+			return;
+		if (it->second.symptom)
+			eventInfo.correlation = EVENT_CORRELATION_SYMPTOM;
+		state.problems.erase(it);
+		if (!state.problems.empty())
+			return;
+		if (isParent(key)) {
+			state.recovered = true;
+			state.recoveredTime = eventInfo.time.tv_sec;
+		} else {
+			problemStateMap.erase(stateIt);
+		}
+	}
+};
+
+AtomicValue<int> EventCorrelator::Impl::generation(0);
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+EventCorrelator::EventCorrelator(const size_t &window)
+: m_impl(new Impl(window))
+{
+}
+
+EventCorrelator::~EventCorrelator()
+{
+}
+
+void EventCorrelator::correlate(EventInfoList &eventList)
+{
+	EventInfoListIterator it = eventList.begin();
+	for (; it != eventList.end(); ++it)
+		it->correlation = EVENT_CORRELATION_NONE;
+
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->reloadIfNeeded();
+	if (m_impl->parentHostSet.empty())
+		return;
+
+	HostKeyVector keys;
+	m_impl->makeHostKeys(keys, eventList);
+
+	// Take the problems of the parent hosts in advance so that the
+	// problems of their children received before them are tagged.
+	it = eventList.begin();
+	for (size_t i = 0; it != eventList.end(); ++it, i++) {
+		const EventInfo &eventInfo = *it;
+		if (eventInfo.status != TRIGGER_STATUS_PROBLEM)
+			continue;
+		const HostKey &key = keys[i];
+		if (!m_impl->isParent(key))
+			continue;
+		TriggerProblemMap &problems =
+		  m_impl->problemStateMap[key].problems;
+		if (problems.find(eventInfo.triggerId) != problems.end())
+			continue;
+		m_impl->addProblem(key, eventInfo.triggerId,
+		                   eventInfo.time.tv_sec, false);
+	}
+
+	it = eventList.begin();
+	for (size_t i = 0; it != eventList.end(); ++it, i++) {
+		EventInfo &eventInfo = *it;
+		if (eventInfo.id == DISCONNECT_SERVER_EVENT_ID)
+			continue;
+		if (eventInfo.status == TRIGGER_STATUS_PROBLEM)
+			m_impl->correlateProblem(eventInfo, keys[i]);
+		else if (eventInfo.status == TRIGGER_STATUS_OK)
+			m_impl->correlateRecovery(eventInfo, keys[i]);
+	}
+}
+
+void EventCorrelator::invalidateDependencies(void)
+{
+	Impl::generation.add(1);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EventCorrelator_h
+#define EventCorrelator_h
+
+#include <memory>
+#include "Params.h"
+#include "Monitoring.h"
+
+/**
+ * Tags the events with the dependencies between hosts.
+ *
+ * The dependencies are loaded from the host_dependencies table and
+ * the host group membership. A problem of a host is tagged as
+ * EVENT_CORRELATION_SYMPTOM when one of the hosts on which it depends
+ * has a problem, or recovered from it within the window. Its recovery
+ * is tagged in the same way. A problem of a host on which other hosts
+ * depend is tagged as EVENT_CORRELATION_ROOT_CAUSE.
+ *
+ * The states of the hosts are updated with each event, so tagging
+ * an event costs only the number of the dependencies of its host.
+ */
+class EventCorrelator {
+public:
+	/**
+	 * Constructor.
+	 *
+	 * @param window
+	 * The time in seconds in which a problem of a host is regarded as
+	 * the cause after it recovered.
+	 */
+	EventCorrelator(const size_t &window);
+	virtual ~EventCorrelator();
+
+	/**
+	 * Set the correlation of events.
+	 *
+	 * @param eventList Events received from the monitoring servers.
+	 */
+	void correlate(EventInfoList &eventList);
+
+	/**
+	 * Let all instances reload the dependencies before they tag
+	 * the next events. It is called when the host_dependencies table or
+	 * the host group membership is changed.
+	 */
+	static void invalidateDependencies(void);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // EventCorrelator_h
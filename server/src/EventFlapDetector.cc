@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <deque>
+#include <inttypes.h>
+#include <Mutex.h>
+#include <Logger.h>
+#include <SmartBuffer.h>
+#include "EventFlapDetector.h"
+#include "HatoholException.h"
+#include "MonitoringDataCodec.h"
+using namespace std;
+using namespace mlpl;
+
+static const char *STATE_FILE_NAME = "event-flap-state";
+
+struct TriggerFlapState {
+	TriggerStatusType lastStatus;
+	deque<time_t>     changeTimes;
+	bool              flapping;
+
+	// The status last passed to the actions.
+	TriggerStatusType dispatchedStatus;
+
+	// The original event that was stored as the flapping event,
+	// or the last one dropped while the trigger is flapping.
+	EventInfo         lastEvent;
+	bool              hasDroppedEvent;
+
+	TriggerFlapState(const TriggerStatusType &status)
+	: lastStatus(status),
+	  flapping(false),
+	  dispatchedStatus(status),
+	  hasDroppedEvent(false)
+	{
+	}
+
+	void expire(const time_t &now, const size_t &window)
+	{
+		while (!changeTimes.empty() &&
+		       changeTimes.front() + (time_t)window <= now)
+			changeTimes.pop_front();
+	}
+};
+
+// The latest time of the events from a server and the local time when
+// the event arrived.
+struct ServerClock {
+	time_t eventTime;
+	time_t receivedTime;
+
+	time_t estimate(const time_t &now) const
+	{
+		if (now <= receivedTime)
+			return eventTime;
+		return eventTime + (now - receivedTime);
+	}
+};
+
+typedef pair<ServerIdType, TriggerIdType>  TriggerKey;
+typedef map<TriggerKey, TriggerFlapState>  TriggerFlapStateMap;
+typedef TriggerFlapStateMap::iterator      TriggerFlapStateMapIterator;
+typedef map<ServerIdType, ServerClock>     ServerClockMap;
+typedef ServerClockMap::iterator           ServerClockMapIterator;
+typedef ServerClockMap::const_iterator     ServerClockMapConstIterator;
+
+// ---------------------------------------------------------------------------
+// State file
+// ---------------------------------------------------------------------------
+// Each record of the state file is a 32-bit length of the body followed by
+// the body that has the state of a flapping trigger.
+static bool writeRecord(FILE *fp, const TriggerFlapState &state)
+{
+	SmartBuffer buf;
+	buf.addEx32(0); // The length is set at last.
+	MonitoringDataCodec::encode(buf, state.lastEvent);
+	buf.addEx32(state.lastStatus);
+	buf.addEx32(state.dispatchedStatus);
+	buf.addEx32(state.hasDroppedEvent);
+	buf.addEx32(state.changeTimes.size());
+	for (size_t i = 0; i < state.changeTimes.size(); i++)
+		buf.addEx64(state.changeTimes[i]);
+	const size_t size = buf.index();
+	buf.setAt(0, size - sizeof(uint32_t));
+	return fwrite(static_cast<char *>(buf), size, 1, fp) == 1;
+}
+
+static bool readRecord(FILE *fp, TriggerFlapState &state)
+{
+	uint32_t length;
+	if (fread(&length, sizeof(length), 1, fp) != 1 || length == 0)
+		return false;
+	SmartBuffer buf(length);
+	if (fread(static_cast<char *>(buf), length, 1, fp) != 1)
+		return false;
+	if (!MonitoringDataCodec::decode(buf, state.lastEvent))
+		return false;
+	if (buf.remainingSize() < sizeof(uint32_t) * 4)
+		return false;
+	state.lastStatus = static_cast<TriggerStatusType>(
+	  buf.getValueAndIncIndex<uint32_t>());
+	state.dispatchedStatus = static_cast<TriggerStatusType>(
+	  buf.getValueAndIncIndex<uint32_t>());
+	state.hasDroppedEvent = buf.getValueAndIncIndex<uint32_t>();
+	const uint32_t numChangeTimes = buf.getValueAndIncIndex<uint32_t>();
+	if (buf.remainingSize() < sizeof(uint64_t) * numChangeTimes)
+		return false;
+	for (uint32_t i = 0; i < numChangeTimes; i++)
+		state.changeTimes.push_back(buf.getValueAndIncIndex<uint64_t>());
+	state.flapping = true;
+	return true;
+}
+
+// ---------------------------------------------------------------------------
+// Private context
+// ---------------------------------------------------------------------------
+struct EventFlapDetector::Impl
+{
+	const size_t        window;
+	const size_t        startThreshold;
+	const size_t        stopThreshold;
+	const string        statePath;
+	mutable Mutex       mutex;
+	TriggerFlapStateMap stateMap;
+	ServerClockMap      serverClockMap;
+	size_t              numFlappingTriggers;
+	bool                flappingStateChanged;
+
+	Impl(const size_t &_window, const size_t &_startThreshold,
+	     const size_t &_stopThreshold, const string &stateDirectory)
+	: window(_window),
+	  startThreshold(_startThreshold),
+	  stopThreshold(_stopThreshold),
+	  statePath(stateDirectory.empty() ? "" :
+	            stateDirectory + "/" + STATE_FILE_NAME),
+	  numFlappingTriggers(0),
+	  flappingStateChanged(false)
+	{
+		HATOHOL_ASSERT(
+		  !window || stopThreshold < startThreshold,
+		  "stopThreshold: %zd, startThreshold: %zd",
+		  stopThreshold, startThreshold);
+	}
+
+	void updateServerClock(const EventInfo &eventInfo, const time_t &now)
+	{
+		ServerClockMapIterator it =
+		  serverClockMap.find(eventInfo.serverId);
+		if (it == serverClockMap.end()) {
+			ServerClock &clock = serverClockMap[eventInfo.serverId];
+			clock.eventTime = eventInfo.time.tv_sec;
+			clock.receivedTime = now;
+			return;
+		}
+		ServerClock &clock = it->second;
+		if (eventInfo.time.tv_sec >= clock.eventTime) {
+			clock.eventTime = eventInfo.time.tv_sec;
+			clock.receivedTime = now;
+		}
+	}
+
+	// Take over the flapping triggers saved before the restart.
+	void loadState(void)
+	{
+		if (statePath.empty())
+			return;
+		FILE *fp = fopen(statePath.c_str(), "rb");
+		if (!fp)
+			return;
+		const time_t now = time(NULL);
+		while (true) {
+			TriggerFlapState state(TRIGGER_STATUS_UNKNOWN);
+			if (!readRecord(fp, state))
+				break;
+			const EventInfo &lastEvent = state.lastEvent;
+			const TriggerKey key(lastEvent.serverId,
+			                     lastEvent.triggerId);
+			if (!stateMap.insert(make_pair(key, state)).second)
+				continue;
+			numFlappingTriggers++;
+			updateServerClock(lastEvent, now);
+		}
+		fclose(fp);
+		if (numFlappingTriggers > 0) {
+			MLPL_INFO("Found %zd flapping triggers: %s\n",
+			          numFlappingTriggers, statePath.c_str());
+		}
+	}
+
+	void saveStateIfChanged(void)
+	{
+		if (statePath.empty() || !flappingStateChanged)
+			return;
+		flappingStateChanged = false;
+		if (numFlappingTriggers == 0) {
+			remove(statePath.c_str());
+			return;
+		}
+
+		// The file is replaced at once not to leave a broken one.
+		const string tmpPath = statePath + ".tmp";
+		FILE *fp = fopen(tmpPath.c_str(), "wb");
+		if (!fp) {
+			MLPL_ERR("Failed to open %s: %s\n",
+			         tmpPath.c_str(), strerror(errno));
+			return;
+		}
+		bool succeeded = true;
+		TriggerFlapStateMapIterator it = stateMap.begin();
+		for (; it != stateMap.end() && succeeded; ++it) {
+			if (it->second.flapping)
+				succeeded = writeRecord(fp, it->second);
+		}
+		if (fclose(fp) != 0)
+			succeeded = false;
+		if (succeeded &&
+		    rename(tmpPath.c_str(), statePath.c_str()) != 0)
+			succeeded = false;
+		if (!succeeded) {
+			MLPL_ERR("Failed to write %s: %s\n",
+			         statePath.c_str(), strerror(errno));
+			remove(tmpPath.c_str());
+		}
+	}
+
+	void dispatch(EventInfoList &storedEventList,
+	              EventInfoList &dispatchedEventList,
+	              TriggerFlapState &state, const EventInfo &eventInfo)
+	{
+		storedEventList.push_back(eventInfo);
+		dispatchedEventList.push_back(eventInfo);
+		state.dispatchedStatus = eventInfo.status;
+	}
+
+	void process(EventInfoList &storedEventList,
+	             EventInfoList &dispatchedEventList,
+	             const EventInfo &eventInfo)
+	{
+		const TriggerKey key(eventInfo.serverId, eventInfo.triggerId);
+		TriggerFlapStateMapIterator it = stateMap.find(key);
+		if (it == stateMap.end()) {
+			it = stateMap.insert(make_pair(
+			  key, TriggerFlapState(eventInfo.status))).first;
+		}
+		TriggerFlapState &state = it->second;
+
+		const time_t now = eventInfo.time.tv_sec;
+		if (eventInfo.status != state.lastStatus) {
+			state.changeTimes.push_back(now);
+			state.lastStatus = eventInfo.status;
+		}
+		state.expire(now, window);
+
+		if (state.flapping) {
+			// The state file is rewritten by the next settle().
+			state.lastEvent = eventInfo;
+			state.hasDroppedEvent = true;
+			flappingStateChanged = true;
+			return;
+		}
+		if (state.changeTimes.size() < startThreshold) {
+			dispatch(storedEventList, dispatchedEventList,
+			         state, eventInfo);
+			return;
+		}
+
+		state.flapping = true;
+		state.lastEvent = eventInfo;
+		state.hasDroppedEvent = false;
+		numFlappingTriggers++;
+		flappingStateChanged = true;
+		EventInfo flappingEvent = eventInfo;
+		flappingEvent.type = EVENT_TYPE_FLAPPING;
+		storedEventList.push_back(flappingEvent);
+		MLPL_INFO("Trigger %" FMT_TRIGGER_ID " of server %"
+		          FMT_SERVER_ID " is flapping.\n",
+		          eventInfo.triggerId, eventInfo.serverId);
+	}
+
+	void settle(EventInfoList &storedEventList,
+	            EventInfoList &dispatchedEventList, const time_t &now)
+	{
+		TriggerFlapStateMapIterator it = stateMap.begin();
+		while (it != stateMap.end()) {
+			TriggerFlapState &state = it->second;
+			ServerClockMapConstIterator clockIt =
+			  serverClockMap.find(it->first.first);
+			if (clockIt == serverClockMap.end()) {
+				++it;
+				continue;
+			}
+			state.expire(clockIt->second.estimate(now), window);
+			if (!state.flapping) {
+				// Forget the trigger that has not changed in the
+				// window not to keep every trigger here.
+				if (state.changeTimes.empty())
+					stateMap.erase(it++);
+				else
+					++it;
+				continue;
+			}
+			if (state.changeTimes.size() > stopThreshold) {
+				++it;
+				continue;
+			}
+
+			numFlappingTriggers--;
+			flappingStateChanged = true;
+			const EventInfo &lastEvent = state.lastEvent;
+			// The flapping event with the same ID has already
+			// been stored when no event was dropped.
+			if (state.hasDroppedEvent)
+				storedEventList.push_back(lastEvent);
+			if (lastEvent.status != state.dispatchedStatus)
+				dispatchedEventList.push_back(lastEvent);
+			MLPL_INFO("Trigger %" FMT_TRIGGER_ID " of server %"
+			          FMT_SERVER_ID " stopped flapping.\n",
+			          it->first.second, it->first.first);
+			// The next event starts a new history of the trigger.
+			stateMap.erase(it++);
+		}
+	}
+};
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+EventFlapDetector::EventFlapDetector(const size_t &window,
+                                     const size_t &startThreshold,
+                                     const size_t &stopThreshold,
+                                     const string &stateDirectory)
+: m_impl(new Impl(window, startThreshold, stopThreshold, stateDirectory))
+{
+	if (isEnabled())
+		m_impl->loadState();
+}
+
+EventFlapDetector::~EventFlapDetector()
+{
+	if (isEnabled())
+		m_impl->saveStateIfChanged();
+}
+
+bool EventFlapDetector::isEnabled(void) const
+{
+	return m_impl->window > 0;
+}
+
+void EventFlapDetector::filter(EventInfoList &storedEventList,
+                               EventInfoList &dispatchedEventList,
+                               const EventInfoList &eventList)
+{
+	if (!isEnabled()) {
+		storedEventList.insert(storedEventList.end(),
+		                       eventList.begin(), eventList.end());
+		dispatchedEventList.insert(dispatchedEventList.end(),
+		                           eventList.begin(), eventList.end());
+		return;
+	}
+
+	const time_t now = time(NULL);
+	AutoMutex autoLock(&m_impl->mutex);
+	EventInfoListConstIterator it = eventList.begin();
+	for (; it != eventList.end(); ++it) {
+		const EventInfo &eventInfo = *it;
+		if (eventInfo.id == DISCONNECT_SERVER_EVENT_ID) {
+			storedEventList.push_back(eventInfo);
+			dispatchedEventList.push_back(eventInfo);
+			continue;
+		}
+		m_impl->process(storedEventList, dispatchedEventList,
+		                eventInfo);
+		m_impl->updateServerClock(eventInfo, now);
+	}
+	if (m_impl->numFlappingTriggers > 0) {
+		m_impl->settle(storedEventList, dispatchedEventList, now);
+	}
+}
+
+void EventFlapDetector::settle(EventInfoList &storedEventList,
+                               EventInfoList &dispatchedEventList,
+                               const time_t &now)
+{
+	if (!isEnabled())
+		return;
+	AutoMutex autoLock(&m_impl->mutex);
+	m_impl->settle(storedEventList, dispatchedEventList, now);
+	m_impl->saveStateIfChanged();
+}
+
+size_t EventFlapDetector::getNumberOfFlappingTriggers(void) const
+{
+	AutoMutex autoLock(&m_impl->mutex);
+	return m_impl->numFlappingTriggers;
+}
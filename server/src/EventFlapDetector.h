@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EventFlapDetector_h
+#define EventFlapDetector_h
+
+#include <string>
+#include <memory>
+#include <ctime>
+#include "Params.h"
+#include "Monitoring.h"
+
+/**
+ * Detects triggers whose state changes too often and collapses their
+ * events.
+ *
+ * The state changes of each trigger are counted in a sliding window
+ * over the event times. When the count reaches the start threshold,
+ * the trigger is regarded as flapping: the event is stored as an event
+ * of EVENT_TYPE_FLAPPING and the following events of the trigger are
+ * dropped. When the count falls to the stop threshold, the last dropped
+ * event is given as the settled state of the trigger.
+ *
+ * The states of the flapping triggers are saved in a file, so that the
+ * dropped events are given when the triggers settle even after a restart.
+ */
+class EventFlapDetector {
+public:
+	/**
+	 * Constructor.
+	 *
+	 * @param window
+	 * The length of the sliding window in seconds. If it is 0,
+	 * the detection is disabled.
+	 * @param startThreshold
+	 * The number of the state changes in the window with which
+	 * a trigger starts flapping.
+	 * @param stopThreshold
+	 * The number of the state changes in the window with which
+	 * a trigger stops flapping. It must be less than startThreshold.
+	 * @param stateDirectory
+	 * The directory where the state file is created. If it is empty,
+	 * the states aren't saved.
+	 */
+	EventFlapDetector(const size_t &window,
+	                  const size_t &startThreshold,
+	                  const size_t &stopThreshold,
+	                  const std::string &stateDirectory = "");
+	virtual ~EventFlapDetector();
+
+	bool isEnabled(void) const;
+
+	/**
+	 * Filter events.
+	 *
+	 * The clock of a server is the latest time of the events from it
+	 * plus the time elapsed since it arrived. The flapping triggers whose
+	 * windows have quieted are settled here and in settle().
+	 *
+	 * @param storedEventList
+	 * The events to be stored in the DB are appended.
+	 * @param dispatchedEventList
+	 * The events to be passed to the actions are appended. The flapping
+	 * events are not included.
+	 * @param eventList Events received from the monitoring servers.
+	 */
+	void filter(EventInfoList &storedEventList,
+	            EventInfoList &dispatchedEventList,
+	            const EventInfoList &eventList);
+
+	/**
+	 * Settle the flapping triggers whose windows have quieted. This
+	 * should be called periodically, because no event of the server
+	 * may arrive after a trigger stops changing. The state file is
+	 * written here and on destruction, not in filter().
+	 *
+	 * @param storedEventList
+	 * The last dropped events to be stored in the DB are appended.
+	 * @param dispatchedEventList
+	 * The events to be passed to the actions are appended.
+	 * @param now The current time.
+	 */
+	void settle(EventInfoList &storedEventList,
+	            EventInfoList &dispatchedEventList,
+	            const time_t &now = time(NULL));
+
+	size_t getNumberOfFlappingTriggers(void) const;
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // EventFlapDetector_h
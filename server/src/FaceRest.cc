@@ -44,9 +44,12 @@
 #include "RestResourceAction.h"
 #include "RestResourceHost.h"
 #include "RestResourceIncidentTracker.h"
+#include "RestResourceLogLevel.h"
 #include "RestResourceServer.h"
 #include "RestResourceUser.h"
 #include "ConfigManager.h"
+#include "MetricsRegistry.h"
+#include "HostInfoCache.h"
 
 using namespace std;
 using namespace mlpl;
@@ -60,6 +63,7 @@ static const guint DEFAULT_PORT = 33194;
 const char *FaceRest::pathForTest   = "/test";
 const char *FaceRest::pathForLogin  = "/login";
 const char *FaceRest::pathForLogout = "/logout";
+const char *FaceRest::pathForMetrics = "/metrics";
 
 static const char *MIME_HTML = "text/html";
 static const char *MIME_JSON = "application/json";
@@ -98,6 +102,7 @@ struct FaceRest::Impl {
 	queue<ResourceHandler *> restJobQueue;
 	Mutex            restJobLock;
 	sem_t            waitJobSemaphore;
+	MetricGauge     &restJobQueueLength;
 
 	Impl(FaceRestParam *_param)
 	: port(DEFAULT_PORT),
@@ -106,7 +111,10 @@ struct FaceRest::Impl {
 	  param(_param),
 	  quitRequest(false),
 	  asyncMode(true),
-	  numPreLoadWorkers(DEFAULT_NUM_WORKERS)
+	  numPreLoadWorkers(DEFAULT_NUM_WORKERS),
+	  restJobQueueLength(MetricsRegistry::getInstance()->getGauge(
+	    "hatohol_rest_job_queue_length",
+	    "The number of REST requests waiting for a worker"))
 	{
 		gMainCtx = g_main_context_new();
 		sem_init(&waitJobSemaphore, 0, 0);
@@ -122,6 +130,7 @@ struct FaceRest::Impl {
 	{
 		restJobLock.lock();
 		restJobQueue.push(job);
+		restJobQueueLength.add();
 		if (sem_post(&waitJobSemaphore) == -1)
 			MLPL_ERR("Failed to call sem_post: %d\n",
 				 errno);
@@ -142,6 +151,7 @@ struct FaceRest::Impl {
 		if (!restJobQueue.empty()) {
 			job = restJobQueue.front();
 			restJobQueue.pop();
+			restJobQueueLength.sub();
 		}
 		restJobLock.unlock();
 		return job;
@@ -375,11 +385,14 @@ gpointer FaceRest::mainThread(HatoholThreadArg *arg)
 			  new ResourceHandlerFactory(this, handlerLogin));
 	m_impl->addHandler(pathForLogout,
 			  new ResourceHandlerFactory(this, handlerLogout));
+	m_impl->addHandler(pathForMetrics,
+			  new ResourceHandlerFactory(this, handlerMetrics));
 	RestResourceUser::registerFactories(this);
 	RestResourceServer::registerFactories(this);
 	RestResourceHost::registerFactories(this);
 	RestResourceAction::registerFactories(this);
 	RestResourceIncidentTracker::registerFactories(this);
+	RestResourceLogLevel::registerFactories(this);
 
 	if (m_impl->param)
 		m_impl->param->setupDoneNotifyFunc();
@@ -591,6 +604,19 @@ void FaceRest::handlerLogout(ResourceHandler *job)
 	job->replyJSONData(agent);
 }
 
+void FaceRest::handlerMetrics(ResourceHandler *job)
+{
+	string response;
+	MetricsRegistry::getInstance()->writePrometheusText(response);
+	soup_message_headers_set_content_type(
+	  job->m_message->response_headers,
+	  MetricsRegistry::PROMETHEUS_TEXT_MIME_TYPE, NULL);
+	soup_message_body_append(job->m_message->response_body,
+				 SOUP_MEMORY_COPY,
+	                         response.c_str(), response.size());
+	soup_message_set_status(job->m_message, SOUP_STATUS_OK);
+	job->m_replyIsPrepared = true;
+}
 
 // ---------------------------------------------------------------------------
 // FaceRest::ResourceHandler
@@ -637,6 +663,12 @@ void FaceRest::ResourceHandler::handle(void)
 
 void FaceRest::ResourceHandler::handleInTryBlock(void)
 {
+	static MetricHistogram &requestDuration =
+	  MetricsRegistry::getInstance()->getHistogram(
+	    "hatohol_rest_request_duration_seconds",
+	    "Time to handle a REST request",
+	    MetricsRegistry::UNIT_MICRO_SEC);
+	MetricTimer timer(requestDuration);
 	try {
 		handle();
 	} catch (const HatoholException &e) {
@@ -703,7 +735,9 @@ bool FaceRest::ResourceHandler::parseRequest(void)
 
 	bool notFoundSessionId = true;
 	if (m_sessionId.empty()) {
-		if (m_path == pathForLogin ||
+		// The metrics are read by collectors such as Prometheus
+		// that don't have a session.
+		if (m_path == pathForLogin || m_path == pathForMetrics ||
 		    Impl::isTestPath(m_path)) {
 			m_userId = INVALID_USER_ID;
 			notFoundSessionId = false;
@@ -926,8 +960,16 @@ static void addHostsMap(
 	// Event page. We should save host name in Event table.
 	option.setValidity(HOST_ANY_VALIDITY);
 
-	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
-	dataStore->getHostList(hostList, option);
+	// HostInfoCache has all hosts including deleted ones. It can be
+	// used unless the hosts have to be filtered.
+	if (targetHostgroupId == ALL_HOST_GROUPS &&
+	    option.has(OPPRVLG_GET_ALL_SERVER)) {
+		HostInfoCache::getInstance(serverInfo.id).getHostInfoList(
+		  hostList);
+	} else {
+		UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
+		dataStore->getHostList(hostList, option);
+	}
 	HostInfoListIterator it = hostList.begin();
 	agent.startObject("hosts");
 	for (; it != hostList.end(); ++it) {
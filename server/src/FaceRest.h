@@ -81,6 +81,7 @@ protected:
 	static void handlerTest(ResourceHandler *job);
 	static void handlerLogin(ResourceHandler *job);
 	static void handlerLogout(ResourceHandler *job);
+	static void handlerMetrics(ResourceHandler *job);
 
 private:
 	struct Impl;
@@ -89,6 +90,7 @@ private:
 	static const char *pathForTest;
 	static const char *pathForLogin;
 	static const char *pathForLogout;
+	static const char *pathForMetrics;
 };
 
 #endif // FaceRest_h
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <ctime>
+#include <deque>
+#include <string>
+#include <pthread.h>
+#include <Logger.h>
+#include "GroupCommitWriter.h"
+#include "HatoholException.h"
+#include "MetricsRegistry.h"
+using namespace std;
+using namespace mlpl;
+
+const size_t GroupCommitWriter::MAX_REQUESTS_PER_COMMIT = 256;
+
+struct GroupCommitRequest {
+	const TriggerInfoList &triggerList;
+	const EventInfoList   &eventList;
+	const ItemInfoList    &itemList;
+	bool                   done;
+	bool                   failed;
+	string                 errorMessage;
+
+	GroupCommitRequest(const TriggerInfoList &_triggerList,
+	                   const EventInfoList &_eventList,
+	                   const ItemInfoList &_itemList)
+	: triggerList(_triggerList),
+	  eventList(_eventList),
+	  itemList(_itemList),
+	  done(false),
+	  failed(false)
+	{
+	}
+};
+
+typedef deque<GroupCommitRequest *> GroupCommitRequestQueue;
+
+template <typename LIST>
+static void appendList(LIST &dest, const LIST &src)
+{
+	dest.insert(dest.end(), src.begin(), src.end());
+}
+
+static timespec getDeadline(const size_t &delayMSec)
+{
+	timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	const uint64_t nsec = ts.tv_nsec + (uint64_t)delayMSec * 1000 * 1000;
+	ts.tv_sec += nsec / (1000 * 1000 * 1000);
+	ts.tv_nsec = nsec % (1000 * 1000 * 1000);
+	return ts;
+}
+
+// ---------------------------------------------------------------------------
+// Private context
+// ---------------------------------------------------------------------------
+struct GroupCommitWriter::Impl
+{
+	GroupCommitWriter &writer;
+	const size_t       delayMSec;
+	Committer         &committer;
+
+	// The followings are protected by 'mutex'.
+	pthread_mutex_t         mutex;
+	pthread_cond_t          requestedCond;
+	pthread_cond_t          committedCond;
+	GroupCommitRequestQueue requestQueue;
+
+	MetricHistogram   &requestsPerCommit;
+	MetricHistogram   &waitDuration;
+
+	Impl(GroupCommitWriter &_writer, const size_t &_delayMSec,
+	     Committer &_committer)
+	: writer(_writer),
+	  delayMSec(_delayMSec),
+	  committer(_committer),
+	  requestsPerCommit(MetricsRegistry::getInstance()->getHistogram(
+	    "hatohol_group_commit_requests",
+	    "The number of the write requests stored in one transaction")),
+	  waitDuration(MetricsRegistry::getInstance()->getHistogram(
+	    "hatohol_group_commit_wait_seconds",
+	    "The time from the write request to the commit",
+	    MetricsRegistry::UNIT_MICRO_SEC))
+	{
+		pthread_mutex_init(&mutex, NULL);
+		pthread_cond_init(&requestedCond, NULL);
+		pthread_cond_init(&committedCond, NULL);
+	}
+
+	virtual ~Impl()
+	{
+		pthread_cond_destroy(&committedCond);
+		pthread_cond_destroy(&requestedCond);
+		pthread_mutex_destroy(&mutex);
+	}
+
+	// Returns false when the exit is requested and no request is left.
+	bool waitForRequests(GroupCommitRequestQueue &batch)
+	{
+		pthread_mutex_lock(&mutex);
+		while (requestQueue.empty() && !writer.isExitRequested())
+			pthread_cond_wait(&requestedCond, &mutex);
+
+		const timespec deadline = getDeadline(delayMSec);
+		while (requestQueue.size() < MAX_REQUESTS_PER_COMMIT &&
+		       !writer.isExitRequested()) {
+			const int ret = pthread_cond_timedwait(
+			  &requestedCond, &mutex, &deadline);
+			if (ret == ETIMEDOUT)
+				break;
+		}
+
+		while (!requestQueue.empty() &&
+		       batch.size() < MAX_REQUESTS_PER_COMMIT) {
+			batch.push_back(requestQueue.front());
+			requestQueue.pop_front();
+		}
+		pthread_mutex_unlock(&mutex);
+		return !batch.empty();
+	}
+
+	void commit(const GroupCommitRequestQueue &batch)
+	{
+		TriggerInfoList triggerList;
+		EventInfoList   eventList;
+		ItemInfoList    itemList;
+		GroupCommitRequestQueue::const_iterator it = batch.begin();
+		for (; it != batch.end(); ++it) {
+			appendList(triggerList, (*it)->triggerList);
+			appendList(eventList, (*it)->eventList);
+			appendList(itemList, (*it)->itemList);
+		}
+
+		try {
+			committer.commit(triggerList, eventList, itemList);
+			requestsPerCommit.observe(batch.size());
+			return;
+		} catch (const exception &e) {
+			if (batch.size() == 1) {
+				batch.front()->failed = true;
+				batch.front()->errorMessage = e.what();
+				return;
+			}
+			MLPL_ERR("Failed to commit %zd requests at once: %s\n",
+			         batch.size(), e.what());
+		}
+
+		// Commit them one by one so that a bad request doesn't make
+		// the others fail.
+		for (it = batch.begin(); it != batch.end(); ++it) {
+			GroupCommitRequest *request = *it;
+			try {
+				committer.commit(request->triggerList,
+				                 request->eventList,
+				                 request->itemList);
+				requestsPerCommit.observe(1);
+			} catch (const exception &e) {
+				request->failed = true;
+				request->errorMessage = e.what();
+			}
+		}
+	}
+
+	void notifyCommitted(const GroupCommitRequestQueue &batch)
+	{
+		pthread_mutex_lock(&mutex);
+		GroupCommitRequestQueue::const_iterator it = batch.begin();
+		for (; it != batch.end(); ++it)
+			(*it)->done = true;
+		pthread_cond_broadcast(&committedCond);
+		pthread_mutex_unlock(&mutex);
+	}
+};
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+GroupCommitWriter::Committer::~Committer()
+{
+}
+
+GroupCommitWriter::GroupCommitWriter(const size_t &delayMSec,
+                                     Committer &committer)
+: m_impl(new Impl(*this, delayMSec, committer))
+{
+}
+
+GroupCommitWriter::~GroupCommitWriter()
+{
+	exitSync();
+}
+
+void GroupCommitWriter::write(const TriggerInfoList &triggerList,
+                              const EventInfoList &eventList,
+                              const ItemInfoList &itemList)
+{
+	MetricTimer timer(m_impl->waitDuration);
+	GroupCommitRequest request(triggerList, eventList, itemList);
+
+	pthread_mutex_lock(&m_impl->mutex);
+	if (!isStarted() || isExitRequested()) {
+		pthread_mutex_unlock(&m_impl->mutex);
+		m_impl->committer.commit(triggerList, eventList, itemList);
+		return;
+	}
+	m_impl->requestQueue.push_back(&request);
+	if (m_impl->requestQueue.size() == 1 ||
+	    m_impl->requestQueue.size() >= MAX_REQUESTS_PER_COMMIT)
+		pthread_cond_signal(&m_impl->requestedCond);
+	while (!request.done)
+		pthread_cond_wait(&m_impl->committedCond, &m_impl->mutex);
+	pthread_mutex_unlock(&m_impl->mutex);
+
+	if (request.failed) {
+		THROW_HATOHOL_EXCEPTION("Failed to commit: %s",
+		                        request.errorMessage.c_str());
+	}
+}
+
+void GroupCommitWriter::waitExit(void)
+{
+	// The requests in the queue are committed before the thread exits.
+	pthread_mutex_lock(&m_impl->mutex);
+	pthread_cond_broadcast(&m_impl->requestedCond);
+	pthread_mutex_unlock(&m_impl->mutex);
+	HatoholThreadBase::waitExit();
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+gpointer GroupCommitWriter::mainThread(HatoholThreadArg *arg)
+{
+	MLPL_INFO("Start GroupCommitWriter thread: delay: %zd ms\n",
+	          m_impl->delayMSec);
+	while (true) {
+		GroupCommitRequestQueue batch;
+		if (!m_impl->waitForRequests(batch))
+			break;
+		m_impl->commit(batch);
+		m_impl->notifyCommitted(batch);
+	}
+	MLPL_INFO("Exited GroupCommitWriter thread\n");
+	return NULL;
+}
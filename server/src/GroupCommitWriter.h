@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GroupCommitWriter_h
+#define GroupCommitWriter_h
+
+#include <memory>
+#include "Monitoring.h"
+#include "HatoholThreadBase.h"
+
+/**
+ * Merges the monitoring data written by many threads at about the same
+ * time, so that they are stored in one transaction.
+ *
+ * The thread of this class waits for the delay after the first request
+ * arrives and passes the data of all requests received in the meantime
+ * to the Committer at once. Each writer waits until its data are
+ * committed. A longer delay means fewer transactions and a longer wait.
+ */
+class GroupCommitWriter : public HatoholThreadBase {
+public:
+	/**
+	 * Stores the data in the thread of the writer. An exception thrown
+	 * from the method means the data aren't stored.
+	 */
+	class Committer {
+	public:
+		virtual ~Committer();
+		virtual void commit(const TriggerInfoList &triggerList,
+		                    const EventInfoList &eventList,
+		                    const ItemInfoList &itemList) = 0;
+	};
+
+	static const size_t MAX_REQUESTS_PER_COMMIT;
+
+	/**
+	 * Constructor.
+	 *
+	 * @param delayMSec
+	 * The time in milliseconds to wait for the other requests.
+	 * @param committer The committer of the data.
+	 */
+	GroupCommitWriter(const size_t &delayMSec, Committer &committer);
+	virtual ~GroupCommitWriter();
+
+	/**
+	 * Write data and wait until they are committed. If the thread
+	 * isn't running, they are committed in the thread of the caller.
+	 * Any of the lists may be empty.
+	 *
+	 * An exception is thrown if the data aren't stored.
+	 */
+	void write(const TriggerInfoList &triggerList,
+	           const EventInfoList &eventList,
+	           const ItemInfoList &itemList);
+
+	virtual void waitExit(void) override;
+
+protected:
+	virtual gpointer mainThread(HatoholThreadArg *arg) override;
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // GroupCommitWriter_h
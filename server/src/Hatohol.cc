@@ -40,6 +40,9 @@ using namespace mlpl;
 #include "UnifiedDataStore.h"
 #include "ChildProcessManager.h"
 #include "DBTablesHost.h"
+#include "HostInfoCache.h"
+#include "TextSearchIndex.h"
+#include "TriggerStateSnapshot.h"
 
 static Mutex mutex;
 static bool initDone = false; 
@@ -75,6 +78,9 @@ static void reset(const CommandLineOptions *cmdLineOpts,
 	DBTablesAction::reset();
 	DBTablesHost::reset();
 	DBTablesMonitoring::reset();
+	HostInfoCache::reset();
+	TextSearchIndex::reset();
+	TriggerStateSnapshot::reset();
 
 	ActionManager::reset();
 	ThreadLocalDBCache::reset();
@@ -31,6 +31,8 @@
 #include <Reaper.h>
 #include <SimpleSemaphore.h>
 #include "NamedPipe.h"
+#include "HapiLocalChannel.h"
+#include "ConfigManager.h"
 #include "UnifiedDataStore.h"
 #include "HatoholArmPluginGate.h"
 #include "ThreadLocalDBCache.h"
@@ -80,7 +82,6 @@ struct HatoholArmPluginGate::Impl
 	ArmStatus            armStatus;
 	AtomicValue<GPid>    pid;
 	SimpleSemaphore      pluginTermSem;
-	HostInfoCache        hostInfoCache;
 	Mutex                exitSyncLock;
 	bool                 exitSyncDone;
 	bool                 createdSelfTriggers;
@@ -88,6 +89,10 @@ struct HatoholArmPluginGate::Impl
 	HAPIWtchPointInfo    hapiWtchPointInfo[NUM_COLLECT_NG_KIND];
 	NamedPipe            pipeRd, pipeWr;
 	bool                 allowSetGLibMainContext;
+	// Generations of the tables sent by HAPI_CMD_SEND_TABLE_DELTA.
+	// They are forgotten when the plugin is initiated.
+	Mutex                   tableGenerationsLock;
+	map<uint16_t, uint64_t> tableGenerations;
 
 	Impl(const MonitoringServerInfo &_serverInfo,
 	               HatoholArmPluginGate *_hapg)
@@ -154,6 +159,14 @@ HatoholArmPluginGate::HatoholArmPluginGate(
 		address = generateBrokerAddress(m_impl->serverInfo);
 	setQueueAddress(address);
 
+	// A passive plugin is launched by others. It may run on the other
+	// host. So only the plugins launched by us can use the local channel.
+	if (ConfigManager::getInstance()->isHapLocalChannelEnabled() &&
+	    m_impl->armPluginInfo.path != PassivePluginQuasiPath) {
+		setLocalChannelPath(
+		  generateLocalChannelPath(m_impl->serverInfo));
+	}
+
 	registerCommandHandler(
 	  HAPI_CMD_GET_MONITORING_SERVER_INFO,
 	  (CommandHandler)
@@ -174,6 +187,16 @@ HatoholArmPluginGate::HatoholArmPluginGate(
 	  (CommandHandler)
 	    &HatoholArmPluginGate::cmdHandlerGetTimeOfLastEvent);
 
+	registerCommandHandler(
+	  HAPI_CMD_GET_TIMES_OF_LAST_EVENTS,
+	  (CommandHandler)
+	    &HatoholArmPluginGate::cmdHandlerGetTimesOfLastEvents);
+
+	registerCommandHandler(
+	  HAPI_CMD_SEND_TABLE_DELTA,
+	  (CommandHandler)
+	    &HatoholArmPluginGate::cmdHandlerSendTableDelta);
+
 	registerCommandHandler(
 	  HAPI_CMD_SEND_UPDATED_TRIGGERS,
 	  (CommandHandler)
@@ -498,8 +521,7 @@ void HatoholArmPluginGate::setPluginAvailabelTrigger(const HatoholArmPluginWatch
 	HAPIWtchPointInfo &resTrigger = m_impl->hapiWtchPointInfo[type];
 	createPluginTriggerInfo(resTrigger, triggerInfoList);
 
-	ThreadLocalDBCache cache;
-	cache.getMonitoring().addTriggerInfoList(triggerInfoList);
+	UnifiedDataStore::getInstance()->addTriggerList(triggerInfoList);
 }
 
 void HatoholArmPluginGate::setPluginConnectStatus(const HatoholArmPluginWatchType &type,
@@ -561,14 +583,11 @@ void HatoholArmPluginGate::setPluginConnectStatus(const HatoholArmPluginWatchTyp
 		}
 	}
 
-	if (!triggerInfoList.empty()) {
-		ThreadLocalDBCache cache;
-		cache.getMonitoring().addTriggerInfoList(triggerInfoList);
-	}
-	if (!eventInfoList.empty()) {
-		UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
+	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
+	if (!triggerInfoList.empty())
+		dataStore->addTriggerList(triggerInfoList);
+	if (!eventInfoList.empty())
 		dataStore->addEventList(eventInfoList);
-	}
 }
 
 void HatoholArmPluginGate::onConnected(qpid::messaging::Connection &conn)
@@ -619,6 +638,7 @@ void HatoholArmPluginGate::onTerminated(const siginfo_t *siginfo)
 void HatoholArmPluginGate::onInitiated(void)
 {
 	HatoholArmPluginInterface::onInitiated();
+	resetTableGenerations();
 	setPluginConnectStatus(COLLECT_NG_PLGIN_CONNECT_ERROR,
 			      HAPERR_OK);
 }
@@ -727,6 +747,12 @@ bool HatoholArmPluginGate::launchPluginProcess(
 	arg.envs.push_back(StringUtils::sprintf(
 	  "%s=%s", ENV_NAME_QUEUE_ADDR,
 	           generateBrokerAddress(m_impl->serverInfo).c_str()));
+	const string localChannelPath = getLocalChannelPath();
+	if (!localChannelPath.empty()) {
+		arg.envs.push_back(StringUtils::sprintf(
+		  "%s=%s", HapiLocalChannel::ENV_NAME,
+		           localChannelPath.c_str()));
+	}
 	ChildProcessManager::getInstance()->create(arg);
 	if (!eventCb->succeededInCreation) {
 		MLPL_ERR("Failed to execute: (%d) %s\n",
@@ -747,6 +773,15 @@ string HatoholArmPluginGate::generateBrokerAddress(
 	                            serverInfo.id);
 }
 
+string HatoholArmPluginGate::generateLocalChannelPath(
+  const MonitoringServerInfo &serverInfo)
+{
+	const string name = StringUtils::sprintf(HAP_LOCAL_CHANNEL_NAME_FMT,
+	                                         serverInfo.id);
+	return StringUtils::sprintf("%s/%s", NamedPipe::BASE_DIR,
+	                            name.c_str());
+}
+
 void HatoholArmPluginGate::sendTerminateCommand(void)
 {
 	SmartBuffer cmdBuf;
@@ -816,9 +851,8 @@ void HatoholArmPluginGate::cmdHandlerGetLastEventId(
 	SmartBuffer resBuf;
 	HapiResLastEventId *body =
 	  setupResponseBuffer<HapiResLastEventId>(resBuf);
-	ThreadLocalDBCache cache;
-	DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
-	body->lastEventId = dbMonitoring.getLastEventId(m_impl->serverInfo.id);
+	body->lastEventId = UnifiedDataStore::getInstance()->getLastEventId(
+	  m_impl->serverInfo.id);
 	reply(resBuf);
 }
 
@@ -846,6 +880,48 @@ void HatoholArmPluginGate::cmdHandlerGetTimeOfLastEvent(
 	reply(resBuf);
 }
 
+void HatoholArmPluginGate::cmdHandlerGetTimesOfLastEvents(
+  const HapiCommandHeader *header)
+{
+	// Parse command paramters.
+	SmartBuffer *cmdBuf = getCurrBuffer();
+	HATOHOL_ASSERT(cmdBuf, "Current buffer: NULL");
+	HapiParamTimesOfLastEvents *param =
+	  getCommandBody<HapiParamTimesOfLastEvents>(*cmdBuf);
+	const size_t numTriggers = LtoN(param->numTriggers);
+	param = getCommandBody<HapiParamTimesOfLastEvents>(
+	          *cmdBuf, sizeof(uint64_t) * numTriggers);
+	const uint64_t *idArray = reinterpret_cast<uint64_t *>(param + 1);
+	vector<TriggerIdType> triggerIds;
+	triggerIds.reserve(numTriggers);
+	for (size_t i = 0; i < numTriggers; i++)
+		triggerIds.push_back(LtoN(idArray[i]));
+
+	ThreadLocalDBCache cache;
+	DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
+	vector<SmartTime> times;
+	dbMonitoring.getTimesOfLastEvents(m_impl->serverInfo.id,
+	                                  triggerIds, times);
+
+	// Make a response buffer.
+	SmartBuffer resBuf;
+	HapiResTimesOfLastEvents *body =
+	  setupResponseBuffer<HapiResTimesOfLastEvents>(
+	    resBuf, sizeof(HapiResTimeOfLastEvent) * numTriggers);
+	body->lastEventId = NtoL(
+	  UnifiedDataStore::getInstance()->getLastEventId(
+	    m_impl->serverInfo.id));
+	body->numTriggers = NtoL(numTriggers);
+	HapiResTimeOfLastEvent *timeArray =
+	  reinterpret_cast<HapiResTimeOfLastEvent *>(body + 1);
+	for (size_t i = 0; i < numTriggers; i++) {
+		const timespec &ts = times[i].getAsTimespec();
+		timeArray[i].sec  = NtoL((uint64_t)ts.tv_sec);
+		timeArray[i].nsec = NtoL((uint32_t)ts.tv_nsec);
+	}
+	reply(resBuf);
+}
+
 void HatoholArmPluginGate::cmdHandlerSendUpdatedTriggers(
   const HapiCommandHeader *header)
 {
@@ -857,11 +933,10 @@ void HatoholArmPluginGate::cmdHandlerSendUpdatedTriggers(
 
 	TriggerInfoList trigInfoList;
 	HatoholDBUtils::transformTriggersToHatoholFormat(
-	  trigInfoList, tablePtr, m_impl->serverInfo.id, m_impl->hostInfoCache);
+	  trigInfoList, tablePtr, m_impl->serverInfo.id,
+	  HostInfoCache::getInstance(m_impl->serverInfo.id));
 
-	ThreadLocalDBCache cache;
-	DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
-	dbMonitoring.addTriggerInfoList(trigInfoList);
+	UnifiedDataStore::getInstance()->addTriggerList(trigInfoList);
 
 	replyOk();
 }
@@ -883,11 +958,6 @@ void HatoholArmPluginGate::cmdHandlerSendHosts(
 	DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
 	dbMonitoring.updateHosts(hostInfoList, m_impl->serverInfo.id);
 
-	// TODO: consider if DBClientHatohol should have the cache
-	HostInfoListConstIterator hostInfoItr = hostInfoList.begin();
-	for (; hostInfoItr != hostInfoList.end(); ++hostInfoItr)
-		m_impl->hostInfoCache.update(*hostInfoItr);
-
 	replyOk();
 }
 
@@ -931,6 +1001,111 @@ void HatoholArmPluginGate::cmdHandlerSendHostgroups(
 	replyOk();
 }
 
+void HatoholArmPluginGate::cmdHandlerSendTableDelta(
+  const HapiCommandHeader *header)
+{
+	SmartBuffer *cmdBuf = getCurrBuffer();
+	HATOHOL_ASSERT(cmdBuf, "Current buffer: NULL");
+	const HapiParamTableDelta *param =
+	  getCommandBody<HapiParamTableDelta>(*cmdBuf);
+	const uint16_t tableCode = LtoN(param->tableCode);
+	const uint64_t baseGeneration = LtoN(param->baseGeneration);
+	const uint64_t generation = LtoN(param->generation);
+
+	cmdBuf->setIndex(sizeof(HapiCommandHeader) +
+	                 sizeof(HapiParamTableDelta));
+	ItemTablePtr addedTablePtr = createItemTable(*cmdBuf);
+	ItemTablePtr removedTablePtr = createItemTable(*cmdBuf);
+
+	const bool wholeTable = (baseGeneration == 0);
+	if (!wholeTable) {
+		AutoMutex autoMutex(&m_impl->tableGenerationsLock);
+		map<uint16_t, uint64_t>::iterator genIt =
+		  m_impl->tableGenerations.find(tableCode);
+		if (genIt == m_impl->tableGenerations.end() ||
+		    genIt->second != baseGeneration) {
+			MLPL_INFO("Generation mismatch: table: %" PRIu16 ", "
+			          "base: %" PRIu64 "\n",
+			          tableCode, baseGeneration);
+			replyError(HAPI_RES_ERR_GENERATION_MISMATCH);
+			return;
+		}
+	}
+
+	const ServerIdType &serverId = m_impl->serverInfo.id;
+	ThreadLocalDBCache cache;
+	DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
+	switch (tableCode) {
+	case HAPI_CMD_SEND_HOSTS:
+	{
+		HostInfoList hostInfoList;
+		HatoholDBUtils::transformHostsToHatoholFormat(
+		  hostInfoList, addedTablePtr, serverId);
+		if (wholeTable) {
+			dbMonitoring.updateHosts(hostInfoList, serverId);
+			break;
+		}
+		HostInfoList removedHostInfoList;
+		HatoholDBUtils::transformHostsToHatoholFormat(
+		  removedHostInfoList, removedTablePtr, serverId);
+		HostInfoListIterator it = removedHostInfoList.begin();
+		for (; it != removedHostInfoList.end(); ++it) {
+			it->validity = HOST_INVALID;
+			hostInfoList.push_back(*it);
+		}
+		dbMonitoring.addHostInfoList(hostInfoList);
+		break;
+	}
+	case HAPI_CMD_SEND_HOST_GROUP_ELEMENTS:
+	{
+		HostgroupElementList addedList, removedList;
+		HatoholDBUtils::transformHostsGroupsToHatoholFormat(
+		  addedList, addedTablePtr, serverId);
+		if (wholeTable) {
+			dbMonitoring.updateHostgroupElements(addedList,
+			                                     serverId);
+			break;
+		}
+		HatoholDBUtils::transformHostsGroupsToHatoholFormat(
+		  removedList, removedTablePtr, serverId);
+		dbMonitoring.deleteHostgroupElementList(removedList);
+		dbMonitoring.addHostgroupElementList(addedList);
+		break;
+	}
+	case HAPI_CMD_SEND_HOST_GROUPS:
+	{
+		HostgroupInfoList addedList, removedList;
+		HatoholDBUtils::transformGroupsToHatoholFormat(
+		  addedList, addedTablePtr, serverId);
+		if (wholeTable) {
+			dbMonitoring.updateHostgroups(addedList, serverId);
+			break;
+		}
+		HatoholDBUtils::transformGroupsToHatoholFormat(
+		  removedList, removedTablePtr, serverId);
+		dbMonitoring.deleteHostgroupInfoList(removedList);
+		dbMonitoring.addHostgroupInfoList(addedList);
+		break;
+	}
+	default:
+		MLPL_ERR("Unsupported table: %" PRIu16 "\n", tableCode);
+		replyError(HAPI_RES_INVALID_ARG);
+		return;
+	}
+
+	{
+		AutoMutex autoMutex(&m_impl->tableGenerationsLock);
+		m_impl->tableGenerations[tableCode] = generation;
+	}
+	replyOk();
+}
+
+void HatoholArmPluginGate::resetTableGenerations(void)
+{
+	AutoMutex autoMutex(&m_impl->tableGenerationsLock);
+	m_impl->tableGenerations.clear();
+}
+
 void HatoholArmPluginGate::cmdHandlerSendUpdatedEvents(
   const HapiCommandHeader *header)
 {
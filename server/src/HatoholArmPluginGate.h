@@ -122,6 +122,8 @@ protected:
 	bool launchPluginProcess(const ArmPluginInfo &armPluginInfo);
 	static std::string generateBrokerAddress(
 	  const MonitoringServerInfo &serverInfo);
+	static std::string generateLocalChannelPath(
+	  const MonitoringServerInfo &serverInfo);
 	void sendTerminateCommand(void);
 
 	void cmdHandlerGetMonitoringServerInfo(
@@ -130,14 +132,24 @@ protected:
 	  const HapiCommandHeader *header);
 	void cmdHandlerGetLastEventId(const HapiCommandHeader *header);
 	void cmdHandlerGetTimeOfLastEvent(const HapiCommandHeader *header);
+	void cmdHandlerGetTimesOfLastEvents(const HapiCommandHeader *header);
 	void cmdHandlerSendUpdatedTriggers(const HapiCommandHeader *header);
 	void cmdHandlerSendHosts(const HapiCommandHeader *header);
 	void cmdHandlerSendHostgroupElements(const HapiCommandHeader *header);
 	void cmdHandlerSendHostgroups(const HapiCommandHeader *header);
+	void cmdHandlerSendTableDelta(const HapiCommandHeader *header);
 	void cmdHandlerSendUpdatedEvents(const HapiCommandHeader *header);
 	void cmdHandlerSendArmInfo(const HapiCommandHeader *header);
 	void cmdHandlerSendHapSelfTriggers(const HapiCommandHeader *header);
 
+	/**
+	 * Forget the generations of the tables sent as deltas. The next
+	 * delta of each table is replied with
+	 * HAPI_RES_ERR_GENERATION_MISMATCH, so the plugin sends the whole
+	 * table again.
+	 */
+	void resetTableGenerations(void);
+
 	void addInitialTrigger(HatoholArmPluginWatchType addtrigger);
 
 	void createPluginTriggerInfo(const HAPIWtchPointInfo &resTrigger,
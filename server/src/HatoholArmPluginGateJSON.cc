@@ -29,6 +29,7 @@
 #include "AMQPConnectionInfo.h"
 #include "AMQPMessageHandler.h"
 #include "GateJSONEventMessage.h"
+#include "HostInfoCache.h"
 
 using namespace std;
 using namespace mlpl;
@@ -38,7 +39,6 @@ class AMQPJSONMessageHandler : public AMQPMessageHandler
 public:
 	AMQPJSONMessageHandler(const MonitoringServerInfo &serverInfo)
 	: m_serverInfo(serverInfo),
-	  m_hosts(),
 	  m_largestHostID(0)
 	{
 		initializeHosts();
@@ -73,7 +73,6 @@ public:
 
 private:
 	MonitoringServerInfo m_serverInfo;
-	map<string, HostIdType> m_hosts;
 	HostIdType m_largestHostID;
 
 	void initializeHosts()
@@ -88,7 +87,6 @@ private:
 		HostInfoListIterator it = hostInfoList.begin();
 		for (; it != hostInfoList.end(); ++it) {
 			const HostInfo &hostInfo = *it;
-			m_hosts[hostInfo.hostName] = hostInfo.id;
 			if (hostInfo.id > m_largestHostID) {
 				m_largestHostID = hostInfo.id;
 			}
@@ -130,11 +128,11 @@ private:
 
 	HostIdType findOrCreateHostID(const string &hostName)
 	{
-		map<string, HostIdType>::iterator it;
-		it = m_hosts.find(hostName);
-		if (it != m_hosts.end()) {
-			return it->second;
-		}
+		HostIdType hostId;
+		HostInfoCache &hostInfoCache =
+		  HostInfoCache::getInstance(m_serverInfo.id);
+		if (hostInfoCache.getId(hostName, hostId))
+			return hostId;
 
 		ThreadLocalDBCache cache;
 		DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
@@ -146,8 +144,8 @@ private:
 		hostInfo.id = ++m_largestHostID;
 		hostInfo.hostName = hostName;
 		hostInfo.validity = HOST_VALID_INAPPLICABLE;
+		// addHostInfo() also registers the host to hostInfoCache.
 		dbMonitoring.addHostInfo(&hostInfo);
-		m_hosts[hostName] = m_largestHostID;
 		return m_largestHostID;
 	}
 };
@@ -0,0 +1,795 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <map>
+#include <Mutex.h>
+#include <StringUtils.h>
+#include "HistoryCache.h"
+#include "ConfigManager.h"
+#include "HatoholException.h"
+
+using namespace std;
+using namespace mlpl;
+
+const int HistoryCache::ROLLUP_RESOLUTIONS[] = {60, 10 * 60, 60 * 60};
+const size_t HistoryCache::NUM_ROLLUP_RESOLUTIONS =
+  sizeof(HistoryCache::ROLLUP_RESOLUTIONS) / sizeof(int);
+const time_t HistoryCache::UNSETTLED_SEC = 60;
+const time_t HistoryCache::RETENTION_SEC = 7 * 24 * 60 * 60;
+
+// The resolutions above must divide this.
+static const time_t SEGMENT_SEC = 60 * 60;
+
+static const size_t MAX_DECIMALS = 15;
+
+struct Sample {
+	timespec clock;
+	uint64_t bits;  // IEEE 754 of a float or a raw integer
+	string   value; // The string got from the server
+};
+
+static bool operator<(const Sample &lhs, const Sample &rhs)
+{
+	if (lhs.clock.tv_sec != rhs.clock.tv_sec)
+		return lhs.clock.tv_sec < rhs.clock.tv_sec;
+	return lhs.clock.tv_nsec < rhs.clock.tv_nsec;
+}
+
+static bool parseValue(const ItemInfoValueType &valueType,
+                       const string &value, uint64_t &bits)
+{
+	const char *str = value.c_str();
+	char *end = NULL;
+	if (valueType == ITEM_INFO_VALUE_TYPE_INTEGER) {
+		bits = strtoull(str, &end, 10);
+	} else {
+		const double number = strtod(str, &end);
+		memcpy(&bits, &number, sizeof(bits));
+	}
+	return end != str;
+}
+
+static double toDouble(const ItemInfoValueType &valueType,
+                       const uint64_t &bits)
+{
+	if (valueType == ITEM_INFO_VALUE_TYPE_INTEGER)
+		return bits;
+	double number;
+	memcpy(&number, &bits, sizeof(number));
+	return number;
+}
+
+static string toString(const ItemInfoValueType &valueType,
+                       const uint64_t &bits)
+{
+	if (valueType == ITEM_INFO_VALUE_TYPE_INTEGER)
+		return StringUtils::sprintf("%" PRIu64, bits);
+
+	// 17 digits are needed only if 15 digits don't restore the value.
+	const double number = toDouble(valueType, bits);
+	const string str = StringUtils::sprintf("%.15g", number);
+	if (strtod(str.c_str(), NULL) == number)
+		return str;
+	return StringUtils::sprintf("%.17g", number);
+}
+
+// Returns the number of the decimals if the value is the same as
+// the fixed-point format of them, or -1.
+static int getNumberOfDecimals(const ItemInfoValueType &valueType,
+                               const uint64_t &bits, const string &value)
+{
+	if (valueType == ITEM_INFO_VALUE_TYPE_INTEGER)
+		return -1;
+	const size_t pos = value.find('.');
+	const size_t numDecimals =
+	  (pos == string::npos) ? 0 : value.size() - pos - 1;
+	if (numDecimals > MAX_DECIMALS)
+		return -1;
+	const string str = StringUtils::sprintf(
+	  "%.*f", (int)numDecimals, toDouble(valueType, bits));
+	return (str == value) ? numDecimals : -1;
+}
+
+static void addToRollup(HistoryCache::Rollup &rollup, const double &value)
+{
+	if (rollup.count == 0 || value < rollup.min)
+		rollup.min = value;
+	if (rollup.count == 0 || value > rollup.max)
+		rollup.max = value;
+	rollup.sum += value;
+	rollup.count++;
+}
+
+static HistoryCache::Rollup makeRollup(const time_t &clock)
+{
+	HistoryCache::Rollup rollup;
+	rollup.clock = clock;
+	rollup.min = 0;
+	rollup.max = 0;
+	rollup.sum = 0;
+	rollup.count = 0;
+	return rollup;
+}
+
+// ---------------------------------------------------------------------------
+// BitStream
+// ---------------------------------------------------------------------------
+struct BitStream {
+	vector<uint8_t> bytes;
+	size_t          numBits;
+
+	BitStream(void)
+	: numBits(0)
+	{
+	}
+
+	void write(const uint64_t &value, const int &width)
+	{
+		for (int i = width - 1; i >= 0; i--) {
+			if (numBits % 8 == 0)
+				bytes.push_back(0);
+			if ((value >> i) & 1)
+				bytes.back() |= 0x80 >> (numBits % 8);
+			numBits++;
+		}
+	}
+};
+
+struct BitReader {
+	const BitStream &stream;
+	size_t           pos;
+
+	BitReader(const BitStream &_stream)
+	: stream(_stream),
+	  pos(0)
+	{
+	}
+
+	uint64_t read(const int &width)
+	{
+		HATOHOL_ASSERT(pos + width <= stream.numBits,
+		               "Out of the stream: %zd + %d > %zd\n",
+		               pos, width, stream.numBits);
+		uint64_t value = 0;
+		for (int i = 0; i < width; i++, pos++) {
+			const uint8_t byte = stream.bytes[pos / 8];
+			value = (value << 1) | ((byte >> (7 - pos % 8)) & 1);
+		}
+		return value;
+	}
+
+	int64_t readSigned(const int &width, const int64_t &offset)
+	{
+		return (int64_t)read(width) - offset;
+	}
+};
+
+// ---------------------------------------------------------------------------
+// Segment
+// ---------------------------------------------------------------------------
+//
+// The encoding of each sample:
+//
+//   timestamp: The first one is the offset from the beginning of the
+//              segment in 12 bits. The following ones are the delta of
+//              the deltas:
+//                0                         : the same delta
+//                10   + 7 bits             : [-63, 64]
+//                110  + 9 bits             : [-255, 256]
+//                1110 + 12 bits            : [-2047, 2048]
+//                1111 + 32 bits            : others
+//   nanosecond: 0 if it is 0, or 1 + 30 bits.
+//   value:      The first one is 64 bits. The following ones are XOR
+//               with the previous value:
+//                0                         : the same value
+//                10 + meaningful bits      : in the previous window
+//                11 + 5 bits of the leading zeros + 6 bits of the length
+//                   + meaningful bits      : a new window
+//   format:     How the value was written by the server:
+//                0                         : the shortest form
+//                10 + 4 bits               : the number of decimals
+//                11                        : others kept in rawValues
+//
+struct Segment {
+	ItemInfoValueType       valueType;
+	time_t                  startTime;
+	size_t                  count;
+	BitStream               stream;
+	map<size_t, string>     rawValues; // key: the index of a sample
+
+	// The state of the encoder
+	time_t    prevSec;
+	time_t    prevDelta;
+	uint64_t  prevBits;
+	int       prevLeading;
+	int       prevTrailing;
+
+	Segment(const ItemInfoValueType &_valueType, const time_t &_startTime)
+	: valueType(_valueType),
+	  startTime(_startTime),
+	  count(0),
+	  prevSec(0),
+	  prevDelta(0),
+	  prevBits(0),
+	  prevLeading(-1),
+	  prevTrailing(0)
+	{
+	}
+
+	void append(const Sample &sample)
+	{
+		appendTime(sample.clock.tv_sec);
+		if (sample.clock.tv_nsec == 0) {
+			stream.write(0, 1);
+		} else {
+			stream.write(1, 1);
+			stream.write(sample.clock.tv_nsec, 30);
+		}
+		appendValue(sample.bits);
+		appendFormat(sample.bits, sample.value);
+		count++;
+	}
+
+	void appendTime(const time_t &sec)
+	{
+		if (count == 0) {
+			stream.write(sec - startTime, 12);
+			prevSec = sec;
+			prevDelta = 0;
+			return;
+		}
+		const time_t delta = sec - prevSec;
+		const int64_t dod = delta - prevDelta;
+		if (dod == 0) {
+			stream.write(0, 1);
+		} else if (dod >= -63 && dod <= 64) {
+			stream.write(0x2, 2);
+			stream.write(dod + 63, 7);
+		} else if (dod >= -255 && dod <= 256) {
+			stream.write(0x6, 3);
+			stream.write(dod + 255, 9);
+		} else if (dod >= -2047 && dod <= 2048) {
+			stream.write(0xe, 4);
+			stream.write(dod + 2047, 12);
+		} else {
+			stream.write(0xf, 4);
+			stream.write((uint32_t)(int32_t)dod, 32);
+		}
+		prevSec = sec;
+		prevDelta = delta;
+	}
+
+	void appendValue(const uint64_t &bits)
+	{
+		if (count == 0) {
+			stream.write(bits, 64);
+			prevBits = bits;
+			return;
+		}
+		const uint64_t xorBits = bits ^ prevBits;
+		prevBits = bits;
+		if (xorBits == 0) {
+			stream.write(0, 1);
+			return;
+		}
+		stream.write(1, 1);
+		const int leading = min(__builtin_clzll(xorBits), 31);
+		const int trailing = __builtin_ctzll(xorBits);
+		if (prevLeading >= 0 &&
+		    leading >= prevLeading && trailing >= prevTrailing) {
+			stream.write(0, 1);
+			stream.write(xorBits >> prevTrailing,
+			             64 - prevLeading - prevTrailing);
+			return;
+		}
+		const int length = 64 - leading - trailing;
+		stream.write(1, 1);
+		stream.write(leading, 5);
+		stream.write(length == 64 ? 0 : length, 6);
+		stream.write(xorBits >> trailing, length);
+		prevLeading = leading;
+		prevTrailing = trailing;
+	}
+
+	void appendFormat(const uint64_t &bits, const string &value)
+	{
+		if (toString(valueType, bits) == value) {
+			stream.write(0, 1);
+			return;
+		}
+		const int numDecimals =
+		  getNumberOfDecimals(valueType, bits, value);
+		if (numDecimals >= 0) {
+			stream.write(0x2, 2);
+			stream.write(numDecimals, 4);
+			return;
+		}
+		stream.write(0x3, 2);
+		rawValues[count] = value;
+	}
+
+	string decodeFormat(BitReader &reader, const size_t &index,
+	                    const uint64_t &bits) const
+	{
+		if (reader.read(1) == 0)
+			return toString(valueType, bits);
+		if (reader.read(1) == 0) {
+			const int numDecimals = reader.read(4);
+			return StringUtils::sprintf(
+			  "%.*f", numDecimals, toDouble(valueType, bits));
+		}
+		map<size_t, string>::const_iterator it = rawValues.find(index);
+		HATOHOL_ASSERT(it != rawValues.end(),
+		               "Not found the value: %zd\n", index);
+		return it->second;
+	}
+
+	size_t getDataSize(void) const
+	{
+		size_t size = stream.bytes.size();
+		map<size_t, string>::const_iterator it = rawValues.begin();
+		for (; it != rawValues.end(); ++it)
+			size += it->second.size();
+		return size;
+	}
+
+	void decode(vector<Sample> &samples) const
+	{
+		BitReader reader(stream);
+		time_t sec = 0;
+		time_t delta = 0;
+		uint64_t bits = 0;
+		int leading = 0;
+		int trailing = 0;
+		for (size_t i = 0; i < count; i++) {
+			Sample sample;
+			if (i == 0) {
+				sec = startTime + reader.read(12);
+			} else {
+				int64_t dod = 0;
+				if (reader.read(1) == 0)
+					dod = 0;
+				else if (reader.read(1) == 0)
+					dod = reader.readSigned(7, 63);
+				else if (reader.read(1) == 0)
+					dod = reader.readSigned(9, 255);
+				else if (reader.read(1) == 0)
+					dod = reader.readSigned(12, 2047);
+				else
+					dod = (int32_t)reader.read(32);
+				delta += dod;
+				sec += delta;
+			}
+			sample.clock.tv_sec = sec;
+			sample.clock.tv_nsec =
+			  reader.read(1) ? reader.read(30) : 0;
+
+			if (i == 0) {
+				bits = reader.read(64);
+			} else if (reader.read(1) == 1) {
+				if (reader.read(1) == 1) {
+					leading = reader.read(5);
+					int length = reader.read(6);
+					if (length == 0)
+						length = 64;
+					trailing = 64 - leading - length;
+				}
+				const int length = 64 - leading - trailing;
+				bits ^= reader.read(length) << trailing;
+			}
+			sample.bits = bits;
+			sample.value = decodeFormat(reader, i, bits);
+			samples.push_back(sample);
+		}
+	}
+};
+
+// ---------------------------------------------------------------------------
+// Series
+// ---------------------------------------------------------------------------
+typedef pair<ServerIdType, ItemIdType> ItemKey;
+typedef map<time_t, HistoryCache::Rollup> RollupMap;
+typedef RollupMap::iterator               RollupMapIterator;
+
+struct Series {
+	const ItemInfoValueType valueType;
+	time_t                  coveredBegin;
+	time_t                  coveredEnd;
+	deque<Segment>          segments;
+	vector<RollupMap>       rollupMaps;
+	list<ItemKey>::iterator lruIt;
+
+	Series(const ItemInfoValueType &_valueType, const time_t &beginTime)
+	: valueType(_valueType),
+	  coveredBegin(beginTime),
+	  coveredEnd(beginTime - 1),
+	  rollupMaps(HistoryCache::NUM_ROLLUP_RESOLUTIONS)
+	{
+	}
+
+	void append(const Sample &sample)
+	{
+		const time_t sec = sample.clock.tv_sec;
+		const time_t startTime = sec - sec % SEGMENT_SEC;
+		if (segments.empty() || segments.back().startTime != startTime)
+			segments.push_back(Segment(valueType, startTime));
+		segments.back().append(sample);
+
+		const double value = toDouble(valueType, sample.bits);
+		for (size_t i = 0; i < rollupMaps.size(); i++) {
+			const int res = HistoryCache::ROLLUP_RESOLUTIONS[i];
+			const time_t clock = sec - sec % res;
+			RollupMapIterator it = rollupMaps[i].find(clock);
+			if (it == rollupMaps[i].end()) {
+				it = rollupMaps[i].insert(
+				  make_pair(clock, makeRollup(clock))).first;
+			}
+			addToRollup(it->second, value);
+		}
+	}
+
+	void dropOldSamples(void)
+	{
+		const time_t limit = coveredEnd - HistoryCache::RETENTION_SEC;
+		bool dropped = false;
+		while (!segments.empty() &&
+		       segments.front().startTime + SEGMENT_SEC <= limit) {
+			coveredBegin = max(coveredBegin,
+			  segments.front().startTime + SEGMENT_SEC);
+			segments.pop_front();
+			dropped = true;
+		}
+		if (!dropped)
+			return;
+		for (size_t i = 0; i < rollupMaps.size(); i++) {
+			RollupMap &rollupMap = rollupMaps[i];
+			rollupMap.erase(rollupMap.begin(),
+			                rollupMap.lower_bound(coveredBegin));
+		}
+	}
+
+	size_t getDataSize(void) const
+	{
+		size_t size = 0;
+		for (size_t i = 0; i < segments.size(); i++)
+			size += segments[i].getDataSize();
+		return size;
+	}
+};
+
+typedef map<ItemKey, Series *> SeriesMap;
+typedef SeriesMap::iterator    SeriesMapIterator;
+
+// ---------------------------------------------------------------------------
+// HistoryCache::Impl
+// ---------------------------------------------------------------------------
+struct HistoryCache::Impl {
+	static Mutex         instanceLock;
+	static HistoryCache *instance;
+
+	const size_t  maxItems;
+	Mutex         lock;
+	SeriesMap     seriesMap;
+	list<ItemKey> lruList; // The front is the most recently used.
+
+	Impl(const size_t &_maxItems)
+	: maxItems(_maxItems)
+	{
+	}
+
+	virtual ~Impl()
+	{
+		SeriesMapIterator it = seriesMap.begin();
+		for (; it != seriesMap.end(); ++it)
+			delete it->second;
+	}
+
+	// Call with the lock.
+	Series *find(const ItemInfo &itemInfo)
+	{
+		const ItemKey key(itemInfo.serverId, itemInfo.id);
+		SeriesMapIterator it = seriesMap.find(key);
+		if (it == seriesMap.end())
+			return NULL;
+		Series *series = it->second;
+		lruList.splice(lruList.begin(), lruList, series->lruIt);
+		return series;
+	}
+
+	// Call with the lock.
+	Series *findCovering(const ItemInfo &itemInfo, const time_t &beginTime)
+	{
+		Series *series = find(itemInfo);
+		if (!series)
+			return NULL;
+		if (beginTime < series->coveredBegin ||
+		    beginTime > series->coveredEnd + 1)
+			return NULL;
+		return series;
+	}
+
+	// Call with the lock.
+	void remove(const ItemKey &key)
+	{
+		SeriesMapIterator it = seriesMap.find(key);
+		if (it == seriesMap.end())
+			return;
+		lruList.erase(it->second->lruIt);
+		delete it->second;
+		seriesMap.erase(it);
+	}
+
+	// Call with the lock.
+	Series *create(const ItemInfo &itemInfo, const time_t &beginTime)
+	{
+		const ItemKey key(itemInfo.serverId, itemInfo.id);
+		remove(key);
+		while (!lruList.empty() && seriesMap.size() >= maxItems)
+			remove(lruList.back());
+		Series *series = new Series(itemInfo.valueType, beginTime);
+		lruList.push_front(key);
+		series->lruIt = lruList.begin();
+		seriesMap[key] = series;
+		return series;
+	}
+};
+
+Mutex         HistoryCache::Impl::instanceLock;
+HistoryCache *HistoryCache::Impl::instance = NULL;
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+HistoryCache *HistoryCache::getInstance(void)
+{
+	AutoMutex autoMutex(&Impl::instanceLock);
+	if (!Impl::instance) {
+		ConfigManager *confMgr = ConfigManager::getInstance();
+		Impl::instance =
+		  new HistoryCache(confMgr->getNumberOfHistoryCacheItems());
+	}
+	return Impl::instance;
+}
+
+void HistoryCache::reset(void)
+{
+	AutoMutex autoMutex(&Impl::instanceLock);
+	delete Impl::instance;
+	Impl::instance = NULL;
+}
+
+bool HistoryCache::isCacheable(const ItemInfo &itemInfo)
+{
+	return itemInfo.valueType == ITEM_INFO_VALUE_TYPE_FLOAT ||
+	       itemInfo.valueType == ITEM_INFO_VALUE_TYPE_INTEGER;
+}
+
+bool HistoryCache::isValidResolution(const int &resolution)
+{
+	for (size_t i = 0; i < NUM_ROLLUP_RESOLUTIONS; i++) {
+		if (ROLLUP_RESOLUTIONS[i] == resolution)
+			return true;
+	}
+	return false;
+}
+
+void HistoryCache::aggregate(RollupVect &rollupVect,
+                             const HistoryInfoVect &historyInfoVect,
+                             const int &resolution)
+{
+	HATOHOL_ASSERT(resolution > 0, "Invalid resolution: %d\n",
+	               resolution);
+	HistoryInfoVectConstIterator it = historyInfoVect.begin();
+	for (; it != historyInfoVect.end(); ++it) {
+		const char *str = it->value.c_str();
+		char *end = NULL;
+		const double value = strtod(str, &end);
+		if (end == str)
+			continue;
+		const time_t sec = it->clock.tv_sec;
+		const time_t clock = sec - sec % resolution;
+		if (rollupVect.empty() || rollupVect.back().clock != clock)
+			rollupVect.push_back(makeRollup(clock));
+		addToRollup(rollupVect.back(), value);
+	}
+}
+
+void HistoryCache::mergeRollups(RollupVect &rollupVect,
+                                const size_t &maxPoints)
+{
+	HATOHOL_ASSERT(maxPoints > 0, "Invalid maxPoints: %zd\n", maxPoints);
+	if (rollupVect.size() <= maxPoints)
+		return;
+	const size_t numPerPoint =
+	  (rollupVect.size() + maxPoints - 1) / maxPoints;
+	size_t numMerged = 0;
+	for (size_t i = 0; i < rollupVect.size(); i++) {
+		const Rollup &rollup = rollupVect[i];
+		if (i % numPerPoint == 0) {
+			rollupVect[numMerged++] = rollup;
+			continue;
+		}
+		Rollup &merged = rollupVect[numMerged - 1];
+		merged.min = min(merged.min, rollup.min);
+		merged.max = max(merged.max, rollup.max);
+		merged.sum += rollup.sum;
+		merged.count += rollup.count;
+	}
+	rollupVect.resize(numMerged);
+}
+
+HistoryCache::HistoryCache(const size_t &maxItems)
+: m_impl(new Impl(maxItems))
+{
+}
+
+HistoryCache::~HistoryCache()
+{
+}
+
+bool HistoryCache::isEnabled(void) const
+{
+	return m_impl->maxItems > 0;
+}
+
+bool HistoryCache::getRangeToFetch(const ItemInfo &itemInfo,
+                                   const time_t &beginTime,
+                                   const time_t &endTime,
+                                   time_t &fetchBeginTime)
+{
+	fetchBeginTime = beginTime;
+	if (!isEnabled() || !isCacheable(itemInfo))
+		return false;
+
+	AutoMutex autoMutex(&m_impl->lock);
+	Series *series = m_impl->findCovering(itemInfo, beginTime);
+	if (!series)
+		return false;
+	if (endTime <= series->coveredEnd)
+		return true;
+	fetchBeginTime = series->coveredEnd + 1;
+	return false;
+}
+
+void HistoryCache::add(const ItemInfo &itemInfo,
+                       const time_t &beginTime, const time_t &endTime,
+                       const HistoryInfoVect &historyInfoVect)
+{
+	if (!isEnabled() || !isCacheable(itemInfo))
+		return;
+	const time_t settledEndTime =
+	  min(endTime, time(NULL) - UNSETTLED_SEC);
+	if (settledEndTime < beginTime)
+		return;
+
+	vector<Sample> samples;
+	HistoryInfoVectConstIterator it = historyInfoVect.begin();
+	for (; it != historyInfoVect.end(); ++it) {
+		const time_t sec = it->clock.tv_sec;
+		if (sec < beginTime || sec > settledEndTime)
+			continue;
+		Sample sample;
+		sample.clock = it->clock;
+		if (!parseValue(itemInfo.valueType, it->value, sample.bits))
+			continue;
+		sample.value = it->value;
+		samples.push_back(sample);
+	}
+	sort(samples.begin(), samples.end());
+
+	AutoMutex autoMutex(&m_impl->lock);
+	Series *series = m_impl->find(itemInfo);
+	if (!series || series->valueType != itemInfo.valueType ||
+	    beginTime < series->coveredBegin ||
+	    beginTime > series->coveredEnd + 1) {
+		series = m_impl->create(itemInfo, beginTime);
+	}
+	for (size_t i = 0; i < samples.size(); i++) {
+		if (samples[i].clock.tv_sec > series->coveredEnd)
+			series->append(samples[i]);
+	}
+	series->coveredEnd = max(series->coveredEnd, settledEndTime);
+	series->dropOldSamples();
+}
+
+bool HistoryCache::get(HistoryInfoVect &historyInfoVect,
+                       const ItemInfo &itemInfo,
+                       const time_t &beginTime, const time_t &_endTime,
+                       time_t &cachedEndTime)
+{
+	AutoMutex autoMutex(&m_impl->lock);
+	Series *series = m_impl->findCovering(itemInfo, beginTime);
+	if (!series)
+		return false;
+	const time_t endTime = min(_endTime, series->coveredEnd);
+	cachedEndTime = endTime;
+
+	vector<Sample> samples;
+	for (size_t i = 0; i < series->segments.size(); i++) {
+		const Segment &segment = series->segments[i];
+		if (segment.startTime + SEGMENT_SEC <= beginTime)
+			continue;
+		if (segment.startTime > endTime)
+			break;
+		segment.decode(samples);
+	}
+
+	for (size_t i = 0; i < samples.size(); i++) {
+		const Sample &sample = samples[i];
+		if (sample.clock.tv_sec < beginTime ||
+		    sample.clock.tv_sec > endTime)
+			continue;
+		HistoryInfo historyInfo;
+		historyInfo.serverId = itemInfo.serverId;
+		historyInfo.itemId = itemInfo.id;
+		historyInfo.value = sample.value;
+		historyInfo.clock = sample.clock;
+		historyInfoVect.push_back(historyInfo);
+	}
+	return true;
+}
+
+bool HistoryCache::getRollups(RollupVect &rollupVect,
+                              const ItemInfo &itemInfo,
+                              const int &resolution,
+                              const time_t &beginTime, const time_t &_endTime,
+                              time_t &cachedEndTime)
+{
+	size_t index = 0;
+	for (; index < NUM_ROLLUP_RESOLUTIONS; index++) {
+		if (ROLLUP_RESOLUTIONS[index] == resolution)
+			break;
+	}
+	HATOHOL_ASSERT(index < NUM_ROLLUP_RESOLUTIONS,
+	               "Invalid resolution: %d\n", resolution);
+
+	AutoMutex autoMutex(&m_impl->lock);
+	Series *series = m_impl->findCovering(itemInfo, beginTime);
+	if (!series)
+		return false;
+	const time_t endTime = min(_endTime, series->coveredEnd);
+	cachedEndTime = endTime;
+	RollupMap &rollupMap = series->rollupMaps[index];
+	RollupMapIterator it =
+	  rollupMap.lower_bound(beginTime - beginTime % resolution);
+	for (; it != rollupMap.end() && it->first <= endTime; ++it)
+		rollupVect.push_back(it->second);
+	return true;
+}
+
+size_t HistoryCache::getNumberOfItems(void) const
+{
+	AutoMutex autoMutex(&m_impl->lock);
+	return m_impl->seriesMap.size();
+}
+
+size_t HistoryCache::getDataSize(void) const
+{
+	AutoMutex autoMutex(&m_impl->lock);
+	size_t size = 0;
+	SeriesMapIterator it = m_impl->seriesMap.begin();
+	for (; it != m_impl->seriesMap.end(); ++it)
+		size += it->second->getDataSize();
+	return size;
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HistoryCache_h
+#define HistoryCache_h
+
+#include <vector>
+#include <memory>
+#include "Params.h"
+#include "Monitoring.h"
+
+/**
+ * A local store of the history of numeric items fetched from the
+ * monitoring servers.
+ *
+ * The samples of each item are kept in segments partitioned by an hour
+ * and compressed with the delta-of-delta encoding of the timestamps and
+ * the XOR encoding of the values. The values are returned in the same
+ * strings as the ones got from the server. Only one contiguous time
+ * range is kept for each item. A request that starts in the range only
+ * needs to fetch the tail after it.
+ *
+ * The minimum, maximum and average of the samples are also kept for
+ * each bucket of the resolutions in ROLLUP_RESOLUTIONS.
+ */
+class HistoryCache {
+public:
+	struct Rollup {
+		time_t clock; // The beginning of the bucket
+		double min;
+		double max;
+		double sum;
+		size_t count;
+	};
+	typedef std::vector<Rollup>         RollupVect;
+	typedef RollupVect::iterator        RollupVectIterator;
+	typedef RollupVect::const_iterator  RollupVectConstIterator;
+
+	static const int    ROLLUP_RESOLUTIONS[];
+	static const size_t NUM_ROLLUP_RESOLUTIONS;
+
+	/**
+	 * Samples newer than this from the time of the fetch are not
+	 * regarded as cached, because the server may still get samples
+	 * with such timestamps.
+	 */
+	static const time_t UNSETTLED_SEC;
+
+	/**
+	 * Samples older than this from the end of the cached range are
+	 * dropped.
+	 */
+	static const time_t RETENTION_SEC;
+
+	/**
+	 * Get the shared instance. The maximum number of items is taken
+	 * from ConfigManager when this is called at the first time.
+	 */
+	static HistoryCache *getInstance(void);
+
+	/**
+	 * Remove all items of the shared instance. This is mainly for tests.
+	 */
+	static void reset(void);
+
+	static bool isCacheable(const ItemInfo &itemInfo);
+	static bool isValidResolution(const int &resolution);
+
+	/**
+	 * Aggregate samples into buckets without the cache.
+	 *
+	 * @param rollupVect The buckets are appended to this.
+	 * @param historyInfoVect Samples sorted by the time.
+	 * @param resolution A resolution in seconds.
+	 */
+	static void aggregate(RollupVect &rollupVect,
+	                      const HistoryInfoVect &historyInfoVect,
+	                      const int &resolution);
+
+	/**
+	 * Merge adjacent buckets so that the number of them doesn't exceed
+	 * maxPoints. The clock of a merged bucket is the one of the first
+	 * bucket in it.
+	 *
+	 * @param rollupVect Buckets sorted by the time.
+	 * @param maxPoints The maximum number of the buckets.
+	 */
+	static void mergeRollups(RollupVect &rollupVect,
+	                         const size_t &maxPoints);
+
+	/**
+	 * Constructor.
+	 *
+	 * @param maxItems
+	 * The maximum number of items. When it is exceeded, the least
+	 * recently used item is removed. The cache is disabled if it is 0.
+	 */
+	HistoryCache(const size_t &maxItems);
+	virtual ~HistoryCache();
+
+	bool isEnabled(void) const;
+
+	/**
+	 * Get the range that has to be fetched from the server.
+	 *
+	 * @param itemInfo A target item.
+	 * @param beginTime The beginning of the requested range.
+	 * @param endTime The end of the requested range.
+	 * @param fetchBeginTime
+	 * The beginning of the range to be fetched is stored. The end is
+	 * always endTime.
+	 *
+	 * @return true if the whole range is cached and nothing has to be
+	 * fetched.
+	 */
+	bool getRangeToFetch(const ItemInfo &itemInfo,
+	                     const time_t &beginTime, const time_t &endTime,
+	                     time_t &fetchBeginTime);
+
+	/**
+	 * Store fetched samples.
+	 *
+	 * @param itemInfo A target item.
+	 * @param beginTime The beginning of the fetched range.
+	 * @param endTime The end of the fetched range.
+	 * @param historyInfoVect All samples in the range.
+	 */
+	void add(const ItemInfo &itemInfo,
+	         const time_t &beginTime, const time_t &endTime,
+	         const HistoryInfoVect &historyInfoVect);
+
+	/**
+	 * Get cached samples.
+	 *
+	 * @param historyInfoVect The samples are appended to this.
+	 * @param cachedEndTime
+	 * The end of the returned range is stored. It is earlier than
+	 * endTime when the rest isn't cached.
+	 *
+	 * @return false if beginTime isn't in the cached range.
+	 */
+	bool get(HistoryInfoVect &historyInfoVect, const ItemInfo &itemInfo,
+	         const time_t &beginTime, const time_t &endTime,
+	         time_t &cachedEndTime);
+
+	/**
+	 * Get cached buckets. The last one only has the samples until
+	 * cachedEndTime.
+	 *
+	 * @param rollupVect The buckets are appended to this.
+	 * @param resolution One of ROLLUP_RESOLUTIONS.
+	 * @param cachedEndTime The same as get().
+	 *
+	 * @return false if beginTime isn't in the cached range.
+	 */
+	bool getRollups(RollupVect &rollupVect, const ItemInfo &itemInfo,
+	                const int &resolution,
+	                const time_t &beginTime, const time_t &endTime,
+	                time_t &cachedEndTime);
+
+	size_t getNumberOfItems(void) const;
+
+	/**
+	 * Get the size of the compressed samples in bytes.
+	 */
+	size_t getDataSize(void) const;
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // HistoryCache_h
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <cmath>
+#include <StringUtils.h>
+#include "HistoryDownsampler.h"
+
+using namespace std;
+using namespace mlpl;
+
+// The numeric samples in the arrays for the kernels.
+struct Points {
+	timespec       baseClock;
+	vector<size_t> indexes; // Indexes in the original vector
+	vector<double> times;   // Seconds from baseClock
+	vector<double> values;
+
+	void parse(const HistoryInfoVect &historyInfoVect)
+	{
+		const size_t numSamples = historyInfoVect.size();
+		indexes.reserve(numSamples);
+		times.reserve(numSamples);
+		values.reserve(numSamples);
+		if (numSamples > 0)
+			baseClock = historyInfoVect[0].clock;
+		for (size_t i = 0; i < numSamples; i++) {
+			const HistoryInfo &historyInfo = historyInfoVect[i];
+			const char *str = historyInfo.value.c_str();
+			char *end = NULL;
+			const double value = strtod(str, &end);
+			if (end == str)
+				continue;
+			const timespec &clock = historyInfo.clock;
+			indexes.push_back(i);
+			times.push_back(
+			  (clock.tv_sec - baseClock.tv_sec) +
+			  (clock.tv_nsec - baseClock.tv_nsec) * 1e-9);
+			values.push_back(value);
+		}
+	}
+
+	size_t size(void) const
+	{
+		return values.size();
+	}
+
+	// The first point of the bucket in numBuckets.
+	size_t getBucketBegin(const size_t &bucket,
+	                      const size_t &numBuckets) const
+	{
+		return bucket * size() / numBuckets;
+	}
+};
+
+static void selectAll(vector<size_t> &selected, const Points &points)
+{
+	for (size_t i = 0; i < points.size(); i++)
+		selected.push_back(i);
+}
+
+static void selectByLTTB(vector<size_t> &selected, const Points &points,
+                         const size_t &maxPoints)
+{
+	const size_t numPoints = points.size();
+	const double *times = &points.times[0];
+	const double *values = &points.values[0];
+
+	// The first and the last points are always selected. The others
+	// are divided into (maxPoints - 2) buckets.
+	const double bucketSize = (double)(numPoints - 2) / (maxPoints - 2);
+	size_t prev = 0;
+	selected.push_back(prev);
+	for (size_t bucket = 0; bucket < maxPoints - 2; bucket++) {
+		// The average of the next bucket
+		const size_t nextBegin = (size_t)((bucket + 1) * bucketSize) + 1;
+		size_t nextEnd = (size_t)((bucket + 2) * bucketSize) + 1;
+		if (nextEnd > numPoints)
+			nextEnd = numPoints;
+		double avgTime = 0;
+		double avgValue = 0;
+		for (size_t i = nextBegin; i < nextEnd; i++) {
+			avgTime += times[i];
+			avgValue += values[i];
+		}
+		const size_t numNext = nextEnd - nextBegin;
+		avgTime /= numNext;
+		avgValue /= numNext;
+
+		// The point that makes the largest triangle with the
+		// previously selected one and the average.
+		const size_t begin = (size_t)(bucket * bucketSize) + 1;
+		const size_t end = (size_t)((bucket + 1) * bucketSize) + 1;
+		const double prevTime = times[prev];
+		const double prevValue = values[prev];
+		double maxArea = -1;
+		size_t maxIndex = begin;
+		for (size_t i = begin; i < end; i++) {
+			const double area = fabs(
+			  (prevTime - avgTime) * (values[i] - prevValue) -
+			  (prevTime - times[i]) * (avgValue - prevValue));
+			if (area > maxArea) {
+				maxArea = area;
+				maxIndex = i;
+			}
+		}
+		selected.push_back(maxIndex);
+		prev = maxIndex;
+	}
+	selected.push_back(numPoints - 1);
+}
+
+static void selectMinMax(vector<size_t> &selected, const Points &points,
+                         const size_t &maxPoints)
+{
+	const double *values = &points.values[0];
+	const size_t numBuckets = maxPoints / 2;
+	for (size_t bucket = 0; bucket < numBuckets; bucket++) {
+		const size_t begin = points.getBucketBegin(bucket, numBuckets);
+		const size_t end = points.getBucketBegin(bucket + 1,
+		                                         numBuckets);
+		size_t minIndex = begin;
+		size_t maxIndex = begin;
+		for (size_t i = begin + 1; i < end; i++) {
+			if (values[i] < values[minIndex])
+				minIndex = i;
+			if (values[i] > values[maxIndex])
+				maxIndex = i;
+		}
+		// Keep the order of the time.
+		selected.push_back(min(minIndex, maxIndex));
+		if (minIndex != maxIndex)
+			selected.push_back(max(minIndex, maxIndex));
+	}
+}
+
+static void average(HistoryInfoVect &sampledVect,
+                    const HistoryInfoVect &historyInfoVect,
+                    const Points &points, const size_t &maxPoints)
+{
+	const double *times = &points.times[0];
+	const double *values = &points.values[0];
+	for (size_t bucket = 0; bucket < maxPoints; bucket++) {
+		const size_t begin = points.getBucketBegin(bucket, maxPoints);
+		const size_t end = points.getBucketBegin(bucket + 1, maxPoints);
+		if (begin == end)
+			continue;
+		double sumTime = 0;
+		double sumValue = 0;
+		for (size_t i = begin; i < end; i++) {
+			sumTime += times[i];
+			sumValue += values[i];
+		}
+		const size_t numPoints = end - begin;
+
+		// The time is the average of the bucket.
+		const double time = sumTime / numPoints;
+		const double sec = floor(time);
+		HistoryInfo historyInfo =
+		  historyInfoVect[points.indexes[begin]];
+		historyInfo.clock = points.baseClock;
+		historyInfo.clock.tv_sec += (time_t)sec;
+		historyInfo.clock.tv_nsec += (long)((time - sec) * 1e9);
+		if (historyInfo.clock.tv_nsec >= 1000000000) {
+			historyInfo.clock.tv_sec++;
+			historyInfo.clock.tv_nsec -= 1000000000;
+		}
+		historyInfo.value =
+		  StringUtils::sprintf("%.15g", sumValue / numPoints);
+		sampledVect.push_back(historyInfo);
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+bool HistoryDownsampler::parseMethod(const string &name, Method &method)
+{
+	if (name == "lttb")
+		method = METHOD_LTTB;
+	else if (name == "minmax")
+		method = METHOD_MIN_MAX;
+	else if (name == "avg")
+		method = METHOD_AVERAGE;
+	else
+		return false;
+	return true;
+}
+
+void HistoryDownsampler::downsample(HistoryInfoVect &sampledVect,
+                                    const HistoryInfoVect &historyInfoVect,
+                                    const size_t &maxPoints,
+                                    const Method &method)
+{
+	if (maxPoints == 0)
+		return;
+	Points points;
+	points.parse(historyInfoVect);
+	if (points.size() == 0)
+		return;
+
+	vector<size_t> selected;
+	if (points.size() <= maxPoints) {
+		selectAll(selected, points);
+	} else if (method == METHOD_LTTB && maxPoints >= 3) {
+		selectByLTTB(selected, points, maxPoints);
+	} else if (method == METHOD_MIN_MAX && maxPoints >= 2) {
+		selectMinMax(selected, points, maxPoints);
+	} else {
+		// Too few points for the other methods.
+		average(sampledVect, historyInfoVect, points, maxPoints);
+		return;
+	}
+
+	sampledVect.reserve(sampledVect.size() + selected.size());
+	for (size_t i = 0; i < selected.size(); i++) {
+		const size_t index = points.indexes[selected[i]];
+		sampledVect.push_back(historyInfoVect[index]);
+	}
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HistoryDownsampler_h
+#define HistoryDownsampler_h
+
+#include <string>
+#include "Monitoring.h"
+
+/**
+ * Reduce the number of samples of a numeric item for drawing a graph.
+ * The values are parsed once into arrays, and the kernels run on them.
+ */
+class HistoryDownsampler {
+public:
+	enum Method {
+		// Largest-Triangle-Three-Buckets. Keeps the samples that
+		// form the visual shape of the graph.
+		METHOD_LTTB,
+		// The minimum and maximum samples of each bucket.
+		METHOD_MIN_MAX,
+		// The average of each bucket. The values are new ones.
+		METHOD_AVERAGE,
+	};
+
+	/**
+	 * Get a method by the name: "lttb", "minmax" or "avg".
+	 *
+	 * @return false if the name is unknown.
+	 */
+	static bool parseMethod(const std::string &name, Method &method);
+
+	/**
+	 * Downsample samples.
+	 *
+	 * @param sampledVect The result is appended to this.
+	 * @param historyInfoVect Samples sorted by the time. The ones
+	 * whose value isn't a number are ignored.
+	 * @param maxPoints The maximum number of the result.
+	 * @param method A method.
+	 */
+	static void downsample(HistoryInfoVect &sampledVect,
+	                       const HistoryInfoVect &historyInfoVect,
+	                       const size_t &maxPoints,
+	                       const Method &method);
+};
+
+#endif // HistoryDownsampler_h
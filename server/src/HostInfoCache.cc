@@ -20,22 +20,199 @@
 #include <cstdio>
 #include <map>
 #include <string>
+#include <Mutex.h>
 #include <ReadWriteLock.h>
+#include <AtomicValue.h>
+#include <Reaper.h>
 #include "Params.h"
 #include "HostInfoCache.h"
+#include "UsedCountablePtr.h"
+#include "ThreadLocalDBCache.h"
 
 using namespace std;
 using namespace mlpl;
 
-typedef map<HostIdType, string> HostIdNameMap;
-typedef HostIdNameMap::iterator HostIdNameMapIterator;
+struct HostEntry {
+	string       name;
+	HostValidity validity;
+};
+
+typedef map<HostIdType, HostEntry> HostIdEntryMap;
+typedef HostIdEntryMap::iterator HostIdEntryMapIterator;
+typedef HostIdEntryMap::const_iterator HostIdEntryMapConstIterator;
+
+typedef map<string, HostIdType> HostNameIdMap;
+typedef HostNameIdMap::iterator HostNameIdMapIterator;
+typedef HostNameIdMap::const_iterator HostNameIdMapConstIterator;
+
+/**
+ * An immutable snapshot of the dictionary. Once it is published,
+ * it is never modified and is deleted when the last reader unrefs it.
+ */
+struct HostDictionary : public UsedCountable {
+	HostIdEntryMap idEntryMap;
+	HostNameIdMap  nameIdMap;
+
+	HostDictionary *clone(void) const
+	{
+		HostDictionary *dict = new HostDictionary();
+		dict->idEntryMap = idEntryMap;
+		dict->nameIdMap = nameIdMap;
+		return dict;
+	}
+
+	bool isSame(const HostInfo &hostInfo) const
+	{
+		HostIdEntryMapConstIterator it = idEntryMap.find(hostInfo.id);
+		if (it == idEntryMap.end())
+			return false;
+		const HostEntry &entry = it->second;
+		return entry.name == hostInfo.hostName &&
+		       entry.validity == hostInfo.validity;
+	}
+
+	void set(const HostInfo &hostInfo)
+	{
+		HostIdEntryMapIterator it = idEntryMap.find(hostInfo.id);
+		if (it != idEntryMap.end()) {
+			// The host may have been renamed.
+			HostNameIdMapIterator nameIt =
+			  nameIdMap.find(it->second.name);
+			if (nameIt != nameIdMap.end() &&
+			    nameIt->second == hostInfo.id) {
+				nameIdMap.erase(nameIt);
+			}
+		}
+		HostEntry &entry = idEntryMap[hostInfo.id];
+		entry.name = hostInfo.hostName;
+		entry.validity = hostInfo.validity;
+		nameIdMap[hostInfo.hostName] = hostInfo.id;
+	}
+};
+
+typedef UsedCountablePtr<HostDictionary> HostDictionaryPtr;
+
+typedef map<ServerIdType, HostInfoCache *> ServerHostInfoCacheMap;
+typedef ServerHostInfoCacheMap::iterator   ServerHostInfoCacheMapIterator;
+
+typedef map<ServerIdType, HostInfoList>  ServerHostInfoListMap;
+typedef ServerHostInfoListMap::iterator  ServerHostInfoListMapIterator;
 
 struct HostInfoCache::Impl
 {
-	ReadWriteLock lock;
-	HostIdNameMap hostIdNameMap;
+	// The shared instances are never deleted. So a reference returned
+	// by getInstance() is valid until the process exits.
+	static ReadWriteLock          instancesLock;
+	static ServerHostInfoCacheMap instances;
+
+	// This lock is taken only to replace or refer 'snapshot'.
+	Mutex           snapshotLock;
+	// Writers and the load from the DB are serialized by this lock.
+	Mutex           updateLock;
+	HostDictionary *snapshot;
+	// The hosts of the server are loaded from the DB on the first use
+	// for the shared instances. An independent instance has no server.
+	const bool          shared;
+	const ServerIdType  serverId;
+	AtomicValue<bool>   loaded;
+
+	Impl(const bool &_shared = false,
+	     const ServerIdType &_serverId = INVALID_SERVER_ID)
+	: snapshot(new HostDictionary()),
+	  shared(_shared),
+	  serverId(_serverId),
+	  loaded(!_shared)
+	{
+	}
+
+	virtual ~Impl()
+	{
+		snapshot->unref();
+	}
+
+	HostDictionary *acquireSnapshot(void)
+	{
+		snapshotLock.lock();
+		HostDictionary *dict = snapshot;
+		dict->ref();
+		snapshotLock.unlock();
+		return dict;
+	}
+
+	void publish(HostDictionary *next)
+	{
+		snapshotLock.lock();
+		HostDictionary *old = snapshot;
+		snapshot = next;
+		snapshotLock.unlock();
+		old->unref();
+	}
+
+	// 'updateLock' must be taken by the caller.
+	void updateWithoutLock(const HostInfoList &hostInfoList)
+	{
+		HostDictionaryPtr curr(acquireSnapshot(), false);
+		HostDictionary *next = NULL;
+		HostInfoListConstIterator it = hostInfoList.begin();
+		for (; it != hostInfoList.end(); ++it) {
+			const HostInfo &hostInfo = *it;
+			if (!next) {
+				if (curr->isSame(hostInfo))
+					continue;
+				next = curr->clone();
+			}
+			next->set(hostInfo);
+		}
+		if (next)
+			publish(next);
+	}
+
+	void update(const HostInfoList &hostInfoList)
+	{
+		AutoMutex autoLock(&updateLock);
+		updateWithoutLock(hostInfoList);
+	}
+
+	void loadIfNeeded(void)
+	{
+		if (loaded.get())
+			return;
+
+		// Hosts written by updateInstances() during the load wait for
+		// 'updateLock'. So they are applied after the ones in the DB.
+		AutoMutex autoLock(&updateLock);
+		if (loaded.get())
+			return;
+		HostInfoList hostInfoList;
+		HostsQueryOption option(USER_ID_SYSTEM);
+		option.setTargetServerId(serverId);
+		option.setValidity(HOST_ANY_VALIDITY);
+		ThreadLocalDBCache cache;
+		cache.getMonitoring().getHostInfoList(hostInfoList, option);
+		updateWithoutLock(hostInfoList);
+		loaded.set(true);
+	}
+
+	void clear(void)
+	{
+		AutoMutex autoLock(&updateLock);
+		publish(new HostDictionary());
+		loaded.set(!shared);
+	}
+
+	static HostInfoCache *findInstance(const ServerIdType &serverId)
+	{
+		instancesLock.readLock();
+		Reaper<ReadWriteLock> unlocker(&instancesLock,
+		                               ReadWriteLock::unlock);
+		ServerHostInfoCacheMapIterator it = instances.find(serverId);
+		return (it == instances.end()) ? NULL : it->second;
+	}
 };
 
+ReadWriteLock          HostInfoCache::Impl::instancesLock;
+ServerHostInfoCacheMap HostInfoCache::Impl::instances;
+
 // ---------------------------------------------------------------------------
 // Public methods
 // ---------------------------------------------------------------------------
@@ -44,36 +221,116 @@ HostInfoCache::HostInfoCache(void)
 {
 }
 
+HostInfoCache::HostInfoCache(const ServerIdType &serverId)
+: m_impl(new Impl(true, serverId))
+{
+}
+
 HostInfoCache::~HostInfoCache()
 {
 }
 
 void HostInfoCache::update(const HostInfo &hostInfo)
 {
-	bool doUpdate = true;
-	m_impl->lock.writeLock();
-	HostIdNameMapIterator it = m_impl->hostIdNameMap.find(hostInfo.id);
-	if (it != m_impl->hostIdNameMap.end()) {
-		const string &hostName = it->second;
-		if (hostName == hostInfo.hostName)
-			doUpdate = false;
-	}
-	if (doUpdate)
-		m_impl->hostIdNameMap[hostInfo.id] = hostInfo.hostName;;
-	m_impl->lock.unlock();
+	HostInfoList hostInfoList;
+	hostInfoList.push_back(hostInfo);
+	m_impl->update(hostInfoList);
+}
+
+void HostInfoCache::update(const HostInfoList &hostInfoList)
+{
+	m_impl->update(hostInfoList);
 }
 
 bool HostInfoCache::getName(const HostIdType &id, string &name) const
 {
-	bool found = false;
-	m_impl->lock.readLock();
-	HostIdNameMapIterator it = m_impl->hostIdNameMap.find(id);
-	if (it != m_impl->hostIdNameMap.end()) {
-		name = it->second;
-		found = true;
+	HostDictionaryPtr dict(m_impl->acquireSnapshot(), false);
+	HostIdEntryMapConstIterator it = dict->idEntryMap.find(id);
+	if (it == dict->idEntryMap.end())
+		return false;
+	name = it->second.name;
+	return true;
+}
+
+bool HostInfoCache::getId(const string &name, HostIdType &id) const
+{
+	HostDictionaryPtr dict(m_impl->acquireSnapshot(), false);
+	HostNameIdMapConstIterator it = dict->nameIdMap.find(name);
+	if (it == dict->nameIdMap.end())
+		return false;
+	id = it->second;
+	return true;
+}
+
+size_t HostInfoCache::getNumberOfHosts(void) const
+{
+	HostDictionaryPtr dict(m_impl->acquireSnapshot(), false);
+	return dict->idEntryMap.size();
+}
+
+void HostInfoCache::getHostInfoList(HostInfoList &hostInfoList) const
+{
+	HostDictionaryPtr dict(m_impl->acquireSnapshot(), false);
+	HostIdEntryMapConstIterator it = dict->idEntryMap.begin();
+	for (; it != dict->idEntryMap.end(); ++it) {
+		const HostEntry &entry = it->second;
+		HostInfo hostInfo;
+		hostInfo.serverId = m_impl->serverId;
+		hostInfo.id = it->first;
+		hostInfo.hostName = entry.name;
+		hostInfo.validity = entry.validity;
+		hostInfoList.push_back(hostInfo);
+	}
+}
+
+HostInfoCache &HostInfoCache::getInstance(const ServerIdType &serverId)
+{
+	HostInfoCache *hostInfoCache = Impl::findInstance(serverId);
+	if (!hostInfoCache) {
+		Impl::instancesLock.writeLock();
+		ServerHostInfoCacheMapIterator it =
+		  Impl::instances.find(serverId);
+		if (it != Impl::instances.end()) {
+			hostInfoCache = it->second;
+		} else {
+			hostInfoCache = new HostInfoCache(serverId);
+			Impl::instances[serverId] = hostInfoCache;
+		}
+		Impl::instancesLock.unlock();
+	}
+
+	// The global lock isn't held here. The load blocks only the users
+	// of this server.
+	hostInfoCache->m_impl->loadIfNeeded();
+	return *hostInfoCache;
+}
+
+void HostInfoCache::updateInstances(const HostInfoList &hostInfoList)
+{
+	ServerHostInfoListMap serverHostInfoListMap;
+	HostInfoListConstIterator hostIt = hostInfoList.begin();
+	for (; hostIt != hostInfoList.end(); ++hostIt)
+		serverHostInfoListMap[hostIt->serverId].push_back(*hostIt);
+
+	// Instances that have not been created yet will load the hosts
+	// from the DB when they are requested.
+	ServerHostInfoListMapIterator it = serverHostInfoListMap.begin();
+	for (; it != serverHostInfoListMap.end(); ++it) {
+		HostInfoCache *hostInfoCache = Impl::findInstance(it->first);
+		if (hostInfoCache)
+			hostInfoCache->update(it->second);
 	}
-	m_impl->lock.unlock();
-	return found;
+}
+
+void HostInfoCache::reset(void)
+{
+	// The instances are only emptied because callers may still hold
+	// the references. They are loaded again on the next use.
+	Impl::instancesLock.readLock();
+	ServerHostInfoCacheMapIterator it = Impl::instances.begin();
+	for (; it != Impl::instances.end(); ++it)
+		it->second->m_impl->clear();
+	Impl::instancesLock.unlock();
 }
 
 // ---------------------------------------------------------------------------
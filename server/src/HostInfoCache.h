@@ -24,8 +24,18 @@
 #include "DBTablesMonitoring.h"
 
 /**
- * Currently This class has only the ID and the name. In addition,
- * Hosts with the same serverId can be cached for an instance.
+ * A dictionary of host IDs, names and validity of a monitoring server.
+ *
+ * Readers look up an immutable snapshot that is swapped on each update
+ * (copy-on-write). So lookups never wait for a writer except for the
+ * short time to take a reference of the current snapshot.
+ *
+ * An instance for each monitoring server is shared in the process via
+ * getInstance(). DBTablesMonitoring updates it whenever hosts are
+ * written. So it can be used as the authoritative name resolver.
+ * Looking up a shared instance doesn't wait for the load or the update
+ * of the other servers. An instance made by the constructor is
+ * independent of them.
  */
 class HostInfoCache {
 public:
@@ -33,6 +43,13 @@ public:
 	virtual ~HostInfoCache();
 	void update(const HostInfo &hostInfo);
 
+	/**
+	 * Update multiple hosts with a single snapshot swap.
+	 *
+	 * @param hostInfoList Hosts to be added or updated.
+	 */
+	void update(const HostInfoList &hostInfoList);
+
 	/**
 	 * Get the name corresponding to the specified host ID.
 	 *
@@ -43,7 +60,55 @@ public:
 	 */
 	bool getName(const HostIdType &id, std::string &name) const;
 
+	/**
+	 * Get the ID corresponding to the specified host name.
+	 *
+	 * @param name A target host name.
+	 * @param id The obtained ID is store in this paramter.
+	 *
+	 * @return true if the host is found, or false.
+	 */
+	bool getId(const std::string &name, HostIdType &id) const;
+
+	size_t getNumberOfHosts(void) const;
+
+	/**
+	 * Get all hosts in the cache with their validity. The shared
+	 * instances also have the hosts that have been deleted.
+	 *
+	 * @param hostInfoList The hosts are appended to this parameter.
+	 */
+	void getHostInfoList(HostInfoList &hostInfoList) const;
+
+	/**
+	 * Get the shared instance for the monitoring server.
+	 *
+	 * When the instance is created, it is filled with the hosts
+	 * (including invalid ones) stored in the DB.
+	 *
+	 * @param serverId A monitoring server ID.
+	 *
+	 * @return A reference of the instance. It is valid until the
+	 * process exits.
+	 */
+	static HostInfoCache &getInstance(const ServerIdType &serverId);
+
+	/**
+	 * Update the shared instances with hosts of any servers.
+	 *
+	 * @param hostInfoList Hosts to be added or updated.
+	 */
+	static void updateInstances(const HostInfoList &hostInfoList);
+
+	/**
+	 * Empty all shared instances. They are loaded from the DB again on
+	 * the next use. This is mainly for tests.
+	 */
+	static void reset(void);
+
 private:
+	HostInfoCache(const ServerIdType &serverId);
+
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
 };
@@ -21,6 +21,7 @@
 #include "StringUtils.h"
 #include "LabelUtils.h"
 #include "ThreadLocalDBCache.h"
+#include "MetricsRegistry.h"
 #include <Mutex.h>
 #include "SimpleSemaphore.h"
 #include "Reaper.h"
@@ -98,21 +99,33 @@ struct IncidentSender::Impl
 	SimpleSemaphore jobSemaphore;
 	size_t retryLimit;
 	unsigned int retryIntervalMSec;
+	// The sum of all senders
+	MetricGauge &queueLength;
 
 	Impl(IncidentSender &_sender)
 	: sender(_sender), runningJob(NULL), jobSemaphore(0),
 	  retryLimit(DEFAULT_RETRY_LIMIT),
-	  retryIntervalMSec(DEFAULT_RETRY_INTERVAL_MSEC)
+	  retryIntervalMSec(DEFAULT_RETRY_INTERVAL_MSEC),
+	  queueLength(MetricsRegistry::getInstance()->getGauge(
+	    "hatohol_incident_sender_queue_length",
+	    "The number of incidents waiting to be sent"))
 	{
 	}
  
 	~Impl()
+	{
+		dropJobs();
+	}
+
+	// The gauge is shared by all senders. So the jobs left in the queue
+	// of a destroyed sender must be subtracted from it.
+	void dropJobs(void)
 	{
 		queueLock.lock();
+		queueLength.sub(queue.size());
 		while (!queue.empty()) {
-			Job *job = queue.front();
+			delete queue.front();
 			queue.pop();
-			delete job;
 		}
 		queueLock.unlock();
 	}
@@ -121,6 +134,7 @@ struct IncidentSender::Impl
 	{
 		queueLock.lock();
 		queue.push(job);
+		queueLength.add();
 		job->notifyStatus(JOB_QUEUED);
 		jobSemaphore.post();
 		queueLock.unlock();
@@ -133,6 +147,7 @@ struct IncidentSender::Impl
 		if (!queue.empty()) {
 			job = queue.front();
 			queue.pop();
+			queueLength.sub();
 		}
 		runningJob = job;
 		job->notifyStatus(JOB_STARTED);
@@ -184,6 +199,7 @@ IncidentSender::IncidentSender(const IncidentTrackerInfo &tracker)
 IncidentSender::~IncidentSender()
 {
 	exitSync();
+	m_impl->dropJobs();
 }
 
 void IncidentSender::waitExit(void)
@@ -0,0 +1,731 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <Logger.h>
+#include <SmartBuffer.h>
+#include <SmartTime.h>
+#include "IngestionJournal.h"
+#include "MonitoringDataCodec.h"
+#include "MetricsRegistry.h"
+using namespace std;
+using namespace mlpl;
+
+// ---------------------------------------------------------------------------
+// File format
+// ---------------------------------------------------------------------------
+static const uint32_t JOURNAL_MAGIC = 0x4c4e4a48; // "HJNL"
+static const uint32_t JOURNAL_VERSION = 1;
+static const uint32_t RECORD_MAGIC = 0x43455248; // "HREC"
+static const size_t HEADER_SIZE = 4096;
+static const size_t RECORD_ALIGNMENT = 8;
+static const size_t MAX_RECORDS_PER_APPLY = 1000;
+static const size_t RETRY_INTERVAL_MSEC = 1000;
+
+const size_t IngestionJournal::MIN_SIZE = HEADER_SIZE * 4;
+const size_t IngestionJournal::DEFAULT_MAX_RETRIES = 60;
+
+enum RecordType {
+	RECORD_TRIGGERS = 1,
+	RECORD_EVENTS,
+	RECORD_ITEMS,
+};
+
+// At the top of the file
+struct JournalHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size;
+	uint64_t appliedOffset;
+	uint64_t appliedSequence;
+};
+
+// Followed by the body of 'length' bytes
+struct RecordHeader {
+	uint32_t magic;
+	uint32_t type;
+	uint32_t length;
+	uint32_t checksum;
+	uint64_t sequence;
+	uint64_t appendTimeUSec;
+};
+
+struct Crc32Table {
+	uint32_t values[256];
+
+	Crc32Table(void)
+	{
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t crc = i;
+			for (int j = 0; j < 8; j++)
+				crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+			values[i] = crc;
+		}
+	}
+};
+
+static const Crc32Table crc32Table;
+
+static uint32_t updateCrc32(uint32_t crc, const void *data, const size_t &size)
+{
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = crc32Table.values[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static uint32_t computeChecksum(const RecordHeader &header, const void *body)
+{
+	RecordHeader headerWithoutChecksum = header;
+	headerWithoutChecksum.checksum = 0;
+	const uint32_t crc = updateCrc32(0, &headerWithoutChecksum,
+	                                 sizeof(headerWithoutChecksum));
+	return updateCrc32(crc, body, header.length);
+}
+
+static size_t getRecordSize(const size_t &length)
+{
+	const size_t alignedLength =
+	  (length + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+	return sizeof(RecordHeader) + alignedLength;
+}
+
+static uint64_t getCurrTimeUSec(void)
+{
+	const SmartTime now(SmartTime::INIT_CURR_TIME);
+	const timespec &ts = now.getAsTimespec();
+	return (uint64_t)ts.tv_sec * 1000 * 1000 + ts.tv_nsec / 1000;
+}
+
+// ---------------------------------------------------------------------------
+// Private context
+// ---------------------------------------------------------------------------
+struct IngestionJournal::Impl
+{
+	IngestionJournal &journal;
+	const string      path;
+	const size_t      size;
+	Applier          &applier;
+	const size_t      maxRetries;
+	int               fd;
+	uint8_t          *map;
+	size_t            mapSize;
+
+	// The followings are protected by 'mutex'.
+	pthread_mutex_t   mutex;
+	pthread_cond_t    appendedCond;
+	pthread_cond_t    appliedCond;
+	size_t            writeOffset;
+	uint64_t          writeSequence;
+	size_t            numPendingRecords;
+	// The end of the records at the tail of the file while the writer
+	// has returned to the top. It is 0 when the writer is behind them.
+	size_t            wrapOffset;
+
+	MetricGauge      &pendingRecordsGauge;
+	MetricGauge      &pendingBytesGauge;
+	MetricGauge      &lagGauge;
+	MetricHistogram  &applyDuration;
+
+	Impl(IngestionJournal &_journal, const string &_path,
+	     const size_t &_size, Applier &_applier,
+	     const size_t &_maxRetries)
+	: journal(_journal),
+	  path(_path),
+	  size(_size < MIN_SIZE ? MIN_SIZE : _size),
+	  applier(_applier),
+	  maxRetries(_maxRetries),
+	  fd(-1),
+	  map(NULL),
+	  mapSize(0),
+	  writeOffset(HEADER_SIZE),
+	  writeSequence(0),
+	  numPendingRecords(0),
+	  wrapOffset(0),
+	  pendingRecordsGauge(MetricsRegistry::getInstance()->getGauge(
+	    "hatohol_ingestion_journal_pending_records",
+	    "The number of the journal records that aren't stored "
+	    "in the DB yet")),
+	  pendingBytesGauge(MetricsRegistry::getInstance()->getGauge(
+	    "hatohol_ingestion_journal_pending_bytes",
+	    "The size of the journal records that aren't stored "
+	    "in the DB yet")),
+	  lagGauge(MetricsRegistry::getInstance()->getGauge(
+	    "hatohol_ingestion_journal_lag_milliseconds",
+	    "The time from the append of the journal record being "
+	    "stored in the DB")),
+	  applyDuration(MetricsRegistry::getInstance()->getHistogram(
+	    "hatohol_ingestion_journal_apply_seconds",
+	    "The time to store the journal records in the DB",
+	    MetricsRegistry::UNIT_MICRO_SEC))
+	{
+		pthread_mutex_init(&mutex, NULL);
+		pthread_cond_init(&appendedCond, NULL);
+		pthread_cond_init(&appliedCond, NULL);
+	}
+
+	virtual ~Impl()
+	{
+		unmap();
+		if (fd >= 0)
+			close(fd);
+		pthread_cond_destroy(&appliedCond);
+		pthread_cond_destroy(&appendedCond);
+		pthread_mutex_destroy(&mutex);
+	}
+
+	JournalHeader &getHeader(void)
+	{
+		return *reinterpret_cast<JournalHeader *>(map);
+	}
+
+	bool isRunning(void) const
+	{
+		return journal.isStarted() && !journal.isExitRequested();
+	}
+
+	bool mapFile(const size_t &newSize, const bool &truncate)
+	{
+		if (truncate && ftruncate(fd, newSize) != 0) {
+			MLPL_ERR("Failed to resize %s: %s\n",
+			         path.c_str(), strerror(errno));
+			return false;
+		}
+		void *addr = mmap(NULL, newSize, PROT_READ | PROT_WRITE,
+		                  MAP_SHARED, fd, 0);
+		if (addr == MAP_FAILED) {
+			MLPL_ERR("Failed to map %s: %s\n",
+			         path.c_str(), strerror(errno));
+			return false;
+		}
+		map = static_cast<uint8_t *>(addr);
+		mapSize = newSize;
+		return true;
+	}
+
+	void unmap(void)
+	{
+		if (!map)
+			return;
+		msync(map, mapSize, MS_SYNC);
+		munmap(map, mapSize);
+		map = NULL;
+		mapSize = 0;
+	}
+
+	void initHeader(void)
+	{
+		JournalHeader &header = getHeader();
+		header.magic = JOURNAL_MAGIC;
+		header.version = JOURNAL_VERSION;
+		header.size = mapSize;
+		header.appliedOffset = HEADER_SIZE;
+		header.appliedSequence = 0;
+		msync(map, HEADER_SIZE, MS_SYNC);
+	}
+
+	bool readRecordHeader(const size_t &offset, const uint64_t &sequence,
+	                      RecordHeader &recordHeader)
+	{
+		if (offset + sizeof(RecordHeader) > mapSize)
+			return false;
+		memcpy(&recordHeader, map + offset, sizeof(RecordHeader));
+		if (recordHeader.magic != RECORD_MAGIC)
+			return false;
+		if (recordHeader.sequence != sequence)
+			return false;
+		if (offset + getRecordSize(recordHeader.length) > mapSize)
+			return false;
+		const void *body = map + offset + sizeof(RecordHeader);
+		return recordHeader.checksum ==
+		       computeChecksum(recordHeader, body);
+	}
+
+	// Find the records that haven't been applied. The next record is
+	// at the top of the file when the writer has returned there.
+	void recover(void)
+	{
+		const JournalHeader &header = getHeader();
+		size_t offset = header.appliedOffset;
+		uint64_t sequence = header.appliedSequence + 1;
+		size_t numRecords = 0;
+		RecordHeader recordHeader;
+		wrapOffset = 0;
+		while (true) {
+			if (!readRecordHeader(offset, sequence, recordHeader)) {
+				if (wrapOffset || offset == HEADER_SIZE ||
+				    !readRecordHeader(HEADER_SIZE, sequence,
+				                      recordHeader))
+					break;
+				wrapOffset = offset;
+				offset = HEADER_SIZE;
+			}
+			offset += getRecordSize(recordHeader.length);
+			sequence++;
+			numRecords++;
+		}
+		writeOffset = offset;
+		writeSequence = sequence - 1;
+		numPendingRecords = numRecords;
+		if (numRecords > 0) {
+			MLPL_INFO("Found %zd records to be applied in %s\n",
+			          numRecords, path.c_str());
+		}
+		updatePendingGauges();
+	}
+
+	void updatePendingGauges(void)
+	{
+		const size_t appliedOffset = getHeader().appliedOffset;
+		size_t pendingBytes = 0;
+		if (wrapOffset)
+			pendingBytes = wrapOffset - appliedOffset +
+			               writeOffset - HEADER_SIZE;
+		else if (numPendingRecords > 0)
+			pendingBytes = writeOffset - appliedOffset;
+		pendingRecordsGauge.set(numPendingRecords);
+		pendingBytesGauge.set(pendingBytes);
+	}
+
+	// Move writeOffset to the top of the file if the record doesn't fit
+	// in the rest of it. Returns false if the record would overwrite
+	// the pending ones.
+	bool reserve(const size_t &recordSize)
+	{
+		if (numPendingRecords == 0) {
+			if (writeOffset + recordSize > mapSize) {
+				writeOffset = HEADER_SIZE;
+				getHeader().appliedOffset = HEADER_SIZE;
+				wrapOffset = 0;
+			}
+			return true;
+		}
+		const size_t appliedOffset = getHeader().appliedOffset;
+		if (wrapOffset)
+			return writeOffset + recordSize <= appliedOffset;
+		if (writeOffset + recordSize <= mapSize)
+			return true;
+		if (HEADER_SIZE + recordSize > appliedOffset)
+			return false;
+		wrapOffset = writeOffset;
+		writeOffset = HEADER_SIZE;
+		return true;
+	}
+
+	bool append(const RecordType &type, SmartBuffer &body)
+	{
+		const size_t length = body.index();
+		const size_t recordSize = getRecordSize(length);
+		if (recordSize > mapSize - HEADER_SIZE) {
+			MLPL_ERR("Too large record: %zd, journal: %zd\n",
+			         recordSize, mapSize);
+			return false;
+		}
+
+		pthread_mutex_lock(&mutex);
+		while (!reserve(recordSize)) {
+			if (!isRunning()) {
+				pthread_mutex_unlock(&mutex);
+				MLPL_ERR("The journal is full: %s\n",
+				         path.c_str());
+				return false;
+			}
+			pthread_cond_wait(&appliedCond, &mutex);
+		}
+
+		RecordHeader recordHeader;
+		recordHeader.magic = RECORD_MAGIC;
+		recordHeader.type = type;
+		recordHeader.length = length;
+		recordHeader.sequence = writeSequence + 1;
+		recordHeader.appendTimeUSec = getCurrTimeUSec();
+		const char *bodyData = static_cast<const char *>(body);
+		recordHeader.checksum = computeChecksum(recordHeader, bodyData);
+		memcpy(map + writeOffset + sizeof(RecordHeader),
+		       bodyData, length);
+		memcpy(map + writeOffset, &recordHeader, sizeof(RecordHeader));
+
+		writeOffset += recordSize;
+		writeSequence++;
+		numPendingRecords++;
+		updatePendingGauges();
+		pthread_cond_signal(&appendedCond);
+		pthread_mutex_unlock(&mutex);
+		return true;
+	}
+
+	// Returns false when the exit is requested.
+	bool waitForRecords(size_t &offset, uint64_t &sequence,
+	                    size_t &numRecords, size_t &endOfTail)
+	{
+		pthread_mutex_lock(&mutex);
+		while (numPendingRecords == 0 && !journal.isExitRequested())
+			pthread_cond_wait(&appendedCond, &mutex);
+		const JournalHeader &header = getHeader();
+		offset = header.appliedOffset;
+		sequence = header.appliedSequence + 1;
+		numRecords = numPendingRecords;
+		if (numRecords > MAX_RECORDS_PER_APPLY)
+			numRecords = MAX_RECORDS_PER_APPLY;
+		endOfTail = wrapOffset;
+		const bool exitRequested = journal.isExitRequested();
+		pthread_mutex_unlock(&mutex);
+		return !exitRequested;
+	}
+
+	template <typename LIST>
+	static bool decodeRecord(SmartBuffer &body, LIST &list)
+	{
+		LIST decodedList;
+		if (!MonitoringDataCodec::decodeList(body, decodedList))
+			return false;
+		list.splice(list.end(), decodedList);
+		return true;
+	}
+
+	// The records following the one ending at 'endOfTail' are at the top
+	// of the file. The reading stops at a broken record. The record that
+	// can't be decoded is moved to the dead letter file. The offset
+	// following the last read record is returned.
+	size_t readRecords(size_t offset, const uint64_t &firstSequence,
+	                   const size_t &numRecords, const size_t &endOfTail,
+	                   size_t &numRead, TriggerInfoList &triggerList,
+	                   EventInfoList &eventList, ItemInfoList &itemList)
+	{
+		for (numRead = 0; numRead < numRecords; numRead++) {
+			const size_t i = numRead;
+			if (offset == endOfTail)
+				offset = HEADER_SIZE;
+			RecordHeader recordHeader;
+			if (!readRecordHeader(offset, firstSequence + i,
+			                      recordHeader)) {
+				MLPL_BUG("Broken record: %" PRIu64 "\n",
+				         firstSequence + i);
+				break;
+			}
+			if (i == 0) {
+				lagGauge.set((getCurrTimeUSec() -
+				  recordHeader.appendTimeUSec) / 1000);
+			}
+			SmartBuffer body(recordHeader.length);
+			memcpy(static_cast<char *>(body),
+			       map + offset + sizeof(RecordHeader),
+			       recordHeader.length);
+			bool succeeded = false;
+			switch (recordHeader.type) {
+			case RECORD_TRIGGERS:
+				succeeded = decodeRecord(body, triggerList);
+				break;
+			case RECORD_EVENTS:
+				succeeded = decodeRecord(body, eventList);
+				break;
+			case RECORD_ITEMS:
+				succeeded = decodeRecord(body, itemList);
+				break;
+			}
+			const size_t nextOffset =
+			  offset + getRecordSize(recordHeader.length);
+			if (!succeeded) {
+				MLPL_ERR("Failed to decode a record: %" PRIu64
+				         ", type: %" PRIu32 "\n",
+				         recordHeader.sequence,
+				         recordHeader.type);
+				saveDeadRecords(offset, nextOffset, 1);
+			}
+			offset = nextOffset;
+		}
+		return offset;
+	}
+
+	void setApplied(const size_t &offset, const uint64_t &lastSequence,
+	                const size_t &numRecords)
+	{
+		pthread_mutex_lock(&mutex);
+		JournalHeader &header = getHeader();
+		numPendingRecords -= numRecords;
+		// The reader has followed the writer to the top.
+		if (offset < header.appliedOffset || numPendingRecords == 0)
+			wrapOffset = 0;
+		header.appliedOffset = offset;
+		header.appliedSequence = lastSequence;
+		if (numPendingRecords == 0)
+			lagGauge.set(0);
+		updatePendingGauges();
+		pthread_cond_broadcast(&appliedCond);
+		pthread_mutex_unlock(&mutex);
+		msync(map, HEADER_SIZE, MS_ASYNC);
+	}
+
+	bool writeDeadRecords(const int &deadFd, const size_t &offset,
+	                      const size_t &endOffset)
+	{
+		const size_t length = endOffset - offset;
+		return write(deadFd, map + offset, length) == (ssize_t)length;
+	}
+
+	// The records are appended as they are so that they can be read
+	// in the same way as the journal. The range ends at the top part of
+	// the file when 'endOffset' is not after 'offset'.
+	void saveDeadRecords(const size_t &offset, const size_t &endOffset,
+	                     const size_t &numRecords)
+	{
+		const string deadPath = path + ".dead";
+		MLPL_ERR("Moved %zd records to %s\n",
+		         numRecords, deadPath.c_str());
+		const int deadFd =
+		  ::open(deadPath.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0600);
+		if (deadFd < 0) {
+			MLPL_ERR("Failed to open %s: %s\n",
+			         deadPath.c_str(), strerror(errno));
+			return;
+		}
+		bool succeeded;
+		if (offset < endOffset) {
+			succeeded = writeDeadRecords(deadFd, offset, endOffset);
+		} else {
+			pthread_mutex_lock(&mutex);
+			const size_t endOfTail = wrapOffset;
+			pthread_mutex_unlock(&mutex);
+			succeeded =
+			  (endOfTail <= offset ||
+			   writeDeadRecords(deadFd, offset, endOfTail)) &&
+			  writeDeadRecords(deadFd, HEADER_SIZE, endOffset);
+		}
+		if (!succeeded) {
+			MLPL_ERR("Failed to write %s: %s\n",
+			         deadPath.c_str(), strerror(errno));
+		}
+		close(deadFd);
+	}
+
+	// The records following a broken one can't be found. So all pending
+	// records from it are skipped.
+	void skipBrokenRecords(const size_t &offset)
+	{
+		pthread_mutex_lock(&mutex);
+		const size_t endOffset = writeOffset;
+		const uint64_t lastSequence = writeSequence;
+		const size_t numRecords = numPendingRecords;
+		pthread_mutex_unlock(&mutex);
+		if (numRecords == 0)
+			return;
+		saveDeadRecords(offset, endOffset, numRecords);
+		setApplied(endOffset, lastSequence, numRecords);
+	}
+
+	// Returns false if the exit is requested during the wait.
+	bool waitForRetry(void)
+	{
+		for (size_t t = 0; t < RETRY_INTERVAL_MSEC / 100; t++) {
+			if (journal.isExitRequested())
+				return false;
+			usleep(100 * 1000);
+		}
+		return !journal.isExitRequested();
+	}
+
+	// Only the commit is retried so that the data are prepared once.
+	// Returns false if the data aren't stored after the retries or
+	// the exit is requested.
+	bool apply(const TriggerInfoList &triggerList,
+	           const EventInfoList &eventList,
+	           const ItemInfoList &itemList)
+	{
+		bool prepared = false;
+		for (size_t numRetries = 0; ; numRetries++) {
+			try {
+				MetricTimer timer(applyDuration);
+				if (!prepared) {
+					applier.prepare(triggerList, eventList,
+					                itemList);
+					prepared = true;
+				}
+				applier.commit();
+				return true;
+			} catch (const exception &e) {
+				MLPL_ERR("Failed to apply the journal records: "
+				         "%s\n", e.what());
+			}
+			if (numRetries >= maxRetries || !waitForRetry())
+				break;
+		}
+		if (prepared)
+			applier.discard();
+		return false;
+	}
+
+	void wakeUpAll(void)
+	{
+		pthread_mutex_lock(&mutex);
+		pthread_cond_broadcast(&appendedCond);
+		pthread_cond_broadcast(&appliedCond);
+		pthread_mutex_unlock(&mutex);
+	}
+};
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+IngestionJournal::Applier::~Applier()
+{
+}
+
+IngestionJournal::IngestionJournal(const string &path, const size_t &size,
+                                   Applier &applier,
+                                   const size_t &maxRetries)
+: m_impl(new Impl(*this, path, size, applier, maxRetries))
+{
+}
+
+IngestionJournal::~IngestionJournal()
+{
+	exitSync();
+}
+
+bool IngestionJournal::open(void)
+{
+	const string &path = m_impl->path;
+	m_impl->fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0600);
+	if (m_impl->fd < 0) {
+		MLPL_ERR("Failed to open %s: %s\n",
+		         path.c_str(), strerror(errno));
+		return false;
+	}
+
+	// Use the existing journal as it is in case it has records.
+	struct stat st;
+	JournalHeader header;
+	bool valid = false;
+	if (fstat(m_impl->fd, &st) == 0 && (size_t)st.st_size >= MIN_SIZE &&
+	    pread(m_impl->fd, &header, sizeof(header), 0) == sizeof(header)) {
+		valid = header.magic == JOURNAL_MAGIC &&
+		        header.version == JOURNAL_VERSION &&
+		        header.size == (uint64_t)st.st_size;
+	}
+	if (!valid) {
+		if (!m_impl->mapFile(m_impl->size, true))
+			return false;
+		m_impl->initHeader();
+	} else if (!m_impl->mapFile(header.size, false)) {
+		return false;
+	}
+	m_impl->recover();
+
+	if (m_impl->numPendingRecords == 0 &&
+	    m_impl->mapSize != m_impl->size) {
+		m_impl->unmap();
+		if (!m_impl->mapFile(m_impl->size, true))
+			return false;
+		m_impl->initHeader();
+		m_impl->recover();
+	}
+	return true;
+}
+
+bool IngestionJournal::append(const TriggerInfoList &triggerList)
+{
+	SmartBuffer body;
+	MonitoringDataCodec::encodeList(body, triggerList);
+	return m_impl->append(RECORD_TRIGGERS, body);
+}
+
+bool IngestionJournal::append(const EventInfoList &eventList)
+{
+	SmartBuffer body;
+	MonitoringDataCodec::encodeList(body, eventList);
+	return m_impl->append(RECORD_EVENTS, body);
+}
+
+bool IngestionJournal::append(const ItemInfoList &itemList)
+{
+	SmartBuffer body;
+	MonitoringDataCodec::encodeList(body, itemList);
+	return m_impl->append(RECORD_ITEMS, body);
+}
+
+void IngestionJournal::sync(void)
+{
+	pthread_mutex_lock(&m_impl->mutex);
+	const uint64_t sequence = m_impl->writeSequence;
+	while (m_impl->isRunning() &&
+	       m_impl->getHeader().appliedSequence < sequence) {
+		pthread_cond_wait(&m_impl->appliedCond, &m_impl->mutex);
+	}
+	pthread_mutex_unlock(&m_impl->mutex);
+}
+
+size_t IngestionJournal::getNumberOfPendingRecords(void) const
+{
+	pthread_mutex_lock(&m_impl->mutex);
+	const size_t numRecords = m_impl->numPendingRecords;
+	pthread_mutex_unlock(&m_impl->mutex);
+	return numRecords;
+}
+
+void IngestionJournal::waitExit(void)
+{
+	m_impl->wakeUpAll();
+	HatoholThreadBase::waitExit();
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+gpointer IngestionJournal::mainThread(HatoholThreadArg *arg)
+{
+	MLPL_INFO("Start IngestionJournal thread: %s\n",
+	          m_impl->path.c_str());
+	size_t offset;
+	uint64_t sequence;
+	size_t numRecords;
+	size_t endOfTail;
+	while (m_impl->waitForRecords(offset, sequence, numRecords,
+	                              endOfTail)) {
+		TriggerInfoList triggerList;
+		EventInfoList eventList;
+		ItemInfoList itemList;
+		size_t numRead;
+		const size_t nextOffset = m_impl->readRecords(
+		  offset, sequence, numRecords, endOfTail, numRead,
+		  triggerList, eventList, itemList);
+		if (numRead > 0) {
+			if (!m_impl->apply(triggerList, eventList, itemList)) {
+				// They are applied at the next start.
+				if (isExitRequested())
+					break;
+				m_impl->saveDeadRecords(offset, nextOffset,
+				                        numRead);
+			}
+			m_impl->setApplied(nextOffset, sequence + numRead - 1,
+			                   numRead);
+		}
+		if (numRead < numRecords)
+			m_impl->skipBrokenRecords(nextOffset);
+	}
+	MLPL_INFO("Exited IngestionJournal thread: %s\n",
+	          m_impl->path.c_str());
+	return NULL;
+}
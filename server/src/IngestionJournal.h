@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IngestionJournal_h
+#define IngestionJournal_h
+
+#include <string>
+#include <memory>
+#include "Monitoring.h"
+#include "HatoholThreadBase.h"
+
+/**
+ * A write-ahead log of the monitoring data received by the arms.
+ *
+ * The arms append the triggers, events and items to a memory-mapped
+ * file and return without waiting for the DB. The thread of this class
+ * passes them to the Applier in the order of appending. The triggers,
+ * events and items of the records appended while the previous ones were
+ * being applied are merged and passed at once.
+ *
+ * The file is used as a ring. A record that doesn't fit in the rest of
+ * the file is written at the top if the pending records aren't there.
+ * Each record has a sequence number and a checksum. The position of the last applied record is saved in the
+ * header of the file. So the records that hadn't been applied when the
+ * process died are found and applied after open().
+ *
+ * The records that can't be applied after the retries and the broken
+ * ones are appended to the dead letter file, i.e., the path of the
+ * journal followed by ".dead", in the same format and skipped.
+ */
+class IngestionJournal : public HatoholThreadBase {
+public:
+	/**
+	 * Receives the data from the journal in the thread of it.
+	 */
+	class Applier {
+	public:
+		virtual ~Applier();
+
+		/**
+		 * Prepare the data of the records applied at once. Any of
+		 * the lists may be empty. It is called again for the same
+		 * data only if it throws an exception.
+		 */
+		virtual void prepare(const TriggerInfoList &triggerList,
+		                     const EventInfoList &eventList,
+		                     const ItemInfoList &itemList) = 0;
+
+		/**
+		 * Store the prepared data. An exception thrown from the method
+		 * means they aren't stored. Then it is called again after
+		 * a while.
+		 */
+		virtual void commit(void) = 0;
+
+		/**
+		 * Discard the prepared data that aren't stored, because they
+		 * are moved to the dead letter file or the thread exits.
+		 */
+		virtual void discard(void) = 0;
+	};
+
+	static const size_t MIN_SIZE;
+	static const size_t DEFAULT_MAX_RETRIES;
+
+	/**
+	 * Constructor.
+	 *
+	 * @param path The path of the journal file.
+	 * @param size
+	 * The size of the journal file in bytes. The size of an existing
+	 * file is used if it has records that haven't been applied.
+	 * @param applier The applier of the data.
+	 * @param maxRetries
+	 * The number of the retries at intervals of a second before the
+	 * records are moved to the dead letter file.
+	 */
+	IngestionJournal(const std::string &path, const size_t &size,
+	                 Applier &applier,
+	                 const size_t &maxRetries = DEFAULT_MAX_RETRIES);
+	virtual ~IngestionJournal();
+
+	/**
+	 * Map the journal file and find the records that haven't been
+	 * applied. They are applied after the thread is started.
+	 *
+	 * @return true on success. Otherwise false.
+	 */
+	bool open(void);
+
+	/**
+	 * Append data. If the journal is full, it waits until all records
+	 * are applied.
+	 *
+	 * @param list A list of the data.
+	 * @return
+	 * true on success. false if the list is larger than the journal.
+	 * Then the caller should apply it by itself after sync().
+	 */
+	bool append(const TriggerInfoList &triggerList);
+	bool append(const EventInfoList &eventList);
+	bool append(const ItemInfoList &itemList);
+
+	/**
+	 * Wait until the records appended before the call are applied.
+	 * It returns immediately if the thread isn't running.
+	 */
+	void sync(void);
+
+	size_t getNumberOfPendingRecords(void) const;
+
+	virtual void waitExit(void) override;
+
+protected:
+	virtual gpointer mainThread(HatoholThreadArg *arg) override;
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // IngestionJournal_h
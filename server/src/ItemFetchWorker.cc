@@ -24,6 +24,7 @@
 #include <SmartTime.h>
 #include "ItemFetchWorker.h"
 #include "UnifiedDataStore.h"
+#include "MetricsRegistry.h"
 
 using namespace std;
 using namespace mlpl;
@@ -39,9 +40,14 @@ struct ItemFetchWorker::Impl
 	SmartTime       nextAllowedUpdateTime;
 	sem_t           updatedSemaphore;
 	Signal0         itemFetchedSignal;
+	MetricGauge    &remainingFetchersGauge;
 
 	Impl(void)
-	: remainingFetchersCount(0)
+	: remainingFetchersCount(0),
+	  remainingFetchersGauge(MetricsRegistry::getInstance()->getGauge(
+	    "hatohol_item_fetch_remaining_fetchers",
+	    "The number of data stores that haven't finished "
+	    "the on-demand item fetch"))
 	{
 		sem_init(&updatedSemaphore, 0, 0);
 	}
@@ -102,6 +108,7 @@ bool ItemFetchWorker::start(
 	}
 
 	bool started = m_impl->remainingFetchersCount > 0;
+	m_impl->remainingFetchersGauge.set(m_impl->remainingFetchersCount);
 	m_impl->rwlock.unlock();
 
 	return started;
@@ -140,9 +147,12 @@ void ItemFetchWorker::updatedCallback(Closure0 *closure)
 	}
 
 	m_impl->remainingFetchersCount--;
+	m_impl->remainingFetchersGauge.set(m_impl->remainingFetchersCount);
 	if (m_impl->remainingFetchersCount > 0)
 		return;
 
+	// The waiters read the items from the DB.
+	UnifiedDataStore::getInstance()->waitForIngestion();
 	if (sem_post(&m_impl->updatedSemaphore) == -1)
 		MLPL_ERR("Failed to call sem_post: %d\n", errno);
 	m_impl->nextAllowedUpdateTime.setCurrTime();
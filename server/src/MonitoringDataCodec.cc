@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MonitoringDataCodec.h"
+using namespace std;
+using namespace mlpl;
+
+static void addString(SmartBuffer &buf, const string &str)
+{
+	buf.addEx32(str.size());
+	buf.addEx(str.c_str(), str.size());
+}
+
+static bool getString(SmartBuffer &buf, string &str)
+{
+	if (buf.remainingSize() < sizeof(uint32_t))
+		return false;
+	const uint32_t length = buf.getValueAndIncIndex<uint32_t>();
+	if (buf.remainingSize() < length)
+		return false;
+	str.assign(buf.getPointer<char>(), length);
+	buf.incIndex(length);
+	return true;
+}
+
+static void addTimespec(SmartBuffer &buf, const timespec &ts)
+{
+	buf.addEx64(ts.tv_sec);
+	buf.addEx64(ts.tv_nsec);
+}
+
+static void getTimespec(SmartBuffer &buf, timespec &ts)
+{
+	ts.tv_sec = buf.getValueAndIncIndex<uint64_t>();
+	ts.tv_nsec = buf.getValueAndIncIndex<uint64_t>();
+}
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+void MonitoringDataCodec::encode(SmartBuffer &buf,
+                                 const TriggerInfo &triggerInfo)
+{
+	buf.addEx32(triggerInfo.serverId);
+	buf.addEx64(triggerInfo.id);
+	buf.addEx32(triggerInfo.status);
+	buf.addEx32(triggerInfo.severity);
+	addTimespec(buf, triggerInfo.lastChangeTime);
+	buf.addEx64(triggerInfo.hostId);
+	addString(buf, triggerInfo.hostName);
+	addString(buf, triggerInfo.brief);
+}
+
+void MonitoringDataCodec::encode(SmartBuffer &buf, const EventInfo &eventInfo)
+{
+	buf.addEx32(eventInfo.serverId);
+	buf.addEx64(eventInfo.id);
+	addTimespec(buf, eventInfo.time);
+	buf.addEx32(eventInfo.type);
+	buf.addEx64(eventInfo.triggerId);
+	buf.addEx32(eventInfo.status);
+	buf.addEx32(eventInfo.severity);
+	buf.addEx64(eventInfo.hostId);
+	addString(buf, eventInfo.hostName);
+	addString(buf, eventInfo.brief);
+}
+
+void MonitoringDataCodec::encode(SmartBuffer &buf, const ItemInfo &itemInfo)
+{
+	buf.addEx32(itemInfo.serverId);
+	buf.addEx64(itemInfo.id);
+	buf.addEx64(itemInfo.hostId);
+	addTimespec(buf, itemInfo.lastValueTime);
+	buf.addEx32(itemInfo.delay);
+	buf.addEx32(itemInfo.valueType);
+	addString(buf, itemInfo.brief);
+	addString(buf, itemInfo.lastValue);
+	addString(buf, itemInfo.prevValue);
+	addString(buf, itemInfo.itemGroupName);
+	addString(buf, itemInfo.unit);
+}
+
+bool MonitoringDataCodec::decode(SmartBuffer &buf, TriggerInfo &triggerInfo)
+{
+	static const size_t FIXED_SIZE =
+	  sizeof(uint32_t) * 3 + sizeof(uint64_t) * 4;
+	if (buf.remainingSize() < FIXED_SIZE)
+		return false;
+	triggerInfo.serverId = buf.getValueAndIncIndex<uint32_t>();
+	triggerInfo.id = buf.getValueAndIncIndex<uint64_t>();
+	triggerInfo.status = static_cast<TriggerStatusType>(
+	  buf.getValueAndIncIndex<uint32_t>());
+	triggerInfo.severity = static_cast<TriggerSeverityType>(
+	  buf.getValueAndIncIndex<uint32_t>());
+	getTimespec(buf, triggerInfo.lastChangeTime);
+	triggerInfo.hostId = buf.getValueAndIncIndex<uint64_t>();
+	if (!getString(buf, triggerInfo.hostName))
+		return false;
+	return getString(buf, triggerInfo.brief);
+}
+
+bool MonitoringDataCodec::decode(SmartBuffer &buf, EventInfo &eventInfo)
+{
+	static const size_t FIXED_SIZE =
+	  sizeof(uint32_t) * 4 + sizeof(uint64_t) * 5;
+	if (buf.remainingSize() < FIXED_SIZE)
+		return false;
+	initEventInfo(eventInfo);
+	eventInfo.serverId = buf.getValueAndIncIndex<uint32_t>();
+	eventInfo.id = buf.getValueAndIncIndex<uint64_t>();
+	getTimespec(buf, eventInfo.time);
+	eventInfo.type =
+	  static_cast<EventType>(buf.getValueAndIncIndex<uint32_t>());
+	eventInfo.triggerId = buf.getValueAndIncIndex<uint64_t>();
+	eventInfo.status = static_cast<TriggerStatusType>(
+	  buf.getValueAndIncIndex<uint32_t>());
+	eventInfo.severity = static_cast<TriggerSeverityType>(
+	  buf.getValueAndIncIndex<uint32_t>());
+	eventInfo.hostId = buf.getValueAndIncIndex<uint64_t>();
+	if (!getString(buf, eventInfo.hostName))
+		return false;
+	return getString(buf, eventInfo.brief);
+}
+
+bool MonitoringDataCodec::decode(SmartBuffer &buf, ItemInfo &itemInfo)
+{
+	static const size_t FIXED_SIZE =
+	  sizeof(uint32_t) * 3 + sizeof(uint64_t) * 4;
+	if (buf.remainingSize() < FIXED_SIZE)
+		return false;
+	itemInfo.serverId = buf.getValueAndIncIndex<uint32_t>();
+	itemInfo.id = buf.getValueAndIncIndex<uint64_t>();
+	itemInfo.hostId = buf.getValueAndIncIndex<uint64_t>();
+	getTimespec(buf, itemInfo.lastValueTime);
+	itemInfo.delay = buf.getValueAndIncIndex<uint32_t>();
+	itemInfo.valueType = static_cast<ItemInfoValueType>(
+	  buf.getValueAndIncIndex<uint32_t>());
+	if (!getString(buf, itemInfo.brief))
+		return false;
+	if (!getString(buf, itemInfo.lastValue))
+		return false;
+	if (!getString(buf, itemInfo.prevValue))
+		return false;
+	if (!getString(buf, itemInfo.itemGroupName))
+		return false;
+	return getString(buf, itemInfo.unit);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MonitoringDataCodec_h
+#define MonitoringDataCodec_h
+
+#include <SmartBuffer.h>
+#include "Monitoring.h"
+
+/**
+ * Serializes the monitoring data for the files written by the server
+ * itself such as the event spool and the ingestion journal.
+ *
+ * The values are written in the host byte order, so the files can't be
+ * moved to a host of another architecture. The decode methods return
+ * false when the buffer is too short.
+ */
+class MonitoringDataCodec {
+public:
+	static void encode(mlpl::SmartBuffer &buf, const TriggerInfo &triggerInfo);
+	static void encode(mlpl::SmartBuffer &buf, const EventInfo &eventInfo);
+	static void encode(mlpl::SmartBuffer &buf, const ItemInfo &itemInfo);
+
+	static bool decode(mlpl::SmartBuffer &buf, TriggerInfo &triggerInfo);
+	static bool decode(mlpl::SmartBuffer &buf, EventInfo &eventInfo);
+	static bool decode(mlpl::SmartBuffer &buf, ItemInfo &itemInfo);
+
+	template <typename LIST>
+	static void encodeList(mlpl::SmartBuffer &buf, const LIST &list)
+	{
+		buf.addEx32(list.size());
+		typename LIST::const_iterator it = list.begin();
+		for (; it != list.end(); ++it)
+			encode(buf, *it);
+	}
+
+	template <typename LIST>
+	static bool decodeList(mlpl::SmartBuffer &buf, LIST &list)
+	{
+		if (buf.remainingSize() < sizeof(uint32_t))
+			return false;
+		const uint32_t numElements =
+		  buf.getValueAndIncIndex<uint32_t>();
+		for (uint32_t i = 0; i < numElements; i++) {
+			typename LIST::value_type element;
+			if (!decode(buf, element))
+				return false;
+			list.push_back(element);
+		}
+		return true;
+	}
+};
+
+#endif // MonitoringDataCodec_h
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <list>
+#include <cstdlib>
+#include <Logger.h>
+#include "NDOStreamParser.h"
+using namespace std;
+using namespace mlpl;
+
+typedef list<NDOStreamParser::Record> RecordList;
+
+// ---------------------------------------------------------------------------
+// NDOStreamParser::Record
+// ---------------------------------------------------------------------------
+NDOStreamParser::Record::Record(void)
+: type(0)
+{
+}
+
+bool NDOStreamParser::Record::has(const int &key) const
+{
+	return data.find(key) != data.end();
+}
+
+const string &NDOStreamParser::Record::get(const int &key) const
+{
+	static const string emptyString;
+	map<int, string>::const_iterator it = data.find(key);
+	if (it == data.end())
+		return emptyString;
+	return it->second;
+}
+
+int NDOStreamParser::Record::getInt(const int &key,
+                                    const int &defaultValue) const
+{
+	map<int, string>::const_iterator it = data.find(key);
+	if (it == data.end() || it->second.empty())
+		return defaultValue;
+	return atoi(it->second.c_str());
+}
+
+timespec NDOStreamParser::Record::getTimestamp(const int &key) const
+{
+	timespec ts;
+	ts.tv_sec = 0;
+	ts.tv_nsec = 0;
+	const string &value = get(key);
+	if (value.empty())
+		return ts;
+	char *end = NULL;
+	ts.tv_sec = strtol(value.c_str(), &end, 10);
+	if (*end == '.')
+		ts.tv_nsec = strtol(end + 1, NULL, 10) * 1000; // usec -> nsec
+	return ts;
+}
+
+// ---------------------------------------------------------------------------
+// NDOStreamParser::Impl
+// ---------------------------------------------------------------------------
+struct NDOStreamParser::Impl {
+	string     pendingLine;
+	bool       inRecord;
+	Record     currRecord;
+	RecordList records;
+
+	Impl(void)
+	: inRecord(false)
+	{
+	}
+
+	static bool isNumber(const string &str, const size_t &len)
+	{
+		if (len == 0)
+			return false;
+		for (size_t i = 0; i < len; i++) {
+			if (str[i] < '0' || str[i] > '9')
+				return false;
+		}
+		return true;
+	}
+
+	void parseLine(const string &line)
+	{
+		if (line.empty())
+			return;
+
+		if (!inRecord) {
+			// "<type>:" begins a record. Others such as the
+			// header and API_ENDDATADUMP are skipped.
+			const size_t len = line.size() - 1;
+			if (line[len] != ':' || !isNumber(line, len))
+				return;
+			currRecord = Record();
+			currRecord.type = atoi(line.c_str());
+			inRecord = true;
+			return;
+		}
+
+		if (isNumber(line, line.size()) &&
+		    atoi(line.c_str()) == API_ENDDATA) {
+			records.push_back(currRecord);
+			inRecord = false;
+			return;
+		}
+
+		const size_t posEq = line.find('=');
+		if (posEq == string::npos || !isNumber(line, posEq)) {
+			MLPL_WARN("Unexpected line in NDO stream: %s\n",
+			          line.c_str());
+			return;
+		}
+		const int key = atoi(line.c_str());
+		currRecord.data[key] = unescape(line.substr(posEq + 1));
+	}
+};
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+NDOStreamParser::NDOStreamParser(void)
+: m_impl(new Impl())
+{
+}
+
+NDOStreamParser::~NDOStreamParser()
+{
+}
+
+void NDOStreamParser::feed(const char *buf, const size_t &size)
+{
+	string &pendingLine = m_impl->pendingLine;
+	const char *lineHead = buf;
+	const char *tail = buf + size;
+	for (const char *ptr = buf; ptr < tail; ptr++) {
+		if (*ptr != '\n')
+			continue;
+		pendingLine.append(lineHead, ptr - lineHead);
+		m_impl->parseLine(pendingLine);
+		pendingLine.clear();
+		lineHead = ptr + 1;
+	}
+	pendingLine.append(lineHead, tail - lineHead);
+}
+
+bool NDOStreamParser::pop(Record &record)
+{
+	if (m_impl->records.empty())
+		return false;
+	record = m_impl->records.front();
+	m_impl->records.pop_front();
+	return true;
+}
+
+void NDOStreamParser::reset(void)
+{
+	m_impl->pendingLine.clear();
+	m_impl->inRecord = false;
+}
+
+string NDOStreamParser::unescape(const string &value)
+{
+	if (value.find('\\') == string::npos)
+		return value;
+	string decoded;
+	decoded.reserve(value.size());
+	for (size_t i = 0; i < value.size(); i++) {
+		const char c = value[i];
+		if (c != '\\' || i + 1 == value.size()) {
+			decoded += c;
+			continue;
+		}
+		const char next = value[++i];
+		if (next == 'n')
+			decoded += '\n';
+		else if (next == 'r')
+			decoded += '\r';
+		else if (next == 't')
+			decoded += '\t';
+		else
+			decoded += next;
+	}
+	return decoded;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef NDOStreamParser_h
+#define NDOStreamParser_h
+
+#include <time.h>
+#include <map>
+#include <string>
+#include <memory>
+#include "Params.h"
+
+/**
+ * An incremental parser of the output of NDOMOD, the event broker module
+ * of NDOUtils. NDOMOD writes it to a UNIX socket or a file and a record
+ * looks like the following.
+ *
+ *   223:
+ *   4=1401234567.123456
+ *   53=web01
+ *   114=HTTP
+ *   999
+ *
+ * The header, which begins with "HELLO", is skipped.
+ */
+class NDOStreamParser {
+public:
+	// Record types (NDO_API_*) and data keys (NDO_DATA_*) used in
+	// Hatohol. The values are those in include/protoapi.h of NDOUtils.
+	static const int API_STATECHANGEDATA = 223;
+	static const int API_ENDDATA         = 999;
+	static const int API_ENDDATADUMP     = 1000;
+
+	static const int DATA_TYPE           = 1;
+	static const int DATA_TIMESTAMP      = 4;
+	static const int DATA_HOST           = 53;
+	static const int DATA_OUTPUT         = 95;
+	static const int DATA_SERVICE        = 114;
+	static const int DATA_STATE          = 118;
+	static const int DATA_STATETYPE      = 121;
+
+	// The value of DATA_TYPE in a record of API_STATECHANGEDATA
+	// (NEBTYPE_STATECHANGE_END in nagios/include/nebstructs.h).
+	static const int NEBTYPE_STATECHANGE_END = 1801;
+
+	struct Record {
+		int                        type;
+		std::map<int, std::string> data;
+
+		Record(void);
+		bool has(const int &key) const;
+		const std::string &get(const int &key) const;
+		int getInt(const int &key, const int &defaultValue = 0) const;
+
+		/**
+		 * Get the value in the form of "<sec>.<usec>" as timespec.
+		 */
+		timespec getTimestamp(const int &key) const;
+	};
+
+	NDOStreamParser(void);
+	virtual ~NDOStreamParser();
+
+	/**
+	 * Parse a chunk of the stream. It may end in the middle of a line.
+	 */
+	void feed(const char *buf, const size_t &size);
+
+	/**
+	 * Take the oldest record that has been completed.
+	 *
+	 * @return true if a record is taken, otherwise false.
+	 */
+	bool pop(Record &record);
+
+	/**
+	 * Discard the partial input. This should be called when the source
+	 * of the stream is reconnected.
+	 */
+	void reset(void);
+
+	/**
+	 * Decode "\\", "\\n", "\\r" and "\\t" that NDOMOD uses to
+	 * escape a value.
+	 */
+	static std::string unescape(const std::string &value);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // NDOStreamParser_h
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <Logger.h>
+#include "NDOStreamReceiver.h"
+#include "HatoholException.h"
+using namespace std;
+using namespace mlpl;
+
+// The exit request is checked at this interval.
+static const int POLL_TIMEOUT_MSEC = 500;
+static const int RETRY_INTERVAL_MSEC = 10 * 1000;
+static const size_t READ_BUFFER_SIZE = 4096;
+
+struct NDOStreamReceiver::Impl {
+	string          path;
+	RecordHandler   handler;
+	void           *data;
+	NDOStreamParser parser;
+	int             listenFd;
+	int             fd;
+
+	Impl(const string &_path, RecordHandler _handler, void *_data)
+	: path(_path),
+	  handler(_handler),
+	  data(_data),
+	  listenFd(-1),
+	  fd(-1)
+	{
+	}
+
+	virtual ~Impl()
+	{
+		closeAll();
+	}
+
+	void closeStream(void)
+	{
+		if (fd >= 0)
+			close(fd);
+		fd = -1;
+		parser.reset();
+	}
+
+	void closeAll(void)
+	{
+		closeStream();
+		if (listenFd >= 0) {
+			close(listenFd);
+			unlink(path.c_str());
+		}
+		listenFd = -1;
+	}
+
+	/**
+	 * Wait until fd becomes readable.
+	 *
+	 * @return true if it is readable, false on timeout.
+	 */
+	static bool waitReadable(const int &targetFd)
+	{
+		pollfd pfd;
+		pfd.fd = targetFd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		int ret = poll(&pfd, 1, POLL_TIMEOUT_MSEC);
+		if (ret < 0 && errno != EINTR) {
+			THROW_HATOHOL_EXCEPTION("Failed to poll: %s\n",
+			                        strerror(errno));
+		}
+		return ret > 0;
+	}
+
+	/**
+	 * Read the available data and pass completed records to the handler.
+	 *
+	 * @return The return value of read(2).
+	 */
+	ssize_t readAndDispatch(void)
+	{
+		char buf[READ_BUFFER_SIZE];
+		ssize_t size = read(fd, buf, sizeof(buf));
+		if (size <= 0)
+			return size;
+		parser.feed(buf, size);
+		NDOStreamParser::Record record;
+		while (parser.pop(record))
+			(*handler)(record, data);
+		return size;
+	}
+};
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+NDOStreamReceiver::NDOStreamReceiver(
+  const string &path, RecordHandler handler, void *data)
+: m_impl(new Impl(path, handler, data))
+{
+}
+
+NDOStreamReceiver::~NDOStreamReceiver()
+{
+	if (isStarted())
+		exitSync();
+}
+
+const string &NDOStreamReceiver::getPath(void) const
+{
+	return m_impl->path;
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+gpointer NDOStreamReceiver::mainThread(HatoholThreadArg *arg)
+{
+	// Resources may be left by the previous run that threw an exception.
+	m_impl->closeAll();
+
+	struct stat st;
+	const bool isFile =
+	  stat(m_impl->path.c_str(), &st) == 0 &&
+	  (S_ISREG(st.st_mode) || S_ISFIFO(st.st_mode));
+	MLPL_INFO("Start to receive NDO stream: %s (%s)\n",
+	          m_impl->path.c_str(), isFile ? "file" : "UNIX socket");
+	if (isFile)
+		tailFile();
+	else
+		serveSocket();
+	m_impl->closeAll();
+	return NULL;
+}
+
+int NDOStreamReceiver::onCaughtException(const exception &e)
+{
+	MLPL_ERR("NDO stream: %s: retry after %d ms.\n",
+	         m_impl->path.c_str(), RETRY_INTERVAL_MSEC);
+	return RETRY_INTERVAL_MSEC;
+}
+
+// ---------------------------------------------------------------------------
+// Private methods
+// ---------------------------------------------------------------------------
+void NDOStreamReceiver::tailFile(void)
+{
+	const char *path = m_impl->path.c_str();
+	ino_t inode = 0;
+	off_t offset = 0;
+	// Records written before we start are obtained by the DB poll.
+	bool skipExistingData = true;
+	while (!isExitRequested()) {
+		if (m_impl->fd < 0) {
+			m_impl->fd = open(path, O_RDONLY | O_NONBLOCK);
+			struct stat st;
+			if (m_impl->fd < 0 || fstat(m_impl->fd, &st) != 0) {
+				m_impl->closeStream();
+				usleep(POLL_TIMEOUT_MSEC * 1000);
+				continue;
+			}
+			inode = st.st_ino;
+			offset = 0;
+			if (skipExistingData && S_ISREG(st.st_mode))
+				offset = lseek(m_impl->fd, 0, SEEK_END);
+			skipExistingData = false;
+		}
+
+		const ssize_t size = m_impl->readAndDispatch();
+		if (size > 0) {
+			offset += size;
+			continue;
+		}
+		if (size < 0 && errno != EAGAIN && errno != EINTR) {
+			MLPL_ERR("Failed to read %s: %s\n",
+			         path, strerror(errno));
+			m_impl->closeStream();
+			continue;
+		}
+
+		// Reopen the file if it has been rotated or truncated.
+		struct stat st;
+		if (stat(path, &st) == 0 && S_ISREG(st.st_mode) &&
+		    (st.st_ino != inode || st.st_size < offset)) {
+			MLPL_INFO("NDO stream file has been rotated: %s\n",
+			          path);
+			m_impl->closeStream();
+			continue;
+		}
+		usleep(POLL_TIMEOUT_MSEC * 1000);
+	}
+}
+
+void NDOStreamReceiver::serveSocket(void)
+{
+	sockaddr_un addr;
+	if (m_impl->path.size() >= sizeof(addr.sun_path)) {
+		THROW_HATOHOL_EXCEPTION("Too long socket path: %s\n",
+		                        m_impl->path.c_str());
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, m_impl->path.c_str());
+
+	m_impl->listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_impl->listenFd < 0) {
+		THROW_HATOHOL_EXCEPTION("Failed to create a socket: %s\n",
+		                        strerror(errno));
+	}
+	unlink(addr.sun_path);
+	if (bind(m_impl->listenFd, (sockaddr *)&addr, sizeof(addr)) != 0 ||
+	    listen(m_impl->listenFd, 1) != 0) {
+		THROW_HATOHOL_EXCEPTION("Failed to listen %s: %s\n",
+		                        addr.sun_path, strerror(errno));
+	}
+
+	while (!isExitRequested()) {
+		if (m_impl->fd < 0) {
+			if (!Impl::waitReadable(m_impl->listenFd))
+				continue;
+			m_impl->fd = accept(m_impl->listenFd, NULL, NULL);
+			if (m_impl->fd < 0 && errno != EINTR) {
+				MLPL_ERR("Failed to accept: %s\n",
+				         strerror(errno));
+			}
+			continue;
+		}
+		if (!Impl::waitReadable(m_impl->fd))
+			continue;
+		const ssize_t size = m_impl->readAndDispatch();
+		if (size == 0 || (size < 0 && errno != EINTR)) {
+			// NDOMOD reconnects when Nagios is restarted.
+			MLPL_INFO("NDO stream has been closed: %s\n",
+			          addr.sun_path);
+			m_impl->closeStream();
+		}
+	}
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef NDOStreamReceiver_h
+#define NDOStreamReceiver_h
+
+#include <string>
+#include "HatoholThreadBase.h"
+#include "NDOStreamParser.h"
+
+/**
+ * A thread that reads the output of NDOMOD and passes each record to
+ * a handler.
+ *
+ * If the path is a regular file or a FIFO (NDOMOD's output_type=file),
+ * the data appended to it are read like 'tail -F'. Otherwise a UNIX
+ * socket is created at the path and NDOMOD with output_type=unixsocket
+ * is accepted.
+ */
+class NDOStreamReceiver : public HatoholThreadBase {
+public:
+	typedef void (*RecordHandler)(const NDOStreamParser::Record &record,
+	                              void *data);
+
+	NDOStreamReceiver(const std::string &path, RecordHandler handler,
+	                  void *data);
+	virtual ~NDOStreamReceiver();
+	const std::string &getPath(void) const;
+
+protected:
+	// virtual methods
+	virtual gpointer mainThread(HatoholThreadArg *arg) override;
+	virtual int onCaughtException(const std::exception &e) override;
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+
+	void tailFile(void);
+	void serveSocket(void);
+};
+
+#endif // NDOStreamReceiver_h
@@ -99,6 +99,31 @@ void ResidentCommunicator::setNotifyEventBody(
 {
 	setHeader(RESIDENT_PROTO_EVENT_BODY_LEN,
 	          RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT);
+	addNotifyEventBody(actionId, eventInfo, sessionId);
+}
+
+void ResidentCommunicator::setNotifyEventAck(uint32_t resultCode)
+{
+	setHeader(RESIDENT_PROTO_EVENT_ACK_CODE_LEN,
+	          RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_ACK);
+	m_impl->sbuf.add32(resultCode);
+}
+
+void ResidentCommunicator::setNotifyEventsHeader(size_t numEvents)
+{
+	HATOHOL_ASSERT(numEvents > 0 &&
+	               numEvents <= RESIDENT_PROTO_NOTIFY_EVENTS_MAX_NUM,
+	               "Invalid number of events: %zd\n", numEvents);
+	size_t bodyLen = RESIDENT_PROTO_NOTIFY_EVENTS_NUM_LEN +
+	                 RESIDENT_PROTO_EVENT_BODY_LEN * numEvents;
+	setHeader(bodyLen, RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENTS);
+	m_impl->sbuf.add32(numEvents);
+}
+
+void ResidentCommunicator::addNotifyEventBody(
+  const ActionIdType &actionId, const EventInfo &eventInfo,
+  const string &sessionId)
+{
 	m_impl->sbuf.add32(actionId);
 	m_impl->sbuf.add32(eventInfo.serverId);
 	m_impl->sbuf.add64(eventInfo.hostId);
@@ -112,9 +137,32 @@ void ResidentCommunicator::setNotifyEventBody(
 	m_impl->sbuf.add(sessionId.c_str(), HATOHOL_SESSION_ID_LEN);
 }
 
-void ResidentCommunicator::setNotifyEventAck(uint32_t resultCode)
+void ResidentCommunicator::setNotifyEventsAck(
+  const vector<uint32_t> &resultCodes)
 {
-	setHeader(RESIDENT_PROTO_EVENT_ACK_CODE_LEN,
-	          RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_ACK);
-	m_impl->sbuf.add32(resultCode);
+	const size_t numCodes = resultCodes.size();
+	setHeader(RESIDENT_PROTO_NOTIFY_EVENTS_NUM_LEN +
+	          RESIDENT_PROTO_EVENT_ACK_CODE_LEN * numCodes,
+	          RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENTS_ACK);
+	m_impl->sbuf.add32(numCodes);
+	for (size_t i = 0; i < numCodes; i++)
+		m_impl->sbuf.add32(resultCodes[i]);
+}
+
+void ResidentCommunicator::getNotifyEventArg(SmartBuffer &sbuf,
+                                             ResidentNotifyEventArg &arg)
+{
+	arg.actionId        = *sbuf.getPointerAndIncIndex<uint32_t>();
+	arg.serverId        = *sbuf.getPointerAndIncIndex<uint32_t>();
+	arg.hostId          = *sbuf.getPointerAndIncIndex<uint64_t>();
+	arg.time.tv_sec     = *sbuf.getPointerAndIncIndex<uint64_t>();
+	arg.time.tv_nsec    = *sbuf.getPointerAndIncIndex<uint32_t>();
+	arg.eventId         = *sbuf.getPointerAndIncIndex<uint64_t>();
+	arg.eventType       = *sbuf.getPointerAndIncIndex<uint16_t>();
+	arg.triggerId       = *sbuf.getPointerAndIncIndex<uint64_t>();
+	arg.triggerStatus   = *sbuf.getPointerAndIncIndex<uint16_t>();
+	arg.triggerSeverity = *sbuf.getPointerAndIncIndex<uint16_t>();
+	memcpy(arg.sessionId, sbuf.getPointer<char>(), HATOHOL_SESSION_ID_LEN);
+	arg.sessionId[HATOHOL_SESSION_ID_LEN] = '\0';  // NULL terminator
+	sbuf.incIndex(HATOHOL_SESSION_ID_LEN);
 }
@@ -22,6 +22,7 @@
 
 #include <cstdio>
 #include <string>
+#include <vector>
 #include "ResidentProtocol.h"
 #include "NamedPipe.h"
 #include "HatoholException.h"
@@ -50,6 +51,29 @@ public:
 	                        const std::string &sessionId);
 	void setNotifyEventAck(uint32_t resuletCode);
 
+	/**
+	 * Set the header and the number of events of a NOTIFY_EVENTS packet.
+	 *
+	 * addNotifyEventBody() should be called 'numEvents' times after
+	 * calling this function.
+	 *
+	 * @param numEvents The number of events in the packet.
+	 */
+	void setNotifyEventsHeader(size_t numEvents);
+	void addNotifyEventBody(const ActionIdType &actionId,
+	                        const EventInfo &eventInfo,
+	                        const std::string &sessionId);
+	void setNotifyEventsAck(const std::vector<uint32_t> &resultCodes);
+
+	/**
+	 * Parse an event body at the current index of sbuf.
+	 *
+	 * After calling this function, the index of sbuf is moved to the
+	 * next of the body.
+	 */
+	static void getNotifyEventArg(mlpl::SmartBuffer &sbuf,
+	                              ResidentNotifyEventArg &arg);
+
 private:
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
@@ -31,6 +31,8 @@ enum
 	RESIDENT_PROTO_PKT_TYPE_PARAMETERS,
 	RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT,
 	RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_ACK,
+	RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENTS,
+	RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENTS_ACK,
 };
 
 static const uint16_t HATOHOL_SESSION_ID_LEN = 36;
@@ -137,6 +139,28 @@ static const size_t RESIDENT_PROTO_EVENT_BODY_LEN =
 
 static const size_t RESIDENT_PROTO_EVENT_ACK_CODE_LEN = 4;
 
+// [Notify Events]
+// Direction: Master -> Slave
+// packet type: RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENTS
+// <Body>
+// Bytes: Description
+//    4U: The number of events (N).
+//     V: N event bodies. Each of them has the same layout as
+//        the body of [Notify Event].
+//
+// N must be between 1 and RESIDENT_PROTO_NOTIFY_EVENTS_MAX_NUM.
+
+static const size_t RESIDENT_PROTO_NOTIFY_EVENTS_NUM_LEN = 4;
+static const size_t RESIDENT_PROTO_NOTIFY_EVENTS_MAX_NUM = 100;
+
+// [Notify Events Ack]
+// Direction: Slave -> Master
+// packet type: RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENTS_ACK
+// <Body>
+// Bytes: Description
+//    4U: The number of result codes (N).
+//  4U*N: result codes in the same order as the received events.
+
 //
 // Module information
 //
@@ -144,7 +168,12 @@ static const size_t RESIDENT_PROTO_EVENT_ACK_CODE_LEN = 4;
 #define RESIDENT_MODULE_SYMBOL_STR "hatohol_resident_module"
 
 // 1 -> 2: Add sessionId
-static const uint16_t RESIDENT_MODULE_VERSION = 2;
+// 2 -> 3: Add notifyEvents
+static const uint16_t RESIDENT_MODULE_VERSION = 3;
+
+// The oldest module version that hatohol-resident-yard can load.
+// A module whose version is less than 3 doesn't have 'notifyEvents'.
+static const uint16_t RESIDENT_MODULE_MIN_VERSION = 2;
 
 struct ResidentNotifyEventArg {
 	uint32_t actionId;
@@ -163,6 +192,21 @@ struct ResidentModule {
 	uint16_t moduleVersion;
 	uint32_t (*init)(const char *arg);
 	uint32_t (*notifyEvent)(ResidentNotifyEventArg *arg);
+
+	/**
+	 * Notify the module of events at once. (moduleVersion >= 3)
+	 *
+	 * This member can be NULL. In that case, notifyEvent() is called
+	 * for each event.
+	 *
+	 * @param args    An array of the notified events.
+	 * @param numArgs The number of elements in 'args'.
+	 * @param resultCodes
+	 * An array with 'numArgs' elements. The module shall set the
+	 * result code of each event in it.
+	 */
+	void (*notifyEvents)(ResidentNotifyEventArg *args, uint32_t numArgs,
+	                     uint32_t *resultCodes);
 };
 
 enum {
@@ -19,7 +19,10 @@
 
 #include "RestResourceHost.h"
 #include "UnifiedDataStore.h"
+#include "HistoryCache.h"
 #include <string.h>
+#include <algorithm>
+#include <set>
 
 using namespace std;
 using namespace mlpl;
@@ -32,6 +35,8 @@ const char *RestResourceHost::pathForItem      = "/item";
 const char *RestResourceHost::pathForHistory   = "/history";
 const char *RestResourceHost::pathForHostgroup = "/hostgroup";
 
+const size_t RestResourceHost::MAX_HISTORY_ITEMS = 100;
+
 void RestResourceHost::registerFactories(FaceRest *faceRest)
 {
 	faceRest->addResourceHandlerFactory(
@@ -199,6 +204,12 @@ static HatoholError parseTriggerParameter(TriggersQueryOption &option,
 		return err;
 	option.setTriggerStatus(status);
 
+	// text search
+	const gchar *value = static_cast<const gchar*>(
+	  g_hash_table_lookup(query, "q"));
+	if (value && *value)
+		option.setTextQuery(value);
+
 	return HatoholError(HTERR_OK);
 }
 
@@ -262,6 +273,12 @@ HatoholError RestResourceHost::parseEventParameter(EventsQueryOption &option,
 		return err;
 	option.setLimitOfUnifiedId(limitOfUnifiedId);
 
+	// text search
+	const gchar *value = static_cast<const gchar*>(
+	  g_hash_table_lookup(query, "q"));
+	if (value && *value)
+		option.setTextQuery(value);
+
 	return HatoholError(HTERR_OK);
 }
 
@@ -292,6 +309,11 @@ static HatoholError parseItemParameter(ItemsQueryOption &option,
 	if (value && *value)
 		option.setTargetItemGroupName(value);
 
+	// text search
+	value = static_cast<const gchar*>(g_hash_table_lookup(query, "q"));
+	if (value && *value)
+		option.setTextQuery(value);
+
 	return HatoholError(HTERR_OK);
 }
 
@@ -630,6 +652,7 @@ void RestResourceHost::handlerGetEvent(void)
 		agent.add("severity",  eventInfo.severity);
 		agent.add("hostId",    StringUtils::toString(eventInfo.hostId));
 		agent.add("brief",     eventInfo.brief);
+		agent.add("correlation", eventInfo.correlation);
 		if (addIncidents)
 			addIncident(this, agent, incidentVect[i]);
 		agent.endObject();
@@ -731,12 +754,18 @@ void RestResourceHost::handlerGetItem(void)
 
 struct GetHistoryClosure : ClosureTemplate1<RestResourceHost, HistoryInfoVect>
 {
-	DataStorePtr m_dataStorePtr;
+	DataStorePtr                      m_dataStorePtr;
+	RestResourceHost::HistoryRequest  m_request;
+	time_t                            m_fetchBeginTime;
 
 	GetHistoryClosure(RestResourceHost *receiver,
-			  callback func, DataStorePtr dataStorePtr)
+			  callback func, DataStorePtr dataStorePtr,
+			  const RestResourceHost::HistoryRequest &request,
+			  const time_t &fetchBeginTime)
 	: ClosureTemplate1<RestResourceHost, HistoryInfoVect>(receiver, func),
-	  m_dataStorePtr(dataStorePtr)
+	  m_dataStorePtr(dataStorePtr),
+	  m_request(request),
+	  m_fetchBeginTime(fetchBeginTime)
 	{
 		m_receiver->ref();
 	}
@@ -747,9 +776,12 @@ struct GetHistoryClosure : ClosureTemplate1<RestResourceHost, HistoryInfoVect>
 	}
 };
 
+static HatoholError parseHistoryOptions(
+  GHashTable *query, RestResourceHost::HistoryRequest &request);
+
 static HatoholError parseHistoryParameter(
   GHashTable *query, ServerIdType &serverId, ItemIdType &itemId,
-  time_t &beginTime, time_t &endTime)
+  RestResourceHost::HistoryRequest &request)
 {
 	if (!query)
 		return HatoholError(HTERR_INVALID_PARAMETER);
@@ -778,31 +810,115 @@ static HatoholError parseHistoryParameter(
 				    "itemId: ALL_ITEMS");
 	}
 
+	return parseHistoryOptions(query, request);
+}
+
+static HatoholError parseHistoryOptions(
+  GHashTable *query, RestResourceHost::HistoryRequest &request)
+{
+	HatoholError err;
+
 	// beginTime
 	err = getParam<time_t>(query, "beginTime",
-			       "%ld", beginTime);
+			       "%ld", request.beginTime);
 	if (err != HTERR_OK && err != HTERR_NOT_FOUND_PARAMETER)
 		return err;
 
 	// endTime
 	err = getParam<time_t>(query, "endTime",
-			       "%ld", endTime);
+			       "%ld", request.endTime);
+	if (err != HTERR_OK && err != HTERR_NOT_FOUND_PARAMETER)
+		return err;
+
+	// resolution
+	err = getParam<int>(query, "resolution", "%d", request.resolution);
+	if (err == HTERR_OK &&
+	    !HistoryCache::isValidResolution(request.resolution)) {
+		return HatoholError(HTERR_INVALID_PARAMETER,
+		  StringUtils::sprintf("resolution: %d", request.resolution));
+	}
+	if (err != HTERR_OK && err != HTERR_NOT_FOUND_PARAMETER)
+		return err;
+
+	// maxPoints
+	err = getParam<size_t>(query, "maxPoints", "%zu", request.maxPoints);
 	if (err != HTERR_OK && err != HTERR_NOT_FOUND_PARAMETER)
 		return err;
 
+	// aggregation
+	const gchar *value = static_cast<const gchar*>(
+	  g_hash_table_lookup(query, "aggregation"));
+	if (value && !HistoryDownsampler::parseMethod(value, request.method)) {
+		return HatoholError(HTERR_INVALID_PARAMETER,
+		  StringUtils::sprintf("aggregation: %s", value));
+	}
+
 	return HatoholError(HTERR_OK);
 }
 
+typedef pair<ServerIdType, ItemIdType> HistoryItemKey;
+
+// "items" is a comma separated list of <serverId>:<itemId>.
+// An item specified more than once is returned once.
+static HatoholError parseHistoryItems(GHashTable *query,
+                                      vector<HistoryItemKey> &itemKeys)
+{
+	const gchar *value = static_cast<const gchar*>(
+	  g_hash_table_lookup(query, "items"));
+	if (!value)
+		return HatoholError(HTERR_NOT_FOUND_PARAMETER, "items");
+
+	StringVector words;
+	StringUtils::split(words, value, ',');
+	set<HistoryItemKey> keySet;
+	for (size_t i = 0; i < words.size(); i++) {
+		HistoryItemKey key;
+		char extra;
+		if (sscanf(words[i].c_str(),
+		           "%" FMT_SERVER_ID ":%" FMT_ITEM_ID "%c",
+		           &key.first, &key.second, &extra) != 2 ||
+		    key.first == ALL_SERVERS || key.second == ALL_ITEMS) {
+			return HatoholError(HTERR_INVALID_PARAMETER,
+			  StringUtils::sprintf("items: %s", words[i].c_str()));
+		}
+		if (keySet.insert(key).second)
+			itemKeys.push_back(key);
+	}
+	if (itemKeys.empty())
+		return HatoholError(HTERR_INVALID_PARAMETER, "items: empty");
+	if (itemKeys.size() > RestResourceHost::MAX_HISTORY_ITEMS) {
+		return HatoholError(HTERR_INVALID_PARAMETER,
+		  StringUtils::sprintf("items: more than %zd items",
+		                       RestResourceHost::MAX_HISTORY_ITEMS));
+	}
+	return HatoholError(HTERR_OK);
+}
+
+RestResourceHost::HistoryRequest::HistoryRequest(void)
+: beginTime(0),
+  endTime(0),
+  resolution(0),
+  maxPoints(0),
+  method(HistoryDownsampler::METHOD_LTTB)
+{
+}
+
 void RestResourceHost::handlerGetHistory(void)
 {
+	if (m_query && g_hash_table_lookup(m_query, "items")) {
+		handlerGetHistoryOfItems();
+		return;
+	}
+
 	ServerIdType serverId = ALL_SERVERS;
 	ItemId itemId = ALL_ITEMS;
 	const time_t SECONDS_IN_A_DAY = 60 * 60 * 24;
-	time_t endTime = time(NULL);
-	time_t beginTime = endTime - SECONDS_IN_A_DAY;
+	HistoryRequest request;
+	request.endTime = time(NULL);
+	request.beginTime = request.endTime - SECONDS_IN_A_DAY;
 
 	HatoholError err = parseHistoryParameter(m_query, serverId, itemId,
-						 beginTime, endTime);
+						 request);
 	if (err != HTERR_OK) {
 		replyError(err);
 		return;
@@ -825,15 +941,33 @@ void RestResourceHost::handlerGetHistory(void)
 		return;
 	}
 
-	// Queue fetching history
-	ItemInfo &itemInfo = *itemList.begin();
+	// Only the samples newer than the cached ones are fetched.
+	request.itemInfo = *itemList.begin();
+	time_t fetchBeginTime = request.beginTime;
+	HistoryCache *cache = HistoryCache::getInstance();
+	if (cache->getRangeToFetch(request.itemInfo, request.beginTime,
+	                           request.endTime, fetchBeginTime)) {
+		if (replyHistory(request, request.endTime + 1,
+		                 HistoryInfoVect()))
+			return;
+		// The cached samples have been dropped in the meantime.
+		fetchBeginTime = request.beginTime;
+	}
+	startFetchHistory(request, fetchBeginTime);
+}
+
+void RestResourceHost::startFetchHistory(const HistoryRequest &request,
+                                         const time_t &fetchBeginTime)
+{
+	UnifiedDataStore *unifiedDataStore = UnifiedDataStore::getInstance();
 	GetHistoryClosure *closure =
 	  new GetHistoryClosure(
 	    this, &RestResourceHost::historyFetchedCallback,
-	    unifiedDataStore->getDataStore(serverId));
+	    unifiedDataStore->getDataStore(request.itemInfo.serverId),
+	    request, fetchBeginTime);
 	if (closure->m_dataStorePtr.hasData()) {
 		closure->m_dataStorePtr->startOnDemandFetchHistory(
-		  itemInfo, beginTime, endTime, closure);
+		  request.itemInfo, fetchBeginTime, request.endTime, closure);
 	} else {
 		HistoryInfoVect historyInfoVect;
 		(*closure)(historyInfoVect);
@@ -844,10 +978,398 @@ void RestResourceHost::handlerGetHistory(void)
 void RestResourceHost::historyFetchedCallback(
   Closure1<HistoryInfoVect> *closure, const HistoryInfoVect &historyInfoVect)
 {
+	GetHistoryClosure *historyClosure =
+	  dynamic_cast<GetHistoryClosure *>(closure);
+	HATOHOL_ASSERT(historyClosure, "Invalid closure\n");
+	const HistoryRequest &request = historyClosure->m_request;
+	const time_t &fetchBeginTime = historyClosure->m_fetchBeginTime;
+
+	if (historyClosure->m_dataStorePtr.hasData()) {
+		HistoryCache::getInstance()->add(request.itemInfo,
+		                                 fetchBeginTime,
+		                                 request.endTime,
+		                                 historyInfoVect);
+	}
+	if (!replyHistory(request, fetchBeginTime, historyInfoVect)) {
+		// The cached samples before the fetched ones have been
+		// dropped in the meantime.
+		startFetchHistory(request, request.beginTime);
+		return;
+	}
+	unpauseResponse();
+}
+
+static void addRollups(JSONBuilder &agent,
+                       const HistoryCache::RollupVect &rollupVect)
+{
+	HistoryCache::RollupVectConstIterator it = rollupVect.begin();
+	for (; it != rollupVect.end(); ++it) {
+		const HistoryCache::Rollup &rollup = *it;
+		agent.startObject();
+		agent.add("clock", rollup.clock);
+		agent.add("min", StringUtils::sprintf("%.15g", rollup.min));
+		agent.add("max", StringUtils::sprintf("%.15g", rollup.max));
+		agent.add("avg", StringUtils::sprintf(
+		  "%.15g", rollup.sum / rollup.count));
+		agent.add("count", rollup.count);
+		agent.endObject();
+	}
+}
+
+// The samples or the rollups to be returned for a HistoryRequest.
+struct CollectedHistory {
+	HistoryInfoVect          historyInfoVect;
+	HistoryCache::RollupVect rollupVect;
+};
+
+/**
+ * Merge the cached samples and the fetched ones.
+ *
+ * @return
+ * false if the cached samples before fetchBeginTime have been dropped.
+ */
+static bool collectHistory(CollectedHistory &collected,
+                           const RestResourceHost::HistoryRequest &request,
+                           const time_t &fetchBeginTime,
+                           const HistoryInfoVect &fetchedHistoryInfoVect)
+{
+	const ItemInfo &itemInfo = request.itemInfo;
+	const time_t &beginTime = request.beginTime;
+	const time_t &endTime = request.endTime;
+	const int &resolution = request.resolution;
+
+	// Samples until cachedEndTime are taken from the cache, and the
+	// rest from the fetched ones.
+	HistoryCache *cache = HistoryCache::getInstance();
+	time_t cachedEndTime = beginTime - 1;
+	HistoryInfoVect &historyInfoVect = collected.historyInfoVect;
+	HistoryCache::RollupVect &rollupVect = collected.rollupVect;
+	if (resolution == 0) {
+		cache->get(historyInfoVect, itemInfo, beginTime, endTime,
+		           cachedEndTime);
+	} else {
+		cache->getRollups(rollupVect, itemInfo, resolution,
+		                  beginTime, endTime, cachedEndTime);
+	}
+	if (cachedEndTime < fetchBeginTime - 1)
+		return false;
+
+	HistoryInfoVect tailHistoryInfoVect;
+	HistoryInfoVectConstIterator it = fetchedHistoryInfoVect.begin();
+	for (; it != fetchedHistoryInfoVect.end(); ++it) {
+		if (it->clock.tv_sec > cachedEndTime)
+			tailHistoryInfoVect.push_back(*it);
+	}
+
+	if (resolution == 0) {
+		historyInfoVect.insert(historyInfoVect.end(),
+		                       tailHistoryInfoVect.begin(),
+		                       tailHistoryInfoVect.end());
+		if (request.maxPoints > 0 &&
+		    HistoryCache::isCacheable(itemInfo)) {
+			HistoryInfoVect sampledVect;
+			HistoryDownsampler::downsample(sampledVect,
+			                               historyInfoVect,
+			                               request.maxPoints,
+			                               request.method);
+			historyInfoVect.swap(sampledVect);
+		}
+		return true;
+	}
+
+	// The last cached bucket and the first fetched one can be
+	// the same bucket.
+	HistoryCache::RollupVect tailRollupVect;
+	HistoryCache::aggregate(tailRollupVect, tailHistoryInfoVect,
+	                        resolution);
+	HistoryCache::RollupVectIterator tailIt = tailRollupVect.begin();
+	if (!rollupVect.empty() && tailIt != tailRollupVect.end() &&
+	    rollupVect.back().clock == tailIt->clock) {
+		HistoryCache::Rollup &rollup = rollupVect.back();
+		rollup.min = min(rollup.min, tailIt->min);
+		rollup.max = max(rollup.max, tailIt->max);
+		rollup.sum += tailIt->sum;
+		rollup.count += tailIt->count;
+		++tailIt;
+	}
+	rollupVect.insert(rollupVect.end(), tailIt, tailRollupVect.end());
+
+	// The buckets have the minimum, the maximum and the average.
+	// So the aggregation method isn't used.
+	if (request.maxPoints > 0)
+		HistoryCache::mergeRollups(rollupVect, request.maxPoints);
+	return true;
+}
+
+static void addCollectedHistory(JSONBuilder &agent,
+                                const RestResourceHost::HistoryRequest &request,
+                                const CollectedHistory &collected)
+{
+	agent.startArray("history");
+	if (request.resolution == 0)
+		RestResourceHost::addHistory(agent, collected.historyInfoVect);
+	else
+		addRollups(agent, collected.rollupVect);
+	agent.endArray();
+}
+
+bool RestResourceHost::replyHistory(
+  const HistoryRequest &request, const time_t &fetchBeginTime,
+  const HistoryInfoVect &fetchedHistoryInfoVect)
+{
+	CollectedHistory collected;
+	if (!collectHistory(collected, request, fetchBeginTime,
+	                    fetchedHistoryInfoVect))
+		return false;
+
 	JSONBuilder agent;
 	agent.startObject();
 	addHatoholError(agent, HatoholError(HTERR_OK));
-	agent.startArray("history");
+	addCollectedHistory(agent, request, collected);
+	agent.endObject();
+
+	replyJSONData(agent);
+	return true;
+}
+
+// ---------------------------------------------------------------------------
+// History of multiple items
+// ---------------------------------------------------------------------------
+struct RestResourceHost::HistoryBatch {
+	Mutex                  mutex;
+	size_t                 numRemainingServers;
+	bool                   refetched;
+	vector<HistoryRequest> requests;
+	vector<time_t>         fetchBeginTimes;
+	vector<HistoryInfoVect> fetchedVects;
+
+	HistoryBatch(void)
+	: numRemainingServers(0),
+	  refetched(false)
+	{
+	}
+};
+
+struct GetHistoriesClosure
+: ClosureTemplate1<RestResourceHost, HistoryInfoVect>
+{
+	DataStorePtr                    m_dataStorePtr;
+	RestResourceHost::HistoryBatch *m_batch;
+	vector<size_t>                  m_indexes; // in m_batch->requests
+	time_t                          m_fetchBeginTime;
+
+	GetHistoriesClosure(RestResourceHost *receiver,
+			    callback func, DataStorePtr dataStorePtr,
+			    RestResourceHost::HistoryBatch *batch,
+			    const vector<size_t> &indexes,
+			    const time_t &fetchBeginTime)
+	: ClosureTemplate1<RestResourceHost, HistoryInfoVect>(receiver, func),
+	  m_dataStorePtr(dataStorePtr),
+	  m_batch(batch),
+	  m_indexes(indexes),
+	  m_fetchBeginTime(fetchBeginTime)
+	{
+		m_receiver->ref();
+	}
+
+	virtual ~GetHistoriesClosure()
+	{
+		m_receiver->unref();
+	}
+};
+
+void RestResourceHost::handlerGetHistoryOfItems(void)
+{
+	const time_t SECONDS_IN_A_DAY = 60 * 60 * 24;
+	HistoryRequest baseRequest;
+	baseRequest.endTime = time(NULL);
+	baseRequest.beginTime = baseRequest.endTime - SECONDS_IN_A_DAY;
+
+	vector<HistoryItemKey> itemKeys;
+	HatoholError err = parseHistoryItems(m_query, itemKeys);
+	if (err == HTERR_OK)
+		err = parseHistoryOptions(m_query, baseRequest);
+	if (err != HTERR_OK) {
+		replyError(err);
+		return;
+	}
+
+	// Check the specified items
+	UnifiedDataStore *unifiedDataStore = UnifiedDataStore::getInstance();
+	HistoryBatch *batch = new HistoryBatch();
+	for (size_t i = 0; i < itemKeys.size(); i++) {
+		ItemsQueryOption option(m_dataQueryContextPtr);
+		option.setTargetServerId(itemKeys[i].first);
+		option.setTargetId(itemKeys[i].second);
+		ItemInfoList itemList;
+		unifiedDataStore->getItemList(itemList, option);
+		if (itemList.empty()) {
+			string message = StringUtils::sprintf(
+			  "serverId: %" FMT_SERVER_ID ", itemId: %" FMT_ITEM_ID,
+			  itemKeys[i].first, itemKeys[i].second);
+			replyError(HatoholError(HTERR_NOT_FOUND_TARGET_RECORD,
+			                        message));
+			delete batch;
+			return;
+		}
+		batch->requests.push_back(baseRequest);
+		batch->requests.back().itemInfo = *itemList.begin();
+	}
+	batch->fetchBeginTimes.resize(batch->requests.size());
+	batch->fetchedVects.resize(batch->requests.size());
+
+	vector<size_t> indexes;
+	for (size_t i = 0; i < batch->requests.size(); i++)
+		indexes.push_back(i);
+	startFetchHistories(batch, indexes, true);
+}
+
+void RestResourceHost::startFetchHistories(HistoryBatch *batch,
+                                           const vector<size_t> &indexes,
+                                           const bool &useCache)
+{
+	// The items are grouped by the server. The samples of the items
+	// of a server are fetched at once from the earliest time that
+	// any of them needs.
+	typedef map<ServerIdType, vector<size_t> > ServerIndexesMap;
+	ServerIndexesMap serverIndexesMap;
+	map<ServerIdType, time_t> fetchBeginTimeMap;
+	HistoryCache *cache = HistoryCache::getInstance();
+	for (size_t i = 0; i < indexes.size(); i++) {
+		const size_t idx = indexes[i];
+		const HistoryRequest &request = batch->requests[idx];
+		time_t fetchBeginTime = request.beginTime;
+		if (useCache &&
+		    cache->getRangeToFetch(request.itemInfo,
+		                           request.beginTime, request.endTime,
+		                           fetchBeginTime)) {
+			// Covered by the cache
+			batch->fetchBeginTimes[idx] = request.endTime + 1;
+			continue;
+		}
+		const ServerIdType &serverId = request.itemInfo.serverId;
+		map<ServerIdType, time_t>::iterator timeIt =
+		  fetchBeginTimeMap.find(serverId);
+		if (timeIt == fetchBeginTimeMap.end())
+			fetchBeginTimeMap[serverId] = fetchBeginTime;
+		else if (fetchBeginTime < timeIt->second)
+			timeIt->second = fetchBeginTime;
+		serverIndexesMap[serverId].push_back(idx);
+	}
+
+	// The counter has to be set before the first fetch because it
+	// may complete immediately on another thread.
+	batch->numRemainingServers = serverIndexesMap.size();
+	if (serverIndexesMap.empty()) {
+		replyHistories(batch);
+		return;
+	}
+
+	UnifiedDataStore *unifiedDataStore = UnifiedDataStore::getInstance();
+	const time_t &endTime = batch->requests[indexes[0]].endTime;
+	ServerIndexesMap::const_iterator it = serverIndexesMap.begin();
+	for (; it != serverIndexesMap.end(); ++it) {
+		const time_t fetchBeginTime = fetchBeginTimeMap[it->first];
+		ItemInfoList itemInfoList;
+		const vector<size_t> &serverIndexes = it->second;
+		for (size_t i = 0; i < serverIndexes.size(); i++) {
+			const size_t &idx = serverIndexes[i];
+			batch->fetchBeginTimes[idx] = fetchBeginTime;
+			itemInfoList.push_back(batch->requests[idx].itemInfo);
+		}
+		GetHistoriesClosure *closure =
+		  new GetHistoriesClosure(
+		    this, &RestResourceHost::historiesFetchedCallback,
+		    unifiedDataStore->getDataStore(it->first),
+		    batch, serverIndexes, fetchBeginTime);
+		if (closure->m_dataStorePtr.hasData()) {
+			closure->m_dataStorePtr->startOnDemandFetchHistories(
+			  itemInfoList, fetchBeginTime, endTime, closure);
+		} else {
+			HistoryInfoVect historyInfoVect;
+			(*closure)(historyInfoVect);
+			delete closure;
+		}
+	}
+}
+
+void RestResourceHost::historiesFetchedCallback(
+  Closure1<HistoryInfoVect> *closure, const HistoryInfoVect &historyInfoVect)
+{
+	GetHistoriesClosure *historiesClosure =
+	  dynamic_cast<GetHistoriesClosure *>(closure);
+	HATOHOL_ASSERT(historiesClosure, "Invalid closure\n");
+	HistoryBatch *batch = historiesClosure->m_batch;
+	const vector<size_t> &indexes = historiesClosure->m_indexes;
+
+	// Split the samples into the items.
+	map<ItemIdType, HistoryInfoVect> itemHistoryMap;
+	HistoryInfoVectConstIterator it = historyInfoVect.begin();
+	for (; it != historyInfoVect.end(); ++it)
+		itemHistoryMap[it->itemId].push_back(*it);
+
+	HistoryCache *cache = HistoryCache::getInstance();
+	batch->mutex.lock();
+	for (size_t i = 0; i < indexes.size(); i++) {
+		const HistoryRequest &request = batch->requests[indexes[i]];
+		HistoryInfoVect &fetchedVect = batch->fetchedVects[indexes[i]];
+		fetchedVect.swap(itemHistoryMap[request.itemInfo.id]);
+		if (historiesClosure->m_dataStorePtr.hasData()) {
+			cache->add(request.itemInfo,
+			           historiesClosure->m_fetchBeginTime,
+			           request.endTime, fetchedVect);
+		}
+	}
+	const bool completed = (--batch->numRemainingServers == 0);
+	batch->mutex.unlock();
+
+	if (completed)
+		replyHistories(batch);
+}
+
+void RestResourceHost::replyHistories(HistoryBatch *batch)
+{
+	const size_t numRequests = batch->requests.size();
+	vector<CollectedHistory> collectedVect(numRequests);
+	vector<size_t> failedIndexes;
+	for (size_t i = 0; i < numRequests; i++) {
+		if (!collectHistory(collectedVect[i], batch->requests[i],
+		                    batch->fetchBeginTimes[i],
+		                    batch->fetchedVects[i]))
+			failedIndexes.push_back(i);
+	}
+	if (!failedIndexes.empty() && !batch->refetched) {
+		// The cached samples before the fetched ones have been
+		// dropped in the meantime. They are fetched entirely.
+		batch->refetched = true;
+		startFetchHistories(batch, failedIndexes, false);
+		return;
+	}
+
+	JSONBuilder agent;
+	agent.startObject();
+	addHatoholError(agent, HatoholError(HTERR_OK));
+	agent.startArray("histories");
+	for (size_t i = 0; i < numRequests; i++) {
+		const HistoryRequest &request = batch->requests[i];
+		agent.startObject();
+		agent.add("serverId", request.itemInfo.serverId);
+		// use string to treat 64bit value properly on certain browsers
+		agent.add("itemId", StringUtils::toString(request.itemInfo.id));
+		addCollectedHistory(agent, request, collectedVect[i]);
+		agent.endObject();
+	}
+	agent.endArray();
+	agent.endObject();
+	delete batch;
+
+	replyJSONData(agent);
+	unpauseResponse();
+}
+
+void RestResourceHost::addHistory(JSONBuilder &agent,
+                                  const HistoryInfoVect &historyInfoVect)
+{
 	HistoryInfoVectConstIterator it = historyInfoVect.begin();
 	for (; it != historyInfoVect.end(); ++it) {
 		const HistoryInfo &historyInfo = *it;
@@ -865,11 +1387,6 @@ void RestResourceHost::historyFetchedCallback(
 		agent.add("ns",        historyInfo.clock.tv_nsec);
 		agent.endObject();
 	}
-	agent.endArray();
-	agent.endObject();
-
-	replyJSONData(agent);
-	unpauseResponse();
 }
 
 static void addHostsIsMemberOfGroup(
@@ -21,11 +21,29 @@
 #define RestResourceHost_h
 
 #include "FaceRestPrivate.h"
+#include "HistoryDownsampler.h"
 
 struct RestResourceHost : public FaceRest::ResourceHandler
 {
 	typedef void (RestResourceHost::*HandlerFunc)(void);
 
+	struct HistoryRequest {
+		ItemInfo                   itemInfo;
+		time_t                     beginTime;
+		time_t                     endTime;
+		int                        resolution; // 0: raw samples
+		size_t                     maxPoints;  // 0: no limit
+		// The method to reduce the raw samples to maxPoints. The
+		// buckets of a resolution are merged without it.
+		HistoryDownsampler::Method method;
+
+		HistoryRequest(void);
+	};
+	struct HistoryBatch;
+
+	// The maximum number of the items in a /history request
+	static const size_t MAX_HISTORY_ITEMS;
+
 	static void registerFactories(FaceRest *faceRest);
 
 	RestResourceHost(FaceRest *faceRest, HandlerFunc handler);
@@ -41,9 +59,23 @@ struct RestResourceHost : public FaceRest::ResourceHandler
 	void handlerGetItem(void);
 	void replyGetItem(void);
 	void handlerGetHistory(void);
+	void startFetchHistory(const HistoryRequest &request,
+			       const time_t &fetchBeginTime);
+	bool replyHistory(const HistoryRequest &request,
+			  const time_t &fetchBeginTime,
+			  const HistoryInfoVect &fetchedHistoryInfoVect);
+	static void addHistory(JSONBuilder &agent,
+			       const HistoryInfoVect &historyInfoVect);
+	void handlerGetHistoryOfItems(void);
+	void startFetchHistories(HistoryBatch *batch,
+				 const std::vector<size_t> &indexes,
+				 const bool &useCache);
+	void replyHistories(HistoryBatch *batch);
 	void itemFetchedCallback(Closure0 *closure);
 	void historyFetchedCallback(Closure1<HistoryInfoVect> *closure,
 				    const HistoryInfoVect &historyInfoVect);
+	void historiesFetchedCallback(Closure1<HistoryInfoVect> *closure,
+				      const HistoryInfoVect &historyInfoVect);
 
 	static HatoholError parseEventParameter(EventsQueryOption &option,
 						GHashTable *query);
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "RestResourceLogLevel.h"
+
+using namespace std;
+using namespace mlpl;
+
+const char *RestResourceLogLevel::pathForLogLevel = "/log-level";
+
+void RestResourceLogLevel::registerFactories(FaceRest *faceRest)
+{
+	faceRest->addResourceHandlerFactory(
+	  pathForLogLevel, new RestResourceLogLevelFactory(faceRest));
+}
+
+RestResourceLogLevel::RestResourceLogLevel(FaceRest *faceRest)
+: FaceRest::ResourceHandler(faceRest, NULL)
+{
+}
+
+RestResourceLogLevel::~RestResourceLogLevel()
+{
+}
+
+void RestResourceLogLevel::handle(void)
+{
+	if (httpMethodIs("GET")) {
+		handleGet();
+	} else if (httpMethodIs("PUT")) {
+		handlePut();
+	} else if (httpMethodIs("DELETE")) {
+		handleDelete();
+	} else {
+		MLPL_ERR("Unknown method: %s\n", m_message->method);
+		replyHttpStatus(SOUP_STATUS_METHOD_NOT_ALLOWED);
+	}
+}
+
+void RestResourceLogLevel::handleGet(void)
+{
+	LogLevelMap moduleLogLevels;
+	Logger::getModuleLogLevels(moduleLogLevels);
+
+	JSONBuilder agent;
+	agent.startObject();
+	addHatoholError(agent, HTERR_OK);
+	agent.add("level", Logger::getLogLevelName(Logger::getLogLevel()));
+	agent.add("compiledLevel",
+	          Logger::getLogLevelName(MLPL_COMPILED_LOG_LEVEL));
+	agent.startObject("modules");
+	LogLevelMapConstIterator it = moduleLogLevels.begin();
+	for (; it != moduleLogLevels.end(); ++it)
+		agent.add(it->first, Logger::getLogLevelName(it->second));
+	agent.endObject();
+	agent.endObject();
+
+	replyJSONData(agent);
+}
+
+void RestResourceLogLevel::handlePut(void)
+{
+	if (!isAllowedToUpdate()) {
+		replyError(HTERR_NO_PRIVILEGE);
+		return;
+	}
+
+	const char *value =
+	  static_cast<const char *>(g_hash_table_lookup(m_query, "level"));
+	if (!value) {
+		replyError(HTERR_NOT_FOUND_PARAMETER, "level");
+		return;
+	}
+	LogLevel level;
+	if (!Logger::parseLogLevel(value, level)) {
+		REPLY_ERROR(this, HTERR_INVALID_PARAMETER, "level: %s", value);
+		return;
+	}
+
+	const string module = getResourceIdString();
+	if (module.empty()) {
+		MLPL_INFO("Changed the log level: %s\n", value);
+		Logger::setLogLevel(level);
+	} else {
+		MLPL_INFO("Changed the log level: %s: %s\n",
+		          module.c_str(), value);
+		Logger::setModuleLogLevel(module, level);
+	}
+
+	JSONBuilder agent;
+	agent.startObject();
+	addHatoholError(agent, HTERR_OK);
+	agent.endObject();
+	replyJSONData(agent);
+}
+
+void RestResourceLogLevel::handleDelete(void)
+{
+	if (!isAllowedToUpdate()) {
+		replyError(HTERR_NO_PRIVILEGE);
+		return;
+	}
+
+	const string module = getResourceIdString();
+	if (module.empty()) {
+		replyError(HTERR_NOT_FOUND_ID_IN_URL);
+		return;
+	}
+	MLPL_INFO("Cleared the log level: %s\n", module.c_str());
+	Logger::clearModuleLogLevel(module);
+
+	JSONBuilder agent;
+	agent.startObject();
+	addHatoholError(agent, HTERR_OK);
+	agent.endObject();
+	replyJSONData(agent);
+}
+
+bool RestResourceLogLevel::isAllowedToUpdate(void)
+{
+	const OperationPrivilege &privilege =
+	  m_dataQueryContextPtr->getOperationPrivilege();
+	return privilege.getFlags() == ALL_PRIVILEGES;
+}
+
+RestResourceLogLevelFactory::RestResourceLogLevelFactory(FaceRest *faceRest)
+: FaceRest::ResourceHandlerFactory(faceRest, NULL)
+{
+}
+
+FaceRest::ResourceHandler *RestResourceLogLevelFactory::createHandler()
+{
+	return new RestResourceLogLevel(m_faceRest);
+}
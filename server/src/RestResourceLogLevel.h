@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RestResourceLogLevel_h
+#define RestResourceLogLevel_h
+
+#include "FaceRestPrivate.h"
+
+/**
+ * A resource to refer and change the log levels of mlpl::Logger
+ * without restarting the server.
+ *
+ * GET    /log-level
+ * PUT    /log-level?level=DBG             (the default level)
+ * PUT    /log-level/<module>?level=DBG    (the level of the module)
+ * DELETE /log-level/<module>
+ *
+ * The changes require ALL_PRIVILEGES.
+ */
+struct RestResourceLogLevel : public FaceRest::ResourceHandler
+{
+	static void registerFactories(FaceRest *faceRest);
+
+	RestResourceLogLevel(FaceRest *faceRest);
+	virtual ~RestResourceLogLevel();
+
+	virtual void handle(void) override;
+
+	void handleGet(void);
+	void handlePut(void);
+	void handleDelete(void);
+
+	static const char *pathForLogLevel;
+
+protected:
+	bool isAllowedToUpdate(void);
+};
+
+struct RestResourceLogLevelFactory : public FaceRest::ResourceHandlerFactory
+{
+	RestResourceLogLevelFactory(FaceRest *faceRest);
+	virtual FaceRest::ResourceHandler *createHandler(void) override;
+};
+
+#endif // RestResourceLogLevel_h
@@ -653,6 +653,13 @@ void RestResourceServer::handlerServerConnStat(void)
 		agent.add("failureComment",  armInfo.failureComment);
 		agent.add("numUpdate",       armInfo.numUpdate);
 		agent.add("numFailure",      armInfo.numFailure);
+		agent.add("pollingInterval", armInfo.pollingIntervalSec);
+		agent.add("numEventsInLastPoll", armInfo.numEventsInLastPoll);
+		agent.add("lastPollDuration", armInfo.lastPollDurationMSec);
+		agent.add("numAdmittedEvents", armInfo.numAdmittedEvents);
+		agent.add("numSpilledEvents",  armInfo.numSpilledEvents);
+		agent.add("numReplayedEvents", armInfo.numReplayedEvents);
+		agent.add("numPendingEvents",  armInfo.numPendingEvents);
 		agent.endObject(); // serverId
 	}
 	agent.endObject(); // serverConnStat
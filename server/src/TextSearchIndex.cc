@@ -0,0 +1,475 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cctype>
+#include <map>
+#include <algorithm>
+#include <Mutex.h>
+#include <ReadWriteLock.h>
+#include <StringUtils.h>
+#include "TextSearchIndex.h"
+#include "DBHatohol.h"
+#include "DBTermCodec.h"
+#include "HatoholException.h"
+#include "ThreadLocalDBCache.h"
+
+using namespace std;
+using namespace mlpl;
+
+typedef uint32_t DocId;
+typedef uint32_t Trigram;
+typedef vector<DocId> Postings; // Sorted in ascending order
+
+// Documents replaced by newer ones are left in the postings until the
+// number of them exceeds this and the number of the live documents.
+static const size_t MIN_DEAD_DOCS_TO_COMPACT = 1024;
+
+const size_t TextSearchIndex::DEFAULT_MAX_DOCUMENTS = 200000;
+
+// The triggers table has a row for each trigger of the monitoring
+// servers, which doesn't grow with time. Their IDs aren't in the order
+// of the writes either, so the evicted ones can't be told by the IDs.
+// So the documents of the triggers are never evicted.
+static size_t getMaxDocuments(const TextSearchIndex::Target &target)
+{
+	if (target == TextSearchIndex::TARGET_TRIGGERS)
+		return SIZE_MAX;
+	return TextSearchIndex::DEFAULT_MAX_DOCUMENTS;
+}
+
+static string toLower(const string &str)
+{
+	string lower(str);
+	for (size_t i = 0; i < lower.size(); i++)
+		lower[i] = tolower(static_cast<unsigned char>(lower[i]));
+	return lower;
+}
+
+static void splitWords(vector<string> &words, const string &query)
+{
+	string word;
+	for (size_t i = 0; i <= query.size(); i++) {
+		if (i == query.size() ||
+		    isspace(static_cast<unsigned char>(query[i]))) {
+			if (!word.empty())
+				words.push_back(word);
+			word.clear();
+			continue;
+		}
+		word += query[i];
+	}
+}
+
+static Trigram makeTrigram(const string &text, const size_t &pos)
+{
+	return (static_cast<unsigned char>(text[pos]) << 16) |
+	       (static_cast<unsigned char>(text[pos + 1]) << 8) |
+	       static_cast<unsigned char>(text[pos + 2]);
+}
+
+static void extractTrigrams(set<Trigram> &trigrams, const string &text)
+{
+	for (size_t i = 0; i + 3 <= text.size(); i++)
+		trigrams.insert(makeTrigram(text, i));
+}
+
+struct IndexedDocument {
+	TextSearchIndex::Key key;
+	string               text; // Lower case
+	bool                 alive;
+};
+
+typedef map<TextSearchIndex::Key, DocId> DocIdMap;
+typedef DocIdMap::iterator               DocIdMapIterator;
+
+typedef map<Trigram, Postings>           PostingsMap;
+typedef PostingsMap::iterator            PostingsMapIterator;
+typedef PostingsMap::const_iterator      PostingsMapConstIterator;
+
+struct TextSearchIndex::Impl
+{
+	// The followings are protected by instancesLock. The documents
+	// written while an instance is being loaded are kept in
+	// catchUpDocuments and added to it after the load.
+	static Mutex            instancesLock;
+	static TextSearchIndex *instances[NUM_TARGETS];
+	static size_t           numLoaders[NUM_TARGETS];
+	static DocumentVect     catchUpDocuments[NUM_TARGETS];
+
+	const size_t            maxDocuments;
+	mutable ReadWriteLock   rwlock;
+	vector<IndexedDocument> documents; // Indexed by DocId
+	DocIdMap                docIdMap;  // Only for live documents
+	PostingsMap             postingsMap;
+	size_t                  numDeadDocuments;
+	DocId                   evictionCursor;
+	EvictedIdMap            evictedIdMap;
+
+	Impl(const size_t &_maxDocuments)
+	: maxDocuments(_maxDocuments),
+	  numDeadDocuments(0),
+	  evictionCursor(0)
+	{
+	}
+
+	static void finishLoading(const Target &target)
+	{
+		numLoaders[target]--;
+		if (numLoaders[target] == 0)
+			DocumentVect().swap(catchUpDocuments[target]);
+	}
+
+	void addDocument(const Key &key, const string &lowerText)
+	{
+		DocIdMapIterator it = docIdMap.find(key);
+		if (it != docIdMap.end()) {
+			IndexedDocument &prev = documents[it->second];
+			if (prev.text == lowerText)
+				return;
+			prev.alive = false;
+			prev.text.clear();
+			numDeadDocuments++;
+		}
+
+		// DocIds are given in ascending order, so appending to the
+		// postings keeps them sorted.
+		const DocId docId = documents.size();
+		IndexedDocument document;
+		document.key = key;
+		document.text = lowerText;
+		document.alive = true;
+		documents.push_back(document);
+		docIdMap[key] = docId;
+
+		set<Trigram> trigrams;
+		extractTrigrams(trigrams, lowerText);
+		set<Trigram>::const_iterator trigramIt = trigrams.begin();
+		for (; trigramIt != trigrams.end(); ++trigramIt)
+			postingsMap[*trigramIt].push_back(docId);
+	}
+
+	// The documents are evicted in the order in which they are added.
+	void evictIfNeeded(void)
+	{
+		while (docIdMap.size() > maxDocuments) {
+			IndexedDocument &document = documents[evictionCursor++];
+			if (!document.alive)
+				continue;
+			document.alive = false;
+			document.text.clear();
+			docIdMap.erase(document.key);
+			numDeadDocuments++;
+
+			uint64_t &evictedId = evictedIdMap[document.key.first];
+			evictedId = max(evictedId, document.key.second);
+		}
+	}
+
+	void compactIfNeeded(void)
+	{
+		if (numDeadDocuments < MIN_DEAD_DOCS_TO_COMPACT)
+			return;
+		if (numDeadDocuments < documents.size() - numDeadDocuments)
+			return;
+
+		vector<IndexedDocument> liveDocuments;
+		liveDocuments.reserve(documents.size() - numDeadDocuments);
+		for (size_t i = 0; i < documents.size(); i++) {
+			if (documents[i].alive)
+				liveDocuments.push_back(documents[i]);
+		}
+		documents.clear();
+		docIdMap.clear();
+		postingsMap.clear();
+		numDeadDocuments = 0;
+		evictionCursor = 0;
+		for (size_t i = 0; i < liveDocuments.size(); i++) {
+			addDocument(liveDocuments[i].key,
+			            liveDocuments[i].text);
+		}
+	}
+
+	// The documents that contain all the trigrams of the words.
+	// Words shorter than a trigram don't narrow the candidates.
+	bool getCandidates(Postings &candidates,
+	                   const vector<string> &words) const
+	{
+		bool narrowed = false;
+		for (size_t i = 0; i < words.size(); i++) {
+			set<Trigram> trigrams;
+			extractTrigrams(trigrams, words[i]);
+			set<Trigram>::const_iterator it = trigrams.begin();
+			for (; it != trigrams.end(); ++it) {
+				PostingsMapConstIterator postingsIt =
+				  postingsMap.find(*it);
+				if (postingsIt == postingsMap.end()) {
+					candidates.clear();
+					return true;
+				}
+				const Postings &postings = postingsIt->second;
+				if (!narrowed) {
+					candidates = postings;
+					narrowed = true;
+					continue;
+				}
+				Postings intersection;
+				set_intersection(
+				  candidates.begin(), candidates.end(),
+				  postings.begin(), postings.end(),
+				  back_inserter(intersection));
+				candidates.swap(intersection);
+				if (candidates.empty())
+					return true;
+			}
+		}
+		return narrowed;
+	}
+
+	bool matches(const IndexedDocument &document,
+	             const vector<string> &words) const
+	{
+		if (!document.alive)
+			return false;
+		for (size_t i = 0; i < words.size(); i++) {
+			if (document.text.find(words[i]) == string::npos)
+				return false;
+		}
+		return true;
+	}
+};
+
+Mutex            TextSearchIndex::Impl::instancesLock;
+TextSearchIndex *TextSearchIndex::Impl::instances[NUM_TARGETS];
+size_t           TextSearchIndex::Impl::numLoaders[NUM_TARGETS];
+TextSearchIndex::DocumentVect
+                 TextSearchIndex::Impl::catchUpDocuments[NUM_TARGETS];
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+TextSearchIndex::TextSearchIndex(const size_t &maxDocuments)
+: m_impl(new Impl(maxDocuments))
+{
+}
+
+TextSearchIndex::~TextSearchIndex()
+{
+}
+
+void TextSearchIndex::add(const DocumentVect &documentVect)
+{
+	m_impl->rwlock.writeLock();
+	DocumentVectConstIterator it = documentVect.begin();
+	for (; it != documentVect.end(); ++it) {
+		m_impl->addDocument(Key(it->serverId, it->id),
+		                    toLower(it->text));
+	}
+	m_impl->evictIfNeeded();
+	m_impl->compactIfNeeded();
+	m_impl->rwlock.unlock();
+}
+
+void TextSearchIndex::search(KeySet &keySet, const string &query,
+                             EvictedIdMap *evictedIdMap) const
+{
+	vector<string> words;
+	splitWords(words, toLower(query));
+
+	m_impl->rwlock.readLock();
+	Postings candidates;
+	if (m_impl->getCandidates(candidates, words)) {
+		for (size_t i = 0; i < candidates.size(); i++) {
+			const IndexedDocument &document =
+			  m_impl->documents[candidates[i]];
+			if (m_impl->matches(document, words))
+				keySet.insert(document.key);
+		}
+	} else {
+		for (size_t i = 0; i < m_impl->documents.size(); i++) {
+			const IndexedDocument &document =
+			  m_impl->documents[i];
+			if (m_impl->matches(document, words))
+				keySet.insert(document.key);
+		}
+	}
+	if (evictedIdMap)
+		*evictedIdMap = m_impl->evictedIdMap;
+	m_impl->rwlock.unlock();
+}
+
+size_t TextSearchIndex::getNumberOfDocuments(void) const
+{
+	m_impl->rwlock.readLock();
+	const size_t numDocuments = m_impl->docIdMap.size();
+	m_impl->rwlock.unlock();
+	return numDocuments;
+}
+
+TextSearchIndex &TextSearchIndex::getInstance(const Target &target)
+{
+	HATOHOL_ASSERT(target < NUM_TARGETS, "Invalid target: %d\n", target);
+
+	Impl::instancesLock.lock();
+	if (Impl::instances[target]) {
+		TextSearchIndex *index = Impl::instances[target];
+		Impl::instancesLock.unlock();
+		return *index;
+	}
+	// The lock isn't kept during the load. The records written in the
+	// meantime are kept by updateInstance() and added after it.
+	Impl::numLoaders[target]++;
+	Impl::instancesLock.unlock();
+
+	TextSearchIndex *index = new TextSearchIndex(getMaxDocuments(target));
+	try {
+		DocumentVect documentVect;
+		ThreadLocalDBCache cache;
+		cache.getMonitoring().getTextSearchDocuments(documentVect,
+		                                             target);
+		index->add(documentVect);
+	} catch (...) {
+		Impl::instancesLock.lock();
+		Impl::finishLoading(target);
+		Impl::instancesLock.unlock();
+		delete index;
+		throw;
+	}
+
+	Impl::instancesLock.lock();
+	if (Impl::instances[target]) {
+		// Another thread has finished the load earlier.
+		TextSearchIndex *loadedIndex = Impl::instances[target];
+		Impl::finishLoading(target);
+		Impl::instancesLock.unlock();
+		delete index;
+		return *loadedIndex;
+	}
+	index->add(Impl::catchUpDocuments[target]);
+	Impl::instances[target] = index;
+	DocumentVect().swap(Impl::catchUpDocuments[target]);
+	Impl::finishLoading(target);
+	Impl::instancesLock.unlock();
+	return *index;
+}
+
+void TextSearchIndex::updateInstance(const Target &target,
+                                     const DocumentVect &documentVect)
+{
+	// An instance that has not been created yet will load the records
+	// from the DB when it is requested.
+	Impl::instancesLock.lock();
+	if (Impl::instances[target]) {
+		Impl::instances[target]->add(documentVect);
+	} else if (Impl::numLoaders[target] > 0) {
+		DocumentVect &catchUpDocuments =
+		  Impl::catchUpDocuments[target];
+		catchUpDocuments.insert(catchUpDocuments.end(),
+		                        documentVect.begin(),
+		                        documentVect.end());
+	}
+	Impl::instancesLock.unlock();
+}
+
+void TextSearchIndex::reset(void)
+{
+	Impl::instancesLock.lock();
+	for (size_t i = 0; i < NUM_TARGETS; i++) {
+		delete Impl::instances[i];
+		Impl::instances[i] = NULL;
+		Impl::catchUpDocuments[i].clear();
+	}
+	Impl::instancesLock.unlock();
+}
+
+string TextSearchIndex::makeCondition(const KeySet &keySet,
+                                      const string &serverIdColumn,
+                                      const string &idColumn)
+{
+	if (keySet.empty())
+		return DBHatohol::getAlwaysFalseCondition();
+
+	// The keys are sorted by the server ID.
+	string condition = "(";
+	ServerIdType serverId = ALL_SERVERS;
+	KeySetConstIterator it = keySet.begin();
+	for (; it != keySet.end(); ++it) {
+		if (it == keySet.begin() || it->first != serverId) {
+			if (it != keySet.begin())
+				condition += ")) OR ";
+			serverId = it->first;
+			condition += StringUtils::sprintf(
+			  "(%s=%" FMT_SERVER_ID " AND %s IN (%" PRIu64,
+			  serverIdColumn.c_str(), serverId,
+			  idColumn.c_str(), it->second);
+		} else {
+			condition += StringUtils::sprintf(",%" PRIu64,
+			                                  it->second);
+		}
+	}
+	condition += ")))";
+	return condition;
+}
+
+string TextSearchIndex::makeEvictedCondition(
+  const EvictedIdMap &evictedIdMap, const string &serverIdColumn,
+  const string &idColumn)
+{
+	if (evictedIdMap.empty())
+		return DBHatohol::getAlwaysFalseCondition();
+
+	string condition = "(";
+	EvictedIdMapConstIterator it = evictedIdMap.begin();
+	for (; it != evictedIdMap.end(); ++it) {
+		if (it != evictedIdMap.begin())
+			condition += " OR ";
+		condition += StringUtils::sprintf(
+		  "(%s=%" FMT_SERVER_ID " AND %s<=%" PRIu64 ")",
+		  serverIdColumn.c_str(), it->first,
+		  idColumn.c_str(), it->second);
+	}
+	condition += ")";
+	return condition;
+}
+
+string TextSearchIndex::makeLikeCondition(const string &query,
+                                          const vector<string> &textColumns,
+                                          const DBTermCodec &dbTermCodec)
+{
+	vector<string> words;
+	splitWords(words, query);
+	string condition;
+	for (size_t i = 0; i < words.size(); i++) {
+		string escaped = StringUtils::replace(words[i], "!", "!!");
+		escaped = StringUtils::replace(escaped, "%", "!%");
+		escaped = StringUtils::replace(escaped, "_", "!_");
+		const string pattern = dbTermCodec.enc("%" + escaped + "%");
+		if (!condition.empty())
+			condition += " AND ";
+		condition += "(";
+		for (size_t j = 0; j < textColumns.size(); j++) {
+			if (j > 0)
+				condition += " OR ";
+			condition += StringUtils::sprintf(
+			  "%s LIKE %s ESCAPE '!'",
+			  textColumns[j].c_str(), pattern.c_str());
+		}
+		condition += ")";
+	}
+	return condition;
+}
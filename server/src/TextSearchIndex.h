@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TextSearchIndex_h
+#define TextSearchIndex_h
+
+#include <string>
+#include <set>
+#include <map>
+#include <vector>
+#include <memory>
+#include "Params.h"
+
+class DBTermCodec;
+
+/**
+ * A trigram inverted index of texts of the monitoring records.
+ *
+ * A document is identified by a pair of a server ID and an ID of the
+ * record in the server. A query is split into words by white spaces and
+ * a document matches when it contains all of them. The match is
+ * case-insensitive for ASCII letters.
+ *
+ * The number of the documents is bounded by a retention window. When it
+ * is exceeded, the documents added earliest are evicted and the largest
+ * evicted ID of each server is remembered, so that a caller can search
+ * the evicted records in another way. The shared instance of the
+ * triggers has no retention window, because the number of the triggers
+ * doesn't grow with time.
+ *
+ * An instance for each target table is shared in the process via
+ * getInstance(). DBTablesMonitoring updates it whenever records are
+ * written. An instance made by the constructor is independent of them.
+ */
+class TextSearchIndex {
+public:
+	enum Target {
+		TARGET_EVENTS,   // brief and host_name
+		TARGET_TRIGGERS, // brief
+		TARGET_ITEMS,    // brief
+		NUM_TARGETS,
+	};
+
+	typedef std::pair<ServerIdType, uint64_t> Key;
+	typedef std::set<Key>                     KeySet;
+	typedef KeySet::const_iterator            KeySetConstIterator;
+
+	typedef std::map<ServerIdType, uint64_t>  EvictedIdMap;
+	typedef EvictedIdMap::const_iterator      EvictedIdMapConstIterator;
+
+	struct Document {
+		ServerIdType serverId;
+		uint64_t     id;
+		std::string  text;
+	};
+	typedef std::vector<Document>              DocumentVect;
+	typedef DocumentVect::const_iterator       DocumentVectConstIterator;
+
+	static const size_t DEFAULT_MAX_DOCUMENTS;
+
+	/**
+	 * Constructor.
+	 *
+	 * @param maxDocuments The size of the retention window.
+	 */
+	TextSearchIndex(const size_t &maxDocuments = DEFAULT_MAX_DOCUMENTS);
+	virtual ~TextSearchIndex();
+
+	/**
+	 * Add documents. A document whose key is already in the index
+	 * replaces the previous one.
+	 *
+	 * @param documentVect Documents to be added.
+	 */
+	void add(const DocumentVect &documentVect);
+
+	/**
+	 * Get the keys of the documents that match a query.
+	 *
+	 * @param keySet The keys are inserted into this.
+	 * @param query A query.
+	 * @param evictedIdMap
+	 * If this is not NULL, the largest evicted ID of each server is
+	 * set to it. Evicted documents with those IDs or smaller ones
+	 * aren't in keySet even if they match.
+	 */
+	void search(KeySet &keySet, const std::string &query,
+	            EvictedIdMap *evictedIdMap = NULL) const;
+
+	size_t getNumberOfDocuments(void) const;
+
+	/**
+	 * Get the shared instance for the target.
+	 *
+	 * When the instance is created, it is filled with the records
+	 * stored in the DB. The records written by updateInstance() during
+	 * the load are added after it.
+	 *
+	 * @param target A target table.
+	 *
+	 * @return The instance.
+	 */
+	static TextSearchIndex &getInstance(const Target &target);
+
+	/**
+	 * Add documents to the shared instance if it has been created or
+	 * is being loaded.
+	 *
+	 * @param target A target table.
+	 * @param documentVect Documents to be added.
+	 */
+	static void updateInstance(const Target &target,
+	                           const DocumentVect &documentVect);
+
+	static void reset(void);
+
+	/**
+	 * Make an SQL condition that matches the rows of the keys.
+	 *
+	 * @param keySet Keys.
+	 * @param serverIdColumn A column name of the server ID.
+	 * @param idColumn A column name of the ID.
+	 *
+	 * @return A condition. It is always false if keySet is empty.
+	 */
+	static std::string makeCondition(const KeySet &keySet,
+	                                 const std::string &serverIdColumn,
+	                                 const std::string &idColumn);
+
+	/**
+	 * Make an SQL condition that matches the rows whose IDs are equal
+	 * to or smaller than the evicted ones.
+	 *
+	 * @param evictedIdMap The largest evicted IDs.
+	 * @param serverIdColumn A column name of the server ID.
+	 * @param idColumn A column name of the ID.
+	 *
+	 * @return A condition. It is always false if evictedIdMap is empty.
+	 */
+	static std::string makeEvictedCondition(
+	  const EvictedIdMap &evictedIdMap,
+	  const std::string &serverIdColumn, const std::string &idColumn);
+
+	/**
+	 * Make an SQL condition that matches the rows whose text columns
+	 * contain all the words of a query. This is for the case where
+	 * the keys are too many to be listed in a statement and for the
+	 * evicted records.
+	 *
+	 * @param query A query.
+	 * @param textColumns Column names of the texts.
+	 * @param dbTermCodec A codec to make the string literals.
+	 *
+	 * @return A condition. It is empty if the query has no words.
+	 */
+	static std::string makeLikeCondition(
+	  const std::string &query,
+	  const std::vector<std::string> &textColumns,
+	  const DBTermCodec &dbTermCodec);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // TextSearchIndex_h
@@ -17,11 +17,13 @@
  * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <map>
 #include <list>
+#include <time.h>
 #include <Mutex.h>
+#include <SimpleSemaphore.h>
 #include "Params.h"
 #include "ThreadLocalDBCache.h"
+#include "MetricsRegistry.h"
 using namespace std;
 using namespace mlpl;
 
@@ -30,123 +32,262 @@ using namespace mlpl;
 // the following MySQL command.
 //   > show global variables like 'max_connections';
 // We chose the default maximum value that doesn't exceed
-// the above value.
-// However, it naturally be changed by user setting. So this parameter
-// should also be configurable.
-static const size_t DEFAULT_MAX_NUM_CACHE_MYSQL = 100;
+// the above value. It can be changed with --db-pool-size or
+// 'pool_size' in the [mysql] group of the configuration file.
+static const size_t DEFAULT_MAX_NUM_CONNECTIONS = 100;
 
-// A DBAgentSQLite3 instance keeps to open a databa file (i.e.
-// use a file descriptor). So we cannot have the instances unlimitedly.
-static const size_t DEFAULT_MAX_NUM_CACHE_SQLITE3 = 100;
+static const size_t DEFAULT_WAIT_TIMEOUT_MSEC = 10 * 1000;
 
-typedef list<DB *>         DBList;
-typedef DBList::iterator   DBListIterator;
+// The default pool size plus this doesn't exceed the default max
+// connections of MySQL either.
+static const size_t DEFAULT_MAX_NUM_OVERFLOW_CONNECTIONS = 50;
 
-typedef map<DB *, DBListIterator> DBListItrMap;
-typedef DBListItrMap::iterator    DBListItrMapIterator;
+// A connection idle longer than this is pinged before it is handed out.
+static const time_t HEALTH_CHECK_IDLE_TIME_SEC = 60;
 
-struct ThreadLocalDBCacheLRU {
-	DBList       list;
-	DBListItrMap map;
+static time_t getMonotonicSec(void)
+{
+	timespec ts;
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+		return 0;
+	return ts.tv_sec;
+}
+
+struct PooledDB {
+	DBHatohol *dbHatohol;
+	time_t     returnedTime;
+};
+
+typedef list<PooledDB>         PooledDBList;
+typedef PooledDBList::iterator PooledDBListIterator;
 
-	void touch(DB *db)
+// This must be a POD to be a __thread variable.
+struct ThreadLease {
+	DBHatohol *dbHatohol;
+	size_t     nestLevel;
+	size_t     generation;
+	bool       overflow;
+};
+
+struct ThreadLocalDBCache::Impl {
+	static Mutex           lock;
+	// Its count is the number of connections that can be checked out.
+	static SimpleSemaphore slotSem;
+	static size_t          maxNumConnections;
+	static size_t          numSlotsToRetire;
+	static size_t          waitTimeoutMSec;
+	static size_t          maxNumOverflows;
+	static size_t          numOverflows;
+	static size_t          generation;
+	static size_t          numConnections;
+	static PooledDBList    idleList;
+	static __thread ThreadLease lease;
+
+	static MetricHistogram &getWaitDuration(void)
 	{
-		DBListItrMapIterator it = map.find(db);
-		if (it != map.end())
-			list.erase(it->second);
-		map[db] = list.insert(list.begin(), db);
+		static MetricHistogram &waitDuration =
+		  MetricsRegistry::getInstance()->getHistogram(
+		    "hatohol_db_pool_wait_duration_seconds",
+		    "Time to check out a DB connection from the pool",
+		    MetricsRegistry::UNIT_MICRO_SEC);
+		return waitDuration;
 	}
 
-	void erase(DB *db)
+	static MetricCounter &getOverflowCounter(void)
 	{
-		DBListItrMapIterator it = map.find(db);
-		HATOHOL_ASSERT(it != map.end(), "Not found. db: %p", db);
-		list.erase(it->second);
-		map.erase(it);
+		static MetricCounter &overflowCounter =
+		  MetricsRegistry::getInstance()->getCounter(
+		    "hatohol_db_pool_overflows_total",
+		    "The number of extra connections opened after a timeout");
+		return overflowCounter;
 	}
-};
 
-struct ThreadContext {
-	DBHatohol   *dbHatohol;
+	static MetricGauge &getConnectionsGauge(void)
+	{
+		static MetricGauge &connections =
+		  MetricsRegistry::getInstance()->getGauge(
+		    "hatohol_db_pool_connections",
+		    "The number of the DB connections owned by the pool");
+		return connections;
+	}
 
-	ThreadContext(void)
-	: dbHatohol(NULL)
+	static MetricGauge &getIdleConnectionsGauge(void)
 	{
+		static MetricGauge &idleConnections =
+		  MetricsRegistry::getInstance()->getGauge(
+		    "hatohol_db_pool_idle_connections",
+		    "The number of the idle DB connections in the pool");
+		return idleConnections;
 	}
 
-	virtual ~ThreadContext()
+	static void acquireSlot(bool &overflow)
 	{
-		delete dbHatohol;
+		overflow = false;
+		if (slotSem.tryWait() == 0)
+			return;
+		SimpleSemaphore::Status status = slotSem.timedWait(waitTimeoutMSec);
+		if (status == SimpleSemaphore::STAT_OK)
+			return;
+
+		lock.lock();
+		if (numOverflows >= maxNumOverflows) {
+			lock.unlock();
+			THROW_HATOHOL_EXCEPTION(
+			  "All DB connections (%zd) and extra ones (%zd) "
+			  "have been in use for %zd ms.\n",
+			  maxNumConnections, maxNumOverflows, waitTimeoutMSec);
+		}
+		numOverflows++;
+		lock.unlock();
+		MLPL_WARN("All DB connections (%zd) have been in use for %zd ms. "
+		          "Open an extra one.\n",
+		          maxNumConnections, waitTimeoutMSec);
+		getOverflowCounter().add();
+		overflow = true;
 	}
-};
 
-typedef set<ThreadContext *>       ThreadContextSet;
-typedef ThreadContextSet::iterator ThreadContextSetIterator;
+	static void releaseSlot(const bool &overflow, bool &retired)
+	{
+		// Called with the lock held
+		retired = false;
+		if (overflow) {
+			numOverflows--;
+			return;
+		}
+		if (numSlotsToRetire > 0) {
+			numSlotsToRetire--;
+			retired = true;
+			return;
+		}
+		slotSem.post();
+	}
 
-struct ThreadLocalDBCache::Impl {
-	// TODO: The limitation of cahed objects is now WIP.
-	static size_t maxNumCacheMySQL;
-	static size_t maxNumCacheSQLite3;
+	static DBHatohol *popIdleDB(bool &needCheck, size_t &currGeneration)
+	{
+		AutoMutex autoMutex(&lock);
+		currGeneration = generation;
+		if (idleList.empty())
+			return NULL;
+		PooledDB &pooled = idleList.front();
+		DBHatohol *dbHatohol = pooled.dbHatohol;
+		needCheck = (getMonotonicSec() - pooled.returnedTime
+		             >= HEALTH_CHECK_IDLE_TIME_SEC);
+		idleList.pop_front();
+		getIdleConnectionsGauge().set(idleList.size());
+		return dbHatohol;
+	}
 
-	static Mutex                   lock;
-	static ThreadContextSet        ctxSet;
-	static ThreadLocalDBCacheLRU   dbCacheLRU;
-	static __thread ThreadContext *ctx;
+	static void deleteDB(DBHatohol *dbHatohol)
+	{
+		delete dbHatohol;
+		AutoMutex autoMutex(&lock);
+		numConnections--;
+		getConnectionsGauge().set(numConnections);
+	}
 
-	static ThreadContext *getContext(void)
+	static DBHatohol *createDB(void)
 	{
+		DBHatohol *dbHatohol = new DBHatohol();
 		AutoMutex autoMutex(&lock);
-		if (!ctx) {
-			ctx = new ThreadContext();
-			ctxSet.insert(ctx);
+		numConnections++;
+		getConnectionsGauge().set(numConnections);
+		return dbHatohol;
+	}
+
+	static void checkout(void)
+	{
+		MetricTimer timer(getWaitDuration());
+		bool overflow;
+		acquireSlot(overflow);
+		timer.stop();
+
+		bool needCheck = false;
+		size_t currGeneration;
+		DBHatohol *dbHatohol = popIdleDB(needCheck, currGeneration);
+		try {
+			if (dbHatohol) {
+				DBAgent &dbAgent = dbHatohol->getDBAgent();
+				dbAgent.attachToCurrentThread();
+				if (needCheck && !dbAgent.checkConnection()) {
+					deleteDB(dbHatohol);
+					dbHatohol = NULL;
+				}
+			}
+			if (!dbHatohol)
+				dbHatohol = createDB();
+		} catch (...) {
+			AutoMutex autoMutex(&lock);
+			bool retired;
+			releaseSlot(overflow, retired);
+			throw;
 		}
-		return ctx;
+
+		lease.dbHatohol  = dbHatohol;
+		lease.generation = currGeneration;
+		lease.overflow   = overflow;
+	}
+
+	static void checkin(void)
+	{
+		DBHatohol *dbHatohol = lease.dbHatohol;
+		lease.dbHatohol = NULL;
+
+		lock.lock();
+		bool retired;
+		releaseSlot(lease.overflow, retired);
+		const bool keep = !lease.overflow && !retired &&
+		                  lease.generation == generation;
+		if (keep) {
+			PooledDB pooled = {dbHatohol, getMonotonicSec()};
+			// LIFO keeps the recently used connections warm and lets
+			// the others age out via the health check.
+			idleList.push_front(pooled);
+			getIdleConnectionsGauge().set(idleList.size());
+		}
+		lock.unlock();
+		if (!keep)
+			deleteDB(dbHatohol);
 	}
 
 	static void reset(void)
 	{
-		// This only free the DBClientMap instance of the current
-		// thread. For the other, cleanup() should be called from
-		// HatoholThreadBase::threadCleanup(). This implies this
+		// Connections used by other threads are closed when they are
+		// returned because of the new generation. This implies this
 		// method is called from the main thread that is not based
 		// on HatoholThreadBase.
-		//
-		// NOTE: We don't free all elements in dbClientMapSet here.
-		// because some threads (such as ActorCollector) don't exit
-		// at reset().
 		cleanup();
-	}
-
-	static void insert(DB *db)
-	{
-		AutoMutex autoMutex(&lock);
-		dbCacheLRU.touch(db);
+		PooledDBList drained;
+		lock.lock();
+		generation++;
+		drained.swap(idleList);
+		getIdleConnectionsGauge().set(0);
+		lock.unlock();
+		PooledDBListIterator it = drained.begin();
+		for (; it != drained.end(); ++it)
+			deleteDB(it->dbHatohol);
 	}
 
 	static void cleanup(void)
 	{
-		if (!ctx)
-			return;
-		AutoMutex autoMutex(&lock);
-		ThreadContextSetIterator it = ctxSet.find(ctx);
-		const bool found = (it != ctxSet.end());
-		HATOHOL_ASSERT(found, "Failed to found: ctx: %p\n", ctx);
-		ctxSet.erase(it);
-		dbCacheLRU.erase(ctx->dbHatohol);
-		delete ctx;
-		ctx = NULL;
+		if (lease.dbHatohol)
+			checkin();
+		lease.nestLevel = 0;
 	}
 };
 
-size_t ThreadLocalDBCache::Impl::maxNumCacheMySQL
-  = DEFAULT_MAX_NUM_CACHE_MYSQL;
-size_t ThreadLocalDBCache::Impl::maxNumCacheSQLite3
-  = DEFAULT_MAX_NUM_CACHE_SQLITE3;
-
-Mutex                   ThreadLocalDBCache::Impl::lock;
-ThreadContextSet        ThreadLocalDBCache::Impl::ctxSet;
-ThreadLocalDBCacheLRU              ThreadLocalDBCache::Impl::dbCacheLRU;
-__thread ThreadContext *ThreadLocalDBCache::Impl::ctx = NULL;
+Mutex           ThreadLocalDBCache::Impl::lock;
+SimpleSemaphore ThreadLocalDBCache::Impl::slotSem(DEFAULT_MAX_NUM_CONNECTIONS);
+size_t ThreadLocalDBCache::Impl::maxNumConnections
+  = DEFAULT_MAX_NUM_CONNECTIONS;
+size_t ThreadLocalDBCache::Impl::numSlotsToRetire = 0;
+size_t ThreadLocalDBCache::Impl::waitTimeoutMSec = DEFAULT_WAIT_TIMEOUT_MSEC;
+size_t ThreadLocalDBCache::Impl::maxNumOverflows
+  = DEFAULT_MAX_NUM_OVERFLOW_CONNECTIONS;
+size_t ThreadLocalDBCache::Impl::numOverflows = 0;
+size_t ThreadLocalDBCache::Impl::generation = 0;
+size_t ThreadLocalDBCache::Impl::numConnections = 0;
+PooledDBList    ThreadLocalDBCache::Impl::idleList;
+__thread ThreadLease ThreadLocalDBCache::Impl::lease = {NULL, 0, 0, false};
 
 // ---------------------------------------------------------------------------
 // Public methods
@@ -164,24 +305,99 @@ void ThreadLocalDBCache::cleanup(void)
 size_t ThreadLocalDBCache::getNumberOfDBClientMaps(void)
 {
 	AutoMutex autoMutex(&Impl::lock);
-	return Impl::dbCacheLRU.list.size();
+	return Impl::numConnections;
+}
+
+size_t ThreadLocalDBCache::getNumberOfIdleConnections(void)
+{
+	AutoMutex autoMutex(&Impl::lock);
+	return Impl::idleList.size();
+}
+
+void ThreadLocalDBCache::setMaxNumberOfConnections(const size_t &num)
+{
+	HATOHOL_ASSERT(num > 0, "The pool size must be positive.");
+	PooledDBList closed;
+	Impl::lock.lock();
+	size_t currNum = Impl::maxNumConnections;
+	Impl::maxNumConnections = num;
+	for (; currNum < num; currNum++) {
+		if (Impl::numSlotsToRetire > 0)
+			Impl::numSlotsToRetire--;
+		else
+			Impl::slotSem.post();
+	}
+	for (; currNum > num; currNum--) {
+		// Free slots are retired now. The others are retired
+		// when the connections that use them are returned.
+		if (Impl::slotSem.tryWait() != 0) {
+			Impl::numSlotsToRetire++;
+			continue;
+		}
+		if (!Impl::idleList.empty()) {
+			closed.push_back(Impl::idleList.back());
+			Impl::idleList.pop_back();
+		}
+	}
+	Impl::getIdleConnectionsGauge().set(Impl::idleList.size());
+	Impl::lock.unlock();
+
+	PooledDBListIterator it = closed.begin();
+	for (; it != closed.end(); ++it)
+		Impl::deleteDB(it->dbHatohol);
+}
+
+size_t ThreadLocalDBCache::getMaxNumberOfConnections(void)
+{
+	AutoMutex autoMutex(&Impl::lock);
+	return Impl::maxNumConnections;
+}
+
+void ThreadLocalDBCache::setWaitTimeout(const size_t &timeoutInMSec)
+{
+	AutoMutex autoMutex(&Impl::lock);
+	Impl::waitTimeoutMSec = timeoutInMSec;
+}
+
+size_t ThreadLocalDBCache::getWaitTimeout(void)
+{
+	AutoMutex autoMutex(&Impl::lock);
+	return Impl::waitTimeoutMSec;
+}
+
+void ThreadLocalDBCache::setMaxNumberOfOverflowConnections(const size_t &num)
+{
+	AutoMutex autoMutex(&Impl::lock);
+	Impl::maxNumOverflows = num;
+}
+
+size_t ThreadLocalDBCache::getMaxNumberOfOverflowConnections(void)
+{
+	AutoMutex autoMutex(&Impl::lock);
+	return Impl::maxNumOverflows;
 }
 
 ThreadLocalDBCache::ThreadLocalDBCache(void)
 {
+	Impl::lease.nestLevel++;
 }
 
 ThreadLocalDBCache::~ThreadLocalDBCache()
 {
+	// cleanup() may have been called in the scope of this instance.
+	if (Impl::lease.nestLevel == 0)
+		return;
+	Impl::lease.nestLevel--;
+	if (Impl::lease.nestLevel == 0 && Impl::lease.dbHatohol)
+		Impl::checkin();
 }
 
 DBHatohol &ThreadLocalDBCache::getDBHatohol(void)
 {
-	ThreadContext *ctx = Impl::getContext();
-	if (!ctx->dbHatohol)
-		ctx->dbHatohol = new DBHatohol();
-	Impl::insert(ctx->dbHatohol);
-	return *ctx->dbHatohol;
+	// Nested instances reach here without any lock.
+	if (!Impl::lease.dbHatohol)
+		Impl::checkout();
+	return *Impl::lease.dbHatohol;
 }
 
 DBTablesConfig &ThreadLocalDBCache::getConfig(void)
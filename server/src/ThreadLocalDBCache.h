@@ -26,16 +26,55 @@
 #include "DBTablesAction.h"
 #include "DBHatohol.h"
 
+/**
+ * A handle of a DB connection borrowed from a process-wide pool.
+ *
+ * The first instance in a thread checks out a connection when one of the
+ * getters is called, and the connection goes back to the pool when the
+ * outermost instance of the thread is destroyed. Nested instances share
+ * the connection without taking any lock.
+ */
 class ThreadLocalDBCache
 {
 public:
 	static void reset(void);
 
 	/**
-	 * Delete cache for the caller thread.
+	 * Return the connection that the caller thread holds to the pool.
 	 */
 	static void cleanup(void);
+
+	/**
+	 * Get the number of the connections owned by the pool. They include
+	 * the idle ones and the ones in use.
+	 */
 	static size_t getNumberOfDBClientMaps(void);
+	static size_t getNumberOfIdleConnections(void);
+
+	/**
+	 * Set the maximum number of connections that are used concurrently.
+	 * When the limit is lowered, surplus connections are closed as they
+	 * are returned.
+	 */
+	static void setMaxNumberOfConnections(const size_t &num);
+	static size_t getMaxNumberOfConnections(void);
+
+	/**
+	 * Set how long a thread waits for a connection when all of them are
+	 * in use. A thread that times out opens an extra connection, which is
+	 * closed when it is returned, so that threads waiting for each other
+	 * don't dead-lock.
+	 */
+	static void setWaitTimeout(const size_t &timeoutInMSec);
+	static size_t getWaitTimeout(void);
+
+	/**
+	 * Set the maximum number of the extra connections opened after the
+	 * wait timeout. When they are all in use, getDBHatohol() throws
+	 * a HatoholException instead of opening another one.
+	 */
+	static void setMaxNumberOfOverflowConnections(const size_t &num);
+	static size_t getMaxNumberOfOverflowConnections(void);
 
 	ThreadLocalDBCache(void);
 	virtual ~ThreadLocalDBCache();
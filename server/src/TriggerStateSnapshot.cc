@@ -0,0 +1,718 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+#include <algorithm>
+#include <Mutex.h>
+#include "TriggerStateSnapshot.h"
+#include "DBTablesMonitoring.h"
+#include "TextSearchIndex.h"
+#include "ThreadLocalDBCache.h"
+
+using namespace std;
+using namespace mlpl;
+
+typedef pair<ServerIdType, TriggerIdType>   TriggerKey;
+typedef pair<ServerIdType, HostIdType>      HostKey;
+typedef pair<ServerIdType, HostgroupIdType> HostgroupKey;
+
+// Positions in the trigger vector in ascending order
+typedef vector<size_t> Positions;
+
+typedef map<TriggerKey, size_t>               TriggerPositionMap;
+typedef TriggerPositionMap::const_iterator    TriggerPositionMapConstIterator;
+
+typedef map<HostKey, Positions>               HostPositionsMap;
+typedef HostPositionsMap::const_iterator      HostPositionsMapConstIterator;
+
+typedef map<HostgroupKey, Positions>          HostgroupPositionsMap;
+typedef HostgroupPositionsMap::const_iterator HostgroupPositionsMapConstIterator;
+
+typedef map<HostKey, HostgroupIdSet>          HostHostgroupsMap;
+typedef HostHostgroupsMap::iterator           HostHostgroupsMapIterator;
+typedef HostHostgroupsMap::const_iterator     HostHostgroupsMapConstIterator;
+
+static bool isSame(const TriggerInfo &lhs, const TriggerInfo &rhs)
+{
+	return lhs.status == rhs.status &&
+	       lhs.severity == rhs.severity &&
+	       lhs.lastChangeTime.tv_sec == rhs.lastChangeTime.tv_sec &&
+	       lhs.lastChangeTime.tv_nsec == rhs.lastChangeTime.tv_nsec &&
+	       lhs.hostId == rhs.hostId &&
+	       lhs.hostName == rhs.hostName &&
+	       lhs.brief == rhs.brief;
+}
+
+static size_t getSeverityBucket(const TriggerSeverityType &severity)
+{
+	// Unexpected values are put in the nearest bucket. They are checked
+	// again by the filter.
+	if (severity < 0)
+		return 0;
+	if (severity >= NUM_TRIGGER_SEVERITY)
+		return NUM_TRIGGER_SEVERITY - 1;
+	return severity;
+}
+
+/**
+ * The same conditions as the ones TriggersQueryOption::getCondition()
+ * makes, which are evaluated against a trigger in memory.
+ */
+struct TriggerFilter {
+	const TriggersQueryOption &option;
+	bool                       denied;
+	bool                       allServers;
+	const ServerHostGrpSetMap *srvHostGrpSetMap;
+	const ServerIdSet         *validServerIdSet;
+	bool                       useHostgroup;
+	bool                       useTextQuery;
+	TextSearchIndex::KeySet    textMatchedKeySet;
+
+	TriggerFilter(const TriggersQueryOption &_option)
+	: option(_option),
+	  denied(false),
+	  allServers(false),
+	  srvHostGrpSetMap(NULL),
+	  validServerIdSet(NULL),
+	  useHostgroup(option.isHostgroupUsed()),
+	  useTextQuery(!option.getTextQuery().empty())
+	{
+		DataQueryContext &dataQueryContext =
+		  option.getDataQueryContext();
+		if (option.getFilterForDataOfDefunctServers()) {
+			validServerIdSet =
+			  &dataQueryContext.getValidServerIdSet();
+		}
+
+		const UserIdType userId = option.getUserId();
+		if (userId == USER_ID_SYSTEM ||
+		    option.has(OPPRVLG_GET_ALL_SERVER)) {
+			allServers = true;
+		} else if (userId == INVALID_USER_ID) {
+			denied = true;
+		} else {
+			srvHostGrpSetMap =
+			  &dataQueryContext.getServerHostGrpSetMap();
+			const ServerIdType targetServerId =
+			  option.getTargetServerId();
+			if (srvHostGrpSetMap->empty()) {
+				denied = true;
+			} else if (targetServerId != ALL_SERVERS) {
+				if (srvHostGrpSetMap->find(targetServerId) ==
+				    srvHostGrpSetMap->end()) {
+					denied = true;
+				}
+			}
+		}
+
+		// The index of the triggers has all of them. So no evicted
+		// trigger has to be matched in another way.
+		if (useTextQuery && !denied) {
+			TextSearchIndex &index = TextSearchIndex::getInstance(
+			  TextSearchIndex::TARGET_TRIGGERS);
+			index.search(textMatchedKeySet, option.getTextQuery());
+		}
+	}
+
+	bool isAllServersOfUser(void) const
+	{
+		// An entry for all servers makes the privilege condition
+		// empty unless a target server is specified.
+		if (option.getTargetServerId() != ALL_SERVERS)
+			return false;
+		return srvHostGrpSetMap->find(ALL_SERVERS) !=
+		       srvHostGrpSetMap->end();
+	}
+
+	bool matchesTrigger(const TriggerInfo &triggerInfo) const
+	{
+		if (validServerIdSet &&
+		    validServerIdSet->find(triggerInfo.serverId) ==
+		    validServerIdSet->end()) {
+			return false;
+		}
+
+		const TriggerIdType targetId = option.getTargetId();
+		if (targetId != ALL_TRIGGERS && triggerInfo.id != targetId)
+			return false;
+
+		const TriggerSeverityType minSeverity =
+		  option.getMinimumSeverity();
+		if (minSeverity != TRIGGER_SEVERITY_UNKNOWN &&
+		    triggerInfo.severity < minSeverity) {
+			return false;
+		}
+
+		const TriggerStatusType status = option.getTriggerStatus();
+		if (status != TRIGGER_STATUS_ALL && triggerInfo.status != status)
+			return false;
+
+		if (useTextQuery) {
+			const TextSearchIndex::Key key(triggerInfo.serverId,
+			                               triggerInfo.id);
+			if (textMatchedKeySet.find(key) ==
+			    textMatchedKeySet.end()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// hostgroupId is ALL_HOST_GROUPS when the host group isn't used.
+	bool matchesPrivilege(const TriggerInfo &triggerInfo,
+	                      const HostgroupIdType &hostgroupId) const
+	{
+		const ServerIdType targetServerId = option.getTargetServerId();
+		const HostIdType targetHostId = option.getTargetHostId();
+		const HostgroupIdType targetHostgroupId =
+		  option.getTargetHostgroupId();
+
+		if (allServers) {
+			if (targetServerId != ALL_SERVERS &&
+			    triggerInfo.serverId != targetServerId) {
+				return false;
+			}
+			if (targetHostId != ALL_HOSTS &&
+			    triggerInfo.hostId != targetHostId) {
+				return false;
+			}
+			if (targetHostgroupId != ALL_HOST_GROUPS &&
+			    hostgroupId != targetHostgroupId) {
+				return false;
+			}
+			return true;
+		}
+
+		if (isAllServersOfUser())
+			return true;
+
+		if (targetServerId != ALL_SERVERS &&
+		    triggerInfo.serverId != targetServerId) {
+			return false;
+		}
+		ServerHostGrpSetMapConstIterator it =
+		  srvHostGrpSetMap->find(triggerInfo.serverId);
+		if (it == srvHostGrpSetMap->end())
+			return false;
+		const HostgroupIdSet &hostgroupIdSet = it->second;
+		if (targetHostgroupId != ALL_HOST_GROUPS) {
+			if (hostgroupId != targetHostgroupId)
+				return false;
+		} else if (hostgroupIdSet.find(ALL_HOST_GROUPS) ==
+		           hostgroupIdSet.end()) {
+			if (hostgroupIdSet.find(hostgroupId) ==
+			    hostgroupIdSet.end()) {
+				return false;
+			}
+		}
+		if (targetHostId != ALL_HOSTS &&
+		    triggerInfo.hostId != targetHostId) {
+			return false;
+		}
+		return true;
+	}
+};
+
+struct TriggerStateSnapshot::Impl
+{
+	// This lock is taken only to replace or refer 'current'.
+	static Mutex                 snapshotLock;
+	// Writers and the initial load are serialized by this lock.
+	static Mutex                 updateLock;
+	static TriggerStateSnapshot *current;
+
+	vector<TriggerInfo>   triggers;
+	HostHostgroupsMap     hostgroupsMap;
+	TriggerPositionMap    triggerPositionMap;
+	HostPositionsMap      hostPositionsMap;
+	HostgroupPositionsMap hostgroupPositionsMap;
+	Positions             severityPositions[NUM_TRIGGER_SEVERITY];
+
+	static void insertPosition(Positions &positions, const size_t &pos)
+	{
+		// A new trigger is appended, so this is usually push_back().
+		Positions::iterator it =
+		  lower_bound(positions.begin(), positions.end(), pos);
+		positions.insert(it, pos);
+	}
+
+	template<typename KeyType>
+	static void erasePosition(map<KeyType, Positions> &positionsMap,
+	                          const KeyType &key, const size_t &pos)
+	{
+		typename map<KeyType, Positions>::iterator it =
+		  positionsMap.find(key);
+		if (it == positionsMap.end())
+			return;
+		Positions &positions = it->second;
+		Positions::iterator posIt =
+		  lower_bound(positions.begin(), positions.end(), pos);
+		if (posIt != positions.end() && *posIt == pos)
+			positions.erase(posIt);
+		if (positions.empty())
+			positionsMap.erase(it);
+	}
+
+	// The trigger position map is maintained by the caller. The
+	// position of a trigger doesn't change once it is added.
+	void addToIndexes(const size_t &pos)
+	{
+		const TriggerInfo &triggerInfo = triggers[pos];
+		const HostKey hostKey(triggerInfo.serverId, triggerInfo.hostId);
+		insertPosition(hostPositionsMap[hostKey], pos);
+		insertPosition(
+		  severityPositions[getSeverityBucket(triggerInfo.severity)],
+		  pos);
+
+		HostHostgroupsMapConstIterator it = hostgroupsMap.find(hostKey);
+		if (it == hostgroupsMap.end())
+			return;
+		HostgroupIdSetConstIterator groupIt = it->second.begin();
+		for (; groupIt != it->second.end(); ++groupIt) {
+			const HostgroupKey hostgroupKey(triggerInfo.serverId,
+			                                *groupIt);
+			insertPosition(hostgroupPositionsMap[hostgroupKey], pos);
+		}
+	}
+
+	void removeFromIndexes(const size_t &pos)
+	{
+		const TriggerInfo &triggerInfo = triggers[pos];
+		const HostKey hostKey(triggerInfo.serverId, triggerInfo.hostId);
+		erasePosition(hostPositionsMap, hostKey, pos);
+		Positions &severityPos =
+		  severityPositions[getSeverityBucket(triggerInfo.severity)];
+		Positions::iterator posIt =
+		  lower_bound(severityPos.begin(), severityPos.end(), pos);
+		if (posIt != severityPos.end() && *posIt == pos)
+			severityPos.erase(posIt);
+
+		HostHostgroupsMapConstIterator it = hostgroupsMap.find(hostKey);
+		if (it == hostgroupsMap.end())
+			return;
+		HostgroupIdSetConstIterator groupIt = it->second.begin();
+		for (; groupIt != it->second.end(); ++groupIt) {
+			const HostgroupKey hostgroupKey(triggerInfo.serverId,
+			                                *groupIt);
+			erasePosition(hostgroupPositionsMap, hostgroupKey, pos);
+		}
+	}
+
+	void buildIndexes(void)
+	{
+		for (size_t i = 0; i < triggers.size(); i++) {
+			const TriggerInfo &triggerInfo = triggers[i];
+			triggerPositionMap[TriggerKey(triggerInfo.serverId,
+			                              triggerInfo.id)] = i;
+			addToIndexes(i);
+		}
+	}
+
+	// Only for a snapshot that hasn't been published
+	void set(const TriggerInfo &triggerInfo)
+	{
+		const TriggerKey key(triggerInfo.serverId, triggerInfo.id);
+		TriggerPositionMapConstIterator posIt =
+		  triggerPositionMap.find(key);
+		if (posIt == triggerPositionMap.end()) {
+			const size_t pos = triggers.size();
+			triggers.push_back(triggerInfo);
+			triggerPositionMap[key] = pos;
+			addToIndexes(pos);
+			return;
+		}
+
+		const size_t pos = posIt->second;
+		TriggerInfo &prev = triggers[pos];
+		const bool moved =
+		  prev.hostId != triggerInfo.hostId ||
+		  getSeverityBucket(prev.severity) !=
+		  getSeverityBucket(triggerInfo.severity);
+		if (moved)
+			removeFromIndexes(pos);
+		prev = triggerInfo;
+		if (moved)
+			addToIndexes(pos);
+	}
+
+	void getCandidates(Positions &candidates,
+	                   const TriggersQueryOption &option) const
+	{
+		const ServerIdType targetServerId = option.getTargetServerId();
+		if (targetServerId != ALL_SERVERS) {
+			const TriggerIdType targetId = option.getTargetId();
+			const HostIdType targetHostId = option.getTargetHostId();
+			const HostgroupIdType targetHostgroupId =
+			  option.getTargetHostgroupId();
+			if (targetId != ALL_TRIGGERS) {
+				TriggerPositionMapConstIterator it =
+				  triggerPositionMap.find(
+				    TriggerKey(targetServerId, targetId));
+				if (it != triggerPositionMap.end())
+					candidates.push_back(it->second);
+				return;
+			}
+			if (targetHostId != ALL_HOSTS) {
+				HostPositionsMapConstIterator it =
+				  hostPositionsMap.find(
+				    HostKey(targetServerId, targetHostId));
+				if (it != hostPositionsMap.end())
+					candidates = it->second;
+				return;
+			}
+			if (targetHostgroupId != ALL_HOST_GROUPS) {
+				HostgroupPositionsMapConstIterator it =
+				  hostgroupPositionsMap.find(
+				    HostgroupKey(targetServerId,
+				                 targetHostgroupId));
+				if (it != hostgroupPositionsMap.end())
+					candidates = it->second;
+				return;
+			}
+		}
+
+		const TriggerSeverityType minSeverity =
+		  option.getMinimumSeverity();
+		if (minSeverity > TRIGGER_SEVERITY_UNKNOWN &&
+		    minSeverity < NUM_TRIGGER_SEVERITY) {
+			const size_t first = getSeverityBucket(minSeverity);
+			for (size_t i = first; i < NUM_TRIGGER_SEVERITY; i++) {
+				candidates.insert(candidates.end(),
+				                  severityPositions[i].begin(),
+				                  severityPositions[i].end());
+			}
+			sort(candidates.begin(), candidates.end());
+			return;
+		}
+
+		candidates.reserve(triggers.size());
+		for (size_t i = 0; i < triggers.size(); i++)
+			candidates.push_back(i);
+	}
+
+	bool matches(const TriggerFilter &filter,
+	             const TriggerInfo &triggerInfo) const
+	{
+		if (!filter.matchesTrigger(triggerInfo))
+			return false;
+		if (!filter.useHostgroup)
+			return filter.matchesPrivilege(triggerInfo,
+			                               ALL_HOST_GROUPS);
+
+		// Like the inner join with the host group map, a trigger
+		// whose host belongs to no group doesn't match.
+		HostHostgroupsMapConstIterator it = hostgroupsMap.find(
+		  HostKey(triggerInfo.serverId, triggerInfo.hostId));
+		if (it == hostgroupsMap.end())
+			return false;
+		HostgroupIdSetConstIterator groupIt = it->second.begin();
+		for (; groupIt != it->second.end(); ++groupIt) {
+			if (filter.matchesPrivilege(triggerInfo, *groupIt))
+				return true;
+		}
+		return false;
+	}
+
+	static TriggerStateSnapshot *acquire(void)
+	{
+		snapshotLock.lock();
+		TriggerStateSnapshot *snapshot = current;
+		if (snapshot)
+			snapshot->ref();
+		snapshotLock.unlock();
+		return snapshot;
+	}
+
+	static void publish(TriggerStateSnapshot *next)
+	{
+		snapshotLock.lock();
+		TriggerStateSnapshot *old = current;
+		current = next;
+		snapshotLock.unlock();
+		if (old)
+			old->unref();
+	}
+
+	// The indexes have to be built after the host groups are changed.
+	static TriggerStateSnapshot *clone(const TriggerStateSnapshot &src)
+	{
+		TriggerStateSnapshot *snapshot = new TriggerStateSnapshot();
+		snapshot->m_impl->triggers = src.m_impl->triggers;
+		snapshot->m_impl->hostgroupsMap = src.m_impl->hostgroupsMap;
+		return snapshot;
+	}
+
+	// The readers of 'src' don't take any lock. So the data are
+	// copied. But the indexes are not built again, which is much
+	// slower than the copy.
+	static TriggerStateSnapshot *cloneWithIndexes(
+	  const TriggerStateSnapshot &src)
+	{
+		TriggerStateSnapshot *snapshot = clone(src);
+		Impl &impl = *snapshot->m_impl;
+		const Impl &srcImpl = *src.m_impl;
+		impl.triggerPositionMap = srcImpl.triggerPositionMap;
+		impl.hostPositionsMap = srcImpl.hostPositionsMap;
+		impl.hostgroupPositionsMap = srcImpl.hostgroupPositionsMap;
+		for (size_t i = 0; i < NUM_TRIGGER_SEVERITY; i++)
+			impl.severityPositions[i] = srcImpl.severityPositions[i];
+		return snapshot;
+	}
+
+	static TriggerStateSnapshot *load(void)
+	{
+		TriggerInfoList triggerInfoList;
+		HostgroupElementList hostgroupElementList;
+		ThreadLocalDBCache cache;
+		cache.getMonitoring().getTriggerStateSources(
+		  triggerInfoList, hostgroupElementList);
+
+		TriggerStateSnapshot *snapshot = new TriggerStateSnapshot();
+		Impl &impl = *snapshot->m_impl;
+		impl.triggers.assign(triggerInfoList.begin(),
+		                     triggerInfoList.end());
+		HostgroupElementListConstIterator it =
+		  hostgroupElementList.begin();
+		for (; it != hostgroupElementList.end(); ++it) {
+			const HostKey hostKey(it->serverId, it->hostId);
+			impl.hostgroupsMap[hostKey].insert(it->groupId);
+		}
+		impl.buildIndexes();
+		return snapshot;
+	}
+};
+
+Mutex                 TriggerStateSnapshot::Impl::snapshotLock;
+Mutex                 TriggerStateSnapshot::Impl::updateLock;
+TriggerStateSnapshot *TriggerStateSnapshot::Impl::current = NULL;
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+TriggerStateSnapshot::UpdateLock::UpdateLock(void)
+{
+	Impl::updateLock.lock();
+}
+
+TriggerStateSnapshot::UpdateLock::~UpdateLock()
+{
+	Impl::updateLock.unlock();
+}
+
+void TriggerStateSnapshot::find(TriggerInfoPtrVect &triggers,
+                                const TriggersQueryOption &option) const
+{
+	const TriggerFilter filter(option);
+	if (filter.denied)
+		return;
+
+	Positions candidates;
+	m_impl->getCandidates(candidates, option);
+	for (size_t i = 0; i < candidates.size(); i++) {
+		const TriggerInfo &triggerInfo =
+		  m_impl->triggers[candidates[i]];
+		if (m_impl->matches(filter, triggerInfo))
+			triggers.push_back(&triggerInfo);
+	}
+}
+
+const TriggerInfo *TriggerStateSnapshot::find(
+  const ServerIdType &serverId, const TriggerIdType &triggerId) const
+{
+	TriggerPositionMapConstIterator it =
+	  m_impl->triggerPositionMap.find(TriggerKey(serverId, triggerId));
+	if (it == m_impl->triggerPositionMap.end())
+		return NULL;
+	return &m_impl->triggers[it->second];
+}
+
+size_t TriggerStateSnapshot::getNumberOfTriggers(void) const
+{
+	return m_impl->triggers.size();
+}
+
+TriggerStateSnapshot *TriggerStateSnapshot::get(void)
+{
+	TriggerStateSnapshot *snapshot = Impl::acquire();
+	if (snapshot)
+		return snapshot;
+
+	// The lock is kept during the load so that triggers written by
+	// the other threads in the meantime are not lost.
+	Impl::updateLock.lock();
+	snapshot = Impl::acquire();
+	if (!snapshot) {
+		try {
+			snapshot = Impl::load();
+		} catch (...) {
+			Impl::updateLock.unlock();
+			throw;
+		}
+		snapshot->ref();
+		Impl::publish(snapshot);
+	}
+	Impl::updateLock.unlock();
+	return snapshot;
+}
+
+void TriggerStateSnapshot::update(const UpdateLock &updateLock,
+                                  const TriggerInfoList &triggerInfoList)
+{
+	// A snapshot that has not been loaded yet will read the triggers
+	// from the DB.
+	TriggerStateSnapshotPtr curr(Impl::acquire(), false);
+	if (!curr.hasData())
+		return;
+
+	TriggerStateSnapshot *next = NULL;
+	TriggerInfoListConstIterator it = triggerInfoList.begin();
+	for (; it != triggerInfoList.end(); ++it) {
+		const TriggerInfo &triggerInfo = *it;
+		if (!next) {
+			const TriggerInfo *currTrigger =
+			  curr->find(triggerInfo.serverId, triggerInfo.id);
+			if (currTrigger && isSame(*currTrigger, triggerInfo))
+				continue;
+			next = Impl::cloneWithIndexes(*curr);
+		}
+		next->m_impl->set(triggerInfo);
+	}
+	if (next)
+		Impl::publish(next);
+}
+
+void TriggerStateSnapshot::replace(const UpdateLock &updateLock,
+                                   const TriggerInfoList &triggerInfoList,
+                                   const ServerIdType &serverId)
+{
+	TriggerStateSnapshotPtr curr(Impl::acquire(), false);
+	if (!curr.hasData())
+		return;
+
+	TriggerStateSnapshot *next = new TriggerStateSnapshot();
+	next->m_impl->hostgroupsMap = curr->m_impl->hostgroupsMap;
+	vector<TriggerInfo> &triggers = next->m_impl->triggers;
+	const vector<TriggerInfo> &currTriggers = curr->m_impl->triggers;
+	for (size_t i = 0; i < currTriggers.size(); i++) {
+		if (currTriggers[i].serverId != serverId)
+			triggers.push_back(currTriggers[i]);
+	}
+	triggers.insert(triggers.end(),
+	                triggerInfoList.begin(), triggerInfoList.end());
+	next->m_impl->buildIndexes();
+	Impl::publish(next);
+}
+
+void TriggerStateSnapshot::addHostgroupElements(
+  const HostgroupElementList &hostgroupElementList)
+{
+	Impl::updateLock.lock();
+	TriggerStateSnapshotPtr curr(Impl::acquire(), false);
+	if (!curr.hasData()) {
+		Impl::updateLock.unlock();
+		return;
+	}
+
+	TriggerStateSnapshot *next = NULL;
+	HostgroupElementListConstIterator it = hostgroupElementList.begin();
+	for (; it != hostgroupElementList.end(); ++it) {
+		const HostKey hostKey(it->serverId, it->hostId);
+		if (!next) {
+			const HostHostgroupsMap &currMap =
+			  curr->m_impl->hostgroupsMap;
+			HostHostgroupsMapConstIterator groupsIt =
+			  currMap.find(hostKey);
+			if (groupsIt != currMap.end() &&
+			    groupsIt->second.count(it->groupId)) {
+				continue;
+			}
+			next = Impl::clone(*curr);
+		}
+		next->m_impl->hostgroupsMap[hostKey].insert(it->groupId);
+	}
+	if (next) {
+		next->m_impl->buildIndexes();
+		Impl::publish(next);
+	}
+	Impl::updateLock.unlock();
+}
+
+void TriggerStateSnapshot::deleteHostgroupElements(
+  const HostgroupElementList &hostgroupElementList)
+{
+	Impl::updateLock.lock();
+	TriggerStateSnapshotPtr curr(Impl::acquire(), false);
+	if (!curr.hasData()) {
+		Impl::updateLock.unlock();
+		return;
+	}
+
+	TriggerStateSnapshot *next = NULL;
+	HostgroupElementListConstIterator it = hostgroupElementList.begin();
+	for (; it != hostgroupElementList.end(); ++it) {
+		const HostKey hostKey(it->serverId, it->hostId);
+		if (!next) {
+			const HostHostgroupsMap &currMap =
+			  curr->m_impl->hostgroupsMap;
+			HostHostgroupsMapConstIterator groupsIt =
+			  currMap.find(hostKey);
+			if (groupsIt == currMap.end() ||
+			    !groupsIt->second.count(it->groupId)) {
+				continue;
+			}
+			next = Impl::clone(*curr);
+		}
+		HostHostgroupsMap &hostgroupsMap = next->m_impl->hostgroupsMap;
+		HostHostgroupsMapIterator groupsIt = hostgroupsMap.find(hostKey);
+		if (groupsIt == hostgroupsMap.end())
+			continue;
+		groupsIt->second.erase(it->groupId);
+		if (groupsIt->second.empty())
+			hostgroupsMap.erase(groupsIt);
+	}
+	if (next) {
+		next->m_impl->buildIndexes();
+		Impl::publish(next);
+	}
+	Impl::updateLock.unlock();
+}
+
+void TriggerStateSnapshot::reset(void)
+{
+	Impl::updateLock.lock();
+	Impl::snapshotLock.lock();
+	TriggerStateSnapshot *old = Impl::current;
+	Impl::current = NULL;
+	Impl::snapshotLock.unlock();
+	Impl::updateLock.unlock();
+	if (old)
+		old->unref();
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+TriggerStateSnapshot::TriggerStateSnapshot(void)
+: m_impl(new Impl())
+{
+}
+
+TriggerStateSnapshot::~TriggerStateSnapshot()
+{
+}
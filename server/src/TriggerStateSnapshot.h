@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TriggerStateSnapshot_h
+#define TriggerStateSnapshot_h
+
+#include <vector>
+#include <memory>
+#include "Params.h"
+#include "Monitoring.h"
+#include "UsedCountable.h"
+#include "UsedCountablePtr.h"
+
+class TriggersQueryOption;
+
+/**
+ * An immutable snapshot of the current states of all triggers and the
+ * host group membership of their hosts.
+ *
+ * A writer makes a new snapshot from the current one and replaces it.
+ * A reader gets the current one with get() and uses it without any lock
+ * or DB query while the other threads replace it.
+ *
+ * The triggers are kept in the order of the triggers table, i.e., an
+ * updated trigger keeps its position and a new one is appended.
+ */
+class TriggerStateSnapshot : public UsedCountable {
+public:
+	typedef std::vector<const TriggerInfo *> TriggerInfoPtrVect;
+	typedef TriggerInfoPtrVect::const_iterator TriggerInfoPtrVectConstIterator;
+
+	/**
+	 * A lock of the writers of the snapshots. A writer of the triggers
+	 * table holds it from before the write to the DB until it updates
+	 * the snapshot. So the snapshot gets the triggers in the order in
+	 * which they are committed.
+	 *
+	 * The holder must not call get() because it may load the snapshot
+	 * with the lock.
+	 */
+	class UpdateLock {
+	public:
+		UpdateLock(void);
+		virtual ~UpdateLock();
+
+	private:
+		UpdateLock(const UpdateLock &);
+		UpdateLock &operator=(const UpdateLock &);
+	};
+
+	/**
+	 * Find the triggers that satisfy the privilege and the filters of
+	 * an option. The sort order and the limit of the option are
+	 * not used.
+	 *
+	 * @param triggers
+	 * The found triggers are appended in the order of the table.
+	 * They are valid while the snapshot is referred.
+	 * @param option A query option.
+	 */
+	void find(TriggerInfoPtrVect &triggers,
+	          const TriggersQueryOption &option) const;
+
+	/**
+	 * Find a trigger by the ID without checking the privilege.
+	 *
+	 * @param serverId A server ID of the trigger.
+	 * @param triggerId A trigger ID.
+	 * @return
+	 * The trigger or NULL if it isn't found. It is valid while the
+	 * snapshot is referred.
+	 */
+	const TriggerInfo *find(const ServerIdType &serverId,
+	                        const TriggerIdType &triggerId) const;
+
+	size_t getNumberOfTriggers(void) const;
+
+	/**
+	 * Get the current snapshot. It is loaded from the DB when this
+	 * method is called for the first time.
+	 *
+	 * @return The current snapshot. The caller must unref() it.
+	 */
+	static TriggerStateSnapshot *get(void);
+
+	/**
+	 * Add or update triggers. Only the indexes of the changed triggers
+	 * are updated.
+	 *
+	 * @param updateLock The lock held while the triggers are written.
+	 * @param triggerInfoList Triggers written to the DB.
+	 */
+	static void update(const UpdateLock &updateLock,
+	                   const TriggerInfoList &triggerInfoList);
+
+	/**
+	 * Replace all triggers of a server.
+	 *
+	 * @param updateLock The lock held while the triggers are written.
+	 * @param triggerInfoList Triggers written to the DB.
+	 * @param serverId A server ID whose triggers were deleted.
+	 */
+	static void replace(const UpdateLock &updateLock,
+	                    const TriggerInfoList &triggerInfoList,
+	                    const ServerIdType &serverId);
+
+	static void addHostgroupElements(
+	  const HostgroupElementList &hostgroupElementList);
+	static void deleteHostgroupElements(
+	  const HostgroupElementList &hostgroupElementList);
+
+	static void reset(void);
+
+protected:
+	TriggerStateSnapshot(void);
+	virtual ~TriggerStateSnapshot();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+typedef UsedCountablePtr<TriggerStateSnapshot> TriggerStateSnapshotPtr;
+
+#endif // TriggerStateSnapshot_h
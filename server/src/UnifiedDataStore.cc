@@ -21,6 +21,7 @@
 #include <Mutex.h>
 #include <AtomicValue.h>
 #include <Reaper.h>
+#include <SimpleSemaphore.h>
 #include "UnifiedDataStore.h"
 #include "DBTablesAction.h"
 #include "DBTablesConfig.h"
@@ -30,6 +31,13 @@
 #include "ItemFetchWorker.h"
 #include "DataStoreFactory.h"
 #include "ArmIncidentTracker.h"
+#include "EventAdmissionController.h"
+#include "EventFlapDetector.h"
+#include "EventCorrelator.h"
+#include "ConfigManager.h"
+#include "IngestionJournal.h"
+#include "GroupCommitWriter.h"
+#include "MetricsRegistry.h"
 
 using namespace std;
 using namespace mlpl;
@@ -40,11 +48,24 @@ typedef ServerIdDataStoreMap::iterator ServerIdDataStoreMapIterator;
 typedef map<IncidentTrackerIdType, ArmIncidentTracker *> ArmIncidentTrackerMap;
 typedef ArmIncidentTrackerMap::iterator ArmIncidentTrackerMapIterator;
 
+static const size_t EVENT_STAGE_TIMER_INTERVAL_MSEC = 1000;
+
 static ArmInfo getArmInfo(DataStore *dataStore)
 {
 	return dataStore->getArmStatus().getArmInfo();
 }
 
+static void removeSymptoms(EventInfoList &eventList)
+{
+	EventInfoListIterator it = eventList.begin();
+	while (it != eventList.end()) {
+		if (it->correlation == EVENT_CORRELATION_SYMPTOM)
+			it = eventList.erase(it);
+		else
+			++it;
+	}
+}
+
 // ---------------------------------------------------------------------------
 // UnifiedDataStore
 // ---------------------------------------------------------------------------
@@ -79,14 +100,161 @@ struct UnifiedDataStore::Impl
 		}
 	};
 
+	// The triggers are committed and the events pass the stages once in
+	// prepare(), because the journal retries only commit() after
+	// a failure. The actions are executed after the data are stored.
+	struct JournalApplier : public IngestionJournal::Applier
+	{
+		Impl           *impl;
+		TriggerInfoList triggerList;
+		EventInfoList   storedEventList;
+		EventInfoList   dispatchedEventList;
+		ItemInfoList    itemList;
+		bool            replayed;
+
+		JournalApplier(Impl *_impl)
+		: impl(_impl),
+		  replayed(false)
+		{
+		}
+
+		virtual void prepare(const TriggerInfoList &_triggerList,
+		                     const EventInfoList &eventList,
+		                     const ItemInfoList &_itemList) override
+		{
+			clear();
+			itemList = _itemList;
+			if (eventList.empty()) {
+				triggerList = _triggerList;
+				return;
+			}
+			impl->commitTriggersBeforeEvents(_triggerList);
+			replayed = impl->processEventList(
+			  storedEventList, dispatchedEventList, eventList);
+		}
+
+		virtual void commit(void) override
+		{
+			impl->commitMonitoringData(triggerList, storedEventList,
+			                           itemList);
+			if (replayed) {
+				impl->getAdmissionController().finishReplay(
+				  true);
+				replayed = false;
+			}
+			// Not to store them again if the actions fail.
+			triggerList.clear();
+			storedEventList.clear();
+			itemList.clear();
+			impl->dispatchEvents(dispatchedEventList);
+			dispatchedEventList.clear();
+		}
+
+		virtual void discard(void) override
+		{
+			if (replayed)
+				impl->getAdmissionController().finishReplay(false);
+			clear();
+		}
+
+		void clear(void)
+		{
+			triggerList.clear();
+			storedEventList.clear();
+			dispatchedEventList.clear();
+			itemList.clear();
+			replayed = false;
+		}
+	};
+
+	struct MonitoringDataCommitter : public GroupCommitWriter::Committer
+	{
+		MetricCounter &numStoredEvents;
+
+		MonitoringDataCommitter(void)
+		: numStoredEvents(MetricsRegistry::getInstance()->getCounter(
+		    "hatohol_stored_events_total",
+		    "The number of events stored in the DB"))
+		{
+		}
+
+		virtual void commit(const TriggerInfoList &triggerList,
+		                    const EventInfoList &eventList,
+		                    const ItemInfoList &itemList) override
+		{
+			ThreadLocalDBCache cache;
+			cache.getMonitoring().addMonitoringData(
+			  triggerList, eventList, itemList);
+			numStoredEvents.add(eventList.size());
+		}
+	};
+
+	// Releases the events held by the stages periodically, because
+	// no event may arrive to push them out.
+	struct EventStageTimer : public HatoholThreadBase
+	{
+		UnifiedDataStore::Impl *impl;
+		SimpleSemaphore         exitSem;
+
+		EventStageTimer(UnifiedDataStore::Impl *_impl)
+		: impl(_impl),
+		  exitSem(0)
+		{
+		}
+
+		virtual void waitExit(void) override
+		{
+			exitSem.post();
+			HatoholThreadBase::waitExit();
+		}
+
+	protected:
+		virtual gpointer mainThread(HatoholThreadArg *arg) override
+		{
+			while (!isExitRequested()) {
+				const SimpleSemaphore::Status status =
+				  exitSem.timedWait(
+				    EVENT_STAGE_TIMER_INTERVAL_MSEC);
+				if (status != SimpleSemaphore::STAT_TIMEDOUT)
+					break;
+				try {
+					impl->releaseHeldEvents();
+				} catch (const exception &e) {
+					MLPL_ERR("Failed to release the held "
+					         "events: %s\n", e.what());
+				}
+			}
+			return NULL;
+		}
+	};
+
 	static UnifiedDataStore *instance;
 	static Mutex             mutex;
 
 	AtomicValue<bool>        isCopyOnDemandEnabled;
 	ItemFetchWorker          itemFetchWorker;
+	Mutex                    eventStagesLock;
+	unique_ptr<EventAdmissionController> admissionController;
+	unique_ptr<EventCorrelator>   eventCorrelator;
+	unique_ptr<EventFlapDetector> flapDetector;
+	Mutex                    lastEventIdLock;
+	map<ServerIdType, EventIdType> lastReceivedEventIdMap;
+	MetricCounter           &numReceivedEvents;
+	JournalApplier           journalApplier;
+	MonitoringDataCommitter  monitoringDataCommitter;
+	// Protects the pointers of the journal and the writer.
+	ReadWriteLock            ingestionLock;
+	unique_ptr<IngestionJournal>  journal;
+	unique_ptr<GroupCommitWriter> groupCommitWriter;
+	unique_ptr<EventStageTimer>   eventStageTimer;
 
 	Impl()
-	: isCopyOnDemandEnabled(false), isStarted(false)
+	: isCopyOnDemandEnabled(false),
+	  numReceivedEvents(MetricsRegistry::getInstance()->getCounter(
+	    "hatohol_received_events_total",
+	    "The number of events received from the monitoring servers")),
+	  journalApplier(this),
+	  isStarted(false)
 	{ 
 		// TODO: When should the object be freed ?
 		UnifiedDataStoreEventProc *evtProc =
@@ -127,6 +295,330 @@ struct UnifiedDataStore::Impl
 		  "DataStore: %p", serverId, dataStore);
 	}
 
+	EventAdmissionController &getAdmissionController(void)
+	{
+		AutoMutex autoLock(&eventStagesLock);
+		if (!admissionController.get()) {
+			ConfigManager *confMgr = ConfigManager::getInstance();
+			admissionController.reset(new EventAdmissionController(
+			  confMgr->getEventAdmissionRate(),
+			  confMgr->getEventAdmissionBurst(),
+			  confMgr->getDatabaseDirectory()));
+		}
+		return *admissionController;
+	}
+
+	EventCorrelator &getEventCorrelator(void)
+	{
+		AutoMutex autoLock(&eventStagesLock);
+		if (!eventCorrelator.get()) {
+			ConfigManager *confMgr = ConfigManager::getInstance();
+			eventCorrelator.reset(new EventCorrelator(
+			  confMgr->getEventCorrelationWindow()));
+		}
+		return *eventCorrelator;
+	}
+
+	EventFlapDetector &getFlapDetector(void)
+	{
+		AutoMutex autoLock(&eventStagesLock);
+		if (!flapDetector.get()) {
+			ConfigManager *confMgr = ConfigManager::getInstance();
+			flapDetector.reset(new EventFlapDetector(
+			  confMgr->getEventFlapWindow(),
+			  confMgr->getEventFlapStartThreshold(),
+			  confMgr->getEventFlapStopThreshold(),
+			  confMgr->getDatabaseDirectory()));
+		}
+		return *flapDetector;
+	}
+
+	void resetEventStages(void)
+	{
+		AutoMutex autoLock(&eventStagesLock);
+		admissionController.reset();
+		eventCorrelator.reset();
+		flapDetector.reset();
+
+		AutoMutex lastEventIdAutoLock(&lastEventIdLock);
+		lastReceivedEventIdMap.clear();
+	}
+
+	// The events dropped by the stages or waiting in them aren't in
+	// the DB. So the last IDs are kept in memory not to receive them
+	// again. It must be called after the events are stored, spooled or
+	// appended to the journal, so that the events are received again
+	// if they are lost.
+	void updateLastReceivedEventIds(const EventInfoList &eventList)
+	{
+		AutoMutex autoLock(&lastEventIdLock);
+		EventInfoListConstIterator it = eventList.begin();
+		for (; it != eventList.end(); ++it) {
+			if (it->id == DISCONNECT_SERVER_EVENT_ID)
+				continue;
+			map<ServerIdType, EventIdType>::iterator idIt =
+			  lastReceivedEventIdMap.find(it->serverId);
+			if (idIt == lastReceivedEventIdMap.end())
+				lastReceivedEventIdMap[it->serverId] = it->id;
+			else if (it->id > idIt->second)
+				idIt->second = it->id;
+		}
+	}
+
+	EventIdType getLastReceivedEventId(const ServerIdType &serverId)
+	{
+		AutoMutex autoLock(&lastEventIdLock);
+		map<ServerIdType, EventIdType>::const_iterator it =
+		  lastReceivedEventIdMap.find(serverId);
+		if (it == lastReceivedEventIdMap.end())
+			return EVENT_NOT_FOUND;
+		return it->second;
+	}
+
+	// Passes the events through the stages. The events to be stored
+	// and those to be passed to the actions are returned. If spooled
+	// events are admitted, true is returned and commitMonitoringData()
+	// must be called with it.
+	bool processEventList(EventInfoList &storedEventList,
+	                      EventInfoList &dispatchedEventList,
+	                      const EventInfoList &eventList)
+	{
+		EventInfoList admittedEventList;
+		const bool replayed = getAdmissionController().admit(
+		  admittedEventList, eventList);
+		if (admittedEventList.empty())
+			return replayed;
+		getEventCorrelator().correlate(admittedEventList);
+		getFlapDetector().filter(storedEventList, dispatchedEventList,
+		                         admittedEventList);
+		return replayed;
+	}
+
+	void dispatchEvents(EventInfoList &dispatchedEventList)
+	{
+		removeSymptoms(dispatchedEventList);
+		if (dispatchedEventList.empty())
+			return;
+		ActionManager actionManager;
+		actionManager.checkEvents(dispatchedEventList);
+	}
+
+	// This is called with ingestionLock or in the thread of the journal
+	// that is stopped before the writer.
+	void commitMonitoringData(const TriggerInfoList &triggerList,
+	                          const EventInfoList &eventList,
+	                          const ItemInfoList &itemList)
+	{
+		if (groupCommitWriter.get()) {
+			groupCommitWriter->write(triggerList, eventList,
+			                         itemList);
+		} else {
+			monitoringDataCommitter.commit(triggerList, eventList,
+			                               itemList);
+		}
+	}
+
+	// The stages refer to the states of the triggers. So the triggers
+	// received with the events are committed before the events pass
+	// the stages.
+	void commitTriggersBeforeEvents(const TriggerInfoList &triggerList)
+	{
+		if (triggerList.empty())
+			return;
+		commitMonitoringData(triggerList, EventInfoList(),
+		                     ItemInfoList());
+	}
+
+	// The read positions of the spooled events are saved only after
+	// they are stored. Otherwise they are replayed again.
+	void commitMonitoringData(const TriggerInfoList &triggerList,
+	                          const EventInfoList &eventList,
+	                          const ItemInfoList &itemList,
+	                          const bool &replayed)
+	{
+		try {
+			commitMonitoringData(triggerList, eventList, itemList);
+		} catch (...) {
+			if (replayed)
+				getAdmissionController().finishReplay(false);
+			throw;
+		}
+		if (replayed)
+			getAdmissionController().finishReplay(true);
+	}
+
+	// Called in the thread of EventStageTimer. The spooled events are
+	// admitted even when no event arrives.
+	void releaseHeldEvents(void)
+	{
+		EventInfoList storedEventList;
+		EventInfoList dispatchedEventList;
+		const bool replayed = processEventList(
+		  storedEventList, dispatchedEventList, EventInfoList());
+		getFlapDetector().settle(storedEventList, dispatchedEventList);
+		if (!storedEventList.empty() || replayed) {
+			ingestionLock.readLock();
+			Reaper<ReadWriteLock> unlocker(&ingestionLock,
+			                               ReadWriteLock::unlock);
+			commitMonitoringData(TriggerInfoList(), storedEventList,
+			                     ItemInfoList(), replayed);
+		}
+		dispatchEvents(dispatchedEventList);
+	}
+
+	void startEventStageTimerIfNeeded(void)
+	{
+		if (!getFlapDetector().isEnabled() &&
+		    !getAdmissionController().isEnabled()) {
+			return;
+		}
+		eventStageTimer.reset(new EventStageTimer(this));
+		eventStageTimer->start();
+	}
+
+	void stopEventStageTimer(void)
+	{
+		if (!eventStageTimer.get())
+			return;
+		eventStageTimer->exitSync();
+		eventStageTimer.reset();
+	}
+
+	// This is called with ingestionLock.
+	void storeMonitoringData(const TriggerInfoList &triggerList,
+	                         const EventInfoList &eventList,
+	                         const ItemInfoList &itemList)
+	{
+		if (eventList.empty()) {
+			commitMonitoringData(triggerList, eventList, itemList);
+			return;
+		}
+		commitTriggersBeforeEvents(triggerList);
+		EventInfoList storedEventList;
+		EventInfoList dispatchedEventList;
+		const bool replayed = processEventList(
+		  storedEventList, dispatchedEventList, eventList);
+		commitMonitoringData(TriggerInfoList(), storedEventList,
+		                     itemList, replayed);
+		dispatchEvents(dispatchedEventList);
+	}
+
+	void storeList(const TriggerInfoList &triggerList)
+	{
+		storeMonitoringData(triggerList, EventInfoList(),
+		                    ItemInfoList());
+	}
+
+	void storeList(const EventInfoList &eventList)
+	{
+		storeMonitoringData(TriggerInfoList(), eventList,
+		                    ItemInfoList());
+	}
+
+	void storeList(const ItemInfoList &itemList)
+	{
+		storeMonitoringData(TriggerInfoList(), EventInfoList(),
+		                    itemList);
+	}
+
+	template <typename LIST>
+	void ingest(const LIST &list)
+	{
+		ingestionLock.readLock();
+		Reaper<ReadWriteLock> unlocker(&ingestionLock,
+		                               ReadWriteLock::unlock);
+		if (journal.get()) {
+			if (journal->append(list))
+				return;
+			// Keep the order with the data in the journal.
+			journal->sync();
+		}
+		storeList(list);
+	}
+
+	void waitForIngestion(void)
+	{
+		ingestionLock.readLock();
+		Reaper<ReadWriteLock> unlocker(&ingestionLock,
+		                               ReadWriteLock::unlock);
+		if (journal.get())
+			journal->sync();
+	}
+
+	void startGroupCommitWriterIfEnabled(void)
+	{
+		ConfigManager *confMgr = ConfigManager::getInstance();
+		const size_t delay = confMgr->getGroupCommitDelay();
+		if (delay == 0)
+			return;
+		unique_ptr<GroupCommitWriter> newWriter(
+		  new GroupCommitWriter(delay, monitoringDataCommitter));
+		newWriter->start();
+
+		ingestionLock.writeLock();
+		groupCommitWriter.reset(newWriter.release());
+		ingestionLock.unlock();
+	}
+
+	void stopGroupCommitWriter(void)
+	{
+		ingestionLock.writeLock();
+		unique_ptr<GroupCommitWriter> oldWriter;
+		oldWriter.reset(groupCommitWriter.release());
+		ingestionLock.unlock();
+		if (oldWriter.get())
+			oldWriter->exitSync();
+	}
+
+	void startIngestionJournalIfEnabled(void)
+	{
+		ConfigManager *confMgr = ConfigManager::getInstance();
+		const size_t size = confMgr->getIngestionJournalSize();
+		if (size == 0)
+			return;
+		const string path =
+		  confMgr->getDatabaseDirectory() + "/ingestion-journal";
+		unique_ptr<IngestionJournal> newJournal(
+		  new IngestionJournal(path, size * 1024 * 1024,
+		                       journalApplier));
+		if (!newJournal->open()) {
+			MLPL_ERR("Failed to open the ingestion journal. "
+			         "The data are stored directly.\n");
+			return;
+		}
+		newJournal->start();
+		// Apply the records left by the previous run before
+		// the arms start.
+		newJournal->sync();
+
+		ingestionLock.writeLock();
+		journal.reset(newJournal.release());
+		ingestionLock.unlock();
+	}
+
+	void stopIngestionJournal(void)
+	{
+		// The records that haven't been applied are applied when
+		// the journal is opened next time.
+		ingestionLock.writeLock();
+		unique_ptr<IngestionJournal> oldJournal;
+		oldJournal.reset(journal.release());
+		ingestionLock.unlock();
+		if (oldJournal.get())
+			oldJournal->exitSync();
+	}
+
+	void setAdmissionStatistics(ArmInfo &armInfo,
+	                            const ServerIdType &serverId)
+	{
+		const EventAdmissionController::Statistics statistics =
+		  getAdmissionController().getStatistics(serverId);
+		armInfo.numAdmittedEvents = statistics.numAdmitted;
+		armInfo.numSpilledEvents = statistics.numSpilled;
+		armInfo.numReplayedEvents = statistics.numReplayed;
+		armInfo.numPendingEvents = statistics.numPending;
+	}
+
 	DataStorePtr getDataStore(const ServerIdType &serverId)
 	{
 		DataStore *dataStore = NULL;
@@ -290,6 +782,9 @@ struct UnifiedDataStore::Impl
 
 	void start(const bool &autoRun)
 	{
+		startGroupCommitWriterIfEnabled();
+		startIngestionJournalIfEnabled();
+		startEventStageTimerIfNeeded();
 		startAllDataStores(autoRun);
 		startAllArmIncidentTrackers(autoRun);
 		isStarted = true;
@@ -299,6 +794,9 @@ struct UnifiedDataStore::Impl
 	{
 		stopAllDataStores();
 		stopAllArmIncidentTrackers();
+		stopEventStageTimer();
+		stopIngestionJournal();
+		stopGroupCommitWriter();
 		isStarted = false;
 	}
 
@@ -328,6 +826,7 @@ UnifiedDataStore::~UnifiedDataStore()
 void UnifiedDataStore::reset(void)
 {
 	stop();
+	m_impl->resetEventStages();
 }
 
 UnifiedDataStore *UnifiedDataStore::getInstance(void)
@@ -519,19 +1018,53 @@ HatoholError UnifiedDataStore::addAction(ActionDef &actionDef,
 	return cache.getAction().addAction(actionDef, privilege);
 }
 
+static void takeLaterEventId(EventIdType &lastEventId,
+                             const EventIdType &eventId,
+                             const EventIdType &upperBound)
+{
+	if (eventId == EVENT_NOT_FOUND)
+		return;
+	if (upperBound != EVENT_NOT_FOUND && eventId >= upperBound)
+		return;
+	if (lastEventId == EVENT_NOT_FOUND || eventId > lastEventId)
+		lastEventId = eventId;
+}
+
 void UnifiedDataStore::addEventList(const EventInfoList &eventList)
+{
+	m_impl->numReceivedEvents.add(eventList.size());
+	m_impl->ingest(eventList);
+	m_impl->updateLastReceivedEventIds(eventList);
+}
+
+void UnifiedDataStore::addTriggerList(const TriggerInfoList &triggerList)
+{
+	m_impl->ingest(triggerList);
+}
+
+void UnifiedDataStore::waitForIngestion(void)
+{
+	m_impl->waitForIngestion();
+}
+
+EventIdType UnifiedDataStore::getLastEventId(const ServerIdType &serverId,
+                                             const EventIdType &upperBound)
 {
 	ThreadLocalDBCache cache;
-	ActionManager actionManager;
-	actionManager.checkEvents(eventList);
-	cache.getMonitoring().addEventInfoList(eventList);
+	EventIdType lastEventId =
+	  cache.getMonitoring().getLastEventId(serverId, upperBound);
+	takeLaterEventId(lastEventId,
+	                 m_impl->getLastReceivedEventId(serverId), upperBound);
+	takeLaterEventId(
+	  lastEventId,
+	  m_impl->getAdmissionController().getLastSpooledEventId(serverId),
+	  upperBound);
+	return lastEventId;
 }
 
 void UnifiedDataStore::addItemList(const ItemInfoList &itemList)
 {
-	ThreadLocalDBCache cache;
-	DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
-	dbMonitoring.addItemInfoList(itemList);
+	m_impl->ingest(itemList);
 }
 
 void UnifiedDataStore::getUserList(UserInfoList &userList,
@@ -700,6 +1233,8 @@ void UnifiedDataStore::getServerConnStatusVector(
 		ServerConnStatus svConnStat;
 		svConnStat.serverId = *serverIdItr;
 		svConnStat.armInfo = getArmInfo(dataStorePtr);
+		m_impl->setAdmissionStatistics(svConnStat.armInfo,
+		                               *serverIdItr);
 		svConnStatVec.push_back(svConnStat);
 	}
 }
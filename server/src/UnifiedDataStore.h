@@ -60,11 +60,46 @@ public:
 
 	/**
 	 * Add events in the Hatohol DB and executes action if needed. 
+	 * The events are tagged by EventCorrelator and the symptoms are not
+	 * passed to the actions. The events of flapping triggers are
+	 * collapsed by EventFlapDetector.
 	 * 
+	 * If the ingestion journal is enabled, the events are appended to
+	 * it and this method returns before they are stored.
+	 *
 	 * @param eventList A list of EventInfo.
 	 */
 	void addEventList(const EventInfoList &eventList);
 
+	/**
+	 * Add triggers in the Hatohol DB. They are passed through
+	 * the ingestion journal as addEventList().
+	 *
+	 * @param triggerList A list of TriggerInfo.
+	 */
+	void addTriggerList(const TriggerInfoList &triggerList);
+
+	/**
+	 * Wait until the data added before the call are stored in the DB.
+	 * It returns immediately if the ingestion journal is disabled.
+	 */
+	void waitForIngestion(void);
+
+	/**
+	 * Get the last ID of the events of a server. The events that have
+	 * been received but not stored in the DB yet, such as those
+	 * spooled by the admission control, are also taken into account.
+	 * So the arms should start the next polling after it.
+	 *
+	 * @param serverId A server ID.
+	 * @param upperBound
+	 * Only the IDs less than it are returned if it isn't EVENT_NOT_FOUND.
+	 * @return
+	 * The event ID. If there is no event, EVENT_NOT_FOUND is returned.
+	 */
+	EventIdType getLastEventId(const ServerIdType &serverId,
+	                           const EventIdType &upperBound =
+	                             EVENT_NOT_FOUND);
 
 	/*
 	 *  Functions which require operation privilege
@@ -28,6 +28,7 @@
 #include <glib-object.h>
 #include <inttypes.h>
 #include <dlfcn.h>
+#include <vector>
 #include <Logger.h>
 #include <SmartBuffer.h>
 #include "Hatohol.h"
@@ -98,19 +99,7 @@ static void gotNotifyEventBodyCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
                                  size_t size, Impl *impl)
 {
 	ResidentNotifyEventArg arg;
-	arg.actionId        = *sbuf.getPointerAndIncIndex<uint32_t>();
-	arg.serverId        = *sbuf.getPointerAndIncIndex<uint32_t>();
-	arg.hostId          = *sbuf.getPointerAndIncIndex<uint64_t>();
-	arg.time.tv_sec     = *sbuf.getPointerAndIncIndex<uint64_t>();
-	arg.time.tv_nsec    = *sbuf.getPointerAndIncIndex<uint32_t>();
-	arg.eventId         = *sbuf.getPointerAndIncIndex<uint64_t>();
-	arg.eventType       = *sbuf.getPointerAndIncIndex<uint16_t>();
-	arg.triggerId       = *sbuf.getPointerAndIncIndex<uint64_t>();
-	arg.triggerStatus   = *sbuf.getPointerAndIncIndex<uint16_t>();
-	arg.triggerSeverity = *sbuf.getPointerAndIncIndex<uint16_t>();
-	memcpy(arg.sessionId, sbuf.getPointer<char>(), HATOHOL_SESSION_ID_LEN);
-	arg.sessionId[HATOHOL_SESSION_ID_LEN] = '\0';  // NULL terminator
-	sbuf.incIndex(HATOHOL_SESSION_ID_LEN);
+	ResidentCommunicator::getNotifyEventArg(sbuf, arg);
 
 	// call a user action
 	uint32_t resultCode = (*impl->module->notifyEvent)(&arg);
@@ -122,6 +111,50 @@ static void gotNotifyEventBodyCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
 	impl->pullHeader(eventCb);
 }
 
+static void gotNotifyEventsBodyCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
+                                  size_t size, Impl *impl)
+{
+	if (stat != G_IO_STATUS_NORMAL) {
+		MLPL_ERR("Error: status: %x\n", stat);
+		requestQuit(impl);
+		return;
+	}
+
+	uint32_t numEvents = *sbuf.getPointerAndIncIndex<uint32_t>();
+	const size_t expectedSize = RESIDENT_PROTO_NOTIFY_EVENTS_NUM_LEN +
+	                            RESIDENT_PROTO_EVENT_BODY_LEN * numEvents;
+	if (numEvents == 0 ||
+	    numEvents > RESIDENT_PROTO_NOTIFY_EVENTS_MAX_NUM ||
+	    size != expectedSize) {
+		MLPL_ERR("Invalid number of events: %" PRIu32 ", "
+		         "size: %zd\n", numEvents, size);
+		requestQuit(impl);
+		return;
+	}
+
+	vector<ResidentNotifyEventArg> args(numEvents);
+	for (uint32_t i = 0; i < numEvents; i++)
+		ResidentCommunicator::getNotifyEventArg(sbuf, args[i]);
+
+	// call a user action
+	vector<uint32_t> resultCodes(numEvents);
+	if (impl->module->moduleVersion >= 3 && impl->module->notifyEvents) {
+		(*impl->module->notifyEvents)(&args[0], numEvents,
+		                              &resultCodes[0]);
+	} else {
+		for (uint32_t i = 0; i < numEvents; i++) {
+			resultCodes[i] =
+			  (*impl->module->notifyEvent)(&args[i]);
+		}
+	}
+	ResidentCommunicator comm;
+	comm.setNotifyEventsAck(resultCodes);
+	comm.push(impl->pipeWr);
+
+	// request to get the envet
+	impl->pullHeader(eventCb);
+}
+
 static void eventCb(GIOStatus stat, SmartBuffer &sbuf, size_t size,
                     Impl *impl)
 {
@@ -136,6 +169,10 @@ static void eventCb(GIOStatus stat, SmartBuffer &sbuf, size_t size,
 		// request to get the body
 		impl->pullData(RESIDENT_PROTO_EVENT_BODY_LEN,
 		              gotNotifyEventBodyCb);
+	} else if (pktType == RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENTS) {
+		sbuf.resetIndex();
+		uint32_t bodyLen = *sbuf.getPointer<uint32_t>();
+		impl->pullData(bodyLen, gotNotifyEventsBodyCb);
 	} else {
 		MLPL_ERR("Unexpected packet: %d\n", pktType);
 		requestQuit(impl);
@@ -197,10 +234,12 @@ static void getParametersBodyCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
 	}
 
 	// check the module version
-	if (impl->module->moduleVersion != RESIDENT_MODULE_VERSION) {
+	if (impl->module->moduleVersion < RESIDENT_MODULE_MIN_VERSION ||
+	    impl->module->moduleVersion > RESIDENT_MODULE_VERSION) {
 		MLPL_ERR("Module version unmatched: %" PRIu16 ", "
-		         "expected: %" PRIu16 "\n",
-		         impl->module->moduleVersion, RESIDENT_MODULE_VERSION);
+		         "expected: %" PRIu16 "-%" PRIu16 "\n",
+		         impl->module->moduleVersion,
+		         RESIDENT_MODULE_MIN_VERSION, RESIDENT_MODULE_VERSION);
 		sendModuleLoaded(
 		  impl, RESIDENT_PROTO_MODULE_LOADED_CODE_MOD_VER_INVALID);
 		return;
@@ -221,6 +260,8 @@ static void getParametersBodyCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
 	}
 
 	// check functions
+	// NOTE: notifyEvent is also used for a single event packet and
+	//       as a fallback of notifyEvents.
 	if (!impl->module->notifyEvent) {
 		MLPL_ERR("notify Event handler is NULL\n");
 		sendModuleLoaded(
@@ -23,6 +23,9 @@
 #include "Helpers.h"
 #include "DBTablesTest.h"
 #include "ThreadLocalDBCache.h"
+#include "HostInfoCache.h"
+#include "TextSearchIndex.h"
+#include "TriggerStateSnapshot.h"
 using namespace std;
 using namespace mlpl;
 
@@ -1788,6 +1791,10 @@ void setupTestDB(void)
 	                              TEST_DB_USER, TEST_DB_PASSWORD);
 	const bool dbRecreate = true;
 	makeTestMySQLDBIfNeeded(TEST_DB_NAME, dbRecreate);
+	// The cached dictionaries would refer records in the dropped DB.
+	HostInfoCache::reset();
+	TextSearchIndex::reset();
+	TriggerStateSnapshot::reset();
 
 	// Only when we use SQLite3 for DBTablesHatoho,
 	// the following line should be enabled.
@@ -43,6 +43,11 @@ void HatoholArmPluginGateTest::callSendTerminateCommand(void)
 	sendTerminateCommand();
 }
 
+void HatoholArmPluginGateTest::callResetTableGenerations(void)
+{
+	resetTableGenerations();
+}
+
 void HatoholArmPluginGateTest::onSessionChanged(Session *session)
 {
 	if (m_ctx.numRetry && session) {
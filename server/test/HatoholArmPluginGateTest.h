@@ -88,6 +88,7 @@ public:
 	static std::string callGenerateBrokerAddress(
 	  const MonitoringServerInfo &serverInfo);
 	void callSendTerminateCommand(void);
+	void callResetTableGenerations(void);
 
 	// We assume these virtual funcitons are called from
 	// the plugin's thread.
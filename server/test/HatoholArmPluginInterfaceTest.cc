@@ -153,6 +153,7 @@ HatoholArmPluginInterfaceTest::HatoholArmPluginInterfaceTest(
   m_msgIntercept(false)
 {
 	setQueueAddress(hapiSv.getQueueAddress());
+	setLocalChannelPath(hapiSv.getLocalChannelPath());
 }
 
 void HatoholArmPluginInterfaceTest::onReceived(mlpl::SmartBuffer &smbuf)
@@ -21,6 +21,7 @@
 #include <cstdio>
 #include <Logger.h>
 #include <SeparatorInjector.h>
+#include <Reaper.h>
 #include "ZabbixAPIEmulator.h"
 #include "JSONParser.h"
 #include "JSONBuilder.h"
@@ -104,6 +105,7 @@ struct ZabbixAPIEmulator::PrivateContext {
 	int64_t       lastEventId;
 	int64_t       expectedFirstEventId;
 	int64_t       expectedLastEventId;
+	bool          batchRequestSupported;
 	
 	// methods
 	PrivateContext(void)
@@ -112,7 +114,8 @@ struct ZabbixAPIEmulator::PrivateContext {
 	  firstEventId(0),
 	  lastEventId(0),
 	  expectedFirstEventId(0),
-	  expectedLastEventId(0)
+	  expectedLastEventId(0),
+	  batchRequestSupported(true)
 	{
 		initAPIHandlerMap();
 	}
@@ -152,6 +155,7 @@ struct ZabbixAPIEmulator::PrivateContext {
 		lastEventId = 0;
 		expectedFirstEventId = 0;
 		expectedLastEventId = 0;
+		batchRequestSupported = true;
 	}
 
 	void setupEventRange(void)
@@ -210,6 +214,11 @@ void ZabbixAPIEmulator::setOperationMode(OperationMode mode)
 	m_ctx->operationMode = mode;
 }
 
+void ZabbixAPIEmulator::setBatchRequestSupported(const bool &supported)
+{
+	m_ctx->batchRequestSupported = supported;
+}
+
 void ZabbixAPIEmulator::setAPIVersion(APIVersion version)
 {
 	m_ctx->apiVersion = version;
@@ -245,7 +254,13 @@ void ZabbixAPIEmulator::handlerAPI
 	arg.client = client;
 	ZabbixAPIEmulator *obj = static_cast<ZabbixAPIEmulator *>(user_data);
 	try {
-		obj->handlerAPIDispatch(arg);
+		const string body(msg->request_body->data,
+		                  msg->request_body->length);
+		const size_t head = body.find_first_not_of(" \t\r\n");
+		if (head != string::npos && body[head] == '[')
+			obj->handlerAPIBatch(arg);
+		else
+			obj->handlerAPIDispatch(arg);
 	} catch (const exception &e) {
 		MLPL_ERR("Got exception: %s\n", e.what());
 		soup_message_set_status(msg, SOUP_STATUS_INTERNAL_SERVER_ERROR);
@@ -282,6 +297,90 @@ string ZabbixAPIEmulator::generateAuthToken(void)
 	return token;
 }
 
+static string generateJSON(JsonNode *node)
+{
+	JsonGenerator *generator = json_generator_new();
+	json_generator_set_root(generator, node);
+	gchar *rawJSON = json_generator_to_data(generator, NULL);
+	string JSON(rawJSON);
+	g_free(rawJSON);
+	g_object_unref(generator);
+	return JSON;
+}
+
+void ZabbixAPIEmulator::handlerAPIBatch(APIHandlerArg &arg)
+{
+	if (m_ctx->operationMode == OPE_MODE_HTTP_NOT_FOUND) {
+		soup_message_set_status(arg.msg, SOUP_STATUS_NOT_FOUND);
+		return;
+	}
+	if (!m_ctx->batchRequestSupported) {
+		// The JSON-RPC error for an invalid request.
+		static const string response =
+		  "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32600,"
+		  "\"message\":\"Invalid Request.\","
+		  "\"data\":\"Invalid JSON. An error occurred on the server "
+		  "while parsing the JSON text.\"},\"id\":null}";
+		soup_message_body_append(arg.msg->response_body,
+		                         SOUP_MEMORY_COPY,
+		                         response.c_str(), response.size());
+		soup_message_set_status(arg.msg, SOUP_STATUS_OK);
+		return;
+	}
+
+	JsonParser *parser = json_parser_new();
+	Reaper<void> parserReaper(parser, g_object_unref);
+	if (!json_parser_load_from_data(parser, arg.msg->request_body->data,
+	                                arg.msg->request_body->length,
+	                                NULL)) {
+		THROW_HATOHOL_EXCEPTION("Failed to parse a batch request.");
+	}
+	JsonNode *root = json_parser_get_root(parser);
+	if (JSON_NODE_TYPE(root) != JSON_NODE_ARRAY)
+		THROW_HATOHOL_EXCEPTION("Not an array.");
+	JsonArray *requests = json_node_get_array(root);
+
+	// Each request is handled as if it came alone. The response is
+	// stamped with the ID of the request since the data files have
+	// a fixed ID.
+	string response = "[";
+	const guint numRequests = json_array_get_length(requests);
+	for (guint i = 0; i < numRequests; i++) {
+		JsonNode *requestNode = json_array_get_element(requests, i);
+		const string request = generateJSON(requestNode);
+
+		SoupMessage *msg = soup_message_new("POST", "http://localhost/");
+		Reaper<void> msgReaper(msg, g_object_unref);
+		soup_message_set_request(msg, "application/json-rpc",
+		                         SOUP_MEMORY_COPY,
+		                         request.c_str(), request.size());
+		soup_buffer_free(soup_message_body_flatten(msg->request_body));
+		APIHandlerArg subArg = arg;
+		subArg.msg = msg;
+		handlerAPIDispatch(subArg);
+
+		SoupBuffer *buf = soup_message_body_flatten(msg->response_body);
+		Reaper<SoupBuffer> bufReaper(buf, soup_buffer_free);
+		JsonParser *resParser = json_parser_new();
+		Reaper<void> resParserReaper(resParser, g_object_unref);
+		if (!json_parser_load_from_data(resParser, buf->data,
+		                                buf->length, NULL)) {
+			THROW_HATOHOL_EXCEPTION("Failed to parse a response.");
+		}
+		JsonNode *resRoot = json_parser_get_root(resParser);
+		json_object_set_int_member(json_node_get_object(resRoot),
+		                           "id", subArg.id);
+		if (i > 0)
+			response += ",";
+		response += generateJSON(resRoot);
+	}
+	response += "]";
+
+	soup_message_body_append(arg.msg->response_body, SOUP_MEMORY_COPY,
+	                         response.c_str(), response.size());
+	soup_message_set_status(arg.msg, SOUP_STATUS_OK);
+}
+
 void ZabbixAPIEmulator::handlerAPIDispatch(APIHandlerArg &arg)
 {
 	if (m_ctx->operationMode == OPE_MODE_HTTP_NOT_FOUND) {
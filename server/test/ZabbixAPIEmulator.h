@@ -59,6 +59,7 @@ public:
 
 	void setOperationMode(OperationMode mode);
 	void setAPIVersion(APIVersion version);
+	void setBatchRequestSupported(const bool &supported);
 	std::string getAPIVersionString(void);
 	void setExpectedFirstEventId(const EventIdType &id);
 	void setExpectedLastEventId(const EventIdType &id);
@@ -78,6 +79,7 @@ protected:
 
 	std::string generateAuthToken(void);
 	void handlerAPIDispatch(APIHandlerArg &arg);
+	void handlerAPIBatch(APIHandlerArg &arg);
 	void APIHandlerGetWithFile(APIHandlerArg &arg,
 	                           const std::string &dataFile);
 	void APIHandlerAPIVersion(APIHandlerArg &arg);
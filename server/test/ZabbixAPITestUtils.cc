@@ -137,6 +137,18 @@ void ZabbixAPITestee::callGetGroups(ItemTablePtr &groupsTablePtr)
 	getGroups(groupsTablePtr);
 }
 
+void ZabbixAPITestee::callGetHostsAndGroups(ItemTablePtr &hostsTablePtr,
+                                            ItemTablePtr &hostsGroupsTablePtr,
+                                            ItemTablePtr &groupsTablePtr)
+{
+	getHostsAndGroups(hostsTablePtr, hostsGroupsTablePtr, groupsTablePtr);
+}
+
+void ZabbixAPITestee::setBatchRequestSupported(const bool &supported)
+{
+	g_apiEmulator.setBatchRequestSupported(supported);
+}
+
 uint64_t ZabbixAPITestee::callGetLastEventId(void)
 {
 	return getEndEventId(false);
@@ -49,6 +49,10 @@ public:
 	void callGetHosts(ItemTablePtr &hostsTablePtr,
 	                  ItemTablePtr &hostsGroupsTablePtr);
 	void callGetGroups(ItemTablePtr &groupsTablePtr);
+	void callGetHostsAndGroups(ItemTablePtr &hostsTablePtr,
+	                           ItemTablePtr &hostsGroupsTablePtr,
+	                           ItemTablePtr &groupsTablePtr);
+	void setBatchRequestSupported(const bool &supported);
 	uint64_t callGetLastEventId(void);
 	ItemTablePtr callGetHistory(const ItemIdType &itemId,
 				    const ZabbixAPI::ValueType &valueType,
@@ -25,6 +25,8 @@
 #include "ArmBase.h"
 #include "Helpers.h"
 #include "DBTablesTest.h"
+#include "ConfigManager.h"
+#include "ArmScheduler.h"
 using namespace std;
 using namespace mlpl;
 
@@ -71,6 +73,11 @@ public:
 		setFailureInfo(comment);
 	}
 
+	void callCountPolledEvents(const size_t &numEvents)
+	{
+		countPolledEvents(numEvents);
+	}
+
 	void setOneProcHook(OneProcHook hook, void *data)
 	{
 		m_oneProcHook = hook;
@@ -134,6 +141,17 @@ void cut_setup(void)
 
 }
 
+void cut_teardown(void)
+{
+	ConfigManager::getInstance()->setNumberOfArmSchedulerWorkers(0);
+	ConfigManager::getInstance()->setAdaptivePollingEnabled(false);
+}
+
+static void enableArmScheduler(void)
+{
+	ConfigManager::getInstance()->setNumberOfArmSchedulerWorkers(2);
+}
+
 // ---------------------------------------------------------------------------
 // Test cases
 // ---------------------------------------------------------------------------
@@ -450,4 +468,142 @@ void test_fetchHistory(void)
 	cppcut_assert_equal(true, ctx.fetchHistoryClosureDeleted.get());
 }
 
+void test_fetchHistoryOfItems(void)
+{
+	TestFetchCtx ctx;
+
+	MonitoringServerInfo serverInfo;
+	initServerInfo(serverInfo);
+
+	TestArmBase armBase(__func__, serverInfo);
+	armBase.setOneProcHook(TestFetchCtx::oneProcHook, &ctx);
+	armBase.setOneProcFetchHistoryHook(
+	  TestFetchCtx::oneProcFetchHistoryHook, &ctx);
+
+	ItemInfoList itemInfoList;
+	for (ItemIdType itemId = 1; itemId <= 2; itemId++) {
+		ItemInfo itemInfo;
+		itemInfo.id = itemId;
+		itemInfo.serverId = 0;
+		itemInfo.hostId = 0;
+		itemInfo.valueType = ITEM_INFO_VALUE_TYPE_FLOAT;
+		itemInfoList.push_back(itemInfo);
+	}
+	armBase.fetchHistory(itemInfoList, 0, 0, ctx.fetchHistoryClosure);
+	armBase.start();
+	ctx.waitForFirstProc();
+	armBase.callRequestExitAndWait();
+
+	// The default implementation fetches each item in a single job.
+	cppcut_assert_equal(2, ctx.oneProcFetchHistoryCount.get());
+	cppcut_assert_equal(0, ctx.oneProcCount.get());
+	cppcut_assert_equal(true, ctx.fetchHistoryClosureCalled.get());
+	cppcut_assert_equal(true, ctx.fetchHistoryClosureDeleted.get());
+}
+
+void data_adaptivePollingInterval(void)
+{
+	gcut_add_datum("With events",
+	               "numEvents", G_TYPE_INT, 3,
+	               "expect", G_TYPE_INT, 30, NULL);
+	gcut_add_datum("Without events",
+	               "numEvents", G_TYPE_INT, 0,
+	               "expect", G_TYPE_INT, 90, NULL);
+}
+
+void test_adaptivePollingInterval(gconstpointer data)
+{
+	struct Ctx {
+		TestArmBase *armBase;
+		size_t       numEvents;
+
+		static bool oneProcHook(void *data)
+		{
+			Ctx *obj = static_cast<Ctx *>(data);
+			obj->armBase->callCountPolledEvents(obj->numEvents);
+			obj->armBase->callRequestExit();
+			return true;
+		}
+	} ctx;
+
+	ConfigManager::getInstance()->setAdaptivePollingEnabled(true);
+	MonitoringServerInfo serverInfo;
+	initServerInfo(serverInfo);
+	TestArmBase armBase(__func__, serverInfo);
+	armBase.setPollingInterval(60);
+	ctx.armBase = &armBase;
+	ctx.numEvents = gcut_data_get_int(data, "numEvents");
+	armBase.setOneProcHook(Ctx::oneProcHook, &ctx);
+	armBase.start();
+	armBase.waitExit();
+
+	ArmInfo armInfo = armBase.getArmStatus().getArmInfo();
+	cppcut_assert_equal(gcut_data_get_int(data, "expect"),
+	                    armInfo.pollingIntervalSec);
+	cppcut_assert_equal(ctx.numEvents, armInfo.numEventsInLastPoll);
+	cppcut_assert_equal(60, armBase.getPollingInterval());
+}
+
+void test_fixedPollingInterval(void)
+{
+	struct Ctx {
+		static bool oneProcHook(void *data)
+		{
+			TestArmBase *armBase = static_cast<TestArmBase *>(data);
+			armBase->callCountPolledEvents(3);
+			armBase->callRequestExit();
+			return true;
+		}
+	};
+
+	MonitoringServerInfo serverInfo;
+	initServerInfo(serverInfo);
+	TestArmBase armBase(__func__, serverInfo);
+	armBase.setPollingInterval(60);
+	armBase.setOneProcHook(Ctx::oneProcHook, &armBase);
+	armBase.start();
+	armBase.waitExit();
+
+	ArmInfo armInfo = armBase.getArmStatus().getArmInfo();
+	cppcut_assert_equal(60, armInfo.pollingIntervalSec);
+}
+
+void test_startStopOnScheduler(void)
+{
+	enableArmScheduler();
+	MonitoringServerInfo serverInfo;
+	initServerInfo(serverInfo);
+	TestArmBase armBase(__func__, serverInfo);
+	const ArmStatus &armStatus = armBase.getArmStatus();
+	armBase.start();
+	cppcut_assert_equal(true, armStatus.getArmInfo().running);
+	cppcut_assert_equal(true,
+	  ArmScheduler::getInstance()->getNumberOfTasks() > 0);
+	armBase.callRequestExitAndWait();
+	cppcut_assert_equal(false, armStatus.getArmInfo().running);
+}
+
+void test_fetchItemsOnScheduler(void)
+{
+	enableArmScheduler();
+	TestFetchCtx ctx;
+
+	MonitoringServerInfo serverInfo;
+	initServerInfo(serverInfo);
+
+	TestArmBase armBase(__func__, serverInfo);
+	armBase.setOneProcHook(TestFetchCtx::oneProcHook, &ctx);
+	armBase.setOneProcFetchItemsHook(
+	  TestFetchCtx::oneProcFetchItemsHook, &ctx);
+
+	armBase.start();
+	armBase.fetchItems(ctx.fetchItemClosure);
+	ctx.waitForFirstProc();
+	armBase.callRequestExitAndWait();
+
+	cppcut_assert_equal(1, ctx.oneProcFetchItemsCount.get());
+	cppcut_assert_equal(true, ctx.fetchItemsClosureCalled.get());
+	cppcut_assert_equal(true, ctx.fetchItemsClosureDeleted.get());
+}
+
 } // namespace testArmBase
@@ -22,6 +22,7 @@
 #include "ArmNagiosNDOUtils.h"
 #include "Helpers.h"
 #include "DBTablesTest.h"
+#include "ConfigManager.h"
 using namespace std;
 
 namespace testArmNagiosNDOUtils {
@@ -43,6 +44,26 @@ public:
 		ArmNagiosNDOUtils::getEvent();
 	} 
 
+	EventIdType getEventCursor(void)
+	{
+		return ArmNagiosNDOUtils::getEventCursor();
+	}
+
+	bool getHost(void)
+	{
+		return ArmNagiosNDOUtils::getHost();
+	}
+
+	bool getHostgroup(void)
+	{
+		return ArmNagiosNDOUtils::getHostgroup();
+	}
+
+	bool getHostgroupMembers(void)
+	{
+		return ArmNagiosNDOUtils::getHostgroupMembers();
+	}
+
 	void connect(void)
 	{
 		ArmNagiosNDOUtils::connect();
@@ -87,11 +108,19 @@ void cut_setup(void)
 	setupTestDB();
 }
 
+static string getPollCursorPath(void)
+{
+	return ConfigManager::getInstance()->getDatabaseDirectory() +
+	       "/ndo-poll-cursor-1";
+}
+
 void cut_teardown(void)
 {
 	delete g_armNagi;
 	g_armNagi = NULL;
 	g_armNagiTestee = NULL;
+	ConfigManager::getInstance()->setNDOStreamDirectory("");
+	remove(getPollCursorPath().c_str());
 }
 
 // ---------------------------------------------------------------------------
@@ -103,6 +132,20 @@ void test_create(void)
 	cppcut_assert_not_null(g_armNagi);
 }
 
+void test_ndoStreamPathIsEmptyByDefault(void)
+{
+	createGlobalInstance<ArmNagiosNDOUtilsTestee>();
+	cppcut_assert_equal(string(), g_armNagi->getNDOStreamPath());
+}
+
+void test_ndoStreamPathFromConfig(void)
+{
+	ConfigManager::getInstance()->setNDOStreamDirectory("/run/ndo");
+	createGlobalInstance<ArmNagiosNDOUtilsTestee>();
+	cppcut_assert_equal(string("/run/ndo/1.ndo"),
+	                    g_armNagi->getNDOStreamPath());
+}
+
 void test_getTrigger(void)
 {
 	createGlobalInstance<ArmNagiosNDOUtilsTestee>();
@@ -115,5 +158,46 @@ void test_getEvent(void)
 	g_armNagiTestee->getEvent();
 }
 
+void test_eventCursorIsLoadedAfterRestart(void)
+{
+	// The file is left by the previous run.
+	const EventIdType savedCursor = 12345;
+	FILE *fp = fopen(getPollCursorPath().c_str(), "w");
+	cppcut_assert_not_null(fp);
+	fprintf(fp, "%" PRIu64 "\n", savedCursor);
+	fclose(fp);
+
+	ConfigManager::getInstance()->setNDOStreamDirectory("/run/ndo");
+	createGlobalInstance<ArmNagiosNDOUtilsTestee>();
+	cppcut_assert_equal(savedCursor, g_armNagiTestee->getEventCursor());
+}
+
+void test_eventCursorIsSavedByPoll(void)
+{
+	ConfigManager::getInstance()->setNDOStreamDirectory("/run/ndo");
+	createGlobalInstance<ArmNagiosNDOUtilsTestee>();
+	g_armNagiTestee->getEvent();
+	const EventIdType cursor = g_armNagiTestee->getEventCursor();
+	cppcut_assert_not_equal(EVENT_NOT_FOUND, cursor);
+
+	// Restart
+	delete g_armNagi;
+	createGlobalInstance<ArmNagiosNDOUtilsTestee>();
+	cppcut_assert_equal(cursor, g_armNagiTestee->getEventCursor());
+}
+
+void test_skipUnchangedTables(void)
+{
+	createGlobalInstance<ArmNagiosNDOUtilsTestee>();
+	cppcut_assert_equal(true, g_armNagiTestee->getHost());
+	cppcut_assert_equal(true, g_armNagiTestee->getHostgroup());
+	cppcut_assert_equal(true, g_armNagiTestee->getHostgroupMembers());
+
+	// Nothing has changed in NDOUtils since the above calls.
+	cppcut_assert_equal(false, g_armNagiTestee->getHost());
+	cppcut_assert_equal(false, g_armNagiTestee->getHostgroup());
+	cppcut_assert_equal(false, g_armNagiTestee->getHostgroupMembers());
+}
+
 } // namespace testArmNagiosNDOUtils
 
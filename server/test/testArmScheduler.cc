@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unistd.h>
+#include <cppcutter.h>
+#include <Mutex.h>
+#include <AtomicValue.h>
+#include <SimpleSemaphore.h>
+#include "ArmScheduler.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testArmScheduler {
+
+static const size_t TIMEOUT_MSEC = 5000;
+
+struct ConcurrencyCounter {
+	Mutex lock;
+	int   current;
+	int   max;
+
+	ConcurrencyCounter(void)
+	: current(0),
+	  max(0)
+	{
+	}
+
+	void enter(void)
+	{
+		AutoMutex autoMutex(&lock);
+		current++;
+		if (current > max)
+			max = current;
+	}
+
+	void leave(void)
+	{
+		AutoMutex autoMutex(&lock);
+		current--;
+	}
+};
+
+class TestTask : public ArmScheduler::Task {
+public:
+	AtomicValue<int> numRuns;
+	SimpleSemaphore  ran;
+
+	TestTask(const int &intervalSec, const int &maxRuns = 0,
+	         ConcurrencyCounter *counter = NULL)
+	: numRuns(0),
+	  ran(0),
+	  m_intervalSec(intervalSec),
+	  m_maxRuns(maxRuns),
+	  m_counter(counter)
+	{
+	}
+
+	void waitForRun(void)
+	{
+		cppcut_assert_equal(SimpleSemaphore::STAT_OK,
+		                    ran.timedWait(TIMEOUT_MSEC));
+	}
+
+protected:
+	virtual int runOnce(void) override
+	{
+		if (m_counter) {
+			m_counter->enter();
+			usleep(50 * 1000);
+			m_counter->leave();
+		}
+		numRuns.add(1);
+		ran.post();
+		if (m_maxRuns && numRuns >= m_maxRuns)
+			return ArmScheduler::FINISHED;
+		return m_intervalSec;
+	}
+
+private:
+	int                 m_intervalSec;
+	int                 m_maxRuns;
+	ConcurrencyCounter *m_counter;
+};
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_getNumberOfWorkers(void)
+{
+	ArmScheduler scheduler(3);
+	cppcut_assert_equal((size_t)3, scheduler.getNumberOfWorkers());
+}
+
+void test_runUntilFinished(void)
+{
+	ArmScheduler scheduler(1);
+	TestTask task(0, 3);
+	scheduler.add(&task, 0);
+	scheduler.waitForFinish(&task);
+	cppcut_assert_equal(3, task.numRuns.get());
+	cppcut_assert_equal((size_t)0, scheduler.getNumberOfTasks());
+}
+
+void test_waitForFinishWithUnknownTask(void)
+{
+	ArmScheduler scheduler(1);
+	TestTask task(0);
+	scheduler.waitForFinish(&task);
+	cppcut_assert_equal(0, task.numRuns.get());
+}
+
+void test_wakeUp(void)
+{
+	ArmScheduler scheduler(1);
+	TestTask task(3600, 2);
+	scheduler.add(&task, 0);
+	task.waitForRun();
+	cppcut_assert_equal(1, task.numRuns.get());
+
+	scheduler.wakeUp(&task);
+	scheduler.waitForFinish(&task);
+	cppcut_assert_equal(2, task.numRuns.get());
+}
+
+void test_spreadFirstRun(void)
+{
+	ArmScheduler scheduler(1);
+	TestTask task(0);
+	scheduler.add(&task, 3600);
+	cppcut_assert_equal(SimpleSemaphore::STAT_TIMEDOUT,
+	                    task.ran.timedWait(100));
+	cppcut_assert_equal((size_t)1, scheduler.getNumberOfTasks());
+}
+
+void test_limitConcurrentRuns(void)
+{
+	const size_t numWorkers = 2;
+	const size_t numTasks = 6;
+	ConcurrencyCounter counter;
+	ArmScheduler scheduler(numWorkers);
+	vector<TestTask *> tasks;
+	for (size_t i = 0; i < numTasks; i++) {
+		tasks.push_back(new TestTask(0, 2, &counter));
+		scheduler.add(tasks[i], 0);
+	}
+	for (size_t i = 0; i < numTasks; i++) {
+		scheduler.waitForFinish(tasks[i]);
+		cppcut_assert_equal(2, tasks[i]->numRuns.get());
+		delete tasks[i];
+	}
+	cppcut_assert_equal((int)numWorkers, counter.max);
+}
+
+} // namespace testArmScheduler
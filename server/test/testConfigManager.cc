@@ -21,6 +21,7 @@
 #include <cppcutter.h>
 #include <StringUtils.h>
 #include <errno.h>
+#include <unistd.h>
 #include "config.h"
 #include "ConfigManager.h"
 #include "Hatohol.h"
@@ -30,11 +31,35 @@ using namespace mlpl;
 
 namespace testConfigManager {
 
+static string g_configFilePath;
+
+// Makes ConfigManager load a configuration file with the contents.
+static void loadConfigFile(const char *contents)
+{
+	g_configFilePath = StringUtils::sprintf(
+	  "/tmp/hatohol-test-config-%d.conf", getpid());
+	cppcut_assert_equal(TRUE, g_file_set_contents(g_configFilePath.c_str(),
+	                                              contents, -1, NULL));
+	CommandArgHelper cmds;
+	cmds << "--config-file";
+	cmds << g_configFilePath.c_str();
+	cppcut_assert_equal(true, cmds.activate());
+}
+
 void cut_setup(void)
 {
 	hatoholInit();
 }
 
+void cut_teardown(void)
+{
+	if (!g_configFilePath.empty()) {
+		remove(g_configFilePath.c_str());
+		g_configFilePath.clear();
+	}
+	ConfigManager::reset();
+}
+
 // ---------------------------------------------------------------------------
 // Test cases
 // ---------------------------------------------------------------------------
@@ -69,6 +94,241 @@ void test_setResidentYardDirectory(void)
 	  exampleDir, ConfigManager::getInstance()->getResidentYardDirectory());
 }
 
+void test_loadHapLocalChannelDefault(void)
+{
+	loadConfigFile("[hap]\n");
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(false, confMgr->isHapLocalChannelEnabled());
+}
+
+void test_loadHapLocalChannel(void)
+{
+	loadConfigFile("[hap]\n"
+	               "local_channel=true\n");
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(true, confMgr->isHapLocalChannelEnabled());
+}
+
+void test_loadHapLocalChannelWithInvalidValue(void)
+{
+	loadConfigFile("[hap]\n"
+	               "local_channel=maybe\n");
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(false, confMgr->isHapLocalChannelEnabled());
+}
+
+static size_t getIntegerConfig(const string &key)
+{
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	if (key == "scheduler_workers")
+		return confMgr->getNumberOfArmSchedulerWorkers();
+	if (key == "max_connections")
+		return confMgr->getZabbixAPIMaxConnections();
+	if (key == "cache_items")
+		return confMgr->getNumberOfHistoryCacheItems();
+	if (key == "correlation_window")
+		return confMgr->getEventCorrelationWindow();
+	if (key == "journal_size")
+		return confMgr->getIngestionJournalSize();
+	if (key == "group_commit_delay")
+		return confMgr->getGroupCommitDelay();
+	cut_fail("Unknown key: %s", key.c_str());
+	return 0;
+}
+
+static void addIntegerConfigData(const char *group, const char *key,
+                                 const size_t &defaultValue,
+                                 const size_t &validValue)
+{
+	const string validValueString = StringUtils::toString((uint64_t)validValue);
+	const struct {
+		const char *label;
+		const char *value;
+		size_t      expected;
+	} cases[] = {
+		{"Default",      NULL,                     defaultValue},
+		{"Valid",        validValueString.c_str(), validValue},
+		{"Negative",     "-1",                     defaultValue},
+		{"Not a number", "many",                   defaultValue},
+	};
+	for (size_t i = 0; i < G_N_ELEMENTS(cases); i++) {
+		string contents = StringUtils::sprintf("[%s]\n", group);
+		if (cases[i].value) {
+			contents += StringUtils::sprintf("%s=%s\n",
+			                                 key, cases[i].value);
+		}
+		const string label =
+		  StringUtils::sprintf("%s: %s", key, cases[i].label);
+		gcut_add_datum(label.c_str(),
+		               "contents", G_TYPE_STRING, contents.c_str(),
+		               "key", G_TYPE_STRING, key,
+		               "expected", G_TYPE_UINT64,
+		               (guint64)cases[i].expected,
+		               NULL);
+	}
+}
+
+void data_loadNonNegativeInteger(void)
+{
+	addIntegerConfigData("arm",       "scheduler_workers",  0,   4);
+	addIntegerConfigData("zabbix",    "max_connections",    4,   8);
+	addIntegerConfigData("history",   "cache_items",        0,   100);
+	addIntegerConfigData("event",     "correlation_window", 300, 60);
+	addIntegerConfigData("ingestion", "journal_size",       0,   16);
+	addIntegerConfigData("ingestion", "group_commit_delay", 0,   5);
+}
+
+void test_loadNonNegativeInteger(gconstpointer data)
+{
+	loadConfigFile(gcut_data_get_string(data, "contents"));
+	const size_t expected = gcut_data_get_uint64(data, "expected");
+	cppcut_assert_equal(expected,
+	                    getIntegerConfig(gcut_data_get_string(data, "key")));
+}
+
+void test_loadZabbixAPIMaxConnectionsWithZero(void)
+{
+	loadConfigFile("[zabbix]\n"
+	               "max_connections=0\n");
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal((size_t)4, confMgr->getZabbixAPIMaxConnections());
+}
+
+void test_loadAdaptivePollingDefault(void)
+{
+	loadConfigFile("[arm]\n");
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(false, confMgr->isAdaptivePollingEnabled());
+}
+
+void test_loadAdaptivePolling(void)
+{
+	loadConfigFile("[arm]\n"
+	               "adaptive_polling=true\n");
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(true, confMgr->isAdaptivePollingEnabled());
+}
+
+void test_loadAdaptivePollingWithInvalidWorkers(void)
+{
+	// An invalid key doesn't prevent the following keys from loading.
+	loadConfigFile("[arm]\n"
+	               "scheduler_workers=many\n"
+	               "adaptive_polling=true\n");
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(true, confMgr->isAdaptivePollingEnabled());
+}
+
+void test_loadAdaptivePollingWithInvalidValue(void)
+{
+	loadConfigFile("[arm]\n"
+	               "adaptive_polling=sometimes\n");
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(false, confMgr->isAdaptivePollingEnabled());
+}
+
+static void _assertEventFlapKeys(const size_t &window,
+                                 const size_t &startThreshold,
+                                 const size_t &stopThreshold)
+{
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(window, confMgr->getEventFlapWindow());
+	cppcut_assert_equal(startThreshold,
+	                    confMgr->getEventFlapStartThreshold());
+	cppcut_assert_equal(stopThreshold,
+	                    confMgr->getEventFlapStopThreshold());
+}
+#define assertEventFlapKeys(W, START, STOP) \
+cut_trace(_assertEventFlapKeys(W, START, STOP))
+
+void test_loadEventFlapKeysDefault(void)
+{
+	loadConfigFile("[event]\n");
+	assertEventFlapKeys(0, 6, 2);
+}
+
+void test_loadEventFlapKeys(void)
+{
+	loadConfigFile("[event]\n"
+	               "flap_window=300\n"
+	               "flap_start_changes=8\n"
+	               "flap_stop_changes=3\n");
+	assertEventFlapKeys(300, 8, 3);
+}
+
+void data_loadEventFlapKeysWithInvalidValue(void)
+{
+	gcut_add_datum("Negative window",
+	               "contents", G_TYPE_STRING, "flap_window=-1\n", NULL);
+	gcut_add_datum("Window not a number",
+	               "contents", G_TYPE_STRING, "flap_window=long\n", NULL);
+	gcut_add_datum("Start not a number",
+	               "contents", G_TYPE_STRING,
+	               "flap_start_changes=many\n", NULL);
+	gcut_add_datum("Negative stop",
+	               "contents", G_TYPE_STRING,
+	               "flap_stop_changes=-1\n", NULL);
+	gcut_add_datum("Stop not less than start",
+	               "contents", G_TYPE_STRING,
+	               "flap_window=300\nflap_start_changes=3\n"
+	               "flap_stop_changes=3\n", NULL);
+}
+
+void test_loadEventFlapKeysWithInvalidValue(gconstpointer data)
+{
+	const string contents = StringUtils::sprintf(
+	  "[event]\n%s", gcut_data_get_string(data, "contents"));
+	loadConfigFile(contents.c_str());
+	assertEventFlapKeys(0, 6, 2);
+}
+
+static void _assertEventAdmissionKeys(const size_t &rate,
+                                      const size_t &burst)
+{
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(rate, confMgr->getEventAdmissionRate());
+	cppcut_assert_equal(burst, confMgr->getEventAdmissionBurst());
+}
+#define assertEventAdmissionKeys(RATE, BURST) \
+cut_trace(_assertEventAdmissionKeys(RATE, BURST))
+
+void test_loadEventAdmissionKeysDefault(void)
+{
+	loadConfigFile("[event]\n");
+	assertEventAdmissionKeys(0, 1000);
+}
+
+void test_loadEventAdmissionKeys(void)
+{
+	loadConfigFile("[event]\n"
+	               "admission_rate=50\n"
+	               "admission_burst=200\n");
+	assertEventAdmissionKeys(50, 200);
+}
+
+void data_loadEventAdmissionKeysWithInvalidValue(void)
+{
+	gcut_add_datum("Negative rate",
+	               "contents", G_TYPE_STRING, "admission_rate=-1\n", NULL);
+	gcut_add_datum("Rate not a number",
+	               "contents", G_TYPE_STRING, "admission_rate=fast\n",
+	               NULL);
+	gcut_add_datum("Zero burst",
+	               "contents", G_TYPE_STRING,
+	               "admission_rate=50\nadmission_burst=0\n", NULL);
+	gcut_add_datum("Burst not a number",
+	               "contents", G_TYPE_STRING,
+	               "admission_burst=many\n", NULL);
+}
+
+void test_loadEventAdmissionKeysWithInvalidValue(gconstpointer data)
+{
+	const string contents = StringUtils::sprintf(
+	  "[event]\n%s", gcut_data_get_string(data, "contents"));
+	loadConfigFile(contents.c_str());
+	assertEventAdmissionKeys(0, 1000);
+}
+
 void test_parseConfigServerDefault(void)
 {
 	ConfigManager *confMgr = ConfigManager::getInstance();
@@ -175,6 +175,7 @@ struct AssertGetItemsArg
   : public AssertGetHostResourceArg<ItemInfo, ItemsQueryOption>
 {
 	string itemGroupName;
+	string textQuery;
 
 	AssertGetItemsArg(gconstpointer ddtParam)
 	{
@@ -188,6 +189,7 @@ struct AssertGetItemsArg
 		AssertGetHostResourceArg<ItemInfo, ItemsQueryOption>::
 			fixupOption();
 		option.setTargetItemGroupName(itemGroupName);
+		option.setTextQuery(textQuery);
 	}
 
 	virtual bool filterOutExpectedRecord(ItemInfo *info) override
@@ -202,6 +204,11 @@ struct AssertGetItemsArg
 			return true;
 		}
 
+		if (!textQuery.empty() &&
+		    info->brief.find(textQuery) == string::npos) {
+			return true;
+		}
+
 		if (filterForDataOfDefunctSv) {
 			if (!option.isValidServer(info->serverId))
 				return true;
@@ -675,6 +682,27 @@ void test_addItemInfoList(gconstpointer data)
 	assertGetItems(arg);
 }
 
+void test_addMonitoringData(void)
+{
+	DECLARE_DBTABLES_MONITORING(dbMonitoring);
+	TriggerInfoList triggerInfoList(testTriggerInfo,
+	                                testTriggerInfo + NumTestTriggerInfo);
+	EventInfoList eventInfoList(testEventInfo,
+	                            testEventInfo + NumTestEventInfo);
+	ItemInfoList itemInfoList(testItemInfo,
+	                          testItemInfo + NumTestItemInfo);
+	dbMonitoring.addMonitoringData(triggerInfoList, eventInfoList,
+	                               itemInfoList);
+
+	DBAgent &dbAgent = dbMonitoring.getDBAgent();
+	assertDBContent(&dbAgent, "select count(*) from triggers",
+	                StringUtils::toString(NumTestTriggerInfo));
+	assertDBContent(&dbAgent, "select count(*) from events",
+	                StringUtils::toString(NumTestEventInfo));
+	assertDBContent(&dbAgent, "select count(*) from items",
+	                StringUtils::toString(NumTestItemInfo));
+}
+
 void data_getItemsWithOneAuthorizedServer(gconstpointer data)
 {
 	prepareTestDataForFilterForDataOfDefunctServers();
@@ -723,6 +751,30 @@ void test_getItemWithItemGroupName(gconstpointer data)
 	assertGetItemsWithFilter(arg);
 }
 
+void data_getItemWithTextQuery(void)
+{
+	prepareTestDataForFilterForDataOfDefunctServers();
+}
+
+void test_getItemWithTextQuery(gconstpointer data)
+{
+	AssertGetItemsArg arg(data);
+	arg.textQuery = "Rome";
+	assertGetItemsWithFilter(arg);
+}
+
+void data_getItemWithUnmatchedTextQuery(void)
+{
+	prepareTestDataForFilterForDataOfDefunctServers();
+}
+
+void test_getItemWithUnmatchedTextQuery(gconstpointer data)
+{
+	AssertGetItemsArg arg(data);
+	arg.textQuery = "Kyoto";
+	assertGetItemsWithFilter(arg);
+}
+
 void data_getNumberOfItemsWithOneAuthorizedServer(gconstpointer data)
 {
 	prepareTestDataForFilterForDataOfDefunctServers();
@@ -858,6 +910,34 @@ void test_getTimeOfLastEventWithTriggerId(void)
 	  dbMonitoring.getTimeOfLastEvent(serverId, triggerId));
 }
 
+void test_getTimesOfLastEvents(void)
+{
+	loadTestDBEvents();
+
+	DECLARE_DBTABLES_MONITORING(dbMonitoring);
+	const ServerIdType serverId = 3;
+	set<TriggerIdType> triggerIdSet;
+	for (size_t i = 0; i < NumTestEventInfo; i++) {
+		if (testEventInfo[i].serverId == serverId)
+			triggerIdSet.insert(testEventInfo[i].triggerId);
+	}
+	cppcut_assert_equal(false, triggerIdSet.empty());
+	vector<TriggerIdType> triggerIds(triggerIdSet.rbegin(),
+	                                 triggerIdSet.rend());
+	const TriggerIdType unknownTriggerId = 0x123456789abcdef0;
+	triggerIds.push_back(unknownTriggerId);
+
+	vector<SmartTime> times;
+	dbMonitoring.getTimesOfLastEvents(serverId, triggerIds, times);
+	cppcut_assert_equal(triggerIds.size(), times.size());
+	for (size_t i = 0; i < triggerIds.size(); i++) {
+		cppcut_assert_equal(
+		  findTimeOfLastEvent(serverId, triggerIds[i]), times[i],
+		  cut_message("triggerId: %" FMT_TRIGGER_ID, triggerIds[i]));
+	}
+	cppcut_assert_equal(false, times.back().hasValidTime());
+}
+
 void data_getHostInfoList(void)
 {
 	prepareTestDataForFilterForDataOfDefunctServers();
@@ -1368,6 +1448,128 @@ void test_addHostgroupElement(void)
 	assertDBContent(&dbAgent, statement, expect);
 }
 
+void test_deleteHostgroupInfoList(void)
+{
+	DECLARE_DBTABLES_MONITORING(dbMonitoring);
+	HostgroupInfoList hostgroupInfoList, deletedList;
+	DBAgent &dbAgent = dbMonitoring.getDBAgent();
+	string statement = "select * from hostgroups;";
+	string expect;
+
+	cppcut_assert_equal(true, NumTestHostgroupInfo >= 2);
+	for (size_t i = 0; i < NumTestHostgroupInfo; i++) {
+		hostgroupInfoList.push_back(testHostgroupInfo[i]);
+		if (i == 0)
+			deletedList.push_back(testHostgroupInfo[i]);
+		else
+			expect += makeHostgroupsOutput(testHostgroupInfo[i], i);
+	}
+	dbMonitoring.addHostgroupInfoList(hostgroupInfoList);
+	dbMonitoring.deleteHostgroupInfoList(deletedList);
+	assertDBContent(&dbAgent, statement, expect);
+}
+
+void test_deleteHostgroupElementList(void)
+{
+	DECLARE_DBTABLES_MONITORING(dbMonitoring);
+	HostgroupElementList hostgroupElementList, deletedList;
+	DBAgent &dbAgent = dbMonitoring.getDBAgent();
+	string statement = "select * from map_hosts_hostgroups";
+	string expect;
+
+	cppcut_assert_equal(true, NumTestHostgroupElement >= 2);
+	for (size_t i = 0; i < NumTestHostgroupElement; i++) {
+		hostgroupElementList.push_back(testHostgroupElement[i]);
+		if (i == 0) {
+			deletedList.push_back(testHostgroupElement[i]);
+			continue;
+		}
+		expect += makeMapHostsHostgroupsOutput(
+		            testHostgroupElement[i], i);
+	}
+	dbMonitoring.addHostgroupElementList(hostgroupElementList);
+	dbMonitoring.deleteHostgroupElementList(deletedList);
+	assertDBContent(&dbAgent, statement, expect);
+}
+
+void test_updateHostgroups(void)
+{
+	DECLARE_DBTABLES_MONITORING(dbMonitoring);
+	const HostgroupInfo &removedGroup = testHostgroupInfo[0];
+	HostgroupInfoList hostgroupInfoList, newList;
+	for (size_t i = 0; i < NumTestHostgroupInfo; i++) {
+		const HostgroupInfo &groupInfo = testHostgroupInfo[i];
+		hostgroupInfoList.push_back(groupInfo);
+		if (i != 0 && groupInfo.serverId == removedGroup.serverId)
+			newList.push_back(groupInfo);
+	}
+	dbMonitoring.addHostgroupInfoList(hostgroupInfoList);
+	dbMonitoring.updateHostgroups(newList, removedGroup.serverId);
+
+	HostgroupsQueryOption option(USER_ID_SYSTEM);
+	HostgroupInfoList actualList;
+	dbMonitoring.getHostgroupInfoList(actualList, option);
+	cppcut_assert_equal(NumTestHostgroupInfo - 1, actualList.size());
+	HostgroupInfoListConstIterator it = actualList.begin();
+	for (; it != actualList.end(); ++it) {
+		cppcut_assert_equal(false,
+		                    it->serverId == removedGroup.serverId &&
+		                    it->groupId == removedGroup.groupId);
+	}
+}
+
+void test_updateHostgroupElements(void)
+{
+	DECLARE_DBTABLES_MONITORING(dbMonitoring);
+	const HostgroupElement &removedElement = testHostgroupElement[0];
+	HostgroupElementList hostgroupElementList, newList;
+	for (size_t i = 0; i < NumTestHostgroupElement; i++) {
+		const HostgroupElement &element = testHostgroupElement[i];
+		hostgroupElementList.push_back(element);
+		if (i != 0 && element.serverId == removedElement.serverId)
+			newList.push_back(element);
+	}
+	dbMonitoring.addHostgroupElementList(hostgroupElementList);
+	dbMonitoring.updateHostgroupElements(newList, removedElement.serverId);
+
+	HostgroupElementQueryOption option(USER_ID_SYSTEM);
+	HostgroupElementList actualList;
+	dbMonitoring.getHostgroupElementList(actualList, option);
+	cppcut_assert_equal(NumTestHostgroupElement - 1, actualList.size());
+	HostgroupElementListConstIterator it = actualList.begin();
+	for (; it != actualList.end(); ++it) {
+		cppcut_assert_equal(false,
+		                    it->serverId == removedElement.serverId &&
+		                    it->hostId == removedElement.hostId &&
+		                    it->groupId == removedElement.groupId);
+	}
+}
+
+void test_addAndDeleteHostDependency(void)
+{
+	DECLARE_DBTABLES_MONITORING(dbMonitoring);
+	HostDependency hostDependencies[] = {
+	  {AUTO_INCREMENT_VALUE, 1, 10, ALL_HOST_GROUPS, 100},
+	  {AUTO_INCREMENT_VALUE, 1, ALL_HOSTS, 2, 101},
+	};
+	dbMonitoring.addHostDependency(&hostDependencies[0]);
+	dbMonitoring.addHostDependency(&hostDependencies[1]);
+	cppcut_assert_equal(1, hostDependencies[0].id);
+	cppcut_assert_equal(2, hostDependencies[1].id);
+	dbMonitoring.deleteHostDependency(hostDependencies[0].id);
+
+	HostDependencyList hostDependencyList;
+	dbMonitoring.getHostDependencyList(hostDependencyList);
+	cppcut_assert_equal((size_t)1, hostDependencyList.size());
+	const HostDependency &actual = hostDependencyList.front();
+	cppcut_assert_equal(hostDependencies[1].id, actual.id);
+	cppcut_assert_equal(hostDependencies[1].serverId, actual.serverId);
+	cppcut_assert_equal(hostDependencies[1].hostId, actual.hostId);
+	cppcut_assert_equal(hostDependencies[1].groupId, actual.groupId);
+	cppcut_assert_equal(hostDependencies[1].parentHostId,
+	                    actual.parentHostId);
+}
+
 void test_addHostInfo(void)
 {
 	DECLARE_DBTABLES_MONITORING(dbMonitoring);
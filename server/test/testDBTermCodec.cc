@@ -80,6 +80,31 @@ void test_getUint64(gconstpointer data)
 	cppcut_assert_equal(expect, actual);
 }
 
+void data_getString(void)
+{
+	gcut_add_datum("Plain",
+		       "val", G_TYPE_STRING, "abc",
+		       "expect", G_TYPE_STRING, "'abc'",
+		       NULL);
+	gcut_add_datum("Quote",
+		       "val", G_TYPE_STRING, "a'b",
+		       "expect", G_TYPE_STRING, "'a''b'",
+		       NULL);
+	gcut_add_datum("Backslash",
+		       "val", G_TYPE_STRING, "a\\b\\",
+		       "expect", G_TYPE_STRING, "'a\\\\b\\\\'",
+		       NULL);
+}
+
+void test_getString(gconstpointer data)
+{
+	DBTermCodec dbTermCodec;
+	string actual =
+	  dbTermCodec.enc(string(gcut_data_get_string(data, "val")));
+	string expect = gcut_data_get_string(data, "expect");
+	cppcut_assert_equal(expect, actual);
+}
+
 } // testDBTermCodec
 
 namespace testDBTermCodecSQLite3 {
@@ -98,4 +123,26 @@ void test_getUint64(gconstpointer data)
 	cppcut_assert_equal(expect, actual);
 }
 
+void data_getString(void)
+{
+	gcut_add_datum("Quote",
+		       "val", G_TYPE_STRING, "a'b",
+		       "expect", G_TYPE_STRING, "'a''b'",
+		       NULL);
+	gcut_add_datum("Backslash",
+		       "val", G_TYPE_STRING, "a\\b",
+		       "expect", G_TYPE_STRING, "'a\\b'",
+		       NULL);
+}
+
+void test_getString(gconstpointer data)
+{
+	DBAgentSQLite3 dbAgent;
+	const DBTermCodec *dbTermCodec = dbAgent.getDBTermCodec();
+	string actual =
+	  dbTermCodec->enc(string(gcut_data_get_string(data, "val")));
+	string expect = gcut_data_get_string(data, "expect");
+	cppcut_assert_equal(expect, actual);
+}
+
 } // testDBTermCodecSQLite3
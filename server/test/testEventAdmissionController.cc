@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include <gcutter.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <StringUtils.h>
+#include "EventAdmissionController.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testEventAdmissionController {
+
+static const size_t RATE = 10;
+static const ServerIdType SERVER_ID = 1;
+static const ServerIdType OTHER_SERVER_ID = 2;
+
+static string g_spoolDir;
+
+static SmartTime makeTime(const time_t &sec, const long &msec = 0)
+{
+	timespec ts;
+	ts.tv_sec = sec;
+	ts.tv_nsec = msec * 1000 * 1000;
+	return SmartTime(ts);
+}
+
+static void appendEvents(EventInfoList &eventList,
+                         const EventIdType &firstId,
+                         const EventIdType &lastId,
+                         const ServerIdType &serverId = SERVER_ID)
+{
+	for (EventIdType id = firstId; id <= lastId; id++) {
+		EventInfo eventInfo;
+		initEventInfo(eventInfo);
+		eventInfo.serverId = serverId;
+		eventInfo.id = id;
+		eventInfo.time.tv_sec = 1000 + id;
+		eventInfo.type = EVENT_TYPE_BAD;
+		eventInfo.triggerId = 100 + id;
+		eventInfo.status = TRIGGER_STATUS_PROBLEM;
+		eventInfo.severity = TRIGGER_SEVERITY_WARNING;
+		eventInfo.hostId = 10;
+		eventInfo.hostName = StringUtils::sprintf(
+		  "host-%" FMT_EVENT_ID, id);
+		eventInfo.brief = StringUtils::sprintf(
+		  "brief-%" FMT_EVENT_ID, id);
+		eventList.push_back(eventInfo);
+	}
+}
+
+// Makes a string such as "1,2,3" from the IDs of the events.
+static string makeIdString(const EventInfoList &eventList)
+{
+	string str;
+	EventInfoListConstIterator it = eventList.begin();
+	for (; it != eventList.end(); ++it) {
+		if (!str.empty())
+			str += ",";
+		str += StringUtils::sprintf("%" FMT_EVENT_ID, it->id);
+	}
+	return str;
+}
+
+// The replayed events are regarded as stored.
+static string admit(EventAdmissionController &controller,
+                    const EventInfoList &eventList, const SmartTime &now)
+{
+	EventInfoList admittedEventList;
+	if (controller.admit(admittedEventList, eventList, now))
+		controller.finishReplay(true);
+	return makeIdString(admittedEventList);
+}
+
+static void assertStatistics(EventAdmissionController &controller,
+                             const size_t &numAdmitted,
+                             const size_t &numSpilled,
+                             const size_t &numReplayed,
+                             const size_t &numPending,
+                             const ServerIdType &serverId = SERVER_ID)
+{
+	const EventAdmissionController::Statistics statistics =
+	  controller.getStatistics(serverId);
+	cppcut_assert_equal(numAdmitted, statistics.numAdmitted);
+	cppcut_assert_equal(numSpilled, statistics.numSpilled);
+	cppcut_assert_equal(numReplayed, statistics.numReplayed);
+	cppcut_assert_equal(numPending, statistics.numPending);
+}
+
+static void removeSpool(const ServerIdType &serverId)
+{
+	const string path = StringUtils::sprintf(
+	  "%s/event-spool-%" FMT_SERVER_ID, g_spoolDir.c_str(), serverId);
+	remove(path.c_str());
+	remove((path + ".offset").c_str());
+}
+
+static off_t getSpoolSize(const ServerIdType &serverId = SERVER_ID)
+{
+	const string path = StringUtils::sprintf(
+	  "%s/event-spool-%" FMT_SERVER_ID, g_spoolDir.c_str(), serverId);
+	struct stat st;
+	cppcut_assert_equal(0, stat(path.c_str(), &st));
+	return st.st_size;
+}
+
+void cut_setup(void)
+{
+	g_spoolDir = StringUtils::sprintf(
+	  "/tmp/hatohol-test-event-spool-%d", getpid());
+	mkdir(g_spoolDir.c_str(), 0700);
+}
+
+void cut_teardown(void)
+{
+	removeSpool(SERVER_ID);
+	removeSpool(OTHER_SERVER_ID);
+	rmdir(g_spoolDir.c_str());
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_disabled(void)
+{
+	EventAdmissionController controller(0, 1, g_spoolDir);
+	cppcut_assert_equal(false, controller.isEnabled());
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 5);
+	cppcut_assert_equal(string("1,2,3,4,5"),
+	                    admit(controller, eventList, makeTime(0)));
+	assertStatistics(controller, 0, 0, 0, 0);
+}
+
+void test_spillOverBurst(void)
+{
+	EventAdmissionController controller(RATE, 3, g_spoolDir);
+	cppcut_assert_equal(true, controller.isEnabled());
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 5);
+	cppcut_assert_equal(string("1,2,3"),
+	                    admit(controller, eventList, makeTime(0)));
+	assertStatistics(controller, 3, 2, 0, 2);
+}
+
+void test_replayInOrder(void)
+{
+	EventAdmissionController controller(RATE, 2, g_spoolDir);
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 3);
+	cppcut_assert_equal(string("1,2"),
+	                    admit(controller, eventList, makeTime(0)));
+
+	// Only one token is refilled, which is used by the spooled event.
+	eventList.clear();
+	appendEvents(eventList, 4, 5);
+	cppcut_assert_equal(string("3"),
+	                    admit(controller, eventList, makeTime(0, 100)));
+	assertStatistics(controller, 2, 3, 1, 2);
+
+	// The new event waits for the next refill behind the spooled ones.
+	eventList.clear();
+	appendEvents(eventList, 6, 6);
+	cppcut_assert_equal(string("4,5"),
+	                    admit(controller, eventList, makeTime(10)));
+	assertStatistics(controller, 2, 4, 3, 1);
+}
+
+void test_replayWithoutNewEvents(void)
+{
+	EventAdmissionController controller(RATE, 2, g_spoolDir);
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 4);
+	cppcut_assert_equal(string("1,2"),
+	                    admit(controller, eventList, makeTime(0)));
+
+	eventList.clear();
+	appendEvents(eventList, 100, 100, OTHER_SERVER_ID);
+	cppcut_assert_equal(string("100,3,4"),
+	                    admit(controller, eventList, makeTime(10)));
+	assertStatistics(controller, 2, 2, 2, 0);
+	assertStatistics(controller, 1, 0, 0, 0, OTHER_SERVER_ID);
+}
+
+void test_disconnectEventIsNotLimited(void)
+{
+	EventAdmissionController controller(RATE, 1, g_spoolDir);
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 2);
+	appendEvents(eventList, DISCONNECT_SERVER_EVENT_ID,
+	             DISCONNECT_SERVER_EVENT_ID);
+	EventInfoList admittedEventList;
+	controller.admit(admittedEventList, eventList, makeTime(0));
+	cppcut_assert_equal((size_t)2, admittedEventList.size());
+	cppcut_assert_equal(DISCONNECT_SERVER_EVENT_ID,
+	                    admittedEventList.front().id);
+	assertStatistics(controller, 1, 1, 0, 1);
+}
+
+void test_getLastSpooledEventId(void)
+{
+	EventAdmissionController controller(RATE, 2, g_spoolDir);
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 4);
+	admit(controller, eventList, makeTime(0));
+	cppcut_assert_equal((EventIdType)4,
+	                    controller.getLastSpooledEventId(SERVER_ID));
+	cppcut_assert_equal(EVENT_NOT_FOUND,
+	                    controller.getLastSpooledEventId(OTHER_SERVER_ID));
+
+	admit(controller, EventInfoList(), makeTime(10));
+	cppcut_assert_equal(EVENT_NOT_FOUND,
+	                    controller.getLastSpooledEventId(SERVER_ID));
+}
+
+void test_saveReadOffsetAfterStored(void)
+{
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 3);
+	{
+		EventAdmissionController controller(RATE, 1, g_spoolDir);
+		cppcut_assert_equal(string("1"),
+		  admit(controller, eventList, makeTime(0)));
+		// Exit before the replayed event is stored.
+		EventInfoList admittedEventList;
+		cppcut_assert_equal(true,
+		  controller.admit(admittedEventList, EventInfoList(),
+		                   makeTime(0, 100)));
+		cppcut_assert_equal(string("2"),
+		                    makeIdString(admittedEventList));
+	}
+
+	// The spool is loaded when the arm gets the last event ID.
+	EventAdmissionController controller(RATE, 10, g_spoolDir);
+	cppcut_assert_equal((EventIdType)3,
+	                    controller.getLastSpooledEventId(SERVER_ID));
+	cppcut_assert_equal(string("2,3"),
+	                    admit(controller, EventInfoList(), makeTime(1)));
+}
+
+void test_replayAgainAfterFailure(void)
+{
+	EventAdmissionController controller(RATE, 1, g_spoolDir);
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 3);
+	cppcut_assert_equal(string("1"),
+	                    admit(controller, eventList, makeTime(0)));
+
+	EventInfoList admittedEventList;
+	cppcut_assert_equal(true,
+	  controller.admit(admittedEventList, EventInfoList(), makeTime(10)));
+	cppcut_assert_equal(string("2"), makeIdString(admittedEventList));
+	controller.finishReplay(false);
+	assertStatistics(controller, 1, 2, 0, 2);
+
+	cppcut_assert_equal(string("2"),
+	                    admit(controller, EventInfoList(), makeTime(20)));
+	assertStatistics(controller, 1, 2, 1, 1);
+}
+
+void test_newEventsWaitForReplayedEvents(void)
+{
+	EventAdmissionController controller(RATE, 2, g_spoolDir);
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 3);
+	cppcut_assert_equal(string("1,2"),
+	                    admit(controller, eventList, makeTime(0)));
+
+	EventInfoList admittedEventList;
+	cppcut_assert_equal(true,
+	  controller.admit(admittedEventList, EventInfoList(), makeTime(10)));
+	cppcut_assert_equal(string("3"), makeIdString(admittedEventList));
+
+	// Another caller doesn't get ahead of the replayed event.
+	eventList.clear();
+	appendEvents(eventList, 4, 4);
+	cppcut_assert_equal(string(""),
+	                    admit(controller, eventList, makeTime(10)));
+	controller.finishReplay(true);
+	cppcut_assert_equal(string("4"),
+	                    admit(controller, EventInfoList(), makeTime(20)));
+}
+
+void test_admitWhenSpoolIsFull(void)
+{
+	// Only the first spilled events are written.
+	EventAdmissionController controller(RATE, 1, g_spoolDir, 1);
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 3);
+	cppcut_assert_equal(string("1"),
+	                    admit(controller, eventList, makeTime(0)));
+	eventList.clear();
+	appendEvents(eventList, 4, 5);
+	cppcut_assert_equal(string("4,5"),
+	                    admit(controller, eventList, makeTime(0)));
+	assertStatistics(controller, 3, 2, 0, 2);
+}
+
+void test_notCountReplayedEventsInSpoolSize(void)
+{
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 2);
+	off_t recordSize;
+	{
+		EventAdmissionController controller(RATE, 1, g_spoolDir);
+		admit(controller, eventList, makeTime(0));
+		recordSize = getSpoolSize();
+		removeSpool(SERVER_ID);
+	}
+
+	// The replayed event 2 is kept in the spool file, since its size
+	// is less than half of the maximum size.
+	EventAdmissionController controller(RATE, 1, g_spoolDir,
+	                                    recordSize * 2 + 2);
+	eventList.clear();
+	appendEvents(eventList, 1, 3);
+	cppcut_assert_equal(string("1"),
+	                    admit(controller, eventList, makeTime(0)));
+	cppcut_assert_equal(string("2"),
+	  admit(controller, EventInfoList(), makeTime(0, 100)));
+	for (EventIdType id = 4; id <= 5; id++) {
+		eventList.clear();
+		appendEvents(eventList, id, id);
+		cppcut_assert_equal(string(""),
+		  admit(controller, eventList, makeTime(0, 100)));
+	}
+	cppcut_assert_equal(recordSize * 4, getSpoolSize());
+	assertStatistics(controller, 1, 4, 1, 3);
+}
+
+void test_compactSpool(void)
+{
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 4);
+	{
+		EventAdmissionController controller(RATE, 1, g_spoolDir, 1);
+		cppcut_assert_equal(string("1"),
+		  admit(controller, eventList, makeTime(0)));
+		const off_t spoolSize = getSpoolSize();
+		cppcut_assert_equal(string("2"),
+		  admit(controller, EventInfoList(), makeTime(0, 100)));
+		cppcut_assert_equal(spoolSize / 3 * 2, getSpoolSize());
+	}
+
+	EventAdmissionController controller(RATE, 10, g_spoolDir);
+	cppcut_assert_equal((EventIdType)4,
+	                    controller.getLastSpooledEventId(SERVER_ID));
+	cppcut_assert_equal(string("3,4"),
+	                    admit(controller, EventInfoList(), makeTime(1)));
+}
+
+void test_takeOverSpoolAfterRestart(void)
+{
+	EventInfoList eventList;
+	appendEvents(eventList, 1, 5);
+	{
+		EventAdmissionController controller(RATE, 1, g_spoolDir);
+		cppcut_assert_equal(string("1"),
+		  admit(controller, eventList, makeTime(0)));
+		cppcut_assert_equal(string("2"),
+		  admit(controller, EventInfoList(), makeTime(0, 100)));
+	}
+
+	EventAdmissionController controller(RATE, 10, g_spoolDir);
+	EventInfoList admittedEventList;
+	eventList.clear();
+	appendEvents(eventList, 6, 6);
+	cppcut_assert_equal((EventIdType)5,
+	                    controller.getLastSpooledEventId(SERVER_ID));
+	controller.admit(admittedEventList, eventList, makeTime(1));
+	assertStatistics(controller, 1, 0, 3, 0);
+
+	EventInfoList expectedEventList;
+	appendEvents(expectedEventList, 3, 6);
+	cppcut_assert_equal(expectedEventList.size(), admittedEventList.size());
+	EventInfoListConstIterator expectedIt = expectedEventList.begin();
+	EventInfoListConstIterator actualIt = admittedEventList.begin();
+	for (; expectedIt != expectedEventList.end();
+	     ++expectedIt, ++actualIt) {
+		cppcut_assert_equal(expectedIt->serverId, actualIt->serverId);
+		cppcut_assert_equal(expectedIt->id, actualIt->id);
+		cppcut_assert_equal(expectedIt->time.tv_sec,
+		                    actualIt->time.tv_sec);
+		cppcut_assert_equal(expectedIt->type, actualIt->type);
+		cppcut_assert_equal(expectedIt->triggerId, actualIt->triggerId);
+		cppcut_assert_equal(expectedIt->status, actualIt->status);
+		cppcut_assert_equal(expectedIt->severity, actualIt->severity);
+		cppcut_assert_equal(expectedIt->hostId, actualIt->hostId);
+		cppcut_assert_equal(expectedIt->hostName, actualIt->hostName);
+		cppcut_assert_equal(expectedIt->brief, actualIt->brief);
+	}
+}
+
+} // namespace testEventAdmissionController
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include <gcutter.h>
+#include "EventCorrelator.h"
+#include "ThreadLocalDBCache.h"
+#include "Hatohol.h"
+#include "DBTablesTest.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testEventCorrelator {
+
+static const size_t WINDOW = 60;
+static const ServerIdType SERVER_ID = 1;
+static const HostIdType PARENT_HOST_ID = 100;
+static const HostIdType CHILD_HOST_ID = 10;
+static const HostIdType OTHER_HOST_ID = 30;
+static const TriggerIdType PARENT_TRIGGER_ID = 1000;
+
+static EventIdType g_eventId = 1;
+
+static void addDependency(const HostIdType &hostId,
+                          const HostgroupIdType &groupId,
+                          const HostIdType &parentHostId)
+{
+	HostDependency hostDependency;
+	hostDependency.id = AUTO_INCREMENT_VALUE;
+	hostDependency.serverId = SERVER_ID;
+	hostDependency.hostId = hostId;
+	hostDependency.groupId = groupId;
+	hostDependency.parentHostId = parentHostId;
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().addHostDependency(&hostDependency);
+}
+
+static void appendEvent(EventInfoList &eventList, const time_t &time,
+                        const HostIdType &hostId,
+                        const TriggerStatusType &status,
+                        const TriggerIdType &triggerId = 1)
+{
+	EventInfo eventInfo;
+	initEventInfo(eventInfo);
+	eventInfo.serverId = SERVER_ID;
+	eventInfo.id = g_eventId++;
+	eventInfo.time.tv_sec = time;
+	eventInfo.hostId = hostId;
+	eventInfo.triggerId = triggerId;
+	eventInfo.status = status;
+	eventInfo.type = (status == TRIGGER_STATUS_OK) ?
+	                 EVENT_TYPE_GOOD : EVENT_TYPE_BAD;
+	eventList.push_back(eventInfo);
+}
+
+static void appendParentEvent(EventInfoList &eventList, const time_t &time,
+                              const TriggerStatusType &status)
+{
+	appendEvent(eventList, time, PARENT_HOST_ID, status,
+	            PARENT_TRIGGER_ID);
+}
+
+// Makes a string such as "RSN" from the correlations of the events.
+static string correlate(EventCorrelator &correlator, EventInfoList &eventList)
+{
+	correlator.correlate(eventList);
+	string str;
+	EventInfoListConstIterator it = eventList.begin();
+	for (; it != eventList.end(); ++it) {
+		switch (it->correlation) {
+		case EVENT_CORRELATION_NONE:
+			str += "N";
+			break;
+		case EVENT_CORRELATION_ROOT_CAUSE:
+			str += "R";
+			break;
+		case EVENT_CORRELATION_SYMPTOM:
+			str += "S";
+			break;
+		default:
+			str += "?";
+		}
+	}
+	return str;
+}
+
+void cut_setup(void)
+{
+	hatoholInit();
+	setupTestDB();
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_withoutDependencies(void)
+{
+	EventCorrelator correlator(WINDOW);
+	EventInfoList eventList;
+	appendParentEvent(eventList, 1000, TRIGGER_STATUS_PROBLEM);
+	appendEvent(eventList, 1010, CHILD_HOST_ID, TRIGGER_STATUS_PROBLEM);
+	cppcut_assert_equal(string("NN"), correlate(correlator, eventList));
+}
+
+void test_symptom(void)
+{
+	addDependency(CHILD_HOST_ID, ALL_HOST_GROUPS, PARENT_HOST_ID);
+	EventCorrelator correlator(WINDOW);
+	EventInfoList eventList;
+	appendParentEvent(eventList, 1000, TRIGGER_STATUS_PROBLEM);
+	appendEvent(eventList, 1010, CHILD_HOST_ID, TRIGGER_STATUS_PROBLEM);
+	appendEvent(eventList, 1020, OTHER_HOST_ID, TRIGGER_STATUS_PROBLEM);
+	cppcut_assert_equal(string("RSN"), correlate(correlator, eventList));
+
+	// The recovery of the symptom is also a symptom.
+	eventList.clear();
+	appendEvent(eventList, 1030, CHILD_HOST_ID, TRIGGER_STATUS_OK);
+	appendParentEvent(eventList, 1040, TRIGGER_STATUS_OK);
+	cppcut_assert_equal(string("SN"), correlate(correlator, eventList));
+}
+
+void test_symptomReceivedBeforeCause(void)
+{
+	addDependency(CHILD_HOST_ID, ALL_HOST_GROUPS, PARENT_HOST_ID);
+	EventCorrelator correlator(WINDOW);
+	EventInfoList eventList;
+	appendEvent(eventList, 1000, CHILD_HOST_ID, TRIGGER_STATUS_PROBLEM);
+	appendParentEvent(eventList, 1005, TRIGGER_STATUS_PROBLEM);
+	cppcut_assert_equal(string("SR"), correlate(correlator, eventList));
+}
+
+void test_problemOfChildWithoutCause(void)
+{
+	addDependency(CHILD_HOST_ID, ALL_HOST_GROUPS, PARENT_HOST_ID);
+	EventCorrelator correlator(WINDOW);
+	EventInfoList eventList;
+	appendEvent(eventList, 1000, CHILD_HOST_ID, TRIGGER_STATUS_PROBLEM);
+	appendEvent(eventList, 1010, CHILD_HOST_ID, TRIGGER_STATUS_OK);
+	cppcut_assert_equal(string("NN"), correlate(correlator, eventList));
+}
+
+void data_recoveredCause(void)
+{
+	gcut_add_datum("In the window",
+	               "delay", G_TYPE_INT, (gint)WINDOW,
+	               "expected", G_TYPE_STRING, "RNS",
+	               NULL);
+	gcut_add_datum("After the window",
+	               "delay", G_TYPE_INT, (gint)WINDOW + 1,
+	               "expected", G_TYPE_STRING, "RNN",
+	               NULL);
+}
+
+void test_recoveredCause(gconstpointer data)
+{
+	addDependency(CHILD_HOST_ID, ALL_HOST_GROUPS, PARENT_HOST_ID);
+	EventCorrelator correlator(WINDOW);
+	EventInfoList eventList;
+	appendParentEvent(eventList, 1000, TRIGGER_STATUS_PROBLEM);
+	appendParentEvent(eventList, 1010, TRIGGER_STATUS_OK);
+	appendEvent(eventList, 1010 + gcut_data_get_int(data, "delay"),
+	            CHILD_HOST_ID, TRIGGER_STATUS_PROBLEM);
+	cppcut_assert_equal(string(gcut_data_get_string(data, "expected")),
+	                    correlate(correlator, eventList));
+}
+
+void test_dependencyOfHostgroup(void)
+{
+	HostgroupElement hostgroupElement;
+	hostgroupElement.id = AUTO_INCREMENT_VALUE;
+	hostgroupElement.serverId = SERVER_ID;
+	hostgroupElement.hostId = CHILD_HOST_ID;
+	hostgroupElement.groupId = 2;
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().addHostgroupElement(&hostgroupElement);
+	addDependency(ALL_HOSTS, 2, PARENT_HOST_ID);
+
+	EventCorrelator correlator(WINDOW);
+	EventInfoList eventList;
+	appendParentEvent(eventList, 1000, TRIGGER_STATUS_PROBLEM);
+	appendEvent(eventList, 1010, CHILD_HOST_ID, TRIGGER_STATUS_PROBLEM);
+	appendEvent(eventList, 1010, OTHER_HOST_ID, TRIGGER_STATUS_PROBLEM);
+	cppcut_assert_equal(string("RSN"), correlate(correlator, eventList));
+}
+
+void test_hostOfTrigger(void)
+{
+	TriggerInfo triggerInfo = testTriggerInfo[0];
+	triggerInfo.serverId = SERVER_ID;
+	triggerInfo.id = 2000;
+	triggerInfo.hostId = CHILD_HOST_ID;
+	triggerInfo.status = TRIGGER_STATUS_OK;
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().addTriggerInfo(&triggerInfo);
+	addDependency(CHILD_HOST_ID, ALL_HOST_GROUPS, PARENT_HOST_ID);
+
+	// The host of the event is taken from the trigger.
+	EventCorrelator correlator(WINDOW);
+	EventInfoList eventList;
+	appendParentEvent(eventList, 1000, TRIGGER_STATUS_PROBLEM);
+	appendEvent(eventList, 1010, INVALID_HOST_ID, TRIGGER_STATUS_PROBLEM,
+	            triggerInfo.id);
+	appendEvent(eventList, 1020, INVALID_HOST_ID, TRIGGER_STATUS_PROBLEM,
+	            triggerInfo.id + 1);
+	cppcut_assert_equal(string("RSN"), correlate(correlator, eventList));
+	cppcut_assert_equal(INVALID_HOST_ID, eventList.back().hostId);
+}
+
+void test_reloadAddedDependency(void)
+{
+	EventCorrelator correlator(WINDOW);
+	EventInfoList eventList;
+	appendParentEvent(eventList, 1000, TRIGGER_STATUS_PROBLEM);
+	cppcut_assert_equal(string("N"), correlate(correlator, eventList));
+
+	addDependency(CHILD_HOST_ID, ALL_HOST_GROUPS, PARENT_HOST_ID);
+	eventList.clear();
+	appendParentEvent(eventList, 1010, TRIGGER_STATUS_PROBLEM);
+	appendEvent(eventList, 1020, CHILD_HOST_ID, TRIGGER_STATUS_PROBLEM);
+	cppcut_assert_equal(string("RS"), correlate(correlator, eventList));
+}
+
+} // namespace testEventCorrelator
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cppcutter.h>
+#include <StringUtils.h>
+#include "EventFlapDetector.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testEventFlapDetector {
+
+static const size_t WINDOW = 60;
+static const size_t START_THRESHOLD = 4;
+static const size_t STOP_THRESHOLD = 1;
+
+static string g_stateDir;
+
+static EventInfo makeEvent(const EventIdType &id, const time_t &time,
+                           const TriggerStatusType &status,
+                           const TriggerIdType &triggerId = 10)
+{
+	EventInfo eventInfo;
+	initEventInfo(eventInfo);
+	eventInfo.serverId = 1;
+	eventInfo.id = id;
+	eventInfo.time.tv_sec = time;
+	eventInfo.time.tv_nsec = 0;
+	eventInfo.triggerId = triggerId;
+	eventInfo.status = status;
+	eventInfo.type = (status == TRIGGER_STATUS_OK) ?
+	                 EVENT_TYPE_GOOD : EVENT_TYPE_BAD;
+	return eventInfo;
+}
+
+// Makes a string such as "1:B 2:G 3:F" from IDs and types of the events.
+static string toString(const EventInfoList &eventList)
+{
+	string str;
+	EventInfoListConstIterator it = eventList.begin();
+	for (; it != eventList.end(); ++it) {
+		const char type = (it->type == EVENT_TYPE_GOOD) ? 'G' :
+		                  (it->type == EVENT_TYPE_BAD)  ? 'B' :
+		                  (it->type == EVENT_TYPE_FLAPPING) ? 'F' : '?';
+		if (!str.empty())
+			str += " ";
+		str += StringUtils::sprintf("%" PRIu64 ":%c", it->id, type);
+	}
+	return str;
+}
+
+// Adds events of the trigger that changes its state every second
+// from the time 'begin'.
+static void appendFlappingEvents(EventInfoList &eventList,
+                                 const EventIdType &firstId,
+                                 const size_t &numEvents,
+                                 const time_t &begin)
+{
+	for (size_t i = 0; i < numEvents; i++) {
+		const TriggerStatusType status = (i % 2) ?
+		  TRIGGER_STATUS_OK : TRIGGER_STATUS_PROBLEM;
+		eventList.push_back(makeEvent(firstId + i, begin + i, status));
+	}
+}
+
+static void filter(EventFlapDetector &detector,
+                   string &stored, string &dispatched,
+                   const EventInfoList &eventList)
+{
+	EventInfoList storedEventList;
+	EventInfoList dispatchedEventList;
+	detector.filter(storedEventList, dispatchedEventList, eventList);
+	stored = toString(storedEventList);
+	dispatched = toString(dispatchedEventList);
+}
+
+static void settle(EventFlapDetector &detector,
+                   string &stored, string &dispatched, const time_t &now)
+{
+	EventInfoList storedEventList;
+	EventInfoList dispatchedEventList;
+	detector.settle(storedEventList, dispatchedEventList, now);
+	stored = toString(storedEventList);
+	dispatched = toString(dispatchedEventList);
+}
+
+void cut_setup(void)
+{
+	g_stateDir = StringUtils::sprintf(
+	  "/tmp/hatohol-test-event-flap-%d", getpid());
+	mkdir(g_stateDir.c_str(), 0700);
+}
+
+void cut_teardown(void)
+{
+	remove((g_stateDir + "/event-flap-state").c_str());
+	rmdir(g_stateDir.c_str());
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_disabled(void)
+{
+	EventFlapDetector detector(0, START_THRESHOLD, STOP_THRESHOLD);
+	cppcut_assert_equal(false, detector.isEnabled());
+
+	EventInfoList eventList;
+	appendFlappingEvents(eventList, 1, 8, 1000);
+	string stored, dispatched;
+	filter(detector, stored, dispatched, eventList);
+	cppcut_assert_equal(toString(eventList), stored);
+	cppcut_assert_equal(toString(eventList), dispatched);
+}
+
+void test_notFlapping(void)
+{
+	EventFlapDetector detector(WINDOW, START_THRESHOLD, STOP_THRESHOLD);
+	EventInfoList eventList;
+	eventList.push_back(makeEvent(1, 1000, TRIGGER_STATUS_PROBLEM));
+	eventList.push_back(makeEvent(2, 1030, TRIGGER_STATUS_OK));
+	eventList.push_back(makeEvent(3, 1070, TRIGGER_STATUS_PROBLEM));
+	eventList.push_back(makeEvent(4, 1110, TRIGGER_STATUS_OK));
+	eventList.push_back(makeEvent(5, 1150, TRIGGER_STATUS_PROBLEM));
+	string stored, dispatched;
+	filter(detector, stored, dispatched, eventList);
+	cppcut_assert_equal(string("1:B 2:G 3:B 4:G 5:B"), stored);
+	cppcut_assert_equal(stored, dispatched);
+	cppcut_assert_equal((size_t)0, detector.getNumberOfFlappingTriggers());
+}
+
+void test_startFlapping(void)
+{
+	EventFlapDetector detector(WINDOW, START_THRESHOLD, STOP_THRESHOLD);
+	EventInfoList eventList;
+	appendFlappingEvents(eventList, 1, 8, 1000);
+	string stored, dispatched;
+	filter(detector, stored, dispatched, eventList);
+	// The 4th state change is the 5th event.
+	cppcut_assert_equal(string("1:B 2:G 3:B 4:G 5:F"), stored);
+	cppcut_assert_equal(string("1:B 2:G 3:B 4:G"), dispatched);
+	cppcut_assert_equal((size_t)1, detector.getNumberOfFlappingTriggers());
+}
+
+void test_otherTriggerIsNotSuppressed(void)
+{
+	EventFlapDetector detector(WINDOW, START_THRESHOLD, STOP_THRESHOLD);
+	EventInfoList eventList;
+	appendFlappingEvents(eventList, 1, 8, 1000);
+	eventList.push_back(makeEvent(9, 1009, TRIGGER_STATUS_PROBLEM, 20));
+	string stored, dispatched;
+	filter(detector, stored, dispatched, eventList);
+	cppcut_assert_equal(string("1:B 2:G 3:B 4:G 5:F 9:B"), stored);
+	cppcut_assert_equal(string("1:B 2:G 3:B 4:G 9:B"), dispatched);
+}
+
+void test_stopFlapping(void)
+{
+	EventFlapDetector detector(WINDOW, START_THRESHOLD, STOP_THRESHOLD);
+	EventInfoList eventList;
+	appendFlappingEvents(eventList, 1, 8, 1000);
+	string stored, dispatched;
+	filter(detector, stored, dispatched, eventList);
+
+	// Still flapping: the state changes before 1007 are in the window.
+	eventList.clear();
+	eventList.push_back(makeEvent(20, 1050, TRIGGER_STATUS_PROBLEM, 20));
+	filter(detector, stored, dispatched, eventList);
+	cppcut_assert_equal(string("20:B"), stored);
+	cppcut_assert_equal((size_t)1, detector.getNumberOfFlappingTriggers());
+
+	// The last dropped event (8: OK) is stored as the settled state.
+	// It is not passed to the actions that have got OK with the event 4.
+	eventList.clear();
+	eventList.push_back(makeEvent(21, 1067, TRIGGER_STATUS_OK, 20));
+	filter(detector, stored, dispatched, eventList);
+	cppcut_assert_equal(string("21:G 8:G"), stored);
+	cppcut_assert_equal(string("21:G"), dispatched);
+	cppcut_assert_equal((size_t)0, detector.getNumberOfFlappingTriggers());
+}
+
+void test_stopFlappingInAnotherState(void)
+{
+	EventFlapDetector detector(WINDOW, START_THRESHOLD, STOP_THRESHOLD);
+	EventInfoList eventList;
+	appendFlappingEvents(eventList, 1, 9, 1000);
+	string stored, dispatched;
+	filter(detector, stored, dispatched, eventList);
+
+	// The trigger settles in PROBLEM while the actions have got OK
+	// with the event 4.
+	eventList.clear();
+	eventList.push_back(makeEvent(20, 1100, TRIGGER_STATUS_OK, 20));
+	filter(detector, stored, dispatched, eventList);
+	cppcut_assert_equal(string("20:G 9:B"), stored);
+	cppcut_assert_equal(string("20:G 9:B"), dispatched);
+}
+
+void test_stopFlappingWithoutDroppedEvents(void)
+{
+	EventFlapDetector detector(WINDOW, START_THRESHOLD, STOP_THRESHOLD);
+	EventInfoList eventList;
+	appendFlappingEvents(eventList, 1, 5, 1000);
+	string stored, dispatched;
+	filter(detector, stored, dispatched, eventList);
+	cppcut_assert_equal(string("1:B 2:G 3:B 4:G 5:F"), stored);
+
+	// The event 5 has been stored as the flapping event. It is only
+	// passed to the actions.
+	eventList.clear();
+	eventList.push_back(makeEvent(20, 1100, TRIGGER_STATUS_OK, 20));
+	filter(detector, stored, dispatched, eventList);
+	cppcut_assert_equal(string("20:G"), stored);
+	cppcut_assert_equal(string("20:G 5:B"), dispatched);
+}
+
+void test_disconnectEventIsNotSuppressed(void)
+{
+	EventFlapDetector detector(WINDOW, START_THRESHOLD, STOP_THRESHOLD);
+	EventInfoList eventList;
+	for (size_t i = 0; i < 8; i++) {
+		const TriggerStatusType status = (i % 2) ?
+		  TRIGGER_STATUS_OK : TRIGGER_STATUS_PROBLEM;
+		eventList.push_back(makeEvent(DISCONNECT_SERVER_EVENT_ID,
+		                              1000 + i, status));
+	}
+	string stored, dispatched;
+	filter(detector, stored, dispatched, eventList);
+	cppcut_assert_equal(toString(eventList), stored);
+	cppcut_assert_equal(toString(eventList), dispatched);
+}
+
+void test_settleWithoutEvents(void)
+{
+	EventFlapDetector detector(WINDOW, START_THRESHOLD, STOP_THRESHOLD);
+	EventInfoList eventList;
+	appendFlappingEvents(eventList, 1, 8, 1000);
+	string stored, dispatched;
+	filter(detector, stored, dispatched, eventList);
+
+	// The clock of the server goes on without events.
+	const time_t now = time(NULL);
+	settle(detector, stored, dispatched, now);
+	cppcut_assert_equal(string(""), stored);
+	cppcut_assert_equal((size_t)1, detector.getNumberOfFlappingTriggers());
+
+	settle(detector, stored, dispatched, now + WINDOW);
+	cppcut_assert_equal(string("8:G"), stored);
+	cppcut_assert_equal(string(""), dispatched);
+	cppcut_assert_equal((size_t)0, detector.getNumberOfFlappingTriggers());
+}
+
+void test_takeOverFlappingTriggers(void)
+{
+	{
+		EventFlapDetector detector(WINDOW, START_THRESHOLD,
+		                           STOP_THRESHOLD, g_stateDir);
+		EventInfoList eventList;
+		appendFlappingEvents(eventList, 1, 9, 1000);
+		string stored, dispatched;
+		filter(detector, stored, dispatched, eventList);
+		cppcut_assert_equal(string("1:B 2:G 3:B 4:G 5:F"), stored);
+
+		// The state file is written by settle(), not by filter().
+		const string statePath = g_stateDir + "/event-flap-state";
+		struct stat st;
+		cppcut_assert_equal(-1, stat(statePath.c_str(), &st));
+		settle(detector, stored, dispatched, time(NULL));
+		cppcut_assert_equal(0, stat(statePath.c_str(), &st));
+	}
+
+	// The dropped event 9 is given after the restart.
+	EventFlapDetector detector(WINDOW, START_THRESHOLD, STOP_THRESHOLD,
+	                           g_stateDir);
+	cppcut_assert_equal((size_t)1, detector.getNumberOfFlappingTriggers());
+	string stored, dispatched;
+	settle(detector, stored, dispatched, time(NULL) + WINDOW);
+	cppcut_assert_equal(string("9:B"), stored);
+	cppcut_assert_equal(string("9:B"), dispatched);
+
+	// The state file is removed when no trigger is flapping.
+	EventFlapDetector restartedDetector(WINDOW, START_THRESHOLD,
+	                                    STOP_THRESHOLD, g_stateDir);
+	cppcut_assert_equal(
+	  (size_t)0, restartedDetector.getNumberOfFlappingTriggers());
+}
+
+} // namespace testEventFlapDetector
@@ -18,6 +18,7 @@
  */
 
 #include <cppcutter.h>
+#include <gcutter.h>
 #include "Hatohol.h"
 #include "FaceRest.h"
 #include "Helpers.h"
@@ -26,6 +27,9 @@
 #include "testDBTablesMonitoring.h"
 #include "FaceRestTestUtils.h"
 #include "ThreadLocalDBCache.h"
+#include "ConfigManager.h"
+#include "HistoryCache.h"
+#include "RestResourceHost.h"
 using namespace std;
 using namespace mlpl;
 
@@ -507,6 +511,9 @@ void cut_teardown(void)
 
 	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
 	dataStore->setCopyOnDemandEnabled(false);
+
+	ConfigManager::getInstance()->setNumberOfHistoryCacheItems(0);
+	HistoryCache::reset();
 }
 
 void test_hosts(void)
@@ -640,6 +647,66 @@ void test_getHistoryWithMinimumParameter(void)
 	// TODO: check contents
 }
 
+void data_getHistoryWithDownsamplingParameter(void)
+{
+	gcut_add_datum("maxPoints",
+	               "parameters", G_TYPE_STRING, "maxPoints=100",
+	               "errorCode", G_TYPE_INT, HTERR_OK,
+	               NULL);
+	gcut_add_datum("maxPoints and aggregation",
+	               "parameters", G_TYPE_STRING,
+	               "maxPoints=100&aggregation=minmax",
+	               "errorCode", G_TYPE_INT, HTERR_OK,
+	               NULL);
+	gcut_add_datum("maxPoints and resolution",
+	               "parameters", G_TYPE_STRING,
+	               "maxPoints=10&resolution=600",
+	               "errorCode", G_TYPE_INT, HTERR_OK,
+	               NULL);
+	gcut_add_datum("Invalid maxPoints",
+	               "parameters", G_TYPE_STRING, "maxPoints=many",
+	               "errorCode", G_TYPE_INT, HTERR_INVALID_PARAMETER,
+	               NULL);
+	gcut_add_datum("Unknown aggregation",
+	               "parameters", G_TYPE_STRING,
+	               "maxPoints=100&aggregation=median",
+	               "errorCode", G_TYPE_INT, HTERR_INVALID_PARAMETER,
+	               NULL);
+	gcut_add_datum("Invalid resolution",
+	               "parameters", G_TYPE_STRING, "resolution=7",
+	               "errorCode", G_TYPE_INT, HTERR_INVALID_PARAMETER,
+	               NULL);
+}
+
+void test_getHistoryWithDownsamplingParameter(gconstpointer data)
+{
+	startFaceRest();
+	loadTestDBItems();
+
+	RequestArg arg("/history");
+	StringMap params;
+	params["serverId"] = StringUtils::toString(testItemInfo[0].serverId);
+	params["itemId"] = StringUtils::toString(testItemInfo[0].id);
+	StringVector words;
+	StringUtils::split(words, gcut_data_get_string(data, "parameters"),
+	                   '&');
+	for (size_t i = 0; i < words.size(); i++) {
+		const size_t pos = words[i].find('=');
+		params[words[i].substr(0, pos)] = words[i].substr(pos + 1);
+	}
+	arg.parameters = params;
+	arg.userId = findUserWith(OPPRVLG_GET_ALL_SERVER);
+	JSONParser *parser = getResponseAsJSONParser(arg);
+	unique_ptr<JSONParser> parserPtr(parser);
+	const HatoholErrorCode expectedCode =
+	  static_cast<HatoholErrorCode>(gcut_data_get_int(data, "errorCode"));
+	assertErrorCode(parser, expectedCode);
+	if (expectedCode != HTERR_OK)
+		return;
+	cppcut_assert_equal(true, parser->startObject("history"));
+	parser->endObject();
+}
+
 void test_getHistoryWithInvalidItemId(void)
 {
 	startFaceRest();
@@ -655,4 +722,120 @@ void test_getHistoryWithInvalidItemId(void)
 	assertErrorCode(parser, HTERR_NOT_FOUND_TARGET_RECORD);
 }
 
+void test_getHistoryOfItems(void)
+{
+	startFaceRest();
+	loadTestDBItems();
+
+	// The samples of the integer item are taken from the cache. The
+	// other item has no data store and no sample.
+	const time_t beginTime = 1400000000;
+	const time_t endTime = beginTime + 120;
+	ConfigManager::getInstance()->setNumberOfHistoryCacheItems(10);
+	HistoryCache::reset();
+	const ItemInfo &cachedItemInfo = testItemInfo[1];
+	cppcut_assert_equal(ITEM_INFO_VALUE_TYPE_INTEGER,
+	                    cachedItemInfo.valueType);
+	HistoryInfoVect historyInfoVect;
+	for (int i = 0; i < 3; i++) {
+		HistoryInfo historyInfo;
+		historyInfo.serverId = cachedItemInfo.serverId;
+		historyInfo.itemId = cachedItemInfo.id;
+		historyInfo.value = StringUtils::toString(i + 10);
+		historyInfo.clock.tv_sec = beginTime + i * 60;
+		historyInfo.clock.tv_nsec = 0;
+		historyInfoVect.push_back(historyInfo);
+	}
+	HistoryCache::getInstance()->add(cachedItemInfo, beginTime, endTime,
+	                                 historyInfoVect);
+
+	// The same item is returned once.
+	RequestArg arg("/history");
+	StringMap params;
+	const size_t indexes[] = {1, 0, 1};
+	string items;
+	for (size_t i = 0; i < 3; i++) {
+		const ItemInfo &itemInfo = testItemInfo[indexes[i]];
+		if (!items.empty())
+			items += ",";
+		items += StringUtils::sprintf(
+		  "%" FMT_SERVER_ID ":%" FMT_ITEM_ID,
+		  itemInfo.serverId, itemInfo.id);
+	}
+	params["items"] = items;
+	params["beginTime"] = StringUtils::sprintf("%ld", beginTime);
+	params["endTime"] = StringUtils::sprintf("%ld", endTime);
+	arg.parameters = params;
+	arg.userId = findUserWith(OPPRVLG_GET_ALL_SERVER);
+	JSONParser *parser = getResponseAsJSONParser(arg);
+	unique_ptr<JSONParser> parserPtr(parser);
+	assertErrorCode(parser, HTERR_OK);
+
+	cppcut_assert_equal(true, parser->startObject("histories"));
+	cppcut_assert_equal(2, parser->countElements());
+	for (int i = 0; i < 2; i++) {
+		const ItemInfo &itemInfo = testItemInfo[indexes[i]];
+		parser->startElement(i);
+		assertValueInParser(parser, "serverId",
+		                    (uint32_t)itemInfo.serverId);
+		assertValueInParser(parser, "itemId",
+		                    StringUtils::toString(itemInfo.id));
+		assertStartObject(parser, "history");
+		if (&itemInfo != &cachedItemInfo) {
+			cppcut_assert_equal(0, parser->countElements());
+			parser->endObject();
+			parser->endElement();
+			continue;
+		}
+		cppcut_assert_equal((int)historyInfoVect.size(),
+		                    parser->countElements());
+		for (size_t j = 0; j < historyInfoVect.size(); j++) {
+			const HistoryInfo &historyInfo = historyInfoVect[j];
+			parser->startElement(j);
+			assertValueInParser(parser, "value", historyInfo.value);
+			assertValueInParser(parser, "clock",
+			  (uint64_t)historyInfo.clock.tv_sec);
+			assertValueInParser(parser, "ns", 0);
+			parser->endElement();
+		}
+		parser->endObject();
+		parser->endElement();
+	}
+	parser->endObject();
+}
+
+void test_getHistoryOfTooManyItems(void)
+{
+	startFaceRest();
+
+	RequestArg arg("/history");
+	StringMap params;
+	string items;
+	for (size_t i = 1; i <= RestResourceHost::MAX_HISTORY_ITEMS + 1; i++) {
+		if (!items.empty())
+			items += ",";
+		items += StringUtils::sprintf("1:%zd", i);
+	}
+	params["items"] = items;
+	arg.parameters = params;
+	arg.userId = findUserWith(OPPRVLG_GET_ALL_SERVER);
+	JSONParser *parser = getResponseAsJSONParser(arg);
+	unique_ptr<JSONParser> parserPtr(parser);
+	assertErrorCode(parser, HTERR_INVALID_PARAMETER);
+}
+
+void test_getHistoryOfItemsWithInvalidParameter(void)
+{
+	startFaceRest();
+
+	RequestArg arg("/history");
+	StringMap params;
+	params["items"] = "1:abc";
+	arg.parameters = params;
+	arg.userId = findUserWith(OPPRVLG_GET_ALL_SERVER);
+	JSONParser *parser = getResponseAsJSONParser(arg);
+	unique_ptr<JSONParser> parserPtr(parser);
+	assertErrorCode(parser, HTERR_INVALID_PARAMETER);
+}
+
 } // namespace testFaceRestHost
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cppcutter.h>
+#include "Hatohol.h"
+#include "FaceRest.h"
+#include "Helpers.h"
+#include "JSONParser.h"
+#include "DBTablesTest.h"
+#include "ThreadLocalDBCache.h"
+#include "FaceRestTestUtils.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testFaceRestLogLevel {
+
+static LogLevel g_savedLogLevel;
+
+static UserIdType findAdminUser(void)
+{
+	ThreadLocalDBCache cache;
+	UserInfoList userInfoList;
+	UserQueryOption option(USER_ID_SYSTEM);
+	cache.getUser().getUserInfoList(userInfoList, option);
+	UserInfoListIterator userInfo = userInfoList.begin();
+	for (; userInfo != userInfoList.end(); ++userInfo) {
+		if (userInfo->flags == ALL_PRIVILEGES)
+			return userInfo->id;
+	}
+	cut_fail("Not found: a user with ALL_PRIVILEGES");
+	return INVALID_USER_ID;
+}
+
+static void _assertRequest(const string &url, const string &method,
+                           const UserIdType &userId,
+                           const HatoholErrorCode &expectCode,
+                           const StringMap &params = StringMap())
+{
+	startFaceRest();
+	RequestArg arg(url);
+	arg.request = method;
+	arg.parameters = params;
+	arg.userId = userId;
+	unique_ptr<JSONParser> parserPtr(getResponseAsJSONParser(arg));
+	assertErrorCode(parserPtr.get(), expectCode);
+}
+#define assertRequest(U,M,I,E,...) \
+cut_trace(_assertRequest(U,M,I,E,##__VA_ARGS__))
+
+void cut_setup(void)
+{
+	hatoholInit();
+	setupTestDB();
+	loadTestDBTablesUser();
+	g_savedLogLevel = Logger::getLogLevel();
+}
+
+void cut_teardown(void)
+{
+	stopFaceRest();
+	Logger::setLogLevel(g_savedLogLevel);
+	Logger::clearModuleLogLevel("testFaceRestLogLevel");
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_getLogLevel(void)
+{
+	Logger::setModuleLogLevel("testFaceRestLogLevel", MLPL_LOG_DBG);
+	startFaceRest();
+	RequestArg arg("/log-level");
+	arg.userId = findAdminUser();
+	unique_ptr<JSONParser> parserPtr(getResponseAsJSONParser(arg));
+	JSONParser *parser = parserPtr.get();
+	assertErrorCode(parser);
+	assertValueInParser(parser, "level",
+	                    string(Logger::getLogLevelName(g_savedLogLevel)));
+	assertStartObject(parser, "modules");
+	assertValueInParser(parser, "testFaceRestLogLevel", string("DBG"));
+}
+
+void test_putDefaultLogLevel(void)
+{
+	StringMap params;
+	params["level"] = "ERR";
+	assertRequest("/log-level", "PUT", findAdminUser(), HTERR_OK, params);
+	cppcut_assert_equal(MLPL_LOG_ERR, Logger::getLogLevel());
+}
+
+void test_putModuleLogLevel(void)
+{
+	StringMap params;
+	params["level"] = "DBG";
+	assertRequest("/log-level/testFaceRestLogLevel", "PUT",
+	              findAdminUser(), HTERR_OK, params);
+	LogLevelMap levels;
+	Logger::getModuleLogLevels(levels);
+	cppcut_assert_equal(MLPL_LOG_DBG, levels["testFaceRestLogLevel"]);
+}
+
+void test_putInvalidLogLevel(void)
+{
+	StringMap params;
+	params["level"] = "VERBOSE";
+	assertRequest("/log-level", "PUT", findAdminUser(),
+	              HTERR_INVALID_PARAMETER, params);
+}
+
+void test_putLogLevelWithoutPrivilege(void)
+{
+	StringMap params;
+	params["level"] = "DBG";
+	assertRequest("/log-level", "PUT",
+	              findUserWithout(OPPRVLG_UPDATE_ALL_SERVER),
+	              HTERR_NO_PRIVILEGE, params);
+}
+
+void test_deleteModuleLogLevel(void)
+{
+	Logger::setModuleLogLevel("testFaceRestLogLevel", MLPL_LOG_DBG);
+	assertRequest("/log-level/testFaceRestLogLevel", "DELETE",
+	              findAdminUser(), HTERR_OK);
+	LogLevelMap levels;
+	Logger::getModuleLogLevels(levels);
+	cppcut_assert_equal(true, levels.find("testFaceRestLogLevel") ==
+	                          levels.end());
+}
+
+} // namespace testFaceRestLogLevel
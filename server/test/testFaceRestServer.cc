@@ -149,6 +149,13 @@ static void _assertServerConnStat(JSONParser *parser)
 		assertValueInParser(parser, "failureComment", string(""));
 		assertValueInParser(parser, "numUpdate",      0);
 		assertValueInParser(parser, "numFailure",     0);
+		assertValueInParser(parser, "pollingInterval", 0);
+		assertValueInParser(parser, "numEventsInLastPoll", 0);
+		assertValueInParser(parser, "lastPollDuration", 0);
+		assertValueInParser(parser, "numAdmittedEvents", 0);
+		assertValueInParser(parser, "numSpilledEvents",  0);
+		assertValueInParser(parser, "numReplayedEvents", 0);
+		assertValueInParser(parser, "numPendingEvents",  0);
 		parser->endObject(); // serverId
 		expectIdSet.erase(serverIdItr);
 	}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include <gcutter.h>
+#include <set>
+#include <vector>
+#include <stdexcept>
+#include <Mutex.h>
+#include <StringUtils.h>
+#include "GroupCommitWriter.h"
+#include "HatoholException.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testGroupCommitWriter {
+
+static const TriggerIdType BAD_TRIGGER_ID = 3;
+
+struct TestCommitter : public GroupCommitWriter::Committer {
+	Mutex                   mutex;
+	size_t                  numCommits;
+	set<TriggerIdType>      committedIds;
+
+	TestCommitter(void)
+	: numCommits(0)
+	{
+	}
+
+	virtual void commit(const TriggerInfoList &triggerList,
+	                    const EventInfoList &eventList,
+	                    const ItemInfoList &itemList) override
+	{
+		AutoMutex autoLock(&mutex);
+		TriggerInfoListConstIterator it = triggerList.begin();
+		for (; it != triggerList.end(); ++it) {
+			if (it->id == BAD_TRIGGER_ID)
+				throw runtime_error("Bad trigger");
+		}
+		for (it = triggerList.begin(); it != triggerList.end(); ++it)
+			committedIds.insert(it->id);
+		numCommits++;
+	}
+
+	// Makes a string such as "1,2,4" from the committed IDs.
+	string getCommittedIds(void)
+	{
+		AutoMutex autoLock(&mutex);
+		string str;
+		set<TriggerIdType>::const_iterator it = committedIds.begin();
+		for (; it != committedIds.end(); ++it) {
+			if (!str.empty())
+				str += ",";
+			str += StringUtils::sprintf("%" FMT_TRIGGER_ID, *it);
+		}
+		return str;
+	}
+};
+
+static TriggerInfoList makeTriggerList(const TriggerIdType &id)
+{
+	TriggerInfo triggerInfo;
+	triggerInfo.serverId = 1;
+	triggerInfo.id = id;
+	triggerInfo.status = TRIGGER_STATUS_PROBLEM;
+	triggerInfo.severity = TRIGGER_SEVERITY_WARNING;
+	triggerInfo.lastChangeTime.tv_sec = 1000;
+	triggerInfo.lastChangeTime.tv_nsec = 0;
+	triggerInfo.hostId = 10;
+	triggerInfo.hostName = "host";
+	triggerInfo.brief = "brief";
+	return TriggerInfoList(1, triggerInfo);
+}
+
+class TestWriterThread : public HatoholThreadBase {
+public:
+	TestWriterThread(GroupCommitWriter &writer, const TriggerIdType &id)
+	: m_writer(writer),
+	  m_id(id),
+	  m_failed(false)
+	{
+	}
+
+	bool hasFailed(void) const
+	{
+		return m_failed;
+	}
+
+protected:
+	virtual gpointer mainThread(HatoholThreadArg *arg) override
+	{
+		try {
+			m_writer.write(makeTriggerList(m_id), EventInfoList(),
+			               ItemInfoList());
+		} catch (const HatoholException &e) {
+			m_failed = true;
+		}
+		return NULL;
+	}
+
+private:
+	GroupCommitWriter &m_writer;
+	TriggerIdType      m_id;
+	bool               m_failed;
+};
+
+// Writes the triggers of ID 1 to numWriters from as many threads.
+static void writeConcurrently(vector<bool> &failed,
+                              GroupCommitWriter &writer,
+                              const size_t &numWriters)
+{
+	vector<TestWriterThread *> threads;
+	for (size_t i = 1; i <= numWriters; i++) {
+		TestWriterThread *thread = new TestWriterThread(writer, i);
+		thread->start();
+		threads.push_back(thread);
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i]->exitSync();
+		failed.push_back(threads[i]->hasFailed());
+		delete threads[i];
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_writeWithoutThread(void)
+{
+	TestCommitter committer;
+	GroupCommitWriter writer(100, committer);
+	writer.write(makeTriggerList(1), EventInfoList(), ItemInfoList());
+	cppcut_assert_equal((size_t)1, committer.numCommits);
+	cppcut_assert_equal(string("1"), committer.getCommittedIds());
+}
+
+void test_mergeConcurrentWrites(void)
+{
+	const size_t numWriters = 2;
+	TestCommitter committer;
+	GroupCommitWriter writer(200, committer);
+	writer.start();
+	vector<bool> failed;
+	writeConcurrently(failed, writer, numWriters);
+	cppcut_assert_equal(string("1,2"), committer.getCommittedIds());
+	cppcut_assert_equal((size_t)1, committer.numCommits);
+	cppcut_assert_equal(false, failed[0]);
+	cppcut_assert_equal(false, failed[1]);
+}
+
+void test_failureIsReturnedOnlyToTheWriter(void)
+{
+	const size_t numWriters = 4;
+	TestCommitter committer;
+	GroupCommitWriter writer(200, committer);
+	writer.start();
+	vector<bool> failed;
+	writeConcurrently(failed, writer, numWriters);
+	cppcut_assert_equal(string("1,2,4"), committer.getCommittedIds());
+	cppcut_assert_equal(false, failed[0]);
+	cppcut_assert_equal(false, failed[1]);
+	cppcut_assert_equal(true, failed[BAD_TRIGGER_ID - 1]);
+	cppcut_assert_equal(false, failed[3]);
+}
+
+} // namespace testGroupCommitWriter
@@ -52,6 +52,16 @@ public:
 	{
 		return getHistoryQueryOption(lastTime);
 	}
+
+	size_t callGetMaxConcurrentRequests(void)
+	{
+		return getMaxConcurrentRequests();
+	}
+
+	void callSetMaxConcurrentRequests(const size_t &num)
+	{
+		setMaxConcurrentRequests(num);
+	}
 };
 
 // ---------------------------------------------------------------------------
@@ -116,6 +126,14 @@ void test_getHistoryQueryOption(void)
 	cppcut_assert_equal(expect, actual);
 }
 
+void test_maxConcurrentRequests(void)
+{
+	TestHapProcessCeilometer hap;
+	cppcut_assert_equal((size_t)8, hap.callGetMaxConcurrentRequests());
+	hap.callSetMaxConcurrentRequests(1);
+	cppcut_assert_equal((size_t)1, hap.callGetMaxConcurrentRequests());
+}
+
 void data_parseAlarmHistoryDetail(void)
 {
 	gcut_add_datum("ok",
@@ -154,8 +154,8 @@ void test_getHostsAndTriggers(void)
 	pair.plugin->assertWaitReady();
 	pair.plugin->callUpdateAuthTokenIfNeeded();
 	pair.plugin->callWorkOnHostsAndHostgroups();
-	pair.gate->assertWaitHandledCommand(HAPI_CMD_SEND_HOSTS);
-	pair.gate->assertWaitHandledCommand(HAPI_CMD_SEND_HOST_GROUP_ELEMENTS);
+	// Hosts and host group elements.
+	pair.gate->assertWaitHandledCommand(HAPI_CMD_SEND_TABLE_DELTA, 2);
 
 	pair.plugin->callWorkOnTriggers();
 	pair.gate->assertWaitHandledCommand(HAPI_CMD_SEND_UPDATED_TRIGGERS);
@@ -173,7 +173,7 @@ void test_getHostgroups(void)
 	pair.plugin->assertWaitReady();
 	pair.plugin->callUpdateAuthTokenIfNeeded();
 	pair.plugin->callWorkOnHostgroups();
-	pair.gate->assertWaitHandledCommand(HAPI_CMD_SEND_HOST_GROUPS);
+	pair.gate->assertWaitHandledCommand(HAPI_CMD_SEND_TABLE_DELTA);
 
 	// TODO: check the DB content
 }
@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cppcutter.h>
+#include <StringUtils.h>
+#include "HapiLocalChannel.h"
+#include "HatoholThreadBase.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testHapiLocalChannel {
+
+static const int    TIMEOUT_MSEC = 5000;
+static const size_t SMALL_RING_SIZE = 1024;
+
+// The layout of the shared memory
+static const size_t CHANNEL_HEADER_SIZE = 64;
+static const size_t RING_HEADER_SIZE = 128;
+
+static string g_path;
+static HapiLocalChannel *g_server = NULL;
+static HapiLocalChannel *g_plugin = NULL;
+
+class SenderThread : public HatoholThreadBase {
+public:
+	SenderThread(HapiLocalChannel *channel, const SmartBuffer &sbuf,
+	             const useconds_t &delayUSec = 0)
+	: m_channel(channel),
+	  m_sbuf(sbuf),
+	  m_delayUSec(delayUSec)
+	{
+	}
+
+protected:
+	virtual gpointer mainThread(HatoholThreadArg *arg) override
+	{
+		usleep(m_delayUSec);
+		m_channel->send(m_sbuf);
+		return NULL;
+	}
+
+private:
+	HapiLocalChannel *m_channel;
+	SmartBuffer       m_sbuf;
+	useconds_t        m_delayUSec;
+};
+
+// Opens a new plugin side after a while and sends a message from it.
+class PluginRelaunchThread : public HatoholThreadBase {
+public:
+	PluginRelaunchThread(const SmartBuffer &sbuf)
+	: m_plugin(g_path, HapiLocalChannel::SIDE_PLUGIN),
+	  m_sbuf(sbuf)
+	{
+	}
+
+protected:
+	virtual gpointer mainThread(HatoholThreadArg *arg) override
+	{
+		usleep(100 * 1000);
+		m_plugin.open();
+		m_plugin.send(m_sbuf);
+		return NULL;
+	}
+
+private:
+	HapiLocalChannel m_plugin;
+	SmartBuffer      m_sbuf;
+};
+
+static void openChannels(const size_t &ringSize =
+                           HapiLocalChannel::DEFAULT_RING_SIZE)
+{
+	g_server = new HapiLocalChannel(g_path, HapiLocalChannel::SIDE_SERVER,
+	                                ringSize);
+	g_server->open();
+	g_plugin = new HapiLocalChannel(g_path, HapiLocalChannel::SIDE_PLUGIN);
+	g_plugin->open();
+}
+
+static void makeMessage(SmartBuffer &sbuf, const size_t &size)
+{
+	sbuf.alloc(size);
+	uint8_t *buf = sbuf.getPointer<uint8_t>(0);
+	for (size_t i = 0; i < size; i++)
+		buf[i] = i % 251;
+}
+
+static void assertMessage(const SmartBuffer &expected,
+                          const SmartBuffer &actual)
+{
+	cppcut_assert_equal(expected.size(), actual.size());
+	cppcut_assert_equal(0, memcmp(expected.getPointer<uint8_t>(0),
+	                              actual.getPointer<uint8_t>(0),
+	                              expected.size()));
+	cppcut_assert_equal((size_t)0, actual.index());
+}
+
+// Writes the data as if the plugin has written them to the ring.
+static void writeToServerRing(const void *data, const size_t &size,
+                              const size_t &ringSize)
+{
+	const off_t headOffset =
+	  CHANNEL_HEADER_SIZE + RING_HEADER_SIZE + ringSize;
+	const off_t dataOffset = headOffset + RING_HEADER_SIZE;
+	const uint64_t head = size;
+	int fd = open(g_path.c_str(), O_RDWR);
+	cppcut_assert_equal(true, fd >= 0);
+	cppcut_assert_equal((ssize_t)size, pwrite(fd, data, size, dataOffset));
+	cppcut_assert_equal((ssize_t)sizeof(head),
+	                    pwrite(fd, &head, sizeof(head), headOffset));
+	close(fd);
+}
+
+void cut_setup(void)
+{
+	g_path = StringUtils::sprintf("/tmp/hatohol-test-hap-local-%d",
+	                              getpid());
+}
+
+void cut_teardown(void)
+{
+	delete g_plugin;
+	g_plugin = NULL;
+	delete g_server;
+	g_server = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_sendToPlugin(void)
+{
+	openChannels();
+	SmartBuffer msg, received;
+	makeMessage(msg, 100);
+	g_server->send(msg);
+	cppcut_assert_equal(true, g_plugin->receive(received, TIMEOUT_MSEC));
+	assertMessage(msg, received);
+}
+
+void test_sendToServer(void)
+{
+	openChannels();
+	SmartBuffer msg, received;
+	makeMessage(msg, 100);
+	g_plugin->send(msg);
+	cppcut_assert_equal(true, g_server->receive(received, TIMEOUT_MSEC));
+	assertMessage(msg, received);
+}
+
+void test_receiveInOrder(void)
+{
+	openChannels(SMALL_RING_SIZE);
+	const size_t sizes[] = {1, 10, 300, 500};
+	const size_t numMessages = sizeof(sizes) / sizeof(size_t);
+	SmartBuffer msgs[numMessages];
+	for (size_t i = 0; i < numMessages; i++) {
+		makeMessage(msgs[i], sizes[i]);
+		g_server->send(msgs[i]);
+	}
+	for (size_t i = 0; i < numMessages; i++) {
+		SmartBuffer received;
+		cppcut_assert_equal(true,
+		                    g_plugin->receive(received, TIMEOUT_MSEC));
+		assertMessage(msgs[i], received);
+	}
+}
+
+void test_sendMessageLargerThanRing(void)
+{
+	openChannels(SMALL_RING_SIZE);
+	SmartBuffer msg, received;
+	makeMessage(msg, SMALL_RING_SIZE * 100 + 3);
+	SenderThread sender(g_server, msg);
+	sender.start();
+	cppcut_assert_equal(true, g_plugin->receive(received, TIMEOUT_MSEC));
+	sender.waitExit();
+	assertMessage(msg, received);
+}
+
+void test_receiveTimeout(void)
+{
+	openChannels();
+	SmartBuffer received;
+	cppcut_assert_equal(false, g_plugin->receive(received, 10));
+}
+
+void test_interrupt(void)
+{
+	openChannels();
+	SmartBuffer received;
+	g_plugin->interrupt();
+	cppcut_assert_equal(false, g_plugin->receive(received, -1));
+}
+
+void test_interruptIsClearedByOpen(void)
+{
+	openChannels();
+	SmartBuffer msg, received;
+	makeMessage(msg, 100);
+	g_plugin->interrupt();
+	g_plugin->close();
+	g_plugin->open();
+	SenderThread sender(g_server, msg, 100 * 1000);
+	sender.start();
+	cppcut_assert_equal(true, g_plugin->receive(received, -1));
+	sender.waitExit();
+	assertMessage(msg, received);
+}
+
+void test_reopenResetsChannel(void)
+{
+	openChannels();
+	SmartBuffer staleMsg, msg, received;
+	makeMessage(staleMsg, 100);
+	makeMessage(msg, 50);
+	g_server->send(staleMsg);
+	g_server->close();
+	g_server->open();
+
+	// The plugin has to open the channel again.
+	bool gotException = false;
+	try {
+		g_plugin->receive(received, TIMEOUT_MSEC);
+	} catch (const HatoholException &e) {
+		gotException = true;
+	}
+	cppcut_assert_equal(true, gotException);
+	g_plugin->close();
+	g_plugin->open();
+	cppcut_assert_equal(false, g_plugin->receive(received, 10));
+
+	g_server->send(msg);
+	cppcut_assert_equal(true, g_plugin->receive(received, TIMEOUT_MSEC));
+	assertMessage(msg, received);
+}
+
+void test_relaunchedPluginReceivesOnlyNewMessages(void)
+{
+	openChannels();
+	SmartBuffer staleMsg, msg, received;
+	makeMessage(staleMsg, 100);
+	makeMessage(msg, 50);
+	g_server->send(staleMsg);
+	delete g_plugin;
+	g_plugin = new HapiLocalChannel(g_path, HapiLocalChannel::SIDE_PLUGIN);
+	g_plugin->open();
+	g_server->send(msg);
+	cppcut_assert_equal(true, g_plugin->receive(received, TIMEOUT_MSEC));
+	assertMessage(msg, received);
+	cppcut_assert_equal(false, g_plugin->receive(received, 10));
+}
+
+void test_pluginRelaunchInMiddleOfMessage(void)
+{
+	openChannels(SMALL_RING_SIZE);
+	delete g_plugin;
+	g_plugin = NULL;
+
+	// The plugin died after it wrote 10 bytes of a 100-byte message.
+	uint8_t partial[sizeof(uint32_t) + 10];
+	const uint32_t length = 100;
+	memcpy(partial, &length, sizeof(length));
+	memset(&partial[sizeof(length)], 0x55, 10);
+	writeToServerRing(partial, sizeof(partial), SMALL_RING_SIZE);
+
+	SmartBuffer msg, received;
+	makeMessage(msg, 30);
+	PluginRelaunchThread relaunch(msg);
+	relaunch.start();
+	cppcut_assert_equal(true, g_server->receive(received, TIMEOUT_MSEC));
+	relaunch.waitExit();
+	assertMessage(msg, received);
+}
+
+void test_resetByTooLargeMessage(void)
+{
+	openChannels();
+	delete g_plugin;
+	g_plugin = NULL;
+
+	// A broken length must not be allocated.
+	const uint32_t length = HapiLocalChannel::MAX_MESSAGE_SIZE + 1;
+	writeToServerRing(&length, sizeof(length),
+	                  HapiLocalChannel::DEFAULT_RING_SIZE);
+	SmartBuffer msg, received;
+	cppcut_assert_equal(false, g_server->receive(received, 10));
+
+	g_plugin = new HapiLocalChannel(g_path, HapiLocalChannel::SIDE_PLUGIN);
+	g_plugin->open();
+	makeMessage(msg, 30);
+	g_plugin->send(msg);
+	cppcut_assert_equal(true, g_server->receive(received, TIMEOUT_MSEC));
+	assertMessage(msg, received);
+}
+
+void test_openPluginSideWithoutServer(void)
+{
+	g_plugin = new HapiLocalChannel(g_path, HapiLocalChannel::SIDE_PLUGIN);
+	bool gotException = false;
+	try {
+		g_plugin->open();
+	} catch (const HatoholException &e) {
+		gotException = true;
+	}
+	cppcut_assert_equal(true, gotException);
+	cppcut_assert_equal(false, g_plugin->isOpened());
+}
+
+void test_filesAreRemovedOnDestruction(void)
+{
+	openChannels();
+	delete g_server;
+	g_server = NULL;
+	cppcut_assert_equal(-1, access(g_path.c_str(), F_OK));
+	cppcut_assert_equal(-1, access((g_path + "-S").c_str(), F_OK));
+	cppcut_assert_equal(-1, access((g_path + "-T").c_str(), F_OK));
+}
+
+} // namespace testHapiLocalChannel
@@ -18,13 +18,17 @@
  */
 
 #include <cppcutter.h>
+#include <set>
+#include <unistd.h>
 #include <SimpleSemaphore.h>
+#include <StringUtils.h>
 #include "Hatohol.h"
 #include "HatoholArmPluginBase.h"
 #include "HatoholArmPluginGateTest.h"
 #include "HatoholArmPluginTestPair.h"
 #include "DBTablesTest.h"
 #include "Helpers.h"
+#include "ThreadLocalDBCache.h"
 
 using namespace std;
 using namespace mlpl;
@@ -45,6 +49,12 @@ public:
 		sendArmInfo(armInfo);
 	}
 
+	bool callSendTableDelta(const HapiCommandCode &code,
+	                        const ItemTablePtr &tablePtr)
+	{
+		return sendTableDelta(code, tablePtr);
+	}
+
 protected:
 	void onConnected(Connection &conn) override
 	{
@@ -60,6 +70,54 @@ protected:
 
 typedef HatoholArmPluginTestPair<HatoholArmPluginBaseTest> TestPair;
 
+static ItemTablePtr makeHostgroupTable(const char *groupIds)
+{
+	VariableItemTablePtr tablePtr;
+	StringVector ids;
+	StringUtils::split(ids, groupIds, ',');
+	for (size_t i = 0; i < ids.size(); i++) {
+		const uint64_t groupId = StringUtils::toUint64(ids[i]);
+		VariableItemGroupPtr grp;
+		grp->addNewItem(ITEM_ID_ZBX_GROUPS_GROUPID, groupId);
+		grp->addNewItem(ITEM_ID_ZBX_GROUPS_NAME, "group" + ids[i]);
+		tablePtr->add(grp);
+	}
+	return static_cast<ItemTablePtr>(tablePtr);
+}
+
+// Returns the IDs of the host groups in the DB such as "1,2".
+static string getHostgroupIds(const ServerIdType &serverId)
+{
+	ThreadLocalDBCache cache;
+	HostgroupsQueryOption option(USER_ID_SYSTEM);
+	option.setTargetServerId(serverId);
+	HostgroupInfoList hostgroupInfoList;
+	cache.getMonitoring().getHostgroupInfoList(hostgroupInfoList, option);
+	set<HostgroupIdType> groupIds;
+	HostgroupInfoListConstIterator it = hostgroupInfoList.begin();
+	for (; it != hostgroupInfoList.end(); ++it)
+		groupIds.insert(it->groupId);
+	string str;
+	set<HostgroupIdType>::const_iterator idIt = groupIds.begin();
+	for (; idIt != groupIds.end(); ++idIt) {
+		if (!str.empty())
+			str += ",";
+		str += StringUtils::sprintf("%" FMT_HOST_GROUP_ID, *idIt);
+	}
+	return str;
+}
+
+static void sendHostgroupTable(TestPair &pair, const char *groupIds,
+                               const size_t &numHandled)
+{
+	cppcut_assert_equal(
+	  true,
+	  pair.plugin->callSendTableDelta(HAPI_CMD_SEND_HOST_GROUPS,
+	                                  makeHostgroupTable(groupIds)));
+	pair.gate->assertWaitHandledCommand(HAPI_CMD_SEND_TABLE_DELTA,
+	                                    numHandled);
+}
+
 void cut_setup(void)
 {
 	hatoholInit();
@@ -118,4 +176,64 @@ void test_sendArmInfo(void)
 	assertEqual(armInfo, pair.gate->getArmStatus().getArmInfo());
 }
 
+void test_sendTableDeltaReplacesWholeTable(void)
+{
+	HatoholArmPluginTestPairArg arg(MONITORING_SYSTEM_HAPI_TEST_PASSIVE);
+	HostgroupInfo staleGroup;
+	staleGroup.id = AUTO_INCREMENT_VALUE;
+	staleGroup.serverId = arg.serverId;
+	staleGroup.groupId = 99;
+	staleGroup.groupName = "stale";
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().addHostgroupInfo(&staleGroup);
+
+	TestPair pair(arg);
+	sendHostgroupTable(pair, "1,2", 1);
+	cppcut_assert_equal(string("1,2"), getHostgroupIds(arg.serverId));
+}
+
+void test_sendTableDeltaWithoutChange(void)
+{
+	HatoholArmPluginTestPairArg arg(MONITORING_SYSTEM_HAPI_TEST_PASSIVE);
+	TestPair pair(arg);
+	sendHostgroupTable(pair, "1,2", 1);
+	cppcut_assert_equal(
+	  false,
+	  pair.plugin->callSendTableDelta(HAPI_CMD_SEND_HOST_GROUPS,
+	                                  makeHostgroupTable("1,2")));
+}
+
+void test_sendTableDeltaWithRemovedRows(void)
+{
+	HatoholArmPluginTestPairArg arg(MONITORING_SYSTEM_HAPI_TEST_PASSIVE);
+	TestPair pair(arg);
+	sendHostgroupTable(pair, "1,2", 1);
+	sendHostgroupTable(pair, "1", 2);
+	cppcut_assert_equal(string("1"), getHostgroupIds(arg.serverId));
+}
+
+void test_sendTableDeltaAfterGenerationMismatch(void)
+{
+	HatoholArmPluginTestPairArg arg(MONITORING_SYSTEM_HAPI_TEST_PASSIVE);
+	TestPair pair(arg);
+	sendHostgroupTable(pair, "1,2", 1);
+	pair.gate->callResetTableGenerations();
+	sendHostgroupTable(pair, "1", 2);
+	// The delta isn't applied.
+	cppcut_assert_equal(string("1,2"), getHostgroupIds(arg.serverId));
+
+	// The whole table is sent after the plugin gets the error.
+	const size_t maxTrials = 500;
+	size_t trials = 0;
+	for (; trials < maxTrials; trials++) {
+		if (pair.plugin->callSendTableDelta(
+		      HAPI_CMD_SEND_HOST_GROUPS, makeHostgroupTable("1")))
+			break;
+		usleep(10 * 1000);
+	}
+	cppcut_assert_equal(true, trials < maxTrials);
+	pair.gate->assertWaitHandledCommand(HAPI_CMD_SEND_TABLE_DELTA, 3);
+	cppcut_assert_equal(string("1"), getHostgroupIds(arg.serverId));
+}
+
 } // namespace testHatoholArmPluginBase
@@ -21,6 +21,7 @@
 #include <cppcutter.h>
 #include <SimpleSemaphore.h>
 #include <Reaper.h>
+#include <StringUtils.h>
 #include "DataSamples.h"
 #include "Helpers.h"
 #include "HatoholArmPluginInterface.h"
@@ -191,6 +192,28 @@ void test_sendAndonReceived(void)
 	cppcut_assert_equal(testMessage, hapiSv.getMessage());
 }
 
+void test_sendAndonReceivedViaLocalChannel(void)
+{
+	const string testMessage = "FOO";
+	const string path = StringUtils::sprintf(
+	  "/tmp/hatohol-test-hapi-local-%d", getpid());
+
+	HatoholArmPluginInterfaceTest hapiSv;
+	hapiSv.setLocalChannelPath(path);
+	hapiSv.assertStartAndWaitConnected();
+
+	HatoholArmPluginInterfaceTest hapiCl(hapiSv);
+	cppcut_assert_equal(path, hapiCl.getLocalChannelPath());
+	hapiCl.assertStartAndWaitConnected();
+	hapiSv.assertWaitInitiated();
+
+	hapiSv.setMessageIntercept();
+	hapiCl.send(testMessage);
+	cppcut_assert_equal(SimpleSemaphore::STAT_OK,
+	                    hapiSv.getRcvSem().timedWait(TIMEOUT));
+	cppcut_assert_equal(testMessage, hapiSv.getMessage());
+}
+
 void test_registCommandHandler(void)
 {
 	struct Hapi : public HatoholArmPluginInterfaceTest {
@@ -632,6 +655,15 @@ void test_setGetBrokerUrl(void)
 	cppcut_assert_equal(brokerUrl, hapi.getBrokerUrl());
 }
 
+void test_setGetLocalChannelPath(void)
+{
+	const string path = "/tmp/hatohol/hap-local-5";
+	HatoholArmPluginInterface hapi;
+	cppcut_assert_equal(string(), hapi.getLocalChannelPath());
+	hapi.setLocalChannelPath(path);
+	cppcut_assert_equal(path, hapi.getLocalChannelPath());
+}
+
 void test_setGetGLibMainContext(void)
 {
 	HatoholArmPluginInterface hapi;
@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include <gcutter.h>
+#include <StringUtils.h>
+#include "HistoryCache.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testHistoryCache {
+
+// Aligned to an hour
+static const time_t BASE_TIME = 1400000000 - 1400000000 % 3600;
+
+static ItemInfo makeItemInfo(const ItemIdType &itemId,
+                             const ItemInfoValueType &valueType)
+{
+	ItemInfo itemInfo;
+	itemInfo.serverId = 1;
+	itemInfo.id = itemId;
+	itemInfo.hostId = 1;
+	itemInfo.delay = 60;
+	itemInfo.valueType = valueType;
+	return itemInfo;
+}
+
+static void appendHistory(HistoryInfoVect &historyInfoVect,
+                          const ItemInfo &itemInfo,
+                          const time_t &sec, const long &nsec,
+                          const string &value)
+{
+	HistoryInfo historyInfo;
+	historyInfo.serverId = itemInfo.serverId;
+	historyInfo.itemId = itemInfo.id;
+	historyInfo.value = value;
+	historyInfo.clock.tv_sec = sec;
+	historyInfo.clock.tv_nsec = nsec;
+	historyInfoVect.push_back(historyInfo);
+}
+
+static string toString(const HistoryInfoVect &historyInfoVect)
+{
+	string str;
+	HistoryInfoVectConstIterator it = historyInfoVect.begin();
+	for (; it != historyInfoVect.end(); ++it) {
+		str += StringUtils::sprintf("%ld.%09ld %s\n",
+		  it->clock.tv_sec, it->clock.tv_nsec, it->value.c_str());
+	}
+	return str;
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void data_addAndGet(void)
+{
+	gcut_add_datum("Float",
+	               "valueType", G_TYPE_INT, ITEM_INFO_VALUE_TYPE_FLOAT,
+	               NULL);
+	gcut_add_datum("Integer",
+	               "valueType", G_TYPE_INT, ITEM_INFO_VALUE_TYPE_INTEGER,
+	               NULL);
+}
+
+void test_addAndGet(gconstpointer data)
+{
+	const ItemInfoValueType valueType =
+	  (ItemInfoValueType)gcut_data_get_int(data, "valueType");
+	const char *floatValues[] = {
+	  "1.5", "1.5", "2.25", "-0.125", "1e+20", "100", "0.1"};
+	const char *integerValues[] = {
+	  "0", "0", "42", "18446744073709551615", "7", "100", "1"};
+	const char **values = valueType == ITEM_INFO_VALUE_TYPE_FLOAT ?
+	                      floatValues : integerValues;
+	// Regular and irregular intervals over segments
+	const time_t offsets[] = {0, 60, 120, 121, 3500, 7300, 7301};
+	const long nsecs[] = {0, 0, 123456789, 0, 999999999, 0, 1};
+	const size_t numSamples = sizeof(offsets) / sizeof(time_t);
+
+	ItemInfo itemInfo = makeItemInfo(1, valueType);
+	HistoryInfoVect expected;
+	for (size_t i = 0; i < numSamples; i++) {
+		appendHistory(expected, itemInfo, BASE_TIME + offsets[i],
+		              nsecs[i], values[i]);
+	}
+
+	HistoryCache cache(10);
+	const time_t endTime = BASE_TIME + 10000;
+	cache.add(itemInfo, BASE_TIME, endTime, expected);
+
+	HistoryInfoVect actual;
+	time_t cachedEndTime = 0;
+	cppcut_assert_equal(true, cache.get(actual, itemInfo, BASE_TIME,
+	                                    endTime, cachedEndTime));
+	cppcut_assert_equal(endTime, cachedEndTime);
+	cppcut_assert_equal(toString(expected), toString(actual));
+}
+
+void data_keepValueStrings(void)
+{
+	gcut_add_datum("Float",
+	               "valueType", G_TYPE_INT, ITEM_INFO_VALUE_TYPE_FLOAT,
+	               NULL);
+	gcut_add_datum("Integer",
+	               "valueType", G_TYPE_INT, ITEM_INFO_VALUE_TYPE_INTEGER,
+	               NULL);
+}
+
+void test_keepValueStrings(gconstpointer data)
+{
+	const ItemInfoValueType valueType =
+	  (ItemInfoValueType)gcut_data_get_int(data, "valueType");
+	// Fixed-point numbers like Zabbix's and other forms
+	const char *floatValues[] = {
+	  "0.1000", "12.3400", "1.5", "3", "+2.5", "1.000000000000000000",
+	  "0.1000"};
+	const char *integerValues[] = {
+	  "42", "007", "+7", "42", "0", "00", "42"};
+	const char **values = valueType == ITEM_INFO_VALUE_TYPE_FLOAT ?
+	                      floatValues : integerValues;
+	const size_t numSamples = 7;
+
+	ItemInfo itemInfo = makeItemInfo(1, valueType);
+	HistoryInfoVect expected;
+	for (size_t i = 0; i < numSamples; i++) {
+		appendHistory(expected, itemInfo, BASE_TIME + i * 60, 0,
+		              values[i]);
+	}
+
+	HistoryCache cache(10);
+	const time_t endTime = BASE_TIME + 3600;
+	cache.add(itemInfo, BASE_TIME, endTime, expected);
+
+	HistoryInfoVect actual;
+	time_t cachedEndTime = 0;
+	cppcut_assert_equal(true, cache.get(actual, itemInfo, BASE_TIME,
+	                                    endTime, cachedEndTime));
+	cppcut_assert_equal(toString(expected), toString(actual));
+}
+
+void test_getPartOfRange(void)
+{
+	ItemInfo itemInfo = makeItemInfo(1, ITEM_INFO_VALUE_TYPE_INTEGER);
+	HistoryInfoVect historyInfoVect;
+	for (int i = 0; i < 10; i++) {
+		appendHistory(historyInfoVect, itemInfo, BASE_TIME + i * 600,
+		              0, StringUtils::toString(i));
+	}
+	HistoryCache cache(10);
+	cache.add(itemInfo, BASE_TIME, BASE_TIME + 6000, historyInfoVect);
+
+	HistoryInfoVect expected(historyInfoVect.begin() + 3,
+	                         historyInfoVect.begin() + 7);
+	HistoryInfoVect actual;
+	time_t cachedEndTime = 0;
+	cppcut_assert_equal(true,
+	  cache.get(actual, itemInfo, BASE_TIME + 1800, BASE_TIME + 3600,
+	            cachedEndTime));
+	cppcut_assert_equal(toString(expected), toString(actual));
+}
+
+void test_getRangeToFetch(void)
+{
+	ItemInfo itemInfo = makeItemInfo(1, ITEM_INFO_VALUE_TYPE_FLOAT);
+	HistoryCache cache(10);
+	const time_t endTime = BASE_TIME + 3600;
+	cache.add(itemInfo, BASE_TIME, endTime, HistoryInfoVect());
+
+	time_t fetchBeginTime = 0;
+	// Covered
+	cppcut_assert_equal(true,
+	  cache.getRangeToFetch(itemInfo, BASE_TIME + 10, endTime - 10,
+	                        fetchBeginTime));
+	// Only the tail is needed
+	cppcut_assert_equal(false,
+	  cache.getRangeToFetch(itemInfo, BASE_TIME + 10, endTime + 100,
+	                        fetchBeginTime));
+	cppcut_assert_equal(endTime + 1, fetchBeginTime);
+	// The head isn't cached
+	cppcut_assert_equal(false,
+	  cache.getRangeToFetch(itemInfo, BASE_TIME - 10, endTime,
+	                        fetchBeginTime));
+	cppcut_assert_equal(BASE_TIME - 10, fetchBeginTime);
+}
+
+void test_addTail(void)
+{
+	ItemInfo itemInfo = makeItemInfo(1, ITEM_INFO_VALUE_TYPE_INTEGER);
+	HistoryInfoVect expected;
+	for (int i = 0; i < 10; i++) {
+		appendHistory(expected, itemInfo, BASE_TIME + i * 60, 0,
+		              StringUtils::toString(i));
+	}
+
+	HistoryCache cache(10);
+	const HistoryInfoVect head(expected.begin(), expected.begin() + 5);
+	cache.add(itemInfo, BASE_TIME, BASE_TIME + 4 * 60, head);
+	// Overlapped samples are not added twice.
+	const HistoryInfoVect tail(expected.begin() + 3, expected.end());
+	cache.add(itemInfo, BASE_TIME + 3 * 60, BASE_TIME + 9 * 60, tail);
+
+	HistoryInfoVect actual;
+	time_t cachedEndTime = 0;
+	cppcut_assert_equal(true,
+	  cache.get(actual, itemInfo, BASE_TIME, BASE_TIME + 9 * 60,
+	            cachedEndTime));
+	cppcut_assert_equal(toString(expected), toString(actual));
+}
+
+void test_unsettledSamplesAreNotCached(void)
+{
+	ItemInfo itemInfo = makeItemInfo(1, ITEM_INFO_VALUE_TYPE_INTEGER);
+	const time_t now = time(NULL);
+	const time_t beginTime = now - 1000;
+	HistoryInfoVect historyInfoVect;
+	appendHistory(historyInfoVect, itemInfo, now - 500, 0, "1");
+	appendHistory(historyInfoVect, itemInfo, now - 10, 0, "2");
+
+	HistoryCache cache(10);
+	cache.add(itemInfo, beginTime, now, historyInfoVect);
+
+	HistoryInfoVect actual;
+	time_t cachedEndTime = 0;
+	cppcut_assert_equal(true,
+	  cache.get(actual, itemInfo, beginTime, now, cachedEndTime));
+	cppcut_assert_equal(true,
+	  cachedEndTime <= now - HistoryCache::UNSETTLED_SEC);
+	cppcut_assert_equal((size_t)1, actual.size());
+	cppcut_assert_equal(string("1"), actual[0].value);
+}
+
+void test_getRollups(void)
+{
+	ItemInfo itemInfo = makeItemInfo(1, ITEM_INFO_VALUE_TYPE_FLOAT);
+	HistoryInfoVect historyInfoVect;
+	appendHistory(historyInfoVect, itemInfo, BASE_TIME,      0, "1");
+	appendHistory(historyInfoVect, itemInfo, BASE_TIME + 20, 0, "3");
+	appendHistory(historyInfoVect, itemInfo, BASE_TIME + 40, 0, "2");
+	appendHistory(historyInfoVect, itemInfo, BASE_TIME + 60, 0, "10");
+
+	HistoryCache cache(10);
+	cache.add(itemInfo, BASE_TIME, BASE_TIME + 3600, historyInfoVect);
+
+	HistoryCache::RollupVect rollupVect;
+	time_t cachedEndTime = 0;
+	cppcut_assert_equal(true,
+	  cache.getRollups(rollupVect, itemInfo, 60,
+	                   BASE_TIME, BASE_TIME + 3600, cachedEndTime));
+	cppcut_assert_equal((size_t)2, rollupVect.size());
+	cppcut_assert_equal(BASE_TIME, rollupVect[0].clock);
+	cppcut_assert_equal(1.0, rollupVect[0].min);
+	cppcut_assert_equal(3.0, rollupVect[0].max);
+	cppcut_assert_equal(6.0, rollupVect[0].sum);
+	cppcut_assert_equal((size_t)3, rollupVect[0].count);
+	cppcut_assert_equal(BASE_TIME + 60, rollupVect[1].clock);
+	cppcut_assert_equal((size_t)1, rollupVect[1].count);
+
+	rollupVect.clear();
+	cppcut_assert_equal(true,
+	  cache.getRollups(rollupVect, itemInfo, 3600,
+	                   BASE_TIME, BASE_TIME + 3600, cachedEndTime));
+	cppcut_assert_equal((size_t)1, rollupVect.size());
+	cppcut_assert_equal(1.0, rollupVect[0].min);
+	cppcut_assert_equal(10.0, rollupVect[0].max);
+	cppcut_assert_equal((size_t)4, rollupVect[0].count);
+}
+
+void test_aggregate(void)
+{
+	ItemInfo itemInfo = makeItemInfo(1, ITEM_INFO_VALUE_TYPE_FLOAT);
+	HistoryInfoVect historyInfoVect;
+	appendHistory(historyInfoVect, itemInfo, BASE_TIME,       0, "4");
+	appendHistory(historyInfoVect, itemInfo, BASE_TIME + 599, 0, "-2");
+	appendHistory(historyInfoVect, itemInfo, BASE_TIME + 600, 0, "5");
+
+	HistoryCache::RollupVect rollupVect;
+	HistoryCache::aggregate(rollupVect, historyInfoVect, 600);
+	cppcut_assert_equal((size_t)2, rollupVect.size());
+	cppcut_assert_equal(-2.0, rollupVect[0].min);
+	cppcut_assert_equal(4.0, rollupVect[0].max);
+	cppcut_assert_equal((size_t)2, rollupVect[0].count);
+	cppcut_assert_equal(5.0, rollupVect[1].sum);
+}
+
+void data_mergeRollups(void)
+{
+	gcut_add_datum("Not merged",
+	               "maxPoints", G_TYPE_INT, 5,
+	               "expected", G_TYPE_STRING, "0:1,60:2,120:3,180:4,240:5",
+	               NULL);
+	gcut_add_datum("Merge 2 buckets",
+	               "maxPoints", G_TYPE_INT, 3,
+	               "expected", G_TYPE_STRING, "0:1-2,120:3-4,240:5",
+	               NULL);
+	gcut_add_datum("Merge all",
+	               "maxPoints", G_TYPE_INT, 1,
+	               "expected", G_TYPE_STRING, "0:1-5",
+	               NULL);
+}
+
+void test_mergeRollups(gconstpointer data)
+{
+	ItemInfo itemInfo = makeItemInfo(1, ITEM_INFO_VALUE_TYPE_INTEGER);
+	HistoryInfoVect historyInfoVect;
+	for (int i = 1; i <= 5; i++) {
+		appendHistory(historyInfoVect, itemInfo,
+		              BASE_TIME + (i - 1) * 60, 0,
+		              StringUtils::toString(i));
+	}
+	HistoryCache::RollupVect rollupVect;
+	HistoryCache::aggregate(rollupVect, historyInfoVect, 60);
+	HistoryCache::mergeRollups(rollupVect,
+	                           gcut_data_get_int(data, "maxPoints"));
+
+	// "<clock>:<min>-<max>" or "<clock>:<value>" of each bucket
+	string actual;
+	size_t count = 0;
+	for (size_t i = 0; i < rollupVect.size(); i++) {
+		const HistoryCache::Rollup &rollup = rollupVect[i];
+		if (!actual.empty())
+			actual += ",";
+		actual += StringUtils::sprintf("%ld:", rollup.clock - BASE_TIME);
+		if (rollup.min == rollup.max) {
+			actual += StringUtils::sprintf("%.0f", rollup.min);
+		} else {
+			actual += StringUtils::sprintf("%.0f-%.0f",
+			                               rollup.min, rollup.max);
+		}
+		count += rollup.count;
+	}
+	cppcut_assert_equal(string(gcut_data_get_string(data, "expected")),
+	                    actual);
+	cppcut_assert_equal((size_t)5, count);
+}
+
+void test_evictLeastRecentlyUsed(void)
+{
+	HistoryCache cache(2);
+	ItemInfo itemInfo1 = makeItemInfo(1, ITEM_INFO_VALUE_TYPE_FLOAT);
+	ItemInfo itemInfo2 = makeItemInfo(2, ITEM_INFO_VALUE_TYPE_FLOAT);
+	ItemInfo itemInfo3 = makeItemInfo(3, ITEM_INFO_VALUE_TYPE_FLOAT);
+	const time_t endTime = BASE_TIME + 60;
+	cache.add(itemInfo1, BASE_TIME, endTime, HistoryInfoVect());
+	cache.add(itemInfo2, BASE_TIME, endTime, HistoryInfoVect());
+	time_t fetchBeginTime;
+	cache.getRangeToFetch(itemInfo1, BASE_TIME, endTime, fetchBeginTime);
+	cache.add(itemInfo3, BASE_TIME, endTime, HistoryInfoVect());
+
+	cppcut_assert_equal((size_t)2, cache.getNumberOfItems());
+	cppcut_assert_equal(true, cache.getRangeToFetch(
+	  itemInfo1, BASE_TIME, endTime, fetchBeginTime));
+	cppcut_assert_equal(false, cache.getRangeToFetch(
+	  itemInfo2, BASE_TIME, endTime, fetchBeginTime));
+	cppcut_assert_equal(true, cache.getRangeToFetch(
+	  itemInfo3, BASE_TIME, endTime, fetchBeginTime));
+}
+
+void test_stringItemIsNotCached(void)
+{
+	ItemInfo itemInfo = makeItemInfo(1, ITEM_INFO_VALUE_TYPE_STRING);
+	HistoryInfoVect historyInfoVect;
+	appendHistory(historyInfoVect, itemInfo, BASE_TIME, 0, "foo");
+	HistoryCache cache(10);
+	cache.add(itemInfo, BASE_TIME, BASE_TIME + 60, historyInfoVect);
+	cppcut_assert_equal((size_t)0, cache.getNumberOfItems());
+}
+
+void test_disabled(void)
+{
+	ItemInfo itemInfo = makeItemInfo(1, ITEM_INFO_VALUE_TYPE_FLOAT);
+	HistoryCache cache(0);
+	cppcut_assert_equal(false, cache.isEnabled());
+	cache.add(itemInfo, BASE_TIME, BASE_TIME + 60, HistoryInfoVect());
+	cppcut_assert_equal((size_t)0, cache.getNumberOfItems());
+}
+
+void test_compressRegularSamples(void)
+{
+	ItemInfo itemInfo = makeItemInfo(1, ITEM_INFO_VALUE_TYPE_FLOAT);
+	HistoryInfoVect historyInfoVect;
+	const size_t numSamples = 1440;
+	for (size_t i = 0; i < numSamples; i++) {
+		appendHistory(historyInfoVect, itemInfo, BASE_TIME + i * 60,
+		              0, "0.5");
+	}
+	HistoryCache cache(10);
+	cache.add(itemInfo, BASE_TIME, BASE_TIME + numSamples * 60,
+	          historyInfoVect);
+	// 4 bits for each sample except the first one of each segment.
+	cppcut_assert_equal(true,
+	  cache.getDataSize() < numSamples * sizeof(double) / 8);
+}
+
+} // namespace testHistoryCache
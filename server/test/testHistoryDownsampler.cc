@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include <gcutter.h>
+#include <StringUtils.h>
+#include "HistoryDownsampler.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testHistoryDownsampler {
+
+static const time_t BASE_TIME = 1400000000;
+
+static void appendHistory(HistoryInfoVect &historyInfoVect,
+                          const time_t &sec, const string &value)
+{
+	HistoryInfo historyInfo;
+	historyInfo.serverId = 1;
+	historyInfo.itemId = 1;
+	historyInfo.value = value;
+	historyInfo.clock.tv_sec = sec;
+	historyInfo.clock.tv_nsec = 0;
+	historyInfoVect.push_back(historyInfo);
+}
+
+static void appendHistory(HistoryInfoVect &historyInfoVect,
+                          const time_t &sec, const int &value)
+{
+	appendHistory(historyInfoVect, sec, StringUtils::toString(value));
+}
+
+static string toString(const HistoryInfoVect &historyInfoVect)
+{
+	string str;
+	HistoryInfoVectConstIterator it = historyInfoVect.begin();
+	for (; it != historyInfoVect.end(); ++it) {
+		str += StringUtils::sprintf("%ld.%09ld %s\n",
+		  it->clock.tv_sec, it->clock.tv_nsec, it->value.c_str());
+	}
+	return str;
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void data_parseMethod(void)
+{
+	gcut_add_datum("lttb",
+	               "name", G_TYPE_STRING, "lttb",
+	               "method", G_TYPE_INT, HistoryDownsampler::METHOD_LTTB,
+	               NULL);
+	gcut_add_datum("minmax",
+	               "name", G_TYPE_STRING, "minmax",
+	               "method", G_TYPE_INT,
+	               HistoryDownsampler::METHOD_MIN_MAX,
+	               NULL);
+	gcut_add_datum("avg",
+	               "name", G_TYPE_STRING, "avg",
+	               "method", G_TYPE_INT,
+	               HistoryDownsampler::METHOD_AVERAGE,
+	               NULL);
+}
+
+void test_parseMethod(gconstpointer data)
+{
+	HistoryDownsampler::Method method;
+	cppcut_assert_equal(
+	  true,
+	  HistoryDownsampler::parseMethod(gcut_data_get_string(data, "name"),
+	                                  method));
+	cppcut_assert_equal(gcut_data_get_int(data, "method"), (int)method);
+}
+
+void test_parseUnknownMethod(void)
+{
+	HistoryDownsampler::Method method;
+	cppcut_assert_equal(
+	  false, HistoryDownsampler::parseMethod("median", method));
+}
+
+void test_fewerSamplesThanMaxPoints(void)
+{
+	HistoryInfoVect historyInfoVect;
+	for (int i = 0; i < 5; i++)
+		appendHistory(historyInfoVect, BASE_TIME + i, i);
+	HistoryInfoVect sampledVect;
+	HistoryDownsampler::downsample(sampledVect, historyInfoVect, 10,
+	                               HistoryDownsampler::METHOD_LTTB);
+	cppcut_assert_equal(toString(historyInfoVect), toString(sampledVect));
+}
+
+void test_lttb(void)
+{
+	// A flat line with a spike
+	HistoryInfoVect historyInfoVect;
+	for (int i = 0; i < 100; i++)
+		appendHistory(historyInfoVect, BASE_TIME + i, i == 42 ? 100 : 0);
+	HistoryInfoVect sampledVect;
+	HistoryDownsampler::downsample(sampledVect, historyInfoVect, 10,
+	                               HistoryDownsampler::METHOD_LTTB);
+	cppcut_assert_equal((size_t)10, sampledVect.size());
+	cppcut_assert_equal(BASE_TIME, sampledVect.front().clock.tv_sec);
+	cppcut_assert_equal(BASE_TIME + 99, sampledVect.back().clock.tv_sec);
+
+	bool hasSpike = false;
+	for (size_t i = 0; i < sampledVect.size(); i++) {
+		if (i > 0) {
+			cppcut_assert_equal(
+			  true, sampledVect[i - 1].clock.tv_sec <
+			        sampledVect[i].clock.tv_sec);
+		}
+		if (sampledVect[i].clock.tv_sec == BASE_TIME + 42) {
+			cppcut_assert_equal(string("100"),
+			                    sampledVect[i].value);
+			hasSpike = true;
+		}
+	}
+	cppcut_assert_equal(true, hasSpike);
+}
+
+void test_minMax(void)
+{
+	HistoryInfoVect historyInfoVect;
+	const int values[] = {3, 9, 1, 5,   7, 2, 8, 4};
+	for (size_t i = 0; i < G_N_ELEMENTS(values); i++)
+		appendHistory(historyInfoVect, BASE_TIME + i, values[i]);
+	HistoryInfoVect sampledVect;
+	HistoryDownsampler::downsample(sampledVect, historyInfoVect, 4,
+	                               HistoryDownsampler::METHOD_MIN_MAX);
+
+	HistoryInfoVect expectedVect;
+	appendHistory(expectedVect, BASE_TIME + 1, 9);
+	appendHistory(expectedVect, BASE_TIME + 2, 1);
+	appendHistory(expectedVect, BASE_TIME + 5, 2);
+	appendHistory(expectedVect, BASE_TIME + 6, 8);
+	cppcut_assert_equal(toString(expectedVect), toString(sampledVect));
+}
+
+void test_average(void)
+{
+	HistoryInfoVect historyInfoVect;
+	const int values[] = {1, 2, 3, 4,   10, 20, 30, 40};
+	for (size_t i = 0; i < G_N_ELEMENTS(values); i++)
+		appendHistory(historyInfoVect, BASE_TIME + i, values[i]);
+	HistoryInfoVect sampledVect;
+	HistoryDownsampler::downsample(sampledVect, historyInfoVect, 2,
+	                               HistoryDownsampler::METHOD_AVERAGE);
+
+	string expected = StringUtils::sprintf(
+	  "%ld.500000000 2.5\n%ld.500000000 25\n",
+	  BASE_TIME + 1, BASE_TIME + 5);
+	cppcut_assert_equal(expected, toString(sampledVect));
+}
+
+void test_nonNumericValuesAreIgnored(void)
+{
+	HistoryInfoVect historyInfoVect;
+	appendHistory(historyInfoVect, BASE_TIME, 1);
+	appendHistory(historyInfoVect, BASE_TIME + 1, "N/A");
+	appendHistory(historyInfoVect, BASE_TIME + 2, 3);
+	HistoryInfoVect sampledVect;
+	HistoryDownsampler::downsample(sampledVect, historyInfoVect, 10,
+	                               HistoryDownsampler::METHOD_LTTB);
+
+	HistoryInfoVect expectedVect;
+	appendHistory(expectedVect, BASE_TIME, 1);
+	appendHistory(expectedVect, BASE_TIME + 2, 3);
+	cppcut_assert_equal(toString(expectedVect), toString(sampledVect));
+}
+
+} // namespace testHistoryDownsampler
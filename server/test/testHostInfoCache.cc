@@ -18,8 +18,12 @@
  */
 
 #include <cppcutter.h>
+#include <StringUtils.h>
 #include "HostInfoCache.h"
+#include "Hatohol.h"
+#include "DBTablesTest.h"
 using namespace std;
+using namespace mlpl;
 
 namespace testHostInfoCache {
 
@@ -106,4 +110,109 @@ void test_getNameFromMany(void)
 	}
 }
 
+void test_getId(void)
+{
+	HostInfo hostInfo;
+	hostInfo.serverId = 100;
+	hostInfo.id = 2;
+	hostInfo.hostName = "foo";
+
+	HostInfoCache hiCache;
+	hiCache.update(hostInfo);
+	HostIdType id = INVALID_HOST_ID;
+	cppcut_assert_equal(true, hiCache.getId(hostInfo.hostName, id));
+	cppcut_assert_equal(hostInfo.id, id);
+	cppcut_assert_equal(false, hiCache.getId("bar", id));
+}
+
+void test_getIdAfterRename(void)
+{
+	HostInfo hostInfo;
+	hostInfo.serverId = 100;
+	hostInfo.id = 2;
+	hostInfo.hostName = "foo";
+
+	HostInfoCache hiCache;
+	hiCache.update(hostInfo);
+	hostInfo.hostName = "bar";
+	hiCache.update(hostInfo);
+
+	HostIdType id = INVALID_HOST_ID;
+	cppcut_assert_equal(false, hiCache.getId("foo", id));
+	cppcut_assert_equal(true, hiCache.getId("bar", id));
+	cppcut_assert_equal(hostInfo.id, id);
+	cppcut_assert_equal((size_t)1, hiCache.getNumberOfHosts());
+}
+
+void test_updateList(void)
+{
+	HostInfoList hostInfoList;
+	for (size_t i = 0; i < 3; i++) {
+		HostInfo hostInfo;
+		hostInfo.serverId = 100;
+		hostInfo.id = 10 + i;
+		hostInfo.hostName = StringUtils::sprintf("host%zd", i);
+		hostInfoList.push_back(hostInfo);
+	}
+
+	HostInfoCache hiCache;
+	hiCache.update(hostInfoList);
+	cppcut_assert_equal(hostInfoList.size(), hiCache.getNumberOfHosts());
+	HostInfoListIterator it = hostInfoList.begin();
+	for (; it != hostInfoList.end(); ++it) {
+		string name;
+		cppcut_assert_equal(true, hiCache.getName(it->id, name));
+		cppcut_assert_equal(it->hostName, name);
+	}
+}
+
+void test_getHostInfoList(void)
+{
+	HostInfo hostInfo;
+	hostInfo.serverId = 100;
+	hostInfo.id = 2;
+	hostInfo.hostName = "foo";
+	hostInfo.validity = HOST_INVALID;
+
+	HostInfoCache hiCache;
+	hiCache.update(hostInfo);
+	HostInfoList hostInfoList;
+	hiCache.getHostInfoList(hostInfoList);
+	cppcut_assert_equal((size_t)1, hostInfoList.size());
+	cppcut_assert_equal(hostInfo.id, hostInfoList.front().id);
+	cppcut_assert_equal(hostInfo.hostName, hostInfoList.front().hostName);
+	cppcut_assert_equal(hostInfo.validity, hostInfoList.front().validity);
+}
+
+void test_getInstanceLoadsHosts(void)
+{
+	hatoholInit();
+	setupTestDB();
+	loadTestDBHosts();
+	const HostInfo &hostInfo = testHostInfo[0];
+	HostInfoCache &hiCache = HostInfoCache::getInstance(hostInfo.serverId);
+	string name;
+	cppcut_assert_equal(true, hiCache.getName(hostInfo.id, name));
+	cppcut_assert_equal(hostInfo.hostName, name);
+}
+
+void test_referenceIsValidAfterReset(void)
+{
+	hatoholInit();
+	setupTestDB();
+	loadTestDBHosts();
+	const HostInfo &hostInfo = testHostInfo[0];
+	HostInfoCache &hiCache = HostInfoCache::getInstance(hostInfo.serverId);
+	HostInfoCache::reset();
+	cppcut_assert_equal((size_t)0, hiCache.getNumberOfHosts());
+
+	// The same instance is loaded again.
+	HostInfoCache &reloaded =
+	  HostInfoCache::getInstance(hostInfo.serverId);
+	cppcut_assert_equal(&hiCache, &reloaded);
+	string name;
+	cppcut_assert_equal(true, hiCache.getName(hostInfo.id, name));
+	cppcut_assert_equal(hostInfo.hostName, name);
+}
+
 } // namespace testHostInfoCache
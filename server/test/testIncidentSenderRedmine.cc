@@ -24,6 +24,7 @@
 #include <JSONParser.h>
 #include <ThreadLocalDBCache.h>
 #include <RedmineAPI.h>
+#include <MetricsRegistry.h>
 #include <cppcutter.h>
 #include <gcutter.h>
 #include "RedmineAPIEmulator.h"
@@ -452,4 +453,19 @@ void test_threadWithLimitOverErrors(void)
 	assertThread(retryLimit + 1, !shouldSuccessSending);
 }
 
+void test_queueLengthAfterDestruction(void)
+{
+	MetricGauge &queueLength = MetricsRegistry::getInstance()->getGauge(
+	  "hatohol_incident_sender_queue_length",
+	  "The number of incidents waiting to be sent");
+	const int64_t initialLength = queueLength.get();
+	IncidentTrackerInfo &tracker = testIncidentTrackerInfo[2];
+	TestRedmineSender *sender = new TestRedmineSender(tracker);
+	sender->queue(testEventInfo[0]);
+	sender->queue(testEventInfo[1]);
+	cppcut_assert_equal(initialLength + 2, queueLength.get());
+	delete sender;
+	cppcut_assert_equal(initialLength, queueLength.get());
+}
+
 }
@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include <gcutter.h>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <Mutex.h>
+#include <StringUtils.h>
+#include "IngestionJournal.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testIngestionJournal {
+
+static const ServerIdType SERVER_ID = 1;
+
+static string g_path;
+
+// Records the committed data as "T1,E2,I3".
+struct TestApplier : public IngestionJournal::Applier {
+	Mutex  mutex;
+	string log;
+	string preparedLog;
+	size_t numFailures;
+	size_t numPrepared;
+	size_t numDiscarded;
+
+	TestApplier(void)
+	: numFailures(0),
+	  numPrepared(0),
+	  numDiscarded(0)
+	{
+	}
+
+	void record(const char *type, const uint64_t &id)
+	{
+		if (!preparedLog.empty())
+			preparedLog += ",";
+		preparedLog += StringUtils::sprintf("%s%" PRIu64, type, id);
+	}
+
+	string getLog(void)
+	{
+		AutoMutex autoLock(&mutex);
+		return log;
+	}
+
+	virtual void prepare(const TriggerInfoList &triggerList,
+	                     const EventInfoList &eventList,
+	                     const ItemInfoList &itemList) override
+	{
+		AutoMutex autoLock(&mutex);
+		numPrepared++;
+		TriggerInfoListConstIterator trigIt = triggerList.begin();
+		for (; trigIt != triggerList.end(); ++trigIt)
+			record("T", trigIt->id);
+		EventInfoListConstIterator eventIt = eventList.begin();
+		for (; eventIt != eventList.end(); ++eventIt)
+			record("E", eventIt->id);
+		ItemInfoListConstIterator itemIt = itemList.begin();
+		for (; itemIt != itemList.end(); ++itemIt)
+			record("I", itemIt->id);
+	}
+
+	virtual void commit(void) override
+	{
+		AutoMutex autoLock(&mutex);
+		if (numFailures > 0) {
+			numFailures--;
+			throw runtime_error("Failed to store");
+		}
+		if (!log.empty() && !preparedLog.empty())
+			log += ",";
+		log += preparedLog;
+		preparedLog.clear();
+	}
+
+	virtual void discard(void) override
+	{
+		AutoMutex autoLock(&mutex);
+		numDiscarded++;
+		preparedLog.clear();
+	}
+};
+
+static void _assertFileSize(const string &path, const bool &empty)
+{
+	struct stat st;
+	cppcut_assert_equal(0, stat(path.c_str(), &st));
+	cppcut_assert_equal(empty, st.st_size == 0);
+}
+#define assertFileSize(P, E) cut_trace(_assertFileSize(P, E))
+
+static TriggerInfoList makeTriggerList(const TriggerIdType &id)
+{
+	TriggerInfo triggerInfo;
+	triggerInfo.serverId = SERVER_ID;
+	triggerInfo.id = id;
+	triggerInfo.status = TRIGGER_STATUS_PROBLEM;
+	triggerInfo.severity = TRIGGER_SEVERITY_WARNING;
+	triggerInfo.lastChangeTime.tv_sec = 1000;
+	triggerInfo.lastChangeTime.tv_nsec = 0;
+	triggerInfo.hostId = 10;
+	triggerInfo.hostName = "host";
+	triggerInfo.brief = "brief";
+	return TriggerInfoList(1, triggerInfo);
+}
+
+static EventInfoList makeEventList(const EventIdType &id,
+                                   const size_t &briefLength = 5)
+{
+	EventInfo eventInfo;
+	initEventInfo(eventInfo);
+	eventInfo.serverId = SERVER_ID;
+	eventInfo.id = id;
+	eventInfo.time.tv_sec = 1000 + id;
+	eventInfo.type = EVENT_TYPE_BAD;
+	eventInfo.triggerId = 100;
+	eventInfo.status = TRIGGER_STATUS_PROBLEM;
+	eventInfo.severity = TRIGGER_SEVERITY_WARNING;
+	eventInfo.hostId = 10;
+	eventInfo.hostName = "host";
+	eventInfo.brief = string(briefLength, 'b');
+	return EventInfoList(1, eventInfo);
+}
+
+static ItemInfoList makeItemList(const ItemIdType &id)
+{
+	ItemInfo itemInfo;
+	itemInfo.serverId = SERVER_ID;
+	itemInfo.id = id;
+	itemInfo.hostId = 10;
+	itemInfo.lastValueTime.tv_sec = 1000;
+	itemInfo.lastValueTime.tv_nsec = 0;
+	itemInfo.delay = 60;
+	itemInfo.valueType = ITEM_INFO_VALUE_TYPE_STRING;
+	itemInfo.brief = "brief";
+	itemInfo.lastValue = "1";
+	itemInfo.prevValue = "0";
+	itemInfo.itemGroupName = "group";
+	itemInfo.unit = "";
+	return ItemInfoList(1, itemInfo);
+}
+
+void cut_setup(void)
+{
+	g_path = StringUtils::sprintf(
+	  "/tmp/hatohol-test-ingestion-journal-%d", getpid());
+}
+
+void cut_teardown(void)
+{
+	remove(g_path.c_str());
+	remove((g_path + ".dead").c_str());
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_applyInOrder(void)
+{
+	TestApplier applier;
+	IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE, applier);
+	cppcut_assert_equal(true, journal.open());
+	journal.start();
+	cppcut_assert_equal(true, journal.append(makeTriggerList(1)));
+	cppcut_assert_equal(true, journal.append(makeEventList(2)));
+	cppcut_assert_equal(true, journal.append(makeItemList(3)));
+	journal.sync();
+	cppcut_assert_equal(string("T1,E2,I3"), applier.getLog());
+	cppcut_assert_equal((size_t)0, journal.getNumberOfPendingRecords());
+}
+
+void test_applyAfterReopen(void)
+{
+	TestApplier applier;
+	{
+		// The records aren't applied without the thread.
+		IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE,
+		                         applier);
+		cppcut_assert_equal(true, journal.open());
+		cppcut_assert_equal(true, journal.append(makeEventList(1)));
+		cppcut_assert_equal(true, journal.append(makeEventList(2)));
+	}
+	cppcut_assert_equal(string(""), applier.getLog());
+
+	IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE, applier);
+	cppcut_assert_equal(true, journal.open());
+	cppcut_assert_equal((size_t)2, journal.getNumberOfPendingRecords());
+	journal.start();
+	journal.sync();
+	cppcut_assert_equal(string("E1,E2"), applier.getLog());
+	cppcut_assert_equal((size_t)0, journal.getNumberOfPendingRecords());
+}
+
+void test_brokenRecordIsNotApplied(void)
+{
+	TestApplier applier;
+	{
+		IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE,
+		                         applier);
+		cppcut_assert_equal(true, journal.open());
+		cppcut_assert_equal(true, journal.append(makeEventList(1)));
+	}
+
+	// Overwrite the body of the record following the header page.
+	int fd = open(g_path.c_str(), O_RDWR);
+	cppcut_assert_equal(true, fd >= 0);
+	const char garbage = 0x55;
+	cppcut_assert_equal((ssize_t)1, pwrite(fd, &garbage, 1, 4096 + 40));
+	close(fd);
+
+	IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE, applier);
+	cppcut_assert_equal(true, journal.open());
+	cppcut_assert_equal((size_t)0, journal.getNumberOfPendingRecords());
+}
+
+void test_wrapAround(void)
+{
+	// About 50 records fill the journal.
+	const size_t numRecords = 200;
+	TestApplier applier;
+	IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE, applier);
+	cppcut_assert_equal(true, journal.open());
+	journal.start();
+	string expected;
+	for (size_t i = 1; i <= numRecords; i++) {
+		cppcut_assert_equal(true,
+		                    journal.append(makeEventList(i, 200)));
+		if (!expected.empty())
+			expected += ",";
+		expected += StringUtils::sprintf("E%zd", i);
+	}
+	journal.sync();
+	cppcut_assert_equal(expected, applier.getLog());
+}
+
+void test_wrapAroundBeforeApplied(void)
+{
+	TestApplier applier;
+	string expected;
+	{
+		// The applied records leave a space at the top.
+		IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE,
+		                         applier);
+		cppcut_assert_equal(true, journal.open());
+		journal.start();
+		for (size_t i = 1; i <= 30; i++) {
+			cppcut_assert_equal(
+			  true, journal.append(makeEventList(i, 200)));
+		}
+		journal.sync();
+		journal.exitSync();
+
+		// The records don't fit in the rest of the file without
+		// the space.
+		for (size_t i = 31; i <= 65; i++) {
+			cppcut_assert_equal(
+			  true, journal.append(makeEventList(i, 200)));
+			if (!expected.empty())
+				expected += ",";
+			expected += StringUtils::sprintf("E%zd", i);
+		}
+		cppcut_assert_equal((size_t)35,
+		                    journal.getNumberOfPendingRecords());
+	}
+
+	TestApplier reopenedApplier;
+	IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE,
+	                         reopenedApplier);
+	cppcut_assert_equal(true, journal.open());
+	cppcut_assert_equal((size_t)35, journal.getNumberOfPendingRecords());
+	journal.start();
+	journal.sync();
+	cppcut_assert_equal(expected, reopenedApplier.getLog());
+}
+
+void test_appendTooLargeList(void)
+{
+	TestApplier applier;
+	IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE, applier);
+	cppcut_assert_equal(true, journal.open());
+	cppcut_assert_equal(
+	  false,
+	  journal.append(makeEventList(1, IngestionJournal::MIN_SIZE)));
+	cppcut_assert_equal((size_t)0, journal.getNumberOfPendingRecords());
+}
+
+void test_retryAfterFailure(void)
+{
+	TestApplier applier;
+	applier.numFailures = 1;
+	IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE, applier);
+	cppcut_assert_equal(true, journal.open());
+	journal.start();
+	cppcut_assert_equal(true, journal.append(makeEventList(1)));
+	journal.sync();
+	cppcut_assert_equal(string("E1"), applier.getLog());
+}
+
+void test_prepareOnceForRetries(void)
+{
+	TestApplier applier;
+	applier.numFailures = 2;
+	IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE, applier);
+	cppcut_assert_equal(true, journal.open());
+	journal.start();
+	cppcut_assert_equal(true, journal.append(makeEventList(1)));
+	journal.sync();
+	cppcut_assert_equal(string("E1"), applier.getLog());
+	cppcut_assert_equal((size_t)1, applier.numPrepared);
+	cppcut_assert_equal((size_t)0, applier.numDiscarded);
+}
+
+void test_moveToDeadLetterFile(void)
+{
+	TestApplier applier;
+	applier.numFailures = 2;
+	IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE, applier,
+	                         1);
+	cppcut_assert_equal(true, journal.open());
+	journal.start();
+	cppcut_assert_equal(true, journal.append(makeEventList(1)));
+	journal.sync();
+	cppcut_assert_equal(true, journal.append(makeEventList(2)));
+	journal.sync();
+	cppcut_assert_equal(string("E2"), applier.getLog());
+	cppcut_assert_equal((size_t)1, applier.numDiscarded);
+	cppcut_assert_equal((size_t)0, journal.getNumberOfPendingRecords());
+	assertFileSize(g_path + ".dead", false);
+}
+
+void test_skipBrokenRecordWhileRunning(void)
+{
+	TestApplier applier;
+	IngestionJournal journal(g_path, IngestionJournal::MIN_SIZE, applier);
+	cppcut_assert_equal(true, journal.open());
+	cppcut_assert_equal(true, journal.append(makeEventList(1)));
+	cppcut_assert_equal(true, journal.append(makeEventList(2)));
+
+	// Overwrite the body of the first record in the mapped file.
+	int fd = open(g_path.c_str(), O_RDWR);
+	cppcut_assert_equal(true, fd >= 0);
+	const char garbage = 0x55;
+	cppcut_assert_equal((ssize_t)1, pwrite(fd, &garbage, 1, 4096 + 40));
+	close(fd);
+
+	// The records following the broken one are also skipped and
+	// the new one is applied.
+	journal.start();
+	journal.sync();
+	cppcut_assert_equal((size_t)0, journal.getNumberOfPendingRecords());
+	cppcut_assert_equal(true, journal.append(makeEventList(3)));
+	journal.sync();
+	cppcut_assert_equal(string("E3"), applier.getLog());
+	assertFileSize(g_path + ".dead", false);
+}
+
+} // namespace testIngestionJournal
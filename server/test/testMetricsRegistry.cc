@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cppcutter.h>
+#include "MetricsRegistry.h"
+using namespace std;
+
+namespace testMetricsRegistry {
+
+static bool contains(const string &text, const string &line)
+{
+	return text.find(line + "\n") != string::npos;
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_counter(void)
+{
+	MetricCounter counter;
+	counter.add();
+	counter.add(5);
+	cppcut_assert_equal((uint64_t)6, counter.get());
+}
+
+void test_gauge(void)
+{
+	MetricGauge gauge;
+	gauge.add(3);
+	gauge.sub();
+	cppcut_assert_equal((int64_t)2, gauge.get());
+	gauge.set(-7);
+	cppcut_assert_equal((int64_t)-7, gauge.get());
+}
+
+void data_getBucketIndex(void)
+{
+	gcut_add_datum("0",   "value", G_TYPE_UINT64, (guint64)0,
+	               "index", G_TYPE_UINT64, (guint64)0, NULL);
+	gcut_add_datum("1",   "value", G_TYPE_UINT64, (guint64)1,
+	               "index", G_TYPE_UINT64, (guint64)0, NULL);
+	gcut_add_datum("2",   "value", G_TYPE_UINT64, (guint64)2,
+	               "index", G_TYPE_UINT64, (guint64)1, NULL);
+	gcut_add_datum("3",   "value", G_TYPE_UINT64, (guint64)3,
+	               "index", G_TYPE_UINT64, (guint64)2, NULL);
+	gcut_add_datum("4",   "value", G_TYPE_UINT64, (guint64)4,
+	               "index", G_TYPE_UINT64, (guint64)2, NULL);
+	gcut_add_datum("5",   "value", G_TYPE_UINT64, (guint64)5,
+	               "index", G_TYPE_UINT64, (guint64)3, NULL);
+	gcut_add_datum("Max", "value", G_TYPE_UINT64, G_MAXUINT64,
+	               "index", G_TYPE_UINT64,
+	               (guint64)MetricHistogram::NUM_BUCKETS, NULL);
+}
+
+void test_getBucketIndex(gconstpointer data)
+{
+	const uint64_t value = gcut_data_get_uint64(data, "value");
+	const size_t index = gcut_data_get_uint64(data, "index");
+	cppcut_assert_equal(index, MetricHistogram::getBucketIndex(value));
+}
+
+void test_histogram(void)
+{
+	MetricHistogram histogram;
+	histogram.observe(1);
+	histogram.observe(3);
+	histogram.observe(4);
+	cppcut_assert_equal((uint64_t)3, histogram.getCount());
+	cppcut_assert_equal((uint64_t)8, histogram.getSum());
+	cppcut_assert_equal((uint64_t)1, histogram.getBucketCount(0));
+	cppcut_assert_equal((uint64_t)0, histogram.getBucketCount(1));
+	cppcut_assert_equal((uint64_t)2, histogram.getBucketCount(2));
+}
+
+void test_getSameMetric(void)
+{
+	MetricsRegistry *registry = MetricsRegistry::getInstance();
+	MetricCounter &counter1 = registry->getCounter(
+	  "test_get_same_metric_total", "help", "a=\"1\"");
+	MetricCounter &counter2 = registry->getCounter(
+	  "test_get_same_metric_total", "help", "a=\"1\"");
+	MetricCounter &counter3 = registry->getCounter(
+	  "test_get_same_metric_total", "help", "a=\"2\"");
+	cppcut_assert_equal(&counter1, &counter2);
+	cppcut_assert_not_equal(&counter1, &counter3);
+}
+
+void test_writePrometheusText(void)
+{
+	MetricsRegistry *registry = MetricsRegistry::getInstance();
+	registry->getCounter("test_write_total", "Test counter").add(3);
+	registry->getGauge("test_write_gauge", "Test gauge",
+	                   "q=\"foo\"").set(-2);
+	MetricHistogram &histogram = registry->getHistogram(
+	  "test_write_seconds", "Test histogram",
+	  MetricsRegistry::UNIT_MICRO_SEC);
+	histogram.observe(2);
+
+	string text;
+	registry->writePrometheusText(text);
+	cppcut_assert_equal(true, contains(text, "# HELP test_write_total Test counter"));
+	cppcut_assert_equal(true, contains(text, "# TYPE test_write_total counter"));
+	cppcut_assert_equal(true, contains(text, "test_write_total 3"));
+	cppcut_assert_equal(true, contains(text, "# TYPE test_write_gauge gauge"));
+	cppcut_assert_equal(true, contains(text, "test_write_gauge{q=\"foo\"} -2"));
+	cppcut_assert_equal(true, contains(text, "# TYPE test_write_seconds histogram"));
+	cppcut_assert_equal(true, contains(text, "test_write_seconds_bucket{le=\"1e-06\"} 0"));
+	cppcut_assert_equal(true, contains(text, "test_write_seconds_bucket{le=\"2e-06\"} 1"));
+	cppcut_assert_equal(true, contains(text, "test_write_seconds_bucket{le=\"+Inf\"} 1"));
+	cppcut_assert_equal(true, contains(text, "test_write_seconds_sum 2e-06"));
+	cppcut_assert_equal(true, contains(text, "test_write_seconds_count 1"));
+}
+
+} // namespace testMetricsRegistry
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <cppcutter.h>
+#include "NDOStreamParser.h"
+using namespace std;
+
+namespace testNDOStreamParser {
+
+static const char *STREAM_HEADER =
+  "HELLO\n"
+  "PROTOCOL: 2\n"
+  "AGENT: NDOMOD\n"
+  "STARTTIME: 1401234500\n"
+  "DISPOSITION: REALTIME\n"
+  "CONNECTION: UNIXSOCKET\n"
+  "CONNECTTYPE: INITIAL\n"
+  "INSTANCENAME: default\n"
+  "STARTDATADUMP\n"
+  "\n\n";
+
+static const char *STATE_CHANGE_RECORD =
+  "\n223:\n"
+  "1=1801\n"
+  "4=1401234567.012345\n"
+  "53=web01\n"
+  "114=HTTP\n"
+  "118=2\n"
+  "121=1\n"
+  "95=CRITICAL - Socket timeout\\nafter 10 seconds\n"
+  "999\n";
+
+static void feed(NDOStreamParser &parser, const string &str)
+{
+	parser.feed(str.c_str(), str.size());
+}
+
+static void assertStateChangeRecord(const NDOStreamParser::Record &record)
+{
+	typedef NDOStreamParser P;
+	cppcut_assert_equal(P::API_STATECHANGEDATA, record.type);
+	cppcut_assert_equal((int)P::NEBTYPE_STATECHANGE_END,
+	                    record.getInt(P::DATA_TYPE));
+	cppcut_assert_equal(string("web01"), record.get(P::DATA_HOST));
+	cppcut_assert_equal(string("HTTP"), record.get(P::DATA_SERVICE));
+	cppcut_assert_equal(2, record.getInt(P::DATA_STATE));
+	cppcut_assert_equal(1, record.getInt(P::DATA_STATETYPE));
+	cppcut_assert_equal(string("CRITICAL - Socket timeout\n"
+	                           "after 10 seconds"),
+	                    record.get(P::DATA_OUTPUT));
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_parseRecord(void)
+{
+	NDOStreamParser parser;
+	NDOStreamParser::Record record;
+	feed(parser, STREAM_HEADER);
+	cppcut_assert_equal(false, parser.pop(record));
+	feed(parser, STATE_CHANGE_RECORD);
+	cppcut_assert_equal(true, parser.pop(record));
+	assertStateChangeRecord(record);
+	cppcut_assert_equal(false, parser.pop(record));
+}
+
+void test_parseRecordSplitIntoBytes(void)
+{
+	NDOStreamParser parser;
+	NDOStreamParser::Record record;
+	const string stream = string(STREAM_HEADER) + STATE_CHANGE_RECORD;
+	for (size_t i = 0; i < stream.size(); i++) {
+		cppcut_assert_equal(false, parser.pop(record));
+		parser.feed(&stream[i], 1);
+	}
+	cppcut_assert_equal(true, parser.pop(record));
+	assertStateChangeRecord(record);
+}
+
+void test_parseMultipleRecordsInOneChunk(void)
+{
+	NDOStreamParser parser;
+	NDOStreamParser::Record record;
+	feed(parser, string(STATE_CHANGE_RECORD) + STATE_CHANGE_RECORD);
+	for (int i = 0; i < 2; i++) {
+		cppcut_assert_equal(true, parser.pop(record));
+		assertStateChangeRecord(record);
+	}
+	cppcut_assert_equal(false, parser.pop(record));
+}
+
+void test_reset(void)
+{
+	NDOStreamParser parser;
+	NDOStreamParser::Record record;
+	const string stream = STATE_CHANGE_RECORD;
+	parser.feed(stream.c_str(), stream.size() / 2);
+	parser.reset();
+	feed(parser, stream);
+	cppcut_assert_equal(true, parser.pop(record));
+	assertStateChangeRecord(record);
+	cppcut_assert_equal(false, parser.pop(record));
+}
+
+void test_getTimestamp(void)
+{
+	NDOStreamParser parser;
+	NDOStreamParser::Record record;
+	feed(parser, STATE_CHANGE_RECORD);
+	cppcut_assert_equal(true, parser.pop(record));
+	timespec ts = record.getTimestamp(NDOStreamParser::DATA_TIMESTAMP);
+	cppcut_assert_equal((time_t)1401234567, ts.tv_sec);
+	cppcut_assert_equal((long)12345000, ts.tv_nsec);
+}
+
+void test_getMissingValue(void)
+{
+	NDOStreamParser::Record record;
+	cppcut_assert_equal(false, record.has(NDOStreamParser::DATA_HOST));
+	cppcut_assert_equal(string(), record.get(NDOStreamParser::DATA_HOST));
+	cppcut_assert_equal(-1,
+	                    record.getInt(NDOStreamParser::DATA_STATE, -1));
+}
+
+void data_unescape(void)
+{
+	gcut_add_datum("no escape",
+	               "input", G_TYPE_STRING, "abc",
+	               "expect", G_TYPE_STRING, "abc", NULL);
+	gcut_add_datum("new line",
+	               "input", G_TYPE_STRING, "a\\nb",
+	               "expect", G_TYPE_STRING, "a\nb", NULL);
+	gcut_add_datum("carriage return",
+	               "input", G_TYPE_STRING, "a\\rb",
+	               "expect", G_TYPE_STRING, "a\rb", NULL);
+	gcut_add_datum("tab",
+	               "input", G_TYPE_STRING, "a\\tb",
+	               "expect", G_TYPE_STRING, "a\tb", NULL);
+	gcut_add_datum("back slash",
+	               "input", G_TYPE_STRING, "a\\\\nb",
+	               "expect", G_TYPE_STRING, "a\\nb", NULL);
+}
+
+void test_unescape(gconstpointer data)
+{
+	cppcut_assert_equal(
+	  string(gcut_data_get_string(data, "expect")),
+	  NDOStreamParser::unescape(gcut_data_get_string(data, "input")));
+}
+
+} // namespace testNDOStreamParser
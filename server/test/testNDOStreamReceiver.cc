@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <cppcutter.h>
+#include <StringUtils.h>
+#include <Mutex.h>
+#include "NDOStreamReceiver.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testNDOStreamReceiver {
+
+static const size_t TIMEOUT_MSEC = 5000;
+
+static const char *RECORD =
+  "\n223:\n"
+  "1=1801\n"
+  "53=web01\n"
+  "114=HTTP\n"
+  "999\n";
+
+struct ReceivedRecords {
+	Mutex                 lock;
+	vector<NDOStreamParser::Record> records;
+};
+
+static ReceivedRecords *g_received = NULL;
+static NDOStreamReceiver *g_receiver = NULL;
+static int g_clientFd = -1;
+static string g_path;
+
+static void recordHandler(const NDOStreamParser::Record &record, void *data)
+{
+	ReceivedRecords *received = static_cast<ReceivedRecords *>(data);
+	AutoMutex autoMutex(&received->lock);
+	received->records.push_back(record);
+}
+
+static size_t getNumReceived(void)
+{
+	AutoMutex autoMutex(&g_received->lock);
+	return g_received->records.size();
+}
+
+static void waitRecords(const size_t &expected)
+{
+	for (size_t t = 0; t < TIMEOUT_MSEC; t += 10) {
+		if (getNumReceived() >= expected)
+			break;
+		usleep(10 * 1000);
+	}
+	cppcut_assert_equal(expected, getNumReceived());
+}
+
+static void startReceiver(void)
+{
+	g_receiver = new NDOStreamReceiver(g_path, recordHandler, g_received);
+	g_receiver->start();
+}
+
+static bool connectToReceiver(void)
+{
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, g_path.c_str());
+	g_clientFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	cppcut_assert_equal(true, g_clientFd >= 0);
+	for (size_t t = 0; t < TIMEOUT_MSEC; t += 10) {
+		if (connect(g_clientFd, (sockaddr *)&addr, sizeof(addr)) == 0)
+			return true;
+		usleep(10 * 1000);
+	}
+	return false;
+}
+
+static void writeString(const int &fd, const string &str)
+{
+	cppcut_assert_equal((ssize_t)str.size(),
+	                    write(fd, str.c_str(), str.size()));
+}
+
+static void appendToFile(const string &str)
+{
+	FILE *fp = fopen(g_path.c_str(), "a");
+	cppcut_assert_not_null(fp);
+	cppcut_assert_equal(str.size(),
+	                    fwrite(str.c_str(), 1, str.size(), fp));
+	fclose(fp);
+}
+
+void cut_setup(void)
+{
+	g_path = StringUtils::sprintf("/tmp/hatohol-test-ndo-%d.ndo",
+	                              getpid());
+	unlink(g_path.c_str());
+	g_received = new ReceivedRecords();
+}
+
+void cut_teardown(void)
+{
+	if (g_clientFd >= 0)
+		close(g_clientFd);
+	g_clientFd = -1;
+	delete g_receiver;
+	g_receiver = NULL;
+	delete g_received;
+	g_received = NULL;
+	unlink(g_path.c_str());
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_receiveFromSocket(void)
+{
+	startReceiver();
+	cppcut_assert_equal(true, connectToReceiver());
+	writeString(g_clientFd, "HELLO\nAGENT: NDOMOD\n\n");
+	writeString(g_clientFd, RECORD);
+	writeString(g_clientFd, RECORD);
+	waitRecords(2);
+	cppcut_assert_equal(string("web01"),
+	  g_received->records[0].get(NDOStreamParser::DATA_HOST));
+}
+
+void test_reconnectToSocket(void)
+{
+	startReceiver();
+	cppcut_assert_equal(true, connectToReceiver());
+	writeString(g_clientFd, RECORD);
+	waitRecords(1);
+	close(g_clientFd);
+	g_clientFd = -1;
+
+	cppcut_assert_equal(true, connectToReceiver());
+	writeString(g_clientFd, RECORD);
+	waitRecords(2);
+}
+
+void test_tailFile(void)
+{
+	// Records that exist before the start should be ignored.
+	appendToFile(RECORD);
+	startReceiver();
+	// Wait for the receiver to open the file.
+	usleep(100 * 1000);
+	appendToFile(RECORD);
+	waitRecords(1);
+	cppcut_assert_equal(string("HTTP"),
+	  g_received->records[0].get(NDOStreamParser::DATA_SERVICE));
+}
+
+void test_socketFileIsRemovedOnExit(void)
+{
+	startReceiver();
+	cppcut_assert_equal(true, connectToReceiver());
+	delete g_receiver;
+	g_receiver = NULL;
+	cppcut_assert_equal(-1, access(g_path.c_str(), F_OK));
+}
+
+} // namespace testNDOStreamReceiver
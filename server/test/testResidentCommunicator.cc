@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cppcutter.h>
+#include "ResidentCommunicator.h"
+#include "DBTablesTest.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testResidentCommunicator {
+
+static void assertNotifyEventArg(const ActionIdType &actionId,
+                                 const EventInfo &eventInfo,
+                                 const string &sessionId,
+                                 const ResidentNotifyEventArg &arg)
+{
+	cppcut_assert_equal((uint32_t)actionId, arg.actionId);
+	cppcut_assert_equal((uint32_t)eventInfo.serverId, arg.serverId);
+	cppcut_assert_equal(eventInfo.hostId, arg.hostId);
+	cppcut_assert_equal(eventInfo.time.tv_sec, arg.time.tv_sec);
+	cppcut_assert_equal(eventInfo.time.tv_nsec, arg.time.tv_nsec);
+	cppcut_assert_equal(eventInfo.id, arg.eventId);
+	cppcut_assert_equal((uint16_t)eventInfo.type, arg.eventType);
+	cppcut_assert_equal(eventInfo.triggerId, arg.triggerId);
+	cppcut_assert_equal((uint16_t)eventInfo.status, arg.triggerStatus);
+	cppcut_assert_equal((uint16_t)eventInfo.severity,
+	                    arg.triggerSeverity);
+	cppcut_assert_equal(sessionId, string(arg.sessionId));
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_setNotifyEventsHeader(void)
+{
+	const size_t numEvents = 3;
+	ResidentCommunicator comm;
+	comm.setNotifyEventsHeader(numEvents);
+	SmartBuffer &sbuf = comm.getBuffer();
+	cppcut_assert_equal((int)RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENTS,
+	                    ResidentCommunicator::getPacketType(sbuf));
+	sbuf.resetIndex();
+	cppcut_assert_equal(
+	  (uint32_t)(RESIDENT_PROTO_NOTIFY_EVENTS_NUM_LEN +
+	             RESIDENT_PROTO_EVENT_BODY_LEN * numEvents),
+	  sbuf.getValue<uint32_t>());
+	sbuf.setIndex(RESIDENT_PROTO_HEADER_LEN);
+	cppcut_assert_equal((uint32_t)numEvents, sbuf.getValue<uint32_t>());
+}
+
+void test_addNotifyEventBodyAndGetNotifyEventArg(void)
+{
+	const ActionIdType actionId = 52;
+	const string sessionId = "0123456789abcdef0123456789abcdef0123";
+	const size_t numEvents = NumTestEventInfo;
+	ResidentCommunicator comm;
+	comm.setNotifyEventsHeader(numEvents);
+	for (size_t i = 0; i < numEvents; i++)
+		comm.addNotifyEventBody(actionId, testEventInfo[i], sessionId);
+
+	SmartBuffer &sbuf = comm.getBuffer();
+	cppcut_assert_equal(
+	  RESIDENT_PROTO_HEADER_LEN + RESIDENT_PROTO_NOTIFY_EVENTS_NUM_LEN +
+	  RESIDENT_PROTO_EVENT_BODY_LEN * numEvents, sbuf.index());
+	sbuf.setIndex(RESIDENT_PROTO_HEADER_LEN +
+	              RESIDENT_PROTO_NOTIFY_EVENTS_NUM_LEN);
+	for (size_t i = 0; i < numEvents; i++) {
+		ResidentNotifyEventArg arg;
+		ResidentCommunicator::getNotifyEventArg(sbuf, arg);
+		assertNotifyEventArg(actionId, testEventInfo[i], sessionId,
+		                     arg);
+	}
+}
+
+void test_setNotifyEventsAck(void)
+{
+	vector<uint32_t> resultCodes;
+	resultCodes.push_back(RESIDENT_MOD_NOTIFY_EVENT_ACK_OK);
+	resultCodes.push_back(0x12345678);
+	resultCodes.push_back(RESIDENT_MOD_NOTIFY_EVENT_ACK_OK);
+
+	ResidentCommunicator comm;
+	comm.setNotifyEventsAck(resultCodes);
+	SmartBuffer &sbuf = comm.getBuffer();
+	cppcut_assert_equal((int)RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENTS_ACK,
+	                    ResidentCommunicator::getPacketType(sbuf));
+	sbuf.resetIndex();
+	cppcut_assert_equal(
+	  (uint32_t)(RESIDENT_PROTO_NOTIFY_EVENTS_NUM_LEN +
+	             RESIDENT_PROTO_EVENT_ACK_CODE_LEN * resultCodes.size()),
+	  sbuf.getValueAndIncIndex<uint32_t>());
+	sbuf.setIndex(RESIDENT_PROTO_HEADER_LEN);
+	cppcut_assert_equal((uint32_t)resultCodes.size(),
+	                    sbuf.getValueAndIncIndex<uint32_t>());
+	for (size_t i = 0; i < resultCodes.size(); i++) {
+		cppcut_assert_equal(resultCodes[i],
+		                    sbuf.getValueAndIncIndex<uint32_t>());
+	}
+}
+
+} // namespace testResidentCommunicator
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include <gcutter.h>
+#include <StringUtils.h>
+#include "TextSearchIndex.h"
+#include "DBHatohol.h"
+#include "DBTermCodec.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testTextSearchIndex {
+
+static void appendDocument(TextSearchIndex::DocumentVect &documentVect,
+                           const ServerIdType &serverId, const uint64_t &id,
+                           const string &text)
+{
+	TextSearchIndex::Document document;
+	document.serverId = serverId;
+	document.id = id;
+	document.text = text;
+	documentVect.push_back(document);
+}
+
+static void setupIndex(TextSearchIndex &index)
+{
+	TextSearchIndex::DocumentVect documentVect;
+	appendDocument(documentVect, 1, 1, "Too many processes on hostX");
+	appendDocument(documentVect, 1, 2, "Free disk space is less than 20%");
+	appendDocument(documentVect, 2, 1, "Zabbix agent on hostY is down");
+	appendDocument(documentVect, 2, 5, "Too many users on hostY");
+	index.add(documentVect);
+}
+
+static string toString(const TextSearchIndex::KeySet &keySet)
+{
+	string str;
+	TextSearchIndex::KeySetConstIterator it = keySet.begin();
+	for (; it != keySet.end(); ++it) {
+		str += StringUtils::sprintf("%" FMT_SERVER_ID ":%" PRIu64 "\n",
+		                            it->first, it->second);
+	}
+	return str;
+}
+
+static string search(const TextSearchIndex &index, const string &query)
+{
+	TextSearchIndex::KeySet keySet;
+	index.search(keySet, query);
+	return toString(keySet);
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void data_search(void)
+{
+	gcut_add_datum("One word",
+	               "query", G_TYPE_STRING, "many",
+	               "expected", G_TYPE_STRING, "1:1\n2:5\n",
+	               NULL);
+	gcut_add_datum("Case insensitive",
+	               "query", G_TYPE_STRING, "ZABBIX",
+	               "expected", G_TYPE_STRING, "2:1\n",
+	               NULL);
+	gcut_add_datum("All words",
+	               "query", G_TYPE_STRING, "  hosty   many ",
+	               "expected", G_TYPE_STRING, "2:5\n",
+	               NULL);
+	gcut_add_datum("Part of a word",
+	               "query", G_TYPE_STRING, "proces",
+	               "expected", G_TYPE_STRING, "1:1\n",
+	               NULL);
+	gcut_add_datum("Short word",
+	               "query", G_TYPE_STRING, "20",
+	               "expected", G_TYPE_STRING, "1:2\n",
+	               NULL);
+	gcut_add_datum("Short and long words",
+	               "query", G_TYPE_STRING, "on down",
+	               "expected", G_TYPE_STRING, "2:1\n",
+	               NULL);
+	gcut_add_datum("No match",
+	               "query", G_TYPE_STRING, "memory",
+	               "expected", G_TYPE_STRING, "",
+	               NULL);
+	gcut_add_datum("Not in the same document",
+	               "query", G_TYPE_STRING, "disk hostY",
+	               "expected", G_TYPE_STRING, "",
+	               NULL);
+}
+
+void test_search(gconstpointer data)
+{
+	TextSearchIndex index;
+	setupIndex(index);
+	cppcut_assert_equal(string(gcut_data_get_string(data, "expected")),
+	                    search(index, gcut_data_get_string(data, "query")));
+}
+
+void test_replaceDocument(void)
+{
+	TextSearchIndex index;
+	setupIndex(index);
+	TextSearchIndex::DocumentVect documentVect;
+	appendDocument(documentVect, 2, 1, "Zabbix agent on hostY is up");
+	index.add(documentVect);
+
+	cppcut_assert_equal((size_t)4, index.getNumberOfDocuments());
+	cppcut_assert_equal(string(""), search(index, "down"));
+	cppcut_assert_equal(string("2:1\n"), search(index, "up"));
+}
+
+void test_replaceManyTimes(void)
+{
+	// The replaced documents are compacted in the meantime.
+	TextSearchIndex index;
+	for (int i = 0; i < 3000; i++) {
+		TextSearchIndex::DocumentVect documentVect;
+		appendDocument(documentVect, 1, 1,
+		               StringUtils::sprintf("value: %d", i));
+		index.add(documentVect);
+	}
+	cppcut_assert_equal((size_t)1, index.getNumberOfDocuments());
+	cppcut_assert_equal(string(""), search(index, "value: 2998"));
+	cppcut_assert_equal(string("1:1\n"), search(index, "value: 2999"));
+}
+
+void test_makeCondition(void)
+{
+	TextSearchIndex::KeySet keySet;
+	keySet.insert(TextSearchIndex::Key(3, 5));
+	keySet.insert(TextSearchIndex::Key(1, 3));
+	keySet.insert(TextSearchIndex::Key(1, 2));
+	cppcut_assert_equal(
+	  string("((server_id=1 AND id IN (2,3)) OR "
+	         "(server_id=3 AND id IN (5)))"),
+	  TextSearchIndex::makeCondition(keySet, "server_id", "id"));
+}
+
+void test_makeConditionWithEmptySet(void)
+{
+	TextSearchIndex::KeySet keySet;
+	cppcut_assert_equal(
+	  DBHatohol::getAlwaysFalseCondition(),
+	  TextSearchIndex::makeCondition(keySet, "server_id", "id"));
+}
+
+void test_evictOldDocuments(void)
+{
+	TextSearchIndex index(3);
+	setupIndex(index);
+	TextSearchIndex::DocumentVect documentVect;
+	appendDocument(documentVect, 1, 3, "Too many sessions on hostZ");
+	index.add(documentVect);
+
+	TextSearchIndex::KeySet keySet;
+	TextSearchIndex::EvictedIdMap evictedIdMap;
+	index.search(keySet, "many", &evictedIdMap);
+	cppcut_assert_equal((size_t)3, index.getNumberOfDocuments());
+	cppcut_assert_equal(string("1:3\n2:5\n"), toString(keySet));
+	cppcut_assert_equal((size_t)1, evictedIdMap.size());
+	cppcut_assert_equal((uint64_t)2, evictedIdMap[1]);
+}
+
+void test_makeEvictedCondition(void)
+{
+	TextSearchIndex::EvictedIdMap evictedIdMap;
+	evictedIdMap[3] = 5;
+	evictedIdMap[1] = 2;
+	cppcut_assert_equal(
+	  string("((server_id=1 AND id<=2) OR (server_id=3 AND id<=5))"),
+	  TextSearchIndex::makeEvictedCondition(evictedIdMap,
+	                                        "server_id", "id"));
+}
+
+void test_makeLikeCondition(void)
+{
+	DBTermCodec dbTermCodec;
+	vector<string> columns;
+	columns.push_back("brief");
+	columns.push_back("host_name");
+	cppcut_assert_equal(
+	  string("(brief LIKE '%50!%%' ESCAPE '!' OR "
+	         "host_name LIKE '%50!%%' ESCAPE '!') AND "
+	         "(brief LIKE '%a!_b''c\\\\%' ESCAPE '!' OR "
+	         "host_name LIKE '%a!_b''c\\\\%' ESCAPE '!')"),
+	  TextSearchIndex::makeLikeCondition("50% a_b'c\\", columns,
+	                                     dbTermCodec));
+}
+
+} // namespace testTextSearchIndex
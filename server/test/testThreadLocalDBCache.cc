@@ -75,12 +75,19 @@ public:
 protected:
 	virtual gpointer mainThread(HatoholThreadArg *arg)
 	{
+		// The connection is held until the thread exits.
+		ThreadLocalDBCache outerCache;
 		while (true) {
 			m_requestSem.wait();
 			if (m_exitRequest)
 				break;
 			ThreadLocalDBCache cache;
-			m_dbHatohol = &cache.getDBHatohol();
+			try {
+				m_dbHatohol = &cache.getDBHatohol();
+			} catch (const HatoholException &e) {
+				m_dbHatohol = NULL;
+				m_hasError = true;
+			}
 			m_completSem.post();
 		}
 		return NULL;
@@ -107,11 +114,19 @@ static void _assertType(DBTables &dbTables)
 #define assertType(E,DBC) cut_trace(_assertType<E>(DBC))
 
 static vector<TestCacheServiceThread *> g_threads;
+static size_t g_savedMaxNumConnections;
+static size_t g_savedWaitTimeout;
+static size_t g_savedMaxNumOverflows;
 
 void cut_setup(void)
 {
 	hatoholInit();
 	setupTestDB();
+	g_savedMaxNumConnections =
+	  ThreadLocalDBCache::getMaxNumberOfConnections();
+	g_savedWaitTimeout = ThreadLocalDBCache::getWaitTimeout();
+	g_savedMaxNumOverflows =
+	  ThreadLocalDBCache::getMaxNumberOfOverflowConnections();
 }
 
 void cut_teardown(void)
@@ -125,6 +140,11 @@ void cut_teardown(void)
 			hasError = true;
 	}
 	g_threads.clear();
+	ThreadLocalDBCache::setMaxNumberOfConnections(
+	  g_savedMaxNumConnections);
+	ThreadLocalDBCache::setWaitTimeout(g_savedWaitTimeout);
+	ThreadLocalDBCache::setMaxNumberOfOverflowConnections(
+	  g_savedMaxNumOverflows);
 	cppcut_assert_equal(false, hasError);
 }
 
@@ -159,25 +179,99 @@ void test_ensureCached(void)
 	}
 }
 
-void test_cleanupOnThreadExit(void)
+void test_returnToPoolOnThreadExit(void)
 {
 	// Some thread may be running with the cache when this test is executed
-	// So the number of the cached DB may not be zero. We have to
+	// So the number of the idle DB may not be zero. We have to
 	// take into account it.
-	size_t numCached0 = ThreadLocalDBCache::getNumberOfDBClientMaps();
 	test_hasInstanceByThread();
-	size_t numCached = ThreadLocalDBCache::getNumberOfDBClientMaps();
-	cppcut_assert_equal(g_threads.size() + numCached0, numCached);
+	const size_t numConnections =
+	  ThreadLocalDBCache::getNumberOfDBClientMaps();
+	size_t numIdle = ThreadLocalDBCache::getNumberOfIdleConnections();
 	for (size_t i = 0; i < g_threads.size(); i++) {
 		TestCacheServiceThread *thr = g_threads[i];
 		bool hasError = deleteTestCacheServiceThread(thr);
 		g_threads[i] = NULL;
 		cppcut_assert_equal(true, hasError);
-		size_t newNumCached =
-		  ThreadLocalDBCache::getNumberOfDBClientMaps();
-		cppcut_assert_equal(numCached - 1, newNumCached);
-		numCached = newNumCached;
+		size_t newNumIdle =
+		  ThreadLocalDBCache::getNumberOfIdleConnections();
+		cppcut_assert_equal(numIdle + 1, newNumIdle);
+		numIdle = newNumIdle;
 	}
+	cppcut_assert_equal(numConnections,
+	                    ThreadLocalDBCache::getNumberOfDBClientMaps());
+}
+
+void test_shareByNestedInstances(void)
+{
+	ThreadLocalDBCache cache;
+	DBHatohol *dbHatohol = &cache.getDBHatohol();
+	{
+		ThreadLocalDBCache nestedCache;
+		cppcut_assert_equal(dbHatohol, &nestedCache.getDBHatohol());
+	}
+	// The connection is still leased after the nested one is gone.
+	cppcut_assert_equal(dbHatohol, &cache.getDBHatohol());
+}
+
+void test_reuseReturnedDB(void)
+{
+	DBHatohol *dbHatohol = NULL;
+	size_t numIdle = 0;
+	{
+		ThreadLocalDBCache cache;
+		dbHatohol = &cache.getDBHatohol();
+		numIdle = ThreadLocalDBCache::getNumberOfIdleConnections();
+	}
+	cppcut_assert_equal(
+	  numIdle + 1, ThreadLocalDBCache::getNumberOfIdleConnections());
+	ThreadLocalDBCache cache;
+	cppcut_assert_equal(dbHatohol, &cache.getDBHatohol());
+	cppcut_assert_equal(
+	  numIdle, ThreadLocalDBCache::getNumberOfIdleConnections());
+}
+
+void test_overflowWhenExhausted(void)
+{
+	ThreadLocalDBCache::setMaxNumberOfConnections(1);
+	ThreadLocalDBCache::setWaitTimeout(10);
+	ThreadLocalDBCache cache;
+	DBHatohol *dbHatohol = &cache.getDBHatohol();
+	const size_t numConnections =
+	  ThreadLocalDBCache::getNumberOfDBClientMaps();
+
+	TestCacheServiceThread *thr = new TestCacheServiceThread();
+	g_threads.push_back(thr);
+	thr->start();
+	cppcut_assert_not_equal(dbHatohol, thr->callGetHatohol());
+	cppcut_assert_equal(numConnections + 1,
+	                    ThreadLocalDBCache::getNumberOfDBClientMaps());
+
+	// The extra connection is closed when it is returned.
+	cppcut_assert_equal(true, deleteTestCacheServiceThread(thr));
+	g_threads.clear();
+	cppcut_assert_equal(numConnections,
+	                    ThreadLocalDBCache::getNumberOfDBClientMaps());
+}
+
+void test_failWhenOverflowsAreExhausted(void)
+{
+	ThreadLocalDBCache::setMaxNumberOfConnections(1);
+	ThreadLocalDBCache::setWaitTimeout(10);
+	ThreadLocalDBCache::setMaxNumberOfOverflowConnections(0);
+	ThreadLocalDBCache cache;
+	cache.getDBHatohol();
+	const size_t numConnections =
+	  ThreadLocalDBCache::getNumberOfDBClientMaps();
+
+	TestCacheServiceThread *thr = new TestCacheServiceThread();
+	g_threads.push_back(thr);
+	thr->start();
+	cppcut_assert_null(thr->callGetHatohol());
+	cppcut_assert_equal(numConnections,
+	                    ThreadLocalDBCache::getNumberOfDBClientMaps());
+	cppcut_assert_equal(false, deleteTestCacheServiceThread(thr));
+	g_threads.clear();
 }
 
 void test_getMonitoring(void)
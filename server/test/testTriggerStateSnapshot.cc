@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2014 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hatohol. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include <gcutter.h>
+#include "TriggerStateSnapshot.h"
+#include "ThreadLocalDBCache.h"
+#include "Hatohol.h"
+#include "DBTablesTest.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testTriggerStateSnapshot {
+
+static size_t countTestTriggers(const ServerIdType &serverId,
+                                const HostIdSet &hostIdSet)
+{
+	size_t numTriggers = 0;
+	for (size_t i = 0; i < NumTestTriggerInfo; i++) {
+		const TriggerInfo &triggerInfo = testTriggerInfo[i];
+		if (triggerInfo.serverId != serverId)
+			continue;
+		if (hostIdSet.find(triggerInfo.hostId) == hostIdSet.end())
+			continue;
+		numTriggers++;
+	}
+	return numTriggers;
+}
+
+static size_t findTriggers(const TriggersQueryOption &option)
+{
+	TriggerStateSnapshotPtr snapshot(TriggerStateSnapshot::get(), false);
+	TriggerStateSnapshot::TriggerInfoPtrVect triggers;
+	snapshot->find(triggers, option);
+	return triggers.size();
+}
+
+void cut_setup(void)
+{
+	hatoholInit();
+	setupTestDB();
+	loadTestDBTriggers();
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_loadFromDB(void)
+{
+	TriggerStateSnapshotPtr snapshot(TriggerStateSnapshot::get(), false);
+	cppcut_assert_equal(NumTestTriggerInfo,
+	                    snapshot->getNumberOfTriggers());
+}
+
+void test_acquiredSnapshotIsNotChanged(void)
+{
+	TriggerStateSnapshotPtr snapshot(TriggerStateSnapshot::get(), false);
+
+	TriggerInfo triggerInfo = testTriggerInfo[0];
+	triggerInfo.id = 0x12345678;
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().addTriggerInfo(&triggerInfo);
+
+	cppcut_assert_equal(NumTestTriggerInfo,
+	                    snapshot->getNumberOfTriggers());
+	TriggerStateSnapshotPtr next(TriggerStateSnapshot::get(), false);
+	cppcut_assert_equal(NumTestTriggerInfo + 1,
+	                    next->getNumberOfTriggers());
+}
+
+void test_updateTrigger(void)
+{
+	// Load the snapshot so that the write below updates it.
+	TriggerStateSnapshotPtr loaded(TriggerStateSnapshot::get(), false);
+
+	TriggerInfo triggerInfo = testTriggerInfo[0];
+	triggerInfo.status = TRIGGER_STATUS_PROBLEM;
+	triggerInfo.brief = "Updated";
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().addTriggerInfo(&triggerInfo);
+
+	TriggersQueryOption option(USER_ID_SYSTEM);
+	option.setFilterForDataOfDefunctServers(false);
+	option.setTargetServerId(triggerInfo.serverId);
+	option.setTargetId(triggerInfo.id);
+	TriggerStateSnapshotPtr snapshot(TriggerStateSnapshot::get(), false);
+	TriggerStateSnapshot::TriggerInfoPtrVect triggers;
+	snapshot->find(triggers, option);
+	cppcut_assert_equal((size_t)1, triggers.size());
+	cppcut_assert_equal(TRIGGER_STATUS_PROBLEM, triggers[0]->status);
+	cppcut_assert_equal(string("Updated"), triggers[0]->brief);
+	cppcut_assert_equal(NumTestTriggerInfo,
+	                    snapshot->getNumberOfTriggers());
+}
+
+void test_updateIndexesOfTrigger(void)
+{
+	// Load the snapshot so that the write below updates it.
+	TriggerStateSnapshotPtr loaded(TriggerStateSnapshot::get(), false);
+
+	const TriggerInfo &orig = testTriggerInfo[0];
+	TriggerInfo triggerInfo = orig;
+	triggerInfo.hostId = 0x12345678;
+	triggerInfo.severity = TRIGGER_SEVERITY_EMERGENCY;
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().addTriggerInfo(&triggerInfo);
+
+	TriggersQueryOption option(USER_ID_SYSTEM);
+	option.setFilterForDataOfDefunctServers(false);
+	option.setTargetServerId(orig.serverId);
+	option.setTargetHostId(triggerInfo.hostId);
+	cppcut_assert_equal((size_t)1, findTriggers(option));
+
+	HostIdSet hostIdSet;
+	hostIdSet.insert(orig.hostId);
+	option.setTargetHostId(orig.hostId);
+	cppcut_assert_equal(countTestTriggers(orig.serverId, hostIdSet) - 1,
+	                    findTriggers(option));
+
+	size_t numEmergency = 0;
+	for (size_t i = 0; i < NumTestTriggerInfo; i++) {
+		if (testTriggerInfo[i].severity == TRIGGER_SEVERITY_EMERGENCY)
+			numEmergency++;
+	}
+	if (orig.severity != TRIGGER_SEVERITY_EMERGENCY)
+		numEmergency++;
+	TriggersQueryOption severityOption(USER_ID_SYSTEM);
+	severityOption.setFilterForDataOfDefunctServers(false);
+	severityOption.setMinimumSeverity(TRIGGER_SEVERITY_EMERGENCY);
+	cppcut_assert_equal(numEmergency, findTriggers(severityOption));
+}
+
+void test_replaceTriggersOfServer(void)
+{
+	// Load the snapshot so that the write below updates it.
+	TriggerStateSnapshotPtr loaded(TriggerStateSnapshot::get(), false);
+
+	const TriggerInfo &triggerInfo = testTriggerInfo[0];
+	TriggerInfoList triggerInfoList;
+	triggerInfoList.push_back(triggerInfo);
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().setTriggerInfoList(triggerInfoList,
+	                                         triggerInfo.serverId);
+
+	TriggersQueryOption option(USER_ID_SYSTEM);
+	option.setFilterForDataOfDefunctServers(false);
+	option.setTargetServerId(triggerInfo.serverId);
+	cppcut_assert_equal((size_t)1, findTriggers(option));
+}
+
+void test_findWithHostgroup(void)
+{
+	loadTestDBHostgroupElements();
+
+	// server 1, host group 2: hosts 235012 and 235013
+	TriggersQueryOption option(USER_ID_SYSTEM);
+	option.setFilterForDataOfDefunctServers(false);
+	option.setTargetServerId(1);
+	option.setTargetHostgroupId(2);
+	HostIdSet hostIdSet;
+	hostIdSet.insert(235012);
+	hostIdSet.insert(235013);
+	cppcut_assert_equal(countTestTriggers(1, hostIdSet),
+	                    findTriggers(option));
+
+	HostgroupElementList hostgroupElementList;
+	HostgroupElement hostgroupElement;
+	hostgroupElement.id = AUTO_INCREMENT_VALUE;
+	hostgroupElement.serverId = 1;
+	hostgroupElement.hostId = 235013;
+	hostgroupElement.groupId = 2;
+	hostgroupElementList.push_back(hostgroupElement);
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().deleteHostgroupElementList(hostgroupElementList);
+
+	hostIdSet.erase(235013);
+	cppcut_assert_equal(countTestTriggers(1, hostIdSet),
+	                    findTriggers(option));
+}
+
+void test_findWithInvalidUser(void)
+{
+	TriggersQueryOption option(INVALID_USER_ID);
+	option.setFilterForDataOfDefunctServers(false);
+	cppcut_assert_equal((size_t)0, findTriggers(option));
+}
+
+void test_findById(void)
+{
+	const TriggerInfo &expected = testTriggerInfo[1];
+	TriggerStateSnapshotPtr snapshot(TriggerStateSnapshot::get(), false);
+	const TriggerInfo *triggerInfo =
+	  snapshot->find(expected.serverId, expected.id);
+	cppcut_assert_not_null(triggerInfo);
+	cppcut_assert_equal(expected.hostId, triggerInfo->hostId);
+	cppcut_assert_null(snapshot->find(expected.serverId, 0x12345678));
+}
+
+} // namespace testTriggerStateSnapshot
@@ -28,6 +28,9 @@
 #include "DBTablesTest.h"
 #include "LabelUtils.h"
 #include "Helpers.h"
+#include "ConfigManager.h"
+#include "ThreadLocalDBCache.h"
+#include "MetricsRegistry.h"
 using namespace std;
 using namespace mlpl;
 
@@ -136,6 +139,11 @@ void cut_setup(void)
 	loadTestDBTablesConfig();
 }
 
+void cut_teardown(void)
+{
+	ConfigManager::getInstance()->setEventFlapWindow(0);
+}
+
 // ---------------------------------------------------------------------------
 // Test cases
 // ---------------------------------------------------------------------------
@@ -278,4 +286,53 @@ void test_getServerConnStatusVector(void)
 	}
 }
 
+void test_getLastEventIdWithDroppedEvents(void)
+{
+	// The events of a flapping trigger are dropped.
+	ConfigManager::getInstance()->setEventFlapWindow(60);
+	const ServerIdType serverId = 1;
+	const EventIdType lastEventId = 10;
+	EventInfoList eventList;
+	for (EventIdType id = 1; id <= lastEventId; id++) {
+		EventInfo eventInfo;
+		initEventInfo(eventInfo);
+		eventInfo.serverId = serverId;
+		eventInfo.id = id;
+		eventInfo.time.tv_sec = 1000 + id;
+		eventInfo.triggerId = 1;
+		eventInfo.status = (id % 2) ?
+		  TRIGGER_STATUS_PROBLEM : TRIGGER_STATUS_OK;
+		eventInfo.type = (id % 2) ? EVENT_TYPE_BAD : EVENT_TYPE_GOOD;
+		eventList.push_back(eventInfo);
+	}
+	UnifiedDataStore *uds = UnifiedDataStore::getInstance();
+	uds->addEventList(eventList);
+
+	ThreadLocalDBCache cache;
+	cppcut_assert_equal(
+	  true, cache.getMonitoring().getLastEventId(serverId) < lastEventId);
+	cppcut_assert_equal(lastEventId, uds->getLastEventId(serverId));
+}
+
+void test_eventIngestionMetrics(void)
+{
+	MetricsRegistry *metrics = MetricsRegistry::getInstance();
+	MetricCounter &numReceived = metrics->getCounter(
+	  "hatohol_received_events_total",
+	  "The number of events received from the monitoring servers");
+	MetricCounter &numStored = metrics->getCounter(
+	  "hatohol_stored_events_total",
+	  "The number of events stored in the DB");
+	const uint64_t initialNumReceived = numReceived.get();
+	const uint64_t initialNumStored = numStored.get();
+
+	const size_t numEvents = 3;
+	EventInfoList eventList;
+	for (size_t i = 0; i < numEvents; i++)
+		eventList.push_back(testEventInfo[i]);
+	UnifiedDataStore::getInstance()->addEventList(eventList);
+	cppcut_assert_equal(initialNumReceived + numEvents, numReceived.get());
+	cppcut_assert_equal(initialNumStored + numEvents, numStored.get());
+}
+
 } // testUnifiedDataStore
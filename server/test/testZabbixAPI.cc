@@ -131,6 +131,62 @@ void test_verifyGroupsAndHostsGroups(void)
 	assertItemTable(expectHostsGroupsTablePtr, actualHostsGroupsTablePtr);
 }
 
+void test_getHostsAndGroups(void)
+{
+	MonitoringServerInfo serverInfo;
+	ZabbixAPITestee::initServerInfoWithDefaultParam(serverInfo);
+	ZabbixAPITestee zbxApiTestee(serverInfo);
+	zbxApiTestee.testOpenSession();
+
+	ItemTablePtr expectHostsTablePtr;
+	ItemTablePtr expectHostsGroupsTablePtr;
+	ItemTablePtr expectGroupsTablePtr;
+	zbxApiTestee.callGetHosts(expectHostsTablePtr,
+	                          expectHostsGroupsTablePtr);
+	zbxApiTestee.callGetGroups(expectGroupsTablePtr);
+
+	ItemTablePtr actualHostsTablePtr;
+	ItemTablePtr actualHostsGroupsTablePtr;
+	ItemTablePtr actualGroupsTablePtr;
+	zbxApiTestee.callGetHostsAndGroups(actualHostsTablePtr,
+	                                   actualHostsGroupsTablePtr,
+	                                   actualGroupsTablePtr);
+
+	assertItemTable(expectHostsTablePtr, actualHostsTablePtr);
+	assertItemTable(expectHostsGroupsTablePtr, actualHostsGroupsTablePtr);
+	assertItemTable(expectGroupsTablePtr, actualGroupsTablePtr);
+}
+
+void test_getHostsAndGroupsWithoutBatchSupport(void)
+{
+	MonitoringServerInfo serverInfo;
+	ZabbixAPITestee::initServerInfoWithDefaultParam(serverInfo);
+	ZabbixAPITestee zbxApiTestee(serverInfo);
+	zbxApiTestee.testOpenSession();
+
+	ItemTablePtr expectHostsTablePtr;
+	ItemTablePtr expectHostsGroupsTablePtr;
+	ItemTablePtr expectGroupsTablePtr;
+	zbxApiTestee.callGetHosts(expectHostsTablePtr,
+	                          expectHostsGroupsTablePtr);
+	zbxApiTestee.callGetGroups(expectGroupsTablePtr);
+
+	// The second call doesn't try the batch request.
+	zbxApiTestee.setBatchRequestSupported(false);
+	for (size_t i = 0; i < 2; i++) {
+		ItemTablePtr actualHostsTablePtr;
+		ItemTablePtr actualHostsGroupsTablePtr;
+		ItemTablePtr actualGroupsTablePtr;
+		zbxApiTestee.callGetHostsAndGroups(actualHostsTablePtr,
+		                                   actualHostsGroupsTablePtr,
+		                                   actualGroupsTablePtr);
+		assertItemTable(expectHostsTablePtr, actualHostsTablePtr);
+		assertItemTable(expectHostsGroupsTablePtr,
+		                actualHostsGroupsTablePtr);
+		assertItemTable(expectGroupsTablePtr, actualGroupsTablePtr);
+	}
+}
+
 void test_getLastEventId(void)
 {
 	MonitoringServerInfo serverInfo;